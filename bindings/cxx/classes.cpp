@@ -28,12 +28,35 @@
 
 #include <sstream>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
 
 namespace sigrok
 {
 
 using namespace std;
 
+/* Bounded packet queue between the session thread and next_packet(). */
+class SR_PRIV PullQueue
+{
+public:
+	explicit PullQueue(size_t capacity) :
+		capacity(capacity), finished(false), discard(false)
+	{
+	}
+	size_t capacity;
+	std::mutex mutex;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+	std::deque<pair<shared_ptr<Device>, shared_ptr<Packet>>> packets;
+	bool finished;
+	bool discard;
+	std::thread thread;
+};
+
 /** Helper function to translate C errors to C++ exceptions. */
 static void check(int result)
 {
@@ -321,6 +344,14 @@ shared_ptr<Packet> Context::create_meta_packet(
 
 shared_ptr<Packet> Context::create_logic_packet(
 	void *data_pointer, size_t data_length, unsigned int unit_size)
+{
+	return create_logic_packet(data_pointer, data_length, unit_size,
+		ReleaseCallback());
+}
+
+shared_ptr<Packet> Context::create_logic_packet(
+	void *data_pointer, size_t data_length, unsigned int unit_size,
+	ReleaseCallback release)
 {
 	auto logic = g_new(struct sr_datafeed_logic, 1);
 	logic->length = data_length;
@@ -329,7 +360,9 @@ shared_ptr<Packet> Context::create_logic_packet(
 	auto packet = g_new(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_LOGIC;
 	packet->payload = logic;
-	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
+	auto result = new Packet{nullptr, packet};
+	result->_release = move(release);
+	return shared_ptr<Packet>{result, default_delete<Packet>{}};
 }
 
 shared_ptr<Packet> Context::create_analog_packet(
@@ -337,6 +370,31 @@ shared_ptr<Packet> Context::create_analog_packet(
 	const float *data_pointer, unsigned int num_samples, const Quantity *mq,
 	const Unit *unit, vector<const QuantityFlag *> mqflags)
 {
+#ifdef WORDS_BIGENDIAN
+	const bool is_bigendian = true;
+#else
+	const bool is_bigendian = false;
+#endif
+	return create_analog_packet(move(channels), data_pointer, num_samples,
+		sizeof(float), true, true, is_bigendian, make_pair(1, 1),
+		make_pair(0, 1), mq, unit, move(mqflags));
+}
+
+shared_ptr<Packet> Context::create_analog_packet(
+	vector<shared_ptr<Channel> > channels,
+	const void *data_pointer, unsigned int num_samples,
+	unsigned int unit_size, bool is_signed, bool is_float,
+	bool is_bigendian, pair<int64_t, uint64_t> scale,
+	pair<int64_t, uint64_t> offset, const Quantity *mq,
+	const Unit *unit, vector<const QuantityFlag *> mqflags,
+	ReleaseCallback release)
+{
+	if (unit_size == 0 || (is_float && unit_size != sizeof(float)
+			&& unit_size != sizeof(double)))
+		throw Error(SR_ERR_ARG);
+	if (scale.second == 0 || offset.second == 0)
+		throw Error(SR_ERR_ARG);
+
 	auto analog = g_new0(struct sr_datafeed_analog, 1);
 	auto meaning = g_new0(struct sr_analog_meaning, 1);
 	auto encoding = g_new0(struct sr_analog_encoding, 1);
@@ -352,31 +410,29 @@ shared_ptr<Packet> Context::create_analog_packet(
 
 	analog->encoding = encoding;
 
-	encoding->unitsize = sizeof(float);
-	encoding->is_signed = TRUE;
-	encoding->is_float = TRUE;
-#ifdef WORDS_BIGENDIAN
-	encoding->is_bigendian = TRUE;
-#else
-	encoding->is_bigendian = FALSE;
-#endif
+	encoding->unitsize = unit_size;
+	encoding->is_signed = is_signed;
+	encoding->is_float = is_float;
+	encoding->is_bigendian = is_bigendian;
 	encoding->digits = 0;
 	encoding->is_digits_decimal = FALSE;
-	encoding->scale.p = 1;
-	encoding->scale.q = 1;
-	encoding->offset.p = 0;
-	encoding->offset.q = 1;
+	encoding->scale.p = scale.first;
+	encoding->scale.q = scale.second;
+	encoding->offset.p = offset.first;
+	encoding->offset.q = offset.second;
 
 	analog->spec = spec;
 
 	spec->spec_digits = 0;
 
 	analog->num_samples = num_samples;
-	analog->data = (float*)data_pointer;
+	analog->data = const_cast<void *>(data_pointer);
 	auto packet = g_new(struct sr_datafeed_packet, 1);
 	packet->type = SR_DF_ANALOG;
 	packet->payload = analog;
-	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
+	auto result = new Packet{nullptr, packet};
+	result->_release = move(release);
+	return shared_ptr<Packet>{result, default_delete<Packet>{}};
 }
 
 shared_ptr<Packet> Context::create_end_packet()
@@ -898,16 +954,47 @@ float TriggerMatch::value() const
 DatafeedCallbackData::DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback) :
 	_callback(move(callback)),
-	_session(session)
+	_session(session),
+	_cached_sdi(nullptr),
+	_cached_device(nullptr),
+	_cached_generation(0)
+{
+}
+
+DatafeedCallbackData::DatafeedCallbackData(Session *session,
+		DatafeedViewCallbackFunction callback) :
+	_view_callback(move(callback)),
+	_session(session),
+	_cached_sdi(nullptr),
+	_cached_device(nullptr),
+	_cached_generation(0)
 {
 }
 
 void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
+	if (_view_callback) {
+		// Packets of a device usually come in sequence, and each
+		// callback runs in one thread at a time. Keep the last lookup.
+		if (sdi != _cached_sdi ||
+				_cached_generation != _session->_devices_generation) {
+			_cached_device = _session->find_device(sdi);
+			_cached_sdi = sdi;
+			_cached_generation = _session->_devices_generation;
+		}
+		const PacketView view {_session, sdi, pkt};
+		_view_callback(*_cached_device, view);
+		return;
+	}
+
 	auto device = _session->get_device(sdi);
 	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
-	_callback(move(device), move(packet));
+	_callback(move(device), packet);
+	// The packet is only valid during the callback. Take a reference
+	// when the application holds on to it (or to its payload).
+	if (packet.use_count() > 1)
+		packet->retain();
 }
 
 SessionDevice::SessionDevice(struct sr_dev_inst *structure) :
@@ -926,7 +1013,11 @@ shared_ptr<Device> SessionDevice::get_shared_from_this()
 
 Session::Session(shared_ptr<Context> context) :
 	_structure(nullptr),
-	_context(move(context))
+	_context(move(context)),
+	_devices_generation(0),
+	_capture(nullptr),
+	_capture_registered(false),
+	_pull_registered(false)
 {
 	check(sr_session_new(_context->_structure, &_structure));
 	_context->_session = this;
@@ -935,6 +1026,10 @@ Session::Session(shared_ptr<Context> context) :
 Session::Session(shared_ptr<Context> context, string filename) :
 	_structure(nullptr),
 	_context(move(context)),
+	_devices_generation(0),
+	_capture(nullptr),
+	_capture_registered(false),
+	_pull_registered(false),
 	_filename(move(filename))
 {
 	check(sr_session_load(_context->_structure, _filename.c_str(), &_structure));
@@ -951,6 +1046,8 @@ Session::Session(shared_ptr<Context> context, string filename) :
 
 Session::~Session()
 {
+	if (_pull)
+		stop_pull();
 	check(sr_session_destroy(_structure));
 }
 
@@ -965,11 +1062,23 @@ shared_ptr<Device> Session::get_device(const struct sr_dev_inst *sdi)
 		throw Error(SR_ERR_BUG);
 }
 
+Device *Session::find_device(const struct sr_dev_inst *sdi)
+{
+	const auto owned = _owned_devices.find(sdi);
+	if (owned != _owned_devices.end())
+		return owned->second.get();
+	const auto other = _other_devices.find(sdi);
+	if (other != _other_devices.end())
+		return other->second.get();
+	throw Error(SR_ERR_BUG);
+}
+
 void Session::add_device(shared_ptr<Device> device)
 {
 	const auto dev_struct = device->_structure;
 	check(sr_session_dev_add(_structure, dev_struct));
 	_other_devices[dev_struct] = move(device);
+	_devices_generation++;
 }
 
 vector<shared_ptr<Device>> Session::devices()
@@ -988,6 +1097,7 @@ vector<shared_ptr<Device>> Session::devices()
 void Session::remove_devices()
 {
 	_other_devices.clear();
+	_devices_generation++;
 	check(sr_session_dev_remove_all(_structure));
 }
 
@@ -1006,6 +1116,12 @@ void Session::stop()
 	check(sr_session_stop(_structure));
 }
 
+void Session::set_dispatch_async(size_t queue_depth, bool drop_when_full)
+{
+	check(sr_session_dispatch_async_set(_structure, queue_depth,
+		drop_when_full ? SR_DISPATCH_DROP : SR_DISPATCH_BLOCK));
+}
+
 bool Session::is_running() const
 {
 	const int ret = sr_session_is_running(_structure);
@@ -1047,10 +1163,297 @@ void Session::add_datafeed_callback(DatafeedCallbackFunction callback)
 	_datafeed_callbacks.push_back(move(cb_data));
 }
 
+void Session::add_datafeed_view_callback(DatafeedViewCallbackFunction callback)
+{
+	unique_ptr<DatafeedCallbackData> cb_data
+		{new DatafeedCallbackData{this, move(callback)}};
+	check(sr_session_datafeed_callback_add(_structure,
+			&datafeed_callback, cb_data.get()));
+	_datafeed_callbacks.push_back(move(cb_data));
+}
+
 void Session::remove_datafeed_callbacks()
 {
 	check(sr_session_datafeed_callback_remove_all(_structure));
 	_datafeed_callbacks.clear();
+	_capture_registered = false;
+	_pull_registered = false;
+}
+
+void Session::capture_callback(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *pkt, void *cb_data) noexcept
+{
+	(void)sdi;
+	auto session = static_cast<Session *>(cb_data);
+	if (!session->_capture)
+		return;
+	try {
+		session->_capture->add(pkt);
+	} catch (const std::exception &) {
+		// Out of memory. Stop collecting, keep what was collected.
+		sr_session_stop(session->_structure);
+	}
+}
+
+shared_ptr<CaptureData> Session::capture(uint64_t expected_samples)
+{
+	shared_ptr<CaptureData> data {new CaptureData{expected_samples},
+		default_delete<CaptureData>{}};
+
+	// The callback stays registered, it ignores packets between captures.
+	if (!_capture_registered) {
+		check(sr_session_datafeed_callback_add(_structure,
+				&capture_callback, this));
+		_capture_registered = true;
+	}
+
+	_capture = data.get();
+	try {
+		start();
+		run();
+	} catch (...) {
+		_capture = nullptr;
+		throw;
+	}
+	_capture = nullptr;
+
+	return data;
+}
+
+void Session::pull_callback(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *pkt, void *cb_data) noexcept
+{
+	auto session = static_cast<Session *>(cb_data);
+	auto queue = session->_pull.get();
+	if (!queue)
+		return;
+
+	try {
+		auto device = session->get_device(sdi);
+		shared_ptr<Packet> packet {new Packet{device, pkt},
+			default_delete<Packet>{}};
+		// The packet outlives the callback.
+		packet->retain();
+
+		std::unique_lock<std::mutex> lock(queue->mutex);
+		queue->not_full.wait(lock, [queue] {
+			return queue->packets.size() < queue->capacity ||
+				queue->discard;
+		});
+		if (queue->discard)
+			return;
+		queue->packets.emplace_back(move(device), move(packet));
+		queue->not_empty.notify_one();
+	} catch (const std::exception &) {
+		sr_session_stop(session->_structure);
+	}
+}
+
+void Session::start_pull(size_t capacity)
+{
+	if (!capacity)
+		throw Error(SR_ERR_ARG);
+	if (_pull) {
+		// Clean up after a previous pull which ran to completion.
+		std::unique_lock<std::mutex> lock(_pull->mutex);
+		if (!_pull->finished)
+			throw Error(SR_ERR);
+		lock.unlock();
+		stop_pull();
+	}
+
+	// The callback stays registered, it ignores packets between pulls.
+	if (!_pull_registered) {
+		check(sr_session_datafeed_callback_add(_structure,
+				&pull_callback, this));
+		_pull_registered = true;
+	}
+	_pull.reset(new PullQueue{capacity});
+
+	// The session runs in the thread which started it.
+	std::promise<int> started;
+	auto result = started.get_future();
+	_pull->thread = std::thread([this, &started] {
+		int ret = sr_session_start(_structure);
+		started.set_value(ret);
+		if (ret == SR_OK)
+			sr_session_run(_structure);
+		std::lock_guard<std::mutex> lock(_pull->mutex);
+		_pull->finished = true;
+		_pull->not_empty.notify_all();
+	});
+
+	const int ret = result.get();
+	if (ret != SR_OK) {
+		_pull->thread.join();
+		_pull->packets.clear();
+		_pull.reset();
+		check(ret);
+	}
+}
+
+shared_ptr<Packet> Session::next_packet(int timeout_ms,
+	shared_ptr<Device> *device)
+{
+	if (!_pull)
+		throw Error(SR_ERR);
+
+	std::unique_lock<std::mutex> lock(_pull->mutex);
+	const auto ready = [this] {
+		return !_pull->packets.empty() || _pull->finished;
+	};
+	if (timeout_ms < 0)
+		_pull->not_empty.wait(lock, ready);
+	else if (!_pull->not_empty.wait_for(lock,
+			std::chrono::milliseconds(timeout_ms), ready))
+		return nullptr;
+	if (_pull->packets.empty())
+		return nullptr;
+
+	auto entry = move(_pull->packets.front());
+	_pull->packets.pop_front();
+	_pull->not_full.notify_one();
+	lock.unlock();
+
+	if (device)
+		*device = move(entry.first);
+	return move(entry.second);
+}
+
+void Session::stop_pull()
+{
+	if (!_pull)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_pull->mutex);
+		_pull->discard = true;
+		_pull->packets.clear();
+		_pull->not_full.notify_all();
+	}
+	sr_session_stop(_structure);
+	if (_pull->thread.joinable())
+		_pull->thread.join();
+	_pull.reset();
+}
+
+bool Session::pull_pending() const
+{
+	if (!_pull)
+		return false;
+
+	std::lock_guard<std::mutex> lock(_pull->mutex);
+	return !_pull->finished || !_pull->packets.empty();
+}
+
+CaptureData::CaptureData(uint64_t expected_samples) :
+	_expected_samples(expected_samples),
+	_logic_unit_size(0)
+{
+}
+
+CaptureData::~CaptureData()
+{
+}
+
+void CaptureData::add(const struct sr_datafeed_packet *pkt)
+{
+	if (pkt->type == SR_DF_LOGIC) {
+		auto logic = static_cast<const struct sr_datafeed_logic *>(
+			pkt->payload);
+		if (!logic->length || !logic->unitsize)
+			return;
+		if (!_logic_unit_size) {
+			_logic_unit_size = logic->unitsize;
+			_logic.reserve(_expected_samples * _logic_unit_size);
+		} else if (logic->unitsize != _logic_unit_size) {
+			// Mixed unit sizes cannot be stored contiguously.
+			return;
+		}
+		auto data = static_cast<const uint8_t *>(logic->data);
+		_logic.insert(_logic.end(), data, data + logic->length);
+		return;
+	}
+
+	if (pkt->type != SR_DF_ANALOG)
+		return;
+	auto analog = static_cast<const struct sr_datafeed_analog *>(
+		pkt->payload);
+	if (!analog->meaning || !analog->num_samples)
+		return;
+	const auto num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels)
+		return;
+	const size_t num_samples = analog->num_samples;
+
+	vector<float> *dest;
+	if (num_channels == 1) {
+		// Convert straight into the channel's buffer.
+		auto ch = static_cast<struct sr_channel *>(
+			analog->meaning->channels->data);
+		dest = &_analog[ch->name];
+		if (dest->empty())
+			dest->reserve(_expected_samples);
+		const auto fill = dest->size();
+		dest->resize(fill + num_samples);
+		check(sr_analog_to_float_range(analog, 0, num_samples,
+			dest->data() + fill, 1));
+		return;
+	}
+
+	// Values of several channels are interleaved, split them up.
+	_scratch.resize(num_samples * num_channels);
+	check(sr_analog_to_float(analog, _scratch.data()));
+	size_t idx = 0;
+	for (GSList *l = analog->meaning->channels; l; l = l->next, idx++) {
+		auto ch = static_cast<struct sr_channel *>(l->data);
+		dest = &_analog[ch->name];
+		if (dest->empty())
+			dest->reserve(_expected_samples);
+		const auto fill = dest->size();
+		dest->resize(fill + num_samples);
+		for (size_t i = 0; i < num_samples; i++)
+			(*dest)[fill + i] = _scratch[i * num_channels + idx];
+	}
+}
+
+const uint8_t *CaptureData::logic_data() const
+{
+	return _logic.data();
+}
+
+size_t CaptureData::logic_length() const
+{
+	return _logic.size();
+}
+
+unsigned int CaptureData::logic_unit_size() const
+{
+	return _logic_unit_size;
+}
+
+vector<string> CaptureData::analog_channels() const
+{
+	vector<string> result;
+	for (const auto &entry : _analog)
+		result.push_back(entry.first);
+	return result;
+}
+
+const float *CaptureData::analog_data(const string &channel) const
+{
+	const auto entry = _analog.find(channel);
+	if (entry == _analog.end())
+		throw Error(SR_ERR_ARG);
+	return entry->second.data();
+}
+
+size_t CaptureData::analog_count(const string &channel) const
+{
+	const auto entry = _analog.find(channel);
+	if (entry == _analog.end())
+		throw Error(SR_ERR_ARG);
+	return entry->second.size();
 }
 
 shared_ptr<Trigger> Session::trigger()
@@ -1081,6 +1484,7 @@ shared_ptr<Context> Session::context()
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
 	_structure(structure),
+	_reference(nullptr),
 	_device(move(device))
 {
 	switch (structure->type)
@@ -1110,6 +1514,50 @@ Packet::Packet(shared_ptr<Device> device,
 
 Packet::~Packet()
 {
+	if (_reference)
+		sr_packet_unref(_reference);
+	if (_release)
+		_release();
+}
+
+void Packet::retain()
+{
+	struct sr_datafeed_packet *reference;
+
+	if (_reference)
+		return;
+
+	// Buffer backed packets are shared, others get copied once.
+	check(sr_packet_ref(_structure, &reference));
+	_reference = reference;
+	_structure = reference;
+
+	if (!_payload)
+		return;
+
+	switch (reference->type)
+	{
+		case SR_DF_HEADER:
+			static_cast<Header *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_header *>(
+					reference->payload);
+			break;
+		case SR_DF_META:
+			static_cast<Meta *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_meta *>(
+					reference->payload);
+			break;
+		case SR_DF_LOGIC:
+			static_cast<Logic *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_logic *>(
+					reference->payload);
+			break;
+		case SR_DF_ANALOG:
+			static_cast<Analog *>(_payload.get())->_structure =
+				static_cast<const struct sr_datafeed_analog *>(
+					reference->payload);
+			break;
+	}
 }
 
 const PacketType *Packet::type() const
@@ -1117,6 +1565,56 @@ const PacketType *Packet::type() const
 	return PacketType::get(_structure->type);
 }
 
+PacketView::PacketView(Session *session, const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *structure) :
+	_session(session),
+	_sdi(sdi),
+	_structure(structure)
+{
+}
+
+const PacketType *PacketView::type() const
+{
+	return PacketType::get(_structure->type);
+}
+
+const struct sr_datafeed_packet *PacketView::c_struct() const
+{
+	return _structure;
+}
+
+const void *PacketView::logic_data() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return nullptr;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->data;
+}
+
+size_t PacketView::logic_length() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return 0;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->length;
+}
+
+unsigned int PacketView::logic_unit_size() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return 0;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->unitsize;
+}
+
+shared_ptr<Packet> PacketView::retain() const
+{
+	shared_ptr<Packet> packet {new Packet{_session->get_device(_sdi),
+		_structure}, default_delete<Packet>{}};
+	packet->retain();
+	return packet;
+}
+
 shared_ptr<PacketPayload> Packet::payload()
 {
 	if (_payload)
@@ -1217,9 +1715,17 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+void Logic::retain()
+{
+	if (!_parent)
+		throw Error(SR_ERR_BUG);
+	_parent->retain();
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
-	_structure(structure)
+	_structure(structure),
+	_channels_cached(false)
 {
 }
 
@@ -1238,6 +1744,13 @@ void *Analog::data_pointer()
 	return _structure->data;
 }
 
+void Analog::retain()
+{
+	if (!_parent)
+		throw Error(SR_ERR_BUG);
+	_parent->retain();
+}
+
 void Analog::get_data_as_float(float *dest)
 {
 	check(sr_analog_to_float(_structure, dest));
@@ -1250,12 +1763,19 @@ unsigned int Analog::num_samples() const
 
 vector<shared_ptr<Channel>> Analog::channels()
 {
-	vector<shared_ptr<Channel>> result;
-	for (auto l = _structure->meaning->channels; l; l = l->next) {
-		auto *const ch = static_cast<struct sr_channel *>(l->data);
-		result.push_back(_parent->_device->get_channel(ch));
+	return channel_list();
+}
+
+const vector<shared_ptr<Channel>> &Analog::channel_list()
+{
+	if (!_channels_cached) {
+		for (auto l = _structure->meaning->channels; l; l = l->next) {
+			auto *const ch = static_cast<struct sr_channel *>(l->data);
+			_channels.push_back(_parent->_device->get_channel(ch));
+		}
+		_channels_cached = true;
 	}
-	return result;
+	return _channels;
 }
 
 unsigned int Analog::unitsize() const
@@ -1471,9 +1991,25 @@ shared_ptr<InputDevice> Input::device()
 
 void Input::send(void *data, size_t length)
 {
-	auto gstr = g_string_new_len(static_cast<char *>(data), length);
-	auto ret = sr_input_send(_structure, gstr);
-	g_string_free(gstr, true);
+	check(sr_input_send_data(_structure, data, length));
+}
+
+static void input_buffer_release(void *data, void *cb_data)
+{
+	(void)data;
+
+	auto release = static_cast<ReleaseCallback *>(cb_data);
+	if (*release)
+		(*release)();
+	delete release;
+}
+
+void Input::send_buffer(void *data, size_t length, ReleaseCallback release)
+{
+	auto cb_data = new ReleaseCallback{move(release)};
+	auto buf = sr_buffer_new(data, length, input_buffer_release, cb_data);
+	auto ret = sr_input_send_buffer(_structure, buf);
+	sr_buffer_unref(buf);
 	check(ret);
 }
 
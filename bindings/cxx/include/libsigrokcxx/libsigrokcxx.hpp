@@ -84,6 +84,9 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 #include <vector>
 #include <map>
 #include <set>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
 
 namespace sigrok
 {
@@ -109,6 +112,9 @@ class SR_API TriggerMatch;
 class SR_API TriggerMatchType;
 class SR_API ChannelType;
 class SR_API Packet;
+class SR_API CaptureData;
+class SR_PRIV PullQueue;
+class SR_API PacketView;
 class SR_API PacketPayload;
 class SR_API PacketType;
 class SR_API Quantity;
@@ -214,6 +220,9 @@ protected:
 /** Type of log callback */
 typedef std::function<void(const LogLevel *, std::string message)> LogCallbackFunction;
 
+/** Type of callback which releases borrowed sample data */
+typedef std::function<void()> ReleaseCallback;
+
 /** Resource reader delegate. */
 class SR_API ResourceReader
 {
@@ -281,11 +290,43 @@ public:
 	/** Create a logic packet. */
 	std::shared_ptr<Packet> create_logic_packet(
 		void *data_pointer, size_t data_length, unsigned int unit_size);
+	/** Create a logic packet which borrows its sample data.
+	 * @param data_pointer Sample data, not copied.
+	 * @param data_length Length of the sample data in bytes.
+	 * @param unit_size Size of a sample in bytes.
+	 * @param release Called when the packet gets destroyed, after which
+	 *                the sample data is no longer accessed. */
+	std::shared_ptr<Packet> create_logic_packet(
+		void *data_pointer, size_t data_length, unsigned int unit_size,
+		ReleaseCallback release);
 	/** Create an analog packet. */
 	std::shared_ptr<Packet> create_analog_packet(
 		std::vector<std::shared_ptr<Channel> > channels,
 		const float *data_pointer, unsigned int num_samples, const Quantity *mq,
 		const Unit *unit, std::vector<const QuantityFlag *> mqflags);
+	/** Create an analog packet from samples in their native encoding.
+	 * The sample data is borrowed, not copied or converted.
+	 * @param channels Channels the samples belong to.
+	 * @param data_pointer Sample data.
+	 * @param num_samples Number of samples per channel.
+	 * @param unit_size Size of a sample in bytes.
+	 * @param is_signed Whether samples are signed.
+	 * @param is_float Whether samples are floating point.
+	 * @param is_bigendian Whether samples are big endian.
+	 * @param scale Scale factor (numerator, denominator) to apply.
+	 * @param offset Offset (numerator, denominator) to apply after scaling.
+	 * @param mq Measured quantity.
+	 * @param unit Unit of the measurement.
+	 * @param mqflags Measured quantity flags.
+	 * @param release Called when the packet gets destroyed, can be empty. */
+	std::shared_ptr<Packet> create_analog_packet(
+		std::vector<std::shared_ptr<Channel> > channels,
+		const void *data_pointer, unsigned int num_samples,
+		unsigned int unit_size, bool is_signed, bool is_float,
+		bool is_bigendian, std::pair<int64_t, uint64_t> scale,
+		std::pair<int64_t, uint64_t> offset, const Quantity *mq,
+		const Unit *unit, std::vector<const QuantityFlag *> mqflags,
+		ReleaseCallback release = ReleaseCallback());
 	/** Create an end packet. */
 	std::shared_ptr<Packet> create_end_packet();
 	/** Load a saved session.
@@ -578,6 +619,40 @@ typedef std::function<void()> SessionStoppedCallback;
 typedef std::function<void(std::shared_ptr<Device>, std::shared_ptr<Packet>)>
 	DatafeedCallbackFunction;
 
+/** Non-owning view of a datafeed packet
+ *
+ * Only valid during the datafeed callback which receives it. Nothing
+ * gets allocated to deliver it. Use retain() to keep the packet beyond
+ * the callback. */
+class SR_API PacketView
+{
+public:
+	/** Type of this packet. */
+	const PacketType *type() const;
+	/** Underlying C packet, valid during the callback. */
+	const struct sr_datafeed_packet *c_struct() const;
+	/** Pointer to logic data, nullptr for other packet types. */
+	const void *logic_data() const;
+	/** Logic data length in bytes, 0 for other packet types. */
+	size_t logic_length() const;
+	/** Size of each logic sample in bytes, 0 for other packet types. */
+	unsigned int logic_unit_size() const;
+	/** Keep this packet beyond the callback. */
+	std::shared_ptr<Packet> retain() const;
+private:
+	PacketView(Session *session, const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *structure);
+	Session *_session;
+	const struct sr_dev_inst *_sdi;
+	const struct sr_datafeed_packet *_structure;
+
+	friend class DatafeedCallbackData;
+};
+
+/** Type of lightweight datafeed callback */
+typedef std::function<void(Device &, const PacketView &)>
+	DatafeedViewCallbackFunction;
+
 /* Data required for C callback function to call a C++ datafeed callback */
 class SR_PRIV DatafeedCallbackData
 {
@@ -586,9 +661,16 @@ public:
 		const struct sr_datafeed_packet *pkt);
 private:
 	DatafeedCallbackFunction _callback;
+	DatafeedViewCallbackFunction _view_callback;
 	DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback);
+	DatafeedCallbackData(Session *session,
+		DatafeedViewCallbackFunction callback);
 	Session *_session;
+	/* Device of the most recent packet, see Session::find_device(). */
+	const struct sr_dev_inst *_cached_sdi;
+	Device *_cached_device;
+	unsigned int _cached_generation;
 	friend class Session;
 };
 
@@ -606,6 +688,36 @@ private:
 	friend struct std::default_delete<SessionDevice>;
 };
 
+/** Sample data which a capture collected, see Session::capture() */
+class SR_API CaptureData : public UserOwned<CaptureData>
+{
+public:
+	/** Logic samples, logic_unit_size() bytes each, contiguous. */
+	const uint8_t *logic_data() const;
+	/** Length of the logic data in bytes. */
+	size_t logic_length() const;
+	/** Size of each logic sample in bytes, 0 without logic data. */
+	unsigned int logic_unit_size() const;
+	/** Names of the analog channels which data was collected for. */
+	std::vector<std::string> analog_channels() const;
+	/** Analog values of a channel, scaled to float, contiguous. */
+	const float *analog_data(const std::string &channel) const;
+	/** Number of analog values of a channel. */
+	size_t analog_count(const std::string &channel) const;
+private:
+	explicit CaptureData(uint64_t expected_samples);
+	~CaptureData();
+	void add(const struct sr_datafeed_packet *pkt);
+	uint64_t _expected_samples;
+	std::vector<uint8_t> _logic;
+	unsigned int _logic_unit_size;
+	std::map<std::string, std::vector<float> > _analog;
+	std::vector<float> _scratch;
+
+	friend class Session;
+	friend struct std::default_delete<CaptureData>;
+};
+
 /** A sigrok session */
 class SR_API Session : public UserOwned<Session>
 {
@@ -620,6 +732,11 @@ public:
 	/** Add a datafeed callback to this session.
 	 * @param callback Callback of the form callback(Device, Packet). */
 	void add_datafeed_callback(DatafeedCallbackFunction callback);
+	/** Add a lightweight datafeed callback to this session.
+	 * The callback receives packets without allocations or reference
+	 * counting, see PacketView.
+	 * @param callback Callback of the form callback(Device &, PacketView &). */
+	void add_datafeed_view_callback(DatafeedViewCallbackFunction callback);
 	/** Remove all datafeed callbacks from this session. */
 	void remove_datafeed_callbacks();
 	/** Start the session. */
@@ -630,8 +747,40 @@ public:
 	void stop();
 	/** Return whether the session is running. */
 	bool is_running() const;
+	/** Start the session, run it, and collect all sample data into
+	 * contiguous buffers. Logic data gets appended as is, analog
+	 * data per channel, converted to float.
+	 * @param expected_samples Number of samples per channel to
+	 *                         allocate buffers for upfront, 0 if
+	 *                         unknown. Buffers grow as needed. */
+	std::shared_ptr<CaptureData> capture(uint64_t expected_samples = 0);
+	/** Start the session in a thread of its own, and queue its packets
+	 * for next_packet(). When the queue is full, the datafeed waits for
+	 * packets to get pulled. Use set_dispatch_async() to keep devices
+	 * running meanwhile.
+	 * @param capacity Maximum number of queued packets. */
+	void start_pull(size_t capacity = 64);
+	/** Get the next packet of a session started by start_pull().
+	 * @param timeout_ms Maximum time to wait in milliseconds, negative
+	 *                   to wait without limit.
+	 * @param device Receives the packet's device. Can be nullptr.
+	 * @return The packet, or nullptr upon timeout, or after the session
+	 *         stopped and all packets were pulled. */
+	std::shared_ptr<Packet> next_packet(int timeout_ms = -1,
+		std::shared_ptr<Device> *device = nullptr);
+	/** Stop a session started by start_pull(), discard queued packets. */
+	void stop_pull();
+	/** Return whether a pulled session still has packets to deliver. */
+	bool pull_pending() const;
 	/** Set callback to be invoked on session stop. */
 	void set_stopped_callback(SessionStoppedCallback callback);
+	/** Run datafeed callbacks in a thread of their own, decoupled from
+	 * device event handling by a bounded queue.
+	 * @param queue_depth Maximum number of queued packets, 0 to run
+	 *                    callbacks in the event loop (the default).
+	 * @param drop_when_full Drop sample data when the queue is full,
+	 *                       instead of blocking the device. */
+	void set_dispatch_async(size_t queue_depth, bool drop_when_full = false);
 	/** Get current trigger setting. */
 	std::shared_ptr<Trigger> trigger();
 	/** Get the context. */
@@ -646,10 +795,24 @@ private:
 	Session(std::shared_ptr<Context> context, std::string filename);
 	~Session();
 	std::shared_ptr<Device> get_device(const struct sr_dev_inst *sdi);
+	Device *find_device(const struct sr_dev_inst *sdi);
+	static void capture_callback(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *pkt, void *cb_data) noexcept;
+	static void pull_callback(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *pkt, void *cb_data) noexcept;
 	struct sr_session *_structure;
 	const std::shared_ptr<Context> _context;
 	std::map<const struct sr_dev_inst *, std::unique_ptr<SessionDevice> > _owned_devices;
 	std::map<const struct sr_dev_inst *, std::shared_ptr<Device> > _other_devices;
+	/* Changes when devices get added or removed. */
+	unsigned int _devices_generation;
+	/* Data of the running capture(), and whether its callback is set. */
+	CaptureData *_capture;
+	bool _capture_registered;
+	/* Packet queue and thread of start_pull(), and whether its
+	 * callback is set. */
+	std::unique_ptr<PullQueue> _pull;
+	bool _pull_registered;
 	std::vector<std::unique_ptr<DatafeedCallbackData> > _datafeed_callbacks;
 	SessionStoppedCallback _stopped_callback;
 	std::string _filename;
@@ -657,6 +820,7 @@ private:
 
 	friend class Context;
 	friend class DatafeedCallbackData;
+	friend class PacketView;
 	friend class SessionDevice;
 	friend struct std::default_delete<Session>;
 };
@@ -673,13 +837,17 @@ private:
 	Packet(std::shared_ptr<Device> device,
 		const struct sr_datafeed_packet *structure);
 	~Packet();
+	void retain();
 	const struct sr_datafeed_packet *_structure;
+	struct sr_datafeed_packet *_reference;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
+	ReleaseCallback _release;
 
 	friend class Session;
 	friend class Output;
 	friend class DatafeedCallbackData;
+	friend class PacketView;
 	friend class Header;
 	friend class Meta;
 	friend class Logic;
@@ -741,6 +909,60 @@ private:
 	friend class Packet;
 };
 
+/** Non-owning view of samples of one type, possibly interleaved with
+ * samples of other channels. Valid as long as the packet it refers to. */
+template <class T>
+class SampleSpan
+{
+public:
+	/** Iterator over the samples of a span */
+	class iterator
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T *pointer;
+		typedef T &reference;
+
+		iterator(T *ptr, size_t stride) : _ptr(ptr), _stride(stride) {}
+		T &operator*() const { return *_ptr; }
+		T &operator[](difference_type n) const { return _ptr[n * (difference_type)_stride]; }
+		iterator &operator++() { _ptr += _stride; return *this; }
+		iterator operator++(int) { iterator it = *this; _ptr += _stride; return it; }
+		iterator &operator--() { _ptr -= _stride; return *this; }
+		iterator operator--(int) { iterator it = *this; _ptr -= _stride; return it; }
+		iterator &operator+=(difference_type n) { _ptr += n * (difference_type)_stride; return *this; }
+		iterator &operator-=(difference_type n) { _ptr -= n * (difference_type)_stride; return *this; }
+		iterator operator+(difference_type n) const { iterator it = *this; return it += n; }
+		iterator operator-(difference_type n) const { iterator it = *this; return it -= n; }
+		difference_type operator-(const iterator &other) const { return (_ptr - other._ptr) / (difference_type)_stride; }
+		bool operator==(const iterator &other) const { return _ptr == other._ptr; }
+		bool operator!=(const iterator &other) const { return _ptr != other._ptr; }
+		bool operator<(const iterator &other) const { return _ptr < other._ptr; }
+	private:
+		T *_ptr;
+		size_t _stride;
+	};
+
+	SampleSpan(T *data, size_t size, size_t stride) :
+		_data(data), _size(size), _stride(stride ? stride : 1) {}
+	/** Number of samples. */
+	size_t size() const { return _size; }
+	/** Whether the span holds no samples. */
+	bool empty() const { return !_size; }
+	/** Distance of consecutive samples, in elements of T. */
+	size_t stride() const { return _stride; }
+	/** Sample at an index, not range checked. */
+	T &operator[](size_t index) const { return _data[index * _stride]; }
+	iterator begin() const { return iterator(_data, _stride); }
+	iterator end() const { return iterator(_data + _size * _stride, _stride); }
+private:
+	T *_data;
+	size_t _size;
+	size_t _stride;
+};
+
 /** Payload of a datafeed packet with logic data */
 class SR_API Logic :
 	public ParentOwned<Logic, Packet>,
@@ -753,6 +975,20 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** Samples as words of type T, which must match unit_size(). */
+	template <class T>
+	SampleSpan<const T> samples() const
+	{
+		static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value,
+			"Logic samples are unsigned integers.");
+		if (_structure->unitsize != sizeof(T))
+			throw Error(SR_ERR_ARG);
+		return SampleSpan<const T>(static_cast<const T *>(_structure->data),
+			_structure->length / sizeof(T), 1);
+	}
+	/** Keep the data valid beyond the datafeed callback. Pointers
+	 * obtained before do not follow when the packet gets copied. */
+	void retain();
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -773,6 +1009,9 @@ class SR_API Analog :
 public:
 	/** Pointer to data. */
 	void *data_pointer();
+	/** Keep the data valid beyond the datafeed callback. Pointers
+	 * obtained before do not follow when the packet gets copied. */
+	void retain();
 	/**
 	 * Fills dest pointer with the analog data converted to float.
 	 * The pointer must have space for num_samples() floats.
@@ -782,6 +1021,32 @@ public:
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
 	std::vector<std::shared_ptr<Channel> > channels();
+	/** Channels for which this packet contains data, without a copy.
+	 * Valid as long as this payload object. */
+	const std::vector<std::shared_ptr<Channel> > &channel_list();
+	/**
+	 * Raw values of one channel, in the packet's encoding. T must match
+	 * the encoding's size, signedness, and float flag, and the encoding
+	 * must use the host's byte order. Values are not scaled, see
+	 * get_data_as_float() for that.
+	 * @param index Index of the channel within channel_list().
+	 */
+	template <class T>
+	SampleSpan<const T> channel_samples(size_t index) const
+	{
+		const struct sr_analog_encoding *enc = _structure->encoding;
+		const size_t count = g_slist_length(_structure->meaning->channels);
+		const bool host_big = G_BYTE_ORDER == G_BIG_ENDIAN;
+		if (enc->unitsize != sizeof(T) || index >= count ||
+				(bool)enc->is_float != std::is_floating_point<T>::value ||
+				(!enc->is_float &&
+				 (bool)enc->is_signed != std::is_signed<T>::value) ||
+				(sizeof(T) > 1 && (bool)enc->is_bigendian != host_big))
+			throw Error(SR_ERR_ARG);
+		return SampleSpan<const T>(
+			static_cast<const T *>(_structure->data) + index,
+			_structure->num_samples, count);
+	}
 	/** Size of a single sample in bytes. */
 	unsigned int unitsize() const;
 	/** Samples use a signed data type. */
@@ -855,6 +1120,8 @@ private:
 	std::shared_ptr<PacketPayload> share_owned_by(std::shared_ptr<Packet> parent);
 
 	const struct sr_datafeed_analog *_structure;
+	std::vector<std::shared_ptr<Channel> > _channels;
+	bool _channels_cached;
 
 	friend class Packet;
 };
@@ -920,6 +1187,14 @@ public:
 	 * @param data Next stream data.
 	 * @param length Length of data. */
 	void send(void *data, size_t length);
+	/** Send next stream data without copying it.
+	 * Input formats which forward samples straight from the given data
+	 * keep referencing it in the packets they send. It must stay valid
+	 * until the release callback got called.
+	 * @param data Next stream data.
+	 * @param length Length of data.
+	 * @param release Called when the data is no longer accessed. */
+	void send_buffer(void *data, size_t length, ReleaseCallback release);
 	/** Signal end of input data. */
 	void end();
 	void reset();
@@ -91,6 +91,10 @@ typedef guint pyg_flags_type;
 #endif
     }
     import_array();
+#if PY_VERSION_HEX < 0x03070000
+    /* Callbacks may run in threads which libsigrok creates. */
+    PyEval_InitThreads();
+#endif
 %}
 
 %include "../../../swig/templates.i"
@@ -462,6 +466,26 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
 }
 %enddef
 
+/*
+ * Release the GIL while the session's event loop runs. Python threads
+ * keep running meanwhile, Python callbacks take the GIL when invoked.
+ */
+%exception sigrok::Session::run {
+    int error = SR_OK;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        $action
+    } catch (sigrok::Error &e) {
+        error = e.result;
+    }
+    Py_END_ALLOW_THREADS
+    if (error != SR_OK) {
+        sigrok::Error e(error);
+        SWIG_exception(swig_exception_code(e.result),
+            const_cast<char*>(e.what()));
+    }
+}
+
 %include "../../../swig/classes.i"
 
 /* Support Driver.scan() with keyword arguments. */
@@ -543,53 +567,156 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     }
 }
 
+%{
+/*
+ * Wrap payload data in a NumPy array without copying. The array keeps
+ * the payload's Python object alive, which in turn keeps the retained
+ * packet alive, so the array stays valid after the datafeed callback.
+ */
+static PyObject *payload_array(PyObject *owner, int nd, npy_intp *dims,
+	PyArray_Descr *descr, void *data)
+{
+	PyObject *array;
+
+	array = PyArray_NewFromDescr(&PyArray_Type, descr, nd, dims,
+		NULL, data, NPY_ARRAY_CARRAY_RO, NULL);
+	if (!array)
+		return NULL;
+	Py_INCREF(owner);
+	if (PyArray_SetBaseObject((PyArrayObject *)array, owner) < 0) {
+		Py_DECREF(array);
+		return NULL;
+	}
+
+	return array;
+}
+%}
+
 /* Return NumPy array from Analog::data(). */
 %extend sigrok::Analog
 {
-    PyObject * _data()
+    PyObject * _data(PyObject *owner)
     {
-        int nd = 2;
         npy_intp dims[2];
+        int typenum;
+        char byteorder;
+        PyArray_Descr *base, *descr;
+
+        switch ($self->unitsize()) {
+        case 1:
+            typenum = $self->is_signed() ? NPY_INT8 : NPY_UINT8;
+            break;
+        case 2:
+            typenum = $self->is_signed() ? NPY_INT16 : NPY_UINT16;
+            break;
+        case 4:
+            typenum = $self->is_float() ? NPY_FLOAT32 :
+                $self->is_signed() ? NPY_INT32 : NPY_UINT32;
+            break;
+        case 8:
+            typenum = $self->is_float() ? NPY_FLOAT64 :
+                $self->is_signed() ? NPY_INT64 : NPY_UINT64;
+            break;
+        default:
+            PyErr_SetString(PyExc_ValueError, "Unsupported analog encoding.");
+            return NULL;
+        }
+        byteorder = $self->is_bigendian() ? NPY_BIG : NPY_LITTLE;
+        base = PyArray_DescrFromType(typenum);
+        descr = PyArray_DescrNewByteorder(base, byteorder);
+        Py_DECREF(base);
+        if (!descr)
+            return NULL;
+
+        $self->retain();
         dims[0] = $self->channels().size();
         dims[1] = $self->num_samples();
-        int typenum = NPY_FLOAT;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+        return payload_array(owner, 2, dims, descr, $self->data_pointer());
+    }
+
+    PyObject * _data_float()
+    {
+        npy_intp dims[2];
+        PyObject *array;
+
+        dims[0] = $self->channels().size();
+        dims[1] = $self->num_samples();
+        array = PyArray_SimpleNew(2, dims, NPY_FLOAT32);
+        if (!array)
+            return NULL;
+        $self->get_data_as_float(
+            (float *)PyArray_DATA((PyArrayObject *)array));
+        return array;
     }
 
 %pythoncode
 {
-    data = property(_data)
+    data = property(lambda self: self._data(self),
+        doc="Raw sample data, in the packet's encoding. Not copied.")
+    data_float = property(_data_float,
+        doc="Sample data scaled to float. Converted upon access.")
 }
 }
 
 /* Return NumPy array from Logic::data(). */
 %extend sigrok::Logic
 {
-    PyObject * _data()
+    PyObject * _data(PyObject *owner)
     {
         npy_intp dims[2];
+
+        $self->retain();
         dims[0] = $self->data_length() / $self->unit_size();
         dims[1] = $self->unit_size();
-        int typenum = NPY_UINT8;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        return payload_array(owner, 2, dims,
+            PyArray_DescrFromType(NPY_UINT8), $self->data_pointer());
     }
 
 %pythoncode
 {
-    data = property(_data)
+    data = property(lambda self: self._data(self))
 }
 }
 
-/* Create logic packet from Python buffer. */
+%{
+/* Hold a Python buffer until the C++ side releases the data. */
+static sigrok::ReleaseCallback buffer_release(Py_buffer *view)
+{
+    return [view]() {
+        auto gstate = PyGILState_Ensure();
+        PyBuffer_Release(view);
+        PyGILState_Release(gstate);
+        delete view;
+    };
+}
+%}
+
+/* Create logic packet from Python buffer, without copying it. */
 %extend sigrok::Context
 {
     std::shared_ptr<Packet> _create_logic_packet_buf(PyObject *buf, unsigned int unit_size)
     {
-        Py_buffer view;
-        PyObject_GetBuffer(buf, &view, PyBUF_SIMPLE);
-        return $self->create_logic_packet(view.buf, view.len, unit_size);
+        auto view = new Py_buffer;
+        if (PyObject_GetBuffer(buf, view, PyBUF_SIMPLE) < 0) {
+            delete view;
+            throw sigrok::Error(SR_ERR_ARG);
+        }
+        return $self->create_logic_packet(view->buf, view->len, unit_size,
+            buffer_release(view));
+    }
+}
+
+/* Send Python buffer to an input, without copying it. */
+%extend sigrok::Input
+{
+    void send_buffer(PyObject *buf)
+    {
+        auto view = new Py_buffer;
+        if (PyObject_GetBuffer(buf, view, PyBUF_SIMPLE) < 0) {
+            delete view;
+            throw sigrok::Error(SR_ERR_ARG);
+        }
+        $self->send_buffer(view->buf, view->len, buffer_release(view));
     }
 }
 
@@ -601,4 +728,93 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     Context.create_logic_packet = _Context_create_logic_packet
 }
 
+%{
+static void capture_data_release(PyObject *capsule)
+{
+    delete static_cast<std::shared_ptr<sigrok::CaptureData> *>(
+        PyCapsule_GetPointer(capsule, "sigrok.CaptureData"));
+}
+%}
+
+/* Collect a capture into NumPy arrays, see Session::capture(). */
+%extend sigrok::Session
+{
+    PyObject * _capture_to_arrays(uint64_t expected_samples)
+    {
+        std::shared_ptr<sigrok::CaptureData> data;
+        int error = SR_OK;
+
+        /* Datafeed callbacks in Python take the GIL themselves. */
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            data = $self->capture(expected_samples);
+        } catch (const sigrok::Error &e) {
+            error = e.result;
+        }
+        Py_END_ALLOW_THREADS
+        if (error != SR_OK) {
+            PyErr_SetString(PyExc_RuntimeError, sr_strerror(error));
+            return NULL;
+        }
+
+        /* The arrays share the collected buffers, no data gets copied. */
+        auto owner = PyCapsule_New(new std::shared_ptr<sigrok::CaptureData>(data),
+            "sigrok.CaptureData", capture_data_release);
+        if (!owner)
+            return NULL;
+
+        auto result = PyDict_New();
+        auto analog = PyDict_New();
+        PyDict_SetItemString(result, "analog", analog);
+        Py_DECREF(analog);
+
+        if (data->logic_unit_size()) {
+            npy_intp dims[2];
+            dims[0] = data->logic_length() / data->logic_unit_size();
+            dims[1] = data->logic_unit_size();
+            auto array = payload_array(owner, 2, dims,
+                PyArray_DescrFromType(NPY_UINT8),
+                (void *)data->logic_data());
+            if (!array)
+                goto fail;
+            PyDict_SetItemString(result, "logic", array);
+            Py_DECREF(array);
+        } else {
+            PyDict_SetItemString(result, "logic", Py_None);
+        }
+
+        for (const auto &name : data->analog_channels()) {
+            npy_intp dims[1];
+            dims[0] = data->analog_count(name);
+            auto array = payload_array(owner, 1, dims,
+                PyArray_DescrFromType(NPY_FLOAT32),
+                (void *)data->analog_data(name));
+            if (!array)
+                goto fail;
+            PyDict_SetItemString(analog, name.c_str(), array);
+            Py_DECREF(array);
+        }
+
+        Py_DECREF(owner);
+        return result;
+
+    fail:
+        Py_DECREF(owner);
+        Py_DECREF(result);
+        return NULL;
+    }
+
+%pythoncode
+{
+    def capture_to_arrays(self, expected_samples=0):
+        """Run the session and collect all sample data.
+
+        Returns a dict with the logic data as an array of shape
+        (samples, unit size) under 'logic' (None without logic data),
+        and a dict of float arrays by channel name under 'analog'.
+        The GIL is released while the session runs."""
+        return self._capture_to_arrays(expected_samples)
+}
+}
+
 %include "doc_end.i"
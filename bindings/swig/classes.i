@@ -58,6 +58,7 @@ template< class T > class enable_shared_from_this;
 %shared_ptr(sigrok::Channel);
 %shared_ptr(sigrok::ChannelGroup);
 %shared_ptr(sigrok::Session);
+%shared_ptr(sigrok::CaptureData);
 %shared_ptr(sigrok::SessionDevice);
 %shared_ptr(sigrok::Packet);
 %shared_ptr(sigrok::PacketPayload);
@@ -80,6 +81,19 @@ template< class T > class enable_shared_from_this;
 #define SR_PRIV
 
 %ignore sigrok::DatafeedCallbackData;
+%ignore sigrok::PacketView;
+%ignore sigrok::Session::add_datafeed_view_callback;
+%ignore sigrok::Session::next_packet;
+%ignore sigrok::SampleSpan;
+%ignore sigrok::Analog::channel_list;
+%ignore sigrok::Context::create_logic_packet(void *, size_t, unsigned int,
+	ReleaseCallback);
+%ignore sigrok::Context::create_analog_packet(
+	std::vector<std::shared_ptr<Channel> >, const void *, unsigned int,
+	unsigned int, bool, bool, bool, std::pair<int64_t, uint64_t>,
+	std::pair<int64_t, uint64_t>, const Quantity *, const Unit *,
+	std::vector<const QuantityFlag *>, ReleaseCallback);
+%ignore sigrok::Input::send_buffer(void *, size_t, ReleaseCallback);
 
 #ifndef SWIGJAVA
 
@@ -107,6 +107,20 @@ enum sr_loglevel {
 	SR_LOG_SPEW = 5, /**< Output very noisy debug messages. */
 };
 
+/** A formatted log message, see sr_log_record_callback_set(). */
+struct sr_log_record {
+	/** Loglevel of the message (SR_LOG_ERR, ...). */
+	int loglevel;
+	/** Monotonic time of the message in microseconds, g_get_monotonic_time(). */
+	int64_t timestamp;
+	/** Subsystem which logged the message, e.g. "hwdriver". */
+	const char *prefix;
+	/** Message text, without the prefix and without line breaks. */
+	const char *message;
+	/** Length of the message text in bytes. */
+	size_t message_len;
+};
+
 /*
  * Use SR_API to mark public API symbols, and SR_PRIV for private symbols.
  *
@@ -176,6 +190,12 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_runs. */
+	SR_DF_LOGIC_RUNS,
+	/** Payload is struct sr_datafeed_logic_planar. */
+	SR_DF_LOGIC_PLANAR,
+	/** Payload is struct sr_datafeed_logic_edges. */
+	SR_DF_LOGIC_EDGES,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
@@ -418,6 +438,8 @@ enum sr_trigger_matches {
 	SR_TRIGGER_EDGE,
 	SR_TRIGGER_OVER,
 	SR_TRIGGER_UNDER,
+	SR_TRIGGER_INSIDE,
+	SR_TRIGGER_OUTSIDE,
 };
 
 /** The representation of a trigger, consisting of one or more stages
@@ -436,6 +458,13 @@ struct sr_trigger_stage {
 	int stage;
 	/** List of pointers to struct sr_trigger_match. */
 	GSList *matches;
+	/** Number of times the stage's matches must occur, since the
+	 * previous stage matched. 0 and 1 both mean once. */
+	uint64_t count;
+	/** Maximum distance in samples from the previous stage's match to
+	 * the stage's (last) occurrence. 0 means the occurrences must be
+	 * consecutive samples, directly following the previous stage. */
+	uint64_t within;
 };
 
 /** A channel to match and what to match it on. */
@@ -453,14 +482,25 @@ struct sr_trigger_match {
 	 * For analog channels, only these matches may be used:
 	 * SR_TRIGGER_RISING
 	 * SR_TRIGGER_FALLING
+	 * SR_TRIGGER_EDGE
 	 * SR_TRIGGER_OVER
 	 * SR_TRIGGER_UNDER
+	 * SR_TRIGGER_INSIDE
+	 * SR_TRIGGER_OUTSIDE
 	 *
 	 */
 	int match;
 	/** If the trigger match is one of SR_TRIGGER_OVER or SR_TRIGGER_UNDER,
-	 * this contains the value to compare against. */
+	 * this contains the value to compare against. For edge matches on
+	 * analog channels, this is the level to cross. For SR_TRIGGER_INSIDE
+	 * and SR_TRIGGER_OUTSIDE, this is the lower bound of the window. */
 	float value;
+	/** Upper bound of the window for SR_TRIGGER_INSIDE and
+	 * SR_TRIGGER_OUTSIDE. */
+	float value_high;
+	/** Hysteresis of edge matches on analog channels. The signal must
+	 * have been at least this far on the other side of the level. */
+	float hysteresis;
 };
 
 /**
@@ -483,6 +523,14 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * Opaque structure representing a reference counted memory buffer
+ * which carries datafeed sample data.
+ *
+ * @see sr_buffer_new(), sr_buffer_ref(), sr_buffer_unref().
+ */
+struct sr_buffer;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -514,6 +562,63 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run length encoded logic datafeed payload for type SR_DF_LOGIC_RUNS.
+ *
+ * The sample value at data + i * unitsize repeats lengths[i] times.
+ * Sources which know the timing of their value changes (like sparse
+ * simulator dumps) send this instead of SR_DF_LOGIC, consumers can
+ * expand it with sr_logic_runs_expand(). Datafeed callbacks and output
+ * modules get the runs expanded unless they opted in, see
+ * sr_session_datafeed_callback_runs_set() and SR_OUTPUT_LOGIC_RUNS.
+ */
+struct sr_datafeed_logic_runs {
+	uint64_t num_runs;
+	uint16_t unitsize;
+	void *data;
+	uint64_t *lengths;
+};
+
+/**
+ * Bit planar logic datafeed payload for type SR_DF_LOGIC_PLANAR.
+ *
+ * Samples come in blocks of 32. A block holds one 32bit word (in host
+ * byte order) per plane, the block's first sample is the word's most
+ * significant bit. Plane p carries the channel at bit plane_bits[p]
+ * of a unitsize sample, channels without a plane are low. Devices
+ * which capture this way send it instead of SR_DF_LOGIC when the
+ * session accepts it (see sr_session_logic_planar_set()), consumers
+ * can convert it with sr_logic_planar_to_logic().
+ */
+struct sr_datafeed_logic_planar {
+	uint64_t num_blocks;
+	uint16_t unitsize;
+	uint16_t num_planes;
+	uint8_t *plane_bits;
+	uint32_t *data;
+};
+
+/**
+ * Edge index datafeed payload for type SR_DF_LOGIC_EDGES.
+ *
+ * Lists where logic channels change their value, so consumers which
+ * follow a few channels don't have to scan all samples. The "edges"
+ * transform module sends it right before the SR_DF_LOGIC packet which
+ * it indexes, of num_samples samples. Entry n of the index is about the
+ * logic channel with index channels[n], its edges are at
+ * positions[offsets[n]] up to positions[offsets[n + 1] - 1], in
+ * ascending order. At position p, sample p of the logic packet differs
+ * from the sample before it, which for p = 0 is the last sample of the
+ * previous packet.
+ */
+struct sr_datafeed_logic_edges {
+	uint64_t num_samples;
+	uint16_t num_channels;
+	uint16_t *channels;
+	uint64_t *offsets;
+	uint64_t *positions;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -521,6 +626,13 @@ struct sr_datafeed_analog {
 	struct sr_analog_encoding *encoding;
 	struct sr_analog_meaning *meaning;
 	struct sr_analog_spec *spec;
+	/**
+	 * Optional reception time of each sample, in microseconds of the
+	 * monotonic clock (see g_get_monotonic_time()), or NULL. Allows
+	 * to merge the data of several slow instruments. Only valid for
+	 * the duration of the packet's submission.
+	 */
+	const int64_t *timestamps;
 };
 
 struct sr_analog_encoding {
@@ -618,6 +730,164 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/**
+	 * If set, this output module handles SR_DF_LOGIC_RUNS packets.
+	 * Other modules get them expanded into SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_RUNS = 0x02,
+};
+
+/**
+ * Back-pressure policy of the asynchronous datafeed dispatch queue.
+ *
+ * @see sr_session_dispatch_async_set().
+ */
+enum sr_dispatch_policy {
+	/** Block the sender until the dispatch queue has room. */
+	SR_DISPATCH_BLOCK = 10000,
+	/** Drop sample data packets (logic, analog) when the queue is full. */
+	SR_DISPATCH_DROP,
+};
+
+/**
+ * Classes of threads which a session creates.
+ *
+ * @see sr_session_thread_policy_set().
+ */
+enum sr_thread_class {
+	/** Device threads, see sr_session_device_threads_set(). */
+	SR_THREAD_DEVICE = 1 << 0,
+	/** Asynchronous dispatch thread, see sr_session_dispatch_async_set(). */
+	SR_THREAD_DISPATCH = 1 << 1,
+	/** Fan-out worker threads, see sr_session_datafeed_parallel_set(). */
+	SR_THREAD_FANOUT = 1 << 2,
+};
+
+/**
+ * Statistics of a device's streaming data transfers (e.g. USB bulk).
+ *
+ * Times are in microseconds. All zero for devices which don't stream.
+ */
+struct sr_transfer_stats {
+	/** Number of transfers in the queue. */
+	unsigned int queue_size;
+	/** Fewest transfers still pending when one completed. */
+	unsigned int in_flight_min;
+	/** Number of completed transfers which carried data. */
+	uint64_t transfers;
+	/** Number of bytes received. */
+	uint64_t bytes;
+	/** Number of transfers which completed without data, or failed. */
+	uint64_t empty_transfers;
+	/** Number of completion gaps longer than the queue could buffer. */
+	uint64_t overruns;
+	/** Longest interval between two transfer completions. */
+	uint64_t gap_max;
+	/** Sum of the intervals between transfer completions. */
+	uint64_t gap_total;
+	/** Longest time from a transfer's completion to its resubmission. */
+	uint64_t latency_max;
+	/** Sum of the times from completion to resubmission. */
+	uint64_t latency_total;
+};
+
+/** Datafeed statistics of one device in a session. */
+struct sr_dev_stats {
+	/** The device which sent the packets. */
+	const struct sr_dev_inst *sdi;
+	/** Number of datafeed packets of any type. */
+	uint64_t packets;
+	/** Number of bytes of sample data (logic and analog). */
+	uint64_t bytes;
+	/** Number of samples (logic and analog). */
+	uint64_t samples;
+	/** Streaming transfer statistics, if the driver reports them. */
+	struct sr_transfer_stats transfers;
+};
+
+/** Accumulated run time of a transform or a datafeed callback. */
+struct sr_dispatch_timing {
+	/** Number of invocations. */
+	uint64_t calls;
+	/** Total run time of all invocations, in microseconds. */
+	uint64_t time_total;
+	/** Longest run time of a single invocation, in microseconds. */
+	uint64_t time_max;
+};
+
+/**
+ * Snapshot of a session's datafeed statistics.
+ *
+ * @see sr_session_stats_get(), sr_session_stats_free().
+ */
+struct sr_session_stats {
+	/** Time since the session was started, in microseconds. */
+	uint64_t elapsed;
+	/** Number of devices which have sent packets. */
+	size_t num_devices;
+	/** Per-device statistics, num_devices items. */
+	struct sr_dev_stats *devices;
+	/** Number of transforms in the session. */
+	size_t num_transforms;
+	/** Per-transform timing, in the order of the transforms' creation. */
+	struct sr_dispatch_timing *transforms;
+	/** Number of datafeed callbacks in the session. */
+	size_t num_callbacks;
+	/** Per-callback timing, in the order of the callbacks' registration. */
+	struct sr_dispatch_timing *callbacks;
+	/** Highest fill level of the asynchronous dispatch queue. */
+	size_t queue_high_water;
+	/** Number of packets which were dropped by the dispatch queue. */
+	uint64_t queue_dropped;
+};
+
+/**
+ * Time base of a device in a session. Times are in nanoseconds of
+ * session time, which starts when the session starts.
+ *
+ * @see sr_session_timebase_get(), sr_session_sample_time().
+ */
+struct sr_timebase {
+	/** When the device sent its SR_DF_HEADER packet. */
+	int64_t start;
+	/** The start time which the device reported in its header. */
+	struct timeval starttime;
+	/** The device's current samplerate, 0 when unknown. */
+	uint64_t samplerate;
+	/** Number of samples the device has sent. */
+	uint64_t samples;
+	/** Whether the device has sent an SR_DF_TRIGGER packet. */
+	gboolean triggered;
+	/** Sample number of the device's first trigger. */
+	uint64_t trigger_sample;
+	/** Time of the device's first trigger. */
+	int64_t trigger_time;
+};
+
+/** A channel of a session file, see sr_session_file_info_get(). */
+struct sr_session_file_channel {
+	/** The channel's index in the device of the loaded session. */
+	int index;
+	/** Channel type (SR_CHANNEL_LOGIC, ...) */
+	int type;
+	/** Name of the channel. */
+	char *name;
+};
+
+/** Metadata of a session file, see sr_session_file_info_get(). */
+struct sr_session_file_info {
+	/** Samplerate in Hz, 0 when the file doesn't specify it. */
+	uint64_t samplerate;
+	/** Number of samples, 0 when unknown. */
+	uint64_t num_samples;
+	/** Bytes per logic sample, 0 without logic data. */
+	unsigned int unitsize;
+	/** Number of logic channels, enabled or not. */
+	int num_logic_channels;
+	/** Number of analog channels. */
+	int num_analog_channels;
+	/** The channels with data, sr_session_file_channel structs. */
+	GSList *channels;
 };
 
 struct sr_input;
@@ -1156,6 +1426,52 @@ enum sr_configkey {
 	 */
 	SR_CONF_INVERTED,
 
+	/**
+	 * How the device's data transport trades latency for robustness.
+	 * @arg type: string ("balanced", "low-latency" or "robust")
+	 * @arg get: get the current profile
+	 * @arg set: change the profile, effective from the next acquisition
+	 * @arg list: list the supported profiles
+	 */
+	SR_CONF_TRANSFER_PROFILE,
+
+	/**
+	 * Generate data as fast as possible, instead of at the samplerate's
+	 * real time pace. Sample and time limits refer to sample time.
+	 * @arg type: boolean
+	 * @arg get: @b true if the mode is enabled
+	 * @arg set: enable or disable the mode
+	 */
+	SR_CONF_MAX_THROUGHPUT,
+
+	/**
+	 * Encoding of the analog values the device sends.
+	 * @arg type: string ("float" or "int16")
+	 * @arg get: get the current encoding
+	 * @arg set: change the encoding
+	 * @arg list: list the supported encodings
+	 */
+	SR_CONF_ANALOG_ENCODING,
+
+	/**
+	 * Number of readings which get collected before they are sent
+	 * in one analog packet per channel. A value of 0 or 1 sends every
+	 * reading in a packet of its own.
+	 * @arg type: uint64_t
+	 * @arg get: get the current number of readings per packet
+	 * @arg set: change the number of readings per packet
+	 */
+	SR_CONF_BATCH_SAMPLES,
+
+	/**
+	 * Maximum time (in ms) for which readings are kept, before
+	 * collected readings get sent. 0 means there is no time limit.
+	 * @arg type: uint64_t
+	 * @arg get: get the current time limit
+	 * @arg set: change the time limit
+	 */
+	SR_CONF_BATCH_MSEC,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Special stuff -------------------------------------------------*/
@@ -1192,6 +1508,60 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * The device supports starting the playback of a capture at
+	 * a sample number.
+	 * @arg type: uint64_t
+	 * @arg get: the first sample to play back
+	 * @arg set: change the first sample to play back
+	 */
+	SR_CONF_CAPTURE_START,
+
+	/**
+	 * The device supports starting the playback of a capture at
+	 * a time (in ms). Takes precedence over SR_CONF_CAPTURE_START.
+	 * @arg type: uint64_t
+	 * @arg get: the time to start playback at, 0 when unset
+	 * @arg set: change the time to start playback at
+	 */
+	SR_CONF_CAPTURE_START_MSEC,
+
+	/**
+	 * The number of chunks to decompress ahead of their playback,
+	 * in parallel. 0 decompresses the chunks as they get played.
+	 * @arg type: uint64_t
+	 * @arg get: the read-ahead depth
+	 * @arg set: change the read-ahead depth
+	 */
+	SR_CONF_CAPTURE_READAHEAD,
+
+	/**
+	 * The playback speed of a capture, relative to its samplerate.
+	 * 1.0 plays in real time, 0 plays as fast as the main loop turns.
+	 * @arg type: double
+	 * @arg get: the playback speed
+	 * @arg set: change the playback speed
+	 */
+	SR_CONF_CAPTURE_SPEED,
+
+	/**
+	 * Play back a capture in one go, without returning to the main
+	 * loop in between. Ignores SR_CONF_CAPTURE_SPEED.
+	 * @arg type: boolean
+	 * @arg get: @b true if the bulk playback is enabled
+	 * @arg set: enable or disable the bulk playback
+	 */
+	SR_CONF_CAPTURE_BULK,
+
+	/**
+	 * The payload size of the packets which play back a capture,
+	 * in bytes.
+	 * @arg type: uint64_t
+	 * @arg get: the payload size
+	 * @arg set: change the payload size, at least 4096 bytes
+	 */
+	SR_CONF_CAPTURE_CHUNKSIZE,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
@@ -1381,6 +1751,31 @@ struct sr_serial_port {
 	char *description;
 };
 
+/** Type of a hotplug event, see sr_hotplug_subscribe(). */
+enum sr_hotplug_event_type {
+	/** A device was found on a newly attached USB device. */
+	SR_HOTPLUG_DEVICE_ADDED,
+	/** The USB device of a previously added device was detached. */
+	SR_HOTPLUG_DEVICE_REMOVED,
+	/** A serial port appeared. */
+	SR_HOTPLUG_SERIAL_ADDED,
+	/** A serial port disappeared. */
+	SR_HOTPLUG_SERIAL_REMOVED,
+};
+
+/** Hotplug event, passed to the callback of sr_hotplug_subscribe(). */
+struct sr_hotplug_event {
+	/** Type of the event. */
+	enum sr_hotplug_event_type type;
+	/** The device, for device events. NULL otherwise. */
+	struct sr_dev_inst *sdi;
+	/** The OS dependent port name, for serial port events. NULL otherwise. */
+	const char *port;
+};
+
+/** Opaque structure representing a hotplug subscription. */
+struct sr_hotplug;
+
 #include <libsigrok/proto.h>
 #include <libsigrok/version.h>
 
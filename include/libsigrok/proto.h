@@ -30,6 +30,18 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
+SR_API int sr_analog_to_float_range(const struct sr_datafeed_analog *analog,
+		size_t start, size_t end, float *buf, size_t stride);
+SR_API int sr_analog_to_double_range(const struct sr_datafeed_analog *analog,
+		size_t start, size_t end, double *buf, size_t stride);
+SR_API int sr_analog_stats_get(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end,
+		double *min, double *max, double *mean);
+SR_API int sr_analog_decimate(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end, size_t factor,
+		float *min, float *max);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -57,17 +69,32 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *logic, uint16_t unitsize,
+		unsigned int bit, uint64_t count);
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *logic,
+		uint16_t unitsize, unsigned int bit, uint64_t count);
+SR_API uint64_t sr_logic_runs_expand(const struct sr_datafeed_logic_runs *runs,
+		uint64_t *run, uint64_t *offset, uint8_t *out, uint64_t count);
+SR_API int sr_logic_planar_to_logic(const struct sr_datafeed_logic_planar *planar,
+		uint8_t *out);
+SR_API void sr_logic_unitsize_convert(const uint8_t *in, size_t in_unitsize,
+		uint8_t *out, size_t out_unitsize, size_t count);
 
 /*--- log.c -----------------------------------------------------------------*/
 
 typedef int (*sr_log_callback)(void *cb_data, int loglevel,
 				const char *format, va_list args);
+typedef void (*sr_log_record_callback)(const struct sr_log_record *record,
+				void *cb_data);
 
 SR_API int sr_log_loglevel_set(int loglevel);
 SR_API int sr_log_loglevel_get(void);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
+SR_API int sr_log_record_callback_set(sr_log_record_callback cb, void *cb_data);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -84,6 +111,7 @@ SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver);
 SR_API int sr_dev_clear(const struct sr_dev_driver *driver);
 SR_API int sr_dev_open(struct sr_dev_inst *sdi);
 SR_API int sr_dev_close(struct sr_dev_inst *sdi);
+SR_API int sr_dev_config_reapply(struct sr_dev_inst *sdi);
 
 SR_API struct sr_dev_driver *sr_dev_inst_driver_get(const struct sr_dev_inst *sdi);
 SR_API const char *sr_dev_inst_vendor_get(const struct sr_dev_inst *sdi);
@@ -105,6 +133,7 @@ SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx, GSList *options);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -120,17 +149,32 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key);
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid);
 
+/*--- hotplug.c -------------------------------------------------------------*/
+
+typedef void (*sr_hotplug_callback)(const struct sr_hotplug_event *event,
+		void *cb_data);
+
+SR_API int sr_hotplug_subscribe(struct sr_context *ctx,
+		sr_hotplug_callback cb, void *cb_data, struct sr_hotplug **hotplug);
+SR_API int sr_hotplug_unsubscribe(struct sr_hotplug *hotplug);
+
 /*--- session.c -------------------------------------------------------------*/
 
 typedef void (*sr_session_stopped_callback)(void *data);
 typedef void (*sr_datafeed_callback)(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet, void *cb_data);
+typedef void (*sr_datafeed_batch_callback)(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *const *packets, size_t count,
+		void *cb_data);
 
 SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session);
 
 /* Session setup */
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	struct sr_session **session);
+SR_API int sr_session_file_info_get(const char *filename,
+	struct sr_session_file_info **info);
+SR_API void sr_session_file_info_free(struct sr_session_file_info *info);
 SR_API int sr_session_new(struct sr_context *ctx, struct sr_session **session);
 SR_API int sr_session_destroy(struct sr_session *session);
 SR_API int sr_session_dev_remove_all(struct sr_session *session);
@@ -145,11 +189,32 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_batch_callback_add(struct sr_session *session,
+		sr_datafeed_batch_callback cb, void *cb_data);
+SR_API int sr_session_dispatch_async_set(struct sr_session *session,
+		size_t queue_depth, enum sr_dispatch_policy policy);
+SR_API int sr_session_dispatch_dropped_get(struct sr_session *session,
+		uint64_t *dropped);
+SR_API int sr_session_datafeed_parallel_set(struct sr_session *session,
+		unsigned int num_threads);
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_thread_policy_set(struct sr_session *session,
+		int classes, const unsigned int *cpus, size_t cpu_count,
+		int rt_priority);
+SR_API int sr_session_datafeed_callback_runs_set(struct sr_session *session,
+		void *cb_data, gboolean accept);
+SR_API int sr_session_logic_planar_set(struct sr_session *session,
+		gboolean accept);
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats);
+SR_API void sr_session_stats_free(struct sr_session_stats *stats);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
 SR_API int sr_session_run(struct sr_session *session);
 SR_API int sr_session_stop(struct sr_session *session);
+SR_API int sr_session_rearm(struct sr_session *session);
 SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
@@ -158,8 +223,76 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
 
+typedef void (*sr_buffer_release_callback)(void *data, void *cb_data);
+
+SR_API struct sr_buffer *sr_buffer_new(void *data, size_t size,
+		sr_buffer_release_callback cb, void *cb_data);
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf);
+SR_API void sr_buffer_unref(struct sr_buffer *buf);
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf, size_t *size);
+SR_API int sr_packet_ref(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **ref);
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet);
+
+/*--- memory.c --------------------------------------------------------------*/
+
+SR_API int sr_memory_budget_set(struct sr_context *ctx, uint64_t budget);
+SR_API int sr_memory_budget_get(struct sr_context *ctx, uint64_t *budget);
+SR_API int sr_memory_usage_get(struct sr_context *ctx,
+		uint64_t *used, uint64_t *peak);
+
+/*--- thread_policy.c -------------------------------------------------------*/
+
+SR_API int sr_dev_local_cpus_get(const struct sr_dev_inst *sdi,
+		unsigned int **cpus, size_t *cpu_count);
+
+/*--- session_output.c ------------------------------------------------------*/
+
+SR_API int sr_session_output_add(struct sr_session *session,
+		const struct sr_output *o, FILE *file, size_t queue_depth);
+SR_API int sr_session_output_remove(struct sr_session *session,
+		const struct sr_output *o);
+
+/*--- session_recorder.c ----------------------------------------------------*/
+
+SR_API int sr_session_recorder_set(struct sr_session *session,
+		uint64_t max_samples, uint64_t max_age_ms);
+SR_API int sr_session_recorder_snapshot(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_recorder_save(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const char *filename);
+
+/*--- session_store.c -------------------------------------------------------*/
+
+SR_API int sr_session_store_set(struct sr_session *session,
+		gboolean enable, gboolean compress);
+SR_API int sr_session_store_samples_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		uint64_t *num_samples);
+SR_API int sr_session_store_logic_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const GSList *channels,
+		uint64_t start, uint64_t end, uint8_t *data,
+		uint64_t *num_samples);
+SR_API int sr_session_store_analog_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		uint64_t start, uint64_t end, float *data, uint64_t *num_samples);
+SR_API int sr_session_store_sample_find(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		int64_t time_ns, uint64_t *sample);
+
+/*--- session_timebase.c ----------------------------------------------------*/
+
+SR_API int sr_session_timebase_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_timebase *timebase);
+SR_API int sr_session_sample_time(struct sr_session *session,
+		const struct sr_dev_inst *sdi, uint64_t sample, int64_t *time_ns);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
+typedef int (*sr_input_ready_callback)(const struct sr_input *in,
+		void *cb_data);
+
 SR_API const struct sr_input_module **sr_input_list(void);
 SR_API const char *sr_input_id_get(const struct sr_input_module *imod);
 SR_API const char *sr_input_name_get(const struct sr_input_module *imod);
@@ -173,9 +306,20 @@ SR_API struct sr_input *sr_input_new(const struct sr_input_module *imod,
 		GHashTable *options);
 SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in);
 SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
+SR_API int sr_input_probe_file(const char *filename,
+		const struct sr_input_module **imod);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_data(const struct sr_input *in,
+		const void *data, size_t len);
+SR_API int sr_input_send_buffer(const struct sr_input *in,
+		struct sr_buffer *buf);
+SR_API int sr_input_load_file(const struct sr_input *in, const char *filename,
+		sr_input_ready_callback ready, void *cb_data);
+SR_API int sr_input_load_file_range(const struct sr_input *in,
+		const char *filename, uint64_t start, uint64_t count,
+		sr_input_ready_callback ready, void *cb_data);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
@@ -198,6 +342,10 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *buf);
+SR_API int sr_output_send_file(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, FILE *file);
 SR_API int sr_output_free(const struct sr_output *o);
 
 /*--- transform/transform.c -------------------------------------------------*/
@@ -218,8 +366,17 @@ SR_API int sr_transform_free(const struct sr_transform *t);
 SR_API struct sr_trigger *sr_trigger_new(const char *name);
 SR_API void sr_trigger_free(struct sr_trigger *trig);
 SR_API struct sr_trigger_stage *sr_trigger_stage_add(struct sr_trigger *trig);
+SR_API int sr_trigger_stage_timing_set(struct sr_trigger_stage *stage,
+		uint64_t count, uint64_t within);
 SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 		struct sr_channel *ch, int trigger_match, float value);
+SR_API int sr_trigger_match_analog_add(struct sr_trigger_stage *stage,
+		struct sr_channel *ch, int trigger_match, float value,
+		float value_high, float hysteresis);
+
+/*--- scpi/scpi_cache.c ----------------------------------------------------*/
+
+SR_API int sr_scpi_cache_clear(struct sr_context *ctx);
 
 /*--- serial.c --------------------------------------------------------------*/
 
@@ -266,6 +423,8 @@ SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 SR_API int sr_parse_rational(const char *str, struct sr_rational *ret);
 SR_API char *sr_text_trim_spaces(char *s);
 SR_API char *sr_text_next_line(char *s, size_t l, char **next, size_t *taken);
+SR_API size_t sr_text_next_lines(char *s, size_t l, char **lines,
+		size_t count, char **next, size_t *taken);
 SR_API char *sr_text_next_word(char *s, char **next);
 
 SR_API int sr_next_power_of_two(size_t value, size_t *bits, size_t *power);
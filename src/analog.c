@@ -157,34 +157,211 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
-/**
- * Convert an analog datafeed payload to an array of floats.
- *
- * The caller must provide the #outbuf space for the conversion result,
- * and is expected to free allocated space after use.
- *
- * @param[in] analog The analog payload to convert. Must not be NULL.
- *                   analog->data, analog->meaning, and analog->encoding
- *                   must not be NULL.
- * @param[out] outbuf Memory where to store the result. Must not be NULL.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR Unsupported encoding.
- * @retval SR_ERR_ARG Invalid argument.
+/*
+ * Conversion kernels, one per supported input encoding and result type.
+ * Every kernel is a single loop which loads a sample, applies scale and
+ * offset, and stores the result, without calls or branches in the loop
+ * body. Loads in the host's byte order go through memcpy(), which
+ * compilers turn into plain (unaligned) loads, and the loops get
+ * auto-vectorized for the build's target (SSE2, AVX2, NEON). Byte
+ * swapping loads use the common read_*() helpers, which compilers
+ * recognize as swaps. Strided output (stride > 1) gets a separate loop,
+ * to keep the contiguous case vectorizable.
  *
- * @since 0.4.0
+ * The kernels get selected once for a payload's encoding.
  */
-SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
-		float *outbuf)
+typedef void (*analog_float_kernel)(const uint8_t *in, float *out,
+		size_t count, size_t stride, double scale, double offset);
+typedef void (*analog_double_kernel)(const uint8_t *in, double *out,
+		size_t count, size_t stride, double scale, double offset);
+
+/** @cond PRIVATE */
+#define ANALOG_NATIVE_LOAD(name, type) \
+static inline type load_ ## name(const uint8_t *p) \
+{ \
+	type v; \
+	memcpy(&v, p, sizeof(v)); \
+	return v; \
+}
+
+#define ANALOG_KERNEL(name, width, load, otype) \
+static void analog_to_ ## otype ## _ ## name(const uint8_t *in, otype *out, \
+		size_t count, size_t stride, double scale, double offset) \
+{ \
+	size_t i; \
+	if (stride <= 1) { \
+		for (i = 0; i < count; i++) \
+			out[i] = (double)load(in + i * (width)) \
+				* scale + offset; \
+	} else { \
+		for (i = 0; i < count; i++) \
+			out[i * stride] = (double)load(in + i * (width)) \
+				* scale + offset; \
+	} \
+}
+
+#define ANALOG_KERNELS(name, type, load) \
+	ANALOG_KERNEL(name, sizeof(type), load, float) \
+	ANALOG_KERNEL(name, sizeof(type), load, double)
+
+/* Packed 24bit integers (audio PCM, ADCs) have no C type. */
+#define ANALOG_KERNELS_24(name, load) \
+	ANALOG_KERNEL(name, 3, load, float) \
+	ANALOG_KERNEL(name, 3, load, double)
+
+ANALOG_NATIVE_LOAD(u16, uint16_t)
+ANALOG_NATIVE_LOAD(i16, int16_t)
+ANALOG_NATIVE_LOAD(u32, uint32_t)
+ANALOG_NATIVE_LOAD(i32, int32_t)
+ANALOG_NATIVE_LOAD(flt, float)
+ANALOG_NATIVE_LOAD(dbl, double)
+
+#ifdef WORDS_BIGENDIAN
+#define load_u16be load_u16
+#define load_i16be load_i16
+#define load_u32be load_u32
+#define load_i32be load_i32
+#define load_fltbe load_flt
+#define load_dblbe load_dbl
+#define load_u16le read_u16le
+#define load_i16le read_i16le
+#define load_u32le read_u32le
+#define load_i32le read_i32le
+#define load_fltle read_fltle
+#define load_dblle read_dblle
+#else
+#define load_u16be read_u16be
+#define load_i16be read_i16be
+#define load_u32be read_u32be
+#define load_i32be read_i32be
+#define load_fltbe read_fltbe
+#define load_dblbe read_dblbe
+#define load_u16le load_u16
+#define load_i16le load_i16
+#define load_u32le load_u32
+#define load_i32le load_i32
+#define load_fltle load_flt
+#define load_dblle load_dbl
+#endif
+
+static inline int32_t load_i24le(const uint8_t *p)
 {
+	return (int32_t)(read_u24le(p) ^ 0x800000) - 0x800000;
+}
+
+static inline int32_t load_i24be(const uint8_t *p)
+{
+	return (int32_t)(read_u24be(p) ^ 0x800000) - 0x800000;
+}
+
+ANALOG_KERNELS(u8, uint8_t, read_u8)
+ANALOG_KERNELS(i8, int8_t, read_i8)
+ANALOG_KERNELS(u16le, uint16_t, load_u16le)
+ANALOG_KERNELS(u16be, uint16_t, load_u16be)
+ANALOG_KERNELS(i16le, int16_t, load_i16le)
+ANALOG_KERNELS(i16be, int16_t, load_i16be)
+ANALOG_KERNELS_24(u24le, read_u24le)
+ANALOG_KERNELS_24(u24be, read_u24be)
+ANALOG_KERNELS_24(i24le, load_i24le)
+ANALOG_KERNELS_24(i24be, load_i24be)
+ANALOG_KERNELS(u32le, uint32_t, load_u32le)
+ANALOG_KERNELS(u32be, uint32_t, load_u32be)
+ANALOG_KERNELS(i32le, int32_t, load_i32le)
+ANALOG_KERNELS(i32be, int32_t, load_i32be)
+ANALOG_KERNELS(fltle, float, load_fltle)
+ANALOG_KERNELS(fltbe, float, load_fltbe)
+ANALOG_KERNELS(dblle, double, load_dblle)
+ANALOG_KERNELS(dblbe, double, load_dblbe)
+
+#define KERNEL_ENTRY(fp, sign, be, size, name) \
+	{ fp, sign, be, size, analog_to_float_ ## name, analog_to_double_ ## name, }
+/** @endcond */
+
+struct analog_kernel {
+	gboolean is_float;
+	gboolean is_signed;
+	gboolean is_bigendian;
+	size_t unitsize;
+	analog_float_kernel to_float;
+	analog_double_kernel to_double;
+};
+
+static const struct analog_kernel analog_kernels[] = {
+	KERNEL_ENTRY(FALSE, FALSE, FALSE, 1, u8),
+	KERNEL_ENTRY(FALSE, FALSE, TRUE, 1, u8),
+	KERNEL_ENTRY(FALSE, TRUE, FALSE, 1, i8),
+	KERNEL_ENTRY(FALSE, TRUE, TRUE, 1, i8),
+	KERNEL_ENTRY(FALSE, FALSE, FALSE, 2, u16le),
+	KERNEL_ENTRY(FALSE, FALSE, TRUE, 2, u16be),
+	KERNEL_ENTRY(FALSE, TRUE, FALSE, 2, i16le),
+	KERNEL_ENTRY(FALSE, TRUE, TRUE, 2, i16be),
+	KERNEL_ENTRY(FALSE, FALSE, FALSE, 3, u24le),
+	KERNEL_ENTRY(FALSE, FALSE, TRUE, 3, u24be),
+	KERNEL_ENTRY(FALSE, TRUE, FALSE, 3, i24le),
+	KERNEL_ENTRY(FALSE, TRUE, TRUE, 3, i24be),
+	KERNEL_ENTRY(FALSE, FALSE, FALSE, 4, u32le),
+	KERNEL_ENTRY(FALSE, FALSE, TRUE, 4, u32be),
+	KERNEL_ENTRY(FALSE, TRUE, FALSE, 4, i32le),
+	KERNEL_ENTRY(FALSE, TRUE, TRUE, 4, i32be),
+	KERNEL_ENTRY(TRUE, FALSE, FALSE, 4, fltle),
+	KERNEL_ENTRY(TRUE, FALSE, TRUE, 4, fltbe),
+	KERNEL_ENTRY(TRUE, FALSE, FALSE, 8, dblle),
+	KERNEL_ENTRY(TRUE, FALSE, TRUE, 8, dblbe),
+};
+
+static const struct analog_kernel *analog_kernel_get(
+		const struct sr_analog_encoding *encoding)
+{
+	const struct analog_kernel *k;
+	gboolean is_signed;
+	size_t i;
+	char type_text[10];
+
+	/* Floating point input is signed, regardless of the flag. */
+	is_signed = encoding->is_float ? FALSE : encoding->is_signed;
+	for (i = 0; i < ARRAY_SIZE(analog_kernels); i++) {
+		k = &analog_kernels[i];
+		if (k->is_float != !!encoding->is_float)
+			continue;
+		if (k->is_signed != !!is_signed)
+			continue;
+		if (k->is_bigendian != !!encoding->is_bigendian)
+			continue;
+		if (k->unitsize != encoding->unitsize)
+			continue;
+		return k;
+	}
+
+	/*
+	 * Error messages for unsupported input property combinations
+	 * will only be seen by developers and maintainers of input
+	 * formats or acquisition device drivers. Terse output is
+	 * acceptable there, users shall never see them.
+	 */
+	snprintf(type_text, sizeof(type_text), "%c%zu%s",
+		encoding->is_float ? 'f' : encoding->is_signed ? 'i' : 'u',
+		(size_t)encoding->unitsize * 8,
+		encoding->is_bigendian ? "be" : "le");
+	sr_err("Unsupported type for analog conversion: %s.", type_text);
+
+	return NULL;
+}
+
+/*
+ * Convert the values [start, end) of an analog payload (all channels'
+ * values, interleaved as in the payload) to float or double, storing
+ * every stride'th element of outbuf.
+ */
+static int analog_convert(const struct sr_datafeed_analog *analog,
+		size_t start, size_t end, void *outbuf, size_t stride,
+		gboolean to_double)
+{
+	const struct sr_analog_encoding *encoding;
+	const struct analog_kernel *kernel;
+	const uint8_t *data8;
 	size_t count;
 	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
-	char type_text[10];
+	double scale, offset;
 
 	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
 		return SR_ERR_ARG;
@@ -192,190 +369,471 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		return SR_ERR_ARG;
 
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	if (start > end || end > count)
+		return SR_ERR_ARG;
+	count = end - start;
+	encoding = analog->encoding;
+	data8 = (const uint8_t *)analog->data + start * encoding->unitsize;
 
-	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
-	 * Error messages for unsupported input property combinations
-	 * will only be seen by developers and maintainers of input
-	 * formats or acquisition device drivers. Terse output is
-	 * acceptable there, users shall never see them.
-	 */
 #ifdef WORDS_BIGENDIAN
 	host_bigendian = TRUE;
 #else
 	host_bigendian = FALSE;
 #endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
 
 	/*
-	 * Prepare the iteration over the sample data: Get the common
-	 * scale/offset factors which apply to all individual values.
-	 * Position the read pointer on the first byte of input data.
+	 * Get the common scale/offset factors which apply to all
+	 * individual values. Do the calculations on double precision
+	 * values, float results only get trimmed on the way out.
 	 */
-	offset = analog->encoding->offset.p;
-	offset /= analog->encoding->offset.q;
-	scale = analog->encoding->scale.p;
-	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
+	offset = encoding->offset.p;
+	offset /= encoding->offset.q;
+	scale = encoding->scale.p;
+	scale /= encoding->scale.q;
 
 	/*
 	 * Immediately handle the special case where input data needs
 	 * no conversion because it already is in the application's
-	 * native format. Do apply scale/offset though when applicable
-	 * on our way out.
+	 * native format.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
-		if (scale != 1.0 || offset != 0.0) {
-			while (count--) {
-				*outbuf *= scale;
-				*outbuf += offset;
-				outbuf++;
-			}
-		}
+	if (encoding->is_float && stride <= 1 &&
+			encoding->unitsize == (to_double ? sizeof(double) : sizeof(float)) &&
+			!encoding->is_bigendian == !host_bigendian &&
+			scale == 1.0 && offset == 0.0) {
+		memcpy(outbuf, data8, count * encoding->unitsize);
 		return SR_OK;
 	}
 
-	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
-	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
+	kernel = analog_kernel_get(encoding);
+	if (!kernel)
 		return SR_ERR;
-	}
+	if (to_double)
+		kernel->to_double(data8, outbuf, count, stride, scale, offset);
+	else
+		kernel->to_float(data8, outbuf, count, stride, scale, offset);
 
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of floats.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
+		float *outbuf)
+{
+	if (!analog || !analog->meaning)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, 0, analog->num_samples
+		* g_slist_length(analog->meaning->channels), outbuf, 1, FALSE);
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Like sr_analog_to_float(), but keeps the double precision of the
+ * internal calculations in the result.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	if (!analog || !analog->meaning)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, 0, analog->num_samples
+		* g_slist_length(analog->meaning->channels), outbuf, 1, TRUE);
+}
+
+/**
+ * Convert a range of an analog datafeed payload's values to floats.
+ *
+ * Values are counted as in the result of sr_analog_to_float(), that is
+ * all channels' values, in the payload's (interleaved) order. Only the
+ * values [start, end) get converted, which allows converting just the
+ * part of a packet which is needed without a full size copy.
+ *
+ * The results get stored at every stride'th element of #outbuf. This
+ * allows writing a single channel's values into an interleaved buffer.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] start Index of the first value to convert.
+ * @param[in] end Index after the last value to convert. Must not be less
+ *                than @a start, nor exceed the payload's value count.
+ * @param[out] outbuf Memory where to store the result, end - start
+ *                    values with the given stride. Must not be NULL.
+ * @param[in] stride Distance of the results in elements of #outbuf.
+ *                   0 and 1 both store contiguous results.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_float_range(const struct sr_datafeed_analog *analog,
+		size_t start, size_t end, float *outbuf, size_t stride)
+{
+	return analog_convert(analog, start, end, outbuf, stride, FALSE);
+}
+
+/**
+ * Convert a range of an analog datafeed payload's values to doubles.
+ *
+ * Like sr_analog_to_float_range(), with double precision results.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] start Index of the first value to convert.
+ * @param[in] end Index after the last value to convert. Must not be less
+ *                than @a start, nor exceed the payload's value count.
+ * @param[out] outbuf Memory where to store the result, end - start
+ *                    values with the given stride. Must not be NULL.
+ * @param[in] stride Distance of the results in elements of #outbuf.
+ *                   0 and 1 both store contiguous results.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double_range(const struct sr_datafeed_analog *analog,
+		size_t start, size_t end, double *outbuf, size_t stride)
+{
+	return analog_convert(analog, start, end, outbuf, stride, TRUE);
+}
+
+/** @private
+ * Check whether an encoding is an integer type which
+ * sr_analog_raw_load() supports.
+ */
+SR_PRIV gboolean sr_analog_raw_supported(const struct sr_analog_encoding *encoding)
+{
+	if (encoding->is_float)
+		return FALSE;
+
+	return encoding->unitsize >= 1 && encoding->unitsize <= 4;
+}
+
+/** @private
+ * Load raw integer values without scale and offset, from every step'th
+ * byte of the input. The encoding must be supported, see
+ * sr_analog_raw_supported().
+ */
+SR_PRIV void sr_analog_raw_load(const struct sr_analog_encoding *encoding,
+		const uint8_t *p, size_t step, size_t n, int64_t *raw)
+{
+	size_t i;
+
+	switch (encoding->unitsize * 4 + !!encoding->is_signed * 2
+			+ !!encoding->is_bigendian) {
+	case 4: case 5:
+		for (i = 0; i < n; i++)
+			raw[i] = read_u8(p + i * step);
+		break;
+	case 6: case 7:
+		for (i = 0; i < n; i++)
+			raw[i] = read_i8(p + i * step);
+		break;
+	case 8:
+		for (i = 0; i < n; i++)
+			raw[i] = load_u16le(p + i * step);
+		break;
+	case 9:
+		for (i = 0; i < n; i++)
+			raw[i] = load_u16be(p + i * step);
+		break;
+	case 10:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i16le(p + i * step);
+		break;
+	case 11:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i16be(p + i * step);
+		break;
+	case 12:
+		for (i = 0; i < n; i++)
+			raw[i] = read_u24le(p + i * step);
+		break;
+	case 13:
+		for (i = 0; i < n; i++)
+			raw[i] = read_u24be(p + i * step);
+		break;
+	case 14:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i24le(p + i * step);
+		break;
+	case 15:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i24be(p + i * step);
+		break;
+	case 16:
+		for (i = 0; i < n; i++)
+			raw[i] = load_u32le(p + i * step);
+		break;
+	case 17:
+		for (i = 0; i < n; i++)
+			raw[i] = load_u32be(p + i * step);
+		break;
+	case 18:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i32le(p + i * step);
+		break;
+	case 19:
+		for (i = 0; i < n; i++)
+			raw[i] = load_i32be(p + i * step);
+		break;
 	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+}
+
+/* Load floating point values without scale and offset. */
+static void analog_fp_load(const struct sr_analog_encoding *encoding,
+		const uint8_t *p, size_t step, size_t n, double *values)
+{
+	size_t i;
+
+	if (encoding->unitsize == sizeof(float)) {
+		for (i = 0; i < n; i++)
+			values[i] = encoding->is_bigendian
+				? load_fltbe(p + i * step) : load_fltle(p + i * step);
+	} else {
+		for (i = 0; i < n; i++)
+			values[i] = encoding->is_bigendian
+				? load_dblbe(p + i * step) : load_dblle(p + i * step);
 	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
+}
+
+/** @cond PRIVATE */
+#define ANALOG_BLOCK	256
+/** @endcond */
+
+/*
+ * Reduce the channel's samples [start, end) to their minimum, maximum
+ * and sum, without scale and offset. Integer input is reduced in its
+ * raw encoding.
+ */
+static int analog_reduce(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end,
+		double *min, double *max, double *sum)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *p;
+	int64_t raw[ANALOG_BLOCK], rmin, rmax, rsum;
+	double values[ANALOG_BLOCK];
+	size_t num_channels, step, n, i;
+	gboolean is_raw;
+
+	enc = analog->encoding;
+	num_channels = g_slist_length(analog->meaning->channels);
+	step = num_channels * enc->unitsize;
+	p = (const uint8_t *)analog->data + start * step
+		+ channel * enc->unitsize;
+	is_raw = sr_analog_raw_supported(enc);
+
+	*min = INFINITY;
+	*max = -INFINITY;
+	*sum = 0;
+	while (start < end) {
+		n = MIN(end - start, ANALOG_BLOCK);
+		if (is_raw) {
+			sr_analog_raw_load(enc, p, step, n, raw);
+			rmin = rmax = raw[0];
+			rsum = 0;
+			for (i = 0; i < n; i++) {
+				rmin = MIN(rmin, raw[i]);
+				rmax = MAX(rmax, raw[i]);
+				rsum += raw[i];
+			}
+			*min = MIN(*min, (double)rmin);
+			*max = MAX(*max, (double)rmax);
+			*sum += rsum;
+		} else {
+			analog_fp_load(enc, p, step, n, values);
+			for (i = 0; i < n; i++) {
+				*min = MIN(*min, values[i]);
+				*max = MAX(*max, values[i]);
+				*sum += values[i];
+			}
 		}
-		return SR_OK;
+		p += n * step;
+		start += n;
 	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
+
+	return SR_OK;
+}
+
+static int analog_view_check(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end)
+{
+	const struct sr_analog_encoding *enc;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (channel >= g_slist_length(analog->meaning->channels))
+		return SR_ERR_ARG;
+	if (start >= end || end > analog->num_samples)
+		return SR_ERR_ARG;
+
+	enc = analog->encoding;
+	if (enc->is_float && enc->unitsize != sizeof(float)
+			&& enc->unitsize != sizeof(double))
+		return SR_ERR;
+	if (!enc->is_float && !sr_analog_raw_supported(enc))
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/* Apply scale and offset to a minimum and maximum. */
+static void analog_minmax_scale(const struct sr_analog_encoding *enc,
+		double rmin, double rmax, double *min, double *max)
+{
+	double scale, offset, lo, hi;
+
+	scale = (double)enc->scale.p / enc->scale.q;
+	offset = (double)enc->offset.p / enc->offset.q;
+	lo = rmin * scale + offset;
+	hi = rmax * scale + offset;
+	/* A negative scale swaps the extremes. */
+	*min = MIN(lo, hi);
+	*max = MAX(lo, hi);
+}
+
+/**
+ * Get the minimum, maximum and mean value of a channel in an analog
+ * datafeed payload.
+ *
+ * The values get computed on the payload's raw data, scale and offset
+ * only get applied to the results. This avoids converting every sample
+ * to floating point, see sr_analog_to_float().
+ *
+ * @param[in] analog The analog payload. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] channel Index of the channel in analog->meaning->channels.
+ * @param[in] start Index of the channel's first sample to consider.
+ * @param[in] end Index after the channel's last sample to consider. Must
+ *                be greater than @a start, and not exceed the payload's
+ *                number of samples.
+ * @param[out] min The minimum value. Can be NULL.
+ * @param[out] max The maximum value. Can be NULL.
+ * @param[out] mean The mean value. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_stats_get(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end,
+		double *min, double *max, double *mean)
+{
+	const struct sr_analog_encoding *enc;
+	double rmin, rmax, rsum;
+	double lo, hi;
+	int ret;
+
+	if ((ret = analog_view_check(analog, channel, start, end)) != SR_OK)
+		return ret;
+
+	enc = analog->encoding;
+	analog_reduce(analog, channel, start, end, &rmin, &rmax, &rsum);
+	analog_minmax_scale(enc, rmin, rmax, &lo, &hi);
+	if (min)
+		*min = lo;
+	if (max)
+		*max = hi;
+	if (mean)
+		*mean = rsum / (end - start) * enc->scale.p / enc->scale.q
+			+ (double)enc->offset.p / enc->offset.q;
+
+	return SR_OK;
+}
+
+/**
+ * Get a decimated view of a channel in an analog datafeed payload.
+ *
+ * The channel's samples [start, end) get split into buckets of
+ * @a factor samples (the last one may be shorter), and the minimum and
+ * maximum value of every bucket get stored. This is what viewers need
+ * to draw a signal's envelope at a zoom level where a pixel covers many
+ * samples. The buckets get reduced on the raw data, only the results
+ * get converted to floating point.
+ *
+ * @param[in] analog The analog payload. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] channel Index of the channel in analog->meaning->channels.
+ * @param[in] start Index of the channel's first sample to consider.
+ * @param[in] end Index after the channel's last sample to consider. Must
+ *                be greater than @a start, and not exceed the payload's
+ *                number of samples.
+ * @param[in] factor The number of samples per bucket. Must not be 0.
+ * @param[out] min The buckets' minimum values, space for
+ *                 (end - start + factor - 1) / factor values. Can be NULL.
+ * @param[out] max The buckets' maximum values, same size as @a min.
+ *                 Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_decimate(const struct sr_datafeed_analog *analog,
+		size_t channel, size_t start, size_t end, size_t factor,
+		float *min, float *max)
+{
+	double rmin, rmax, rsum, lo, hi;
+	size_t bucket, n;
+	int ret;
+
+	if ((ret = analog_view_check(analog, channel, start, end)) != SR_OK)
+		return ret;
+	if (!factor)
+		return SR_ERR_ARG;
+
+	for (bucket = 0; start < end; bucket++, start += n) {
+		n = MIN(end - start, factor);
+		analog_reduce(analog, channel, start, start + n,
+			&rmin, &rmax, &rsum);
+		analog_minmax_scale(analog->encoding, rmin, rmax, &lo, &hi);
+		if (min)
+			min[bucket] = lo;
+		if (max)
+			max[bucket] = hi;
 	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
+
+	return SR_OK;
 }
 
 /**
@@ -31,6 +31,9 @@
 #define LOG_PREFIX "backend"
 /** @endcond */
 
+/* Guards the lazy initialization of the contexts' transports. */
+G_LOCK_DEFINE_STATIC(transports);
+
 /**
  * @mainpage libsigrok API
  *
@@ -540,6 +543,46 @@ static int sanity_check_all_transform_modules(void)
 	return ret;
 }
 
+/*
+ * The modules, drivers and the LZO library only need checking once per
+ * process, they are the same for all contexts.
+ */
+static gpointer sanity_check_all(gpointer data)
+{
+	const struct sr_context *ctx;
+
+	ctx = data;
+
+	if (sanity_check_all_drivers(ctx) < 0) {
+		sr_err("Internal driver error(s), aborting.");
+		return GINT_TO_POINTER(SR_ERR);
+	}
+
+	if (sanity_check_all_input_modules() < 0) {
+		sr_err("Internal input module error(s), aborting.");
+		return GINT_TO_POINTER(SR_ERR);
+	}
+
+	if (sanity_check_all_output_modules() < 0) {
+		sr_err("Internal output module error(s), aborting.");
+		return GINT_TO_POINTER(SR_ERR);
+	}
+
+	if (sanity_check_all_transform_modules() < 0) {
+		sr_err("Internal transform module error(s), aborting.");
+		return GINT_TO_POINTER(SR_ERR);
+	}
+
+	if (lzo_init() != LZO_E_OK) {
+		sr_err("lzo_init() failed.");
+		sr_err("This usually indicates a compiler bug. Recompile without");
+		sr_err("optimizations, and enable '-DLZO_DEBUG' for diagnostics.");
+		return GINT_TO_POINTER(SR_ERR);
+	}
+
+	return GINT_TO_POINTER(SR_OK);
+}
+
 /**
  * Initialize libsigrok.
  *
@@ -558,15 +601,18 @@ static int sanity_check_all_transform_modules(void)
  */
 SR_API int sr_init(struct sr_context **ctx)
 {
+	static GOnce sanity_once = G_ONCE_INIT;
 	int ret = SR_ERR;
 	struct sr_context *context;
 #ifdef _WIN32
 	WSADATA wsadata;
 #endif
 
-	print_versions();
-
-	print_resourcepaths();
+	/* Only worth collecting when it's going to be logged. */
+	if (sr_log_loglevel_get() >= SR_LOG_DBG) {
+		print_versions();
+		print_resourcepaths();
+	}
 
 	if (!ctx) {
 		sr_err("%s(): libsigrok context was NULL.", __func__);
@@ -577,25 +623,9 @@ SR_API int sr_init(struct sr_context **ctx)
 
 	sr_drivers_init(context);
 
-	if (sanity_check_all_drivers(context) < 0) {
-		sr_err("Internal driver error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_input_modules() < 0) {
-		sr_err("Internal input module error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_output_modules() < 0) {
-		sr_err("Internal output module error(s), aborting.");
-		goto done;
-	}
-
-	if (sanity_check_all_transform_modules() < 0) {
-		sr_err("Internal transform module error(s), aborting.");
+	ret = GPOINTER_TO_INT(g_once(&sanity_once, sanity_check_all, context));
+	if (ret != SR_OK)
 		goto done;
-	}
 
 #ifdef _WIN32
 	if ((ret = WSAStartup(MAKEWORD(2, 2), &wsadata)) != 0) {
@@ -605,20 +635,52 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 #endif
 
-	if ((ret = lzo_init()) != LZO_E_OK) {
-		sr_err("lzo_init() failed with return code %d.", ret);
-		sr_err("This usually indicates a compiler bug. Recompile without");
-		sr_err("optimizations, and enable '-DLZO_DEBUG' for diagnostics.");
-		ret = SR_ERR;
-		goto done;
+	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
+
+	*ctx = context;
+	context = NULL;
+	ret = SR_OK;
+
+done:
+	g_free(context);
+	return ret;
+}
+
+/**
+ * Initialize the USB and HID transports of a context.
+ *
+ * This is done on first use rather than by sr_init(), since initializing
+ * libusb enumerates the system's USB devices, which processes that don't
+ * talk to hardware (e.g. file conversion) have no use for. Called by
+ * sr_driver_init(), and by other code which uses the transports before
+ * any driver was initialized.
+ *
+ * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
+ *
+ * @retval SR_OK Success, or the transports were initialized before.
+ * @retval SR_ERR Initialization failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_transports_init(struct sr_context *ctx)
+{
+#ifdef HAVE_LIBUSB_1_0
+	int ret;
+#endif
+
+	G_LOCK(transports);
+	if (ctx->transports_ready) {
+		G_UNLOCK(transports);
+		return SR_OK;
 	}
 
 #ifdef HAVE_LIBUSB_1_0
-	ret = libusb_init(&context->libusb_ctx);
+	ret = libusb_init(&ctx->libusb_ctx);
 	if (LIBUSB_SUCCESS != ret) {
 		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
-		ret = SR_ERR;
-		goto done;
+		ctx->libusb_ctx = NULL;
+		G_UNLOCK(transports);
+		return SR_ERR;
 	}
 #endif
 #ifdef HAVE_LIBHIDAPI
@@ -631,19 +693,18 @@ SR_API int sr_init(struct sr_context **ctx)
 	 */
 	if (hid_init() != 0) {
 		sr_err("HIDAPI hid_init() failed.");
-		ret = SR_ERR;
-		goto done;
+#ifdef HAVE_LIBUSB_1_0
+		libusb_exit(ctx->libusb_ctx);
+		ctx->libusb_ctx = NULL;
+#endif
+		G_UNLOCK(transports);
+		return SR_ERR;
 	}
 #endif
-	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
-
-	*ctx = context;
-	context = NULL;
-	ret = SR_OK;
+	ctx->transports_ready = TRUE;
+	G_UNLOCK(transports);
 
-done:
-	g_free(context);
-	return ret;
+	return SR_OK;
 }
 
 /**
@@ -669,13 +730,21 @@ SR_API int sr_exit(struct sr_context *ctx)
 	WSACleanup();
 #endif
 
+	if (ctx->transports_ready) {
 #ifdef HAVE_LIBHIDAPI
-	hid_exit();
+		hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
-	libusb_exit(ctx->libusb_ctx);
+		libusb_exit(ctx->libusb_ctx);
 #endif
+	}
 
+	if (ctx->resource_cache)
+		g_hash_table_destroy(ctx->resource_cache);
+	if (ctx->resource_uploads)
+		g_hash_table_destroy(ctx->resource_uploads);
+	if (ctx->scpi_cache)
+		g_hash_table_destroy(ctx->scpi_cache);
 	g_free(sr_driver_list(ctx));
 	g_free(ctx);
 
@@ -97,6 +97,11 @@
 #define CONNECT_RFCOMM_TRIES	3
 #define CONNECT_RFCOMM_RETRY_MS	100
 
+#define BLE_RX_SOCK_BUF_SIZE	(256 * 1024) /* Kernel side notification backlog. */
+#define BLE_RX_PACKET_SIZE	1024	/* Exceeds the largest ATT MTU (517). */
+#define BLE_MTU_EXCHANGE_TIMEOUT_MS	1000
+#define BLE_CONN_UPDATE_TIMEOUT_MS	2000
+
 /* {{{ compat decls */
 /*
  * The availability of conversion helpers in <bluetooth/bluetooth.h>
@@ -238,7 +243,10 @@ struct sr_bt_desc {
 	uint16_t cccd_handle;
 	uint16_t cccd_value;
 	uint16_t ble_mtu;
+	uint16_t att_mtu_req;
+	uint16_t conn_interval_ms;
 	/* Internal state. */
+	uint16_t att_mtu;
 	int devid;
 	int fd;
 	struct hci_filter orig_filter;
@@ -254,6 +262,8 @@ static ssize_t sr_bt_write_type_handle_bytes(struct sr_bt_desc *desc,
 	uint8_t type, uint16_t handle, const uint8_t *data, size_t len);
 static ssize_t sr_bt_char_write_req(struct sr_bt_desc *desc,
 	uint16_t handle, const void *data, size_t len);
+static int sr_bt_handle_packet(struct sr_bt_desc *desc,
+	uint8_t *buf, size_t buflen);
 
 SR_PRIV struct sr_bt_desc *sr_bt_desc_new(void)
 {
@@ -378,6 +388,24 @@ SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	return 0;
 }
 
+/*
+ * Optionally tune the BLE link for higher notification throughput.
+ * A non-zero ATT MTU gets proposed to the peripheral after connect,
+ * a non-zero connection interval (in ms) gets requested from the
+ * controller. Peers may not accept either, failure is not fatal.
+ */
+SR_PRIV int sr_bt_config_ble_link(struct sr_bt_desc *desc,
+	uint16_t att_mtu, uint16_t conn_interval_ms)
+{
+	if (!desc)
+		return -1;
+
+	desc->att_mtu_req = att_mtu;
+	desc->conn_interval_ms = conn_interval_ms;
+
+	return 0;
+}
+
 static int sr_bt_desc_open(struct sr_bt_desc *desc, int *id_ref)
 {
 	int id, sock;
@@ -656,11 +684,121 @@ SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration)
 /* }}} scan */
 /* {{{ connect/disconnect */
 
+/*
+ * Request a shorter connection interval. Peripherals send a limited
+ * number of notifications per connection event, so the interval caps
+ * the achievable throughput. Needs access to the HCI device, which
+ * may require privileges.
+ */
+static int sr_bt_request_conn_interval(struct sr_bt_desc *desc)
+{
+	struct l2cap_conninfo info;
+	socklen_t len;
+	bdaddr_t mac;
+	uint16_t interval, timeout;
+	int id, dd, ret;
+
+	memset(&info, 0, sizeof(info));
+	len = sizeof(info);
+	ret = getsockopt(desc->fd, SOL_L2CAP, L2CAP_CONNINFO, &info, &len);
+	if (ret < 0) {
+		sr_dbg("Cannot get BLE connection handle: %s.",
+			g_strerror(errno));
+		return -1;
+	}
+
+	if (desc->local_addr[0]) {
+		id = hci_devid(desc->local_addr);
+	} else {
+		str2ba(desc->remote_addr, &mac);
+		id = hci_get_route(&mac);
+	}
+	if (id < 0)
+		return -1;
+	dd = hci_open_dev(id);
+	if (dd < 0)
+		return -1;
+
+	/*
+	 * Interval in units of 1.25ms (7.5ms to 4s), supervision timeout
+	 * in units of 10ms. The timeout must exceed twice the interval.
+	 */
+	interval = desc->conn_interval_ms * 4 / 5;
+	interval = CLAMP(interval, 6, 3200);
+	timeout = MAX(400, interval * 3 / 4);
+	ret = hci_le_conn_update(dd, htobs(info.hci_handle),
+		htobs(interval), htobs(interval), htobs(0), htobs(timeout),
+		BLE_CONN_UPDATE_TIMEOUT_MS);
+	hci_close_dev(dd);
+	if (ret < 0) {
+		sr_dbg("BLE connection interval update failed: %s.",
+			g_strerror(errno));
+		return -1;
+	}
+	sr_dbg("BLE connection interval %u.%02ums.",
+		interval * 5 / 4, (interval * 125) % 100);
+
+	return 0;
+}
+
+/*
+ * Propose a larger ATT MTU to the peripheral, so that it can send
+ * larger notifications. ATT allows one outstanding request, so wait
+ * for the response before the caller sends its next request. Other
+ * packets which arrive in the meantime get processed as usual.
+ */
+static int sr_bt_exchange_mtu(struct sr_bt_desc *desc)
+{
+	uint8_t buf[BLE_RX_PACKET_SIZE];
+	struct pollfd fds[1];
+	gint64 deadline, now;
+	ssize_t rdlen;
+	uint16_t mtu;
+	int ret;
+
+	if (sr_bt_write_type_handle(desc, BLE_ATT_EXCHANGE_MTU_REQ,
+			desc->att_mtu_req) < 0)
+		return -1;
+
+	deadline = g_get_monotonic_time();
+	deadline += BLE_MTU_EXCHANGE_TIMEOUT_MS * 1000;
+	while ((now = g_get_monotonic_time()) < deadline) {
+		memset(fds, 0, sizeof(fds));
+		fds[0].fd = desc->fd;
+		fds[0].events = POLLIN;
+		ret = poll(fds, ARRAY_SIZE(fds), (deadline - now) / 1000 + 1);
+		if (ret < 0)
+			return -1;
+		if (!ret || !(fds[0].revents & POLLIN))
+			continue;
+		rdlen = read(desc->fd, buf, sizeof(buf));
+		if (rdlen <= 0)
+			return -1;
+		if (buf[0] == BLE_ATT_ERROR_RESP) {
+			sr_dbg("BLE MTU exchange rejected.");
+			return -1;
+		}
+		if (buf[0] != BLE_ATT_EXCHANGE_MTU_RESP) {
+			(void)sr_bt_handle_packet(desc, buf, rdlen);
+			continue;
+		}
+		if (rdlen < 3)
+			return -1;
+		mtu = read_u16le(&buf[1]);
+		desc->att_mtu = MIN(mtu, desc->att_mtu_req);
+		sr_dbg("BLE ATT MTU %" PRIu16 ".", desc->att_mtu);
+		return 0;
+	}
+	sr_dbg("BLE MTU exchange timed out.");
+
+	return -1;
+}
+
 SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 {
 	struct sockaddr_l2 sl2;
 	bdaddr_t mac;
-	int s, ret;
+	int s, ret, rcvbuf;
 	gint64 deadline;
 
 	if (!desc)
@@ -692,6 +830,16 @@ SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 		return ret;
 	}
 
+	/*
+	 * Let the kernel queue bursts of notifications while the
+	 * application is busy. The default is rather small, and
+	 * excess packets get dropped silently.
+	 */
+	rcvbuf = BLE_RX_SOCK_BUF_SIZE;
+	ret = setsockopt(s, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if (ret < 0)
+		sr_dbg("Cannot set BLE socket receive buffer size.");
+
 	if (0) {
 		struct bt_security buf = {
 			.level = BT_SECURITY_LOW,
@@ -783,6 +931,12 @@ SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 		return ret;
 	}
 
+	/* Optional link tuning, failure is not fatal. */
+	if (desc->conn_interval_ms)
+		(void)sr_bt_request_conn_interval(desc);
+	if (desc->att_mtu_req)
+		(void)sr_bt_exchange_mtu(desc);
+
 	return 0;
 }
 
@@ -899,17 +1053,8 @@ SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc)
 
 SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 {
-	uint8_t buf[1024];
+	uint8_t buf[BLE_RX_PACKET_SIZE];
 	ssize_t rdlen;
-	const uint8_t *bufptr;
-	size_t buflen;
-	uint8_t packet_type;
-	uint16_t packet_handle;
-	uint8_t *packet_data;
-	size_t packet_dlen;
-	const char *type_text;
-	int ret;
-	uint16_t mtu;
 
 	if (!desc)
 		return -1;
@@ -918,11 +1063,8 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		return -2;
 
 	/*
-	 * Get another message from the Bluetooth socket.
-	 *
-	 * TODO Can we assume that every "message" comes in a separate
-	 * read(2) call, or can data combine at the caller's? Need we
-	 * loop over the received content until all was consumed?
+	 * Get another message from the Bluetooth socket. L2CAP is a
+	 * SEQPACKET socket, every read(2) call returns one ATT PDU.
 	 */
 	rdlen = sr_bt_read(desc, buf, sizeof(buf));
 	if (rdlen < 0) {
@@ -933,13 +1075,73 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		if (0) sr_spew("check notifiy, empty read");
 		return 0;
 	}
+
+	return sr_bt_handle_packet(desc, buf, rdlen);
+}
+
+/*
+ * Process all ATT PDUs which are pending at the socket, up to a caller
+ * specified count (zero is unlimited). Uses non-blocking socket reads
+ * without polling before each of them. Returns the number of processed
+ * PDUs, or a negative value upon errors.
+ */
+SR_PRIV int sr_bt_check_notify_batch(struct sr_bt_desc *desc, size_t max_count)
+{
+	uint8_t buf[BLE_RX_PACKET_SIZE];
+	ssize_t rdlen;
+	size_t count;
+	int ret;
+
+	if (!desc)
+		return -1;
+	if (desc->fd < 0)
+		return -1;
+
+	if (sr_bt_check_socket_usable(desc) < 0)
+		return -2;
+
+	count = 0;
+	while (!max_count || count < max_count) {
+		rdlen = recv(desc->fd, buf, sizeof(buf), MSG_DONTWAIT);
+		if (rdlen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (rdlen < 0 && errno == EINTR)
+			break;
+		if (rdlen < 0) {
+			sr_dbg("check notify batch, read error, %s",
+				g_strerror(errno));
+			return -2;
+		}
+		if (!rdlen)
+			break;
+		ret = sr_bt_handle_packet(desc, buf, rdlen);
+		if (ret < 0)
+			return ret;
+		count++;
+	}
+
+	return count;
+}
+
+/* Dispatch one received ATT PDU. */
+static int sr_bt_handle_packet(struct sr_bt_desc *desc,
+	uint8_t *buf, size_t buflen)
+{
+	const uint8_t *bufptr;
+	uint8_t packet_type;
+	uint16_t packet_handle;
+	uint8_t *packet_data;
+	size_t packet_dlen;
+	const char *type_text;
+	int ret;
+	uint16_t mtu;
+
 	bufptr = &buf[0];
-	buflen = (size_t)rdlen;
 	if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
 		GString *txt;
 		txt = sr_hexdump_new(bufptr, buflen);
-		sr_spew("check notifiy, read succes, length %zd, data: %s",
-			rdlen, txt->str);
+		sr_spew("check notifiy, read succes, length %zu, data: %s",
+			buflen, txt->str);
 		sr_hexdump_free(txt);
 	}
 
@@ -984,6 +1186,15 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		}
 		sr_warn("Unhandled BLE %s.", type_text);
 		break;
+	case BLE_ATT_EXCHANGE_MTU_RESP:
+		type_text = "MTU exchange response";
+		if (buflen < sizeof(uint16_t)) {
+			sr_dbg("%s, invalid (size)", type_text);
+			break;
+		}
+		mtu = read_u16le_inc_len(&bufptr, &buflen);
+		sr_dbg("%s, late, peripheral value %" PRIu16, type_text, mtu);
+		break;
 	case BLE_ATT_ERROR_RESP:
 		type_text = "error response";
 		if (!buflen) {
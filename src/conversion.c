@@ -23,6 +23,9 @@
  * Conversion helper functions.
  */
 
+#include <config.h>
+#include <math.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -30,6 +33,235 @@
 #define LOG_PREFIX "conv"
 /** @endcond */
 
+/*
+ * The converters process the input in blocks, which live on the stack.
+ * Integer input is compared in its raw encoding against thresholds
+ * which were converted to the raw domain once, so no sample needs to be
+ * scaled. Floating point input gets converted to float block by block.
+ * The results get stored either as one byte per sample, or as a bit in
+ * the samples of a logic buffer.
+ */
+#define A2L_BLOCK	256
+
+/* A condition on input values, as an inclusive range of raw values. */
+struct a2l_range {
+	int64_t lo;
+	int64_t hi;
+};
+
+enum a2l_cmp {
+	A2L_GE,
+	A2L_GT,
+	A2L_LT,
+};
+
+struct a2l_ctx {
+	const struct sr_datafeed_analog *analog;
+	gboolean raw;
+	double scale, offset;
+	/* Output: one byte per sample, or a bit of logic samples. */
+	uint8_t *output;
+	uint16_t unitsize;
+	unsigned int bit;
+};
+
+static int64_t a2l_clamp(double v)
+{
+	if (v >= (double)INT64_MAX)
+		return INT64_MAX;
+	if (v <= (double)INT64_MIN)
+		return INT64_MIN;
+
+	return (int64_t)v;
+}
+
+/*
+ * Get the range of raw values for which (raw * scale + offset) compares
+ * to thr as requested. A negative scale flips the direction.
+ */
+static struct a2l_range a2l_raw_range(double scale, double offset,
+		double thr, enum a2l_cmp cmp)
+{
+	struct a2l_range r;
+	double x;
+	gboolean above;
+
+	r.lo = INT64_MIN;
+	r.hi = INT64_MAX;
+	if (scale == 0.0) {
+		if ((cmp == A2L_GE && !(offset >= thr))
+				|| (cmp == A2L_GT && !(offset > thr))
+				|| (cmp == A2L_LT && !(offset < thr))) {
+			r.lo = INT64_MAX;
+			r.hi = INT64_MIN;
+		}
+		return r;
+	}
+
+	x = (thr - offset) / scale;
+	if (isnan(x)) {
+		r.lo = INT64_MAX;
+		r.hi = INT64_MIN;
+		return r;
+	}
+	above = (cmp != A2L_LT) == (scale > 0);
+	if (above) {
+		/* raw >= x (or raw > x). */
+		if (cmp == A2L_GE)
+			r.lo = a2l_clamp(ceil(x));
+		else
+			r.lo = a2l_clamp(floor(x) + 1);
+	} else {
+		/* raw <= x (or raw < x). */
+		if (cmp == A2L_GE && scale < 0)
+			r.hi = a2l_clamp(floor(x));
+		else
+			r.hi = a2l_clamp(ceil(x) - 1);
+	}
+
+	return r;
+}
+
+static int a2l_init(struct a2l_ctx *ctx, const struct sr_datafeed_analog *analog,
+		uint8_t *output, uint16_t unitsize, unsigned int bit)
+{
+	const struct sr_analog_encoding *enc;
+
+	if (!analog || !analog->data || !analog->encoding || !output)
+		return SR_ERR_ARG;
+	if (unitsize && bit >= 8U * unitsize)
+		return SR_ERR_ARG;
+
+	enc = analog->encoding;
+	ctx->analog = analog;
+	ctx->raw = sr_analog_raw_supported(enc);
+	if (!enc->is_float && !ctx->raw)
+		return SR_ERR;
+	ctx->scale = (double)enc->scale.p / enc->scale.q;
+	ctx->offset = (double)enc->offset.p / enc->offset.q;
+	ctx->output = output;
+	ctx->unitsize = unitsize;
+	ctx->bit = bit;
+
+	return SR_OK;
+}
+
+/* Store a block of results, starting at sample pos. */
+static void a2l_store(const struct a2l_ctx *ctx, uint64_t pos,
+		const uint8_t *bits, size_t n)
+{
+	uint8_t *p, mask;
+	size_t i;
+
+	if (!ctx->unitsize) {
+		memcpy(ctx->output + pos, bits, n);
+		return;
+	}
+
+	p = ctx->output + pos * ctx->unitsize + ctx->bit / 8;
+	mask = 1 << (ctx->bit % 8);
+	for (i = 0; i < n; i++, p += ctx->unitsize)
+		*p = bits[i] ? (*p | mask) : (*p & ~mask);
+}
+
+static int a2l_threshold(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, uint16_t unitsize,
+		unsigned int bit, uint64_t count)
+{
+	struct a2l_ctx ctx;
+	struct a2l_range r;
+	int64_t raw[A2L_BLOCK];
+	float values[A2L_BLOCK];
+	uint8_t bits[A2L_BLOCK];
+	const uint8_t *data;
+	uint64_t pos;
+	size_t n, i;
+	int ret;
+
+	if ((ret = a2l_init(&ctx, analog, output, unitsize, bit)) != SR_OK)
+		return ret;
+
+	data = analog->data;
+	r = a2l_raw_range(ctx.scale, ctx.offset, threshold, A2L_GE);
+	for (pos = 0; pos < count; pos += n) {
+		n = MIN(count - pos, A2L_BLOCK);
+		if (ctx.raw) {
+			sr_analog_raw_load(analog->encoding,
+				data + pos * analog->encoding->unitsize,
+				analog->encoding->unitsize, n, raw);
+			for (i = 0; i < n; i++)
+				bits[i] = raw[i] >= r.lo && raw[i] <= r.hi;
+		} else {
+			ret = sr_analog_to_float_range(analog, pos, pos + n,
+				values, 1);
+			if (ret != SR_OK)
+				return ret;
+			for (i = 0; i < n; i++)
+				bits[i] = values[i] >= threshold;
+		}
+		a2l_store(&ctx, pos, bits, n);
+	}
+
+	return SR_OK;
+}
+
+static int a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		uint16_t unitsize, unsigned int bit, uint64_t count)
+{
+	struct a2l_ctx ctx;
+	struct a2l_range r0, r1;
+	int64_t raw[A2L_BLOCK];
+	float values[A2L_BLOCK];
+	uint8_t bits[A2L_BLOCK];
+	const uint8_t *data;
+	uint64_t pos;
+	size_t n, i;
+	uint8_t cur;
+	int ret;
+
+	if (!state)
+		return SR_ERR_ARG;
+	if ((ret = a2l_init(&ctx, analog, output, unitsize, bit)) != SR_OK)
+		return ret;
+
+	data = analog->data;
+	r0 = a2l_raw_range(ctx.scale, ctx.offset, lo_thr, A2L_LT);
+	r1 = a2l_raw_range(ctx.scale, ctx.offset, hi_thr, A2L_GT);
+	cur = *state;
+	for (pos = 0; pos < count; pos += n) {
+		n = MIN(count - pos, A2L_BLOCK);
+		if (ctx.raw) {
+			sr_analog_raw_load(analog->encoding,
+				data + pos * analog->encoding->unitsize,
+				analog->encoding->unitsize, n, raw);
+			for (i = 0; i < n; i++) {
+				if (raw[i] >= r0.lo && raw[i] <= r0.hi)
+					cur = 0;
+				else if (raw[i] >= r1.lo && raw[i] <= r1.hi)
+					cur = 1;
+				bits[i] = cur;
+			}
+		} else {
+			ret = sr_analog_to_float_range(analog, pos, pos + n,
+				values, 1);
+			if (ret != SR_OK)
+				return ret;
+			for (i = 0; i < n; i++) {
+				if (values[i] < lo_thr)
+					cur = 0;
+				else if (values[i] > hi_thr)
+					cur = 1;
+				bits[i] = cur;
+			}
+		}
+		a2l_store(&ctx, pos, bits, n);
+	}
+	*state = cur;
+
+	return SR_OK;
+}
+
 /**
  * Convert analog values to logic values by using a fixed threshold.
  *
@@ -44,24 +276,7 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
-
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
-
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
-
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
-
-	if (!analog->encoding->is_float)
-		g_free(input);
-
-	return SR_OK;
+	return a2l_threshold(analog, threshold, output, 0, 0, count);
 }
 
 /**
@@ -82,28 +297,307 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	return a2l_schmitt_trigger(analog, lo_thr, hi_thr, state, output,
+		0, 0, count);
+}
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+/**
+ * Convert analog values to a logic channel by using a fixed threshold.
+ *
+ * Like sr_a2l_threshold(), but stores the results as a bit of logic
+ * samples, ready for an SR_DF_LOGIC packet. Other bits of the logic
+ * samples are left untouched, so that several analog channels can be
+ * converted into the same logic buffer.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] threshold The threshold to use.
+ * @param[in,out] logic The logic samples. Must provide space for count
+ *                      samples of unitsize bytes.
+ * @param[in] unitsize The logic samples' size in bytes. Must not be 0.
+ * @param[in] bit The bit to store the results in, below 8 * unitsize.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_logic(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *logic, uint16_t unitsize,
+		unsigned int bit, uint64_t count)
+{
+	if (!unitsize)
+		return SR_ERR_ARG;
+
+	return a2l_threshold(analog, threshold, logic, unitsize, bit, count);
+}
+
+/**
+ * Convert analog values to a logic channel by using a Schmitt-trigger
+ * algorithm.
+ *
+ * Like sr_a2l_schmitt_trigger(), but stores the results as a bit of
+ * logic samples, see sr_a2l_threshold_logic().
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in,out] state The internal converter state, see
+ *                      sr_a2l_schmitt_trigger().
+ * @param[in,out] logic The logic samples. Must provide space for count
+ *                      samples of unitsize bytes.
+ * @param[in] unitsize The logic samples' size in bytes. Must not be 0.
+ * @param[in] bit The bit to store the results in, below 8 * unitsize.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_logic(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *logic,
+		uint16_t unitsize, unsigned int bit, uint64_t count)
+{
+	if (!unitsize)
+		return SR_ERR_ARG;
+
+	return a2l_schmitt_trigger(analog, lo_thr, hi_thr, state, logic,
+		unitsize, bit, count);
+}
+
+/*
+ * Unit size conversion for a pair of constant unit sizes. The constant
+ * sizes let the compiler turn the copies into plain loads and stores,
+ * and vectorize the loop.
+ */
+#define UNITSIZE_CONVERT(IN, OUT) \
+	case ((IN) << 4) | (OUT): \
+		for (i = 0; i < count; i++) { \
+			memcpy(&out[i * (OUT)], &in[i * (IN)], MIN(IN, OUT)); \
+			if ((OUT) > (IN)) \
+				memset(&out[i * (OUT) + MIN(IN, OUT)], 0, \
+					(OUT) - MIN(IN, OUT)); \
+		} \
+		return;
+
+/**
+ * Convert logic samples to a different unit size.
+ *
+ * Logic samples are little endian, the first byte holds the first eight
+ * channels. Narrowing discards the excess bytes of each sample, widening
+ * pads samples with zero bytes.
+ *
+ * @param[in] in The input samples.
+ * @param[in] in_unitsize The input samples' size in bytes.
+ * @param[out] out The output samples. Must not overlap with the input.
+ * @param[in] out_unitsize The output samples' size in bytes.
+ * @param[in] count The number of samples to convert.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_unitsize_convert(const uint8_t *in, size_t in_unitsize,
+		uint8_t *out, size_t out_unitsize, size_t count)
+{
+	size_t i, copy;
+
+	if (in_unitsize == out_unitsize) {
+		memcpy(out, in, count * in_unitsize);
+		return;
+	}
+
+	if (in_unitsize <= 8 && out_unitsize <= 8) {
+		switch ((in_unitsize << 4) | out_unitsize) {
+		UNITSIZE_CONVERT(1, 2)
+		UNITSIZE_CONVERT(1, 4)
+		UNITSIZE_CONVERT(1, 8)
+		UNITSIZE_CONVERT(2, 1)
+		UNITSIZE_CONVERT(2, 4)
+		UNITSIZE_CONVERT(2, 8)
+		UNITSIZE_CONVERT(4, 1)
+		UNITSIZE_CONVERT(4, 2)
+		UNITSIZE_CONVERT(4, 8)
+		UNITSIZE_CONVERT(8, 1)
+		UNITSIZE_CONVERT(8, 2)
+		UNITSIZE_CONVERT(8, 4)
+		}
+	}
+
+	copy = MIN(in_unitsize, out_unitsize);
+	for (i = 0; i < count; i++) {
+		memcpy(&out[i * out_unitsize], &in[i * in_unitsize], copy);
+		memset(&out[i * out_unitsize + copy], 0, out_unitsize - copy);
+	}
+}
+
+/**
+ * Expand run length encoded logic data into plain samples.
+ *
+ * Expansion can be split across several calls, the run index and the
+ * offset within that run track the position in the runs. Both start
+ * at 0 for the first sample of the payload.
+ *
+ * @param[in] runs The SR_DF_LOGIC_RUNS payload.
+ * @param[in,out] run The index of the run to continue with.
+ * @param[in,out] offset The number of samples of that run already expanded.
+ * @param[out] out Buffer for count samples of runs->unitsize bytes.
+ * @param[in] count The maximum number of samples to expand.
+ *
+ * @return The number of samples written to out, 0 when all runs were
+ *         expanded or on invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_runs_expand(const struct sr_datafeed_logic_runs *runs,
+		uint64_t *run, uint64_t *offset, uint8_t *out, uint64_t count)
+{
+	const uint8_t *value;
+	uint64_t done, len, i;
+	uint16_t unitsize;
+
+	if (!runs || !run || !offset || !out)
+		return 0;
+
+	unitsize = runs->unitsize;
+	done = 0;
+	while (done < count && *run < runs->num_runs) {
+		len = runs->lengths[*run] - *offset;
+		len = MIN(len, count - done);
+		value = (const uint8_t *)runs->data + *run * unitsize;
+		if (unitsize == 1) {
+			memset(out, value[0], len);
+		} else {
+			for (i = 0; i < len; i++)
+				memcpy(&out[i * unitsize], value, unitsize);
+		}
+		out += len * unitsize;
+		done += len;
+		*offset += len;
+		if (*offset == runs->lengths[*run]) {
+			(*run)++;
+			*offset = 0;
+		}
+	}
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	return done;
+}
 
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+/**
+ * Convert bit planar logic data into plain samples.
+ *
+ * Each block's words get transposed in pieces of 8x8 bits, instead of
+ * testing every single bit.
+ *
+ * @param[in] planar The SR_DF_LOGIC_PLANAR payload.
+ * @param[out] out Buffer for planar->num_blocks * 32 samples of
+ *                 planar->unitsize bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_planar_to_logic(const struct sr_datafeed_logic_planar *planar,
+		uint8_t *out)
+{
+	const uint32_t *block;
+	uint32_t rows[8];
+	uint64_t blk, x;
+	uint16_t unitsize, grp;
+	unsigned int plane, quad, r, b;
+	uint8_t row_byte;
 
-		output[i] = *state;
+	if (!planar || !out || !planar->unitsize)
+		return SR_ERR_ARG;
+	if (planar->num_planes && (!planar->plane_bits || !planar->data))
+		return SR_ERR_ARG;
+	unitsize = planar->unitsize;
+	for (plane = 0; plane < planar->num_planes; plane++) {
+		if (planar->plane_bits[plane] >= unitsize * 8)
+			return SR_ERR_ARG;
 	}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+	for (blk = 0; blk < planar->num_blocks; blk++) {
+		block = &planar->data[blk * planar->num_planes];
+		for (grp = 0; grp < unitsize; grp++) {
+			/* Row r holds the samples of the group's channel r. */
+			memset(rows, 0, sizeof(rows));
+			for (plane = 0; plane < planar->num_planes; plane++) {
+				if (planar->plane_bits[plane] / 8 != grp)
+					continue;
+				rows[planar->plane_bits[plane] % 8] = block[plane];
+			}
+			for (quad = 0; quad < 4; quad++) {
+				/* Byte r holds 8 samples of channel r. */
+				x = 0;
+				for (r = 0; r < 8; r++) {
+					row_byte = rows[r] >> (24 - 8 * quad);
+					x |= (uint64_t)row_byte << (8 * r);
+				}
+				x = sr_bit_transpose_8x8(x);
+				/* Byte b holds 8 channels of sample quad * 8 + 7 - b. */
+				for (b = 0; b < 8; b++)
+					out[(quad * 8 + 7 - b) * unitsize + grp] = x >> (8 * b);
+			}
+		}
+		out += 32 * unitsize;
+	}
 
 	return SR_OK;
 }
+
+/**
+ * Convert 64bit bit planes into plain samples.
+ *
+ * Each block holds one little endian 64bit word per plane, the word's
+ * LSB is the block's first sample. Like sr_logic_planar_to_logic(),
+ * the words get transposed in pieces of 8x8 bits.
+ *
+ * @param[in] src The blocks of num_planes words each.
+ * @param[in] num_blocks The number of blocks.
+ * @param[in] num_planes The number of words per block.
+ * @param[in] plane_bits The sample bit of each plane, less than unitsize * 8.
+ * @param[out] out Buffer for num_blocks * 64 samples of unitsize bytes.
+ *                 Bits which no plane maps to are zero.
+ * @param[in] unitsize The sample width in bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_bit_planes64_to_logic(const uint8_t *src, size_t num_blocks,
+		size_t num_planes, const uint8_t *plane_bits,
+		uint8_t *out, size_t unitsize)
+{
+	uint64_t rows[8], x;
+	size_t blk, grp, plane;
+	unsigned int oct, r, b;
+
+	for (blk = 0; blk < num_blocks; blk++) {
+		for (grp = 0; grp < unitsize; grp++) {
+			/* Row r holds the samples of the group's channel r. */
+			memset(rows, 0, sizeof(rows));
+			for (plane = 0; plane < num_planes; plane++) {
+				if (plane_bits[plane] / 8 != grp)
+					continue;
+				rows[plane_bits[plane] % 8] = RL64(&src[8 * plane]);
+			}
+			for (oct = 0; oct < 8; oct++) {
+				/* Byte r holds 8 samples of channel r. */
+				x = 0;
+				for (r = 0; r < 8; r++)
+					x |= ((rows[r] >> (8 * oct)) & 0xff) << (8 * r);
+				x = sr_bit_transpose_8x8(x);
+				/* Byte b holds 8 channels of sample oct * 8 + b. */
+				if (unitsize == 1) {
+					WL64(&out[oct * 8], x);
+					continue;
+				}
+				for (b = 0; b < 8; b++)
+					out[(oct * 8 + b) * unitsize + grp] = x >> (8 * b);
+			}
+		}
+		src += 8 * num_planes;
+		out += 64 * unitsize;
+	}
+}
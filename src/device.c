@@ -527,6 +527,8 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	g_free(sdi->version);
 	g_free(sdi->serial_num);
 	g_free(sdi->connection_id);
+	if (sdi->applied)
+		g_hash_table_destroy(sdi->applied);
 	g_free(sdi);
 }
 
@@ -740,8 +742,11 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 
 	ret = sdi->driver->dev_open(sdi);
 
-	if (ret == SR_OK)
+	if (ret == SR_OK) {
 		sdi->status = SR_ST_ACTIVE;
+		/* Nothing is known about the device's state yet. */
+		sr_dev_config_reapply(sdi);
+	}
 
 	return ret;
 }
@@ -777,12 +782,134 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 	}
 
 	sdi->status = SR_ST_INACTIVE;
+	sr_dev_config_reapply(sdi);
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
 	return sdi->driver->dev_close(sdi);
 }
 
+/**
+ * Have the next acquisition start apply the device's full configuration.
+ *
+ * Drivers remember the settings which they applied to the device, and
+ * only send the settings which changed since, when an acquisition
+ * starts. Changes which are made on the device itself, like on the
+ * front panel of a scope, go unnoticed though. This forgets about the
+ * applied settings, so that all of them get sent again.
+ *
+ * @param sdi Device instance to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_config_reapply(struct sr_dev_inst *sdi)
+{
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	if (sdi->applied)
+		g_hash_table_remove_all(sdi->applied);
+
+	return SR_OK;
+}
+
+/**
+ * Check whether a setting differs from the one last applied to a device.
+ *
+ * @param sdi Device instance to use. Must not be NULL.
+ * @param key The setting's name, unique within the driver.
+ * @param value The setting's value, as it is sent to the device.
+ * @param size The value's size in bytes.
+ *
+ * @return TRUE when the setting must be sent to the device.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_dev_setting_changed(const struct sr_dev_inst *sdi,
+	const char *key, const void *value, size_t size)
+{
+	GBytes *applied;
+
+	if (!sdi->applied)
+		return TRUE;
+
+	applied = g_hash_table_lookup(sdi->applied, key);
+	if (!applied || g_bytes_get_size(applied) != size)
+		return TRUE;
+
+	return memcmp(g_bytes_get_data(applied, NULL), value, size) != 0;
+}
+
+/**
+ * Remember a setting which was successfully applied to a device.
+ *
+ * @param sdi Device instance to use. Must not be NULL.
+ * @param key The setting's name, unique within the driver.
+ * @param value The setting's value, as it was sent to the device.
+ * @param size The value's size in bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_setting_applied(const struct sr_dev_inst *sdi,
+	const char *key, const void *value, size_t size)
+{
+	struct sr_dev_inst *inst;
+
+	/* Bookkeeping only, the device instance itself is unchanged. */
+	inst = (struct sr_dev_inst *)sdi;
+	if (!inst->applied)
+		inst->applied = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)g_bytes_unref);
+
+	g_hash_table_replace(inst->applied, g_strdup(key),
+		g_bytes_new(value, size));
+}
+
+/* The header of a command is the setting's key, up to the first space. */
+static char *command_key(const char *command)
+{
+	return g_strndup(command, strcspn(command, " "));
+}
+
+/**
+ * Check whether a textual (e.g. SCPI) command which changes a setting
+ * must be sent to a device, see sr_dev_setting_changed(). The command's
+ * header is the key of the setting, its arguments are the value.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_dev_command_changed(const struct sr_dev_inst *sdi,
+	const char *command)
+{
+	char *key;
+	gboolean changed;
+
+	key = command_key(command);
+	changed = sr_dev_setting_changed(sdi, key, command, strlen(command));
+	g_free(key);
+
+	return changed;
+}
+
+/**
+ * Remember a textual command which was successfully sent to a device,
+ * see sr_dev_command_changed().
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_command_applied(const struct sr_dev_inst *sdi,
+	const char *command)
+{
+	char *key;
+
+	key = command_key(command);
+	sr_dev_setting_applied(sdi, key, command, strlen(command));
+	g_free(key);
+}
+
 /**
  * Queries a device instances' driver.
  *
@@ -902,7 +1029,7 @@ SR_API const char *sr_dev_inst_connid_get(const struct sr_dev_inst *sdi)
 		drvc = sdi->driver->context;
 		usb = sdi->conn;
 
-		if ((cnt = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist)) < 0) {
+		if ((cnt = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist)) < 0) {
 			sr_err("Failed to retrieve device list: %s.",
 			       libusb_error_name(cnt));
 			return NULL;
@@ -33,8 +33,13 @@
 
 #define LOG_PREFIX "ezusb"
 
+/* Larger control transfers get rejected by Linux usbfs. */
 #define FW_CHUNKSIZE (4 * 1024)
 
+/* Retry interval without USB hotplug support, and as a fallback with it. */
+#define RENUM_POLL_US (100 * 1000)
+#define RENUM_POLL_HOTPLUG_US (500 * 1000)
+
 SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear)
 {
 	int ret;
@@ -85,7 +90,7 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 			g_free(firmware);
 			return SR_ERR;
 		}
-		sr_info("Uploaded %zu bytes.", chunksize);
+		sr_spew("Uploaded %zu bytes.", chunksize);
 		offset += chunksize;
 	}
 	g_free(firmware);
@@ -142,3 +147,125 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 
 	return SR_OK;
 }
+
+static int LIBUSB_CALL renum_hotplug_cb(libusb_context *usb_ctx,
+	libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	(void)usb_ctx;
+	(void)dev;
+	(void)event;
+
+	g_atomic_int_inc((gint *)user_data);
+
+	return 0;
+}
+
+/*
+ * Wait until any USB device arrives, or the timeout expires. Waits
+ * the full timeout when there is no hotplug support.
+ */
+static void renum_wait(libusb_context *usb_ctx, gint *arrivals,
+	int64_t timeout_us)
+{
+	struct timeval tv;
+	int64_t until, now;
+	gint seen;
+
+	if (!usb_ctx) {
+		g_usleep(timeout_us);
+		return;
+	}
+
+	seen = g_atomic_int_get(arrivals);
+	until = g_get_monotonic_time() + timeout_us;
+	while ((now = g_get_monotonic_time()) < until) {
+		tv.tv_sec = (until - now) / G_USEC_PER_SEC;
+		tv.tv_usec = (until - now) % G_USEC_PER_SEC;
+		if (libusb_handle_events_timeout_completed(usb_ctx, &tv, NULL) < 0)
+			break;
+		if (g_atomic_int_get(arrivals) != seen)
+			break;
+	}
+}
+
+/**
+ * Wait for an FX2 to renumerate after its firmware was uploaded, and
+ * open it.
+ *
+ * The device gets opened as soon as it can be, attempts are made when
+ * USB devices arrive. Platforms without USB hotplug support get polled.
+ *
+ * @param sdi The device instance.
+ * @param fw_updated The monotonic time of the firmware upload.
+ * @param gone_ms How long after the upload the device is gone from the bus.
+ * @param max_delay_ms How long after the upload to give up.
+ * @param open_cb Opens the device, returns SR_OK when it has renumerated.
+ *
+ * @return The last result of @a open_cb.
+ *
+ * @private
+ */
+SR_PRIV int ezusb_wait_renum(struct sr_dev_inst *sdi, int64_t fw_updated,
+	int gone_ms, int max_delay_ms, int (*open_cb)(struct sr_dev_inst *sdi))
+{
+	libusb_context *usb_ctx;
+	libusb_hotplug_callback_handle handle;
+	int64_t now, gone, deadline, poll_us;
+	gint arrivals;
+	int ret;
+
+	sr_info("Waiting for device to reset.");
+
+	/*
+	 * Arrivals get watched on a private context. Handling its events
+	 * won't run transfer callbacks of other devices.
+	 */
+	usb_ctx = NULL;
+	arrivals = 0;
+	poll_us = RENUM_POLL_US;
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)
+			&& libusb_init(&usb_ctx) == LIBUSB_SUCCESS) {
+		ret = libusb_hotplug_register_callback(usb_ctx,
+			LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, 0,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, renum_hotplug_cb, &arrivals,
+			&handle);
+		if (ret == LIBUSB_SUCCESS) {
+			poll_us = RENUM_POLL_HOTPLUG_US;
+		} else {
+			libusb_exit(usb_ctx);
+			usb_ctx = NULL;
+		}
+	}
+
+	/* Don't open the device before it went away. */
+	now = g_get_monotonic_time();
+	gone = fw_updated + (int64_t)gone_ms * 1000;
+	if (now < gone)
+		g_usleep(gone - now);
+
+	deadline = fw_updated + (int64_t)max_delay_ms * 1000;
+	while (TRUE) {
+		if ((ret = open_cb(sdi)) == SR_OK)
+			break;
+		now = g_get_monotonic_time();
+		sr_spew("Waited %" PRIi64 "ms.", (now - fw_updated) / 1000);
+		if (now >= deadline)
+			break;
+		renum_wait(usb_ctx, &arrivals, MIN(poll_us, deadline - now));
+	}
+
+	if (usb_ctx) {
+		libusb_hotplug_deregister_callback(usb_ctx, handle);
+		libusb_exit(usb_ctx);
+	}
+
+	if (ret != SR_OK) {
+		sr_err("Device failed to renumerate.");
+		return ret;
+	}
+	sr_info("Device came back after %" PRIi64 "ms.",
+		(g_get_monotonic_time() - fw_updated) / 1000);
+
+	return SR_OK;
+}
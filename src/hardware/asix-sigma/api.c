@@ -155,7 +155,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all ASIX logic analyzers (which match the connection spec). */
 	devices = NULL;
-	libusb_get_device_list(usbctx, &devlist);
+	sr_usb_get_device_list(usbctx, &devlist);
 	for (devidx = 0; devlist[devidx]; devidx++) {
 		devitem = devlist[devidx];
 
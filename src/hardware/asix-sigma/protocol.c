@@ -1260,34 +1260,76 @@ static int flush_submit_buffer(struct dev_context *devc)
 	return SR_OK;
 }
 
+/*
+ * Get how many of the given number of samples may still get submitted.
+ * User specified limits are enforced exactly, unless triggers are used.
+ */
+static size_t submit_limit_count(struct dev_context *devc, size_t count)
+{
+	struct sr_sw_limits *limits;
+
+	limits = &devc->limit.submit;
+	if (devc->use_triggers || !limits->limit_samples)
+		return count;
+	if (limits->samples_read >= limits->limit_samples)
+		return 0;
+
+	return MIN(count, limits->limit_samples - limits->samples_read);
+}
+
 static int addto_submit_buffer(struct dev_context *devc,
 	uint16_t sample, size_t count)
 {
 	struct submit_buffer *buffer;
-	struct sr_sw_limits *limits;
+	size_t chunk, idx;
 	int ret;
 
 	buffer = devc->buffer;
-	limits = &devc->limit.submit;
-	if (!devc->use_triggers && sr_sw_limits_check(limits))
-		count = 0;
+	count = submit_limit_count(devc, count);
 
 	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
+	 * Accumulate as many samples as fit in local storage, flush
+	 * when it is full.
 	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
+	while (count) {
+		chunk = MIN(count, buffer->max_samples - buffer->curr_samples);
+		for (idx = 0; idx < chunk; idx++)
+			write_u16le_inc(&buffer->write_pointer, sample);
+		buffer->curr_samples += chunk;
+		count -= chunk;
+		sr_sw_limits_update_samples_read(&devc->limit.submit, chunk);
+		if (buffer->curr_samples == buffer->max_samples) {
+			ret = flush_submit_buffer(devc);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int addto_submit_buffer_many(struct dev_context *devc,
+	const uint16_t *samples, size_t count)
+{
+	struct submit_buffer *buffer;
+	size_t chunk, idx;
+	int ret;
+
+	buffer = devc->buffer;
+	count = submit_limit_count(devc, count);
+
+	while (count) {
+		chunk = MIN(count, buffer->max_samples - buffer->curr_samples);
+		for (idx = 0; idx < chunk; idx++)
+			write_u16le_inc(&buffer->write_pointer, *samples++);
+		buffer->curr_samples += chunk;
+		count -= chunk;
+		sr_sw_limits_update_samples_read(&devc->limit.submit, chunk);
 		if (buffer->curr_samples == buffer->max_samples) {
 			ret = flush_submit_buffer(devc);
 			if (ret != SR_OK)
 				return ret;
 		}
-		sr_sw_limits_update_samples_read(limits, 1);
-		if (!devc->use_triggers && sr_sw_limits_check(limits))
-			break;
 	}
 
 	return SR_OK;
@@ -1679,44 +1721,67 @@ SR_PRIV int sigma_convert_trigger(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static gboolean sample_matches_trigger(struct dev_context *devc, uint16_t sample)
+/*
+ * Compile the trigger condition into masks and values for the current
+ * and the previous sample. A level must be seen in the current sample,
+ * an edge needs the opposite level in the previous sample. Unused
+ * trigger features remain neutral, their mask bits are clear.
+ */
+static void sigma_trigger_compile(struct dev_context *devc)
 {
-	struct sigma_sample_interp *interp;
-	uint16_t last_sample;
 	struct sigma_trigger *t;
-	gboolean simple_match, rising_match, falling_match;
-	gboolean matched;
+	struct sigma_sample_interp *interp;
 
-	/*
-	 * This logic is about improving the precision of the hardware
-	 * provided trigger match position. Software checks are only
-	 * required for a short range of samples, and only when a user
-	 * specified trigger condition was involved during acquisition.
-	 */
-	if (!devc)
-		return FALSE;
-	if (!devc->use_triggers)
-		return FALSE;
+	t = &devc->trigger;
+	interp = &devc->interp;
+	interp->trig_chk.curr_mask = t->simplemask | t->risingmask | t->fallingmask;
+	interp->trig_chk.curr_value = t->simplevalue | t->risingmask;
+	interp->trig_chk.curr_value &= ~t->fallingmask;
+	interp->trig_chk.prev_mask = t->risingmask | t->fallingmask;
+	interp->trig_chk.prev_value = t->fallingmask;
+}
+
+/*
+ * Find the first of a block of samples which matches the trigger,
+ * given the sample which precedes the block. Returns the match's
+ * index, or the block's length when none matched.
+ *
+ * This logic is about improving the precision of the hardware
+ * provided trigger match position. Software checks are only
+ * required for a short range of samples, and only when a user
+ * specified trigger condition was involved during acquisition.
+ */
+static size_t sigma_trigger_scan(struct dev_context *devc,
+	const uint16_t *samples, size_t count, uint16_t prev)
+{
+	struct sigma_sample_interp *interp;
+	uint16_t curr_mask, curr_value, prev_mask, prev_value;
+	size_t idx;
+
+	if (!devc || !devc->use_triggers)
+		return count;
 	interp = &devc->interp;
 	if (!interp->trig_chk.armed)
-		return FALSE;
+		return count;
+
+	curr_mask = interp->trig_chk.curr_mask;
+	curr_value = interp->trig_chk.curr_value;
+	prev_mask = interp->trig_chk.prev_mask;
+	prev_value = interp->trig_chk.prev_value;
+	for (idx = 0; idx < count; idx++) {
+		if ((samples[idx] & curr_mask) == curr_value &&
+				(prev & prev_mask) == prev_value)
+			return idx;
+		prev = samples[idx];
+	}
 
-	/*
-	 * Check if the current sample and its most recent transition
-	 * match the initially provided trigger condition. The data
-	 * must not fail either of the individual checks. Unused
-	 * trigger features remain neutral in the summary expression.
-	 */
-	last_sample = interp->last.sample;
-	t = &devc->trigger;
-	simple_match = (sample & t->simplemask) == t->simplevalue;
-	rising_match = ((last_sample & t->risingmask) == 0) &&
-			((sample & t->risingmask) == t->risingmask);
-	falling_match = ((last_sample & t->fallingmask) == t->fallingmask) &&
-			((sample & t->fallingmask) == 0);
-	matched = simple_match && rising_match && falling_match;
+	return count;
+}
 
-	return matched;
+static gboolean sample_matches_trigger(struct dev_context *devc, uint16_t sample)
+{
+	return sigma_trigger_scan(devc, &sample, 1,
+		devc->interp.last.sample) == 0;
 }
 
 static int send_trigger_marker(struct dev_context *devc)
@@ -1752,6 +1817,38 @@ static int check_and_submit_sample(struct dev_context *devc,
 	return SR_OK;
 }
 
+/*
+ * Submit a block of samples which may contain the trigger position.
+ * The marker goes in front of the first match.
+ */
+static int check_and_submit_samples(struct dev_context *devc,
+	const uint16_t *samples, size_t count)
+{
+	size_t idx;
+	int ret;
+
+	if (!count)
+		return SR_OK;
+
+	idx = count;
+	if (!devc->interp.trig_chk.matched)
+		idx = sigma_trigger_scan(devc, samples, count,
+			devc->interp.last.sample);
+	devc->interp.last.sample = samples[count - 1];
+	if (idx == count)
+		return addto_submit_buffer_many(devc, samples, count);
+
+	ret = addto_submit_buffer_many(devc, samples, idx);
+	if (ret != SR_OK)
+		return ret;
+	ret = send_trigger_marker(devc);
+	if (ret != SR_OK)
+		return ret;
+	devc->interp.trig_chk.matched = TRUE;
+
+	return addto_submit_buffer_many(devc, &samples[idx], count - idx);
+}
+
 static void sigma_location_check(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
@@ -1808,6 +1905,26 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 	return read_u16le((const uint8_t *)&cl->samples[idx]);
 }
 
+/*
+ * Deinterlacing lookup tables. A byte of sample memory holds four bits
+ * (2x8 layout) or two bits (4x4 layout) of one sample, every second or
+ * fourth bit. The tables compact these bits, two lookups per sample
+ * replace the shift cascade.
+ */
+#define DEINT_2X8(b)	(((b) & 1) | (((b) >> 1) & 2) | \
+			(((b) >> 2) & 4) | (((b) >> 3) & 8))
+#define DEINT_4X4(b)	(((b) & 1) | (((b) >> 3) & 2))
+#define DEINT_R2(f, n)	f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define DEINT_R4(f, n)	DEINT_R2(f, n), DEINT_R2(f, (n) + 4), \
+			DEINT_R2(f, (n) + 8), DEINT_R2(f, (n) + 12)
+#define DEINT_R6(f, n)	DEINT_R4(f, n), DEINT_R4(f, (n) + 16), \
+			DEINT_R4(f, (n) + 32), DEINT_R4(f, (n) + 48)
+#define DEINT_R8(f)	DEINT_R6(f, 0), DEINT_R6(f, 64), \
+			DEINT_R6(f, 128), DEINT_R6(f, 192)
+
+static const uint8_t deint_2x8[256] = { DEINT_R8(DEINT_2X8) };
+static const uint8_t deint_4x4[256] = { DEINT_R8(DEINT_4X4) };
+
 /*
  * Deinterlace sample data that was retrieved at 100MHz samplerate.
  * One 16bit item contains two samples of 8bits each. The bits of
@@ -1815,19 +1932,8 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
  */
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
 {
-	uint16_t outdata;
-
 	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
+	return deint_2x8[indata & 0xff] | (deint_2x8[indata >> 8] << 4);
 }
 
 /*
@@ -1837,15 +1943,32 @@ static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
  */
 static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
 {
-	uint16_t outdata;
-
 	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
+	return deint_4x4[indata & 0xff] | (deint_4x4[indata >> 8] << 2);
+}
+
+/*
+ * Get the samples of one event, returns their count. All of them go
+ * to the session feed unless the software trigger check is active.
+ */
+static size_t sigma_event_samples(struct dev_context *devc,
+	uint16_t item16, uint16_t *samples)
+{
+	size_t idx;
+
+	switch (devc->interp.samples_per_event) {
+	case 4:
+		for (idx = 0; idx < 4; idx++)
+			samples[idx] = sigma_deinterlace_data_4x4(item16, idx);
+		return 4;
+	case 2:
+		samples[0] = sigma_deinterlace_data_2x8(item16, 0);
+		samples[1] = sigma_deinterlace_data_2x8(item16, 1);
+		return 2;
+	default:
+		samples[0] = item16;
+		return 1;
+	}
 }
 
 static void sigma_decode_dram_cluster(struct dev_context *devc,
@@ -1853,7 +1976,8 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	size_t events_in_cluster)
 {
 	uint16_t tsdiff, ts, sample, item16;
-	size_t count;
+	uint16_t samples[EVENTS_PER_CLUSTER * 4], event_samples[4];
+	size_t count, num;
 	size_t evt;
 
 	/*
@@ -1881,38 +2005,29 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	 * memory layout of sample data. Accumulation of data chunks
 	 * before submission is transparent to this code path, specific
 	 * buffer depth is neither assumed nor required here.
+	 *
+	 * Samples get collected and submitted in one go, unless the
+	 * software trigger check is active. Which is the case for a
+	 * short range of events around the hardware trigger position,
+	 * and needs every individual sample and its predecessor.
 	 */
-	sample = 0;
+	count = 0;
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
-		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+		if (!devc->interp.trig_chk.armed) {
+			count += sigma_event_samples(devc, item16,
+				&samples[count]);
+			devc->interp.last.sample = samples[count - 1];
 		} else {
-			sample = item16;
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			(void)addto_submit_buffer_many(devc, samples, count);
+			count = 0;
+			num = sigma_event_samples(devc, item16, event_samples);
+			(void)check_and_submit_samples(devc, event_samples, num);
 		}
 		sigma_location_increment(&devc->interp.iter);
 		sigma_location_check(devc);
 	}
+	(void)addto_submit_buffer_many(devc, samples, count);
 }
 
 /*
@@ -2032,6 +2147,7 @@ static int download_capture(struct sr_dev_inst *sdi)
 		if (ret != SR_OK)
 			return FALSE;
 
+		sigma_trigger_compile(devc);
 		ret = alloc_submit_buffer(sdi);
 		if (ret != SR_OK)
 			return FALSE;
@@ -374,6 +374,9 @@ struct dev_context {
 			gboolean armed;
 			gboolean matched;
 			size_t evt_remain;
+			/* Compiled trigger, see sigma_trigger_compile(). */
+			uint16_t curr_mask, curr_value;
+			uint16_t prev_mask, prev_value;
 		} trig_chk;
 	} interp;
 	uint64_t capture_ratio;
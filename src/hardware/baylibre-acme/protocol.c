@@ -52,6 +52,7 @@ struct channel_priv {
 	int ch_type;
 	int fd;
 	int digits;
+	float scale;
 	float val;
 	struct channel_group_priv *probe;
 };
@@ -629,19 +630,24 @@ static int type_digits(int type)
 	}
 }
 
+/*
+ * Read the attribute with a single pread() call from the channel's
+ * file, which is kept open during acquisition. Parse the decimal text
+ * in place, and apply the scale that was determined when the channel
+ * got opened.
+ */
 static float read_sample(struct sr_channel *ch)
 {
 	struct channel_priv *chp;
 	char buf[16];
+	const char *p;
 	ssize_t len;
-	int fd;
+	gboolean negative;
+	long value;
 
 	chp = ch->priv;
-	fd = chp->fd;
 
-	lseek(fd, 0, SEEK_SET);
-
-	len = read(fd, buf, sizeof(buf));
+	len = pread(chp->fd, buf, sizeof(buf), 0);
 	if (len < 0) {
 		sr_err("Error reading from channel %s (hwmon: %d): %s",
 			ch->name, chp->probe->hwmon_num, g_strerror(errno));
@@ -649,8 +655,17 @@ static float read_sample(struct sr_channel *ch)
 		return -1.0;
 	}
 
-	chp->digits = type_digits(chp->ch_type);
-	return strtol(buf, NULL, 10) * powf(10, -chp->digits);
+	p = buf;
+	negative = len > 0 && *p == '-';
+	if (negative)
+		p++;
+	value = 0;
+	while (p < buf + len && *p >= '0' && *p <= '9')
+		value = value * 10 + (*p++ - '0');
+	if (negative)
+		value = -value;
+
+	return value * chp->scale;
 }
 
 SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
@@ -684,6 +699,8 @@ SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
 	}
 
 	chp->fd = fd;
+	chp->digits = type_digits(chp->ch_type);
+	chp->scale = powf(10, -chp->digits);
 
 	return 0;
 }
@@ -81,6 +81,8 @@ static int beaglelogic_tcp_open(struct dev_context *devc)
 		return SR_ERR;
 	}
 
+	(void)sr_tcp_set_sock_opts(devc->socket);
+
 	return SR_OK;
 }
 
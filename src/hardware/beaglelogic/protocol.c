@@ -32,8 +32,7 @@
 #include "protocol.h"
 #include "beaglelogic.h"
 
-/* Define data packet size independent of packet (bufunitsize bytes) size
- * from the BeagleLogic kernel module */
+/* Data packet size, when the kernel module reports no buffer unit size. */
 #define PACKET_SIZE	(512 * 1024)
 
 /* This implementation is zero copy from the libsigrok side.
@@ -47,21 +46,35 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	GPollFD pfd;
 
 	int trigger_offset;
 	int pre_trigger_samples;
-	uint32_t packetsize;
+	uint32_t unit_size, packetsize, num_units;
 	uint64_t bytes_remaining;
+	gboolean done;
 
 	if (!(sdi = cb_data) || !(devc = sdi->priv))
 		return TRUE;
 
-	packetsize = PACKET_SIZE;
 	logic.unitsize = SAMPLEUNIT_TO_BYTES(devc->sampleunit);
-
-	if (revents == G_IO_IN) {
-		sr_info("In callback G_IO_IN, offset=%d", devc->offset);
-
+	unit_size = devc->bufunitsize ? devc->bufunitsize : PACKET_SIZE;
+	num_units = (devc->buffersize + unit_size - 1) / unit_size;
+	done = FALSE;
+
+	/*
+	 * The kernel module signals readability when the buffer unit at
+	 * the read position was filled. Send the rest of that unit in a
+	 * single packet, then check without waiting whether the next unit
+	 * is ready as well. That takes all data up to the kernel's write
+	 * position (one lap of the ring at most) per wake-up, with one
+	 * lseek() per buffer unit.
+	 */
+	while (revents == G_IO_IN && !done && num_units--) {
+		sr_spew("In callback G_IO_IN, offset=%d", devc->offset);
+
+		packetsize = unit_size - devc->offset % unit_size;
+		packetsize = MIN(packetsize, devc->buffersize - devc->offset);
 		bytes_remaining = (devc->limit_samples * logic.unitsize) -
 				devc->bytes_read;
 
@@ -77,7 +90,7 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 		} else {
 			/* Check for trigger */
 			trigger_offset = soft_trigger_logic_check(devc->stl,
-					logic.data, packetsize, &pre_trigger_samples);
+					logic.data, logic.length, &pre_trigger_samples);
 			if (trigger_offset > -1) {
 				devc->bytes_read += pre_trigger_samples * logic.unitsize;
 				trigger_offset *= logic.unitsize;
@@ -102,13 +115,22 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 			if (devc->triggerflags == BL_TRIGGERFLAGS_CONTINUOUS)
 				devc->offset = 0;
 			else
-				packetsize = 0;
+				done = TRUE;
 		}
+		if (devc->bytes_read >= devc->limit_samples * logic.unitsize)
+			done = TRUE;
+
+		/* Is the next buffer unit ready already? */
+		pfd.fd = fd;
+		pfd.events = G_IO_IN;
+		pfd.revents = 0;
+		if (!done && (g_poll(&pfd, 1, 0) <= 0 ||
+				!(pfd.revents & G_IO_IN)))
+			break;
 	}
 
 	/* EOF Received or we have reached the limit */
-	if (devc->bytes_read >= devc->limit_samples * logic.unitsize ||
-			packetsize == 0) {
+	if (devc->bytes_read >= devc->limit_samples * logic.unitsize || done) {
 		/* Send EOA Packet, stop polling */
 		std_session_send_df_end(sdi);
 		sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
@@ -148,7 +148,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	if (conn)
 		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		bus = libusb_get_bus_number(devlist[i]);
 		addr = libusb_get_device_address(devlist[i]);
@@ -381,7 +381,7 @@ static int config_list(uint32_t key, GVariant **data,
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
-	int i, ret;
+	int ret;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 
@@ -403,21 +403,18 @@ static int receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 	}
 
-	/* Get one block of data. */
-	if ((ret = cv_read_block(devc)) < 0) {
-		sr_err("Failed to read data block: %d.", ret);
-		sr_dev_acquisition_stop(sdi);
-		return FALSE;
-	}
-
 	/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
-	if (devc->block_counter != (NUM_BLOCKS - 1)) {
-		devc->block_counter++;
+	if (devc->block_counter < NUM_BLOCKS) {
+		if ((ret = cv_read_poll(devc)) < 0) {
+			sr_err("Failed to read data block: %d.", ret);
+			sr_dev_acquisition_stop(sdi);
+			return FALSE;
+		}
+		if (devc->block_counter == NUM_BLOCKS)
+			sr_dbg("Sampling finished, sending data to session bus now.");
 		return TRUE;
 	}
 
-	sr_dbg("Sampling finished, sending data to session bus now.");
-
 	/*
 	 * All data was received and demangled, send it to the session bus.
 	 *
@@ -425,11 +422,15 @@ static int receive_data(int fd, int revents, void *cb_data)
 	 * SDRAM, we can _not_ send it to the session bus in a streaming
 	 * manner while we receive it. We have to receive and de-mangle the
 	 * full 8MByte first, only then the whole buffer contains valid data.
+	 * Send it in portions, to not hold up other event sources.
 	 */
-	for (i = 0; i < NUM_BLOCKS; i++)
-		cv_send_block_to_session_bus(sdi, i);
-
-	sr_dev_acquisition_stop(sdi);
+	while (devc->blocks_sent < NUM_BLOCKS) {
+		cv_send_block_to_session_bus(sdi, devc->blocks_sent++);
+		if (devc->blocks_sent % SEND_BLOCKS == 0)
+			break;
+	}
+	if (devc->blocks_sent == NUM_BLOCKS)
+		sr_dev_acquisition_stop(sdi);
 
 	return TRUE;
 }
@@ -485,23 +486,33 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	/* Keep reads in flight while the device waits for the trigger. */
+	if (cv_read_start(devc) != SR_OK) {
+		sr_err("Failed to start reading data.");
+		return SR_ERR;
+	}
+
 	std_session_send_df_header(sdi);
 
 	/* Time when we should be done (for detecting trigger timeouts). */
 	devc->done = (devc->divcount + 1) * devc->prof->trigger_constant +
 			g_get_monotonic_time() + (10 * G_TIME_SPAN_SECOND);
-	devc->block_counter = 0;
 	devc->trigger_found = 0;
 
-	/* Hook up a dummy handler to receive data from the device. */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	/* Hook up a dummy handler which polls the read transfers. */
+	sr_session_source_add(sdi->session, -1, 0, 10, receive_data, (void *)sdi);
 
 	return SR_OK;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
 	sr_session_source_remove(sdi->session, -1);
+	cv_read_abort(devc);
 	std_session_send_df_end(sdi);
 
 	return SR_OK;
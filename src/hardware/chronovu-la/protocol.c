@@ -347,43 +347,11 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
 	return SR_OK;
 }
 
-/**
- * Get a block of data from the device.
- *
- * @param devc The struct containing private per-device-instance data. Must not
- *             be NULL. devc->ftdic must not be NULL either.
- *
- * @return SR_OK upon success, or SR_ERR upon errors.
- */
-SR_PRIV int cv_read_block(struct dev_context *devc)
+/* De-mangle a block of data into the final buffer. */
+static void demangle_block(struct dev_context *devc, const uint8_t *buf)
 {
-	int i, byte_offset, m, mi, p, q, index, bytes_read;
-	gint64 now;
-
-	/* Note: Caller checked that devc and devc->ftdic != NULL. */
-
-	sr_spew("Reading block %d.", devc->block_counter);
+	int i, byte_offset, m, mi, p, q, index;
 
-	bytes_read = cv_read(devc, devc->mangled_buf, BS);
-
-	/* If first block read got 0 bytes, retry until success or timeout. */
-	if ((bytes_read == 0) && (devc->block_counter == 0)) {
-		do {
-			sr_spew("Reading block 0 (again).");
-			/* Note: If bytes_read < 0 cv_read() will log errors. */
-			bytes_read = cv_read(devc, devc->mangled_buf, BS);
-			now = g_get_monotonic_time();
-		} while ((devc->done > now) && (bytes_read == 0));
-	}
-
-	/* Check if block read was successful or a timeout occurred. */
-	if (bytes_read != BS) {
-		sr_err("Trigger timed out. Bytes read: %d.", bytes_read);
-		(void) reset_device(devc); /* Ignore errors. */
-		return SR_ERR;
-	}
-
-	/* De-mangle the data. */
 	sr_spew("Demangling block %d.", devc->block_counter);
 	byte_offset = devc->block_counter * BS;
 	m = byte_offset / (1024 * 1024);
@@ -399,12 +367,159 @@ SR_PRIV int cv_read_block(struct dev_context *devc)
 			index = m * 4 + (((byte_offset + i) - mi) / 4) * 32;
 			index += q + (1 - p);
 		}
-		devc->final_buf[index] = devc->mangled_buf[i];
+		devc->final_buf[index] = buf[i];
+	}
+	devc->block_counter++;
+}
+
+/* Submit a read transfer for the next blocks, if any are left. */
+static int submit_transfer(struct dev_context *devc, int slot)
+{
+	struct ftdi_transfer_control *tc;
+
+	if (devc->blocks_submitted >= NUM_BLOCKS)
+		return SR_OK;
+
+	tc = ftdi_read_data_submit(devc->ftdic, devc->mangled_buf[slot],
+		TRANSFER_SIZE);
+	if (!tc) {
+		sr_err("Failed to submit read transfer: %s.",
+		       ftdi_get_error_string(devc->ftdic));
+		return SR_ERR;
 	}
+	devc->transfers[slot] = tc;
+	devc->blocks_submitted += TRANSFER_BLOCKS;
 
 	return SR_OK;
 }
 
+/**
+ * Start reading the sample memory from the device.
+ *
+ * Several read transfers are kept in flight, cv_read_poll() collects
+ * their data without blocking.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL. devc->ftdic must not be NULL either.
+ *
+ * @return SR_OK upon success, or SR_ERR upon errors.
+ */
+SR_PRIV int cv_read_start(struct dev_context *devc)
+{
+	int slot, ret;
+
+	devc->block_counter = 0;
+	devc->blocks_submitted = 0;
+	devc->blocks_sent = 0;
+	devc->transfer_head = 0;
+
+	for (slot = 0; slot < NUM_TRANSFERS; slot++) {
+		if ((ret = submit_transfer(devc, slot)) != SR_OK) {
+			cv_read_abort(devc);
+			return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Collect the data of completed read transfers, and submit the next ones.
+ *
+ * Completed blocks get de-mangled into the final buffer, and the count
+ * of received blocks advances in devc->block_counter. A device which
+ * does not send the first block before devc->done is assumed to not
+ * trigger, the device gets reset in that case.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL. devc->ftdic must not be NULL either.
+ *
+ * @return SR_OK upon success, or SR_ERR upon errors or timeouts.
+ */
+SR_PRIV int cv_read_poll(struct dev_context *devc)
+{
+	struct ftdi_transfer_control *tc;
+	struct timeval tv;
+	int slot, i, bytes_read, ret;
+
+	/* Note: Caller checked that devc and devc->ftdic != NULL. */
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	ret = libusb_handle_events_timeout_completed(devc->ftdic->usb_ctx,
+		&tv, NULL);
+	if (ret != 0) {
+		sr_err("Failed to handle USB events: %s.",
+		       libusb_error_name(ret));
+		cv_read_abort(devc);
+		return SR_ERR;
+	}
+
+	/* Transfers complete in the order of their submission. */
+	while ((tc = devc->transfers[devc->transfer_head]) && tc->completed) {
+		slot = devc->transfer_head;
+		devc->transfers[slot] = NULL;
+		devc->transfer_head = (slot + 1) % NUM_TRANSFERS;
+
+		bytes_read = ftdi_transfer_data_done(tc);
+		if (bytes_read != TRANSFER_SIZE) {
+			sr_err("Failed to read block %d. Bytes read: %d.",
+			       devc->block_counter, bytes_read);
+			cv_read_abort(devc);
+			(void) reset_device(devc); /* Ignore errors. */
+			return SR_ERR;
+		}
+		for (i = 0; i < TRANSFER_BLOCKS; i++)
+			demangle_block(devc, devc->mangled_buf[slot] + i * BS);
+		devc->done = g_get_monotonic_time() + READ_TIMEOUT;
+
+		if ((ret = submit_transfer(devc, slot)) != SR_OK) {
+			cv_read_abort(devc);
+			(void) reset_device(devc); /* Ignore errors. */
+			return ret;
+		}
+	}
+
+	if (devc->block_counter < NUM_BLOCKS
+			&& g_get_monotonic_time() > devc->done) {
+		if (devc->block_counter == 0)
+			sr_err("Trigger timed out.");
+		else
+			sr_err("Timed out reading block %d.",
+			       devc->block_counter);
+		cv_read_abort(devc);
+		(void) reset_device(devc); /* Ignore errors. */
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Cancel the read transfers which are in flight.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL.
+ */
+SR_PRIV void cv_read_abort(struct dev_context *devc)
+{
+	struct ftdi_transfer_control *tc;
+	int slot;
+
+	for (slot = 0; slot < NUM_TRANSFERS; slot++) {
+		if (!(tc = devc->transfers[slot]))
+			continue;
+		devc->transfers[slot] = NULL;
+#if defined HAVE_FTDI_TRANSFER_DATA_CANCEL && HAVE_FTDI_TRANSFER_DATA_CANCEL
+		ftdi_transfer_data_cancel(tc, NULL);
+#else
+		if (!tc->completed)
+			libusb_cancel_transfer(tc->transfer);
+		(void) ftdi_transfer_data_done(tc);
+#endif
+	}
+}
+
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block)
 {
 	int i, idx;
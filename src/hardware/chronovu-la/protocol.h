@@ -36,6 +36,12 @@
 #define BS				4096 /* Block size */
 #define NUM_BLOCKS			2048 /* Number of blocks */
 
+#define TRANSFER_BLOCKS			16 /* Blocks per USB read transfer */
+#define TRANSFER_SIZE			(TRANSFER_BLOCKS * BS)
+#define NUM_TRANSFERS			4 /* Read transfers in flight */
+#define SEND_BLOCKS			64 /* Blocks to send per callback */
+#define READ_TIMEOUT			(2 * G_TIME_SPAN_SECOND)
+
 enum {
 	CHRONOVU_LA8,
 	CHRONOVU_LA16,
@@ -59,10 +65,15 @@ struct dev_context {
 	uint64_t limit_samples;
 
 	/**
-	 * A buffer containing some (mangled) samples from the device.
+	 * Buffers containing some (mangled) samples from the device, one
+	 * per read transfer.
 	 * Format: Pretty mangled-up (due to hardware reasons), see code.
 	 */
-	uint8_t mangled_buf[BS];
+	uint8_t mangled_buf[NUM_TRANSFERS][TRANSFER_SIZE];
+
+	/** Read transfers in flight, the oldest at transfer_head. */
+	struct ftdi_transfer_control *transfers[NUM_TRANSFERS];
+	int transfer_head;
 
 	/**
 	 * An 8MB buffer where we'll store the de-mangled samples.
@@ -103,6 +114,12 @@ struct dev_context {
 	/** Counter/index for the data block to be read. */
 	int block_counter;
 
+	/** Number of blocks which read transfers were submitted for. */
+	int blocks_submitted;
+
+	/** Number of blocks which were sent to the session bus. */
+	int blocks_sent;
+
 	/** The divcount value (determines the sample period). */
 	uint8_t divcount;
 
@@ -122,7 +139,9 @@ SR_PRIV uint8_t cv_samplerate_to_divcount(const struct sr_dev_inst *sdi,
 SR_PRIV int cv_write(struct dev_context *devc, uint8_t *buf, int size);
 SR_PRIV int cv_convert_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate);
-SR_PRIV int cv_read_block(struct dev_context *devc);
+SR_PRIV int cv_read_start(struct dev_context *devc);
+SR_PRIV int cv_read_poll(struct dev_context *devc);
+SR_PRIV void cv_read_abort(struct dev_context *devc);
 SR_PRIV void cv_send_block_to_session_bus(const struct sr_dev_inst *sdi, int block);
 
 #endif
@@ -69,6 +69,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_MAX_THROUGHPUT | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_ANALOG_ENCODING | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -93,6 +95,10 @@ static const int32_t trigger_matches[] = {
 	SR_TRIGGER_RISING,
 	SR_TRIGGER_FALLING,
 	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
+	SR_TRIGGER_INSIDE,
+	SR_TRIGGER_OUTSIDE,
 };
 
 static const uint64_t samplerates[] = {
@@ -148,6 +154,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devc->limit_frames = limit_frames;
 	devc->capture_ratio = 20;
 	devc->stl = NULL;
+	devc->sta = NULL;
 
 	if (num_logic_channels > 0) {
 		/* Logic channels, all in one channel group. */
@@ -265,6 +272,13 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_AVG_SAMPLES:
 		*data = g_variant_new_uint64(devc->avg_samples);
 		break;
+	case SR_CONF_MAX_THROUGHPUT:
+		*data = g_variant_new_boolean(devc->max_throughput);
+		break;
+	case SR_CONF_ANALOG_ENCODING:
+		*data = g_variant_new_string(
+			analog_encoding_str[devc->analog_encoding]);
+		break;
 	case SR_CONF_MEASURED_QUANTITY:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -330,7 +344,7 @@ static int config_set(uint32_t key, GVariant *data,
 	struct sr_channel *ch;
 	GVariant *mq_tuple_child;
 	GSList *l;
-	int logic_pattern, analog_pattern;
+	int logic_pattern, analog_pattern, idx;
 
 	devc = sdi->priv;
 
@@ -357,6 +371,15 @@ static int config_set(uint32_t key, GVariant *data,
 		devc->avg_samples = g_variant_get_uint64(data);
 		sr_dbg("Setting averaging rate to %" PRIu64, devc->avg_samples);
 		break;
+	case SR_CONF_MAX_THROUGHPUT:
+		devc->max_throughput = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_ANALOG_ENCODING:
+		idx = std_str_idx(data, ARRAY_AND_SIZE(analog_encoding_str));
+		if (idx < 0)
+			return SR_ERR_ARG;
+		devc->analog_encoding = idx;
+		break;
 	case SR_CONF_MEASURED_QUANTITY:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -451,6 +474,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_TRIGGER_MATCH:
 			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 			break;
+		case SR_CONF_ANALOG_ENCODING:
+			*data = g_variant_new_strv(ARRAY_AND_SIZE(analog_encoding_str));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -501,24 +527,43 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	devc->sent_samples = 0;
 	devc->sent_frame_samples = 0;
+	devc->segmented = FALSE;
 
 	/* Setup triggers */
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
-		devc->stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
-		if (!devc->stl)
-			return SR_ERR_MALLOC;
-
-		/* Disable all analog channels since using them when there are logic
-		 * triggers set up would require having pre-trigger sample buffers
-		 * for analog sample data.
-		 */
-		for (l = sdi->channels; l; l = l->next) {
-			ch = l->data;
-			if (ch->type == SR_CHANNEL_ANALOG)
-				ch->enabled = FALSE;
+		if (soft_trigger_is_analog(trigger)) {
+			devc->sta = soft_trigger_analog_new(sdi, trigger,
+				pre_trigger_samples);
+			if (!devc->sta)
+				return SR_ERR_ARG;
+		} else {
+			devc->stl = soft_trigger_logic_new(sdi, trigger,
+				pre_trigger_samples);
+			if (!devc->stl)
+				return SR_ERR_MALLOC;
+
+			/*
+			 * With a frame limit, capture a frame of limit_samples
+			 * samples around every trigger position.
+			 */
+			devc->segmented = devc->limit_frames > 0
+				&& devc->limit_samples > 0;
+			if (devc->segmented)
+				soft_trigger_logic_segments_set(devc->stl,
+					devc->limit_samples - pre_trigger_samples);
+
+			/* Disable all analog channels since using them when there are logic
+			 * triggers set up would require having pre-trigger sample buffers
+			 * for analog sample data.
+			 */
+			for (l = sdi->channels; l; l = l->next) {
+				ch = l->data;
+				if (ch->type == SR_CHANNEL_ANALOG)
+					ch->enabled = FALSE;
+			}
 		}
 	}
 	devc->trigger_fired = FALSE;
@@ -561,12 +606,16 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	demo_logic_table_build(devc);
+	demo_analog_batches_build((struct sr_dev_inst *)sdi);
+
+	sr_session_source_add(sdi->session, -1, 0,
+			devc->max_throughput ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
 
-	if (devc->limit_frames > 0)
+	if (devc->limit_frames > 0 && !devc->segmented)
 		std_session_send_df_frame_begin(sdi);
 
 	/* We use this timestamp to decide how many more samples to send. */
@@ -584,16 +633,26 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	sr_session_source_remove(sdi->session, -1);
 
 	devc = sdi->priv;
-	if (devc->limit_frames > 0)
+	if (devc->segmented)
+		soft_trigger_logic_segment_close(devc->stl);
+	else if (devc->limit_frames > 0)
 		std_session_send_df_frame_end(sdi);
 
 	std_session_send_df_end(sdi);
 
+	demo_logic_table_free(devc);
+	demo_analog_batches_free(devc);
+
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
 
+	if (devc->sta) {
+		soft_trigger_analog_free(devc->sta);
+		devc->sta = NULL;
+	}
+
 	return SR_OK;
 }
 
@@ -274,9 +274,13 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/*
+ * Generate the pattern's data the straight way, one sample (or byte)
+ * at a time. Periodic patterns use this to fill their tables.
+ */
+static void logic_pattern_fill(struct dev_context *devc,
+	uint8_t *buf, uint64_t size)
 {
-	struct dev_context *devc;
 	uint64_t i, j;
 	uint8_t pat;
 	uint8_t *sample;
@@ -284,27 +288,21 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	size_t col_count, col_height;
 	uint64_t gray;
 
-	devc = sdi->priv;
-
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(buf, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				buf[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
-	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
-		break;
 	case PATTERN_INC:
 		for (i = 0; i < size; i++) {
-			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+			for (j = 0; j < devc->logic_unitsize && i + j < size; j++)
+				buf[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
@@ -312,7 +310,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			buf[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -327,7 +325,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* j contains the value of the highest bit */
 		j = 1 << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			buf[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -342,11 +340,11 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		/* These were set when the pattern mode was selected. */
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(buf, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &buf[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +360,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &buf[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -371,6 +369,106 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	}
 }
 
+/* Length in bytes after which a pattern repeats, 0 if it doesn't. */
+static size_t logic_pattern_period(struct dev_context *devc)
+{
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		return sizeof(pattern_sigrok) * devc->logic_unitsize;
+	case PATTERN_INC:
+		return 256;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		return devc->num_logic_channels + 1;
+	case PATTERN_SQUID:
+		return ARRAY_SIZE(pattern_squid) * devc->logic_unitsize;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Precompute the table of a periodic pattern for the acquisition. The
+ * table holds whole periods and is at least LOGIC_BUFSIZE long, so that
+ * a chunk takes one or two copies.
+ */
+SR_PRIV void demo_logic_table_build(struct dev_context *devc)
+{
+	size_t period;
+
+	demo_logic_table_free(devc);
+	devc->prng_state = 0x9e3779b97f4a7c15ULL;
+
+	period = logic_pattern_period(devc);
+	if (!period)
+		return;
+	devc->logic_table_len = period * ((LOGIC_BUFSIZE + period - 1) / period);
+	devc->logic_table = g_malloc(devc->logic_table_len);
+	devc->step = 0;
+	logic_pattern_fill(devc, devc->logic_table, devc->logic_table_len);
+	devc->step = 0;
+}
+
+SR_PRIV void demo_logic_table_free(struct dev_context *devc)
+{
+	g_free(devc->logic_table);
+	devc->logic_table = NULL;
+	devc->logic_table_len = 0;
+	devc->logic_table_pos = 0;
+}
+
+/* A xorshift64* generator, fills whole words of random data. */
+static void logic_random_fill(struct dev_context *devc,
+	uint8_t *buf, uint64_t size)
+{
+	uint64_t x;
+	uint8_t last[sizeof(x)];
+
+	x = devc->prng_state;
+	while (size) {
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		if (size >= sizeof(x)) {
+			write_u64le(buf, x * 0x2545f4914f6cdd1dULL);
+			buf += sizeof(x);
+			size -= sizeof(x);
+		} else {
+			write_u64le(last, x * 0x2545f4914f6cdd1dULL);
+			memcpy(buf, last, size);
+			size = 0;
+		}
+	}
+	devc->prng_state = x;
+}
+
+static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+{
+	struct dev_context *devc;
+	uint64_t off, len;
+
+	devc = sdi->priv;
+
+	if (devc->logic_table) {
+		for (off = 0; off < size; off += len) {
+			len = MIN(size - off,
+				devc->logic_table_len - devc->logic_table_pos);
+			memcpy(&devc->logic_data[off],
+				&devc->logic_table[devc->logic_table_pos], len);
+			devc->logic_table_pos += len;
+			devc->logic_table_pos %= devc->logic_table_len;
+		}
+		return;
+	}
+
+	if (devc->logic_pattern == PATTERN_RANDOM) {
+		logic_random_fill(devc, devc->logic_data, size);
+		return;
+	}
+
+	logic_pattern_fill(devc, devc->logic_data, size);
+}
+
 /*
  * Fixup a memory image of generated logic data before it gets sent to
  * the session's datafeed. Mask out content from disabled channels.
@@ -399,6 +497,97 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+/* The unit for the given quantity. */
+static enum sr_unit analog_unit(enum sr_mq mq)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		return SR_UNIT_VOLT;
+	case SR_MQ_CURRENT:
+		return SR_UNIT_AMPERE;
+	case SR_MQ_RESISTANCE:
+		return SR_UNIT_OHM;
+	case SR_MQ_CAPACITANCE:
+		return SR_UNIT_FARAD;
+	case SR_MQ_TEMPERATURE:
+		return SR_UNIT_CELSIUS;
+	case SR_MQ_FREQUENCY:
+		return SR_UNIT_HERTZ;
+	case SR_MQ_DUTY_CYCLE:
+		return SR_UNIT_PERCENTAGE;
+	case SR_MQ_CONTINUITY:
+		return SR_UNIT_OHM;
+	case SR_MQ_PULSE_WIDTH:
+		return SR_UNIT_PERCENTAGE;
+	case SR_MQ_CONDUCTANCE:
+		return SR_UNIT_SIEMENS;
+	case SR_MQ_POWER:
+		return SR_UNIT_WATT;
+	case SR_MQ_GAIN:
+		return SR_UNIT_UNITLESS;
+	case SR_MQ_SOUND_PRESSURE_LEVEL:
+		return SR_UNIT_DECIBEL_SPL;
+	case SR_MQ_CARBON_MONOXIDE:
+		return SR_UNIT_CONCENTRATION;
+	case SR_MQ_RELATIVE_HUMIDITY:
+		return SR_UNIT_HUMIDITY_293K;
+	case SR_MQ_TIME:
+		return SR_UNIT_SECOND;
+	case SR_MQ_WIND_SPEED:
+		return SR_UNIT_METER_SECOND;
+	case SR_MQ_PRESSURE:
+		return SR_UNIT_HECTOPASCAL;
+	case SR_MQ_PARALLEL_INDUCTANCE:
+		return SR_UNIT_HENRY;
+	case SR_MQ_PARALLEL_CAPACITANCE:
+		return SR_UNIT_FARAD;
+	case SR_MQ_PARALLEL_RESISTANCE:
+		return SR_UNIT_OHM;
+	case SR_MQ_SERIES_INDUCTANCE:
+		return SR_UNIT_HENRY;
+	case SR_MQ_SERIES_CAPACITANCE:
+		return SR_UNIT_FARAD;
+	case SR_MQ_SERIES_RESISTANCE:
+		return SR_UNIT_OHM;
+	case SR_MQ_DISSIPATION_FACTOR:
+		return SR_UNIT_UNITLESS;
+	case SR_MQ_QUALITY_FACTOR:
+		return SR_UNIT_UNITLESS;
+	case SR_MQ_PHASE_ANGLE:
+		return SR_UNIT_DEGREE;
+	case SR_MQ_DIFFERENCE:
+		return SR_UNIT_UNITLESS;
+	case SR_MQ_COUNT:
+		return SR_UNIT_PIECE;
+	case SR_MQ_POWER_FACTOR:
+		return SR_UNIT_UNITLESS;
+	case SR_MQ_APPARENT_POWER:
+		return SR_UNIT_VOLT_AMPERE;
+	case SR_MQ_MASS:
+		return SR_UNIT_GRAM;
+	case SR_MQ_HARMONIC_RATIO:
+		return SR_UNIT_UNITLESS;
+	default:
+		return SR_UNIT_UNITLESS;
+	}
+}
+
+/*
+ * Factors which turn the channel's pattern data (or random numbers
+ * from 0 to 999) into values of the configured amplitude and offset.
+ */
+static void analog_scale(const struct analog_gen *ag,
+		float *amplitude, float *offset)
+{
+	if (ag->pattern == PATTERN_ANALOG_RANDOM) {
+		*amplitude = ag->amplitude / 500.0;
+		*offset = ag->offset - DEFAULT_ANALOG_OFFSET - ag->amplitude;
+	} else {
+		*amplitude = ag->amplitude / DEFAULT_ANALOG_AMPLITUDE;
+		*offset = ag->offset - DEFAULT_ANALOG_OFFSET;
+	}
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -412,7 +601,7 @@ static void send_analog_packet(struct analog_gen *ag,
 	float amplitude, offset, value;
 	float *data;
 
-	if (!ag->ch || !ag->ch->enabled)
+	if (!ag->ch || !ag->ch->enabled || ag->batched)
 		return;
 
 	devc = sdi->priv;
@@ -425,75 +614,7 @@ static void send_analog_packet(struct analog_gen *ag,
 	ag->packet.meaning->mq = ag->mq;
 	ag->packet.meaning->mqflags = ag->mq_flags;
 
-	/* Set a unit for the given quantity. */
-	if (ag->mq == SR_MQ_VOLTAGE)
-		ag->packet.meaning->unit = SR_UNIT_VOLT;
-	else if (ag->mq == SR_MQ_CURRENT)
-		ag->packet.meaning->unit = SR_UNIT_AMPERE;
-	else if (ag->mq == SR_MQ_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_TEMPERATURE)
-		ag->packet.meaning->unit = SR_UNIT_CELSIUS;
-	else if (ag->mq == SR_MQ_FREQUENCY)
-		ag->packet.meaning->unit = SR_UNIT_HERTZ;
-	else if (ag->mq == SR_MQ_DUTY_CYCLE)
-		ag->packet.meaning->unit = SR_UNIT_PERCENTAGE;
-	else if (ag->mq == SR_MQ_CONTINUITY)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_PULSE_WIDTH)
-		ag->packet.meaning->unit = SR_UNIT_PERCENTAGE;
-	else if (ag->mq == SR_MQ_CONDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_SIEMENS;
-	else if (ag->mq == SR_MQ_POWER)
-		ag->packet.meaning->unit = SR_UNIT_WATT;
-	else if (ag->mq == SR_MQ_GAIN)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_SOUND_PRESSURE_LEVEL)
-		ag->packet.meaning->unit = SR_UNIT_DECIBEL_SPL;
-	else if (ag->mq == SR_MQ_CARBON_MONOXIDE)
-		ag->packet.meaning->unit = SR_UNIT_CONCENTRATION;
-	else if (ag->mq == SR_MQ_RELATIVE_HUMIDITY)
-		ag->packet.meaning->unit = SR_UNIT_HUMIDITY_293K;
-	else if (ag->mq == SR_MQ_TIME)
-		ag->packet.meaning->unit = SR_UNIT_SECOND;
-	else if (ag->mq == SR_MQ_WIND_SPEED)
-		ag->packet.meaning->unit = SR_UNIT_METER_SECOND;
-	else if (ag->mq == SR_MQ_PRESSURE)
-		ag->packet.meaning->unit = SR_UNIT_HECTOPASCAL;
-	else if (ag->mq == SR_MQ_PARALLEL_INDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_HENRY;
-	else if (ag->mq == SR_MQ_PARALLEL_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_PARALLEL_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_SERIES_INDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_HENRY;
-	else if (ag->mq == SR_MQ_SERIES_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_SERIES_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_DISSIPATION_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_QUALITY_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_PHASE_ANGLE)
-		ag->packet.meaning->unit = SR_UNIT_DEGREE;
-	else if (ag->mq == SR_MQ_DIFFERENCE)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_COUNT)
-		ag->packet.meaning->unit = SR_UNIT_PIECE;
-	else if (ag->mq == SR_MQ_POWER_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_APPARENT_POWER)
-		ag->packet.meaning->unit = SR_UNIT_VOLT_AMPERE;
-	else if (ag->mq == SR_MQ_MASS)
-		ag->packet.meaning->unit = SR_UNIT_GRAM;
-	else if (ag->mq == SR_MQ_HARMONIC_RATIO)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
+	ag->packet.meaning->unit = analog_unit(ag->mq);
 
 	if (!devc->avg) {
 		ag_pattern_pos = analog_pos % pattern->num_samples;
@@ -505,13 +626,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			 * Amplitude or offset changed (or we are generating
 			 * random data), modify each sample.
 			 */
-			if (ag->pattern == PATTERN_ANALOG_RANDOM) {
-				amplitude = ag->amplitude / 500.0;
-				offset = ag->offset - DEFAULT_ANALOG_OFFSET - ag->amplitude;
-			} else {
-				amplitude = ag->amplitude / DEFAULT_ANALOG_AMPLITUDE;
-				offset = ag->offset - DEFAULT_ANALOG_OFFSET;
-			}
+			analog_scale(ag, &amplitude, &offset);
 			data = ag->packet.data;
 			for (i = 0; i < sending_now; i++) {
 				if (ag->pattern == PATTERN_ANALOG_RANDOM)
@@ -524,20 +639,17 @@ static void send_analog_packet(struct analog_gen *ag,
 			ag->packet.data = pattern->data + ag_pattern_pos;
 		}
 		ag->packet.num_samples = sending_now;
-		sr_session_send(sdi, &packet);
+		if (devc->sta)
+			soft_trigger_analog_send(devc->sta, &packet);
+		else
+			sr_session_send(sdi, &packet);
 
 		/* Whichever channel group gets there first. */
 		*analog_sent = MAX(*analog_sent, sending_now);
 	} else {
 		ag_pattern_pos = analog_pos % pattern->num_samples;
 		to_avg = MIN(analog_todo, pattern->num_samples - ag_pattern_pos);
-		if (ag->pattern == PATTERN_ANALOG_RANDOM) {
-			amplitude = ag->amplitude / 500.0;
-			offset = ag->offset - DEFAULT_ANALOG_OFFSET - ag->amplitude;
-		} else {
-			amplitude = ag->amplitude / DEFAULT_ANALOG_AMPLITUDE;
-			offset = ag->offset - DEFAULT_ANALOG_OFFSET;
-		}
+		analog_scale(ag, &amplitude, &offset);
 
 		for (i = 0; i < to_avg; i++) {
 			if (ag->pattern == PATTERN_ANALOG_RANDOM)
@@ -564,7 +676,10 @@ do_send:
 		ag->packet.data = &ag->avg_val;
 		ag->packet.num_samples = 1;
 
-		sr_session_send(sdi, &packet);
+		if (devc->sta)
+			soft_trigger_analog_send(devc->sta, &packet);
+		else
+			sr_session_send(sdi, &packet);
 		*analog_sent = ag->num_avgs;
 
 		ag->num_avgs = 0;
@@ -572,6 +687,173 @@ do_send:
 	}
 }
 
+static void analog_batch_free(void *data)
+{
+	struct analog_batch *batch;
+
+	batch = data;
+	g_slist_free(batch->channels);
+	g_free(batch->period);
+	g_free(batch);
+}
+
+SR_PRIV void demo_analog_batches_free(struct dev_context *devc)
+{
+	g_slist_free_full(devc->analog_batches, analog_batch_free);
+	devc->analog_batches = NULL;
+}
+
+/* Compute one period of the batch's values, in the selected encoding. */
+static void analog_batch_fill(struct dev_context *devc,
+		struct analog_batch *batch, GSList *gens)
+{
+	struct analog_gen *ag;
+	struct analog_pattern *pattern;
+	GSList *l;
+	float *values, amplitude, offset, max_abs;
+	int16_t raw;
+	size_t num_values, c, i;
+	int digits;
+	uint64_t mult;
+
+	num_values = batch->num_samples * batch->num_channels;
+	values = g_malloc(num_values * sizeof(float));
+	for (l = gens, c = 0; l; l = l->next, c++) {
+		ag = l->data;
+		pattern = devc->analog_patterns[ag->pattern];
+		analog_scale(ag, &amplitude, &offset);
+		for (i = 0; i < batch->num_samples; i++)
+			values[i * batch->num_channels + c] =
+				pattern->data[i] * amplitude + offset;
+	}
+
+	if (devc->analog_encoding == ANALOG_ENCODING_FLOAT) {
+		batch->period = (uint8_t *)values;
+		return;
+	}
+
+	/* As many decimal digits as the largest value allows. */
+	max_abs = 0;
+	for (i = 0; i < num_values; i++)
+		max_abs = MAX(max_abs, fabsf(values[i]));
+	digits = 0;
+	mult = 1;
+	while (digits < DEFAULT_ANALOG_ENCODING_DIGITS &&
+			max_abs * mult * 10 <= INT16_MAX) {
+		digits++;
+		mult *= 10;
+	}
+
+	batch->period = g_malloc(num_values * sizeof(raw));
+	for (i = 0; i < num_values; i++) {
+		raw = lrintf(CLAMP(values[i] * mult, INT16_MIN, INT16_MAX));
+		memcpy(&batch->period[i * sizeof(raw)], &raw, sizeof(raw));
+	}
+	g_free(values);
+
+	batch->encoding.unitsize = sizeof(raw);
+	batch->encoding.is_float = FALSE;
+	batch->encoding.is_signed = TRUE;
+	batch->encoding.digits = digits;
+	batch->encoding.scale.p = 1;
+	batch->encoding.scale.q = mult;
+	batch->spec.spec_digits = digits;
+}
+
+/*
+ * Group the enabled analog channels by their quantity, each group is
+ * sent in one packet per time slice. Random data and averaging are
+ * still handled per channel, as is the analog soft trigger.
+ */
+SR_PRIV void demo_analog_batches_build(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct analog_batch *batch;
+	struct analog_gen *ag, *first;
+	struct sr_channel *ch;
+	GSList *l, *gens, *members, *rest;
+
+	devc = sdi->priv;
+	demo_analog_batches_free(devc);
+
+	gens = NULL;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		ag = g_hash_table_lookup(devc->ch_ag, ch);
+		ag->batched = FALSE;
+		if (!ch->enabled || devc->avg || devc->sta)
+			continue;
+		if (ag->pattern == PATTERN_ANALOG_RANDOM)
+			continue;
+		gens = g_slist_append(gens, ag);
+	}
+
+	while (gens) {
+		first = gens->data;
+		members = rest = NULL;
+		for (l = gens; l; l = l->next) {
+			ag = l->data;
+			if (ag->mq == first->mq && ag->mq_flags == first->mq_flags)
+				members = g_slist_append(members, ag);
+			else
+				rest = g_slist_append(rest, ag);
+		}
+		g_slist_free(gens);
+		gens = rest;
+
+		batch = g_malloc0(sizeof(*batch));
+		sr_analog_init(&batch->packet, &batch->encoding,
+			&batch->meaning, &batch->spec,
+			DEFAULT_ANALOG_ENCODING_DIGITS);
+		batch->spec.spec_digits = DEFAULT_ANALOG_SPEC_DIGITS;
+		for (l = members; l; l = l->next) {
+			ag = l->data;
+			ag->batched = TRUE;
+			batch->channels = g_slist_append(batch->channels, ag->ch);
+		}
+		batch->num_channels = g_slist_length(members);
+		batch->num_samples = devc->analog_patterns[first->pattern]->num_samples;
+		batch->meaning.channels = batch->channels;
+		batch->meaning.mq = first->mq;
+		batch->meaning.mqflags = first->mq_flags;
+		batch->meaning.unit = analog_unit(first->mq);
+		analog_batch_fill(devc, batch, members);
+		g_slist_free(members);
+
+		devc->analog_batches = g_slist_append(devc->analog_batches, batch);
+		sr_dbg("Batching %zu analog channels, %s encoding.",
+			batch->num_channels,
+			analog_encoding_str[devc->analog_encoding]);
+	}
+}
+
+/* Send a time slice of all analog batches, straight from their period. */
+static void send_analog_batches(struct sr_dev_inst *sdi,
+		uint64_t *analog_sent, uint64_t analog_pos, uint64_t analog_todo)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct analog_batch *batch;
+	uint64_t pos, sending_now;
+	GSList *l;
+
+	devc = sdi->priv;
+	for (l = devc->analog_batches; l; l = l->next) {
+		batch = l->data;
+		pos = analog_pos % batch->num_samples;
+		sending_now = MIN(analog_todo, batch->num_samples - pos);
+		batch->packet.data = batch->period +
+			pos * batch->num_channels * batch->encoding.unitsize;
+		batch->packet.num_samples = sending_now;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &batch->packet;
+		sr_session_send(sdi, &packet);
+		*analog_sent = MAX(*analog_sent, sending_now);
+	}
+}
+
 /* Callback handling data */
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 {
@@ -613,7 +895,18 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
 			/ G_USEC_PER_SEC;
 
-	if (devc->limit_samples > 0) {
+	/* Without pacing, the time limit refers to the samples' time. */
+	if (devc->max_throughput) {
+		samples_todo = THROUGHPUT_SAMPLES;
+		if (limit_us > 0) {
+			todo_us = MAX(0, limit_us - devc->spent_us);
+			samples_todo = MIN(samples_todo,
+				(todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+				/ G_USEC_PER_SEC);
+		}
+	}
+
+	if (devc->limit_samples > 0 && !devc->segmented) {
 		if (devc->limit_samples < devc->sent_samples)
 			samples_todo = 0;
 		else if (devc->limit_samples - devc->sent_samples < samples_todo)
@@ -623,7 +916,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	if (samples_todo == 0)
 		return G_SOURCE_CONTINUE;
 
-	if (devc->limit_frames) {
+	if (devc->limit_frames && !devc->segmented) {
 		/* Never send more samples than a frame can fit... */
 		samples_todo = MIN(samples_todo, SAMPLES_PER_FRAME);
 		/* ...or than we need to finish the current frame. */
@@ -651,6 +944,22 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			sending_now = MIN(samples_todo - logic_done,
 					LOGIC_BUFSIZE / devc->logic_unitsize);
 			logic_generator(sdi, sending_now * devc->logic_unitsize);
+			if (devc->segmented) {
+				/* The soft trigger sends the frames. */
+				logic.unitsize = devc->logic_unitsize;
+				logic.length = sending_now * devc->logic_unitsize;
+				logic.data = devc->logic_data;
+				logic_fixup_feed(devc, &logic);
+				soft_trigger_logic_segments_feed(devc->stl,
+					devc->logic_data, logic.length);
+				logic_done += sending_now;
+				if (devc->stl->segments >= devc->limit_frames) {
+					sr_dbg("Requested number of frames reached.");
+					sr_dev_acquisition_stop(sdi);
+					break;
+				}
+				continue;
+			}
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
@@ -684,8 +993,11 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 					/* Send nothing */
 					logic_done += sending_now;
 				}
-			} else if (!devc->stl) {
-				/* No trigger defined, send logic samples */
+			} else if (devc->sta && !soft_trigger_analog_fired(devc->sta)) {
+				/* Analog trigger pending, send nothing */
+				logic_done += sending_now;
+			} else {
+				/* No logic trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
 				logic.data = devc->logic_data;
 				logic_fixup_feed(devc, &logic);
@@ -698,6 +1010,9 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		if (analog_done < samples_todo) {
 			analog_sent = 0;
 
+			send_analog_batches(sdi, &analog_sent,
+				devc->sent_samples + analog_done,
+				samples_todo - analog_done);
 			g_hash_table_iter_init(&iter, devc->ch_ag);
 			while (g_hash_table_iter_next(&iter, NULL, &value)) {
 				send_analog_packet(value, sdi, &analog_sent,
@@ -713,6 +1028,9 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	devc->sent_frame_samples += min;
 	devc->spent_us += todo_us;
 
+	if (devc->segmented)
+		return G_SOURCE_CONTINUE;
+
 	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
 		std_session_send_df_frame_end(sdi);
 		devc->sent_frame_samples = 0;
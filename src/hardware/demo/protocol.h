@@ -31,7 +31,9 @@
 #define LOG_PREFIX "demo"
 
 /* The size in bytes of chunks to send through the session bus. */
-#define LOGIC_BUFSIZE			4096
+#define LOGIC_BUFSIZE			65536
+/* Samples per callback when generating at maximum throughput. */
+#define THROUGHPUT_SAMPLES		(1024 * 1024)
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -106,6 +108,17 @@ static const char *analog_pattern_str[] = {
 	"random",
 };
 
+/* Encodings of analog values in batched packets. */
+enum analog_encoding_type {
+	ANALOG_ENCODING_FLOAT,
+	ANALOG_ENCODING_INT16,
+};
+
+static const char *analog_encoding_str[] = {
+	"float",
+	"int16",
+};
+
 struct analog_pattern {
 	float data[ANALOG_BUFSIZE];
 	unsigned int num_samples;
@@ -128,6 +141,16 @@ struct dev_context {
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
 	uint8_t logic_data[LOGIC_BUFSIZE];
+	/* Periodic patterns get copied from a precomputed table. */
+	uint8_t *logic_table;
+	size_t logic_table_len;
+	size_t logic_table_pos;
+	uint64_t prng_state;
+	/* Don't pace data generation by the samplerate. */
+	gboolean max_throughput;
+	/* Analog channels which get sent in multi-channel packets. */
+	GSList *analog_batches;
+	enum analog_encoding_type analog_encoding;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -142,6 +165,9 @@ struct dev_context {
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
 	struct soft_trigger_logic *stl;
+	struct soft_trigger_analog *sta;
+	/* One frame per trigger, see soft_trigger_logic_segments_set(). */
+	gboolean segmented;
 };
 
 struct analog_gen {
@@ -158,10 +184,31 @@ struct analog_gen {
 	struct sr_analog_spec spec;
 	float avg_val; /* Average value */
 	unsigned int num_avgs; /* Number of samples averaged */
+	gboolean batched; /* Sent as part of an analog_batch */
+};
+
+/*
+ * Analog channels of the same quantity, sent in one packet with the
+ * values interleaved. One period of all channels' values is computed
+ * at acquisition start, packets point into it.
+ */
+struct analog_batch {
+	GSList *channels;
+	size_t num_channels;
+	uint8_t *period;
+	unsigned int num_samples;
+	struct sr_datafeed_analog packet;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
 };
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV void demo_logic_table_build(struct dev_context *devc);
+SR_PRIV void demo_logic_table_free(struct dev_context *devc);
+SR_PRIV void demo_analog_batches_build(struct sr_dev_inst *sdi);
+SR_PRIV void demo_analog_batches_free(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -233,6 +233,7 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 	int transferred;
 	int result, ret;
 	const uint8_t cmd[3] = {0, 0, 0};
+	char id[32];
 
 	drvc = sdi->driver->context;
 	devc = sdi->priv;
@@ -256,12 +257,21 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	/* The FPGA keeps its configuration while the device is attached. */
+	g_snprintf(id, sizeof(id), "usb/%d.%d", usb->bus, usb->address);
+	if (sr_resource_upload_matches(drvc->sr_ctx, id,
+			SR_RESOURCE_FIRMWARE, name)) {
+		sr_dbg("FPGA firmware '%s' is already loaded.", name);
+		return SR_OK;
+	}
+
 	sr_dbg("Uploading FPGA firmware '%s'.", name);
 
 	result = sr_resource_open(drvc->sr_ctx, &bitstream,
 			SR_RESOURCE_FIRMWARE, name);
 	if (result != SR_OK)
 		return result;
+	sr_resource_upload_done(drvc->sr_ctx, id, SR_RESOURCE_FIRMWARE, NULL);
 
 	/* Tell the device firmware is coming. */
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
@@ -306,8 +316,11 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 	g_free(buf);
 	sr_resource_close(drvc->sr_ctx, &bitstream);
 
-	if (result == SR_OK)
+	if (result == SR_OK) {
 		sr_dbg("FPGA firmware upload done.");
+		sr_resource_upload_done(drvc->sr_ctx, id,
+			SR_RESOURCE_FIRMWARE, name);
+	}
 
 	return result;
 }
@@ -551,7 +564,7 @@ SR_PRIV int dslogic_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -678,6 +691,10 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	/* Wait for the decoding of all received data. */
+	sr_usb_decoder_finish(devc->decoder);
+	devc->decoder = NULL;
+
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
@@ -725,35 +742,30 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 }
 
 static void deinterleave_buffer(const uint8_t *src, size_t length,
-	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
+	uint8_t *dst_ptr, size_t channel_count, uint16_t channel_mask,
+	size_t unitsize)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
-		}
+	uint8_t plane_bits[16];
+	unsigned int channel;
+	size_t plane;
+
+	/* The words of a block are those of the enabled channels, in order. */
+	plane = 0;
+	for (channel = 0; channel < 16 && plane < channel_count; channel++) {
+		if (channel_mask & (1 << channel))
+			plane_bits[plane++] = channel;
 	}
+
+	sr_bit_planes64_to_logic(src, length / (DSLOGIC_ATOMIC_BYTES * channel_count),
+		plane, plane_bits, dst_ptr, unitsize);
 }
 
 static void send_data(struct sr_dev_inst *sdi,
-	uint16_t *data, size_t sample_count)
+	uint8_t *data, size_t sample_count, size_t unitsize)
 {
 	const struct sr_datafeed_logic logic = {
-		.length = sample_count * sizeof(uint16_t),
-		.unitsize = sizeof(uint16_t),
+		.length = sample_count * unitsize,
+		.unitsize = unitsize,
 		.data = data
 	};
 
@@ -765,19 +777,85 @@ static void send_data(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
+/* Convert received sample data, and send it to the session. */
+static void process_data(struct sr_dev_inst *sdi,
+	const uint8_t *data, size_t length)
+{
+	struct dev_context *const devc = sdi->priv;
+	const size_t channel_count = enabled_channel_count(sdi);
+	const uint16_t channel_mask = enabled_channel_mask(sdi);
+	/* Narrow units suffice when only the low channels are enabled. */
+	const size_t unitsize = (channel_mask & 0xff00) ? 2 : 1;
+	const unsigned int cur_sample_count = DSLOGIC_ATOMIC_SAMPLES *
+		length / (DSLOGIC_ATOMIC_BYTES * channel_count);
+
+	unsigned int num_samples;
+	int trigger_offset;
+
+	if (devc->limit_samples && devc->decoded_samples >= devc->limit_samples)
+		return;
+
+	if (devc->limit_samples && devc->decoded_samples + cur_sample_count > devc->limit_samples)
+		num_samples = devc->limit_samples - devc->decoded_samples;
+	else
+		num_samples = cur_sample_count;
+
+	/**
+	 * The DSLogic emits sample data as sequences of 64-bit sample words
+	 * in a round-robin i.e. 64-bits from channel 0, 64-bits from channel 1
+	 * etc. for each of the enabled channels, then looping back to the
+	 * channel.
+	 *
+	 * Because sigrok's internal representation is bit-interleaved channels
+	 * we must recast the data.
+	 *
+	 * Hopefully in future it will be possible to pass the data on as-is.
+	 */
+	if (length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
+		sr_err("Invalid transfer length!");
+	deinterleave_buffer(data, length, devc->deinterleave_buffer,
+		channel_count, channel_mask, unitsize);
+
+	/* Send the incoming transfer to the session bus. */
+	if (devc->trigger_pos > devc->decoded_samples
+		&& devc->trigger_pos <= devc->decoded_samples + num_samples) {
+		/* DSLogic trigger in this block. Send trigger position. */
+		trigger_offset = devc->trigger_pos - devc->decoded_samples;
+		/* Pre-trigger samples. */
+		send_data(sdi, devc->deinterleave_buffer, trigger_offset,
+			unitsize);
+		devc->decoded_samples += trigger_offset;
+		/* Trigger position. */
+		devc->trigger_pos = 0;
+		std_session_send_df_trigger(sdi);
+		/* Post trigger samples. */
+		num_samples -= trigger_offset;
+		send_data(sdi, devc->deinterleave_buffer
+			+ trigger_offset * unitsize, num_samples, unitsize);
+		devc->decoded_samples += num_samples;
+	} else {
+		send_data(sdi, devc->deinterleave_buffer, num_samples,
+			unitsize);
+		devc->decoded_samples += num_samples;
+	}
+}
+
+/* Routine of the decoding thread, see start_transfers(). */
+static void process_data_cb(const uint8_t *data, size_t length, void *cb_data)
+{
+	process_data(cb_data, data, length);
+}
+
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *const sdi = transfer->user_data;
 	struct dev_context *const devc = sdi->priv;
 	const size_t channel_count = enabled_channel_count(sdi);
-	const uint16_t channel_mask = enabled_channel_mask(sdi);
 	const unsigned int cur_sample_count = DSLOGIC_ATOMIC_SAMPLES *
 		transfer->actual_length /
 		(DSLOGIC_ATOMIC_BYTES * channel_count);
 
 	gboolean packet_has_error = FALSE;
-	unsigned int num_samples;
-	int trigger_offset;
 
 	/*
 	 * If acquisition has already ended, just free any queued up
@@ -823,48 +901,18 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		devc->empty_transfer_count = 0;
 	}
 
+	/*
+	 * Have the data processed. The decoding thread does that when
+	 * it is running, the transfer then gets a spare buffer and can
+	 * be resubmitted before the data was processed.
+	 */
 	if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
-		if (devc->limit_samples && devc->sent_samples + cur_sample_count > devc->limit_samples)
-			num_samples = devc->limit_samples - devc->sent_samples;
+		if (devc->decoder)
+			sr_usb_decoder_push(devc->decoder, transfer);
 		else
-			num_samples = cur_sample_count;
-
-		/**
-		 * The DSLogic emits sample data as sequences of 64-bit sample words
-		 * in a round-robin i.e. 64-bits from channel 0, 64-bits from channel 1
-		 * etc. for each of the enabled channels, then looping back to the
-		 * channel.
-		 *
-		 * Because sigrok's internal representation is bit-interleaved channels
-		 * we must recast the data.
-		 *
-		 * Hopefully in future it will be possible to pass the data on as-is.
-		 */
-		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
-			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
-
-		/* Send the incoming transfer to the session bus. */
-		if (devc->trigger_pos > devc->sent_samples
-			&& devc->trigger_pos <= devc->sent_samples + num_samples) {
-			/* DSLogic trigger in this block. Send trigger position. */
-			trigger_offset = devc->trigger_pos - devc->sent_samples;
-			/* Pre-trigger samples. */
-			send_data(sdi, devc->deinterleave_buffer, trigger_offset);
-			devc->sent_samples += trigger_offset;
-			/* Trigger position. */
-			devc->trigger_pos = 0;
-			std_session_send_df_trigger(sdi);
-			/* Post trigger samples. */
-			num_samples -= trigger_offset;
-			send_data(sdi, devc->deinterleave_buffer
-				+ trigger_offset, num_samples);
-			devc->sent_samples += num_samples;
-		} else {
-			send_data(sdi, devc->deinterleave_buffer, num_samples);
-			devc->sent_samples += num_samples;
-		}
+			process_data(sdi, transfer->buffer,
+				transfer->actual_length);
+		devc->sent_samples += cur_sample_count;
 	}
 
 	if (devc->limit_samples && devc->sent_samples >= devc->limit_samples) {
@@ -952,6 +1000,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	usb = sdi->conn;
 
 	devc->sent_samples = 0;
+	devc->decoded_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
 	devc->submitted_transfers = 0;
@@ -994,6 +1043,16 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		devc->submitted_transfers++;
 	}
 
+	/*
+	 * Downloads of the device's memory (buffered mode) run at full
+	 * USB speed, decode them in a separate thread meanwhile. Transfers
+	 * complete from the session's event loop only, so the thread can
+	 * still start after their submission.
+	 */
+	if (!devc->continuous_mode)
+		devc->decoder = sr_usb_decoder_new(size, DECODE_BUFSZ / size,
+			process_data_cb, (void *)sdi);
+
 	std_session_send_df_header(sdi);
 
 	return SR_OK;
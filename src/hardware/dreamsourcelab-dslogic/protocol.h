@@ -37,6 +37,8 @@
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
 #define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
+/* Received data which may wait for decoding, in buffered mode. */
+#define DECODE_BUFSZ		(32 * 1024 * 1024)
 
 #define NUM_CHANNELS		16
 #define NUM_TRIGGER_STAGES	16
@@ -125,6 +127,9 @@ struct dev_context {
 	gboolean acq_aborted;
 
 	unsigned int sent_samples;
+	/* Sent to the session, lags behind sent_samples when decoding. */
+	unsigned int decoded_samples;
+	struct sr_usb_decoder *decoder;
 	int submitted_transfers;
 	int empty_transfer_count;
 
@@ -132,7 +137,7 @@ struct dev_context {
 	struct libusb_transfer **transfers;
 	struct sr_context *ctx;
 
-	uint16_t *deinterleave_buffer;
+	uint8_t *deinterleave_buffer;
 
 	uint16_t mode;
 	uint32_t trigger_pos;
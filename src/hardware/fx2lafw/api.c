@@ -21,6 +21,7 @@
 #include <config.h>
 #include "protocol.h"
 #include <math.h>
+#include <string.h>
 
 static const struct fx2lafw_profile supported_fx2[] = {
 	/*
@@ -132,6 +133,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TRANSFER_PROFILE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
 static const int32_t trigger_matches[] = {
@@ -142,6 +144,11 @@ static const int32_t trigger_matches[] = {
 	SR_TRIGGER_EDGE,
 };
 
+/* Indexed by enum sr_usb_stream_profile. */
+static const char *transfer_profiles[] = {
+	"balanced", "low-latency", "robust",
+};
+
 static const uint64_t samplerates[] = {
 	SR_KHZ(20),
 	SR_KHZ(25),
@@ -230,7 +237,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -412,13 +419,17 @@ static int dev_clear(const struct sr_dev_driver *di)
 	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
 }
 
+static int renum_open(struct sr_dev_inst *sdi)
+{
+	return fx2lafw_dev_open(sdi, sdi->driver);
+}
+
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct sr_dev_driver *di = sdi->driver;
 	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
 	int ret;
-	int64_t timediff_us, timediff_ms;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -427,26 +438,11 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * milliseconds for the FX2 to renumerate.
 	 */
-	ret = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((ret = fx2lafw_dev_open(sdi, di)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
-		if (ret != SR_OK) {
-			sr_err("Device failed to renumerate.");
+		ret = ezusb_wait_renum(sdi, devc->fw_updated,
+			EZUSB_RENUM_GONE_DELAY_MS, MAX_RENUM_DELAY_MS, renum_open);
+		if (ret != SR_OK)
 			return SR_ERR;
-		}
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
 	} else {
 		sr_info("Firmware upload was not needed.");
 		ret = fx2lafw_dev_open(sdi, di);
@@ -538,6 +534,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_TRANSFER_PROFILE:
+		*data = g_variant_new_string(transfer_profiles[devc->transfer_profile]);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +572,13 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_TRANSFER_PROFILE:
+		if ((idx = std_str_idx(data, ARRAY_AND_SIZE(transfer_profiles))) < 0)
+			return SR_ERR_ARG;
+		if (idx != devc->transfer_profile)
+			memset(&devc->last_stats, 0, sizeof(devc->last_stats));
+		devc->transfer_profile = idx;
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -601,6 +607,9 @@ static int config_list(uint32_t key, GVariant **data,
 	case SR_CONF_TRIGGER_MATCH:
 		*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
 		break;
+	case SR_CONF_TRANSFER_PROFILE:
+		*data = std_gvar_array_str(ARRAY_AND_SIZE(transfer_profiles));
+		break;
 	default:
 		return SR_ERR_NA;
 	}
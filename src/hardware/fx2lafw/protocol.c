@@ -21,6 +21,7 @@
 #include <config.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <string.h>
 #include "protocol.h"
 
 #pragma pack(push, 1)
@@ -155,7 +156,7 @@ SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -270,28 +271,29 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 
 SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 {
-	int i;
-
-	devc->acq_aborted = TRUE;
-
-	for (i = devc->num_transfers - 1; i >= 0; i--) {
-		if (devc->transfers[i])
-			libusb_cancel_transfer(devc->transfers[i]);
-	}
+	sr_usb_stream_abort(devc->stream);
 }
 
-static void finish_acquisition(struct sr_dev_inst *sdi)
+static void finish_acquisition(struct sr_usb_stream *stream, void *cb_data)
 {
+	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 
+	sdi = cb_data;
 	devc = sdi->priv;
 
+	devc->last_stats = stream->stats;
+	if (stream->stats.overruns)
+		sr_warn("%" PRIu64 " transfer overruns, %" PRIu64 " empty "
+			"transfers. Try the \"robust\" transfer profile.",
+			stream->stats.overruns, stream->stats.empty_transfers);
+
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
 
-	devc->num_transfers = 0;
-	g_free(devc->transfers);
+	sr_usb_stream_free(stream);
+	devc->stream = NULL;
 
 	/* Free the deinterlace buffers if we had them. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
@@ -305,47 +307,35 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	}
 }
 
-static void free_transfer(struct libusb_transfer *transfer)
+/*
+ * Split interleaved pairs of logic and analog bytes. Four pairs at a
+ * time get separated in a 64bit register: even bytes are logic, odd
+ * bytes are analog.
+ */
+static void mso_demux(const uint8_t *data, size_t length,
+	uint8_t *logic, uint8_t *analog)
 {
-	struct sr_dev_inst *sdi;
-	struct dev_context *devc;
-	unsigned int i;
-
-	sdi = transfer->user_data;
-	devc = sdi->priv;
-
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
+	uint64_t x, l, a;
+	size_t i;
 
-	for (i = 0; i < devc->num_transfers; i++) {
-		if (devc->transfers[i] == transfer) {
-			devc->transfers[i] = NULL;
-			break;
-		}
+	for (i = 0; i + 4 <= length; i += 4) {
+		x = read_u64le(&data[i * 2]);
+		l = x & UINT64_C(0x00ff00ff00ff00ff);
+		a = (x >> 8) & UINT64_C(0x00ff00ff00ff00ff);
+		l = (l | (l >> 8)) & UINT64_C(0x0000ffff0000ffff);
+		a = (a | (a >> 8)) & UINT64_C(0x0000ffff0000ffff);
+		write_u32le(&logic[i], l | (l >> 16));
+		write_u32le(&analog[i], a | (a >> 16));
+	}
+	for (; i < length; i++) {
+		logic[i] = data[i * 2];
+		analog[i] = data[i * 2 + 1];
 	}
-
-	devc->submitted_transfers--;
-	if (devc->submitted_transfers == 0)
-		finish_acquisition(sdi);
-}
-
-static void resubmit_transfer(struct libusb_transfer *transfer)
-{
-	int ret;
-
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
-		return;
-
-	sr_err("%s: %s", __func__, libusb_error_name(ret));
-	free_transfer(transfer);
-
 }
 
 static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	uint8_t *data, size_t length, size_t sample_width)
 {
-	size_t i;
 	struct dev_context *devc;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -359,11 +349,7 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	length /= 2;
 
 	/* Send the logic */
-	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
-		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
-	};
+	mso_demux(data, length, devc->logic_buffer, devc->analog_buffer);
 
 	const struct sr_datafeed_logic logic = {
 		.length = length,
@@ -378,7 +364,18 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 
 	sr_session_send(sdi, &logic_packet);
 
+	/*
+	 * Send the ADC values as they are. Scale and offset rescale
+	 * 0-255 to -10V - +10V, that is (x - 128) / 12.8.
+	 */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_signed = FALSE;
+	analog.encoding->scale.p = 5;
+	analog.encoding->scale.q = 64;
+	analog.encoding->offset.p = -10;
+	analog.encoding->offset.q = 1;
 	analog.meaning->channels = devc->enabled_analog_channels;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
@@ -411,65 +408,22 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+static int receive_transfer(struct sr_usb_stream *stream,
+		uint8_t *data, size_t length, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	gboolean packet_has_error = FALSE;
 	unsigned int num_samples;
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
 
-	sdi = transfer->user_data;
+	sdi = cb_data;
 	devc = sdi->priv;
 
-	/*
-	 * If acquisition has already ended, just free any queued up
-	 * transfer that come in.
-	 */
-	if (devc->acq_aborted) {
-		free_transfer(transfer);
-		return;
-	}
-
-	sr_dbg("receive_transfer(): status %s received %d bytes.",
-		libusb_error_name(transfer->status), transfer->actual_length);
-
-	/* Save incoming transfer before reusing the transfer struct. */
 	unitsize = devc->sample_wide ? 2 : 1;
-	cur_sample_count = transfer->actual_length / unitsize;
+	cur_sample_count = length / unitsize;
 	processed_samples = 0;
 
-	switch (transfer->status) {
-	case LIBUSB_TRANSFER_NO_DEVICE:
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-		return;
-	case LIBUSB_TRANSFER_COMPLETED:
-	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
-		break;
-	default:
-		packet_has_error = TRUE;
-		break;
-	}
-
-	if (transfer->actual_length == 0 || packet_has_error) {
-		devc->empty_transfer_count++;
-		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
-			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
-			 */
-			fx2lafw_abort_acquisition(devc);
-			free_transfer(transfer);
-		} else {
-			resubmit_transfer(transfer);
-		}
-		return;
-	} else {
-		devc->empty_transfer_count = 0;
-	}
-
 check_trigger:
 	if (devc->trigger_fired) {
 		if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
@@ -478,15 +432,15 @@ check_trigger:
 			if (devc->limit_samples && devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer + processed_samples * unitsize,
+			devc->send_data_proc(sdi, data + processed_samples * unitsize,
 				num_samples * unitsize, unitsize);
 			devc->sent_samples += num_samples;
 			processed_samples += num_samples;
 		}
 	} else {
 		trigger_offset = soft_trigger_logic_check(devc->stl,
-			transfer->buffer + processed_samples * unitsize,
-			transfer->actual_length - processed_samples * unitsize,
+			data + processed_samples * unitsize,
+			length - processed_samples * unitsize,
 			&pre_trigger_samples);
 		if (trigger_offset > -1) {
 			std_session_send_df_frame_begin(sdi);
@@ -496,7 +450,7 @@ check_trigger:
 					devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer
+			devc->send_data_proc(sdi, data
 					+ processed_samples * unitsize
 					+ trigger_offset * unitsize,
 					num_samples * unitsize, unitsize);
@@ -520,7 +474,7 @@ check_trigger:
 		if (processed_samples < cur_sample_count) {
 			/* Reset the trigger stage */
 			if (devc->stl)
-				devc->stl->cur_stage = 0;
+				soft_trigger_logic_reset(devc->stl);
 			else {
 				std_session_send_df_frame_begin(sdi);
 				devc->trigger_fired = TRUE;
@@ -529,11 +483,10 @@ check_trigger:
 				goto check_trigger;
 		}
 	}
-	if (frame_ended && final_frame) {
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+	if (frame_ended && final_frame)
+		sr_usb_stream_abort(stream);
+
+	return SR_OK;
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -570,46 +523,27 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
+static struct sr_usb_stream *new_stream(const struct sr_dev_inst *sdi)
 {
-	return samplerate / 1000;
-}
-
-static size_t get_buffer_size(struct dev_context *devc)
-{
-	size_t s;
-
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
-	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct sr_usb_stream_config cfg;
 
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
+	devc = sdi->priv;
+	usb = sdi->conn;
 
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.endpoint = 2 | LIBUSB_ENDPOINT_IN;
+	cfg.bytes_per_sec = devc->cur_samplerate * (devc->sample_wide ? 2 : 1);
+	cfg.max_transfers = NUM_SIMUL_TRANSFERS;
+	sr_usb_stream_config_profile(&cfg, devc->transfer_profile,
+		&devc->last_stats);
+	cfg.sdi = sdi;
+	cfg.data_cb = receive_transfer;
+	cfg.done_cb = finish_acquisition;
+	cfg.cb_data = (void *)sdi;
+
+	return sr_usb_stream_new(usb->devhdl, &cfg);
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -631,20 +565,12 @@ static int receive_data(int fd, int revents, void *cb_data)
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
 	struct sr_trigger *trigger;
-	struct libusb_transfer *transfer;
-	unsigned int i, num_transfers;
-	int timeout, ret;
-	unsigned char *buf;
-	size_t size;
+	int ret;
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	devc->sent_samples = 0;
-	devc->acq_aborted = FALSE;
-	devc->empty_transfer_count = 0;
 
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
@@ -659,40 +585,8 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		devc->trigger_fired = TRUE;
 	}
 
-	num_transfers = get_number_of_transfers(devc);
-
-	size = get_buffer_size(devc);
-	devc->submitted_transfers = 0;
-
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
-	if (!devc->transfers) {
-		sr_err("USB transfers malloc failed.");
-		return SR_ERR_MALLOC;
-	}
-
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
-		sr_info("submitting transfer: %d", i);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
-			sr_err("Failed to submit transfer: %s.",
-			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
-			fx2lafw_abort_acquisition(devc);
-			return SR_ERR;
-		}
-		devc->transfers[i] = transfer;
-		devc->submitted_transfers++;
-	}
+	if ((ret = sr_usb_stream_start(devc->stream)) != SR_OK)
+		return ret;
 
 	/*
 	 * If this device has analog channels and at least one of them is
@@ -714,7 +608,7 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
-	int timeout, ret;
+	int ret;
 	size_t size;
 
 	di = sdi->driver;
@@ -724,26 +618,34 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	devc->ctx = drvc->sr_ctx;
 	devc->num_frames = 0;
 	devc->sent_samples = 0;
-	devc->empty_transfer_count = 0;
-	devc->acq_aborted = FALSE;
 
 	if (configure_channels(sdi) != SR_OK) {
 		sr_err("Failed to configure channels.");
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	devc->stream = new_stream(sdi);
+	if (!devc->stream)
+		return SR_ERR;
+	usb_source_add(sdi->session, devc->ctx, devc->stream->timeout,
+		receive_data, drvc);
 
-	size = get_buffer_size(devc);
+	size = devc->stream->buffer_size;
 	/* Prepare for analog sampling. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		/* We need a buffer half the size of a transfer. */
 		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
+		devc->analog_buffer = g_try_malloc(size / 2);
+	}
+	if ((ret = start_transfers(sdi)) != SR_OK) {
+		/* Nothing got submitted, so the stream won't finish by itself. */
+		if (!devc->stream->submitted) {
+			usb_source_remove(sdi->session, devc->ctx);
+			sr_usb_stream_free(devc->stream);
+			devc->stream = NULL;
+		}
+		return ret;
 	}
-	start_transfers(sdi);
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
 		fx2lafw_abort_acquisition(devc);
 		return ret;
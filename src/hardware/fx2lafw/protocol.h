@@ -37,7 +37,6 @@
 
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
-#define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
 #define NUM_CHANNELS		16
 
@@ -108,22 +107,21 @@ struct dev_context {
 	uint64_t capture_ratio;
 
 	gboolean trigger_fired;
-	gboolean acq_aborted;
 	gboolean sample_wide;
 	struct soft_trigger_logic *stl;
 
 	uint64_t num_frames;
 	uint64_t sent_samples;
-	int submitted_transfers;
-	int empty_transfer_count;
 
-	unsigned int num_transfers;
-	struct libusb_transfer **transfers;
+	int transfer_profile;
+	/* Transfer statistics of the last acquisition, to size the next. */
+	struct sr_transfer_stats last_stats;
+	struct sr_usb_stream *stream;
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
-	float *analog_buffer;
+	uint8_t *analog_buffer;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
@@ -532,6 +532,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	usb_source_add(sdi->session, ctx, 50,
 		greatfet_receive_data, (void *)sdi);
+	(void)sr_sw_limits_start_timer(&devc->sw_limits, sdi->session);
 
 	ret = std_session_send_df_header(sdi);
 	acq->frame_begin_sent = ret == SR_OK;
@@ -30,6 +30,8 @@
 
 #define LOG_PREFIX "greatfet"
 
+#define EXPAND_BUFFER_SAMPLES	4096
+
 struct dev_context {
 	struct sr_dev_inst *sdi;
 	GString *usb_comm_buffer;
@@ -48,6 +50,8 @@ struct dev_context {
 		gboolean use_upper_pins;
 		size_t channel_shift;
 		size_t points_per_byte;
+		uint8_t expand_lut[256][8 * sizeof(uint16_t)];
+		uint8_t expand_buffer[EXPAND_BUFFER_SAMPLES * sizeof(uint16_t)];
 		uint64_t capture_samplerate;
 		size_t firmware_bufsize;
 		uint8_t samples_endpoint;
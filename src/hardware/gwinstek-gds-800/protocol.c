@@ -24,41 +24,87 @@
 #define ANALOG_CHANNELS 2
 #define VERTICAL_DIVISIONS 10
 
-static int read_data(struct sr_dev_inst *sdi,
+/*
+ * Send the samples of the current channel, which the block has in the
+ * device's receive buffer. They go to the bus as they are, big endian
+ * 16bit values, the encoding's scale turns them into volts.
+ */
+static int channel_data_send(struct sr_dev_inst *sdi,
 		struct sr_scpi_dev_inst *scpi, struct dev_context *devc,
-		int data_size)
+		size_t len)
 {
-	int len;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	char command[32];
+	char *response;
+	float volts_per_division, vbit, vbitlog;
+	int num_samples, digits;
+	uint32_t sample_rate;
+	char *end_ptr;
 
-	len = sr_scpi_read_data(scpi,
-		&devc->rcv_buffer[devc->cur_rcv_buffer_position],
-		data_size - devc->cur_rcv_buffer_position);
-	if (len < 0) {
-		sr_err("Read data error.");
-		sr_dev_acquisition_stop(sdi);
-		devc->cur_rcv_buffer_position = 0;
-		return SR_ERR;
+	if (len < MEM_HEADER_SIZE) {
+		sr_err("Truncated channel data received.");
+		return SR_ERR_DATA;
 	}
 
-	devc->cur_rcv_buffer_position += len;
-
-	/* Handle the case where sr_scpi_read_data stopped at the newline. */
-	if (len < data_size && sr_scpi_read_complete(scpi)) {
-		devc->rcv_buffer[devc->cur_rcv_buffer_position] = '\n';
-		devc->cur_rcv_buffer_position++;
+	/*
+	 * Contrary to the documentation, the samplerate is
+	 * transfered with most significant byte first!
+	 */
+	sample_rate = RB32(devc->rcv_buffer);
+	memcpy(&devc->sample_rate, &sample_rate, sizeof(float));
+
+	if (!devc->df_started) {
+		std_session_send_df_header(sdi);
+		std_session_send_df_frame_begin(sdi);
+		devc->df_started = TRUE;
 	}
 
-	if (devc->cur_rcv_buffer_position < data_size)
-		return SR_ERR; /* Not finished yet. */
-	else if (devc->cur_rcv_buffer_position == data_size) {
-		 devc->cur_rcv_buffer_position = 0;
-		return SR_OK;
-	} else {
-		sr_err("Too many bytes read.");
-		sr_dev_acquisition_stop(sdi);
-		devc->cur_rcv_buffer_position = 0;
+	/* Fetch data needed for conversion from device. */
+	snprintf(command, sizeof(command), ":CHAN%d:SCAL?",
+			devc->cur_acq_channel + 1);
+	if (sr_scpi_get_string(scpi, command, &response) != SR_OK) {
+		sr_err("Failed to get volts per division.");
 		return SR_ERR;
 	}
+	volts_per_division = g_ascii_strtod(response, &end_ptr);
+	if (!strcmp(end_ptr, "mV"))
+		volts_per_division *= 1.e-3;
+	g_free(response);
+
+	num_samples = (len - MEM_HEADER_SIZE) / 2;
+	sr_spew("Received %d number of samples from channel "
+		"%d.", num_samples, devc->cur_acq_channel + 1);
+
+	vbit = volts_per_division * VERTICAL_DIVISIONS / 256.0;
+	vbitlog = log10f(vbit);
+	digits = -(int)vbitlog + (vbitlog < 0.0);
+
+	/* Fill frame. */
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	encoding.unitsize = sizeof(int16_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = TRUE;
+	/* Volts per division at microvolt resolution. */
+	sr_rational_set(&encoding.scale,
+		llroundf(volts_per_division * 1e6) * VERTICAL_DIVISIONS,
+		256 * 1000000);
+	analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, devc->cur_acq_channel));
+	analog.num_samples = num_samples;
+	analog.data = &devc->rcv_buffer[MEM_HEADER_SIZE];
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+
+	return SR_OK;
 }
 
 SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
@@ -66,18 +112,8 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	char command[32];
-	char *response;
-	float volts_per_division;
-	int num_samples, i;
-	float samples[MAX_SAMPLES];
-	uint32_t sample_rate;
-	char *end_ptr;
+	size_t len;
 
 	(void)fd;
 
@@ -115,18 +151,24 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 		break;
 	case START_TRANSFER_OF_CHANNEL_DATA:
 		if (((struct sr_channel *)g_slist_nth_data(sdi->channels, devc->cur_acq_channel))->enabled) {
-			if (sr_scpi_send(scpi, ":ACQ%d:MEM?", devc->cur_acq_channel+1) != SR_OK) {
+			/* Read the whole block, straight into the buffer. */
+			snprintf(command, sizeof(command), ":ACQ%d:MEM?",
+					devc->cur_acq_channel + 1);
+			if (sr_scpi_get_block_into(scpi, command,
+					devc->rcv_buffer, sizeof(devc->rcv_buffer),
+					&len) != SR_OK) {
 				sr_err("Failed to acquire memory.");
 				sr_dev_acquisition_stop(sdi);
 				return TRUE;
 			}
-			if (sr_scpi_read_begin(scpi) != SR_OK) {
-				sr_err("Could not begin reading SCPI response.");
-				sr_dev_acquisition_stop(sdi);
-				return TRUE;
+			/* Discard the newline which follows the block. */
+			while (!sr_scpi_read_complete(scpi)) {
+				if (sr_scpi_read_data(scpi, command,
+						sizeof(command)) < 0)
+					break;
 			}
-			devc->state = WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE;
-			devc->cur_rcv_buffer_position = 0;
+			devc->state = CHANNEL_DATA_RECEIVED;
+			devc->rcv_length = len;
 		} else {
 			/* All channels acquired. */
 			if (devc->cur_acq_channel == ANALOG_CHANNELS - 1) {
@@ -154,104 +196,12 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 			}
 		}
 		break;
-	case WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) < 0)
-			break;
-		if (devc->rcv_buffer[0] == '#')
-			devc->state = WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) < 0)
-			break;
-		if (devc->rcv_buffer[0] != '4' &&
-			devc->rcv_buffer[0] != '5' &&
-			devc->rcv_buffer[0] != '6') {
-			sr_err("Data size digits is not 4, 5 or 6 but "
-			       "'%c'.", devc->rcv_buffer[0]);
+	case CHANNEL_DATA_RECEIVED:
+		if (channel_data_send(sdi, scpi, devc,
+				devc->rcv_length) != SR_OK) {
 			sr_dev_acquisition_stop(sdi);
 			return TRUE;
-		} else {
-			devc->data_size_digits = devc->rcv_buffer[0] - '0';
-			devc->state = WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE;
 		}
-		break;
-	case WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE:
-		if (read_data(sdi, scpi, devc, devc->data_size_digits) < 0)
-			break;
-		devc->rcv_buffer[devc->data_size_digits] = 0;
-		if (sr_atoi(devc->rcv_buffer, &devc->data_size) != SR_OK) {
-			sr_err("Could not parse data size '%s'", devc->rcv_buffer);
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
-		} else
-			devc->state = WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE:
-		if (read_data(sdi, scpi, devc, sizeof(float)) < 0)
-			break;
-		/*
-		 * Contrary to the documentation, this field is
-		 * transfered with most significant byte first!
-		 */
-		sample_rate = RB32(devc->rcv_buffer);
-		memcpy(&devc->sample_rate, &sample_rate, sizeof(float));
-		devc->state = WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE;
-
-		if (!devc->df_started) {
-			std_session_send_df_header(sdi);
-			std_session_send_df_frame_begin(sdi);
-			devc->df_started = TRUE;
-		}
-		break;
-	case WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) == SR_OK)
-			devc->state = WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE:
-		if (read_data(sdi, scpi, devc, 3) == SR_OK)
-			devc->state = WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE:
-		if (read_data(sdi, scpi, devc, devc->data_size - 8) < 0)
-			break;
-
-		/* Fetch data needed for conversion from device. */
-		snprintf(command, sizeof(command), ":CHAN%d:SCAL?",
-				devc->cur_acq_channel + 1);
-		if (sr_scpi_get_string(scpi, command, &response) != SR_OK) {
-			sr_err("Failed to get volts per division.");
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
-		}
-		volts_per_division = g_ascii_strtod(response, &end_ptr);
-		if (!strcmp(end_ptr, "mV"))
-			volts_per_division *= 1.e-3;
-		g_free(response);
-
-		num_samples = (devc->data_size - 8) / 2;
-		sr_spew("Received %d number of samples from channel "
-			"%d.", num_samples, devc->cur_acq_channel + 1);
-
-		float vbit = volts_per_division * VERTICAL_DIVISIONS / 256.0;
-		float vbitlog = log10f(vbit);
-		int digits = -(int)vbitlog + (vbitlog < 0.0);
-
-		/* Convert data. */
-		for (i = 0; i < num_samples; i++)
-			samples[i] = ((float) ((int16_t) (RB16(&devc->rcv_buffer[i*2])))) * vbit;
-
-		/* Fill frame. */
-		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, devc->cur_acq_channel));
-		analog.num_samples = num_samples;
-		analog.data = samples;
-		analog.meaning->mq = SR_MQ_VOLTAGE;
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.meaning->mqflags = 0;
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 
 		/* All channels acquired. */
 		if (devc->cur_acq_channel == ANALOG_CHANNELS - 1) {
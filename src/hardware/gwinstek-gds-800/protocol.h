@@ -29,19 +29,18 @@
 #define LOG_PREFIX "gwinstek-gds-800"
 
 #define MAX_SAMPLES 125000
-#define MAX_RCV_BUFFER_SIZE (MAX_SAMPLES * 2)
+/*
+ * The block of :ACQ<n>:MEM? starts with the samplerate, the channel
+ * indicator and reserved bytes, then the samples follow.
+ */
+#define MEM_HEADER_SIZE 8
+#define MAX_RCV_BUFFER_SIZE (MEM_HEADER_SIZE + MAX_SAMPLES * 2)
 
 enum gds_state
 {
 	START_ACQUISITION,
 	START_TRANSFER_OF_CHANNEL_DATA,
-	WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE,
+	CHANNEL_DATA_RECEIVED,
 };
 
 struct dev_context {
@@ -49,10 +48,8 @@ struct dev_context {
 	uint64_t cur_acq_frame;
 	uint64_t frame_limit;
 	int cur_acq_channel;
-	int cur_rcv_buffer_position;
-	char rcv_buffer[MAX_RCV_BUFFER_SIZE];
-	int data_size_digits;
-	int data_size;
+	uint8_t rcv_buffer[MAX_RCV_BUFFER_SIZE];
+	size_t rcv_length;
 	float sample_rate;
 	gboolean df_started;
 };
@@ -843,7 +843,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (!devc->enabled_channels)
 		return SR_ERR;
 	devc->pod_count = pod_count;
-	devc->logic_data = NULL;
+	for (group = 0; group < ARRAY_SIZE(devc->pod_data); group++)
+		devc->pod_data[group] = NULL;
 
 	/*
 	 * Check constraints. Some channels can be either analog or
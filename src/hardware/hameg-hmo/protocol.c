@@ -939,7 +939,7 @@ static int scope_state_get_array_option(struct sr_scpi_dev_inst *scpi,
  *
  * @return SR_ERR on any parsing error, SR_OK otherwise.
  */
-static int array_float_get(gchar *value, const uint64_t array[][2],
+static int array_float_get(const gchar *value, const uint64_t array[][2],
 		int array_len, unsigned int *result)
 {
 	struct sr_rational rval;
@@ -977,73 +977,81 @@ static int analog_channel_state_get(struct sr_dev_inst *sdi,
 				    const struct scope_config *config,
 				    struct scope_state *state)
 {
-	unsigned int i, j;
+	static const int queries[] = {
+		SCPI_CMD_GET_ANALOG_CHAN_STATE,
+		SCPI_CMD_GET_VERTICAL_SCALE,
+		SCPI_CMD_GET_VERTICAL_OFFSET,
+		SCPI_CMD_GET_COUPLING,
+		SCPI_CMD_GET_PROBE_UNIT,
+	};
+	unsigned int i, j, q;
+	int idx, ret;
 	char command[MAX_COMMAND_SIZE];
-	char *tmp_str;
+	const char *tmp_str;
+	size_t base;
 	struct sr_channel *ch;
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
+	struct sr_scpi_pipeline *pl;
 
+	/* Query all channels' settings in few round trips. */
+	pl = sr_scpi_pipeline_new(sdi->conn);
 	for (i = 0; i < config->analog_channels; i++) {
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_ANALOG_CHAN_STATE],
-			   i + 1);
+		for (q = 0; q < ARRAY_SIZE(queries); q++) {
+			g_snprintf(command, sizeof(command),
+				   (*config->scpi_dialect)[queries[q]], i + 1);
+			sr_scpi_pipeline_query(pl, command);
+		}
+	}
+	if (sr_scpi_pipeline_run(pl) != SR_OK) {
+		sr_scpi_pipeline_free(pl);
+		return SR_ERR;
+	}
 
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->analog_channels[i].state) != SR_OK)
-			return SR_ERR;
+	ret = SR_OK;
+	for (i = 0; i < config->analog_channels; i++) {
+		base = i * ARRAY_SIZE(queries);
+
+		if (sr_scpi_pipeline_get_bool(pl, base,
+				&state->analog_channels[i].state) != SR_OK) {
+			ret = SR_ERR;
+			break;
+		}
 
 		ch = get_channel_by_index_and_type(sdi->channels, i, SR_CHANNEL_ANALOG);
 		if (ch)
 			ch->enabled = state->analog_channels[i].state;
 
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_SCALE],
-			   i + 1);
-
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
-
+		tmp_str = sr_scpi_pipeline_response(pl, base + 1);
 		if (array_float_get(tmp_str, *(config->vdivs), config->num_vdivs, &j) != SR_OK) {
-			g_free(tmp_str);
 			sr_err("Could not determine array index for vertical div scale.");
-			return SR_ERR;
+			ret = SR_ERR;
+			break;
 		}
-
-		g_free(tmp_str);
 		state->analog_channels[i].vdiv = j;
 
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_OFFSET],
-			   i + 1);
-
-		if (sr_scpi_get_float(scpi, command,
-				     &state->analog_channels[i].vertical_offset) != SR_OK)
-			return SR_ERR;
-
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_COUPLING],
-			   i + 1);
-
-		if (scope_state_get_array_option(scpi, command, config->coupling_options,
-					 config->num_coupling_options,
-					 &state->analog_channels[i].coupling) != SR_OK)
-			return SR_ERR;
-
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_PROBE_UNIT],
-			   i + 1);
+		if (sr_scpi_pipeline_get_float(pl, base + 2,
+				&state->analog_channels[i].vertical_offset) != SR_OK) {
+			ret = SR_ERR;
+			break;
+		}
 
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
+		tmp_str = sr_scpi_pipeline_response(pl, base + 3);
+		idx = std_str_idx_s(tmp_str, *config->coupling_options,
+			config->num_coupling_options);
+		if (idx < 0) {
+			ret = SR_ERR;
+			break;
+		}
+		state->analog_channels[i].coupling = idx;
 
+		tmp_str = sr_scpi_pipeline_response(pl, base + 4);
 		if (tmp_str[0] == 'A')
 			state->analog_channels[i].probe_unit = 'A';
 		else
 			state->analog_channels[i].probe_unit = 'V';
-		g_free(tmp_str);
 	}
+	sr_scpi_pipeline_free(pl);
 
-	return SR_OK;
+	return ret;
 }
 
 static int digital_channel_state_get(struct sr_dev_inst *sdi,
@@ -1382,80 +1390,114 @@ SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi)
 SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
 				  size_t group, GByteArray *pod_data)
 {
-	size_t size;
-	GByteArray *store;
-	uint8_t *logic_data;
-	size_t idx, logic_step;
-
 	/*
-	 * Upon first invocation, allocate the array which can hold the
-	 * combined logic data for all channels. Assume that each channel
-	 * will yield an identical number of samples per receive call.
-	 *
-	 * As a poor man's safety measure: (Silently) skip processing
-	 * for unexpected sample counts, and ignore samples for
-	 * unexpected channel groups. Don't bother with complicated
-	 * resize logic, considering that many models only support one
-	 * pod, and the most capable supported models have two pods of
-	 * identical size. We haven't yet seen any "odd" configuration.
+	 * Keep the received pod data until all involved channel groups
+	 * were received. Ignore data for unexpected channel groups, and
+	 * (silently) replace data for a group that was seen before.
 	 */
-	if (!devc->logic_data) {
-		size = pod_data->len * devc->pod_count;
-		store = g_byte_array_sized_new(size);
-		memset(store->data, 0, size);
-		store = g_byte_array_set_size(store, size);
-		devc->logic_data = store;
-	} else {
-		store = devc->logic_data;
-		size = store->len / devc->pod_count;
-		if (group >= devc->pod_count)
-			return;
+	if (group >= devc->pod_count || group >= ARRAY_SIZE(devc->pod_data)) {
+		g_byte_array_free(pod_data, TRUE);
+		return;
 	}
+	if (devc->pod_data[group])
+		g_byte_array_free(devc->pod_data[group], TRUE);
+	devc->pod_data[group] = pod_data;
+}
 
-	/*
-	 * Fold the data of the most recently received channel group into
-	 * the storage, where data resides for all channels combined.
-	 */
-	logic_data = store->data;
-	logic_data += group;
-	logic_step = devc->pod_count;
-	for (idx = 0; idx < pod_data->len; idx++) {
-		*logic_data = pod_data->data[idx];
-		logic_data += logic_step;
+/*
+ * Fold the data of individual channel groups into the combined sample
+ * layout of the session feed. The common two pods case gets handled by
+ * a dedicated loop which the compiler can vectorize. Channel groups
+ * which are not involved in the acquisition read as all-zero.
+ */
+static void hmo_fold_logic_data(struct dev_context *devc,
+				uint8_t *logic_data, size_t offset, size_t count)
+{
+	const uint8_t *pod0, *pod1, *pod;
+	size_t group, idx;
+
+	if (devc->pod_count == 2 && devc->pod_data[0] && devc->pod_data[1]) {
+		pod0 = &devc->pod_data[0]->data[offset];
+		pod1 = &devc->pod_data[1]->data[offset];
+		for (idx = 0; idx < count; idx++) {
+			logic_data[2 * idx + 0] = pod0[idx];
+			logic_data[2 * idx + 1] = pod1[idx];
+		}
+		return;
 	}
 
-	/* Truncate acquisition if a smaller number of samples has been requested. */
-	if (devc->samples_limit > 0 && devc->logic_data->len > devc->samples_limit * devc->pod_count)
-		devc->logic_data->len = devc->samples_limit * devc->pod_count;
+	for (group = 0; group < devc->pod_count; group++) {
+		if (!devc->pod_data[group]) {
+			for (idx = 0; idx < count; idx++)
+				logic_data[idx * devc->pod_count + group] = 0;
+			continue;
+		}
+		pod = &devc->pod_data[group]->data[offset];
+		for (idx = 0; idx < count; idx++)
+			logic_data[idx * devc->pod_count + group] = pod[idx];
+	}
 }
 
-/* Submit data for all channels, after the individual groups got collected. */
+/*
+ * Submit data for all channels, after the individual groups got collected.
+ * The combined data gets sent in chunks of limited size, which avoids
+ * holding another copy of the complete frame's logic data in memory.
+ */
 SR_PRIV void hmo_send_logic_packet(struct sr_dev_inst *sdi,
 				   struct dev_context *devc)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	uint8_t *logic_data;
+	size_t group, samples, offset, count;
 
-	if (!devc->logic_data)
+	/*
+	 * Assume that each channel group yields an identical number of
+	 * samples. Cope with unexpected differences by only sending the
+	 * samples which all groups have data for.
+	 */
+	samples = 0;
+	for (group = 0; group < devc->pod_count; group++) {
+		if (!devc->pod_data[group])
+			continue;
+		if (!samples || devc->pod_data[group]->len < samples)
+			samples = devc->pod_data[group]->len;
+	}
+	if (!samples)
 		return;
 
-	logic.data = devc->logic_data->data;
-	logic.length = devc->logic_data->len;
-	logic.unitsize = devc->pod_count;
+	/* Truncate acquisition if a smaller number of samples has been requested. */
+	if (devc->samples_limit > 0 && samples > devc->samples_limit)
+		samples = devc->samples_limit;
 
+	count = MIN(samples, LOGIC_PACKET_SAMPLES);
+	logic_data = g_malloc(count * devc->pod_count);
+
+	logic.data = logic_data;
+	logic.unitsize = devc->pod_count;
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 
-	sr_session_send(sdi, &packet);
+	for (offset = 0; offset < samples; offset += count) {
+		count = MIN(samples - offset, LOGIC_PACKET_SAMPLES);
+		hmo_fold_logic_data(devc, logic_data, offset, count);
+		logic.length = count * devc->pod_count;
+		sr_session_send(sdi, &packet);
+	}
+
+	g_free(logic_data);
 }
 
 /* Undo previous resource allocation. */
 SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc)
 {
+	size_t group;
 
-	if (devc->logic_data) {
-		g_byte_array_free(devc->logic_data, TRUE);
-		devc->logic_data = NULL;
+	for (group = 0; group < ARRAY_SIZE(devc->pod_data); group++) {
+		if (!devc->pod_data[group])
+			continue;
+		g_byte_array_free(devc->pod_data[group], TRUE);
+		devc->pod_data[group] = NULL;
 	}
 	/*
 	 * Keep 'pod_count'! It's required when more frames will be
@@ -1463,6 +1505,20 @@ SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc)
 	 */
 }
 
+/* Check whether more digital channel groups are pending in this frame. */
+static gboolean hmo_logic_pending(GSList *l)
+{
+	struct sr_channel *ch;
+
+	for (; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_channel *ch;
@@ -1477,6 +1533,8 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	size_t group;
+	GSList *next_channel;
+	gboolean last_channel, last_frame;
 
 	(void)fd;
 	(void)revents;
@@ -1504,18 +1562,43 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	if (devc->current_channel == devc->enabled_channels)
 		std_session_send_df_frame_begin(sdi);
 
+	/* Get the channel's data block. */
+	data = NULL;
+	if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
+		if (data)
+			g_byte_array_free(data, TRUE);
+		return TRUE;
+	}
+	if (ch->type == SR_CHANNEL_LOGIC)
+		devc->num_samples = data->len / devc->pod_count;
+	else
+		devc->num_samples = data->len / sizeof(float);
+
+	/*
+	 * Advance to the next enabled channel, or the first one of the
+	 * next frame, and request its data right away. The scope prepares
+	 * the next block while this one gets passed on. Stop acquisition
+	 * after the specified number of frames or after the specified
+	 * number of samples.
+	 */
+	next_channel = devc->current_channel->next;
+	last_channel = !next_channel;
+	last_frame = last_channel &&
+		(devc->num_frames + 1 >= devc->frame_limit ||
+		devc->num_samples >= devc->samples_limit);
+	if (!last_channel) {
+		devc->current_channel = devc->current_channel->next;
+		hmo_request_data(sdi);
+	} else if (!last_frame) {
+		devc->current_channel = devc->enabled_channels;
+		hmo_request_data(sdi);
+	}
+
 	/*
 	 * Pass on the received data of the channel(s).
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
 		packet.type = SR_DF_ANALOG;
 
 		analog.data = data->data;
@@ -1536,19 +1619,9 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		meaning.channels = g_slist_append(NULL, ch);
 		packet.payload = &analog;
 		sr_session_send(sdi, &packet);
-		devc->num_samples = data->len / sizeof(float);
 		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	case SR_CHANNEL_LOGIC:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
 		/*
 		 * If only data from the first pod is involved in the
 		 * acquisition, then the raw input bytes can get passed
@@ -1560,7 +1633,9 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		 * applies. The "queue" logic transparently copes with
 		 * any such configuration. This works around the lack
 		 * of support for "meaning" to logic data, which is used
-		 * above for analog data.
+		 * above for analog data. Combined data is sent as soon as
+		 * the last involved pod was received, which releases the
+		 * pods' memory before more channels get received.
 		 */
 		if (devc->pod_count == 1) {
 			packet.type = SR_DF_LOGIC;
@@ -1575,50 +1650,34 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		} else {
 			group = ch->index / DIGITAL_CHANNELS_PER_POD;
 			hmo_queue_logic_data(devc, group, data);
+			data = NULL;
+			if (!hmo_logic_pending(next_channel)) {
+				hmo_send_logic_packet(sdi, devc);
+				hmo_cleanup_logic_data(devc);
+			}
 		}
-
-		devc->num_samples = data->len / devc->pod_count;
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	default:
 		sr_err("Invalid channel type.");
 		break;
 	}
+	if (data)
+		g_byte_array_free(data, TRUE);
+	data = NULL;
 
 	/*
-	 * Advance to the next enabled channel. When data for all enabled
-	 * channels was received, then flush potentially queued logic data,
-	 * and send the "frame end" packet.
+	 * When data for all enabled channels was received, then send
+	 * the "frame end" packet. Logic data has been flushed already.
 	 */
-	if (devc->current_channel->next) {
-		devc->current_channel = devc->current_channel->next;
-		hmo_request_data(sdi);
+	if (!last_channel)
 		return TRUE;
-	}
-	hmo_send_logic_packet(sdi, devc);
-
-	/*
-	 * Release the logic data storage after each frame. This copes
-	 * with sample counts that differ in length per frame. -- Is
-	 * this a real constraint when acquiring multiple frames with
-	 * identical device settings?
-	 */
-	hmo_cleanup_logic_data(devc);
 
 	std_session_send_df_frame_end(sdi);
 
-	/*
-	 * End of frame was reached. Stop acquisition after the specified
-	 * number of frames or after the specified number of samples, or
-	 * continue reception by starting over at the first enabled channel.
-	 */
-	if (++devc->num_frames >= devc->frame_limit || devc->num_samples >= devc->samples_limit) {
+	devc->num_frames++;
+	if (last_frame) {
 		sr_dev_acquisition_stop(sdi);
 		hmo_cleanup_logic_data(devc);
-	} else {
-		devc->current_channel = devc->enabled_channels;
-		hmo_request_data(sdi);
 	}
 
 	return TRUE;
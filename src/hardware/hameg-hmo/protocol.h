@@ -35,6 +35,7 @@
 #define MAX_ANALOG_CHANNEL_COUNT	4
 #define MAX_DIGITAL_CHANNEL_COUNT	16
 #define MAX_DIGITAL_GROUP_COUNT		2
+#define LOGIC_PACKET_SAMPLES		(64 * 1024)
 
 struct scope_config {
 	const char *name[MAX_INSTRUMENT_VERSIONS];
@@ -130,7 +131,7 @@ struct dev_context {
 	uint64_t frame_limit;
 
 	size_t pod_count;
-	GByteArray *logic_data;
+	GByteArray *pod_data[MAX_DIGITAL_GROUP_COUNT];
 };
 
 SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi);
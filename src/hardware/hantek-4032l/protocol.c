@@ -160,8 +160,9 @@ void LIBUSB_CALL h4032l_data_transfer_callback(struct libusb_transfer *transfer)
 	struct sr_dev_inst *const sdi = transfer->user_data;
 	struct dev_context *const devc = sdi->priv;
 	uint32_t max_samples = transfer->actual_length / sizeof(uint32_t);
+	const uint32_t packet_words = H4032L_USB_PACKET_SIZE / sizeof(uint32_t);
 	uint32_t *buf;
-	uint32_t num_samples;
+	uint32_t num_samples, i;
 
 	/*
 	 * If acquisition has already ended, just free any queued up
@@ -183,6 +184,25 @@ void LIBUSB_CALL h4032l_data_transfer_callback(struct libusb_transfer *transfer)
 
 	buf = (uint32_t *)transfer->buffer;
 
+	if (devc->status == H4032L_STATUS_FIRST_TRANSFER) {
+		/*
+		 * Drop USB packets until H4032L_START_PACKET_MAGIC, a data
+		 * transfer spans several of them.
+		 */
+		for (i = 0; i < max_samples; i += packet_words) {
+			if (buf[i] == H4032L_START_PACKET_MAGIC)
+				break;
+		}
+		if (i >= max_samples) {
+			sr_dbg("Mismatch magic number of start poll.");
+			resubmit_transfer(transfer);
+			return;
+		}
+		devc->status = H4032L_STATUS_TRANSFER;
+		max_samples -= i + 1;
+		buf += i + 1;
+	}
+
 	num_samples = MIN(devc->remaining_samples, max_samples);
 	devc->remaining_samples -= num_samples;
 	send_data(sdi, buf, num_samples);
@@ -211,10 +231,7 @@ void LIBUSB_CALL h4032l_usb_callback(struct libusb_transfer *transfer)
 	struct dev_context *const devc = sdi->priv;
 	struct sr_usb_dev_inst *usb = sdi->conn;
 	gboolean cmd = FALSE;
-	uint32_t max_samples = transfer->actual_length / sizeof(uint32_t);
-	uint32_t *buf;
 	struct h4032l_status_packet *status;
-	uint32_t num_samples;
 	int ret;
 
 	/*
@@ -229,8 +246,6 @@ void LIBUSB_CALL h4032l_usb_callback(struct libusb_transfer *transfer)
 	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
 		sr_dbg("%s error: %d.", __func__, transfer->status);
 
-	buf = (uint32_t *)transfer->buffer;
-
 	switch (devc->status) {
 	case H4032L_STATUS_IDLE:
 		sr_err("USB callback called in idle.");
@@ -274,30 +289,28 @@ void LIBUSB_CALL h4032l_usb_callback(struct libusb_transfer *transfer)
 		std_session_send_df_header(sdi);
 		break;
 	case H4032L_STATUS_FIRST_TRANSFER:
-		/* Drop packets until H4032L_START_PACKET_MAGIC. */
-		if (buf[0] != H4032L_START_PACKET_MAGIC) {
-			sr_dbg("Mismatch magic number of start poll.");
-			break;
-		}
-		devc->status = H4032L_STATUS_TRANSFER;
-		max_samples--;
-		buf++;
-		/* Fallthrough. */
 	case H4032L_STATUS_TRANSFER:
-		num_samples = MIN(devc->remaining_samples, max_samples);
-		devc->remaining_samples -= num_samples;
-		send_data(sdi, buf, num_samples);
-		sr_dbg("Remaining: %d %08X %08X.", devc->remaining_samples,
-		       buf[0], buf[1]);
+		sr_err("USB callback called during data transfer.");
+		devc->status = H4032L_STATUS_IDLE;
 		break;
 	}
 
-	/* Start data receiving. */
-	if (devc->status == H4032L_STATUS_TRANSFER) {
+	/*
+	 * Start data receiving. The data transfers get queued right
+	 * after the get command, the first one to complete finds the
+	 * start of the sample data.
+	 */
+	if (devc->status == H4032L_STATUS_FIRST_TRANSFER) {
+		/* The command transfer is replaced by the data transfers. */
+		transfer->buffer = NULL;
+		libusb_free_transfer(transfer);
 		if ((ret = h4032l_start_data_transfers(sdi)) != SR_OK) {
 			sr_err("Can not start data transfers: %d", ret);
 			devc->status = H4032L_STATUS_IDLE;
+			if (devc->submitted_transfers == 0)
+				finish_acquisition(sdi);
 		}
+		return;
 	} else if (devc->status != H4032L_STATUS_IDLE) {
 		if (cmd) {
 			/* Setup new USB cmd packet, reuse transfer object. */
@@ -468,7 +481,7 @@ SR_PRIV int h4032l_dev_open(struct sr_dev_inst *sdi)
 	int ret = SR_ERR, i, device_count;
 	char connection_id[64];
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -33,8 +33,9 @@
 #define H4032L_USB_VENDOR 0x04b5
 #define H4032L_USB_PRODUCT 0x4032
 
-#define H4032L_DATA_BUFFER_SIZE (2 * 1024)
-#define H4032L_DATA_TRANSFER_MAX_NUM 32
+#define H4032L_DATA_BUFFER_SIZE (16 * 1024)
+#define H4032L_DATA_TRANSFER_MAX_NUM 16
+#define H4032L_USB_PACKET_SIZE 512
 
 #define H4043L_NUM_SAMPLES_MIN (2 * 1024)
 #define H4032L_NUM_SAMPLES_MAX (64 * 1024 * 1024)
@@ -40,6 +40,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_VDIV | SR_CONF_GET,
+	SR_CONF_CONTINUOUS | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg[] = {
@@ -188,7 +189,9 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		ch = l->data;
 		if (p < NUM_CHANNELS) {
 			devc->ch_enabled[p] = ch->enabled;
-			devc->enabled_channels = g_slist_append(devc->enabled_channels, ch);
+			if (ch->enabled)
+				devc->enabled_channels = g_slist_append(
+					devc->enabled_channels, ch);
 		}
 	}
 
@@ -238,7 +241,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -311,7 +314,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	int64_t timediff_us, timediff_ms;
 	int err;
 
 	devc = sdi->priv;
@@ -321,22 +323,9 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * for the FX2 to renumerate.
 	 */
-	err = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((err = hantek_6xxx_open(sdi)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 " ms.", timediff_ms);
-		}
-		if (timediff_ms < MAX_RENUM_DELAY_MS)
-			sr_info("Device came back after %"PRIu64" ms.", timediff_ms);
+		err = ezusb_wait_renum(sdi, devc->fw_updated,
+			EZUSB_RENUM_GONE_DELAY_MS, MAX_RENUM_DELAY_MS, hantek_6xxx_open);
 	} else {
 		err = hantek_6xxx_open(sdi);
 	}
@@ -393,6 +382,9 @@ static int config_get(uint32_t key, GVariant **data,
 		case SR_CONF_LIMIT_SAMPLES:
 			*data = g_variant_new_uint64(devc->limit_samples);
 			break;
+		case SR_CONF_CONTINUOUS:
+			*data = g_variant_new_boolean(devc->continuous);
+			break;
 		case SR_CONF_CONN:
 			if (!sdi->conn)
 				return SR_ERR_ARG;
@@ -447,6 +439,9 @@ static int config_set(uint32_t key, GVariant *data,
 		case SR_CONF_LIMIT_SAMPLES:
 			devc->limit_samples = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_CONTINUOUS:
+			devc->continuous = g_variant_get_boolean(data);
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -546,6 +541,32 @@ static uint32_t data_amount(const struct sr_dev_inst *sdi)
 	return data_left_2;
 }
 
+/*
+ * Voltage values are encoded as a value 0-255, where the value is a
+ * point in the range represented by the vdiv setting. There are 10
+ * vertical divs, so e.g. 500mV/div represents 5V peak-to-peak where
+ * 0 = -2.5V and 255 = +2.5V. The values go to the bus as they are, the
+ * encoding's scale (range / 255) and offset (-range / 2) convert them.
+ */
+static void set_encoding(struct dev_context *devc, int ch,
+		struct sr_analog_encoding *encoding, struct sr_analog_spec *spec)
+{
+	const uint64_t *vdiv;
+	float vdivlog;
+	int digits;
+
+	vdiv = devc->vdivs[devc->voltage[ch]];
+	sr_rational_set(&encoding->scale,
+		vdiv[0] * VDIV_MULTIPLIER, vdiv[1] * 255);
+	sr_rational_set(&encoding->offset,
+		-(int64_t)(vdiv[0] * VDIV_MULTIPLIER), vdiv[1] * 2);
+
+	vdivlog = log10f(RANGE(ch) / 255);
+	digits = -(int)vdivlog + (vdivlog < 0.0);
+	encoding->digits = digits;
+	spec->spec_digits = digits;
+}
+
 static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 		int num_samples)
 {
@@ -556,11 +577,15 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
+	uint8_t *data;
 
-	const float ch_bit[] = { RANGE(0) / 255, RANGE(1) / 255 };
-	const float ch_center[] = { RANGE(0) / 2, RANGE(1) / 2 };
+	if (num_samples <= 0 || !channels)
+		return;
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_signed = FALSE;
 
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
@@ -570,44 +595,139 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
 
-	analog.data = g_try_malloc(num_samples * sizeof(float));
-	if (!analog.data) {
+	/*
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's
+	 * data. However, we only send the requested channels to
+	 * the bus. With both channels on the same vdiv, the interleaved
+	 * data is sent as it came in.
+	 */
+	if (devc->ch_enabled[0] && devc->ch_enabled[1] &&
+			devc->voltage[0] == devc->voltage[1]) {
+		set_encoding(devc, 0, analog.encoding, analog.spec);
+		analog.meaning->channels = channels;
+		analog.data = buf;
+		sr_session_send(sdi, &packet);
+		return;
+	}
+
+	data = g_try_malloc(num_samples);
+	if (!data) {
 		sr_err("Analog data buffer malloc failed.");
 		devc->dev_state = STOPPING;
 		return;
 	}
+	analog.data = data;
 
 	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float vdivlog = log10f(ch_bit[ch]);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
+		set_encoding(devc, ch, analog.encoding, analog.spec);
 		analog.meaning->channels = g_slist_append(NULL, channels->data);
 
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255, where the
-			 * value is a point in the range represented by the vdiv
-			 * setting. There are 10 vertical divs, so e.g. 500mV/div
-			 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
-			 */
-			((float *)analog.data)[i] = ch_bit[ch] * *(buf + i * 2 + ch) - ch_center[ch];
-		}
+		for (int i = 0; i < num_samples; i++)
+			data[i] = buf[i * 2 + ch];
 
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
 
 		channels = channels->next;
 	}
-	g_free(analog.data);
+	g_free(data);
+}
+
+/*
+ * Continuous capture: the device keeps sampling into its FIFO, which
+ * a queue of transfers drains without gaps. The limits count samples,
+ * the time limit refers to sample time.
+ */
+static int stream_data(struct sr_usb_stream *stream, uint8_t *data,
+		size_t length, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	uint64_t limit, num_samples;
+
+	(void)stream;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	if (devc->dev_state != CAPTURE)
+		return SR_OK;
+
+	limit = devc->limit_samples;
+	if (devc->limit_msec) {
+		num_samples = devc->limit_msec * devc->samplerate / 1000;
+		if (!limit || num_samples < limit)
+			limit = num_samples;
+	}
+
+	num_samples = length / NUM_CHANNELS;
+	if (limit)
+		num_samples = MIN(num_samples, limit - devc->samp_received);
+	send_chunk(sdi, data, num_samples);
+	devc->samp_received += num_samples;
+
+	if (limit && devc->samp_received >= limit) {
+		sr_info("Requested limit reached, stopping.");
+		devc->dev_state = STOPPING;
+	}
+
+	return SR_OK;
+}
+
+static void stream_done(struct sr_usb_stream *stream, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct drv_context *drvc;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+	drvc = sdi->driver->context;
+
+	sr_usb_stream_free(stream);
+	devc->stream = NULL;
+
+	usb_source_remove(sdi->session, drvc->sr_ctx);
+	std_session_send_df_end(sdi);
+
+	devc->dev_state = IDLE;
+}
+
+static int start_stream(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct sr_usb_stream_config cfg;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.endpoint = HANTEK_EP_IN;
+	cfg.bytes_per_sec = devc->samplerate * NUM_CHANNELS;
+	cfg.sdi = sdi;
+	cfg.data_cb = stream_data;
+	cfg.done_cb = stream_done;
+	cfg.cb_data = (void *)sdi;
+
+	if (!(devc->stream = sr_usb_stream_new(usb->devhdl, &cfg)))
+		return SR_ERR;
+
+	if ((ret = sr_usb_stream_start(devc->stream)) != SR_OK) {
+		/* Nothing got submitted, so the stream won't finish by itself. */
+		if (!devc->stream->submitted) {
+			sr_usb_stream_free(devc->stream);
+			devc->stream = NULL;
+		}
+		return ret;
+	}
+
+	return SR_OK;
 }
 
 /*
@@ -629,7 +749,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		libusb_free_transfer(transfer);
 		devc->dev_state = CAPTURE;
 		devc->aq_started = g_get_monotonic_time();
-		read_channel(sdi, data_amount(sdi));
+		if (!devc->continuous)
+			read_channel(sdi, data_amount(sdi));
+		else if (start_stream(sdi) != SR_OK)
+			devc->dev_state = STOPPING;
 		return;
 	}
 
@@ -710,6 +833,14 @@ static int handle_event(int fd, int revents, void *cb_data)
 		sr_dbg("Stopping acquisition.");
 
 		hantek_6xxx_stop_data_collecting(sdi);
+
+		if (devc->stream) {
+			/* SR_DF_END goes out once the transfers are back. */
+			devc->dev_state = DRAINING;
+			sr_usb_stream_abort(devc->stream);
+			return TRUE;
+		}
+
 		/*
 		 * TODO: Doesn't really cancel pending transfers so they might
 		 * come in after SR_DF_END is sent.
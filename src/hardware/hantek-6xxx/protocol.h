@@ -92,6 +92,8 @@ enum states {
 	FLUSH,
 	CAPTURE,
 	STOPPING,
+	/* Waiting for the stream's transfers to come back. */
+	DRAINING,
 };
 
 enum couplings {
@@ -145,6 +147,10 @@ struct dev_context {
 
 	uint64_t limit_msec;
 	uint64_t limit_samples;
+
+	/* Stream continuously instead of reading blocks. */
+	gboolean continuous;
+	struct sr_usb_stream *stream;
 };
 
 SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi);
@@ -294,7 +294,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek DSO devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -642,8 +642,48 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
-static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
-		int num_samples)
+/*
+ * Voltage values are encoded as a value 0-255 (0-512 on the DSO-5200*),
+ * where the value is a point in the range represented by the vdiv
+ * setting. There are 8 vertical divs, so e.g. 500mV/div represents 4V
+ * peak-to-peak where 0 = -2V and 255 = +2V. The values go to the bus as
+ * they are, the encoding's scale (range / 255) and offset (-range / 2)
+ * convert them.
+ */
+static void set_encoding(const struct dev_context *devc, int ch,
+		struct sr_analog_encoding *encoding, struct sr_analog_spec *spec)
+{
+	const uint64_t *vdiv;
+	float range, vdivlog;
+	int digits;
+
+	vdiv = vdivs[devc->voltage[ch]];
+	sr_rational_set(&encoding->scale, vdiv[0] * 8, vdiv[1] * 255);
+	sr_rational_set(&encoding->offset, -(int64_t)(vdiv[0] * 4), vdiv[1]);
+
+	range = ((float)vdiv[0] / vdiv[1]) * 8;
+	vdivlog = log10f(range / 255);
+	digits = -(int)vdivlog + (vdivlog < 0.0);
+	encoding->digits = digits;
+	spec->spec_digits = digits;
+}
+
+/*
+ * Send a downloaded frame to the session bus.
+ *
+ * The device always sends a full frame, but the beginning of the frame
+ * doesn't represent the trigger point. The offset at which the trigger
+ * happened came in with the capture state, so the frame is sent from
+ * there on. The samples in the frame buffer before that trigger point
+ * came after the end of the device's frame buffer was reached, and it
+ * wrapped around to overwrite up until the trigger point. They go last.
+ *
+ * The device always sends data for both channels. If a channel is
+ * disabled, it contains a copy of the enabled channel's data. However,
+ * we only send the requested channels to the bus. Both channels are
+ * split off in one pass over the frame.
+ */
+static void send_frame(const struct sr_dev_inst *sdi)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -652,147 +692,111 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
+	const uint8_t *frame;
+	uint8_t *data, *ch_data[NUM_CHANNELS];
+	unsigned int framesize, start, i, j;
+
+	framesize = devc->framesize;
+	frame = devc->framebuf;
+	start = (devc->trigger_offset < framesize) ? devc->trigger_offset : 0;
+	sr_dbg("Sending frame of %u samples, trigger point at %u.",
+		framesize, start);
+
+	if (!channels)
+		return;
+
+	data = g_try_malloc(framesize * NUM_CHANNELS);
+	if (!data) {
+		sr_err("Analog data buffer malloc failed.");
+		return;
+	}
+	ch_data[0] = data;
+	ch_data[1] = data + framesize;
+
+	/* TODO: Support for DSO-5xxx series 9-bit samples. */
+	for (i = 0, j = start; i < framesize; i++) {
+		ch_data[0][i] = frame[j * 2 + 1];
+		ch_data[1][i] = frame[j * 2];
+		if (++j == framesize)
+			j = 0;
+	}
 
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
-	/* TODO: support for 5xxx series 9-bit samples */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-	analog.num_samples = num_samples;
+	analog.encoding->unitsize = sizeof(uint8_t);
+	analog.encoding->is_float = FALSE;
+	analog.encoding->is_signed = FALSE;
+	analog.num_samples = framesize;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(num_samples * sizeof(float));
 
 	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
-		float vdivlog = log10f(range / 255);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
+		set_encoding(devc, ch, analog.encoding, analog.spec);
 		analog.meaning->channels = g_slist_append(NULL, channels->data);
-
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255 (0-512 on the
-			 * DSO-5200*), where the value is a point in the range
-			 * represented by the vdiv setting. There are 8 vertical divs,
-			 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
-			 * and 255 = +2V.
-			 */
-			/* TODO: Support for DSO-5xxx series 9-bit samples. */
-			((float *)analog.data)[i] = range / 255 * *(buf + i * 2 + 1 - ch) - range / 2;
-		}
+		analog.data = ch_data[ch];
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
 
 		channels = channels->next;
 	}
-	g_free(analog.data);
+	g_free(data);
 }
 
 /*
  * Called by libusb (as triggered by handle_event()) when a transfer comes in.
  * Only channel data comes in asynchronously, and all transfers for this are
- * queued up beforehand, so this just needs to chuck the incoming data onto
- * the libsigrok session bus.
+ * queued up beforehand, straight into the frame buffer. Once they are all
+ * back, handle_event() arms the next capture and sends the frame.
  */
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	int num_samples, pre;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 	sr_spew("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
-	if (transfer->actual_length == 0)
-		/* Nothing to send to the bus. */
-		return;
-
-	num_samples = transfer->actual_length / 2;
+	devc->samp_received += transfer->actual_length / 2;
+	libusb_free_transfer(transfer);
 
-	sr_spew("Got %d-%d/%d samples in frame.", devc->samp_received + 1,
-		devc->samp_received + num_samples, devc->framesize);
+	if (--devc->transfers_pending > 0 || devc->dev_state != FETCH_DATA)
+		return;
 
-	/*
-	 * The device always sends a full frame, but the beginning of the frame
-	 * doesn't represent the trigger point. The offset at which the trigger
-	 * happened came in with the capture state, so we need to start sending
-	 * from there up the session bus. The samples in the frame buffer
-	 * before that trigger point came after the end of the device's frame
-	 * buffer was reached, and it wrapped around to overwrite up until the
-	 * trigger point.
-	 */
-	if (devc->samp_received < devc->trigger_offset) {
-		/* Trigger point not yet reached. */
-		if (devc->samp_received + num_samples < devc->trigger_offset) {
-			/* The entire chunk is before the trigger point. */
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, num_samples * 2);
-			devc->samp_buffered += num_samples;
-		} else {
-			/*
-			 * This chunk hits or overruns the trigger point.
-			 * Store the part before the trigger fired, and
-			 * send the rest up to the session bus.
-			 */
-			pre = devc->trigger_offset - devc->samp_received;
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, pre * 2);
-			devc->samp_buffered += pre;
-
-			/* The rest of this chunk starts with the trigger point. */
-			sr_dbg("Reached trigger point, %d samples buffered.",
-				devc->samp_buffered);
-
-			/* Avoid the corner case where the chunk ended at
-			 * exactly the trigger point. */
-			if (num_samples > pre)
-				send_chunk(sdi, transfer->buffer + pre * 2,
-						num_samples - pre);
-		}
-	} else {
-		/* Already past the trigger point, just send it all out. */
-		send_chunk(sdi, transfer->buffer, num_samples);
+	if (devc->samp_received < devc->framesize) {
+		sr_warn("Short frame, %u of %u samples, dropped.",
+			devc->samp_received, devc->framesize);
+		std_session_send_df_frame_end(sdi);
+		devc->dev_state = NEW_CAPTURE;
+		return;
 	}
 
-	devc->samp_received += num_samples;
-
-	/* Everything in this transfer was either copied to the buffer or
-	 * sent to the session bus. */
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	devc->dev_state = FRAME_READY;
+}
 
-	if (devc->samp_received >= devc->framesize) {
-		/* That was the last chunk in this frame. Send the buffered
-		 * pre-trigger samples out now, in one big chunk. */
-		sr_dbg("End of frame, sending %d pre-trigger buffered samples.",
-			devc->samp_buffered);
-		send_chunk(sdi, devc->framebuf, devc->samp_buffered);
-		g_free(devc->framebuf);
-		devc->framebuf = NULL;
+static int arm_capture(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
 
-		/* Mark the end of this frame. */
-		std_session_send_df_frame_end(sdi);
+	devc = sdi->priv;
 
-		if (devc->limit_frames && ++devc->num_frames >= devc->limit_frames) {
-			/* Terminate session */
-			devc->dev_state = STOPPING;
-		} else {
-			devc->dev_state = NEW_CAPTURE;
-		}
+	if (dso_capture_start(sdi) != SR_OK)
+		return SR_ERR;
+	if (dso_enable_trigger(sdi) != SR_OK)
+		return SR_ERR;
+	if (!devc->triggersource) {
+		if (dso_force_trigger(sdi) != SR_OK)
+			return SR_ERR;
 	}
+	sr_dbg("Successfully requested next chunk.");
+
+	return SR_OK;
 }
 
 static int handle_event(int fd, int revents, void *cb_data)
@@ -802,9 +806,9 @@ static int handle_event(int fd, int revents, void *cb_data)
 	struct sr_dev_driver *di;
 	struct dev_context *devc;
 	struct drv_context *drvc;
-	int num_channels;
 	uint32_t trigger_offset;
 	uint8_t capturestate;
+	gboolean last_frame;
 
 	(void)fd;
 	(void)revents;
@@ -813,37 +817,55 @@ static int handle_event(int fd, int revents, void *cb_data)
 	di = sdi->driver;
 	drvc = di->context;
 	devc = sdi->priv;
+
+	/* Always handle pending libusb events. */
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+
 	if (devc->dev_state == STOPPING) {
+		/* Transfers still write to the frame buffer, or time out. */
+		if (devc->transfers_pending)
+			return TRUE;
+
 		/* We've been told to wind up the acquisition. */
 		sr_dbg("Stopping acquisition.");
-		/*
-		 * TODO: Doesn't really cancel pending transfers so they might
-		 * come in after SR_DF_END is sent.
-		 */
 		usb_source_remove(sdi->session, drvc->sr_ctx);
 
 		std_session_send_df_end(sdi);
 
+		g_free(devc->framebuf);
+		devc->framebuf = NULL;
 		devc->dev_state = IDLE;
 
 		return TRUE;
 	}
 
-	/* Always handle pending libusb events. */
-	tv.tv_sec = tv.tv_usec = 0;
-	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+	if (devc->dev_state == FRAME_READY) {
+		/*
+		 * The frame is in host memory, so the device can get on with
+		 * the next capture while this one goes to the session bus.
+		 */
+		last_frame = devc->limit_frames &&
+			devc->num_frames + 1 >= devc->limit_frames;
+		if (!last_frame && arm_capture(sdi) != SR_OK) {
+			/* Try again next time, the frame waits. */
+			return TRUE;
+		}
+
+		send_frame(sdi);
+
+		/* Mark the end of this frame. */
+		std_session_send_df_frame_end(sdi);
+
+		devc->num_frames++;
+		devc->dev_state = last_frame ? STOPPING : CAPTURE;
+		return TRUE;
+	}
 
 	/* TODO: ugh */
 	if (devc->dev_state == NEW_CAPTURE) {
-		if (dso_capture_start(sdi) != SR_OK)
+		if (arm_capture(sdi) != SR_OK)
 			return TRUE;
-		if (dso_enable_trigger(sdi) != SR_OK)
-			return TRUE;
-		if (!devc->triggersource) {
-			if (dso_force_trigger(sdi) != SR_OK)
-				return TRUE;
-		}
-		sr_dbg("Successfully requested next chunk.");
 		devc->dev_state = CAPTURE;
 		return TRUE;
 	}
@@ -859,15 +881,7 @@ static int handle_event(int fd, int revents, void *cb_data)
 	case CAPTURE_EMPTY:
 		if (++devc->capture_empty_count >= MAX_CAPTURE_EMPTY) {
 			devc->capture_empty_count = 0;
-			if (dso_capture_start(sdi) != SR_OK)
-				break;
-			if (dso_enable_trigger(sdi) != SR_OK)
-				break;
-			if (!devc->triggersource) {
-				if (dso_force_trigger(sdi) != SR_OK)
-					break;
-			}
-			sr_dbg("Successfully requested next chunk.");
+			arm_capture(sdi);
 		}
 		break;
 	case CAPTURE_FILLING:
@@ -878,17 +892,19 @@ static int handle_event(int fd, int revents, void *cb_data)
 		/* Remember where in the captured frame the trigger is. */
 		devc->trigger_offset = trigger_offset;
 
-		num_channels = (devc->ch_enabled[0] && devc->ch_enabled[1]) ? 2 : 1;
-		devc->framebuf = g_malloc(devc->framesize * num_channels * 2);
-		devc->samp_buffered = devc->samp_received = 0;
+		devc->framebuf = g_realloc(devc->framebuf, devc->framesize * 2);
+		devc->samp_received = 0;
 
 		/* Tell the scope to send us the first frame. */
-		if (dso_get_channeldata(sdi, receive_transfer) != SR_OK)
+		if (dso_get_channeldata(sdi, receive_transfer) != SR_OK &&
+				!devc->transfers_pending)
 			break;
 
 		/*
 		 * Don't hit the state machine again until we're done fetching
-		 * the data we just told the scope to send.
+		 * the data we just told the scope to send. Should the request
+		 * have failed halfway, the frame comes up short and gets
+		 * dropped.
 		 */
 		devc->dev_state = FETCH_DATA;
 
@@ -117,7 +117,7 @@ SR_PRIV int dso_open(struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -895,9 +895,9 @@ SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct libusb_transfer *transfer;
-	int num_transfers, ret, i;
+	size_t frame_bytes, chunk, offset, len;
+	int ret;
 	uint8_t cmdstring[2];
-	unsigned char *buf;
 
 	sr_dbg("Sending CMD_GET_CHANNELDATA.");
 
@@ -913,26 +913,26 @@ SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
 		return SR_ERR;
 	}
 
-	/* TODO: DSO-2xxx only. */
-	num_transfers = devc->framesize *
-			sizeof(unsigned short) / devc->epin_maxpacketsize;
-	sr_dbg("Queueing up %d transfers.", num_transfers);
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(devc->epin_maxpacketsize))) {
-			sr_err("Failed to malloc USB endpoint buffer.");
-			return SR_ERR_MALLOC;
-		}
+	/*
+	 * The frame comes straight into the frame buffer, in transfers
+	 * of several packets each.
+	 * TODO: DSO-2xxx only.
+	 */
+	frame_bytes = devc->framesize * sizeof(unsigned short);
+	chunk = devc->epin_maxpacketsize * FRAME_TRANSFER_PACKETS;
+	sr_dbg("Queueing up %zu transfers.", (frame_bytes + chunk - 1) / chunk);
+	for (offset = 0; offset < frame_bytes; offset += len) {
+		len = MIN(chunk, frame_bytes - offset);
 		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl, DSO_EP_IN, buf,
-				devc->epin_maxpacketsize, cb, (void *)sdi, 40);
+		libusb_fill_bulk_transfer(transfer, usb->devhdl, DSO_EP_IN,
+				devc->framebuf + offset, len, cb, (void *)sdi, 40);
 		if ((ret = libusb_submit_transfer(transfer)) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
-			/* TODO: Free them all. */
 			libusb_free_transfer(transfer);
-			g_free(buf);
 			return SR_ERR;
 		}
+		devc->transfers_pending++;
 	}
 
 	return SR_OK;
@@ -54,6 +54,9 @@
 
 #define NUM_CHANNELS            2
 
+/* Frame data comes in transfers of up to this many packets. */
+#define FRAME_TRANSFER_PACKETS  32
+
 enum control_requests {
 	CTRL_READ_EEPROM = 0xa2,
 	CTRL_GETSPEED = 0xb2,
@@ -158,6 +161,8 @@ enum states {
 	NEW_CAPTURE,
 	CAPTURE,
 	FETCH_DATA,
+	/* Frame downloaded, waiting to be sent once the next one is armed. */
+	FRAME_READY,
 	STOPPING,
 };
 
@@ -209,9 +214,9 @@ struct dev_context {
 
 	/* Frame transfer */
 	unsigned int samp_received;
-	unsigned int samp_buffered;
 	unsigned int trigger_offset;
 	unsigned char *framebuf;
+	unsigned int transfers_pending;
 };
 
 SR_PRIV int dso_open(struct sr_dev_inst *sdi);
@@ -135,6 +135,9 @@ SR_PRIV int ipdbg_la_tcp_open(struct ipdbg_la_tcp *tcp)
 		return SR_ERR;
 	}
 
+	/* Commands are single bytes, don't let Nagle hold them back. */
+	(void)sr_tcp_set_sock_opts(tcp->socket);
+
 	return SR_OK;
 }
 
@@ -221,7 +224,9 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 
 	devc->num_stages = 0;
 	devc->num_transfers = 0;
+	devc->sent_samples = 0;
 	devc->raw_sample_buf = NULL;
+	devc->raw_sample_fill = 0;
 
 	for (uint64_t i = 0; i < devc->data_width_bytes; i++) {
 		devc->trigger_mask[i] = 0;
@@ -279,6 +284,47 @@ SR_PRIV int ipdbg_la_convert_trigger(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/*
+ * Send the complete samples in the receive buffer, and the trigger
+ * when it gets passed. An incomplete sample moves to the buffer start.
+ */
+static void send_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t num_samples, count;
+	size_t offset;
+
+	devc = sdi->priv;
+	num_samples = devc->raw_sample_fill / devc->data_width_bytes;
+	offset = 0;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = devc->data_width_bytes;
+
+	while (num_samples) {
+		count = num_samples;
+		if (devc->sent_samples < devc->delay_value)
+			count = MIN(count, devc->delay_value - devc->sent_samples);
+		else if (devc->sent_samples == devc->delay_value)
+			std_session_send_df_trigger(sdi);
+
+		logic.length = count * devc->data_width_bytes;
+		logic.data = devc->raw_sample_buf + offset;
+		sr_session_send(sdi, &packet);
+
+		devc->sent_samples += count;
+		offset += logic.length;
+		num_samples -= count;
+	}
+
+	devc->raw_sample_fill -= offset;
+	memmove(devc->raw_sample_buf, devc->raw_sample_buf + offset,
+		devc->raw_sample_fill);
+}
+
 SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
@@ -295,64 +341,36 @@ SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 
 	struct ipdbg_la_tcp *tcp = sdi->conn;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
+	const uint64_t limit_bytes = devc->limit_samples * devc->data_width_bytes;
 
 	if (!devc->raw_sample_buf) {
-		devc->raw_sample_buf =
-			g_try_malloc(devc->limit_samples * devc->data_width_bytes);
+		devc->raw_sample_buf = g_try_malloc(RECV_BUFSIZE);
 		if (!devc->raw_sample_buf) {
 			sr_err("Sample buffer malloc failed.");
 			return FALSE;
 		}
+		devc->raw_sample_fill = 0;
 	}
 
 	if (devc->num_transfers <
 		(devc->limit_samples_max * devc->data_width_bytes)) {
-		const size_t bufsize = 1024;
-		uint8_t buffer[bufsize];
-
-		const int recd = ipdbg_la_tcp_receive(tcp, buffer, bufsize);
-		if ( recd > 0) {
-			int num_move = (((devc->num_transfers + recd) <=
-							 (devc->limit_samples * devc->data_width_bytes))
-			?
-				recd
-			:
-				(int)((devc->limit_samples * devc->data_width_bytes) -
-						devc->num_transfers));
-			if ( num_move > 0 )
-				memcpy(&(devc->raw_sample_buf[devc->num_transfers]),
-						buffer, num_move);
+		/*
+		 * Receive straight into the sample buffer, and send the
+		 * samples right away. The device always sends its whole
+		 * memory, data after the requested samples is dropped.
+		 */
+		const int recd = ipdbg_la_tcp_receive(tcp,
+			devc->raw_sample_buf + devc->raw_sample_fill,
+			RECV_BUFSIZE - devc->raw_sample_fill);
+		if (recd > 0) {
+			if (devc->num_transfers < limit_bytes) {
+				devc->raw_sample_fill += MIN((uint64_t)recd,
+					limit_bytes - devc->num_transfers);
+				send_samples(sdi);
+			}
 			devc->num_transfers += recd;
 		}
 	} else {
-		if (devc->delay_value > 0) {
-			/* There are pre-trigger samples, send those first. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = devc->delay_value * devc->data_width_bytes;
-			logic.unitsize = devc->data_width_bytes;
-			logic.data = devc->raw_sample_buf;
-			sr_session_send(cb_data, &packet);
-		}
-
-		/* Send the trigger. */
-		std_session_send_df_trigger(cb_data);
-
-		/* Send post-trigger samples. */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = (devc->limit_samples - devc->delay_value) *
-			devc->data_width_bytes;
-		logic.unitsize = devc->data_width_bytes;
-		logic.data = devc->raw_sample_buf +
-			(devc->delay_value * devc->data_width_bytes);
-		sr_session_send(cb_data, &packet);
-
-		g_free(devc->raw_sample_buf);
-		devc->raw_sample_buf = NULL;
-
 		ipdbg_la_abort_acquisition(sdi);
 	}
 
@@ -555,6 +573,10 @@ SR_PRIV int ipdbg_la_request_id(struct ipdbg_la_tcp *tcp)
 SR_PRIV void ipdbg_la_abort_acquisition(const struct sr_dev_inst *sdi)
 {
 	struct ipdbg_la_tcp *tcp = sdi->conn;
+	struct dev_context *devc = sdi->priv;
+
+	g_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = NULL;
 
 	sr_session_source_remove(sdi->session, tcp->socket);
 
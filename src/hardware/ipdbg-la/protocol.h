@@ -27,6 +27,9 @@
 
 #define LOG_PREFIX "ipdbg-la"
 
+/* Size of the receive buffer, samples get sent as they arrive. */
+#define RECV_BUFSIZE (64 * 1024)
+
 struct ipdbg_la_tcp {
 	char *address;
 	char *port;
@@ -51,7 +54,9 @@ struct dev_context {
 	uint64_t delay_value;
 	int num_stages;
 	uint64_t num_transfers;
+	uint64_t sent_samples;
 	uint8_t *raw_sample_buf;
+	size_t raw_sample_fill;
 };
 
 SR_PRIV struct ipdbg_la_tcp *ipdbg_la_tcp_new(void);
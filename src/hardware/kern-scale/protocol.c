@@ -37,6 +37,8 @@ static void handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi,
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct dev_context *devc;
+	struct sr_serial_dev_inst *serial;
+	int64_t timestamp;
 
 	scale = (struct scale_info *)sdi->driver;
 
@@ -48,6 +50,9 @@ static void handle_packet(const uint8_t *buf, struct sr_dev_inst *sdi,
 	analog.meaning->channels = sdi->channels;
 	analog.num_samples = 1;
 	analog.meaning->mq = 0;
+	serial = sdi->conn;
+	timestamp = serial->rx_time;
+	analog.timestamps = &timestamp;
 
 	scale->packet_parse(buf, &floatval, &analog, info);
 	analog.data = &floatval;
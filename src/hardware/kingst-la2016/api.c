@@ -313,7 +313,7 @@ static int la2016_identify_enum(struct sr_dev_inst *sdi)
 	drvc = di->context;
 	ctx = drvc->sr_ctx;;
 
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx->libusb_ctx, &devlist);
 	if (ret < 0)
 		return SR_ERR_IO;
 	device_count = ret;
@@ -344,32 +344,15 @@ static int la2016_identify_enum(struct sr_dev_inst *sdi)
 static int la2016_identify_wait(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	uint64_t reset_done, now, elapsed_ms;
 	int ret;
 
 	devc = sdi->priv;
 
-	sr_info("Waiting for device to reset after firmware upload.");
-	now = g_get_monotonic_time();
-	reset_done = devc->fw_uploaded + RENUM_GONE_DELAY_MS * 1000;
-	if (now < reset_done)
-		g_usleep(reset_done - now);
-	do {
-		now = g_get_monotonic_time();
-		elapsed_ms = (now - devc->fw_uploaded) / 1000;
-		sr_spew("Waited %" PRIu64 "ms.", elapsed_ms);
-		ret = la2016_identify_enum(sdi);
-		if (ret == SR_OK) {
-			devc->fw_uploaded = 0;
-			break;
-		}
-		g_usleep(RENUM_POLL_INTERVAL_MS * 1000);
-	} while (elapsed_ms < RENUM_CHECK_PERIOD_MS);
-	if (ret != SR_OK) {
-		sr_err("Device failed to re-enumerate.");
+	ret = ezusb_wait_renum(sdi, devc->fw_uploaded, RENUM_GONE_DELAY_MS,
+		RENUM_CHECK_PERIOD_MS, la2016_identify_enum);
+	if (ret != SR_OK)
 		return ret;
-	}
-	sr_info("Device came back after %" PRIi64 "ms.", elapsed_ms);
+	devc->fw_uploaded = 0;
 
 	return SR_OK;
 }
@@ -393,7 +376,7 @@ static int la2016_open_enum(struct sr_dev_inst *sdi)
 	drvc = di->context;
 	ctx = drvc->sr_ctx;;
 
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx->libusb_ctx, &devlist);
 	if (ret < 0)
 		return SR_ERR_IO;
 	device_count = ret;
@@ -479,7 +462,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 	found_devices = NULL;
 	renum_devices = NULL;
-	ret = libusb_get_device_list(ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(ctx->libusb_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Cannot get device list: %s.", libusb_error_name(ret));
 		return devices;
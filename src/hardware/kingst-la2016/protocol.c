@@ -1257,13 +1257,18 @@ static int la2016_stop_acquisition(const struct sr_dev_inst *sdi)
 
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	int ret;
 
+	devc = sdi->priv;
+
 	ret = la2016_stop_acquisition(sdi);
 	if (ret != SR_OK)
 		return ret;
 
 	(void)la2016_usbxfer_cancel_all(sdi);
+	sr_usb_decoder_finish(devc->decoder);
+	devc->decoder = NULL;
 
 	return SR_OK;
 }
@@ -1319,9 +1324,63 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 		return ret;
 	}
 
+	/*
+	 * Decode in a separate thread while the download is running.
+	 * Transfer callbacks only run from the receive callback, which
+	 * is why the thread can still start after the bulk transfers.
+	 */
+	devc->decoder = sr_usb_decoder_new(devc->transfer_bufsize,
+		LA2016_DECODE_BUFSZ / devc->transfer_bufsize,
+		decode_chunk_cb, (void *)sdi);
+
 	return SR_OK;
 }
 
+/* Send a batch of RLE records, mark the trigger position within it. */
+static void send_rle_batch(struct sr_dev_inst *sdi,
+	size_t num_runs, uint64_t num_samples)
+{
+	struct dev_context *devc;
+	const uint8_t *values;
+	const size_t *counts;
+	size_t unit_size, pre_runs, idx;
+	uint64_t pre_samples;
+
+	devc = sdi->priv;
+	values = devc->rle.values;
+	counts = devc->rle.counts;
+	unit_size = devc->model->channel_count / 8;
+	sr_sw_limits_update_samples_read(&devc->sw_limits, num_samples);
+
+	if (devc->trigger_involved && !devc->trigger_marked) {
+		if (devc->n_reps_until_trigger > num_runs) {
+			devc->n_reps_until_trigger -= num_runs;
+		} else {
+			pre_runs = devc->n_reps_until_trigger;
+			pre_samples = 0;
+			for (idx = 0; idx < pre_runs; idx++)
+				pre_samples += counts[idx];
+			feed_queue_logic_submit_runs(devc->feed_queue,
+				values, counts, pre_runs);
+			devc->total_samples += pre_samples;
+			feed_queue_logic_send_trigger(devc->feed_queue);
+			devc->trigger_marked = TRUE;
+			devc->n_reps_until_trigger = 0;
+			sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
+				devc->total_samples,
+				(double)devc->total_samples / devc->samplerate * 1e3);
+			values += pre_runs * unit_size;
+			counts += pre_runs;
+			num_runs -= pre_runs;
+			num_samples -= pre_samples;
+		}
+	}
+
+	feed_queue_logic_submit_runs(devc->feed_queue,
+		values, counts, num_runs);
+	devc->total_samples += num_samples;
+}
+
 /*
  * A chunk of sample memory was received via USB. These chunks contain
  * transfers of 16 or 32 bytes each (model dependent size and layout).
@@ -1342,21 +1401,26 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
  * - 2x u8 sequence number (inverted, and normal)
  *
  * This implementation silently ignores the (weak) sequence number.
+ *
+ * Records get collected in batches, the pin values are kept in their
+ * little endian wire format which matches the session feed's layout.
+ * The feed queue, the sample count limit and the trigger position get
+ * updated once per batch.
  */
-static void send_chunk(struct sr_dev_inst *sdi,
+static void decode_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
-	size_t num_xfers, num_pkts, num_seqs;
+	size_t num_xfers, batch_xfers, num_pkts, num_runs, unit_size;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint8_t *wp;
+	size_t *counts;
+	uint64_t num_samples;
 
 	devc = sdi->priv;
 
-	/* Ignore incoming USB data after complete sample data download. */
-	if (devc->download_finished)
+	/* Ignore data which was received after the limit was reached. */
+	if (g_atomic_int_get(&devc->limit_reached))
 		return;
 
 	if (devc->trigger_involved && !devc->trigger_marked && devc->info.n_rep_packets_before_trigger == 0) {
@@ -1364,53 +1428,78 @@ static void send_chunk(struct sr_dev_inst *sdi,
 		devc->trigger_marked = TRUE;
 	}
 
+	/* Process the received chunk of capture data. */
+	unit_size = devc->model->channel_count / 8;
+	rp = data_buffer;
+	num_xfers = data_length / devc->transfer_size;
+	while (num_xfers) {
+		batch_xfers = LA2016_RLE_BATCH_SIZE / devc->packets_per_chunk;
+		batch_xfers = MIN(batch_xfers, num_xfers);
+		num_xfers -= batch_xfers;
+		wp = devc->rle.values;
+		counts = devc->rle.counts;
+		num_samples = 0;
+		while (batch_xfers--) {
+			num_pkts = devc->packets_per_chunk;
+			while (num_pkts--) {
+				memcpy(wp, rp, unit_size);
+				wp += unit_size;
+				rp += unit_size;
+				*counts = *rp++;
+				num_samples += *counts++;
+			}
+			/* Skip the sequence number bytes. */
+			rp += devc->sequence_size;
+		}
+		num_runs = counts - devc->rle.counts;
+		send_rle_batch(sdi, num_runs, num_samples);
+	}
+
+	if (sr_sw_limits_check(&devc->sw_limits)) {
+		sr_dbg("Acquisition limit reached.");
+		g_atomic_int_set(&devc->limit_reached, TRUE);
+	}
+	sr_dbg("Total samples after chunk: %" PRIu64 ".", devc->total_samples);
+}
+
+/* Routine of the decoding thread, see la2016_start_download(). */
+static void decode_chunk_cb(const uint8_t *data, size_t length, void *cb_data)
+{
+	decode_chunk(cb_data, data, length);
+}
+
+/*
+ * Account a received chunk of capture data, and have it decoded. The
+ * decoding thread does that when it is running, the transfer then gets
+ * a spare buffer and can be resubmitted before the data was decoded.
+ */
+static void send_chunk(struct sr_dev_inst *sdi,
+	struct libusb_transfer *transfer)
+{
+	struct dev_context *devc;
+	size_t data_length;
+
+	devc = sdi->priv;
+
+	/* Ignore incoming USB data after complete sample data download. */
+	if (devc->download_finished)
+		return;
+
 	/*
 	 * Adjust the number of remaining bytes to read from the device
 	 * before the processing of the currently received chunk affects
 	 * the variable which holds the number of received bytes.
 	 */
+	data_length = transfer->actual_length;
 	if (data_length > devc->n_bytes_to_read)
 		devc->n_bytes_to_read = 0;
 	else
 		devc->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
-	sample_value = 0;
-	rp = data_buffer;
-	num_xfers = data_length / devc->transfer_size;
-	while (num_xfers--) {
-		num_pkts = devc->packets_per_chunk;
-		while (num_pkts--) {
-
-			if (devc->model->channel_count == 32)
-				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
-				sample_value = read_u16le_inc(&rp);
-			repetitions = read_u8_inc(&rp);
-
-			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, repetitions);
-			sr_sw_limits_update_samples_read(&devc->sw_limits,
-				repetitions);
-
-			if (devc->trigger_involved && !devc->trigger_marked) {
-				if (!--devc->n_reps_until_trigger) {
-					feed_queue_logic_send_trigger(devc->feed_queue);
-					devc->trigger_marked = TRUE;
-					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
-						devc->total_samples,
-						(double)devc->total_samples / devc->samplerate * 1e3);
-				}
-			}
-		}
-		/* Skip the sequence number bytes. */
-		num_seqs = devc->sequence_size;
-		while (num_seqs--)
-			(void)read_u8_inc(&rp);
-	}
+	if (devc->decoder)
+		sr_usb_decoder_push(devc->decoder, transfer);
+	else
+		decode_chunk(sdi, transfer->buffer, data_length);
 
 	/*
 	 * Check for several conditions which shall terminate the
@@ -1424,15 +1513,12 @@ static void send_chunk(struct sr_dev_inst *sdi,
 		sr_dbg("%" PRIu32 " more bytes to download from the device.",
 			devc->n_bytes_to_read);
 	}
-	if (!devc->download_finished && sr_sw_limits_check(&devc->sw_limits)) {
-		sr_dbg("Acquisition limit reached.");
+	if (g_atomic_int_get(&devc->limit_reached))
 		devc->download_finished = TRUE;
-	}
-	if (devc->download_finished) {
+	if (devc->download_finished && !devc->decoder) {
 		sr_dbg("Download finished, flushing session feed queue.");
 		feed_queue_logic_flush(devc->feed_queue);
 	}
-	sr_dbg("Total samples after chunk: %" PRIu64 ".", devc->total_samples);
 }
 
 /*
@@ -1570,7 +1656,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	if (devc->continuous)
 		stream_data(sdi, transfer->buffer, transfer->actual_length);
 	else
-		send_chunk(sdi, transfer->buffer, transfer->actual_length);
+		send_chunk(sdi, transfer);
 
 	/*
 	 * Re-submit completed transfers (regardless of timeout or
@@ -1642,6 +1728,7 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		devc->sw_limits.limit_msec = 0;
 		devc->completion_seen = TRUE;
 		devc->download_finished = FALSE;
+		g_atomic_int_set(&devc->limit_reached, FALSE);
 		devc->trigger_marked = FALSE;
 		devc->total_samples = 0;
 
@@ -1694,6 +1781,10 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		memset(&tv, 0, sizeof(tv));
 		libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
+		/* Wait for the decoding of all received data. */
+		sr_usb_decoder_finish(devc->decoder);
+		devc->decoder = NULL;
+
 		feed_queue_logic_flush(devc->feed_queue);
 		feed_queue_logic_free(devc->feed_queue);
 		devc->feed_queue = NULL;
@@ -46,6 +46,7 @@
  */
 #define LA2016_EP6_PKTSZ	512 /* Max packet size of USB endpoint 6. */
 #define LA2016_USB_BUFSZ	(512 * 1024) /* 512KiB buffer. */
+#define LA2016_DECODE_BUFSZ	(32 * 1024 * 1024) /* Received, not decoded. */
 #define LA2016_USB_XFER_COUNT	8 /* Size of USB bulk transfers pool. */
 
 /* USB communication timeout during regular operation. */
@@ -61,7 +62,6 @@
  */
 #define RENUM_CHECK_PERIOD_MS	3000
 #define RENUM_GONE_DELAY_MS	1800
-#define RENUM_POLL_INTERVAL_MS	200
 
 /*
  * The device expects some zero padding to follow the content of the
@@ -103,6 +103,7 @@
 #define WITH_DEINIT_IN_CLOSE	0
 
 #define LA2016_CONVBUFFER_SIZE	(4 * 1024 * 1024)
+#define LA2016_RLE_BATCH_SIZE	1024 /* Number of (value, count) records. */
 
 struct kingst_model {
 	uint8_t magic, magic2;	/* EEPROM magic byte values. */
@@ -153,10 +154,16 @@ struct dev_context {
 	uint32_t n_bytes_to_read;
 	uint32_t n_reps_until_trigger;
 	gboolean trigger_marked;
+	gint limit_reached; /* Set by the decoding thread. */
+	struct sr_usb_decoder *decoder;
 	uint64_t total_samples;
 	uint32_t read_pos;
 
 	struct feed_queue_logic *feed_queue;
+	struct rle_batch_t {
+		uint8_t values[LA2016_RLE_BATCH_SIZE * sizeof(uint32_t)];
+		size_t counts[LA2016_RLE_BATCH_SIZE];
+	} rle;
 	GSList *transfers;
 	size_t transfer_bufsize;
 	struct stream_state_t {
@@ -436,6 +436,7 @@ SR_PRIV int korad_kaxxxxp_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	GSList *l;
+	int64_t timestamp;
 
 	(void)fd;
 	(void)revents;
@@ -450,6 +451,7 @@ SR_PRIV int korad_kaxxxxp_receive_data(int fd, int revents, void *cb_data)
 
 	/* Get the value. */
 	korad_kaxxxxp_get_value(serial, devc->acquisition_target, devc);
+	timestamp = serial->rx_time;
 
 	/* Note: digits/spec_digits will be overridden later. */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
@@ -458,6 +460,7 @@ SR_PRIV int korad_kaxxxxp_receive_data(int fd, int revents, void *cb_data)
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	analog.num_samples = 1;
+	analog.timestamps = &timestamp;
 	l = g_slist_copy(sdi->channels);
 	if (devc->acquisition_target == KAXXXXP_CURRENT) {
 		l = g_slist_remove_link(l, g_slist_nth(l, 0));
@@ -361,7 +361,7 @@ SR_PRIV struct sr_dev_inst *lascar_scan(int bus, int address)
 	drvc = di->context;
 	sdi = NULL;
 
-	ret = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (ret < 0)
 		return NULL;
 
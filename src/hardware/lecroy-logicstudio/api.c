@@ -126,7 +126,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	devices = NULL;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
@@ -202,7 +202,7 @@ static int open_device(struct sr_dev_inst *sdi)
 
 	is_opened = FALSE;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
@@ -257,7 +257,7 @@ static int open_device(struct sr_dev_inst *sdi)
 static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	int64_t timediff_us, timediff_ms;
+	size_t i;
 	int ret;
 
 	devc = sdi->priv;
@@ -270,32 +270,10 @@ static int dev_open(struct sr_dev_inst *sdi)
 	if (!devc->fw_updated) {
 		ret = open_device(sdi);
 	} else {
-		sr_info("Waiting for device to reset.");
-
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			ret = open_device(sdi);
-
-			if (ret == SR_OK)
-				break;
-
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
-
-		if (ret != SR_OK) {
-			sr_err("Device failed to renumerate.");
+		ret = ezusb_wait_renum(sdi, devc->fw_updated,
+			EZUSB_RENUM_GONE_DELAY_MS, MAX_RENUM_DELAY_MS, open_device);
+		if (ret != SR_OK)
 			return SR_ERR;
-		}
-
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
 	}
 
 	if (ret != SR_OK) {
@@ -312,7 +290,8 @@ static int dev_open(struct sr_dev_inst *sdi)
 	devc->conv8to16 = g_malloc(CONV_8TO16_BUF_SIZE);
 
 	devc->intr_xfer = libusb_alloc_transfer(0);
-	devc->bulk_xfer = libusb_alloc_transfer(0);
+	for (i = 0; i < NUM_BULK_XFERS; i++)
+		devc->bulk_xfers[i] = libusb_alloc_transfer(0);
 
 	return SR_OK;
 }
@@ -321,6 +300,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
+	size_t i;
 
 	usb = sdi->conn;
 	devc = sdi->priv;
@@ -337,12 +317,19 @@ static int dev_close(struct sr_dev_inst *sdi)
 		devc->intr_xfer = NULL;
 	}
 
-	if (devc->bulk_xfer) {
-		devc->bulk_xfer->buffer = NULL; /* Points into devc. */
-		libusb_free_transfer(devc->bulk_xfer);
-		devc->bulk_xfer = NULL;
+	for (i = 0; i < NUM_BULK_XFERS; i++) {
+		if (!devc->bulk_xfers[i])
+			continue;
+		devc->bulk_xfers[i]->buffer = NULL; /* Points into devc. */
+		libusb_free_transfer(devc->bulk_xfers[i]);
+		devc->bulk_xfers[i] = NULL;
 	}
 
+	/* The device may lose its configuration while closed. */
+	g_free(devc->trigger_regs);
+	devc->trigger_regs = NULL;
+	devc->num_trigger_regs = 0;
+
 	if (!usb->devhdl)
 		return SR_ERR_BUG;
 
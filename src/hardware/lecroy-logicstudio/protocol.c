@@ -46,6 +46,11 @@
 
 #define NUM_TRIGGER_STAGES 2
 #define TRIGGER_CFG_SIZE 45
+/* Three register writes per byte of trigger config, plus the combine op. */
+#define NUM_TRIGGER_REGS (NUM_TRIGGER_STAGES * TRIGGER_CFG_SIZE * 3 + 1)
+
+/* Register writes per control transfer, fills one 64 byte packet. */
+#define MAX_REGS_PER_XFER 21
 
 #define ALIGN2_DOWN(n, p) ((((n) > (p)) ? ((n) - (p)) : (n)) & ~((p) - 1))
 
@@ -162,36 +167,42 @@ static int read_register(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+/*
+ * Write registers in as few control transfers as possible. Long lists
+ * get split into transfers of MAX_REGS_PER_XFER registers, the writes
+ * happen in the order of the list.
+ */
 static int write_registers_sync(const struct sr_dev_inst *sdi,
 	unsigned int wValue, unsigned int wIndex,
 	const struct regval *regs, size_t num_regs)
 {
 	struct sr_usb_dev_inst *usb;
-	uint8_t *buf;
-	size_t i, bufsiz;
+	uint8_t buf[MAX_REGS_PER_XFER * 3];
+	size_t i, count, bufsiz;
 	int r;
 
 	usb = sdi->conn;
 
-	/* Try to avoid overflowing the stack. */
-	if (num_regs > 32)
-		return SR_ERR;
+	while (num_regs > 0) {
+		count = MIN(num_regs, MAX_REGS_PER_XFER);
+		bufsiz = count * 3;
 
-	bufsiz = num_regs * 3;
-	buf = alloca(bufsiz);
+		for (i = 0; i < count; i++) {
+			W8(&buf[i * 3 + 0], regs[i].reg);
+			WB16(&buf[i * 3 + 1], regs[i].val);
+		}
 
-	for (i = 0; i < num_regs; i++) {
-		W8(&buf[i * 3 + 0], regs[i].reg);
-		WB16(&buf[i * 3 + 1], regs[i].val);
-	}
+		r = libusb_control_transfer(usb->devhdl, CTRL_OUT,
+				USB_COMMAND_READ_WRITE_REGS, wValue, wIndex,
+				buf, bufsiz, USB_TIMEOUT_MS);
 
-	r = libusb_control_transfer(usb->devhdl, CTRL_OUT,
-			USB_COMMAND_READ_WRITE_REGS, wValue, wIndex,
-			buf, bufsiz, USB_TIMEOUT_MS);
+		if (r != (int) bufsiz) {
+			sr_err("write_registers_sync(%u/%u) failed.", wValue, wIndex);
+			return SR_ERR;
+		}
 
-	if (r != (int) bufsiz) {
-		sr_err("write_registers_sync(%u/%u) failed.", wValue, wIndex);
-		return SR_ERR;
+		regs += count;
+		num_regs -= count;
 	}
 
 	return SR_OK;
@@ -246,6 +257,9 @@ static void LIBUSB_CALL handle_fetch_samples_done(struct libusb_transfer *xfer)
 	const struct sr_dev_inst *sdi;
 	struct sr_usb_dev_inst *usb;
 	struct dev_context *devc;
+	struct drv_context *drvc;
+	uint32_t offset;
+	size_t i;
 
 	sdi = xfer->user_data;
 	usb = sdi->conn;
@@ -256,11 +270,32 @@ static void LIBUSB_CALL handle_fetch_samples_done(struct libusb_transfer *xfer)
 
 	libusb_free_transfer(xfer);
 
-	libusb_fill_bulk_transfer(devc->bulk_xfer, usb->devhdl, EP_BULK,
-		devc->fetched_samples, 17 << 10,
-		recv_bulk_transfer, (void *)sdi, USB_TIMEOUT_MS);
+	/* Submit all transfers at once, the device sends without pauses. */
+	devc->fetch_failed = FALSE;
+	devc->num_bulk_xfers_pending = 0;
 
-	libusb_submit_transfer(devc->bulk_xfer);
+	for (i = 0; i < NUM_BULK_XFERS; i++) {
+		offset = i * BULK_XFER_SIZE;
+
+		libusb_fill_bulk_transfer(devc->bulk_xfers[i], usb->devhdl,
+			EP_BULK, devc->fetched_samples + offset,
+			MIN(BULK_XFER_SIZE, SAMPLE_BUF_SIZE - offset),
+			recv_bulk_transfer, (void *)sdi, USB_TIMEOUT_MS);
+
+		if (libusb_submit_transfer(devc->bulk_xfers[i]) < 0) {
+			devc->fetch_failed = TRUE;
+			break;
+		}
+
+		devc->num_bulk_xfers_pending++;
+	}
+
+	if (devc->num_bulk_xfers_pending == 0) {
+		sr_err("Failed to submit sample transfers.");
+		drvc = sdi->driver->context;
+		usb_source_remove(sdi->session, drvc->sr_ctx);
+		std_session_send_df_end(sdi);
+	}
 }
 
 static void calc_unk0(uint32_t *a, uint32_t *b)
@@ -504,42 +539,40 @@ out:
 	return ret;
 }
 
-static int upload_trigger(const struct sr_dev_inst *sdi,
+static size_t prep_trigger_regs(struct regval *regs,
 	uint8_t reg_values[TRIGGER_CFG_SIZE], uint8_t reg_offset)
 {
-	struct regval regs[3 * 5];
 	uint16_t value;
-	int i, j, k;
+	size_t i, k;
 
-	for (i = 0; i < TRIGGER_CFG_SIZE; i += 5) {
-		k = 0;
+	k = 0;
 
-		for (j = 0; j < 5; j++) {
-			value = ((reg_offset + i + j) << 8) | reg_values[i + j];
-
-			prep_regw(&regs[k++], REG_TRIGGER_CFG, value);
-			prep_regw(&regs[k++], REG_TRIGGER_CFG, value | 0x8000);
-			prep_regw(&regs[k++], REG_TRIGGER_CFG, value);
-		}
+	for (i = 0; i < TRIGGER_CFG_SIZE; i++) {
+		value = ((reg_offset + i) << 8) | reg_values[i];
 
-		if (write_registers_sync(sdi, 0x12, 5444, ARRAY_AND_SIZE(regs))) {
-			sr_err("Failed to upload trigger config.");
-			return SR_ERR;
-		}
+		prep_regw(&regs[k++], REG_TRIGGER_CFG, value);
+		prep_regw(&regs[k++], REG_TRIGGER_CFG, value | 0x8000);
+		prep_regw(&regs[k++], REG_TRIGGER_CFG, value);
 	}
 
-	return SR_OK;
+	return k;
 }
 
-static int program_trigger(const struct sr_dev_inst *sdi,
+/*
+ * Construct the register writes for the trigger config. Takes
+ * NUM_TRIGGER_REGS items in regs.
+ */
+static void program_trigger(struct regval *regs,
 	struct trigger_config *stages, int num_filled_stages)
 {
 	struct trigger_config *block;
-	struct regval combine_op;
 	uint8_t buf[TRIGGER_CFG_SIZE];
 	const uint8_t reg_offsets[] = { 0x00, 0x40 };
+	size_t k;
 	int i;
 
+	k = 0;
+
 	for (i = 0; i < NUM_TRIGGER_STAGES; i++) {
 		block = &stages[i];
 
@@ -575,8 +608,7 @@ static int program_trigger(const struct sr_dev_inst *sdi,
 			buf[0x2c] = 0x80;
 		}
 
-		if (upload_trigger(sdi, buf, reg_offsets[i]) < 0)
-			return SR_ERR;
+		k += prep_trigger_regs(&regs[k], buf, reg_offsets[i]);
 	}
 
 	/*
@@ -588,10 +620,10 @@ static int program_trigger(const struct sr_dev_inst *sdi,
 	 * edge triggers cannot be AND'ed otherwise
 	 * (they are always OR'd within a single stage).
 	 */
-	prep_regw(&combine_op, REG_TRIGGER_COMBINE_OP,
+	prep_regw(&regs[k++], REG_TRIGGER_COMBINE_OP,
 		num_filled_stages > 1 ? TRIGGER_OP_A_AND_B : TRIGGER_OP_A);
 
-	return write_registers_sync(sdi, 0x12, 5444, &combine_op, 1);
+	assert(k == NUM_TRIGGER_REGS);
 }
 
 static gboolean transform_trigger(struct sr_trigger_stage *stage,
@@ -640,7 +672,12 @@ static gboolean transform_trigger(struct sr_trigger_stage *stage,
 	return ret;
 }
 
-static int configure_trigger(const struct sr_dev_inst *sdi)
+/*
+ * Construct the register writes for the session's trigger. Takes
+ * NUM_TRIGGER_REGS items in regs.
+ */
+static int configure_trigger(const struct sr_dev_inst *sdi,
+	struct regval *regs)
 {
 	struct dev_context *devc;
 	struct sr_trigger *trigger;
@@ -689,7 +726,28 @@ static int configure_trigger(const struct sr_dev_inst *sdi)
 
 	devc->want_trigger = num_filled_stages > 0;
 
-	return program_trigger(sdi, blocks, num_filled_stages);
+	program_trigger(regs, blocks, num_filled_stages);
+
+	return SR_OK;
+}
+
+/* Check whether the device has this trigger config already. */
+static gboolean trigger_regs_unchanged(struct dev_context *devc,
+	const struct regval *regs)
+{
+	size_t i;
+
+	if (devc->num_trigger_regs != NUM_TRIGGER_REGS)
+		return FALSE;
+
+	for (i = 0; i < NUM_TRIGGER_REGS; i++) {
+		if (devc->trigger_regs[i].reg != regs[i].reg)
+			return FALSE;
+		if (devc->trigger_regs[i].val != regs[i].val)
+			return FALSE;
+	}
+
+	return TRUE;
 }
 
 /** Update the bit mask of enabled channels. */
@@ -802,10 +860,12 @@ SR_PRIV int lls_setup_acquisition(const struct sr_dev_inst *sdi)
 	};
 	struct regval threshold[3];
 	struct regval channels;
+	struct regval regs[1 + NUM_TRIGGER_REGS + 2];
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	gboolean lower_enabled, upper_enabled, upload_bitstream;
+	gboolean lower_enabled, upper_enabled, upload_bitstream, upload_trigger;
 	uint32_t num_thousand_samples, num_enabled_channel_groups;
+	size_t num_regs;
 	int i, r;
 
 	usb = sdi->conn;
@@ -875,19 +935,46 @@ SR_PRIV int lls_setup_acquisition(const struct sr_dev_inst *sdi)
 
 		devc->magic_arm_trigger = 0x00;
 		devc->magic_fetch_samples = 0x00;
+
+		/* The new bitstream needs the trigger config again. */
+		g_free(devc->trigger_regs);
+		devc->trigger_regs = NULL;
+		devc->num_trigger_regs = 0;
 	}
 
-	if (write_registers_sync(sdi, 0x12, 5444, &channels, 1))
-		return SR_ERR;
+	/*
+	 * Write the channel selection, the trigger config and the
+	 * thresholds in one go. Skip the trigger config when the device
+	 * has it already, which is the common case in repeated
+	 * acquisitions.
+	 */
+	num_regs = 0;
+	regs[num_regs++] = channels;
 
-	if (configure_trigger(sdi) < 0)
+	if (configure_trigger(sdi, &regs[num_regs]) < 0)
 		return SR_ERR;
 
-	if (write_registers_sync(sdi, 0x12, 5444, &threshold[0], 1))
-		return SR_ERR;
+	upload_trigger = !trigger_regs_unchanged(devc, &regs[num_regs]);
+	if (upload_trigger)
+		num_regs += NUM_TRIGGER_REGS;
 
-	if (write_registers_sync(sdi, 0x12, 5444, &threshold[1], 1))
+	regs[num_regs++] = threshold[0];
+	regs[num_regs++] = threshold[1];
+
+	if (write_registers_sync(sdi, 0x12, 5444, regs, num_regs)) {
+		/* The trigger config on the device is unknown now. */
+		g_free(devc->trigger_regs);
+		devc->trigger_regs = NULL;
+		devc->num_trigger_regs = 0;
 		return SR_ERR;
+	}
+
+	if (upload_trigger) {
+		g_free(devc->trigger_regs);
+		devc->trigger_regs = g_memdup(&regs[1],
+			NUM_TRIGGER_REGS * sizeof(regs[0]));
+		devc->num_trigger_regs = NUM_TRIGGER_REGS;
+	}
 
 	if (upload_bitstream) {
 		r = libusb_control_transfer(usb->devhdl, CTRL_OUT,
@@ -1014,21 +1101,28 @@ static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
 	drvc = sdi->driver->context;
 	devc = sdi->priv;
 
+	/*
+	 * Several transfers are in flight, which fill adjacent parts of
+	 * the sample buffer. A short one would leave a gap.
+	 */
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED
+			|| xfer->actual_length != xfer->length)
+		devc->fetch_failed = TRUE;
+
 	devc->total_received_sample_bytes += xfer->actual_length;
 
-	if (devc->total_received_sample_bytes < SAMPLE_BUF_SIZE) {
-		xfer->buffer = devc->fetched_samples
-			+ devc->total_received_sample_bytes;
+	if (--devc->num_bulk_xfers_pending > 0)
+		return;
 
-		xfer->length = MIN(16 << 10,
-			SAMPLE_BUF_SIZE - devc->total_received_sample_bytes);
+	usb_source_remove(sdi->session, drvc->sr_ctx);
 
-		libusb_submit_transfer(xfer);
+	if (devc->fetch_failed) {
+		sr_err("Failed to fetch samples, got %u of %u bytes.",
+			devc->total_received_sample_bytes, SAMPLE_BUF_SIZE);
+		std_session_send_df_end(sdi);
 		return;
 	}
 
-	usb_source_remove(sdi->session, drvc->sr_ctx);
-
 	read_offset = sample_to_byte_offset(devc, devc->earliest_sample);
 	trigger_offset = sample_to_byte_offset(devc, devc->trigger_sample);
 
@@ -28,14 +28,22 @@
 #define LOG_PREFIX "lecroy-logicstudio"
 
 #define SAMPLE_BUF_SIZE 40960u
+#define BULK_XFER_SIZE (16u << 10)
+#define NUM_BULK_XFERS \
+	((SAMPLE_BUF_SIZE + BULK_XFER_SIZE - 1) / BULK_XFER_SIZE)
 #define CONV_8TO16_BUF_SIZE 8192
 #define INTR_BUF_SIZE 32
 
 struct samplerate_info;
+struct regval;
 
 struct dev_context {
 	struct libusb_transfer *intr_xfer;
-	struct libusb_transfer *bulk_xfer;
+
+	/** Transfers which fetch the sample buffer, all in flight at once. */
+	struct libusb_transfer *bulk_xfers[NUM_BULK_XFERS];
+	int num_bulk_xfers_pending;
+	gboolean fetch_failed;
 
 	const struct samplerate_info *samplerate_info;
 
@@ -88,6 +96,13 @@ struct dev_context {
 	uint8_t magic_arm_trigger;
 	uint8_t magic_fetch_samples;
 
+	/**
+	 * The trigger configuration registers which were written most
+	 * recently. Unchanged configurations don't get written again.
+	 */
+	struct regval *trigger_regs;
+	size_t num_trigger_regs;
+
 	/**
 	 * Buffer for interrupt transfers (acquisition state notifications).
 	 */
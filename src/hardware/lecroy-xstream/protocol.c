@@ -624,6 +624,7 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	gboolean last_channel, last_frame;
 
 	(void)fd;
 	(void)revents;
@@ -681,6 +682,28 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (devc->current_channel == devc->enabled_channels)
 		std_session_send_df_frame_begin(sdi);
 
+	/*
+	 * Advance to the next enabled channel, or the first one of the
+	 * next frame, and request its data right away. The scope prepares
+	 * the next waveform while this one gets passed on. Stop acquisition
+	 * after the specified number of frames.
+	 */
+	last_channel = !devc->current_channel->next;
+	last_frame = last_channel && devc->frame_limit &&
+		(devc->num_frames + 1 == devc->frame_limit);
+	if (!last_channel) {
+		devc->current_channel = devc->current_channel->next;
+		lecroy_xstream_request_data(sdi);
+	} else if (!last_frame) {
+		devc->current_channel = devc->enabled_channels;
+
+		/* Wait for trigger, then begin fetching data. */
+		g_snprintf(command, sizeof(command), "ARM;WAIT;*OPC");
+		sr_scpi_send(sdi->conn, command);
+
+		lecroy_xstream_request_data(sdi);
+	}
+
 	meaning.channels = g_slist_append(NULL, ch);
 	packet.payload = &analog;
 	packet.type = SR_DF_ANALOG;
@@ -692,36 +715,15 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	g_slist_free(meaning.channels);
 	g_free(analog.data);
 
-	/*
-	 * Advance to the next enabled channel. When data for all enabled
-	 * channels was received, then flush potentially queued logic data,
-	 * and send the "frame end" packet.
-	 */
-	if (devc->current_channel->next) {
-		devc->current_channel = devc->current_channel->next;
-		lecroy_xstream_request_data(sdi);
+	/* Send the "frame end" packet after the last enabled channel. */
+	if (!last_channel)
 		return TRUE;
-	}
 
 	std_session_send_df_frame_end(sdi);
 
-	/*
-	 * End of frame was reached. Stop acquisition after the specified
-	 * number of frames, or continue reception by starting over at
-	 * the first enabled channel.
-	 */
 	devc->num_frames++;
-	if (devc->frame_limit && (devc->num_frames == devc->frame_limit)) {
+	if (last_frame)
 		sr_dev_acquisition_stop(sdi);
-	} else {
-		devc->current_channel = devc->enabled_channels;
-
-		/* Wait for trigger, then begin fetching data. */
-		g_snprintf(command, sizeof(command), "ARM;WAIT;*OPC");
-		sr_scpi_send(sdi->conn, command);
-
-		lecroy_xstream_request_data(sdi);
-	}
 
 	return TRUE;
 }
@@ -34,6 +34,7 @@ static const uint32_t drvopts[] = {
 
 static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_FRAMES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_SOURCE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
@@ -274,6 +275,7 @@ static GSList* scan_handle_port(GSList *devices, struct sp_port *port)
 	devc->cur_rate = SR_KHZ(10);
 	devc->dso_probe_factor = 10;
 	devc->limit_samples = MSO_NUM_SAMPLES;
+	devc->limit_frames = 1;
 	devc->logic_threshold = ARRAY_SIZE(logic_thresholds) - 1; // 3.3V/5V
 	devc->logic_threshold_value = logic_threshold_values[devc->logic_threshold];
 	mso_set_offset_value(devc, 0.0);
@@ -405,6 +407,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_LIMIT_SAMPLES:
 		*data = g_variant_new_uint64(devc->limit_samples);
 		break;
+	case SR_CONF_LIMIT_FRAMES:
+		*data = g_variant_new_uint64(devc->limit_frames);
+		break;
 	case SR_CONF_COUPLING:
 		if (!CG_IS_ANALOG(cg))
 			return SR_ERR_NA;
@@ -473,6 +478,10 @@ static int config_set(uint32_t key, GVariant *data,
 		}
 		devc->limit_samples = tmp_u64;
 		break;
+	case SR_CONF_LIMIT_FRAMES:
+		/* Repeated captures, until stopped when 0. */
+		devc->limit_frames = g_variant_get_uint64(data);
+		break;
 	case SR_CONF_TRIGGER_SOURCE:
 		idx = std_str_idx(data, ARRAY_AND_SIZE(trigger_sources));
 		if (idx < 0)
@@ -651,6 +660,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (ret != SR_OK)
 		return ret;
 
+	devc->num_samples = 0;
+	devc->num_frames = 0;
 	std_session_send_df_header(sdi);
 
 	/* Our first channel is analog, the other 8 are of type 'logic'. */
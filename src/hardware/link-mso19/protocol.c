@@ -21,6 +21,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include "protocol.h"
 
 #define LA_TRIGGER_MASK_IGNORE_ALL  0xff
@@ -352,10 +353,51 @@ SR_PRIV int mso_read_status(struct sr_serial_dev_inst *serial, uint8_t *status)
 	return ret;
 }
 
-SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+/*
+ * Unpack the buffer dump, 24 bits per sample: the 10bit ADC value in
+ * bits 0-5 and 8-11, the logic channels in bits 12-13 and 16-21.
+ */
+static void mso_unpack_samples(struct dev_context *devc)
+{
+	const uint8_t *in;
+	uint8_t *analog_out;
+	size_t i;
+
+	in = devc->buffer;
+	analog_out = devc->analog_out;
+	for (i = 0; i < MSO_NUM_SAMPLES; i++) {
+		WL16(analog_out, (in[0] & 0x3f) | ((in[1] & 0xf) << 6));
+		devc->logic_out[i] = ((in[1] & 0x30) >> 4) | ((in[2] & 0x3f) << 2);
+		in += 3;
+		analog_out += sizeof(uint16_t);
+	}
+}
+
+static void mso_send_samples(const struct sr_dev_inst *sdi,
+		struct sr_datafeed_analog *analog, size_t start, size_t count)
 {
+	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+
+	devc = sdi->priv;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = sizeof(devc->logic_out[0]);
+	logic.length = count * logic.unitsize;
+	logic.data = &devc->logic_out[start];
+	sr_session_send(sdi, &packet);
+
+	packet.type = SR_DF_ANALOG;
+	packet.payload = analog;
+	analog->num_samples = count;
+	analog->data = &devc->analog_out[start * sizeof(uint16_t)];
+	sr_session_send(sdi, &packet);
+}
+
+SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+{
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
@@ -363,12 +405,13 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	int i;
 	int trigger_sample;
 	int pre_samples, post_samples;
+	gboolean last_frame;
+	double vstep;
 
 	uint8_t in[MSO_NUM_SAMPLES];
-	size_t s;
+	int s;
 
 	(void)fd;
 	(void)revents;
@@ -381,13 +424,12 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 	if (!devc)
 		return TRUE;
 
-	s = serial_read_blocking(devc->serial, in, sizeof(in), 10);
-	if (s <= 0)
-		return FALSE;
-
 	/* Check if we triggered, then send a command that we are ready
 	 * to read the data */
 	if (BITS_STATUS_ACTION(devc->status) != STATUS_DATA_READY) {
+		s = serial_read_blocking(devc->serial, in, sizeof(in), 10);
+		if (s <= 0)
+			return FALSE;
 		if (mso_validate_status(in[0]) != SR_OK) {
 			return FALSE;
 		}
@@ -402,24 +444,27 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	/* the hardware always dumps 1024 samples, 24bits each */
-	if (devc->buffer_n < (MSO_NUM_SAMPLES * 3)) {
-		memcpy(devc->buffer + devc->buffer_n, in, s);
-		devc->buffer_n += s;
-	}
-	if (devc->buffer_n < (MSO_NUM_SAMPLES * 3))
+	s = serial_read_blocking(devc->serial, devc->buffer + devc->buffer_n,
+		MSO_BUFFER_SIZE - devc->buffer_n, 10);
+	if (s <= 0)
+		return FALSE;
+	devc->buffer_n += s;
+	if (devc->buffer_n < MSO_BUFFER_SIZE)
 		return TRUE;
 
-	/* do the conversion */
-	uint8_t logic_out[MSO_NUM_SAMPLES];
-	float analog_out[MSO_NUM_SAMPLES];
-	for (i = 0; i < MSO_NUM_SAMPLES; i++) {
-		analog_out[i] = (devc->buffer[i * 3] & 0x3f) |
-		    ((devc->buffer[i * 3 + 1] & 0xf) << 6);
-		analog_out[i] = (512.0 - analog_out[i]) * devc->vbit
-			* devc->dso_probe_factor
-			- devc->dso_offset_adjusted;
-		logic_out[i] = ((devc->buffer[i * 3 + 1] & 0x30) >> 4) |
-		    ((devc->buffer[i * 3 + 2] & 0x3f) << 2);
+	/*
+	 * In repeated capture mode the next capture gets going right
+	 * away, the samples of this one get sent while it runs.
+	 */
+	devc->num_frames++;
+	last_frame = devc->limit_frames
+		&& devc->num_frames >= devc->limit_frames;
+	mso_unpack_samples(devc);
+	devc->status = 0;
+	if (!last_frame) {
+		if (mso_arm(sdi) != SR_OK
+				|| mso_read_status(devc->serial, NULL) != SR_OK)
+			return FALSE;
 	}
 
 	if (devc->ctltrig_pos & TRIG_POS_IS_NEGATIVE) {
@@ -430,28 +475,31 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 		pre_samples = MIN(trigger_sample, MSO_NUM_SAMPLES);
 	}
 
-	logic.unitsize = sizeof(*logic_out);
-
+	/*
+	 * Send the raw ADC values, volts are
+	 * (512 - value) * vbit * probe factor - offset.
+	 */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(uint16_t);
+	encoding.is_signed = FALSE;
+	encoding.is_float = FALSE;
+	encoding.is_bigendian = FALSE;
+	vstep = devc->vbit * devc->dso_probe_factor;
+	sr_rational_set(&encoding.scale, -llround(vstep * 1e9), 1000000000);
+	sr_rational_set(&encoding.offset,
+		llround((512 * vstep - devc->dso_offset_adjusted) * 1e9),
+		1000000000);
 	analog.meaning->channels = g_slist_append(
 			NULL, g_slist_nth_data(sdi->channels, 0));
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = SR_MQFLAG_DC;
 
-	if (pre_samples > 0) {
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = pre_samples * sizeof(*logic_out);
-		logic.data = logic_out;
-		sr_session_send(sdi, &packet);
-
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		analog.num_samples = pre_samples;
-		analog.data = analog_out;
-		sr_session_send(sdi, &packet);
-	}
+	if (devc->limit_frames != 1)
+		std_session_send_df_frame_begin(sdi);
+
+	if (pre_samples > 0)
+		mso_send_samples(sdi, &analog, 0, pre_samples);
 
 	if (pre_samples == trigger_sample) {
 		std_session_send_df_trigger(sdi);
@@ -459,25 +507,17 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 
 	post_samples = MSO_NUM_SAMPLES - pre_samples;
 
-	if (post_samples > 0) {
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = post_samples * sizeof(*logic_out);
-		logic.data = logic_out + pre_samples;
-		sr_session_send(sdi, &packet);
-
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		analog.num_samples = post_samples;
-		analog.data = analog_out + pre_samples;
-		sr_session_send(sdi, &packet);
-	}
+	if (post_samples > 0)
+		mso_send_samples(sdi, &analog, pre_samples, post_samples);
 	g_slist_free(analog.meaning->channels);
 
+	if (devc->limit_frames != 1)
+		std_session_send_df_frame_end(sdi);
+
 	devc->num_samples += MSO_NUM_SAMPLES;
 
-	if (devc->limit_samples && devc->num_samples >= devc->limit_samples) {
-		sr_info("Requested number of samples reached.");
+	if (last_frame) {
+		sr_info("Requested number of frames reached.");
 		sr_dev_acquisition_stop(sdi);
 	}
 
@@ -36,6 +36,8 @@
 
 #define SERIALCOMM		"460800/8n1/flow=2"
 #define MSO_NUM_SAMPLES		1024
+/* The buffer dump has 24 bits per sample. */
+#define MSO_BUFFER_SIZE		(MSO_NUM_SAMPLES * 3)
 #define MSO_NUM_LOGIC_CHANNELS	8
 
 #define CG_IS_DIGITAL(cg) (cg && cg->name[0] == 'L')
@@ -83,6 +85,8 @@ struct dev_context {
 	double offset_vbit;
 	uint64_t limit_samples;
 	uint64_t num_samples;
+	uint64_t limit_frames;
+	uint64_t num_frames;
 
 	/* register cache */
 	uint8_t ctlbase1;
@@ -110,7 +114,10 @@ struct dev_context {
 	uint16_t dso_trigger_width;
 	struct mso_prototrig protocol_trigger;
 	uint16_t buffer_n;
-	char buffer[4096];
+	uint8_t buffer[MSO_BUFFER_SIZE];
+	/* Unpacked samples, the ADC values as 16bit little endian. */
+	uint8_t analog_out[MSO_NUM_SAMPLES * sizeof(uint16_t)];
+	uint8_t logic_out[MSO_NUM_SAMPLES];
 };
 
 /* from api.c */
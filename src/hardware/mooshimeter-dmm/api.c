@@ -987,13 +987,23 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc = sdi->priv;
-	int ret;
+	struct sr_channel *ch;
+	int ret, i;
 
 	ret = mooshimeter_dmm_set_chooser(sdi, "SAMPLING:TRIGGER",
 		"SAMPLING:TRIGGER:CONTINUOUS");
 	if (ret)
 		return ret;
 
+	devc->limit_channel = -1;
+	for (i = 0; i < (int)ARRAY_SIZE(devc->channel_meaning); i++) {
+		ch = devc->channel_meaning[i].channels->data;
+		if (ch->enabled) {
+			devc->limit_channel = i;
+			break;
+		}
+	}
+
 	sr_sw_limits_acquisition_start(&devc->limits);
 	std_session_send_df_header(sdi);
 
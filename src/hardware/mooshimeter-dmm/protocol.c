@@ -23,6 +23,12 @@
 #include <string.h>
 #include "protocol.h"
 
+/* Max notifications to process per poll, and the requested BLE link speed. */
+#define NOTIFY_BATCH		64
+#define CONN_INTERVAL_MS	15
+/* Max time to spend draining notifications per poll, in microseconds. */
+#define POLL_BUDGET_US		(20 * 1000)
+
 /*
  * The Mooshimeter protocol is broken down into several layers in a
  * communication stack.
@@ -640,11 +646,18 @@ static void chX_value_update(struct config_tree_node *node,
 	if (devc->channel_autorange[channel])
 		(*devc->channel_autorange[channel])(sdi, value);
 
+	if (channel != devc->limit_channel)
+		return;
 	sr_sw_limits_update_samples_read(&devc->limits, 1);
 	if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
 }
 
+/*
+ * Convert a buffer notification, all samples of one measurement period,
+ * and send them in one packet. The values get decoded into a buffer of
+ * the device context, which is kept across notifications.
+ */
 static void chX_buffer_update(struct config_tree_node *node,
 	struct sr_dev_inst *sdi, int channel)
 {
@@ -654,14 +667,13 @@ static void chX_buffer_update(struct config_tree_node *node,
 	uint32_t bytes_per_sample;
 	const uint8_t *raw;
 	size_t size;
-	size_t number_of_samples;
-	int32_t unscaled = 0;
+	size_t number_of_samples, i;
+	int32_t unscaled;
 	int32_t sign_bit;
 	int32_t sign_mask;
-	float converted_value = 0;
+	float converted_value;
 	float maximum_value = 0;
 	float *values;
-	float *output_value;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -694,25 +706,29 @@ static void chX_buffer_update(struct config_tree_node *node,
 	if (!number_of_samples)
 		return;
 
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-
-	values = g_new0(float, number_of_samples);
-	output_value = values;
-
-	memcpy(analog.meaning, &devc->channel_meaning[channel],
-		sizeof(struct sr_analog_meaning));
-	analog.num_samples = number_of_samples;
-	analog.data = output_value;
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-
 	sr_spew("Received buffer for channel %d with %u bytes (%u samples).",
 		channel, (unsigned int)size, (unsigned int)number_of_samples);
 
+	/* Both channels' buffers cover the same period, count one. */
+	if (channel == devc->limit_channel) {
+		number_of_samples = sr_sw_limits_accept_samples(&devc->limits,
+			number_of_samples);
+		if (!number_of_samples) {
+			sr_dev_acquisition_stop(sdi);
+			return;
+		}
+	}
+
+	if (number_of_samples > devc->buffer_values_size) {
+		g_free(devc->buffer_values);
+		devc->buffer_values = g_new(float, number_of_samples);
+		devc->buffer_values_size = number_of_samples;
+	}
+	values = devc->buffer_values;
+
 	sign_bit = 1 << (bits_per_sample - 1);
 	sign_mask = sign_bit - 1;
-	for (; size >= bytes_per_sample; size -= bytes_per_sample,
-		raw += bytes_per_sample, output_value++) {
+	for (i = 0; i < number_of_samples; i++, raw += bytes_per_sample) {
 		switch (bytes_per_sample) {
 		case 1:
 			unscaled = R8(raw);
@@ -725,29 +741,31 @@ static void chX_buffer_update(struct config_tree_node *node,
 				(((uint32_t)raw[1]) << 8) |
 				(((uint32_t)raw[2]) << 16);
 			break;
-		case 4:
-			unscaled = RL32(raw);
-			break;
 		default:
+			unscaled = RL32(raw);
 			break;
 		}
 
 		unscaled = (unscaled & sign_mask) - (unscaled & sign_bit);
 		converted_value = (float)unscaled * output_scalar;
-		*output_value = converted_value;
+		values[i] = converted_value;
 		if (fabsf(converted_value) > maximum_value)
-			maximum_value = fabsf(maximum_value);
+			maximum_value = fabsf(converted_value);
 	}
 
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	memcpy(analog.meaning, &devc->channel_meaning[channel],
+		sizeof(struct sr_analog_meaning));
+	analog.num_samples = number_of_samples;
+	analog.data = values;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
 	sr_session_send(sdi, &packet);
 
-	g_free(values);
-
 	if (devc->channel_autorange[channel])
 		(*devc->channel_autorange[channel])(sdi, maximum_value);
 
-	sr_sw_limits_update_samples_read(&devc->limits, number_of_samples);
-	if (sr_sw_limits_check(&devc->limits))
+	if (channel == devc->limit_channel && sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
 }
 
@@ -947,7 +965,7 @@ static int wait_for_update(const struct sr_dev_inst *sdi,
 
 	start_time = g_get_monotonic_time();
 	for (;;) {
-		ret = sr_bt_check_notify(desc);
+		ret = sr_bt_check_notify_batch(desc, NOTIFY_BATCH);
 		if (ret < 0)
 			return SR_ERR;
 
@@ -1080,7 +1098,7 @@ static int startup_run(struct startup_context *ctx)
 
 	start_time = g_get_monotonic_time();
 	for (;;) {
-		ret = sr_bt_check_notify(desc);
+		ret = sr_bt_check_notify_batch(desc, NOTIFY_BATCH);
 		if (ret < 0)
 			return SR_ERR;
 
@@ -1265,6 +1283,11 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 	if (ret < 0)
 		return SR_ERR;
 
+	/* Sample streams need more than the default connection interval. */
+	ret = sr_bt_config_ble_link(desc, 0, CONN_INTERVAL_MS);
+	if (ret < 0)
+		return SR_ERR;
+
 	ret = sr_bt_connect_ble(desc);
 	if (ret < 0)
 		return SR_ERR;
@@ -1308,6 +1331,10 @@ SR_PRIV int mooshimeter_dmm_close(const struct sr_dev_inst *sdi)
 		g_byte_array_free(devc->rx.contents, TRUE);
 	devc->rx.contents = NULL;
 
+	g_free(devc->buffer_values);
+	devc->buffer_values = NULL;
+	devc->buffer_values_size = 0;
+
 	return SR_OK;
 }
 
@@ -1524,6 +1551,8 @@ SR_PRIV int mooshimeter_dmm_poll(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct sr_bt_desc *desc;
+	int64_t deadline;
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -1533,7 +1562,15 @@ SR_PRIV int mooshimeter_dmm_poll(int fd, int revents, void *cb_data)
 
 	desc = sdi->conn;
 
-	while (sr_bt_check_notify(desc) > 0);
+	/*
+	 * Drain the pending notifications. Buffered sampling at high
+	 * rates fills more than one batch per poll interval, but don't
+	 * starve other sources of the session.
+	 */
+	deadline = g_get_monotonic_time() + POLL_BUDGET_US;
+	do {
+		ret = sr_bt_check_notify_batch(desc, NOTIFY_BATCH);
+	} while (ret == NOTIFY_BATCH && g_get_monotonic_time() < deadline);
 
 	return TRUE;
 }
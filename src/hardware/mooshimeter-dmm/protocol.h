@@ -81,10 +81,14 @@ struct dev_context {
 	struct config_tree_node *tree_id_lookup[0x7F];
 	uint32_t buffer_bps[2];
 	float buffer_lsb2native[2];
+	float *buffer_values;
+	size_t buffer_values_size;
 
 	void (*channel_autorange[3])(const struct sr_dev_inst *sdi, float value);
 
 	struct sr_sw_limits limits;
+	/* The enabled channel which counts samples towards the limit. */
+	int limit_channel;
 	struct sr_analog_meaning channel_meaning[3];
 
 	gboolean enable_value_stream;
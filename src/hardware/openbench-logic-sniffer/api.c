@@ -310,6 +310,10 @@ static int config_set(uint32_t key, GVariant *data,
 		tmp_u64 = g_variant_get_uint64(data);
 		if (tmp_u64 < MIN_NUM_SAMPLES)
 			return SR_ERR;
+		if (!sr_mem_fits(sr_dev_inst_mem_ctx(sdi), tmp_u64 * 4)) {
+			sr_err("Sample limit exceeds the memory budget.");
+			return SR_ERR_ARG;
+		}
 		devc->limit_samples = tmp_u64;
 		break;
 	case SR_CONF_CAPTURE_RATIO:
@@ -344,16 +344,110 @@ SR_PRIV int ols_set_samplerate(const struct sr_dev_inst *sdi,
 
 SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_serial_dev_inst *serial;
 
 	serial = sdi->conn;
+	devc = sdi->priv;
 	ols_send_reset(serial);
 
 	serial_source_remove(sdi->session, serial);
 
+	if (devc->raw_sample_buf) {
+		g_free(devc->raw_sample_buf);
+		devc->raw_sample_buf = NULL;
+		sr_mem_release(sr_dev_inst_mem_ctx(sdi),
+			devc->limit_samples * 4);
+	}
+
 	std_session_send_df_end(sdi);
 }
 
+/* Handle a complete sample in devc->sample[], see ols_receive_data(). */
+static void ols_process_sample(struct dev_context *devc, int num_changroups)
+{
+	uint32_t sample;
+	uint8_t tmp_sample[4];
+	unsigned int i;
+	int offset, j;
+	uint8_t *dest;
+
+	devc->cnt_samples++;
+	devc->cnt_samples_rle++;
+	/*
+	 * Got a full sample. Convert from the OLS's little-endian
+	 * sample to the local format.
+	 */
+	sample = devc->sample[0] | (devc->sample[1] << 8) |
+		 (devc->sample[2] << 16) | (devc->sample[3] << 24);
+	sr_spew("Received sample 0x%.*x.", devc->num_bytes * 2, sample);
+	if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+		/*
+		 * In RLE mode the high bit of the sample is the
+		 * "count" flag, meaning this sample is the number
+		 * of times the previous sample occurred.
+		 */
+		if (devc->sample[devc->num_bytes - 1] & 0x80) {
+			/* Clear the high bit. */
+			sample &= ~(0x80 << (devc->num_bytes - 1) * 8);
+			devc->rle_count = sample;
+			devc->cnt_samples_rle += devc->rle_count;
+			sr_spew("RLE count: %u.", devc->rle_count);
+			devc->num_bytes = 0;
+			return;
+		}
+	}
+	devc->num_samples += devc->rle_count + 1;
+	if (devc->num_samples > devc->limit_samples) {
+		/* Save us from overrunning the buffer. */
+		devc->rle_count -= devc->num_samples - devc->limit_samples;
+		devc->num_samples = devc->limit_samples;
+	}
+
+	if (num_changroups < 4) {
+		/*
+		 * Some channel groups may have been turned
+		 * off, to speed up transfer between the
+		 * hardware and the PC. Expand that here before
+		 * submitting it over the session bus --
+		 * whatever is listening on the bus will be
+		 * expecting a full sample of devc->unitsize bytes,
+		 * based on the maximum number of channels.
+		 * For simplicity we expand the sample to 32 bits
+		 * little endian, and crop below
+		 */
+		j = 0;
+		memset(tmp_sample, 0, sizeof(tmp_sample));
+		for (i = 0; i < 4; i++) {
+			if (((devc->capture_flags >> 2) & (1 << i)) == 0) {
+				/*
+				 * This channel group was
+				 * enabled, copy from received
+				 * sample.
+				 */
+				tmp_sample[i] = devc->sample[j++];
+			}
+		}
+		memcpy(devc->sample, tmp_sample, 4);
+	}
+
+	/*
+	 * the OLS sends its sample buffer backwards.
+	 * store it in reverse order here, so we can dump
+	 * this on the session bus later.
+	 * Here cropping to devc->unitsize happens
+	 */
+	offset = (devc->limit_samples - devc->num_samples) * devc->unitsize;
+	dest = devc->raw_sample_buf + offset;
+	for (i = 0; i <= devc->rle_count; i++) {
+		memcpy(dest, devc->sample, devc->unitsize);
+		dest += devc->unitsize;
+	}
+	memset(devc->sample, 0, 4);
+	devc->num_bytes = 0;
+	devc->rle_count = 0;
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -361,10 +455,10 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	struct sr_serial_dev_inst *serial;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	uint32_t sample;
-	int num_changroups, offset, j;
+	struct sr_context *ctx;
+	int num_changroups, len, idx;
 	unsigned int i;
-	unsigned char byte;
+	uint8_t buf[OLS_READ_BUFSZ];
 
 	(void)fd;
 
@@ -378,8 +472,14 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (devc->num_transfers++ == 0) {
+		ctx = sr_dev_inst_mem_ctx(sdi);
+		if (sr_mem_reserve(ctx, devc->limit_samples * 4) != SR_OK) {
+			sr_err("Sample buffer exceeds the memory budget.");
+			return FALSE;
+		}
 		devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
 		if (!devc->raw_sample_buf) {
+			sr_mem_release(ctx, devc->limit_samples * 4);
 			sr_err("Sample buffer malloc failed.");
 			return FALSE;
 		}
@@ -395,101 +495,20 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
+		/* Take all available data, not just one byte per call. */
+		len = serial_read_nonblocking(serial, buf, sizeof(buf));
+		if (len <= 0)
 			return FALSE;
-		devc->cnt_bytes++;
-
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
-			return TRUE;
-
-		devc->sample[devc->num_bytes++] = byte;
-		sr_spew("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_changroups) {
-			devc->cnt_samples++;
-			devc->cnt_samples_rle++;
-			/*
-			 * Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format.
-			 */
-			sample = devc->sample[0] | (devc->sample[1] << 8) |
-				 (devc->sample[2] << 16) |
-				 (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2,
-			       sample);
-			if (devc->capture_flags & CAPTURE_FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes -
-							     1) * 8);
-					devc->rle_count = sample;
-					devc->cnt_samples_rle +=
-						devc->rle_count;
-					sr_dbg("RLE count: %u.",
-					       devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -=
-					devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
+		devc->cnt_bytes += len;
+		sr_spew("Received %d bytes.", len);
 
-			if (num_changroups < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full sample of devc->unitsize bytes,
-				 * based on the maximum number of channels.
-				 * For simplicity we expand the sample to 32 bits
-				 * little endian, and crop below
-				 */
-				j = 0;
-				uint8_t tmp_sample[4] = { 0, 0, 0, 0 };
-				for (i = 0; i < 4; i++) {
-					if (((devc->capture_flags >> 2) &
-					     (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						tmp_sample[i] =
-							devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, tmp_sample, 4);
-				sr_spew("Expanded sample: 0x%.2hhx%.2hhx%.2hhx%.2hhx ",
-					devc->sample[3], devc->sample[2],
-					devc->sample[1], devc->sample[0]);
-			}
-
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 * Here cropping to devc->unitsize happens
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * devc->unitsize;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * devc->unitsize),
-				       devc->sample, devc->unitsize);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
+		/* Data after the last sample we asked for gets ignored. */
+		for (idx = 0; idx < len; idx++) {
+			if (devc->num_samples >= devc->limit_samples)
+				break;
+			devc->sample[devc->num_bytes++] = buf[idx];
+			if (devc->num_bytes == num_changroups)
+				ols_process_sample(devc, num_changroups);
 		}
 	} else {
 		/*
@@ -538,8 +557,6 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 				     devc->unitsize;
 		sr_session_send(sdi, &packet);
 
-		g_free(devc->raw_sample_buf);
-
 		serial_flush(serial);
 		abort_acquisition(sdi);
 	}
@@ -33,6 +33,9 @@
 #define MIN_NUM_SAMPLES              4
 #define DEFAULT_SAMPLERATE           SR_KHZ(200)
 
+/* Bytes taken from the serial port per receive callback, at most. */
+#define OLS_READ_BUFSZ               4096
+
 /* Command opcodes */
 #define CMD_RESET                     0x00
 #define CMD_ARM_BASIC_TRIGGER         0x01
@@ -320,6 +320,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList * options)
 		devc->a_pretrig_bufs[i] = NULL;
 	}
 	devc->d_data_buf = NULL;
+	devc->d_run_lengths = NULL;
 	devc->sample_rate = 5000;
 	devc->capture_ratio = 10;
 	devc->rxstate = RX_IDLE;
@@ -657,6 +658,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			sr_err("ERROR: logic buffer malloc fail");
 			return SR_ERR_MALLOC;
 		}
+		devc->d_run_lengths = g_malloc(devc->sample_buf_size *
+			sizeof(devc->d_run_lengths[0]));
+		devc->num_runs = 0;
 	}
 
 	devc->pretrig_entries = (devc->capture_ratio * devc->limit_samples) / 100;
@@ -825,6 +829,8 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		g_free(devc->d_data_buf);
 		devc->d_data_buf = NULL;
 	}
+	g_free(devc->d_run_lengths);
+	devc->d_run_lengths = NULL;
 
 	for (int i = 0; i < devc->num_a_channels; i++) {
 		if (devc->a_pretrig_bufs[i])
@@ -119,6 +119,113 @@ SR_PRIV int send_serial_w_ack(struct sr_serial_dev_inst *serial, char *str)
 	}
 }
 
+/* Number of repeats of the previous sample which a received byte carries,
+ * zero for bytes which are no RLE or data values of that mode. */
+#define D4_RLE(c)	((c) >= 0x80 ? ((c) & 0x70) >> 4 : \
+			(c) >= 48 ? ((c) - 47) * 8 : 0)
+#define SLICE_RLE(c)	((c) >= 0x80 ? 0 : (c) >= 80 ? ((c) - 78) * 32 : \
+			(c) >= 48 ? (c) - 47 : 0)
+#define RLE_R2(f, n)	f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define RLE_R4(f, n)	RLE_R2(f, n), RLE_R2(f, (n) + 4), \
+			RLE_R2(f, (n) + 8), RLE_R2(f, (n) + 12)
+#define RLE_R6(f, n)	RLE_R4(f, n), RLE_R4(f, (n) + 16), \
+			RLE_R4(f, (n) + 32), RLE_R4(f, (n) + 48)
+#define RLE_R8(f)	RLE_R6(f, 0), RLE_R6(f, 64), \
+			RLE_R6(f, 128), RLE_R6(f, 192)
+
+static const uint16_t d4_rle[256] = { RLE_R8(D4_RLE) };
+static const uint16_t slice_rle[256] = { RLE_R8(SLICE_RLE) };
+
+/* Send the runs collected by process_D4_runs() to the session, up to
+ * limit_samples. */
+static void send_D4_runs(struct sr_dev_inst *sdi, struct dev_context *d)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_runs runs;
+	uint64_t remaining, total;
+	uint32_t i;
+
+	remaining = UINT64_MAX;
+	if (d->limit_samples)
+		remaining = d->limit_samples > d->sent_samples ?
+			d->limit_samples - d->sent_samples : 0;
+
+	total = 0;
+	for (i = 0; i < d->num_runs && total < remaining; i++) {
+		if (d->d_run_lengths[i] > remaining - total)
+			d->d_run_lengths[i] = remaining - total;
+		total += d->d_run_lengths[i];
+	}
+
+	if (i) {
+		sr_spew("Sending %u D4 runs, %" PRIu64 " samples", i, total);
+		runs.num_runs = i;
+		runs.unitsize = d->dig_sample_bytes;
+		runs.data = d->d_data_buf;
+		runs.lengths = d->d_run_lengths;
+		packet.type = SR_DF_LOGIC_RUNS;
+		packet.payload = &runs;
+		sr_session_send(sdi, &packet);
+	}
+
+	d->sent_samples += total;
+	d->num_runs = 0;
+}
+
+/* Variant of process_D4() for when the trigger has fired already, it
+ * passes the RLE data on as runs instead of expanding it. A run gets
+ * extended by the RLE bytes which follow its value. */
+static void process_D4_runs(struct sr_dev_inst *sdi, struct dev_context *d)
+{
+	uint8_t cbyte;
+	uint32_t rlecnt, didx;
+
+	while (d->ser_rdptr < d->bytes_avail) {
+		cbyte = d->buffer[d->ser_rdptr];
+		rlecnt = d4_rle[cbyte];
+
+		if (cbyte < 0x80 && !rlecnt) {
+			/* Any other character ends parsing - it could be a frame error
+			 * or a start of the final byte cnt */
+			if (cbyte == '$') {
+				sr_info("D4 Data stream stops with cbyte %d char %c rdidx %d cnt %lu",
+					cbyte, cbyte, d->ser_rdptr, d->byte_cnt);
+				d->rxstate = RX_STOPPED;
+			} else {
+				sr_err("D4 Data stream aborts with cbyte %d char %c rdidx %d cnt %lu",
+					cbyte, cbyte, d->ser_rdptr, d->byte_cnt);
+				d->rxstate = RX_ABORT;
+			}
+			break;
+		}
+
+		if (rlecnt) {
+			/* Repeats of a value sent in a previous serial read. */
+			if (!d->num_runs) {
+				memcpy(d->d_data_buf, d->d_last, d->dig_sample_bytes);
+				d->d_run_lengths[d->num_runs++] = 0;
+			}
+			d->d_run_lengths[d->num_runs - 1] += rlecnt;
+		}
+
+		if (cbyte >= 0x80) {
+			if (d->num_runs == d->sample_buf_size)
+				send_D4_runs(sdi, d);
+			didx = d->num_runs * d->dig_sample_bytes;
+			d->d_data_buf[didx] = cbyte & 0xF;
+			memset(&d->d_data_buf[didx + 1], 0, d->dig_sample_bytes - 1);
+			d->d_run_lengths[d->num_runs++] = 1;
+			d->d_last[0] = cbyte & 0xF;
+		}
+
+		d->byte_cnt++;
+		d->ser_rdptr++;
+	}
+
+	if (d->num_runs)
+		send_D4_runs(sdi, d);
+}
+
 /* Process incoming data stream assuming it is optimized packing of 4 channels
  * or less.
  * Each byte is 4 channels of data and a 3 bit rle value, or a larger rle value,
@@ -137,15 +244,20 @@ void process_D4(struct sr_dev_inst *sdi, struct dev_context *d)
 	uint8_t cbyte, cval;
 	uint32_t rlecnt = 0;
 
+	if (d->trigger_fired && d->d_run_lengths) {
+		process_D4_runs(sdi, d);
+		return;
+	}
+
 	while (d->ser_rdptr < d->bytes_avail) {
 		cbyte = d->buffer[(d->ser_rdptr)];
 
 		/*RLE only byte */
 		if ((cbyte >= 48) && (cbyte <= 127)) {
-			rlecnt += (cbyte - 47) * 8;
+			rlecnt += d4_rle[cbyte];
 			d->byte_cnt++;
 		} else if (cbyte >= 0x80) {	/* sample with possible rle */
-			rlecnt += (cbyte & 0x70) >> 4;
+			rlecnt += d4_rle[cbyte];
 			if (rlecnt) {
 				/* On a value change, duplicate the previous values first. */
 				rle_memset(d, rlecnt);
@@ -261,12 +373,9 @@ void process_slice(struct sr_dev_inst *sdi, struct dev_context *devc)
 
 	if (devc->buffer[devc->ser_rdptr] < 0x80) {
 		int16_t rlecnt;
-		if (devc->buffer[devc->ser_rdptr] <= 79)
-			rlecnt = devc->buffer[devc->ser_rdptr] - 47;
-		else
-			rlecnt = (devc->buffer[devc->ser_rdptr] - 78) * 32;
+		rlecnt = slice_rle[devc->buffer[devc->ser_rdptr]];
 
-		sr_info("RLEcnt of %d in %d", rlecnt, devc->buffer[devc->ser_rdptr]);
+		sr_spew("RLEcnt of %d in %d", rlecnt, devc->buffer[devc->ser_rdptr]);
 		if ((rlecnt < 1) || (rlecnt > 1568))
 			sr_err("Bad rlecnt val %d in %d",
 				rlecnt, devc->buffer[devc->ser_rdptr]);
@@ -646,21 +755,33 @@ int process_group(struct sr_dev_inst *sdi, struct dev_context *devc,
  * the full value of the rle */
 void rle_memset(struct dev_context *devc, uint32_t num_slices)
 {
-	uint32_t j, k, didx;
+	uint32_t didx, done, total, len;
+	uint8_t *dst;
 	sr_spew("rle_memset vals 0x%X, 0x%X, 0x%X slices %d dsb %d",
 		devc->d_last[0], devc->d_last[1], devc->d_last[2],
 		num_slices, devc->dig_sample_bytes);
 
+	if (!num_slices)
+		return;
+
 	/* Even if a channel is disabled, PV expects the same location and size for
-	 * the enabled channels as if the channel were enabled. */
-	for (j = 0; j < num_slices; j++) {
-		didx = devc->cbuf_wrptr * devc->dig_sample_bytes;
-		for (k = 0; k < devc->dig_sample_bytes; k++)
-			devc->d_data_buf[didx + k] =  devc->d_last[k];
-		/* cbuf_wrptr always counts slices/samples (and not the bytes in the
-		 * buffer) regardless of mode */
-		devc->cbuf_wrptr++;
+	 * the enabled channels as if the channel were enabled.
+	 * Write the value once, then copy what is there in doubling sizes. */
+	didx = devc->cbuf_wrptr * devc->dig_sample_bytes;
+	dst = &devc->d_data_buf[didx];
+	total = num_slices * devc->dig_sample_bytes;
+	if (devc->dig_sample_bytes == 1) {
+		memset(dst, devc->d_last[0], total);
+	} else {
+		memcpy(dst, devc->d_last, devc->dig_sample_bytes);
+		for (done = devc->dig_sample_bytes; done < total; done += len) {
+			len = MIN(done, total - done);
+			memcpy(&dst[done], dst, len);
+		}
 	}
+	/* cbuf_wrptr always counts slices/samples (and not the bytes in the
+	 * buffer) regardless of mode */
+	devc->cbuf_wrptr += num_slices;
 }
 
 /* This callback function is mapped from api.c with serial_source_add and is
@@ -124,6 +124,10 @@ struct dev_context {
 	uint8_t *d_data_buf;
 	/* Write pointer for the the per channel data buffers */
 	uint32_t cbuf_wrptr;
+	/* Run lengths for the values in d_data_buf, D4 mode sends the data
+	 * as runs once the trigger fired */
+	uint64_t *d_run_lengths;
+	uint32_t num_runs;
 	/* Size of packet data buffers for each channel */
 	uint32_t sample_buf_size;
 
@@ -423,7 +423,7 @@ static int config_get(uint32_t key, GVariant **data,
 		ret = rdtech_dps_get_state(sdi, &state, ST_CTX_CONFIG);
 		if (ret != SR_OK)
 			return ret;
-		if (!(state.mask & STATE_OUTPUT_ENABLED))
+		if (!(state.mask & STATE_OVP_THRESHOLD))
 			return SR_ERR_DATA;
 		*data = g_variant_new_double(state.ovp_threshold);
 		break;
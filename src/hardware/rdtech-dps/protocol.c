@@ -127,6 +127,23 @@ static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return ret;
 }
 
+/* Same retries for a set of register reads, in as few transactions as possible. */
+static int rdtech_dps_read_plan_run(struct sr_modbus_dev_inst *modbus,
+	struct sr_modbus_read_plan *plan)
+{
+	size_t retries;
+	int ret;
+
+	retries = 3;
+	while (retries--) {
+		ret = sr_modbus_read_plan_run(modbus, plan);
+		if (ret == SR_OK)
+			return ret;
+	}
+
+	return ret;
+}
+
 /* Set one 16bit register. LE format for DPS devices. */
 static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	uint16_t address, uint16_t value)
@@ -269,7 +286,7 @@ SR_PRIV int rdtech_dps_update_range(const struct sr_dev_inst *sdi)
 static int send_value(const struct sr_dev_inst *sdi,
 	struct sr_channel *ch, float value,
 	enum sr_mq mq, enum sr_mqflag mqflags,
-	enum sr_unit unit, int digits)
+	enum sr_unit unit, int digits, int64_t timestamp)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -282,6 +299,7 @@ static int send_value(const struct sr_dev_inst *sdi,
 	analog.meaning->channels = g_slist_append(NULL, ch);
 	analog.num_samples = 1;
 	analog.data = &value;
+	analog.timestamps = &timestamp;
 	analog.meaning->mq = mq;
 	analog.meaning->mqflags = mqflags;
 	analog.meaning->unit = unit;
@@ -311,7 +329,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
 	gboolean get_config, get_init_state, get_curr_meas;
-	uint16_t registers[14];
+	struct sr_modbus_read_plan *plan;
+	uint16_t registers[14], thresholds[2];
 	int ret;
 	const uint8_t *rdptr;
 	uint16_t uset_raw, iset_raw, uout_raw, iout_raw, power_raw;
@@ -353,14 +372,14 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 	}
 	/*
-	 * TODO Make use of this information to reduce the transfer
-	 * volume, especially on low bitrate serial connections. Though
-	 * the device firmware's samplerate is probably more limiting
-	 * than communication bandwidth is.
+	 * Only the protection thresholds live in a separate register
+	 * block, which is skipped unless the caller asked for config
+	 * details. That saves a Modbus transaction per acquisition
+	 * poll. The other blocks' details come for free.
 	 */
-	(void)get_config;
 	(void)get_init_state;
 	(void)get_curr_meas;
+	ovp_threshold = ocp_threshold = 0;
 
 	have_range = devc->model->n_ranges > 1;
 	if (!have_range)
@@ -376,11 +395,15 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		 * their bit fields. But then this is not too unusual for
 		 * a hardware specific device driver ...
 		 */
+		plan = sr_modbus_read_plan_new(0);
+		sr_modbus_read_plan_add(plan, REG_DPS_USET,
+			REG_DPS_ENABLE - REG_DPS_USET + 1, registers);
+		if (get_config)
+			sr_modbus_read_plan_add(plan, PRE_DPS_OVPSET, 2, thresholds);
 		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_DPS_USET, REG_DPS_ENABLE - REG_DPS_USET + 1,
-			registers);
+		ret = rdtech_dps_read_plan_run(modbus, plan);
 		g_mutex_unlock(&devc->rw_mutex);
+		sr_modbus_read_plan_free(plan);
 		if (ret != SR_OK)
 			return ret;
 
@@ -407,33 +430,31 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Transfer another chunk of registers in a single call. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			PRE_DPS_OVPSET, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
 		/* Interpret the second registers chunk's values. */
-		rdptr = (const void *)registers;
-		ovpset_raw = read_u16be_inc(&rdptr); /* PRE OVPSET */
-		ovp_threshold = ovpset_raw * devc->voltage_multiplier;
-		ocpset_raw = read_u16be_inc(&rdptr); /* PRE OCPSET */
-		ocp_threshold = ocpset_raw * devc->current_multiplier;
+		if (get_config) {
+			rdptr = (const void *)thresholds;
+			ovpset_raw = read_u16be_inc(&rdptr); /* PRE OVPSET */
+			ovp_threshold = ovpset_raw * devc->voltage_multiplier;
+			ocpset_raw = read_u16be_inc(&rdptr); /* PRE OCPSET */
+			ocp_threshold = ocpset_raw * devc->current_multiplier;
+		}
 
 		break;
 
 	case MODEL_RD:
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_VOLT_TGT,
+		/* Retrieve sets of adjacent registers. */
+		plan = sr_modbus_read_plan_new(0);
+		sr_modbus_read_plan_add(plan, REG_RD_VOLT_TGT,
 			devc->model->n_ranges > 1
 				? REG_RD_RANGE - REG_RD_VOLT_TGT + 1
 				: REG_RD_ENABLE - REG_RD_VOLT_TGT + 1,
 			registers);
+		if (get_config)
+			sr_modbus_read_plan_add(plan, REG_RD_OVP_THR, 2, thresholds);
+		g_mutex_lock(&devc->rw_mutex);
+		ret = rdtech_dps_read_plan_run(modbus, plan);
 		g_mutex_unlock(&devc->rw_mutex);
+		sr_modbus_read_plan_free(plan);
 		if (ret != SR_OK)
 			return ret;
 
@@ -464,20 +485,13 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 			range = read_u16be_inc(&rdptr) ? 1 : 0; /* RANGE */
 		}
 
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_OVP_THR, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
-		ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
-		ovp_threshold = ovpset_raw / devc->voltage_multiplier;
-		ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
-		ocp_threshold = ocpset_raw / devc->current_multiplier;
+		if (get_config) {
+			rdptr = (const void *)thresholds;
+			ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
+			ovp_threshold = ovpset_raw / devc->voltage_multiplier;
+			ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
+			ocp_threshold = ocpset_raw / devc->current_multiplier;
+		}
 
 		/* Details which we cannot query from the device. */
 		is_lock = FALSE;
@@ -489,13 +503,7 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		return SR_ERR_ARG;
 	}
 
-	/*
-	 * Store gathered details in the high level container.
-	 *
-	 * TODO Make use of the caller's context. The register access
-	 * code path above need not have gathered every detail in every
-	 * invocation.
-	 */
+	/* Store gathered details in the high level container. */
 	memset(state, 0, sizeof(*state));
 	state->lock = is_lock;
 	state->mask |= STATE_LOCK;
@@ -513,10 +521,12 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	state->mask |= STATE_VOLTAGE_TARGET;
 	state->current_limit = curr_limit;
 	state->mask |= STATE_CURRENT_LIMIT;
-	state->ovp_threshold = ovp_threshold;
-	state->mask |= STATE_OVP_THRESHOLD;
-	state->ocp_threshold = ocp_threshold;
-	state->mask |= STATE_OCP_THRESHOLD;
+	if (get_config) {
+		state->ovp_threshold = ovp_threshold;
+		state->mask |= STATE_OVP_THRESHOLD;
+		state->ocp_threshold = ocp_threshold;
+		state->mask |= STATE_OCP_THRESHOLD;
+	}
 	state->voltage = curr_voltage;
 	state->mask |= STATE_VOLTAGE;
 	state->current = curr_current;
@@ -726,6 +736,8 @@ SR_PRIV int rdtech_dps_receive_data(int fd, int revents, void *cb_data)
 	int ret;
 	struct sr_channel *ch;
 	const char *regulation_text, *range_text;
+	struct sr_modbus_dev_inst *modbus;
+	int64_t timestamp;
 
 	(void)fd;
 	(void)revents;
@@ -739,21 +751,24 @@ SR_PRIV int rdtech_dps_receive_data(int fd, int revents, void *cb_data)
 	ret = rdtech_dps_get_state(sdi, &state, ST_CTX_IN_ACQ);
 	if (ret != SR_OK)
 		return ret;
-
+	modbus = sdi->conn;
+	timestamp = modbus->rx_time;
 
 	/* Submit measurement data to the session feed. */
 	std_session_send_df_frame_begin(sdi);
 	ch = g_slist_nth_data(sdi->channels, 0);
 	send_value(sdi, ch, state.voltage,
 		SR_MQ_VOLTAGE, SR_MQFLAG_DC, SR_UNIT_VOLT,
-		devc->model->ranges[devc->curr_range].voltage_digits);
+		devc->model->ranges[devc->curr_range].voltage_digits,
+		timestamp);
 	ch = g_slist_nth_data(sdi->channels, 1);
 	send_value(sdi, ch, state.current,
 		SR_MQ_CURRENT, SR_MQFLAG_DC, SR_UNIT_AMPERE,
-		devc->model->ranges[devc->curr_range].current_digits);
+		devc->model->ranges[devc->curr_range].current_digits,
+		timestamp);
 	ch = g_slist_nth_data(sdi->channels, 2);
 	send_value(sdi, ch, state.power,
-		SR_MQ_POWER, 0, SR_UNIT_WATT, 2);
+		SR_MQ_POWER, 0, SR_UNIT_WATT, 2, timestamp);
 	std_session_send_df_frame_end(sdi);
 
 	/* Check for state changes. */
@@ -157,6 +157,7 @@ static const char *data_sources[] = {
 	"Live",
 	"Memory",
 	"Segmented",
+	"Record",
 };
 
 static const struct rigol_ds_command std_cmd[] = {
@@ -498,6 +499,7 @@ static int analog_frame_size(const struct sr_dev_inst *sdi)
 		return devc->model->series->live_samples;
 	case DATA_SOURCE_MEMORY:
 	case DATA_SOURCE_SEGMENTED:
+	case DATA_SOURCE_RECORD:
 		return devc->model->series->buffer_samples / analog_channels;
 	default:
 		return 0;
@@ -513,6 +515,7 @@ static int digital_frame_size(const struct sr_dev_inst *sdi)
 		return devc->model->series->live_samples * 2;
 	case DATA_SOURCE_MEMORY:
 	case DATA_SOURCE_SEGMENTED:
+	case DATA_SOURCE_RECORD:
 		return devc->model->series->buffer_samples * 2;
 	default:
 		return 0;
@@ -564,8 +567,10 @@ static int config_get(uint32_t key, GVariant **data,
 			*data = g_variant_new_string("Live");
 		else if (devc->data_source == DATA_SOURCE_MEMORY)
 			*data = g_variant_new_string("Memory");
-		else
+		else if (devc->data_source == DATA_SOURCE_SEGMENTED)
 			*data = g_variant_new_string("Segmented");
+		else
+			*data = g_variant_new_string("Record");
 		break;
 	case SR_CONF_LIMIT_FRAMES:
 		*data = g_variant_new_uint64(devc->limit_frames);
@@ -774,6 +779,9 @@ static int config_set(uint32_t key, GVariant *data,
 		else if (devc->model->series->protocol >= PROTOCOL_V3
 			 && !strcmp(tmp_str, "Segmented"))
 			devc->data_source = DATA_SOURCE_SEGMENTED;
+		else if (devc->model->series->protocol >= PROTOCOL_V3
+			 && !strcmp(tmp_str, "Record"))
+			devc->data_source = DATA_SOURCE_RECORD;
 		else {
 			sr_err("Unknown data source: '%s'.", tmp_str);
 			return SR_ERR;
@@ -851,10 +859,10 @@ static int config_list(uint32_t key, GVariant **data,
 			return SR_ERR_ARG;
 		switch (devc->model->series->protocol) {
 		case PROTOCOL_V1:
-			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 2);
+			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 3);
 			break;
 		case PROTOCOL_V2:
-			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 1);
+			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 2);
 			break;
 		default:
 			*data = g_variant_new_strv(ARRAY_AND_SIZE(data_sources));
@@ -875,7 +883,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	struct sr_channel *ch;
 	gboolean some_digital;
 	GSList *l;
-	char *cmd;
+	char *cmd, *mdep;
 	int protocol;
 	int ret;
 
@@ -947,58 +955,36 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			return SR_ERR;
 
 	/* Set memory mode. */
-	if (devc->data_source == DATA_SOURCE_SEGMENTED) {
-		switch (protocol) {
-		case PROTOCOL_V1:
-		case PROTOCOL_V2:
-			/* V1 and V2 do not have segmented data */
-			sr_err("Data source 'Segmented' not supported on this model");
-			break;
-		case PROTOCOL_V3:
-		case PROTOCOL_V4:
-		{
-			int frames = 0;
-			if (sr_scpi_get_int(sdi->conn,
-						protocol == PROTOCOL_V4 ? "FUNC:WREP:FEND?" :
-						"FUNC:WREP:FMAX?", &frames) != SR_OK)
-				return SR_ERR;
-			if (frames <= 0) {
-				sr_err("No segmented data available");
-				return SR_ERR;
-			}
-			devc->num_frames_segmented = frames;
-			break;
-		}
-		case PROTOCOL_V5:
-			/* The frame limit has to be read on the fly, just set up
-			 * reading of the first frame */
-			if (rigol_ds_config_set(sdi, "REC:CURR 1") != SR_OK)
-				return SR_ERR;
-			break;
-		default:
-			sr_err("Data source 'Segmented' not yet supported");
+	if (devc->data_source == DATA_SOURCE_SEGMENTED)
+		if (rigol_ds_segmented_start(sdi) != SR_OK)
 			return SR_ERR;
-		}
-	}
 
 	devc->analog_frame_size = analog_frame_size(sdi);
 	devc->digital_frame_size = digital_frame_size(sdi);
 
 	switch (devc->model->series->protocol) {
 	case PROTOCOL_V2:
-		if (rigol_ds_config_set(sdi, ":ACQ:MEMD LONG") != SR_OK)
+		if (rigol_ds_config_apply(sdi, ":ACQ:MEMD LONG") != SR_OK)
 			return SR_ERR;
 		break;
 	case PROTOCOL_V3:
 		/* Apparently for the DS2000 the memory
 		 * depth can only be set in Running state -
 		 * this matches the behaviour of the UI. */
-		if (rigol_ds_config_set(sdi, ":RUN") != SR_OK)
-			return SR_ERR;
-		if (rigol_ds_config_set(sdi, ":ACQ:MDEP %d",
-					devc->analog_frame_size) != SR_OK)
-			return SR_ERR;
-		if (rigol_ds_config_set(sdi, ":STOP") != SR_OK)
+		mdep = g_strdup_printf(":ACQ:MDEP %d", devc->analog_frame_size);
+		if (!sr_dev_command_changed(sdi, mdep)) {
+			g_free(mdep);
+			break;
+		}
+		ret = rigol_ds_config_set(sdi, ":RUN");
+		if (ret == SR_OK)
+			ret = rigol_ds_config_set(sdi, "%s", mdep);
+		if (ret == SR_OK)
+			ret = rigol_ds_config_set(sdi, ":STOP");
+		if (ret == SR_OK)
+			sr_dev_command_applied(sdi, mdep);
+		g_free(mdep);
+		if (ret != SR_OK)
 			return SR_ERR;
 		break;
 	default:
@@ -1037,8 +1023,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->sample_rate = 1. / xinc;
 	}
 
-	if (rigol_ds_capture_start(sdi) != SR_OK)
-		return SR_ERR;
+	if (devc->data_source == DATA_SOURCE_RECORD) {
+		/* The frames get read once they are all recorded. */
+		if (rigol_ds_record_start(sdi) != SR_OK)
+			return SR_ERR;
+	} else {
+		if (rigol_ds_capture_start(sdi) != SR_OK)
+			return SR_ERR;
+	}
 
 	/* Start of first frame. */
 	std_session_send_df_frame_begin(sdi);
@@ -27,7 +27,6 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
-#include <time.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -98,22 +97,34 @@ static void rigol_ds_set_wait_event(struct dev_context *devc, enum wait_events e
 	else
 		devc->wait_status = 1;
 	devc->wait_event = event;
+	devc->wait_start = devc->wait_poll = g_get_monotonic_time();
+}
+
+/* Whether frames are read from the scope's recording. */
+static gboolean rigol_ds_is_segmented(const struct dev_context *devc)
+{
+	return devc->data_source == DATA_SOURCE_SEGMENTED ||
+		devc->data_source == DATA_SOURCE_RECORD;
 }
 
 /*
- * Waiting for a event will return a timeout after 2 to 3 seconds in order
- * to not block the application.
+ * Waiting for an event polls the scope once per call, and returns
+ * SR_ERR_NA while the event is still pending. The receive callback then
+ * returns to the session loop and gets invoked again, so that other
+ * sources are not blocked until the scope is done.
  */
 static int rigol_ds_event_wait(const struct sr_dev_inst *sdi, char status1, char status2)
 {
 	char *buf, c;
 	struct dev_context *devc;
-	time_t start;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
 
-	start = time(NULL);
+	if (g_get_monotonic_time() - devc->wait_start >= 3 * G_USEC_PER_SEC) {
+		sr_dbg("Timeout waiting for trigger");
+		devc->wait_start = g_get_monotonic_time();
+	}
 
 	/*
 	 * Trigger status may return:
@@ -124,36 +135,20 @@ static int rigol_ds_event_wait(const struct sr_dev_inst *sdi, char status1, char
 	 * "STOP"        - stopped
 	 */
 
-	if (devc->wait_status == 1) {
-		do {
-			if (time(NULL) - start >= 3) {
-				sr_dbg("Timeout waiting for trigger");
-				return SR_ERR_TIMEOUT;
-			}
-
-			if (sr_scpi_get_string(sdi->conn, ":TRIG:STAT?", &buf) != SR_OK)
-				return SR_ERR;
-			c = buf[0];
-			g_free(buf);
-		} while (c == status1 || c == status2);
+	if (sr_scpi_get_string(sdi->conn, ":TRIG:STAT?", &buf) != SR_OK)
+		return SR_ERR;
+	c = buf[0];
+	g_free(buf);
 
+	if (devc->wait_status == 1) {
+		if (c == status1 || c == status2)
+			return SR_ERR_NA;
 		devc->wait_status = 2;
 	}
-	if (devc->wait_status == 2) {
-		do {
-			if (time(NULL) - start >= 3) {
-				sr_dbg("Timeout waiting for trigger");
-				return SR_ERR_TIMEOUT;
-			}
-
-			if (sr_scpi_get_string(sdi->conn, ":TRIG:STAT?", &buf) != SR_OK)
-				return SR_ERR;
-			c = buf[0];
-			g_free(buf);
-		} while (c != status1 && c != status2);
+	if (c != status1 && c != status2)
+		return SR_ERR_NA;
 
-		rigol_ds_set_wait_event(devc, WAIT_NONE);
-	}
+	rigol_ds_set_wait_event(devc, WAIT_NONE);
 
 	return SR_OK;
 }
@@ -193,8 +188,9 @@ static int rigol_ds_trigger_wait(const struct sr_dev_inst *sdi)
 			 */
 			s = (devc->timebase * devc->model->series->num_horizontal_divs
 			     * 85e6) / 100L;
-			sr_spew("Sleeping for %ld usecs instead of trigger-wait", s);
-			g_usleep(s);
+			if (g_get_monotonic_time() - devc->wait_start < s)
+				return SR_ERR_NA;
+			sr_spew("Waited for %ld usecs instead of trigger-wait", s);
 		}
 		rigol_ds_set_wait_event(devc, WAIT_NONE);
 		return SR_OK;
@@ -269,39 +265,40 @@ static int rigol_ds_block_wait(const struct sr_dev_inst *sdi)
 {
 	char *buf, c;
 	struct dev_context *devc;
-	time_t start;
+	gint64 now, interval;
 	int len, ret;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
 
 	if (devc->model->series->protocol == PROTOCOL_V3) {
-
-		start = time(NULL);
-
-		do {
-			if (time(NULL) - start >= 3) {
+		/*
+		 * The scope copies data really slowly from sample
+		 * memory to its output buffer, so try not to bother
+		 * it too much with SCPI requests but don't wait too
+		 * long for short sample frame sizes.
+		 */
+		interval = devc->analog_frame_size < (15 * 1000) ? (100 * 1000) : (1000 * 1000);
+		now = g_get_monotonic_time();
+		if (now - devc->wait_poll < interval)
+			return SR_ERR_NA;
+		devc->wait_poll = now;
+
+		/* "READ,nnnn" (still working) or "IDLE,nnnn" (finished) */
+		if (sr_scpi_get_string(sdi->conn, ":WAV:STAT?", &buf) != SR_OK)
+			return SR_ERR;
+		ret = parse_int(buf + 5, &len);
+		c = buf[0];
+		g_free(buf);
+		if (ret != SR_OK)
+			return SR_ERR;
+		if (c == 'R' && len < (1000 * 1000)) {
+			if (now - devc->wait_start >= 3 * G_USEC_PER_SEC) {
 				sr_dbg("Timeout waiting for data block");
-				return SR_ERR_TIMEOUT;
+				devc->wait_start = now;
 			}
-
-			/*
-			 * The scope copies data really slowly from sample
-			 * memory to its output buffer, so try not to bother
-			 * it too much with SCPI requests but don't wait too
-			 * long for short sample frame sizes.
-			 */
-			g_usleep(devc->analog_frame_size < (15 * 1000) ? (100 * 1000) : (1000 * 1000));
-
-			/* "READ,nnnn" (still working) or "IDLE,nnnn" (finished) */
-			if (sr_scpi_get_string(sdi->conn, ":WAV:STAT?", &buf) != SR_OK)
-				return SR_ERR;
-			ret = parse_int(buf + 5, &len);
-			c = buf[0];
-			g_free(buf);
-			if (ret != SR_OK)
-				return SR_ERR;
-		} while (c == 'R' && len < (1000 * 1000));
+			return SR_ERR_NA;
+		}
 	}
 
 	rigol_ds_set_wait_event(devc, WAIT_NONE);
@@ -333,6 +330,164 @@ SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *forma
 	}
 }
 
+/* Send a configuration setting, unless it was applied already. */
+SR_PRIV int rigol_ds_config_apply(const struct sr_dev_inst *sdi, const char *format, ...)
+{
+	va_list args;
+	char *command;
+	int ret;
+
+	va_start(args, format);
+	command = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	ret = SR_OK;
+	if (sr_dev_command_changed(sdi, command)) {
+		ret = rigol_ds_config_set(sdi, "%s", command);
+		if (ret == SR_OK)
+			sr_dev_command_applied(sdi, command);
+	}
+	g_free(command);
+
+	return ret;
+}
+
+/* Get the number of frames of the scope's recording, select the first one. */
+SR_PRIV int rigol_ds_segmented_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int protocol, frames;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	protocol = devc->model->series->protocol;
+
+	switch (protocol) {
+	case PROTOCOL_V1:
+	case PROTOCOL_V2:
+		/* V1 and V2 do not have segmented data */
+		sr_err("Data source 'Segmented' not supported on this model");
+		break;
+	case PROTOCOL_V3:
+	case PROTOCOL_V4:
+		frames = 0;
+		if (sr_scpi_get_int(sdi->conn,
+					protocol == PROTOCOL_V4 ? "FUNC:WREP:FEND?" :
+					"FUNC:WREP:FMAX?", &frames) != SR_OK)
+			return SR_ERR;
+		if (frames <= 0) {
+			sr_err("No segmented data available");
+			return SR_ERR;
+		}
+		devc->num_frames_segmented = frames;
+		break;
+	case PROTOCOL_V5:
+		/* The frame limit has to be read on the fly, just set up
+		 * reading of the first frame */
+		if (rigol_ds_config_set(sdi, "REC:CURR 1") != SR_OK)
+			return SR_ERR;
+		break;
+	default:
+		sr_err("Data source 'Segmented' not yet supported");
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Have the scope record limit_frames triggered frames into its sample
+ * memory. Each trigger only costs the scope's re-arm time, instead of a
+ * download of the frame. The frames get read once the recording is done.
+ */
+SR_PRIV int rigol_ds_record_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const char *prefix;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	if (devc->limit_frames == 0) {
+		sr_err("Data source 'Record' needs a frame limit.");
+		return SR_ERR_ARG;
+	}
+
+	switch (devc->model->series->protocol) {
+	case PROTOCOL_V3:
+	case PROTOCOL_V4:
+		prefix = ":FUNC:WREC";
+		if (rigol_ds_config_set(sdi, "%s:FEND %" PRIu64, prefix,
+				devc->limit_frames) != SR_OK)
+			return SR_ERR;
+		break;
+	case PROTOCOL_V5:
+		prefix = ":REC:WREC";
+		if (rigol_ds_config_set(sdi, "%s:FRAM %" PRIu64, prefix,
+				devc->limit_frames) != SR_OK)
+			return SR_ERR;
+		break;
+	default:
+		sr_err("Data source 'Record' not supported on this model");
+		return SR_ERR;
+	}
+
+	sr_dbg("Recording %" PRIu64 " frames", devc->limit_frames);
+
+	if (rigol_ds_config_set(sdi, "%s:ENAB ON", prefix) != SR_OK)
+		return SR_ERR;
+	if (rigol_ds_config_set(sdi, ":RUN") != SR_OK)
+		return SR_ERR;
+	if (rigol_ds_config_set(sdi, "%s:OPER RUN", prefix) != SR_OK)
+		return SR_ERR;
+
+	rigol_ds_set_wait_event(devc, WAIT_RECORD);
+
+	return SR_OK;
+}
+
+/* Wait for the recording to finish, then start reading its first frame. */
+static int rigol_ds_record_wait(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	gint64 now;
+	char *buf, c;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	/* Recording takes a while, don't bother the scope too often. */
+	now = g_get_monotonic_time();
+	if (now - devc->wait_poll < 100 * 1000)
+		return SR_ERR_NA;
+	devc->wait_poll = now;
+
+	/* "RUN" while recording, "STOP" when done */
+	if (sr_scpi_get_string(sdi->conn,
+			devc->model->series->protocol >= PROTOCOL_V5 ?
+				":REC:WREC:OPER?" : ":FUNC:WREC:OPER?",
+			&buf) != SR_OK)
+		return SR_ERR;
+	c = buf[0];
+	g_free(buf);
+	if (c == 'R')
+		return SR_ERR_NA;
+
+	sr_dbg("Recording done after %" PRIi64 " ms",
+		(now - devc->wait_start) / 1000);
+
+	rigol_ds_set_wait_event(devc, WAIT_NONE);
+
+	/* Frames of the recording are only read out while stopped. */
+	if (rigol_ds_config_set(sdi, ":STOP") != SR_OK)
+		return SR_ERR;
+	if (rigol_ds_segmented_start(sdi) != SR_OK)
+		return SR_ERR;
+
+	return rigol_ds_capture_start(sdi);
+}
+
 /* Start capturing a new frameset */
 SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 {
@@ -442,7 +597,7 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 			if (devc->data_source == DATA_SOURCE_LIVE && rigol_ds_config_set(sdi, ":SINGL") != SR_OK)
 				return SR_ERR;
 			rigol_ds_set_wait_event(devc, WAIT_STOP);
-			if (devc->data_source == DATA_SOURCE_SEGMENTED &&
+			if (rigol_ds_is_segmented(devc) &&
 					devc->model->series->protocol <= PROTOCOL_V4)
 				if (rigol_ds_config_set(sdi, "FUNC:WREP:FCUR %d", devc->num_frames + 1) != SR_OK)
 					return SR_ERR;
@@ -544,6 +699,7 @@ SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi)
 	devc->num_channel_bytes = 0;
 	devc->num_header_bytes = 0;
 	devc->num_block_bytes = 0;
+	devc->block_requested = FALSE;
 
 	return SR_OK;
 }
@@ -559,7 +715,8 @@ static int rigol_ds_read_header(struct sr_dev_inst *sdi)
 
 	/* Try to read the hashsign and length digit. */
 	if (devc->num_header_bytes < 2) {
-		ret = sr_scpi_read_data(scpi, buf + devc->num_header_bytes,
+		ret = sr_scpi_read_data_nonblocking(scpi,
+				buf + devc->num_header_bytes,
 				2 - devc->num_header_bytes);
 		if (ret < 0) {
 			sr_err("Read error while reading data header.");
@@ -580,7 +737,8 @@ static int rigol_ds_read_header(struct sr_dev_inst *sdi)
 
 	/* Try to read the length. */
 	if (devc->num_header_bytes < header_length) {
-		ret = sr_scpi_read_data(scpi, buf + devc->num_header_bytes,
+		ret = sr_scpi_read_data_nonblocking(scpi,
+				buf + devc->num_header_bytes,
 				header_length - devc->num_header_bytes);
 		if (ret < 0) {
 			sr_err("Read error while reading data header.");
@@ -620,6 +778,8 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	int len, i, vref;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
+	uint64_t block_size;
+	gboolean set_range;
 
 	(void)fd;
 
@@ -657,6 +817,18 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		if (rigol_ds_channel_start(sdi) != SR_OK)
 			return TRUE;
 		return TRUE;
+	case WAIT_RECORD:
+		switch (rigol_ds_record_wait(sdi)) {
+		case SR_OK:
+		case SR_ERR_NA:
+			break;
+		default:
+			sr_err("Error while reading the recording, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sr_dev_acquisition_stop(sdi);
+			break;
+		}
+		return TRUE;
 	default:
 		sr_err("BUG: Unknown event target encountered");
 		break;
@@ -667,13 +839,22 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	expected_data_bytes = ch->type == SR_CHANNEL_ANALOG ?
 			devc->analog_frame_size : devc->digital_frame_size;
 
-	if (devc->num_block_bytes == 0) {
+	/*
+	 * Recorded frames are short, and read in a single block each.
+	 * The block range only needs setting up again for frames which
+	 * take several blocks.
+	 */
+	block_size = rigol_ds_is_segmented(devc) ?
+		ACQ_SEGMENT_BLOCK_SIZE : ACQ_BLOCK_SIZE;
+	set_range = first_frame || devc->analog_frame_size > block_size;
+
+	if (devc->num_block_bytes == 0 && !devc->block_requested) {
 		if (devc->model->series->protocol >= PROTOCOL_V4) {
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:START %d",
+			if (set_range && rigol_ds_config_set(sdi, ":WAV:START %d",
 					devc->num_channel_bytes + 1) != SR_OK)
 				return TRUE;
-			if (first_frame && rigol_ds_config_set(sdi, ":WAV:STOP %d",
-					MIN(devc->num_channel_bytes + ACQ_BLOCK_SIZE,
+			if (set_range && rigol_ds_config_set(sdi, ":WAV:STOP %d",
+					MIN(devc->num_channel_bytes + block_size,
 						devc->analog_frame_size)) != SR_OK)
 				return TRUE;
 		}
@@ -687,13 +868,18 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 		if (sr_scpi_read_begin(scpi) != SR_OK)
 			return TRUE;
+		devc->block_requested = TRUE;
+	}
 
+	if (devc->num_block_bytes == 0) {
 		if (devc->format == FORMAT_IEEE488_2) {
-			sr_dbg("New block header expected");
+			if (devc->num_header_bytes == 0)
+				sr_dbg("New block header expected");
 			len = rigol_ds_read_header(sdi);
 			if (len == 0)
 				/* Still reading the header. */
 				return TRUE;
+			devc->block_requested = FALSE;
 			if (len == -1) {
 				sr_err("Error while reading block header, aborting capture.");
 				std_session_send_df_frame_end(sdi);
@@ -715,6 +901,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			}
 			devc->num_block_bytes = len;
 		} else {
+			devc->block_requested = FALSE;
 			devc->num_block_bytes = expected_data_bytes;
 		}
 		devc->num_block_read = 0;
@@ -725,7 +912,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		len = ACQ_BUFFER_SIZE;
 	sr_dbg("Requesting read of %d bytes", len);
 
-	len = sr_scpi_read_data(scpi, (char *)devc->buffer, len);
+	len = sr_scpi_read_data_nonblocking(scpi, (char *)devc->buffer, len);
 
 	if (len == -1) {
 		sr_err("Error while reading block data, aborting capture.");
@@ -733,6 +920,9 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		sr_dev_acquisition_stop(sdi);
 		return TRUE;
 	}
+	if (len == 0)
+		/* Nothing has arrived yet, come back later. */
+		return TRUE;
 
 	sr_dbg("Received %d bytes.", len);
 
@@ -827,7 +1017,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		/* V5 has no way to read the number of recorded frames, so try to set the
 		 * next frame and read it back instead.
 		 */
-		if (devc->data_source == DATA_SOURCE_SEGMENTED &&
+		if (rigol_ds_is_segmented(devc) &&
 				devc->model->series->protocol == PROTOCOL_V5) {
 			int frames = 0;
 			if (rigol_ds_config_set(sdi, "REC:CURR %d", devc->num_frames + 1) != SR_OK)
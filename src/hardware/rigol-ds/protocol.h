@@ -34,6 +34,9 @@
 /* Maximum number of samples to retrieve at once. */
 #define ACQ_BLOCK_SIZE (30 * 1000)
 
+/* Maximum number of samples of a recorded frame to retrieve at once. */
+#define ACQ_SEGMENT_BLOCK_SIZE (250 * 1000)
+
 #define MAX_ANALOG_CHANNELS 4
 #define MAX_DIGITAL_CHANNELS 16
 
@@ -56,6 +59,8 @@ enum data_source {
 	DATA_SOURCE_LIVE,
 	DATA_SOURCE_MEMORY,
 	DATA_SOURCE_SEGMENTED,
+	/* Record limit_frames frames, then read them like Segmented. */
+	DATA_SOURCE_RECORD,
 };
 
 struct rigol_ds_vendor {
@@ -101,6 +106,7 @@ enum wait_events {
 	WAIT_TRIGGER, /* Wait for trigger (only live capture) */
 	WAIT_BLOCK,   /* Wait for block data (only when reading sample mem) */
 	WAIT_STOP,    /* Wait for scope stopping (only single shots) */
+	WAIT_RECORD,  /* Wait for the waveform recording to finish */
 };
 
 struct dev_context {
@@ -160,12 +166,20 @@ struct dev_context {
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status */
 	int wait_status;
+	/* When the wait started, and when the scope was last polled (us) */
+	gint64 wait_start;
+	gint64 wait_poll;
+	/* Data block requested, its header not read yet */
+	gboolean block_requested;
 	/* Acq buffers used for reading from the scope and sending data to app */
 	unsigned char *buffer;
 	float *data;
 };
 
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
+SR_PRIV int rigol_ds_config_apply(const struct sr_dev_inst *sdi, const char *format, ...);
+SR_PRIV int rigol_ds_record_start(const struct sr_dev_inst *sdi);
+SR_PRIV int rigol_ds_segmented_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_channel_start(const struct sr_dev_inst *sdi);
 SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data);
@@ -190,7 +190,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -214,7 +214,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		/* Give the device some time to come back and scan again */
 		libusb_free_device_list(devlist, 1);
 		g_usleep(500 * 1000);
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	}
 	if (conn)
 		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
@@ -578,6 +578,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			continue;
 
 		mask = 1 << c->index;
+		devc->dig_channel_bits[devc->dig_channel_cnt] = c->index;
 		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
 		devc->dig_channel_mask |= mask;
 
@@ -797,6 +798,7 @@ SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi)
 
 	devc->conv_size = 0;
 	devc->batch_index = 0;
+	devc->planar = sr_session_logic_planar_accepted(sdi->session);
 
 	write_reg(sdi, 0x00, 0x01);
 
@@ -841,48 +843,79 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
+/*
+ * Pass on complete batches. These are bit planar logic data: a 32bit
+ * word per active digital channel, the most significant bit is the
+ * first sample. Either send them as they are, or convert them into
+ * the conversion buffer.
+ */
+static void saleae_logic_pro_emit_batches(const struct sr_dev_inst *sdi,
+					  const uint32_t *words, size_t count)
+{
+	struct dev_context *devc = sdi->priv;
+	const struct sr_datafeed_logic_planar planar = {
+		.num_blocks = count,
+		.unitsize = 2,
+		.num_planes = devc->dig_channel_cnt,
+		.plane_bits = devc->dig_channel_bits,
+		.data = (uint32_t *)words,
+	};
+	const struct sr_datafeed_packet packet = {
+		.type = SR_DF_LOGIC_PLANAR,
+		.payload = &planar,
+	};
+
+	if (devc->planar) {
+		sr_session_send(sdi, &packet);
+		return;
+	}
+
+	sr_logic_planar_to_logic(&planar, devc->conv_buffer + devc->conv_size);
+	devc->conv_size += count * CONV_BATCH_SIZE;
+}
+
 /*
  * One batch from the device consists of 32 samples per active digital channel.
  * This stream of batches is packed into USB packets with 16384 bytes each.
+ * Batches which span packets are collected in the device context, all
+ * others are taken straight from the packet.
  */
-static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
-					 const uint32_t *src, size_t srccnt)
+static void saleae_logic_pro_process_data(const struct sr_dev_inst *sdi,
+					  const uint32_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
-	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
-
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
+	size_t batch_size, count;
+
 	/* Reset converted size. */
 	devc->conv_size = 0;
 
-	batch_index = devc->batch_index;
-	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
-
-		/* Last index of the batch. */
-		if (++batch_index == devc->dig_channel_cnt) {
-			devc->conv_size += CONV_BATCH_SIZE;
-			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
-		}
+	batch_size = devc->dig_channel_cnt;
+	if (!batch_size)
+		return;
+
+	/* Complete the batch which the previous packet started. */
+	if (devc->batch_index) {
+		count = MIN(batch_size - devc->batch_index, srccnt);
+		memcpy(&devc->batch_words[devc->batch_index], src,
+		       count * sizeof(*src));
+		devc->batch_index += count;
+		src += count;
+		srccnt -= count;
+		if (devc->batch_index < batch_size)
+			return;
+		saleae_logic_pro_emit_batches(sdi, devc->batch_words, 1);
+		devc->batch_index = 0;
 	}
-	devc->batch_index = batch_index;
+
+	count = srccnt / batch_size;
+	if (count)
+		saleae_logic_pro_emit_batches(sdi, src, count);
+	src += count * batch_size;
+	srccnt -= count * batch_size;
+
+	/* Keep the start of a batch which spans packets. */
+	memcpy(devc->batch_words, src, srccnt * sizeof(*src));
+	devc->batch_index = srccnt;
 }
 
 SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *transfer)
@@ -903,8 +936,9 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 		return;
 	}
 
-	saleae_logic_pro_convert_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
-	saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
+	saleae_logic_pro_process_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
+	if (devc->conv_size)
+		saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
 
 	if ((ret = libusb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
 		sr_dbg("FIXME resubmit failed");
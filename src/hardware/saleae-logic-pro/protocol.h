@@ -40,6 +40,7 @@ struct dev_context {
 	unsigned int dig_channel_cnt;
 	uint16_t dig_channel_mask;
 	uint16_t dig_channel_masks[16];
+	uint8_t dig_channel_bits[16];
 	uint64_t dig_samplerate;
 
 	uint32_t lfsr;
@@ -51,6 +52,8 @@ struct dev_context {
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
 	unsigned int batch_index;
+	uint32_t batch_words[16];
+	gboolean planar;
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
@@ -170,7 +170,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all Logic16 devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -250,7 +250,7 @@ static int logic16_dev_open(struct sr_dev_inst *sdi)
 	drvc = di->context;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -338,7 +338,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	int ret;
-	int64_t timediff_us, timediff_ms;
 
 	devc = sdi->priv;
 
@@ -346,26 +345,11 @@ static int dev_open(struct sr_dev_inst *sdi)
 	 * If the firmware was recently uploaded, wait up to MAX_RENUM_DELAY_MS
 	 * milliseconds for the FX2 to renumerate.
 	 */
-	ret = SR_ERR;
 	if (devc->fw_updated > 0) {
-		sr_info("Waiting for device to reset.");
-		/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
-		g_usleep(300 * 1000);
-		timediff_ms = 0;
-		while (timediff_ms < MAX_RENUM_DELAY_MS) {
-			if ((ret = logic16_dev_open(sdi)) == SR_OK)
-				break;
-			g_usleep(100 * 1000);
-
-			timediff_us = g_get_monotonic_time() - devc->fw_updated;
-			timediff_ms = timediff_us / 1000;
-			sr_spew("Waited %" PRIi64 "ms.", timediff_ms);
-		}
-		if (ret != SR_OK) {
-			sr_err("Device failed to renumerate.");
+		ret = ezusb_wait_renum(sdi, devc->fw_updated,
+			EZUSB_RENUM_GONE_DELAY_MS, MAX_RENUM_DELAY_MS, logic16_dev_open);
+		if (ret != SR_OK)
 			return SR_ERR;
-		}
-		sr_info("Device came back after %" PRIi64 "ms.", timediff_ms);
 	} else {
 		sr_info("Firmware upload was not needed.");
 		ret = logic16_dev_open(sdi);
@@ -578,17 +562,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		channel_bit = 1 << (ch->index);
 
 		devc->cur_channels |= channel_bit;
-
-#ifdef WORDS_BIGENDIAN
-		/*
-		 * Output logic data should be stored in little endian format.
-		 * To speed things up during conversion, do the switcharoo
-		 * here instead.
-		 */
-		channel_bit = 1 << (ch->index ^ 8);
-#endif
-
-		devc->channel_masks[devc->num_channels++] = channel_bit;
+		devc->channel_index[devc->num_channels++] = ch->index;
 	}
 
 	return SR_OK;
@@ -647,9 +621,19 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->sent_samples = 0;
 	devc->empty_transfer_count = 0;
 	devc->cur_channel = 0;
-	memset(devc->channel_data, 0, sizeof(devc->channel_data));
+	memset(devc->conv_acc, 0, sizeof(devc->conv_acc));
+
+	/*
+	 * Send 8-bit samples when only the lower 8 channels are enabled,
+	 * which halves the data rate for the session. The soft trigger
+	 * checks all 16 channels, stick with 16-bit samples then.
+	 */
+	trigger = sr_session_trigger_get(sdi->session);
+	devc->unitsize = 2;
+	if (!(devc->cur_channels & 0xff00) && !trigger)
+		devc->unitsize = 1;
 
-	if ((trigger = sr_session_trigger_get(sdi->session))) {
+	if (trigger) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
@@ -663,7 +647,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	timeout = get_timeout(devc);
 	num_transfers = get_number_of_transfers(devc);
 	size = get_buffer_size(devc);
-	convsize = (size / devc->num_channels + 2) * 16;
+	convsize = (size / devc->num_channels + 2) * 16 * devc->unitsize / 2;
 	devc->submitted_transfers = 0;
 
 	devc->convbuffer_size = convsize;
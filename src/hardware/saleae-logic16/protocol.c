@@ -457,17 +457,91 @@ static int configure_led(const struct sr_dev_inst *sdi)
 	return set_led_mode(sdi, 1, 6250, 0, 1);
 }
 
-static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
-				 enum voltage_range vrange)
+static void fpga_upload_id(const struct sr_dev_inst *sdi, char *id, size_t len)
+{
+	struct sr_usb_dev_inst *usb;
+
+	usb = sdi->conn;
+	snprintf(id, len, "usb/%d.%d", usb->bus, usb->address);
+}
+
+static int send_fpga_bitstream(const struct sr_dev_inst *sdi,
+			       const char *name)
 {
 	uint64_t sum;
 	struct sr_resource bitstream;
-	struct dev_context *devc;
 	struct drv_context *drvc;
-	const char *name;
 	ssize_t chunksize;
 	int ret;
 	uint8_t command[64];
+	char id[32];
+
+	drvc = sdi->driver->context;
+	fpga_upload_id(sdi, id, sizeof(id));
+
+	sr_info("Uploading FPGA bitstream '%s'.", name);
+	ret = sr_resource_open(drvc->sr_ctx, &bitstream,
+			SR_RESOURCE_FIRMWARE, name);
+	if (ret != SR_OK)
+		return ret;
+
+	sr_resource_upload_done(drvc->sr_ctx, id, SR_RESOURCE_FIRMWARE, NULL);
+	command[0] = COMMAND_FPGA_UPLOAD_INIT;
+	if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK) {
+		sr_resource_close(drvc->sr_ctx, &bitstream);
+		return ret;
+	}
+
+	sum = 0;
+	while (1) {
+		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
+				&command[2], sizeof(command) - 2);
+		if (chunksize < 0) {
+			sr_resource_close(drvc->sr_ctx, &bitstream);
+			return SR_ERR;
+		}
+		if (chunksize == 0)
+			break;
+		command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
+		command[1] = chunksize;
+
+		ret = do_ep1_command(sdi, command, chunksize + 2,
+				NULL, 0);
+		if (ret != SR_OK) {
+			sr_resource_close(drvc->sr_ctx, &bitstream);
+			return ret;
+		}
+		sum += chunksize;
+	}
+	sr_resource_close(drvc->sr_ctx, &bitstream);
+	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.", sum);
+
+	return SR_OK;
+}
+
+static int start_fpga(const struct sr_dev_inst *sdi)
+{
+	int ret;
+
+	/* This needs to be called before accessing any FPGA registers. */
+	if ((ret = setup_register_mapping(sdi)) != SR_OK)
+		return ret;
+
+	if ((ret = prime_fpga(sdi)) != SR_OK)
+		return ret;
+
+	return configure_led(sdi);
+}
+
+static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
+				 enum voltage_range vrange)
+{
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	const char *name;
+	gboolean reused;
+	int ret;
+	char id[32];
 
 	devc = sdi->priv;
 	drvc = sdi->driver->context;
@@ -475,6 +549,8 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 	if (devc->cur_voltage_range == vrange)
 		return SR_OK;
 
+	name = NULL;
+	reused = FALSE;
 	if (devc->fpga_variant != FPGA_VARIANT_MCUPRO) {
 		switch (vrange) {
 		case VOLTAGE_RANGE_18_33_V:
@@ -488,52 +564,29 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 			return SR_ERR;
 		}
 
-		sr_info("Uploading FPGA bitstream '%s'.", name);
-		ret = sr_resource_open(drvc->sr_ctx, &bitstream,
+		/* The FPGA keeps its bitstream while the device is attached. */
+		fpga_upload_id(sdi, id, sizeof(id));
+		reused = sr_resource_upload_matches(drvc->sr_ctx, id,
 				SR_RESOURCE_FIRMWARE, name);
-		if (ret != SR_OK)
+		if (reused)
+			sr_info("FPGA bitstream '%s' is already loaded.", name);
+		else if ((ret = send_fpga_bitstream(sdi, name)) != SR_OK)
 			return ret;
+	}
 
-		command[0] = COMMAND_FPGA_UPLOAD_INIT;
-		if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK) {
-			sr_resource_close(drvc->sr_ctx, &bitstream);
+	ret = start_fpga(sdi);
+	if (ret != SR_OK && reused) {
+		sr_dbg("FPGA not operational, uploading bitstream again.");
+		reused = FALSE;
+		if ((ret = send_fpga_bitstream(sdi, name)) != SR_OK)
 			return ret;
-		}
-
-		sum = 0;
-		while (1) {
-			chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-					&command[2], sizeof(command) - 2);
-			if (chunksize < 0) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR;
-			}
-			if (chunksize == 0)
-				break;
-			command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
-			command[1] = chunksize;
-
-			ret = do_ep1_command(sdi, command, chunksize + 2,
-					NULL, 0);
-			if (ret != SR_OK) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return ret;
-			}
-			sum += chunksize;
-		}
-		sr_resource_close(drvc->sr_ctx, &bitstream);
-		sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.", sum);
+		ret = start_fpga(sdi);
 	}
-
-	/* This needs to be called before accessing any FPGA registers. */
-	if ((ret = setup_register_mapping(sdi)) != SR_OK)
-		return ret;
-
-	if ((ret = prime_fpga(sdi)) != SR_OK)
-		return ret;
-
-	if ((ret = configure_led(sdi)) != SR_OK)
+	if (ret != SR_OK)
 		return ret;
+	if (name && !reused)
+		sr_resource_upload_done(drvc->sr_ctx, id,
+				SR_RESOURCE_FIRMWARE, name);
 
 	devc->cur_voltage_range = vrange;
 	return SR_OK;
@@ -803,40 +856,74 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
+/*
+ * The device sends 16 samples of one channel in a 16-bit word, the
+ * first sample in the MSB. This table spreads the bits of one byte of
+ * such a word to the LSBs of 8 bytes, the first sample in byte 0.
+ */
+#define SPREAD_BIT(b, i) ((uint64_t)(((b) >> (7 - (i))) & 1) << (8 * (i)))
+#define SPREAD(b)	(SPREAD_BIT(b, 0) | SPREAD_BIT(b, 1) | \
+			SPREAD_BIT(b, 2) | SPREAD_BIT(b, 3) | \
+			SPREAD_BIT(b, 4) | SPREAD_BIT(b, 5) | \
+			SPREAD_BIT(b, 6) | SPREAD_BIT(b, 7))
+#define SPREAD_R2(n)	SPREAD(n), SPREAD((n) + 1), \
+			SPREAD((n) + 2), SPREAD((n) + 3)
+#define SPREAD_R4(n)	SPREAD_R2(n), SPREAD_R2((n) + 4), \
+			SPREAD_R2((n) + 8), SPREAD_R2((n) + 12)
+#define SPREAD_R6(n)	SPREAD_R4(n), SPREAD_R4((n) + 16), \
+			SPREAD_R4((n) + 32), SPREAD_R4((n) + 48)
+#define SPREAD_R8()	SPREAD_R6(0), SPREAD_R6(64), \
+			SPREAD_R6(128), SPREAD_R6(192)
+
+static const uint64_t spread_bits[256] = { SPREAD_R8() };
+
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
-	uint16_t *channel_data;
-	int i, cur_channel;
+	uint64_t *acc;
+	const size_t unitsize = devc->unitsize;
+	int i, cur_channel, shift;
 	size_t ret = 0;
-	uint16_t sample, channel_mask;
 
 	srccnt /= 2;
 
-	channel_data = devc->channel_data;
 	cur_channel = devc->cur_channel;
 
+	/*
+	 * Accumulate the samples of a round over all enabled channels.
+	 * conv_acc[] holds one byte per sample: samples 0-7 and 8-15
+	 * of channels 0-7, then the same for channels 8-15.
+	 */
 	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
+		shift = devc->channel_index[cur_channel];
+		acc = &devc->conv_acc[(shift >> 3) * 2];
+		shift &= 7;
+		acc[0] |= spread_bits[src[1]] << shift;
+		acc[1] |= spread_bits[src[0]] << shift;
 		src += 2;
 
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
-
 		if (++cur_channel == devc->num_channels) {
 			cur_channel = 0;
-			if (destcnt < 16 * 2) {
+			if (destcnt < 16 * unitsize) {
 				sr_err("Conversion buffer too small!");
 				break;
 			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
-			dest += 16 * 2;
+			acc = devc->conv_acc;
+			if (unitsize == 1) {
+				write_u64le(&dest[0], acc[0]);
+				write_u64le(&dest[8], acc[1]);
+			} else {
+				for (i = 0; i < 8; i++) {
+					dest[2 * i + 0] = acc[0] >> (8 * i);
+					dest[2 * i + 1] = acc[2] >> (8 * i);
+					dest[2 * i + 16] = acc[1] >> (8 * i);
+					dest[2 * i + 17] = acc[3] >> (8 * i);
+				}
+			}
+			memset(devc->conv_acc, 0, sizeof(devc->conv_acc));
+			dest += 16 * unitsize;
 			ret += 16;
-			destcnt -= 16 * 2;
+			destcnt -= 16 * unitsize;
 		}
 	}
 
@@ -852,12 +939,14 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 	struct sr_datafeed_logic logic;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	size_t unitsize;
 	size_t new_samples, num_samples;
 	int trigger_offset;
 	int pre_trigger_samples;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
+	unitsize = devc->unitsize;
 
 	/*
 	 * If acquisition has already ended, just free any queued up
@@ -925,14 +1014,14 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 		if (devc->limit_samples &&
 				new_samples > devc->limit_samples - devc->sent_samples)
 			new_samples = devc->limit_samples - devc->sent_samples;
-		logic.length = new_samples * 2;
-		logic.unitsize = 2;
+		logic.length = new_samples * unitsize;
+		logic.unitsize = unitsize;
 		logic.data = devc->convbuffer;
 		sr_session_send(sdi, &packet);
 		devc->sent_samples += new_samples;
 	} else {
 		trigger_offset = soft_trigger_logic_check(devc->stl,
-				devc->convbuffer, new_samples * 2, &pre_trigger_samples);
+				devc->convbuffer, new_samples * unitsize, &pre_trigger_samples);
 		if (trigger_offset > -1) {
 			devc->sent_samples += pre_trigger_samples;
 			packet.type = SR_DF_LOGIC;
@@ -941,9 +1030,9 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 			if (devc->limit_samples &&
 					num_samples > devc->limit_samples - devc->sent_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
-			logic.length = num_samples * 2;
-			logic.unitsize = 2;
-			logic.data = devc->convbuffer + trigger_offset * 2;
+			logic.length = num_samples * unitsize;
+			logic.unitsize = unitsize;
+			logic.data = devc->convbuffer + trigger_offset * unitsize;
 			sr_session_send(sdi, &packet);
 			devc->sent_samples += num_samples;
 
@@ -79,8 +79,11 @@ struct dev_context {
 	int empty_transfer_count;
 	int num_channels;
 	int cur_channel;
-	uint16_t channel_masks[16];
-	uint16_t channel_data[16];
+	uint8_t channel_index[16];
+	/* Samples in conversion, see convert_sample_data(). */
+	uint64_t conv_acc[4];
+	/* Bytes per sample sent to the session, 1 or 2. */
+	size_t unitsize;
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
 	struct soft_trigger_logic *stl;
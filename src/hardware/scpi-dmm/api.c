@@ -63,6 +63,30 @@ static const struct scpi_command cmdset_agilent[] = {
 	ALL_ZERO,
 };
 
+/*
+ * The 34460A and 34465A keep taking readings into their memory, which
+ * gets read in bulk (R? removes the readings it returns). Their setup
+ * gets restored when the acquisition stops.
+ */
+static const struct scpi_command cmdset_keysight[] = {
+	{ DMM_CMD_SETUP_REMOTE, "\n", },
+	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
+	{ DMM_CMD_SETUP_FUNC, "CONF:%s", },
+	{ DMM_CMD_QUERY_FUNC, "CONF?", },
+	{ DMM_CMD_START_ACQ, "INIT", },
+	{ DMM_CMD_STOP_ACQ, "ABORT", },
+	{ DMM_CMD_QUERY_VALUE, "FETCH?", },
+	{ DMM_CMD_QUERY_PREC, "CONF?", },
+	{ DMM_CMD_QUERY_RANGE_AUTO, "%s:RANGE:AUTO?", },
+	{ DMM_CMD_QUERY_RANGE, "%s:RANGE?", },
+	{ DMM_CMD_SETUP_RANGE, "CONF:%s %s", },
+	{ DMM_CMD_SETUP_BUFFERED, "TRIG:SOUR IMM;:TRIG:COUN INF;:SAMP:COUN 1", },
+	{ DMM_CMD_SETUP_BINARY, "FORM:DATA REAL,64;:FORM:BORD NORM", },
+	{ DMM_CMD_QUERY_BUFFERED, "R? %d", },
+	{ DMM_CMD_STOP_BUFFERED, "FORM:DATA ASC;:TRIG:COUN 1", },
+	ALL_ZERO,
+};
+
 /*
  * cmdset_hp is used for the 34401A, which was added to this code after the
  * 34405A and 34465A. It differs in starting the measurement with INIT: using
@@ -232,7 +256,7 @@ SR_PRIV const struct scpi_dmm_model models[] = {
 	},
 	{
 		"Agilent", "34460A",
-		1, 6, cmdset_agilent, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_keysight, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
 		ARRAY_AND_SIZE(devopts_generic_range),
 		0, 0, 10 * 1000, 0, FALSE,
@@ -281,7 +305,7 @@ SR_PRIV const struct scpi_dmm_model models[] = {
 	},
 	{
 		"Keysight", "34465A",
-		1, 6, cmdset_agilent, ARRAY_AND_SIZE(mqopts_agilent_34405a),
+		1, 6, cmdset_keysight, ARRAY_AND_SIZE(mqopts_agilent_34405a),
 		scpi_dmm_get_meas_agilent,
 		ARRAY_AND_SIZE(devopts_generic_range),
 		0, 0, 10 * 1000, 0, FALSE,
@@ -627,12 +651,18 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		}
 	}
 
+	ret = scpi_dmm_buffered_start(sdi);
+	if (ret != SR_OK)
+		return ret;
+
 	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_START_ACQ);
 	if (command && *command) {
 		scpi_dmm_cmd_delay(scpi);
 		ret = sr_scpi_send(scpi, command);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			scpi_dmm_buffered_stop(sdi);
 			return ret;
+		}
 	}
 
 	do_mq_meas_delay = item->drv_flags & FLAG_MEAS_DELAY;
@@ -667,6 +697,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		(void)sr_scpi_send(scpi, command);
 	}
 	sr_scpi_source_remove(sdi->session, scpi);
+	scpi_dmm_buffered_stop(sdi);
 
 	std_session_send_df_end(sdi);
 
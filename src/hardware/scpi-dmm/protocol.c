@@ -269,50 +269,18 @@ SR_PRIV GVariant *scpi_dmm_get_range_text_list(const struct sr_dev_inst *sdi)
 	return list;
 }
 
-SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
+/*
+ * Get the precision exponent of an Agilent style response to the query
+ * for the meter's function.
+ */
+static int agilent_prec_exp(char *mode_response,
+	const struct mqopt_item *item, int *prec_exp)
 {
-	struct sr_scpi_dev_inst *scpi;
-	struct dev_context *devc;
-	struct scpi_dmm_acq_info *info;
-	struct sr_datafeed_analog *analog;
-	int ret;
-	enum sr_mq mq;
-	enum sr_mqflag mqflag;
-	char *mode_response;
 	const char *p;
 	char **fields;
 	size_t count;
 	char prec_text[20];
-	const struct mqopt_item *item;
-	int prec_exp;
-	const char *command;
-	char *response;
-	gboolean use_double;
-	int sig_digits, val_exp;
-	int digits;
-	enum sr_unit unit;
-	double limit;
-
-	scpi = sdi->conn;
-	devc = sdi->priv;
-	info = &devc->run_acq_info;
-	analog = &info->analog[ch];
-
-	/*
-	 * Get the meter's current mode, keep the response around.
-	 * Skip the measurement if the mode is uncertain.
-	 */
-	ret = scpi_dmm_get_mq(sdi, &mq, &mqflag, &mode_response, &item);
-	if (ret != SR_OK) {
-		g_free(mode_response);
-		return ret;
-	}
-	if (!mode_response)
-		return SR_ERR;
-	if (!mq) {
-		g_free(mode_response);
-		return +1;
-	}
+	int ret;
 
 	/*
 	 * Get the last comma separated field of the function query
@@ -358,11 +326,82 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 		p++;
 	ret = SR_OK;
 	if (!p || !*p)
-		prec_exp = 0;
+		*prec_exp = 0;
 	else if (*p != 'e' && *p != 'E')
 		ret = SR_ERR_DATA;
 	else
-		ret = sr_atoi(++p, &prec_exp);
+		ret = sr_atoi(++p, prec_exp);
+
+	return ret;
+}
+
+/* Get the unit of a measured quantity, 0 when unknown. */
+static enum sr_unit mq_unit(enum sr_mq mq)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		return SR_UNIT_VOLT;
+	case SR_MQ_CURRENT:
+		return SR_UNIT_AMPERE;
+	case SR_MQ_RESISTANCE:
+	case SR_MQ_CONTINUITY:
+		return SR_UNIT_OHM;
+	case SR_MQ_CAPACITANCE:
+		return SR_UNIT_FARAD;
+	case SR_MQ_TEMPERATURE:
+		return SR_UNIT_CELSIUS;
+	case SR_MQ_FREQUENCY:
+		return SR_UNIT_HERTZ;
+	case SR_MQ_TIME:
+		return SR_UNIT_SECOND;
+	default:
+		return 0;
+	}
+}
+
+SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_acq_info *info;
+	struct sr_datafeed_analog *analog;
+	int ret;
+	enum sr_mq mq;
+	enum sr_mqflag mqflag;
+	char *mode_response;
+	const char *p;
+	const struct mqopt_item *item;
+	int prec_exp;
+	const char *command;
+	char *response;
+	gboolean use_double;
+	int sig_digits, val_exp;
+	int digits;
+	enum sr_unit unit;
+	double limit;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	info = &devc->run_acq_info;
+	analog = &info->analog[ch];
+
+	/*
+	 * Get the meter's current mode, keep the response around.
+	 * Skip the measurement if the mode is uncertain.
+	 */
+	ret = scpi_dmm_get_mq(sdi, &mq, &mqflag, &mode_response, &item);
+	if (ret != SR_OK) {
+		g_free(mode_response);
+		return ret;
+	}
+	if (!mode_response)
+		return SR_ERR;
+	if (!mq) {
+		g_free(mode_response);
+		return +1;
+	}
+
+	ret = agilent_prec_exp(mode_response, item, &prec_exp);
 	g_free(mode_response);
 	if (ret != SR_OK)
 		return ret;
@@ -483,32 +522,9 @@ SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch)
 	analog->encoding->digits = digits;
 	analog->meaning->mq = mq;
 	analog->meaning->mqflags = mqflag;
-	switch (mq) {
-	case SR_MQ_VOLTAGE:
-		unit = SR_UNIT_VOLT;
-		break;
-	case SR_MQ_CURRENT:
-		unit = SR_UNIT_AMPERE;
-		break;
-	case SR_MQ_RESISTANCE:
-	case SR_MQ_CONTINUITY:
-		unit = SR_UNIT_OHM;
-		break;
-	case SR_MQ_CAPACITANCE:
-		unit = SR_UNIT_FARAD;
-		break;
-	case SR_MQ_TEMPERATURE:
-		unit = SR_UNIT_CELSIUS;
-		break;
-	case SR_MQ_FREQUENCY:
-		unit = SR_UNIT_HERTZ;
-		break;
-	case SR_MQ_TIME:
-		unit = SR_UNIT_SECOND;
-		break;
-	default:
+	unit = mq_unit(mq);
+	if (!unit)
 		return SR_ERR_NA;
-	}
 	analog->meaning->unit = unit;
 	analog->spec->spec_digits = digits;
 
@@ -717,6 +733,184 @@ SR_PRIV int scpi_dmm_get_meas_gwinstek(const struct sr_dev_inst *sdi, size_t ch)
 	return SR_OK;
 }
 
+/*
+ * Setup buffered acquisition: the meter keeps taking readings into its
+ * memory, the driver fetches all readings which have accumulated since
+ * its last poll in one transfer. This is for models which have commands
+ * for it, other models get polled for one reading at a time.
+ */
+SR_PRIV int scpi_dmm_buffered_start(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_buffered_acq *acq;
+	const struct mqopt_item *item;
+	const char *command;
+	char *mode_response;
+	int prec_exp;
+	int ret;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	acq = &devc->buffered_acq;
+
+	acq->active = FALSE;
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_QUERY_BUFFERED);
+	if (!command || !*command)
+		return SR_OK;
+
+	/* The meter's function won't change during the acquisition. */
+	ret = scpi_dmm_get_mq(sdi, &acq->mq, &acq->mqflag,
+		&mode_response, &item);
+	if (ret == SR_OK && !mode_response)
+		ret = SR_ERR;
+	if (ret == SR_OK)
+		ret = agilent_prec_exp(mode_response, item, &prec_exp);
+	g_free(mode_response);
+	if (ret != SR_OK)
+		return ret;
+	acq->digits = -prec_exp;
+	acq->unit = mq_unit(acq->mq);
+	if (!acq->unit)
+		return SR_ERR_NA;
+
+	scpi_dmm_cmd_delay(scpi);
+	ret = sr_scpi_cmd(sdi, devc->cmdset, 0, NULL, DMM_CMD_SETUP_BUFFERED);
+	if (ret != SR_OK)
+		return ret;
+
+	/* Binary transfer when supported, comma separated text else. */
+	acq->binary = FALSE;
+	command = sr_scpi_cmd_get(devc->cmdset, DMM_CMD_SETUP_BINARY);
+	if (command && *command) {
+		scpi_dmm_cmd_delay(scpi);
+		acq->binary = sr_scpi_send(scpi, command) == SR_OK;
+	}
+
+	acq->raw = g_malloc(SCPI_DMM_BUFFERED_READINGS
+		* SCPI_DMM_BUFFERED_TEXT_SIZE + 1);
+	acq->values = g_malloc(SCPI_DMM_BUFFERED_READINGS
+		* sizeof(acq->values[0]));
+	acq->active = TRUE;
+	sr_dbg("Buffered acquisition, %s transfer.",
+		acq->binary ? "binary" : "text");
+
+	return SR_OK;
+}
+
+/* Have the meter stop taking readings, restore its setup. */
+SR_PRIV void scpi_dmm_buffered_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct scpi_dmm_buffered_acq *acq;
+
+	devc = sdi->priv;
+	acq = &devc->buffered_acq;
+
+	if (!acq->active)
+		return;
+	acq->active = FALSE;
+	scpi_dmm_cmd_delay(sdi->conn);
+	(void)sr_scpi_cmd(sdi, devc->cmdset, 0, NULL, DMM_CMD_STOP_BUFFERED);
+
+	g_free(acq->raw);
+	acq->raw = NULL;
+	g_free(acq->values);
+	acq->values = NULL;
+}
+
+/*
+ * Fetch the readings which the meter has taken since the last poll, and
+ * send them in one packet. No *OPC? here, the meter never completes its
+ * (endless) measurement.
+ */
+static int scpi_dmm_fetch_buffered(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	struct scpi_dmm_buffered_acq *acq;
+	struct sr_channel *channel;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const uint8_t *rdptr;
+	char *command, **fields;
+	size_t length, count, idx;
+	double limit;
+	int ret;
+
+	scpi = sdi->conn;
+	devc = sdi->priv;
+	acq = &devc->buffered_acq;
+
+	command = g_strdup_printf(sr_scpi_cmd_get(devc->cmdset,
+		DMM_CMD_QUERY_BUFFERED), SCPI_DMM_BUFFERED_READINGS);
+	ret = sr_scpi_get_block_into(scpi, command, acq->raw,
+		SCPI_DMM_BUFFERED_READINGS * SCPI_DMM_BUFFERED_TEXT_SIZE,
+		&length);
+	g_free(command);
+	if (ret != SR_OK)
+		return ret;
+
+	count = 0;
+	if (acq->binary) {
+		rdptr = acq->raw;
+		while (length >= sizeof(double)
+				&& count < SCPI_DMM_BUFFERED_READINGS) {
+			acq->values[count++] = read_dblbe_inc(&rdptr);
+			length -= sizeof(double);
+		}
+	} else if (length) {
+		acq->raw[length] = '\0';
+		fields = g_strsplit((const char *)acq->raw, ",", 0);
+		for (idx = 0; fields[idx]; idx++) {
+			if (count == SCPI_DMM_BUFFERED_READINGS)
+				break;
+			g_strstrip(fields[idx]);
+			if (!*fields[idx])
+				continue;
+			ret = sr_atod_ascii(fields[idx], &acq->values[count]);
+			if (ret != SR_OK)
+				break;
+			count++;
+		}
+		g_strfreev(fields);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	/* Overload readings are 9.9E37. */
+	limit = 9e37;
+	for (idx = 0; idx < count; idx++) {
+		if (acq->values[idx] > +limit)
+			acq->values[idx] = +INFINITY;
+		else if (acq->values[idx] < -limit)
+			acq->values[idx] = -INFINITY;
+	}
+
+	count = sr_sw_limits_accept_samples(&devc->limits, count);
+	channel = g_slist_nth_data(sdi->channels, 0);
+	if (!count || !channel->enabled)
+		return SR_OK;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, acq->digits);
+	encoding.unitsize = sizeof(acq->values[0]);
+	meaning.mq = acq->mq;
+	meaning.mqflags = acq->mqflag;
+	meaning.unit = acq->unit;
+	meaning.channels = g_slist_append(NULL, channel);
+	analog.num_samples = count;
+	analog.data = acq->values;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(meaning.channels);
+
+	return SR_OK;
+}
+
 /* Strictly speaking this is a timer controlled poll routine. */
 SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 {
@@ -741,6 +935,13 @@ SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	info = &devc->run_acq_info;
 
+	if (devc->buffered_acq.active) {
+		ret = scpi_dmm_fetch_buffered(sdi);
+		if (ret != SR_OK || sr_sw_limits_check(&devc->limits))
+			sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+
 	sent_sample = FALSE;
 	ret = SR_OK;
 	for (ch = 0; ch < devc->num_channels; ch++) {
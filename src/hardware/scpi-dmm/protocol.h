@@ -32,6 +32,10 @@
 
 #define SCPI_DMM_MAX_CHANNELS	1
 
+/* Readings per fetch from the meter's memory, and their text size. */
+#define SCPI_DMM_BUFFERED_READINGS	1000
+#define SCPI_DMM_BUFFERED_TEXT_SIZE	24
+
 enum scpi_dmm_cmdcode {
 	DMM_CMD_SETUP_REMOTE,
 	DMM_CMD_SETUP_FUNC,
@@ -45,6 +49,10 @@ enum scpi_dmm_cmdcode {
 	DMM_CMD_QUERY_RANGE,
 	DMM_CMD_SETUP_RANGE_AUTO,
 	DMM_CMD_SETUP_RANGE,
+	DMM_CMD_SETUP_BUFFERED,
+	DMM_CMD_SETUP_BINARY,
+	DMM_CMD_QUERY_BUFFERED,
+	DMM_CMD_STOP_BUFFERED,
 };
 
 struct mqopt_item {
@@ -101,6 +109,16 @@ struct dev_context {
 		struct sr_analog_meaning meaning[SCPI_DMM_MAX_CHANNELS];
 		struct sr_analog_spec spec[SCPI_DMM_MAX_CHANNELS];
 	} run_acq_info;
+	struct scpi_dmm_buffered_acq {
+		gboolean active;
+		gboolean binary;
+		enum sr_mq mq;
+		enum sr_mqflag mqflag;
+		enum sr_unit unit;
+		int digits;
+		uint8_t *raw;
+		double *values;
+	} buffered_acq;
 	gchar *precision;
 	char range_text[32];
 };
@@ -121,6 +139,8 @@ SR_PRIV int scpi_dmm_set_range_from_text(const struct sr_dev_inst *sdi,
 SR_PRIV GVariant *scpi_dmm_get_range_text_list(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_dmm_get_meas_agilent(const struct sr_dev_inst *sdi, size_t ch);
 SR_PRIV int scpi_dmm_get_meas_gwinstek(const struct sr_dev_inst *sdi, size_t ch);
+SR_PRIV int scpi_dmm_buffered_start(const struct sr_dev_inst *sdi);
+SR_PRIV void scpi_dmm_buffered_stop(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_dmm_receive_data(int fd, int revents, void *cb_data);
 
 #endif
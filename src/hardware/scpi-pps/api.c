@@ -464,6 +464,9 @@ static int config_get(uint32_t key, GVariant **data,
 		gvtype = G_VARIANT_TYPE_STRING;
 		cmd = SCPI_CMD_GET_OUTPUT_REGULATION;
 		break;
+	case SR_CONF_SAMPLE_INTERVAL:
+		*data = g_variant_new_uint64(devc->poll_interval_ms);
+		return SR_OK;
 	default:
 		return sr_sw_limits_config_get(&devc->limits, key, data);
 	}
@@ -746,6 +749,10 @@ static int config_set(uint32_t key, GVariant *data,
 					channel_group_cmd, channel_group_name,
 					SCPI_CMD_SET_OVER_TEMPERATURE_PROTECTION_DISABLE);
 		break;
+	case SR_CONF_SAMPLE_INTERVAL:
+		devc->poll_interval_ms = g_variant_get_uint64(data);
+		ret = SR_OK;
+		break;
 	default:
 		ret = sr_sw_limits_config_set(&devc->limits, key, data);
 	}
@@ -854,6 +861,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Prime the pipe with the first channel. */
 	devc->cur_acquisition_channel = sr_next_enabled_channel(sdi, NULL);
+	devc->poll_backoff_ms = 0;
+	devc->poll_cycle_start = g_get_monotonic_time();
+	devc->poll_next = 0;
+	devc->meas_all_valid = FALSE;
 
 	/* Device specific initialization before acquisition starts. */
 	if (devc->device->init_acquisition)
@@ -36,6 +36,7 @@ static const uint32_t agilent_n5700a_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t agilent_n5700a_devopts_cg[] = {
@@ -92,6 +93,7 @@ static const uint32_t bk_9130_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t bk_9130_devopts_cg[] = {
@@ -139,6 +141,7 @@ static const uint32_t chroma_61604_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t chroma_61604_devopts_cg[] = {
@@ -187,6 +190,7 @@ static const uint32_t chroma_62000_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t chroma_62000_devopts_cg[] = {
@@ -280,6 +284,7 @@ static const uint32_t eez_psu_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t eez_psu_devopts_cg[] = {
@@ -324,6 +329,12 @@ static const struct scpi_command eez_psu_cmd[] = {
  */
 static const char *eez_psu_channel_names[] = { "1", "2", "3", "4", "5", "6", };
 
+/* The channel info queries depend on the selected channel, not cached. */
+static const char *const eez_psu_static_queries[] = {
+	":SYST:CHAN:COUN?",
+	NULL,
+};
+
 static int eez_psu_probe_channels(struct sr_dev_inst *sdi,
 		struct sr_scpi_hw_info *hw_info,
 		struct channel_spec **channels, unsigned int *num_channels,
@@ -355,6 +366,7 @@ static int eez_psu_probe_channels(struct sr_dev_inst *sdi,
 	 */
 
 	scpi = sdi->conn;
+	sr_scpi_cache_commands(scpi, eez_psu_static_queries);
 	ret = sr_scpi_get_int(scpi, ":SYST:CHAN:COUN?", &intval);
 	if (ret != SR_OK) {
 		sr_err("Failed to probe EEZ PSU channel count.");
@@ -451,6 +463,7 @@ static const uint32_t rigol_dp700_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t rigol_dp700_devopts_cg[] = {
@@ -520,6 +533,7 @@ static const uint32_t rigol_dp800_devopts[] = {
 	SR_CONF_OVER_TEMPERATURE_PROTECTION | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t rigol_dp800_devopts_cg[] = {
@@ -575,6 +589,7 @@ static const struct scpi_command rigol_dp800_cmd[] = {
 	{ SCPI_CMD_GET_MEAS_VOLTAGE, ":MEAS:VOLT?" },
 	{ SCPI_CMD_GET_MEAS_CURRENT, ":MEAS:CURR?" },
 	{ SCPI_CMD_GET_MEAS_POWER, ":MEAS:POWE?" },
+	{ SCPI_CMD_GET_MEAS_ALL, ":MEAS:ALL?" },
 	{ SCPI_CMD_GET_VOLTAGE_TARGET, ":SOUR:VOLT?" },
 	{ SCPI_CMD_SET_VOLTAGE_TARGET, ":SOUR:VOLT %.6f" },
 	{ SCPI_CMD_GET_CURRENT_LIMIT, ":SOUR:CURR?" },
@@ -606,6 +621,7 @@ static const uint32_t hp_6630a_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t hp_6630a_devopts_cg[] = {
@@ -748,6 +764,7 @@ static const uint32_t hp_6630b_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t hp_6630b_devopts_cg[] = {
@@ -1015,6 +1032,7 @@ static const uint32_t keysight_e36300a_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t keysight_e36300a_devopts_cg[] = {
@@ -1095,7 +1113,8 @@ static const struct scpi_command keysight_e36300a_cmd[] = {
 static const uint32_t owon_p4000_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
-	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t owon_p4000_devopts_cg[] = {
@@ -1169,6 +1188,7 @@ static const uint32_t philips_pm2800_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t philips_pm2800_devopts_cg[] = {
@@ -1320,6 +1340,7 @@ static const uint32_t rs_hmc8043_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t rs_hmc8043_devopts_cg[] = {
@@ -1378,6 +1399,7 @@ static const uint32_t rs_nge100b_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t rs_nge100b_devopts_cg[] = {
@@ -1436,6 +1458,7 @@ static const uint32_t rs_hmp4040_devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SAMPLE_INTERVAL | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t rs_hmp4040_devopts_cg[] = {
@@ -25,6 +25,98 @@
 #include "scpi.h"
 #include "protocol.h"
 
+/*
+ * Use the combined query for voltage, current, and power of an output
+ * when the device supports it. The response is kept for the output's
+ * other channels in the current poll cycle.
+ */
+static int get_meas_all(const struct sr_dev_inst *sdi,
+	const struct pps_channel *pch, int channel_group_cmd,
+	const char *channel_group_name, double *value)
+{
+	struct dev_context *devc;
+	GVariant *gvdata;
+	char **tokens;
+	size_t idx;
+	int ret;
+
+	devc = sdi->priv;
+
+	if (pch->mq == SR_MQ_VOLTAGE)
+		idx = 0;
+	else if (pch->mq == SR_MQ_CURRENT)
+		idx = 1;
+	else
+		idx = 2;
+
+	if (devc->meas_all_valid && devc->meas_all_output == pch->hw_output_idx) {
+		*value = devc->meas_all[idx];
+		return SR_OK;
+	}
+
+	ret = sr_scpi_cmd_resp(sdi, devc->device->commands,
+		channel_group_cmd, channel_group_name, &gvdata,
+		G_VARIANT_TYPE_STRING, SCPI_CMD_GET_MEAS_ALL);
+	if (ret != SR_OK)
+		return ret;
+
+	tokens = g_strsplit(g_variant_get_string(gvdata, NULL), ",", 0);
+	g_variant_unref(gvdata);
+	ret = SR_OK;
+	if (g_strv_length(tokens) < ARRAY_SIZE(devc->meas_all))
+		ret = SR_ERR_DATA;
+	for (idx = 0; ret == SR_OK && idx < ARRAY_SIZE(devc->meas_all); idx++)
+		ret = sr_atod_ascii(tokens[idx], &devc->meas_all[idx]);
+	g_strfreev(tokens);
+	if (ret != SR_OK) {
+		sr_err("Unexpected combined measurement response.");
+		return SR_ERR_DATA;
+	}
+	devc->meas_all_output = pch->hw_output_idx;
+	devc->meas_all_valid = TRUE;
+
+	return get_meas_all(sdi, pch, channel_group_cmd,
+		channel_group_name, value);
+}
+
+static int get_measurement(const struct sr_dev_inst *sdi,
+	const struct pps_channel *pch, int channel_group_cmd,
+	const char *channel_group_name, double *value)
+{
+	struct dev_context *devc;
+	GVariant *gvdata;
+	int cmd, ret;
+
+	devc = sdi->priv;
+
+	if (pch->mq == SR_MQ_VOLTAGE) {
+		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
+	} else if (pch->mq == SR_MQ_FREQUENCY) {
+		cmd = SCPI_CMD_GET_MEAS_FREQUENCY;
+	} else if (pch->mq == SR_MQ_CURRENT) {
+		cmd = SCPI_CMD_GET_MEAS_CURRENT;
+	} else if (pch->mq == SR_MQ_POWER) {
+		cmd = SCPI_CMD_GET_MEAS_POWER;
+	} else {
+		return SR_ERR;
+	}
+
+	if (cmd != SCPI_CMD_GET_MEAS_FREQUENCY &&
+			sr_scpi_cmd_get(devc->device->commands, SCPI_CMD_GET_MEAS_ALL))
+		return get_meas_all(sdi, pch, channel_group_cmd,
+			channel_group_name, value);
+
+	ret = sr_scpi_cmd_resp(sdi, devc->device->commands,
+		channel_group_cmd, channel_group_name, &gvdata,
+		G_VARIANT_TYPE_DOUBLE, cmd);
+	if (ret != SR_OK)
+		return ret;
+	*value = g_variant_get_double(gvdata);
+	g_variant_unref(gvdata);
+
+	return SR_OK;
+}
+
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -35,15 +127,15 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct sr_dev_inst *sdi;
+	struct sr_scpi_dev_inst *scpi;
 	int channel_group_cmd;
 	const char *channel_group_name;
 	struct pps_channel *pch;
 	const struct channel_spec *ch_spec;
 	int ret;
 	float f;
-	GVariant *gvdata;
-	const GVariantType *gvtype;
-	int cmd;
+	double d;
+	int64_t timestamp;
 
 	(void)fd;
 	(void)revents;
@@ -57,6 +149,14 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	if (!(device = devc->device))
 		return TRUE;
 
+	/* Wait for the next poll cycle. */
+	if (devc->poll_next && g_get_monotonic_time() < devc->poll_next) {
+		if (sr_sw_limits_check(&devc->limits))
+			sr_dev_acquisition_stop(sdi);
+		return TRUE;
+	}
+
+	scpi = sdi->conn;
 	pch = devc->cur_acquisition_channel->priv;
 
 	channel_group_cmd = 0;
@@ -70,33 +170,32 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	 * When the current channel is the first in the array, perform the device
 	 * specific status update first.
 	 */
-	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL) &&
-		device->update_status) {
-		device->update_status(sdi);
+	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL)) {
+		devc->poll_cycle_start = g_get_monotonic_time();
+		devc->meas_all_valid = FALSE;
+		if (device->update_status)
+			device->update_status(sdi);
 	}
 
-	if (pch->mq == SR_MQ_VOLTAGE) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
-	} else if (pch->mq == SR_MQ_FREQUENCY) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_FREQUENCY;
-	} else if (pch->mq == SR_MQ_CURRENT) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
-	} else if (pch->mq == SR_MQ_POWER) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_POWER;
-	} else {
-		return SR_ERR;
+	ret = get_measurement(sdi, pch, channel_group_cmd,
+		channel_group_name, &d);
+	if (ret != SR_OK) {
+		/*
+		 * Don't flood a busy device with queries. Retry the channel
+		 * after an increasing delay.
+		 */
+		if (!devc->poll_backoff_ms)
+			devc->poll_backoff_ms = POLL_BACKOFF_MIN_MS;
+		else
+			devc->poll_backoff_ms = MIN(2 * devc->poll_backoff_ms,
+				POLL_BACKOFF_MAX_MS);
+		sr_dbg("Measurement failed, retry in %" PRIu64 "ms.",
+			devc->poll_backoff_ms);
+		devc->poll_next = g_get_monotonic_time();
+		devc->poll_next += devc->poll_backoff_ms * 1000;
+		return TRUE;
 	}
 
-	ret = sr_scpi_cmd_resp(sdi, devc->device->commands,
-		channel_group_cmd, channel_group_name, &gvdata, gvtype, cmd);
-
-	if (ret != SR_OK)
-		return ret;
-
 	if (devc->channels) {
 		/* Dynamically-probed devices. */
 		ch_spec = &devc->channels[pch->hw_output_idx];
@@ -110,6 +209,7 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
 	analog.meaning->channels = g_slist_append(NULL, devc->cur_acquisition_channel);
 	analog.num_samples = 1;
+	analog.timestamps = &timestamp;
 	analog.meaning->mq = pch->mq;
 	analog.meaning->mqflags = pch->mqflags;
 	if (pch->mq == SR_MQ_VOLTAGE) {
@@ -129,8 +229,8 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 		analog.encoding->digits = ch_spec->frequency[4];
 		analog.spec->spec_digits = ch_spec->frequency[3];
 	}
-	f = (float)g_variant_get_double(gvdata);
-	g_variant_unref(gvdata);
+	f = (float)d;
+	timestamp = scpi->rx_time;
 	analog.data = &f;
 	sr_session_send(sdi, &packet);
 	g_slist_free(analog.meaning->channels);
@@ -141,10 +241,19 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 			sr_next_enabled_channel(sdi, devc->cur_acquisition_channel);
 	}
 
-	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL))
+	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL)) {
 		/* First enabled channel, so each channel has been sampled */
 		sr_sw_limits_update_samples_read(&devc->limits, 1);
 
+		/* Schedule the next poll cycle, recover from failures. */
+		devc->poll_backoff_ms /= 2;
+		if (devc->poll_backoff_ms < POLL_BACKOFF_MIN_MS)
+			devc->poll_backoff_ms = 0;
+		devc->poll_next = devc->poll_cycle_start;
+		devc->poll_next += devc->poll_interval_ms * 1000;
+		devc->poll_next += devc->poll_backoff_ms * 1000;
+	}
+
 	/* Stop if limits have been hit. */
 	if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
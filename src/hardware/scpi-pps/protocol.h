@@ -29,6 +29,10 @@
 
 #define LOG_PREFIX "scpi-pps"
 
+/* Range of the additional delay after failed measurement queries. */
+#define POLL_BACKOFF_MIN_MS	10
+#define POLL_BACKOFF_MAX_MS	1000
+
 enum pps_scpi_cmds {
 	SCPI_CMD_REMOTE = 1,
 	SCPI_CMD_LOCAL,
@@ -40,6 +44,7 @@ enum pps_scpi_cmds {
 	SCPI_CMD_GET_MEAS_CURRENT,
 	SCPI_CMD_GET_MEAS_POWER,
 	SCPI_CMD_GET_MEAS_FREQUENCY,
+	SCPI_CMD_GET_MEAS_ALL,
 	SCPI_CMD_GET_VOLTAGE_TARGET,
 	SCPI_CMD_SET_VOLTAGE_TARGET,
 	SCPI_CMD_GET_FREQUENCY_TARGET,
@@ -168,6 +173,18 @@ struct dev_context {
 
 	struct sr_channel *cur_acquisition_channel;
 	struct sr_sw_limits limits;
+
+	/* Poll cycle interval, and additional delay after failures [ms]. */
+	uint64_t poll_interval_ms;
+	uint64_t poll_backoff_ms;
+	/* Monotonic time [us] when the next poll cycle starts. */
+	int64_t poll_cycle_start;
+	int64_t poll_next;
+
+	/* Response of the combined measurement query for one output. */
+	gboolean meas_all_valid;
+	unsigned int meas_all_output;
+	double meas_all[3];
 };
 
 SR_PRIV extern unsigned int num_pps_profiles;
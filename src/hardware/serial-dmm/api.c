@@ -42,6 +42,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_CONTINUOUS,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BATCH_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_BATCH_MSEC | SR_CONF_GET | SR_CONF_SET,
 };
 
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
@@ -200,6 +202,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_LIMIT_FRAMES:
 	case SR_CONF_LIMIT_MSEC:
 		return sr_sw_limits_config_get(&devc->limits, key, data);
+	case SR_CONF_BATCH_SAMPLES:
+		*data = g_variant_new_uint64(devc->batch_samples);
+		return SR_OK;
+	case SR_CONF_BATCH_MSEC:
+		*data = g_variant_new_uint64(devc->batch_msec);
+		return SR_OK;
 	default:
 		dmm = (struct dmm_info *)sdi->driver;
 		if (!dmm || !dmm->config_get)
@@ -225,6 +233,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_LIMIT_FRAMES:
 	case SR_CONF_LIMIT_MSEC:
 		return sr_sw_limits_config_set(&devc->limits, key, data);
+	case SR_CONF_BATCH_SAMPLES:
+		devc->batch_samples = g_variant_get_uint64(data);
+		return SR_OK;
+	case SR_CONF_BATCH_MSEC:
+		devc->batch_msec = g_variant_get_uint64(data);
+		return SR_OK;
 	default:
 		dmm = (struct dmm_info *)sdi->driver;
 		if (!dmm || !dmm->config_set)
@@ -269,6 +283,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	sr_sw_limits_acquisition_start(&devc->limits);
+	sync_hint_setup(sdi);
+	ret = batch_setup(sdi);
+	if (ret != SR_OK)
+		return ret;
 	std_session_send_df_header(sdi);
 
 	cb_func = receive_data;
@@ -288,6 +306,13 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+static int dev_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	batch_free(sdi);
+
+	return std_serial_dev_acquisition_stop(sdi);
+}
+
 #define DMM_ENTRY(ID, CHIPSET, VENDOR, MODEL, \
 		CONN, SERIALCOMM, PACKETSIZE, TIMEOUT, DELAY, \
 		OPEN, REQUEST, VALID, PARSE, DETAILS, \
@@ -309,7 +334,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			.dev_open = std_serial_dev_open, \
 			.dev_close = std_serial_dev_close, \
 			.dev_acquisition_start = dev_acquisition_start, \
-			.dev_acquisition_stop = std_serial_dev_acquisition_stop, \
+			.dev_acquisition_stop = dev_acquisition_stop, \
 			.context = NULL, \
 		}, \
 		VENDOR, MODEL, CONN, SERIALCOMM, PACKETSIZE, TIMEOUT, DELAY, \
@@ -39,6 +39,121 @@ static void log_dmm_packet(const uint8_t *buf, size_t len)
 	sr_hexdump_free(text);
 }
 
+/**
+ * Allocate per channel queues when readings get batched. Parsers which
+ * return double values have their queues keep doubles.
+ */
+SR_PRIV int batch_setup(const struct sr_dev_inst *sdi)
+{
+	struct dmm_info *dmm;
+	struct dev_context *devc;
+	struct feed_queue_analog *q;
+	struct sr_channel *channel;
+	size_t ch_idx;
+	int ret;
+
+	dmm = (struct dmm_info *)sdi->driver;
+	devc = sdi->priv;
+
+	devc->batch_flush_at = 0;
+	if (devc->batch_samples <= 1)
+		return SR_OK;
+
+	devc->batch_queues = g_malloc0(dmm->channel_count *
+		sizeof(devc->batch_queues[0]));
+	for (ch_idx = 0; ch_idx < dmm->channel_count; ch_idx++) {
+		channel = g_slist_nth_data(sdi->channels, ch_idx);
+		q = feed_queue_analog_alloc(sdi, devc->batch_samples, 0, channel);
+		if (!q) {
+			batch_free(sdi);
+			return SR_ERR_MALLOC;
+		}
+		devc->batch_queues[ch_idx] = q;
+		if (!dmm->packet_parse_len)
+			continue;
+		ret = feed_queue_analog_native(q, sizeof(double), TRUE, TRUE);
+		if (ret != SR_OK) {
+			batch_free(sdi);
+			return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/** Send the readings which were collected so far. */
+SR_PRIV int batch_flush(const struct sr_dev_inst *sdi)
+{
+	struct dmm_info *dmm;
+	struct dev_context *devc;
+	size_t ch_idx;
+	int ret;
+
+	dmm = (struct dmm_info *)sdi->driver;
+	devc = sdi->priv;
+
+	devc->batch_flush_at = 0;
+	if (!devc->batch_queues)
+		return SR_OK;
+
+	for (ch_idx = 0; ch_idx < dmm->channel_count; ch_idx++) {
+		ret = feed_queue_analog_flush(devc->batch_queues[ch_idx]);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/** Send pending readings, and release the per channel queues. */
+SR_PRIV void batch_free(const struct sr_dev_inst *sdi)
+{
+	struct dmm_info *dmm;
+	struct dev_context *devc;
+	size_t ch_idx;
+
+	dmm = (struct dmm_info *)sdi->driver;
+	devc = sdi->priv;
+
+	if (!devc->batch_queues)
+		return;
+
+	for (ch_idx = 0; ch_idx < dmm->channel_count; ch_idx++) {
+		if (!devc->batch_queues[ch_idx])
+			continue;
+		feed_queue_analog_flush(devc->batch_queues[ch_idx]);
+		feed_queue_analog_free(devc->batch_queues[ch_idx]);
+	}
+	g_free(devc->batch_queues);
+	devc->batch_queues = NULL;
+}
+
+/*
+ * Queue a reading for later submission. Changes in the quantity, unit,
+ * or resolution send the readings which were collected before.
+ */
+static void batch_submit(struct sr_dev_inst *sdi, size_t ch_idx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct dev_context *devc;
+	struct feed_queue_analog *q;
+
+	devc = sdi->priv;
+	q = devc->batch_queues[ch_idx];
+
+	feed_queue_analog_mq_unit(q, analog->meaning->mq,
+		analog->meaning->mqflags, analog->meaning->unit);
+	feed_queue_analog_digits(q, analog->encoding->digits,
+		analog->spec->spec_digits);
+	feed_queue_analog_timestamp(q, analog->timestamps[0]);
+	feed_queue_analog_submit_native(q, analog->data, 1);
+
+	if (devc->batch_msec && !devc->batch_flush_at) {
+		devc->batch_flush_at = g_get_monotonic_time();
+		devc->batch_flush_at += devc->batch_msec * 1000;
+	}
+}
+
 static void handle_packet(struct sr_dev_inst *sdi,
 	const uint8_t *buf, size_t len, void *info)
 {
@@ -54,11 +169,15 @@ static void handle_packet(struct sr_dev_inst *sdi,
 	gboolean sent_sample;
 	struct sr_channel *channel;
 	size_t ch_idx;
+	struct sr_serial_dev_inst *serial;
+	int64_t timestamp;
 
 	dmm = (struct dmm_info *)sdi->driver;
 
 	log_dmm_packet(buf, len);
 	devc = sdi->priv;
+	serial = sdi->conn;
+	timestamp = serial->rx_time;
 
 	sent_sample = FALSE;
 	memset(info, 0, dmm->info_size);
@@ -70,6 +189,7 @@ static void handle_packet(struct sr_dev_inst *sdi,
 		analog.meaning->channels = g_slist_append(NULL, channel);
 		analog.num_samples = 1;
 		analog.meaning->mq = 0;
+		analog.timestamps = &timestamp;
 
 		if (dmm->packet_parse) {
 			dmm->packet_parse(buf, &floatval, &analog, info);
@@ -88,9 +208,13 @@ static void handle_packet(struct sr_dev_inst *sdi,
 
 		if (analog.meaning->mq != 0 && channel->enabled) {
 			/* Got a measurement. */
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			sr_session_send(sdi, &packet);
+			if (devc->batch_queues) {
+				batch_submit(sdi, ch_idx, &analog);
+			} else {
+				packet.type = SR_DF_ANALOG;
+				packet.payload = &analog;
+				sr_session_send(sdi, &packet);
+			}
 			sent_sample = TRUE;
 		}
 	}
@@ -100,6 +224,60 @@ static void handle_packet(struct sr_dev_inst *sdi,
 	}
 }
 
+/*
+ * Protocols where every packet ends in a specific byte value. After a
+ * failed validity check, the next packet can only start right after
+ * that byte. Which avoids checking every single byte position while
+ * (re-)synchronizing to the stream of input data.
+ */
+static const struct packet_sync_hint {
+	gboolean (*packet_valid)(const uint8_t *buf);
+	uint8_t packet_end;
+} packet_sync_hints[] = {
+	{ sr_asycii_packet_valid, '\r', },
+	{ sr_digitech_qm1578_packet_valid, '\r', },
+	{ sr_es519xx_2400_11b_packet_valid, '\n', },
+	{ sr_es519xx_19200_11b_packet_valid, '\n', },
+	{ sr_es519xx_19200_14b_packet_valid, '\n', },
+	{ sr_fs9922_packet_valid, '\n', },
+	{ sr_m2110_packet_valid, '\n', },
+	{ sr_metex14_packet_valid, '\r', },
+	{ meterman_38xr_packet_valid, '\n', },
+	{ sr_ut71x_packet_valid, '\n', },
+	{ sr_vc870_packet_valid, '\n', },
+	{ sr_vc96_packet_valid, '\n', },
+};
+
+/** Lookup the re-synchronization hint for the device's protocol. */
+SR_PRIV void sync_hint_setup(const struct sr_dev_inst *sdi)
+{
+	struct dmm_info *dmm;
+	struct dev_context *devc;
+	size_t idx;
+
+	dmm = (struct dmm_info *)sdi->driver;
+	devc = sdi->priv;
+
+	devc->have_sync_byte = FALSE;
+	devc->sync_byte = 0;
+
+	/*
+	 * Polled devices may not have a terminated packet in front of
+	 * the response to a request. Only use the hint for devices which
+	 * continuously send their packets.
+	 */
+	if (!dmm->packet_valid || dmm->packet_request)
+		return;
+
+	for (idx = 0; idx < ARRAY_SIZE(packet_sync_hints); idx++) {
+		if (packet_sync_hints[idx].packet_valid != dmm->packet_valid)
+			continue;
+		devc->have_sync_byte = TRUE;
+		devc->sync_byte = packet_sync_hints[idx].packet_end;
+		return;
+	}
+}
+
 /** Request packet, if required. */
 SR_PRIV int req_packet(struct sr_dev_inst *sdi)
 {
@@ -145,7 +323,8 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	struct sr_serial_dev_inst *serial;
 	int ret;
 	size_t read_len, check_pos, check_len, pkt_size, copy_len;
-	uint8_t *check_ptr;
+	size_t skip_len, sync_len;
+	uint8_t *check_ptr, *sync_ptr;
 	uint64_t deadline;
 
 	dmm = (struct dmm_info *)sdi->driver;
@@ -169,38 +348,54 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	 * trying to synchronize to the stream of input data.
 	 */
 	check_pos = 0;
+	skip_len = 0;
 	while (check_pos < devc->buflen) {
 		/* Got the (minimum) amount of receive data for a packet? */
 		check_len = devc->buflen - check_pos;
 		if (check_len < dmm->packet_size)
 			break;
-		sr_dbg("Checking: pos %zu, len %zu.", check_pos, check_len);
 
 		/* Is it a valid packet? */
 		check_ptr = &devc->buf[check_pos];
 		if (dmm->packet_valid_len) {
 			ret = dmm->packet_valid_len(dmm->dmm_state,
 				check_ptr, check_len, &pkt_size);
-			if (ret == SR_PACKET_NEED_RX) {
-				sr_dbg("Need more RX data.");
+			if (ret == SR_PACKET_NEED_RX)
 				break;
-			}
 			if (ret == SR_PACKET_INVALID) {
-				sr_dbg("Not a valid packet, searching.");
 				check_pos++;
+				skip_len++;
 				continue;
 			}
 		} else if (dmm->packet_valid) {
 			if (!dmm->packet_valid(check_ptr)) {
-				sr_dbg("Not a valid packet, searching.");
-				check_pos++;
+				/*
+				 * Advance to the next candidate position.
+				 * Skip to the byte after the next packet end
+				 * when the protocol has one.
+				 */
+				sync_len = 1;
+				if (devc->have_sync_byte) {
+					sync_ptr = memchr(check_ptr,
+						devc->sync_byte, check_len);
+					if (sync_ptr)
+						sync_len = sync_ptr - check_ptr + 1;
+					else
+						sync_len = check_len;
+				}
+				check_pos += sync_len;
+				skip_len += sync_len;
 				continue;
 			}
 			pkt_size = dmm->packet_size;
 		}
 
 		/* Process the packet. */
-		sr_dbg("Valid packet, size %zu, processing", pkt_size);
+		if (skip_len) {
+			sr_dbg("Skipped %zu bytes to find a valid packet.",
+				skip_len);
+			skip_len = 0;
+		}
 		handle_packet(sdi, check_ptr, pkt_size, info);
 		check_pos += pkt_size;
 
@@ -262,6 +457,10 @@ int receive_data(int fd, int revents, void *cb_data)
 			return FALSE;
 	}
 
+	/* Send collected readings when the batch time limit was reached. */
+	if (devc->batch_flush_at && g_get_monotonic_time() >= devc->batch_flush_at)
+		batch_flush(sdi);
+
 	if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
 
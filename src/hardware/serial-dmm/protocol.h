@@ -88,13 +88,32 @@ struct dev_context {
 	uint8_t buf[DMM_BUFSIZE];
 	size_t buflen;
 
+	/**
+	 * Byte which terminates every packet, when the protocol has one.
+	 * Speeds up re-synchronization to the input stream.
+	 */
+	gboolean have_sync_byte;
+	uint8_t sync_byte;
+
 	/**
 	 * The timestamp [µs] to send the next request.
 	 * Used only if device needs polling.
 	 */
 	uint64_t req_next_at;
+
+	/** Readings per batch, and batch time limit [ms]. */
+	uint64_t batch_samples;
+	uint64_t batch_msec;
+	/** Per channel queues, when readings get batched. */
+	struct feed_queue_analog **batch_queues;
+	/** The timestamp [µs] when collected readings get sent. */
+	uint64_t batch_flush_at;
 };
 
+SR_PRIV void sync_hint_setup(const struct sr_dev_inst *sdi);
+SR_PRIV int batch_setup(const struct sr_dev_inst *sdi);
+SR_PRIV int batch_flush(const struct sr_dev_inst *sdi);
+SR_PRIV void batch_free(const struct sr_dev_inst *sdi);
 SR_PRIV int req_packet(struct sr_dev_inst *sdi);
 SR_PRIV int receive_data(int fd, int revents, void *cb_data);
 
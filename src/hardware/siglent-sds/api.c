@@ -157,6 +157,7 @@ static const uint64_t averages[] = {
 static const char *data_sources[] = {
 	"Display",
 	"History",
+	"Sequence",
 };
 
 enum vendor {
@@ -427,6 +428,8 @@ static int config_get(uint32_t key, GVariant **data,
 			*data = g_variant_new_string("Screen");
 		else if (devc->data_source == DATA_SOURCE_HISTORY)
 			*data = g_variant_new_string("History");
+		else if (devc->data_source == DATA_SOURCE_SEQUENCE)
+			*data = g_variant_new_string("Sequence");
 		break;
 	case SR_CONF_SAMPLERATE:
 		siglent_sds_get_dev_cfg_horizontal(sdi);
@@ -675,6 +678,9 @@ static int config_set(uint32_t key, GVariant *data,
 		else if (devc->model->series->protocol >= SPO_MODEL
 			&& !strcmp(tmp_str, "History"))
 			devc->data_source = DATA_SOURCE_HISTORY;
+		else if (devc->model->series->protocol != NON_SPO_MODEL
+			&& !strcmp(tmp_str, "Sequence"))
+			devc->data_source = DATA_SOURCE_SEQUENCE;
 		else {
 			sr_err("Unknown data source: '%s'.", tmp_str);
 			return SR_ERR;
@@ -766,7 +772,7 @@ static int config_list(uint32_t key, GVariant **data,
 		switch (devc->model->series->protocol) {
 		/* TODO: Check what must be done here for the data source buffer sizes. */
 		case NON_SPO_MODEL:
-			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 1);
+			*data = g_variant_new_strv(data_sources, ARRAY_SIZE(data_sources) - 2);
 			break;
 		case SPO_MODEL:
 		case ESERIES:
@@ -799,6 +805,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	devc->num_frames = 0;
+	devc->sequence_done = FALSE;
 	some_digital = FALSE;
 
 	/*
@@ -838,7 +845,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 					devc->enabled_channels, ch);
 			}
 			/* Enabled channel is currently disabled, or vice versa. */
-			if (siglent_sds_config_set(sdi, "D%d:TRA %s", ch->index,
+			if (siglent_sds_config_apply(sdi, "D%d:TRA %s", ch->index,
 				ch->enabled ? "ON" : "OFF") != SR_OK)
 				return SR_ERR;
 			devc->digital_channels[ch->index] = ch->enabled;
@@ -860,21 +867,21 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	siglent_sds_get_dev_cfg_horizontal(sdi);
 	switch (devc->model->series->protocol) {
 	case SPO_MODEL:
-		if (siglent_sds_config_set(sdi, "WFSU SP,0,TYPE,1") != SR_OK)
+		if (siglent_sds_config_apply(sdi, "WFSU SP,0,TYPE,1") != SR_OK)
 			return SR_ERR;
 		if (devc->average_enabled) {
-			if (siglent_sds_config_set(sdi, "ACQW AVERAGE,%i", devc->average_samples) != SR_OK)
+			if (siglent_sds_config_apply(sdi, "ACQW AVERAGE,%i", devc->average_samples) != SR_OK)
 				return SR_ERR;
 		} else {
-			if (siglent_sds_config_set(sdi, "ACQW SAMPLING") != SR_OK)
+			if (siglent_sds_config_apply(sdi, "ACQW SAMPLING") != SR_OK)
 				return SR_ERR;
 		}
 		break;
 	case NON_SPO_MODEL:
 		/* TODO: Implement CML/CNL/DL models. */
-		if (siglent_sds_config_set(sdi, "WFSU SP,0,TYPE,1") != SR_OK)
+		if (siglent_sds_config_apply(sdi, "WFSU SP,0,TYPE,1") != SR_OK)
 			return SR_ERR;
-		if (siglent_sds_config_set(sdi, "ACQW SAMPLING") != SR_OK)
+		if (siglent_sds_config_apply(sdi, "ACQW SAMPLING") != SR_OK)
 			return SR_ERR;
 		break;
 	default:
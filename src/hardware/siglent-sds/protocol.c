@@ -149,6 +149,133 @@ SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi, const char *fo
 	return ret;
 }
 
+/* Send a configuration setting, unless it was applied already. */
+SR_PRIV int siglent_sds_config_apply(const struct sr_dev_inst *sdi,
+	const char *format, ...)
+{
+	va_list args;
+	char *command;
+	int ret;
+
+	va_start(args, format);
+	command = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	ret = SR_OK;
+	if (sr_dev_command_changed(sdi, command)) {
+		ret = siglent_sds_config_set(sdi, "%s", command);
+		if (ret == SR_OK)
+			sr_dev_command_applied(sdi, command);
+	}
+	g_free(command);
+
+	return ret;
+}
+
+/*
+ * Read the next frame from the history. The number of frames in the
+ * history only gets queried along with the first one.
+ */
+static int siglent_sds_history_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	unsigned int framecount;
+	char buf[200];
+	int ret;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	if (devc->num_frames == 0) {
+		sr_dbg("Starting data capture for history frameset.");
+		if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
+			return SR_ERR;
+		ret = sr_scpi_read_data(sdi->conn, buf, 200);
+		if (ret < 0) {
+			sr_err("Read error while reading data header.");
+			return SR_ERR;
+		}
+		memcpy(&framecount, buf + 40, 4);
+		if (devc->limit_frames > framecount)
+			sr_err("Frame limit higher than frames in buffer of device!");
+		else if (devc->limit_frames == 0)
+			devc->limit_frames = framecount;
+	}
+	sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
+		devc->num_frames + 1, devc->limit_frames);
+	if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
+		return SR_ERR;
+	if (siglent_sds_channel_start(sdi) != SR_OK)
+		return SR_ERR;
+	siglent_sds_set_wait_event(devc, WAIT_STOP);
+
+	return SR_OK;
+}
+
+/*
+ * Have the scope capture limit_frames frames in sequence mode. It only
+ * re-arms in between, and keeps the frames in its history, from where
+ * they get read once the sequence is complete.
+ */
+static int siglent_sds_sequence_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	if (devc->limit_frames == 0) {
+		sr_err("Sequence capture needs a frame limit.");
+		return SR_ERR_ARG;
+	}
+
+	sr_dbg("Starting sequence capture of %" PRIu64 " frames.",
+		devc->limit_frames);
+	if (siglent_sds_config_set(sdi, "SEQ ON,%" PRIu64, devc->limit_frames) != SR_OK)
+		return SR_ERR;
+	if (siglent_sds_config_set(sdi, "ARM") != SR_OK)
+		return SR_ERR;
+	siglent_sds_set_wait_event(devc, WAIT_SEQUENCE);
+
+	return SR_OK;
+}
+
+/*
+ * Wait for the sequence capture to complete, then read its first frame
+ * from the history. Like the other waits, this returns a timeout after
+ * about 3 seconds in order to not block the application.
+ */
+static int siglent_sds_sequence_wait(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	time_t start;
+	char *buf;
+	gboolean stopped;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	start = time(NULL);
+	do {
+		if (time(NULL) - start >= 3) {
+			sr_dbg("Timeout waiting for sequence capture.");
+			return SR_ERR_TIMEOUT;
+		}
+		/* "SAST Stop" once all frames are captured. */
+		if (sr_scpi_get_string(sdi->conn, "SAST?", &buf) != SR_OK)
+			return SR_ERR;
+		stopped = g_strrstr(buf, "Stop") != NULL;
+		g_free(buf);
+		if (!stopped)
+			g_usleep(10000);
+	} while (!stopped);
+
+	sr_dbg("Sequence capture complete.");
+	devc->sequence_done = TRUE;
+
+	return siglent_sds_history_start(sdi);
+}
+
 /* Start capturing a new frameset. */
 SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 {
@@ -181,31 +308,11 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 				sr_spew("Device did not enter ARM mode.");
 				return SR_ERR;
 			}
-		} else { /* TODO: Implement history retrieval. */
-			unsigned int framecount;
-			char buf[200];
-			int ret;
-
-			sr_dbg("Starting data capture for history frameset.");
-			if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
-				return SR_ERR;
-			ret = sr_scpi_read_data(sdi->conn, buf, 200);
-			if (ret < 0) {
-				sr_err("Read error while reading data header.");
-				return SR_ERR;
-			}
-			memcpy(&framecount, buf + 40, 4);
-			if (devc->limit_frames > framecount)
-				sr_err("Frame limit higher than frames in buffer of device!");
-			else if (devc->limit_frames == 0)
-				devc->limit_frames = framecount;
-			sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
-				devc->num_frames + 1, devc->limit_frames);
-			if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
-				return SR_ERR;
-			if (siglent_sds_channel_start(sdi) != SR_OK)
-				return SR_ERR;
-			siglent_sds_set_wait_event(devc, WAIT_STOP);
+		} else if (devc->data_source == DATA_SOURCE_SEQUENCE &&
+				!devc->sequence_done) {
+			return siglent_sds_sequence_start(sdi);
+		} else {
+			return siglent_sds_history_start(sdi);
 		}
 		break;
 	case ESERIES:
@@ -231,31 +338,11 @@ SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi)
 				sr_spew("Device did not enter ARM mode.");
 				return SR_ERR;
 			}
-		} else { /* TODO: Implement history retrieval. */
-			unsigned int framecount;
-			char buf[200];
-			int ret;
-
-			sr_dbg("Starting data capture for history frameset.");
-			if (siglent_sds_config_set(sdi, "FPAR?") != SR_OK)
-				return SR_ERR;
-			ret = sr_scpi_read_data(sdi->conn, buf, 200);
-			if (ret < 0) {
-				sr_err("Read error while reading data header.");
-				return SR_ERR;
-			}
-			memcpy(&framecount, buf + 40, 4);
-			if (devc->limit_frames > framecount)
-				sr_err("Frame limit higher than frames in buffer of device!");
-			else if (devc->limit_frames == 0)
-				devc->limit_frames = framecount;
-			sr_dbg("Starting data capture for history frameset %" PRIu64 " of %" PRIu64,
-				devc->num_frames + 1, devc->limit_frames);
-			if (siglent_sds_config_set(sdi, "FRAM %i", devc->num_frames + 1) != SR_OK)
-				return SR_ERR;
-			if (siglent_sds_channel_start(sdi) != SR_OK)
-				return SR_ERR;
-			siglent_sds_set_wait_event(devc, WAIT_STOP);
+		} else if (devc->data_source == DATA_SOURCE_SEQUENCE &&
+				!devc->sequence_done) {
+			return siglent_sds_sequence_start(sdi);
+		} else {
+			return siglent_sds_history_start(sdi);
 		}
 		break;
 	case NON_SPO_MODEL:
@@ -505,6 +592,9 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 		if (siglent_sds_channel_start(sdi) != SR_OK)
 			return TRUE;
 		return TRUE;
+	case WAIT_SEQUENCE:
+		siglent_sds_sequence_wait(sdi);
+		return TRUE;
 	default:
 		sr_err("BUG: Unknown event target encountered.");
 		break;
@@ -54,6 +54,8 @@ enum protocol_version {
 enum data_source {
 	DATA_SOURCE_SCREEN,
 	DATA_SOURCE_HISTORY,
+	/* Capture limit_frames frames in sequence mode, then read them like History. */
+	DATA_SOURCE_SEQUENCE,
 };
 
 struct siglent_sds_vendor {
@@ -86,6 +88,7 @@ enum wait_events {
 	WAIT_TRIGGER,	/* Wait for trigger */
 	WAIT_BLOCK,	/* Wait for block data (only when reading sample mem) */
 	WAIT_STOP,	/* Wait for scope stopping (only single shots) */
+	WAIT_SEQUENCE,	/* Wait for the sequence capture to finish */
 };
 
 struct dev_context {
@@ -135,6 +138,8 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	/* The sequence capture is done, its frames are being read. */
+	gboolean sequence_done;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
@@ -157,6 +162,8 @@ struct dev_context {
 
 SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
 	const char *format, ...);
+SR_PRIV int siglent_sds_config_apply(const struct sr_dev_inst *sdi,
+	const char *format, ...);
 SR_PRIV int siglent_sds_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi);
 SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data);
@@ -0,0 +1,272 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Receives the datafeed which the "remote" output module of another
+ * libsigrok instance serves, and re-emits its packets into the local
+ * session. Connect with conn=tcp/<host>[/<port>].
+ */
+
+#include <config.h>
+#include <string.h>
+#include "protocol.h"
+
+static const uint32_t scanopts[] = {
+	SR_CONF_CONN,
+};
+
+static const uint32_t drvopts[] = {
+	SR_CONF_LOGIC_ANALYZER,
+	SR_CONF_OSCILLOSCOPE,
+};
+
+static const uint32_t devopts[] = {
+	SR_CONF_CONTINUOUS,
+	SR_CONF_CONN | SR_CONF_GET,
+	SR_CONF_SAMPLERATE | SR_CONF_GET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_FRAMES | SR_CONF_GET | SR_CONF_SET,
+};
+
+static void clear_helper(struct dev_context *devc)
+{
+	sr_tcp_dev_inst_free(devc->tcp);
+	g_byte_array_free(devc->rx, TRUE);
+	g_free(devc->lzo_buf);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
+static GSList *scan(struct sr_dev_driver *di, GSList *options)
+{
+	struct sr_config *src;
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct remote_hello *hello;
+	struct remote_channel *rch;
+	const char *conn;
+	char **params;
+	GSList *l;
+
+	conn = NULL;
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conn = g_variant_get_string(src->data, NULL);
+	}
+	if (!conn)
+		return NULL;
+
+	params = g_strsplit(conn, "/", 0);
+	if (!params[0] || g_ascii_strncasecmp(params[0], "tcp", 3)
+			|| !params[1] || !*params[1]) {
+		sr_err("Invalid connection '%s', expecting tcp/<host>[/<port>].",
+			conn);
+		g_strfreev(params);
+		return NULL;
+	}
+
+	devc = g_malloc0(sizeof(*devc));
+	devc->tcp = sr_tcp_dev_inst_new(params[1],
+		params[2] ? params[2] : SR_NETSTREAM_DEFAULT_PORT);
+	devc->rx = g_byte_array_new();
+	sr_sw_limits_init(&devc->limits);
+	g_strfreev(params);
+
+	if (remote_open(devc, &hello) != SR_OK) {
+		clear_helper(devc);
+		g_free(devc);
+		return NULL;
+	}
+	sr_tcp_disconnect(devc->tcp);
+	devc->samplerate = hello->samplerate;
+
+	sdi = g_malloc0(sizeof(*sdi));
+	sdi->status = SR_ST_INACTIVE;
+	sdi->vendor = g_strdup(hello->vendor);
+	sdi->model = g_strdup(hello->model);
+	sdi->version = g_strdup(hello->version);
+	sdi->serial_num = g_strdup(hello->serial_num);
+	sdi->connection_id = g_strdup(conn);
+	sdi->inst_type = SR_INST_USER;
+	sdi->priv = devc;
+	for (l = hello->channels; l; l = l->next) {
+		rch = l->data;
+		sr_channel_new(sdi, rch->index, rch->type, rch->enabled, rch->name);
+	}
+	remote_hello_free(hello);
+
+	return std_scan_complete(di, g_slist_append(NULL, sdi));
+}
+
+static int dev_open(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct remote_hello *hello;
+	int ret;
+
+	devc = sdi->priv;
+
+	if ((ret = remote_open(devc, &hello)) != SR_OK)
+		return ret;
+	if (g_slist_length(hello->channels) != g_slist_length(sdi->channels)) {
+		sr_err("The remote device's channels have changed, rescan.");
+		remote_hello_free(hello);
+		sr_tcp_disconnect(devc->tcp);
+		return SR_ERR;
+	}
+	devc->samplerate = hello->samplerate;
+	remote_hello_free(hello);
+
+	return SR_OK;
+}
+
+static int dev_close(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	return sr_tcp_disconnect(devc->tcp);
+}
+
+static int config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+	devc = sdi->priv;
+
+	switch (key) {
+	case SR_CONF_CONN:
+		*data = g_variant_new_string(sdi->connection_id);
+		break;
+	case SR_CONF_SAMPLERATE:
+		if (!devc->samplerate)
+			return SR_ERR_NA;
+		*data = g_variant_new_uint64(devc->samplerate);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+	case SR_CONF_LIMIT_MSEC:
+	case SR_CONF_LIMIT_FRAMES:
+		return sr_sw_limits_config_get(&devc->limits, key, data);
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int config_set(uint32_t key, GVariant *data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+
+	(void)cg;
+
+	devc = sdi->priv;
+
+	return sr_sw_limits_config_set(&devc->limits, key, data);
+}
+
+static int config_list(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	return STD_CONFIG_LIST(key, data, sdi, cg, scanopts, drvopts, devopts);
+}
+
+static int dev_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct remote_hello *hello;
+	struct sr_channel *ch;
+	GSList *l;
+	int ret;
+
+	devc = sdi->priv;
+
+	/* A previous acquisition closed the connection. */
+	if (devc->tcp->sock_fd < 0) {
+		if ((ret = remote_open(devc, &hello)) != SR_OK)
+			return ret;
+		remote_hello_free(hello);
+	}
+
+	/* Analog samples count towards the limit without logic channels. */
+	devc->limit_channel = NULL;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			devc->limit_channel = NULL;
+			break;
+		}
+		if (!devc->limit_channel)
+			devc->limit_channel = ch;
+	}
+
+	sr_sw_limits_acquisition_start(&devc->limits);
+	if ((ret = remote_start(devc)) != SR_OK)
+		return ret;
+
+	return sr_tcp_source_add(sdi->session, devc->tcp, G_IO_IN, 100,
+		remote_receive_data, (void *)sdi);
+}
+
+static int dev_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	sr_tcp_source_remove(sdi->session, devc->tcp);
+	/* The server streams until the client goes away. */
+	sr_tcp_disconnect(devc->tcp);
+	if (devc->header_seen)
+		std_session_send_df_end(sdi);
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver sigrok_remote_driver_info = {
+	.name = "sigrok-remote",
+	.longname = "sigrok datafeed stream over TCP",
+	.api_version = 1,
+	.init = std_init,
+	.cleanup = std_cleanup,
+	.scan = scan,
+	.dev_list = std_dev_list,
+	.dev_clear = dev_clear,
+	.config_get = config_get,
+	.config_set = config_set,
+	.config_list = config_list,
+	.dev_open = dev_open,
+	.dev_close = dev_close,
+	.dev_acquisition_start = dev_acquisition_start,
+	.dev_acquisition_stop = dev_acquisition_stop,
+	.context = NULL,
+};
+SR_REGISTER_DEV_DRIVER(sigrok_remote_driver_info);
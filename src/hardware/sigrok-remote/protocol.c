@@ -0,0 +1,593 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include "minilzo/minilzo.h"
+#include "protocol.h"
+
+/* Size of the individual reads from the connection. */
+#define RX_READ_SIZE (64 * 1024)
+
+/* Bounds checked parsing of frame payloads, see output/remote.c. */
+struct reader {
+	const uint8_t *p;
+	size_t left;
+	gboolean fail;
+};
+
+static const uint8_t *get_bytes(struct reader *r, size_t len)
+{
+	const uint8_t *p;
+
+	if (r->fail || len > r->left) {
+		r->fail = TRUE;
+		return NULL;
+	}
+	p = r->p;
+	r->p += len;
+	r->left -= len;
+
+	return p;
+}
+
+static uint8_t get_u8(struct reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint8_t));
+	return p ? *p : 0;
+}
+
+static uint16_t get_u16(struct reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint16_t));
+	return p ? RL16(p) : 0;
+}
+
+static uint32_t get_u32(struct reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint32_t));
+	return p ? RL32(p) : 0;
+}
+
+static uint64_t get_u64(struct reader *r)
+{
+	const uint8_t *p;
+
+	p = get_bytes(r, sizeof(uint64_t));
+	return p ? RL64(p) : 0;
+}
+
+/* Copy sample data from the unaligned payload. */
+static void *get_copy(struct reader *r, size_t len)
+{
+	const uint8_t *p;
+	void *copy;
+
+	if (!(p = get_bytes(r, len)))
+		return NULL;
+	copy = g_malloc(len);
+	memcpy(copy, p, len);
+
+	return copy;
+}
+
+static char *get_str(struct reader *r)
+{
+	const uint8_t *p;
+	uint16_t len;
+
+	len = get_u16(r);
+	p = get_bytes(r, len);
+	return p ? g_strndup((const char *)p, len) : NULL;
+}
+
+static int write_all(struct sr_tcp_dev_inst *tcp, const uint8_t *data, size_t len)
+{
+	int ret;
+
+	while (len) {
+		ret = sr_tcp_write_bytes(tcp, data, len);
+		if (ret <= 0)
+			return SR_ERR_IO;
+		data += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+static int read_all(struct sr_tcp_dev_inst *tcp, uint8_t *data, size_t len,
+		int timeout_ms)
+{
+	int64_t deadline, remain;
+	int ret;
+
+	deadline = g_get_monotonic_time() + timeout_ms * 1000;
+	while (len) {
+		remain = (deadline - g_get_monotonic_time()) / 1000;
+		if (remain <= 0)
+			return SR_ERR_TIMEOUT;
+		if (!sr_tcp_wait_readable(tcp, remain))
+			continue;
+		ret = sr_tcp_read_bytes(tcp, data, len, TRUE);
+		/* Readable without data means the peer closed the connection. */
+		if (ret <= 0)
+			return SR_ERR_IO;
+		data += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+/* Send a control frame with a single u32 value. */
+static int send_control(struct sr_tcp_dev_inst *tcp, uint16_t type,
+		uint32_t value)
+{
+	uint8_t frame[SR_NETSTREAM_FRAME_HEADER + sizeof(uint32_t)];
+
+	WL16(&frame[0], type);
+	WL16(&frame[2], 0);
+	WL32(&frame[4], sizeof(uint32_t));
+	WL32(&frame[SR_NETSTREAM_FRAME_HEADER], value);
+
+	return write_all(tcp, frame, sizeof(frame));
+}
+
+static void remote_channel_free(void *data)
+{
+	struct remote_channel *ch;
+
+	ch = data;
+	g_free(ch->name);
+	g_free(ch);
+}
+
+SR_PRIV void remote_hello_free(struct remote_hello *hello)
+{
+	if (!hello)
+		return;
+
+	g_free(hello->vendor);
+	g_free(hello->model);
+	g_free(hello->version);
+	g_free(hello->serial_num);
+	g_slist_free_full(hello->channels, remote_channel_free);
+	g_free(hello);
+}
+
+static struct remote_hello *hello_parse(const uint8_t *payload, size_t len)
+{
+	struct reader r;
+	struct remote_hello *hello;
+	struct remote_channel *ch;
+	uint32_t version, count, i;
+
+	r.p = payload;
+	r.left = len;
+	r.fail = FALSE;
+
+	version = get_u32(&r);
+	if (version != SR_NETSTREAM_VERSION) {
+		sr_err("Unsupported stream version %" PRIu32 ".", version);
+		return NULL;
+	}
+
+	hello = g_malloc0(sizeof(*hello));
+	hello->samplerate = get_u64(&r);
+	hello->vendor = get_str(&r);
+	hello->model = get_str(&r);
+	hello->version = get_str(&r);
+	hello->serial_num = get_str(&r);
+	count = get_u32(&r);
+	for (i = 0; i < count && !r.fail; i++) {
+		ch = g_malloc0(sizeof(*ch));
+		ch->index = get_u32(&r);
+		ch->type = get_u32(&r);
+		ch->enabled = get_u8(&r);
+		ch->name = get_str(&r);
+		hello->channels = g_slist_append(hello->channels, ch);
+	}
+	if (r.fail) {
+		sr_err("Invalid device description.");
+		remote_hello_free(hello);
+		return NULL;
+	}
+
+	return hello;
+}
+
+/**
+ * Connect to the server, and receive its device description.
+ *
+ * @param devc The device context with the connection to use.
+ * @param hello Receives the device description, free it with
+ *              remote_hello_free().
+ */
+SR_PRIV int remote_open(struct dev_context *devc, struct remote_hello **hello)
+{
+	uint8_t header[SR_NETSTREAM_FRAME_HEADER];
+	uint8_t *payload;
+	uint32_t len;
+	int ret;
+
+	if ((ret = sr_tcp_connect(devc->tcp)) != SR_OK)
+		return ret;
+
+	ret = read_all(devc->tcp, header, sizeof(header),
+		REMOTE_HELLO_TIMEOUT_MS);
+	len = RL32(&header[4]);
+	if (ret == SR_OK && (RL16(&header[0]) != SR_NETSTREAM_HELLO
+			|| RL16(&header[2]) || len > 1024 * 1024))
+		ret = SR_ERR_DATA;
+	if (ret != SR_OK) {
+		sr_dbg("No datafeed stream server at %s:%s.",
+			devc->tcp->host_addr, devc->tcp->tcp_port);
+		sr_tcp_disconnect(devc->tcp);
+		return ret;
+	}
+
+	payload = g_malloc(len);
+	ret = read_all(devc->tcp, payload, len, REMOTE_HELLO_TIMEOUT_MS);
+	if (ret == SR_OK && !(*hello = hello_parse(payload, len)))
+		ret = SR_ERR_DATA;
+	g_free(payload);
+	if (ret != SR_OK)
+		sr_tcp_disconnect(devc->tcp);
+
+	return ret;
+}
+
+/* Ask the server to start streaming, and reset the receive state. */
+SR_PRIV int remote_start(struct dev_context *devc)
+{
+	devc->header_seen = FALSE;
+	g_byte_array_set_size(devc->rx, 0);
+
+	return send_control(devc->tcp, SR_NETSTREAM_START, REMOTE_WINDOW);
+}
+
+static struct sr_channel *channel_by_index(const struct sr_dev_inst *sdi,
+		uint32_t index)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if ((uint32_t)ch->index == index)
+			return ch;
+	}
+
+	return NULL;
+}
+
+static int header_process(const struct sr_dev_inst *sdi, struct reader *r)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+
+	devc = sdi->priv;
+
+	/* Later acquisitions of the server continue ours. */
+	if (devc->header_seen)
+		return SR_OK;
+
+	/* The feed version is that of std_session_send_df_header(). */
+	(void)get_u32(r);
+	header.feed_version = 1;
+	header.starttime.tv_sec = (int64_t)get_u64(r);
+	header.starttime.tv_usec = (int64_t)get_u64(r);
+	if (r->fail)
+		return SR_ERR_DATA;
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	devc->header_seen = TRUE;
+
+	return sr_session_send(sdi, &packet);
+}
+
+static int meta_process(const struct sr_dev_inst *sdi, struct reader *r)
+{
+	struct dev_context *devc;
+	GVariant *value, *swapped;
+	void *data;
+	uint32_t count, key, size, i;
+	char *type;
+	int ret;
+
+	devc = sdi->priv;
+
+	ret = SR_OK;
+	count = get_u32(r);
+	for (i = 0; i < count && ret == SR_OK; i++) {
+		key = get_u32(r);
+		type = get_str(r);
+		size = get_u32(r);
+		data = get_copy(r, size);
+		if (r->fail || !g_variant_type_string_is_valid(type)) {
+			g_free(type);
+			g_free(data);
+			return SR_ERR_DATA;
+		}
+		value = g_variant_ref_sink(g_variant_new_from_data(
+			G_VARIANT_TYPE(type), data, size, FALSE, g_free, data));
+		g_free(type);
+		if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+			swapped = g_variant_byteswap(value);
+			g_variant_unref(value);
+			value = swapped;
+		}
+		if (key == SR_CONF_SAMPLERATE
+				&& g_variant_is_of_type(value, G_VARIANT_TYPE_UINT64))
+			devc->samplerate = g_variant_get_uint64(value);
+		ret = sr_session_send_meta(sdi, key, value);
+		g_variant_unref(value);
+	}
+
+	return ret;
+}
+
+static int logic_process(const struct sr_dev_inst *sdi, struct reader *r)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t count;
+
+	devc = sdi->priv;
+
+	logic.unitsize = get_u16(r);
+	if (r->fail || !logic.unitsize)
+		return SR_ERR_DATA;
+	count = r->left / logic.unitsize;
+	count = sr_sw_limits_accept_samples(&devc->limits, count);
+	if (!count)
+		return SR_OK;
+	logic.length = count * logic.unitsize;
+	logic.data = (void *)r->p;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return sr_session_send(sdi, &packet);
+}
+
+static int analog_process(const struct sr_dev_inst *sdi, struct reader *r)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel *ch;
+	const uint8_t *ts;
+	int64_t *timestamps;
+	uint64_t size;
+	uint32_t num_channels, i;
+	uint8_t flags;
+	int ret;
+
+	devc = sdi->priv;
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+
+	analog.num_samples = get_u32(r);
+	flags = get_u8(r);
+	encoding.unitsize = get_u8(r);
+	encoding.is_signed = get_u8(r);
+	encoding.is_float = get_u8(r);
+	encoding.is_bigendian = get_u8(r);
+	encoding.digits = (int8_t)get_u8(r);
+	encoding.is_digits_decimal = get_u8(r);
+	encoding.scale.p = (int64_t)get_u64(r);
+	encoding.scale.q = get_u64(r);
+	encoding.offset.p = (int64_t)get_u64(r);
+	encoding.offset.q = get_u64(r);
+	meaning.mq = get_u32(r);
+	meaning.unit = get_u32(r);
+	meaning.mqflags = get_u64(r);
+	num_channels = get_u32(r);
+	for (i = 0; i < num_channels && !r->fail; i++) {
+		if (!(ch = channel_by_index(sdi, get_u32(r))))
+			r->fail = TRUE;
+		else
+			meaning.channels = g_slist_append(meaning.channels, ch);
+	}
+	spec.spec_digits = (int8_t)get_u8(r);
+	size = (uint64_t)analog.num_samples * num_channels * encoding.unitsize;
+	analog.data = get_copy(r, size);
+	ts = NULL;
+	if (flags & 1)
+		ts = get_bytes(r, (uint64_t)analog.num_samples * sizeof(int64_t));
+	if (r->fail || !meaning.channels) {
+		g_free(analog.data);
+		g_slist_free(meaning.channels);
+		return SR_ERR_DATA;
+	}
+
+	timestamps = NULL;
+	if (ts) {
+		timestamps = g_malloc(analog.num_samples * sizeof(int64_t));
+		for (i = 0; i < analog.num_samples; i++)
+			timestamps[i] = (int64_t)RL64(&ts[i * sizeof(int64_t)]);
+	}
+	analog.timestamps = timestamps;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_session_send(sdi, &packet);
+
+	if (devc->limit_channel && meaning.channels->data == devc->limit_channel)
+		sr_sw_limits_update_samples_read(&devc->limits, analog.num_samples);
+
+	g_free(analog.data);
+	g_free(timestamps);
+	g_slist_free(meaning.channels);
+
+	return ret;
+}
+
+/* Emit a frame's packet. Returns TRUE when the acquisition ends. */
+static gboolean frame_process(const struct sr_dev_inst *sdi, uint16_t type,
+		uint16_t flags, const uint8_t *payload, size_t len)
+{
+	struct dev_context *devc;
+	struct reader r;
+	lzo_uint raw_len;
+	int ret;
+
+	devc = sdi->priv;
+
+	if (flags & SR_NETSTREAM_FLAG_LZO) {
+		if (len < sizeof(uint32_t)
+				|| RL32(payload) > SR_NETSTREAM_MAX_PAYLOAD) {
+			sr_err("Invalid compressed frame.");
+			return TRUE;
+		}
+		raw_len = RL32(payload);
+		if (raw_len > devc->lzo_buf_size) {
+			g_free(devc->lzo_buf);
+			devc->lzo_buf = g_malloc(raw_len);
+			devc->lzo_buf_size = raw_len;
+		}
+		if (lzo1x_decompress_safe((uint8_t *)payload + sizeof(uint32_t),
+				len - sizeof(uint32_t), devc->lzo_buf,
+				&raw_len, NULL) != LZO_E_OK
+				|| raw_len != RL32(payload)) {
+			sr_err("Cannot decompress frame.");
+			return TRUE;
+		}
+		payload = devc->lzo_buf;
+		len = raw_len;
+	}
+
+	r.p = payload;
+	r.left = len;
+	r.fail = FALSE;
+
+	/* The stream of a running acquisition starts with its header. */
+	if (type != SR_DF_HEADER && !devc->header_seen)
+		return FALSE;
+
+	switch (type) {
+	case SR_DF_HEADER:
+		ret = header_process(sdi, &r);
+		break;
+	case SR_DF_END:
+		return TRUE;
+	case SR_DF_META:
+		ret = meta_process(sdi, &r);
+		break;
+	case SR_DF_TRIGGER:
+		ret = std_session_send_df_trigger(sdi);
+		break;
+	case SR_DF_FRAME_BEGIN:
+		ret = std_session_send_df_frame_begin(sdi);
+		break;
+	case SR_DF_FRAME_END:
+		ret = std_session_send_df_frame_end(sdi);
+		sr_sw_limits_update_frames_read(&devc->limits, 1);
+		break;
+	case SR_DF_LOGIC:
+		ret = logic_process(sdi, &r);
+		break;
+	case SR_DF_ANALOG:
+		ret = analog_process(sdi, &r);
+		break;
+	default:
+		sr_dbg("Ignoring frame of unknown type %d.", type);
+		ret = SR_OK;
+		break;
+	}
+	if (ret == SR_ERR_DATA)
+		sr_err("Invalid frame of type %d.", type);
+
+	return ret != SR_OK;
+}
+
+SR_PRIV int remote_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	const uint8_t *p;
+	size_t total, used, pos;
+	uint32_t len;
+	gboolean stop;
+	int ret;
+
+	(void)fd;
+	(void)revents;
+
+	if (!(sdi = cb_data) || !(devc = sdi->priv))
+		return TRUE;
+
+	stop = FALSE;
+	total = 0;
+	while (total < REMOTE_RX_CHUNK && sr_tcp_is_readable(devc->tcp)) {
+		used = devc->rx->len;
+		g_byte_array_set_size(devc->rx, used + RX_READ_SIZE);
+		ret = sr_tcp_read_bytes(devc->tcp, devc->rx->data + used,
+			RX_READ_SIZE, TRUE);
+		g_byte_array_set_size(devc->rx, used + MAX(ret, 0));
+		/* Readable without data means the peer closed the connection. */
+		if (ret <= 0) {
+			sr_err("Connection to the server was lost.");
+			stop = TRUE;
+			break;
+		}
+		total += ret;
+	}
+
+	pos = 0;
+	while (!stop && devc->rx->len - pos >= SR_NETSTREAM_FRAME_HEADER) {
+		p = devc->rx->data + pos;
+		len = RL32(&p[4]);
+		if (len > SR_NETSTREAM_MAX_PAYLOAD) {
+			sr_err("Invalid frame size %" PRIu32 ".", len);
+			stop = TRUE;
+			break;
+		}
+		if (devc->rx->len - pos < SR_NETSTREAM_FRAME_HEADER + len)
+			break;
+		stop = frame_process(sdi, RL16(&p[0]), RL16(&p[2]),
+			p + SR_NETSTREAM_FRAME_HEADER, len);
+		pos += SR_NETSTREAM_FRAME_HEADER + len;
+	}
+	g_byte_array_remove_range(devc->rx, 0, pos);
+
+	/* Let the server send more, now that we processed this data. */
+	if (pos && !stop)
+		(void)send_control(devc->tcp, SR_NETSTREAM_CREDIT, pos);
+
+	if (stop || sr_sw_limits_check(&devc->limits))
+		sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_HARDWARE_SIGROK_REMOTE_PROTOCOL_H
+#define LIBSIGROK_HARDWARE_SIGROK_REMOTE_PROTOCOL_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "sigrok-remote"
+
+/* Sample data which the server may send ahead of our processing. */
+#define REMOTE_WINDOW (8 * 1024 * 1024)
+/* Receive data to process per callback, keeps the session responsive. */
+#define REMOTE_RX_CHUNK (4 * 1024 * 1024)
+#define REMOTE_HELLO_TIMEOUT_MS 3000
+
+struct remote_channel {
+	uint32_t index;
+	uint32_t type;
+	gboolean enabled;
+	char *name;
+};
+
+/* The server's description of the device, see SR_NETSTREAM_HELLO. */
+struct remote_hello {
+	uint64_t samplerate;
+	char *vendor;
+	char *model;
+	char *version;
+	char *serial_num;
+	GSList *channels;
+};
+
+struct dev_context {
+	struct sr_tcp_dev_inst *tcp;
+	struct sr_sw_limits limits;
+	uint64_t samplerate;
+	/* Analog channel which counts samples, when no logic channel does. */
+	const struct sr_channel *limit_channel;
+	gboolean header_seen;
+	GByteArray *rx;
+	uint8_t *lzo_buf;
+	size_t lzo_buf_size;
+};
+
+SR_PRIV int remote_open(struct dev_context *devc, struct remote_hello **hello);
+SR_PRIV void remote_hello_free(struct remote_hello *hello);
+SR_PRIV int remote_start(struct dev_context *devc);
+SR_PRIV int remote_receive_data(int fd, int revents, void *cb_data);
+
+#endif
@@ -160,7 +160,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	}
 
 	/* List all libusb devices. */
-	num_devs = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	num_devs = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (num_devs < 0) {
 		sr_err("Failed to list USB devices: %s.",
 			libusb_error_name(num_devs));
@@ -220,18 +220,21 @@ static int drain_usb(struct sr_usb_dev_inst *usb, unsigned int endpoint)
 
 static int dev_open(struct sr_dev_inst *sdi)
 {
-	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	int i, ret;
 
-	drvc = sdi->driver->context;
 	devc = sdi->priv;
 	usb = sdi->conn;
 
 	/* Try the whole shebang three times, fingers crossed. */
 	for (i = 0; i < 3; i++) {
-		ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+		/*
+		 * Use a libusb context of our own, so that the transfers
+		 * of several devices in a session get handled by their
+		 * own event sources, and thus run in parallel.
+		 */
+		ret = sr_usb_open_private(usb);
 		if (ret != SR_OK)
 			return ret;
 
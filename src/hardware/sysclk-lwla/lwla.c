@@ -27,6 +27,25 @@
 #define BITSTREAM_MAX_SIZE    (256 * 1024) /* Bitstream size limit for safety */
 #define BITSTREAM_HEADER_SIZE 4            /* Transfer header size in bytes */
 
+/* Queue the pending run of the current sample value for the session feed,
+ * up to the sample limit. The feed queue passes long runs on as such.
+ */
+SR_PRIV int lwla_queue_run(struct acquisition_state *acq)
+{
+	uint8_t value[sizeof(uint64_t)];
+	uint64_t count;
+
+	count = MIN(acq->run_len, acq->samples_max - acq->samples_done);
+	acq->run_len = 0;
+	if (count == 0)
+		return SR_OK;
+
+	write_u64le(value, acq->sample);
+	acq->samples_done += count;
+
+	return feed_queue_logic_submit_one(acq->feed_queue, value, count);
+}
+
 /* Load a bitstream file into memory. Returns a newly allocated array
  * consisting of a 32-bit length field followed by the bitstream data.
  */
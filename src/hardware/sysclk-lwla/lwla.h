@@ -26,6 +26,7 @@
 #include <libsigrok/libsigrok.h>
 
 struct sr_usb_dev_inst;
+struct feed_queue_logic;
 
 /* Rotate argument n bits to the left.
  * This construct is an idiom recognized by GCC as bit rotation.
@@ -69,6 +70,11 @@ struct sr_usb_dev_inst;
  */
 #define PACKET_SIZE		(5000 * 4 * 5)
 
+/* Minimum run length in samples which gets sent as a run instead of
+ * being expanded into the logic packet.
+ */
+#define MIN_RUN_SAMPLES		4096
+
 /** LWLA protocol command ID codes. */
 enum command_id {
 	CMD_READ_REG	= 1,
@@ -108,7 +114,9 @@ struct acquisition_state {
 	uint64_t duration_now;	/* running capture duration since trigger */
 
 	uint64_t sample;	/* last sample read from capture memory */
-	uint64_t run_len;	/* remaining run length of current sample */
+	uint64_t run_len;	/* pending run length of current sample */
+
+	struct feed_queue_logic *feed_queue;	/* session feed */
 
 	struct libusb_transfer *xfer_in;	/* USB in transfer record */
 	struct libusb_transfer *xfer_out;	/* USB out transfer record */
@@ -118,7 +126,6 @@ struct acquisition_state {
 	unsigned int mem_addr_next;	/* start address for next async read */
 	unsigned int mem_addr_stop;	/* end of memory range to be read */
 	unsigned int in_index;		/* position in read transfer buffer */
-	unsigned int out_index;		/* position in logic packet buffer */
 	enum rle_state rle;		/* RLE decoding state */
 
 	gboolean rle_enabled;	/* capturing in timing-state mode */
@@ -131,7 +138,6 @@ struct acquisition_state {
 	struct regval reg_sequence[MAX_REG_SEQ_LEN];	/* register buffer */
 	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN32];	/* USB in buffer */
 	uint16_t xfer_buf_out[MAX_ACQ_SEND_LEN16];	/* USB out buffer */
-	uint8_t out_packet[PACKET_SIZE];		/* logic payload */
 };
 
 static inline void lwla_queue_regval(struct acquisition_state *acq,
@@ -142,6 +148,15 @@ static inline void lwla_queue_regval(struct acquisition_state *acq,
 	acq->reg_seq_len++;
 }
 
+/* Check whether the sample limit is reached, including the pending run.
+ */
+static inline gboolean lwla_samples_complete(const struct acquisition_state *acq)
+{
+	return acq->samples_done + acq->run_len >= acq->samples_max;
+}
+
+SR_PRIV int lwla_queue_run(struct acquisition_state *acq);
+
 SR_PRIV int lwla_send_bitstream(struct sr_context *ctx,
 				const struct sr_usb_dev_inst *usb,
 				const char *name);
@@ -88,85 +88,71 @@ static const char bitstream_map[][32] = {
 };
 
 /* Demangle incoming sample data from the transfer buffer. */
-static void read_response(struct acquisition_state *acq)
+static int read_response(struct acquisition_state *acq)
 {
-	uint32_t *in_p, *out_p;
+	uint32_t *in_p;
 	unsigned int words_left, num_words;
-	unsigned int max_samples, run_samples;
+	uint64_t run_samples;
 	unsigned int i;
 
 	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
 			- acq->mem_addr_done;
-	/* Calculate number of samples to write into packet. */
-	max_samples = MIN(acq->samples_max - acq->samples_done,
-			  PACKET_SIZE / UNIT_SIZE - acq->out_index);
-	run_samples = MIN(max_samples, 2 * words_left);
+	/* Calculate number of samples to queue. */
+	run_samples = MIN(acq->samples_max - acq->samples_done,
+			  2 * (uint64_t)words_left);
 
 	/* Round up in case the samples limit is an odd number. */
 	num_words = (run_samples + 1) / 2;
-	/*
-	 * Without RLE the output index will always be a multiple of two
-	 * samples (at least before reaching the samples limit), thus 32-bit
-	 * alignment is guaranteed.
-	 */
-	out_p = (uint32_t *)&acq->out_packet[acq->out_index * UNIT_SIZE];
 	in_p = &acq->xfer_buf_in[acq->in_index];
 	/*
-	 * Transfer two samples at a time, taking care to swap the 16-bit
-	 * halves of each input word but keeping the samples themselves in
-	 * the original Little Endian order.
+	 * Demangle two samples at a time in place, taking care to swap
+	 * the 16-bit halves of each input word but keeping the samples
+	 * themselves in the original Little Endian order.
 	 */
 	for (i = 0; i < num_words; i++)
-		out_p[i] = LROTATE(in_p[i], 16);
+		in_p[i] = LROTATE(in_p[i], 16);
 
 	acq->in_index += num_words;
 	acq->mem_addr_done += num_words;
-	acq->out_index += run_samples;
 	acq->samples_done += run_samples;
+
+	return feed_queue_logic_submit_many(acq->feed_queue,
+			(const uint8_t *)in_p, run_samples);
 }
 
-/* Demangle and decompress incoming sample data from the transfer buffer. */
-static void read_response_rle(struct acquisition_state *acq)
+/* Demangle and decompress incoming sample data from the transfer buffer.
+ * Consecutive words of the same sample value extend the pending run, and
+ * each completed run goes to the feed queue as a whole.
+ */
+static int read_response_rle(struct acquisition_state *acq)
 {
 	uint32_t *in_p;
-	uint16_t *out_p;
-	unsigned int words_left, max_samples, run_samples, wi, ri;
+	unsigned int words_left, wi;
 	uint32_t word;
-	uint16_t sample;
+	uint64_t sample;
+	int ret;
 
 	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
 			- acq->mem_addr_done;
 	in_p = &acq->xfer_buf_in[acq->in_index];
 
-	for (wi = 0;; wi++) {
-		/* Calculate number of samples to write into packet. */
-		max_samples = MIN(acq->samples_max - acq->samples_done,
-				  PACKET_SIZE / UNIT_SIZE - acq->out_index);
-		run_samples = MIN(max_samples, acq->run_len);
-
-		/* Expand run-length samples into session packet. */
-		sample = GUINT16_TO_LE(acq->sample);
-		out_p = &((uint16_t *)acq->out_packet)[acq->out_index];
-
-		for (ri = 0; ri < run_samples; ri++)
-			out_p[ri] = sample;
-
-		acq->run_len -= run_samples;
-		acq->out_index += run_samples;
-		acq->samples_done += run_samples;
-
-		if (run_samples == max_samples)
-			break; /* Packet full or sample limit reached. */
-		if (wi >= words_left)
-			break; /* Done with current transfer. */
-
+	for (wi = 0; wi < words_left && !lwla_samples_complete(acq); wi++) {
 		word = GUINT32_FROM_LE(in_p[wi]);
-		acq->sample = word >> 16;
-		acq->run_len = (word & 0xFFFF) + 1;
+		sample = word >> 16;
+		if (sample != acq->sample) {
+			/* The previous run is complete. */
+			ret = lwla_queue_run(acq);
+			if (ret != SR_OK)
+				return ret;
+			acq->sample = sample;
+		}
+		acq->run_len += (word & 0xFFFF) + 1;
 	}
 
 	acq->in_index += wi;
 	acq->mem_addr_done += wi;
+
+	return SR_OK;
 }
 
 /* Check whether we can receive responses of more than 64 bytes.
@@ -417,10 +403,8 @@ static int handle_response(const struct sr_dev_inst *sdi)
 			return SR_ERR;
 		}
 		if (acq->rle_enabled)
-			read_response_rle(acq);
-		else
-			read_response(acq);
-		break;
+			return read_response_rle(acq);
+		return read_response(acq);
 	default:
 		sr_err("BUG: unhandled response state %d.", devc->state);
 		return SR_ERR_BUG;
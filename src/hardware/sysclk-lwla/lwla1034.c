@@ -185,68 +185,59 @@ static inline uint64_t bulk_long_get(const struct acquisition_state *acq,
 
 /* Demangle and decompress incoming sample data from the transfer buffer.
  * The data chunk is taken from the acquisition state, and is expected to
- * contain a multiple of 8 packed 36-bit words.
+ * contain a multiple of 8 packed 36-bit words. The words get unpacked a
+ * slice at a time, and each completed run of one sample value goes to
+ * the feed queue as a whole instead of being expanded here.
  */
-static void read_response(struct acquisition_state *acq)
+static int read_response(struct acquisition_state *acq)
 {
 	uint64_t sample, high_nibbles, word;
-	uint32_t *slice;
-	uint8_t *out_p;
-	unsigned int words_left, max_samples, run_samples, wi, ri, si;
+	const uint32_t *slice;
+	unsigned int wi, end, si;
+	int ret;
 
-	/* Number of 36-bit words remaining in the transfer buffer. */
-	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
+	wi = acq->in_index;
+	/* End of the 36-bit words in the transfer buffer. */
+	end = wi + MIN(acq->mem_addr_next, acq->mem_addr_stop)
 			- acq->mem_addr_done;
 
-	for (wi = 0;; wi++) {
-		/* Calculate number of samples to write into packet. */
-		max_samples = MIN(acq->samples_max - acq->samples_done,
-				  PACKET_SIZE / UNIT_SIZE - acq->out_index);
-		run_samples = MIN(max_samples, acq->run_len);
-
-		/* Expand run-length samples into session packet. */
-		sample = acq->sample;
-		out_p = &acq->out_packet[acq->out_index * UNIT_SIZE];
-
-		for (ri = 0; ri < run_samples; ri++) {
-			out_p[0] =  sample        & 0xFF;
-			out_p[1] = (sample >>  8) & 0xFF;
-			out_p[2] = (sample >> 16) & 0xFF;
-			out_p[3] = (sample >> 24) & 0xFF;
-			out_p[4] = (sample >> 32) & 0xFF;
-			out_p += UNIT_SIZE;
-		}
-		acq->run_len -= run_samples;
-		acq->out_index += run_samples;
-		acq->samples_done += run_samples;
-
-		if (run_samples == max_samples)
-			break; /* Packet full or sample limit reached. */
-		if (wi >= words_left)
-			break; /* Done with current transfer. */
-
+	while (wi < end && !lwla_samples_complete(acq)) {
 		/* Get the current slice of 8 packed 36-bit words. */
-		slice = &acq->xfer_buf_in[(acq->in_index + wi) / 8 * 9];
-		si = (acq->in_index + wi) % 8; /* Word index within slice. */
-
-		/* Extract the next 36-bit word. */
+		slice = &acq->xfer_buf_in[wi / 8 * 9];
 		high_nibbles = LWLA_TO_UINT32(slice[8]);
-		word = LWLA_TO_UINT32(slice[si]);
-		word |= (high_nibbles << (4 * si + 4)) & (UINT64_C(0xF) << 32);
-
-		if (acq->rle == RLE_STATE_DATA) {
-			acq->sample = word & ALL_CHANNELS_MASK;
-			acq->run_len = ((word >> NUM_CHANNELS) & 1) + 1;
-			acq->rle = ((word & RLE_FLAG_LEN_FOLLOWS) != 0)
-					? RLE_STATE_LEN : RLE_STATE_DATA;
-		} else {
-			acq->run_len += word << 1;
-			acq->rle = RLE_STATE_DATA;
+
+		for (si = wi % 8; si < 8 && wi < end; si++) {
+			/* Extract the next 36-bit word. */
+			word = LWLA_TO_UINT32(slice[si]);
+			word |= (high_nibbles << (4 * si + 4))
+				& (UINT64_C(0xF) << 32);
+			wi++;
+
+			if (acq->rle == RLE_STATE_DATA) {
+				sample = word & ALL_CHANNELS_MASK;
+				if (sample != acq->sample) {
+					/* The previous run is complete. */
+					ret = lwla_queue_run(acq);
+					if (ret != SR_OK)
+						return ret;
+					acq->sample = sample;
+				}
+				acq->run_len += ((word >> NUM_CHANNELS) & 1) + 1;
+				acq->rle = ((word & RLE_FLAG_LEN_FOLLOWS) != 0)
+						? RLE_STATE_LEN : RLE_STATE_DATA;
+			} else {
+				acq->run_len += word << 1;
+				acq->rle = RLE_STATE_DATA;
+			}
+			if (lwla_samples_complete(acq))
+				break; /* Sample limit reached. */
 		}
 	}
 
-	acq->in_index += wi;
-	acq->mem_addr_done += wi;
+	acq->mem_addr_done += wi - acq->in_index;
+	acq->in_index = wi;
+
+	return SR_OK;
 }
 
 /* Check whether we can receive responses of more than 64 bytes.
@@ -536,8 +527,7 @@ static int handle_response(const struct sr_dev_inst *sdi)
 			devc->transfer_error = TRUE;
 			return SR_ERR;
 		}
-		read_response(acq);
-		break;
+		return read_response(acq);
 	default:
 		sr_err("BUG: unhandled response state %d.", devc->state);
 		return SR_ERR_BUG;
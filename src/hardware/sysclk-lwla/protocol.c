@@ -172,7 +172,6 @@ static void handle_length_response(const struct sr_dev_inst *sdi)
 	acq->run_len = 0;
 	acq->samples_done = 0;
 	acq->mem_addr_done = acq->mem_addr_next;
-	acq->out_index = 0;
 
 	if (acq->mem_addr_next >= acq->mem_addr_stop) {
 		submit_request(sdi, STATE_READ_FINISH);
@@ -189,55 +188,43 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 	unsigned int end_addr;
 
 	devc = sdi->priv;
 	acq = devc->acquisition;
 
-	/* Prepare session packet. */
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.unitsize = (devc->model->num_channels + 7) / 8;
-	logic.data = acq->out_packet;
-
 	end_addr = MIN(acq->mem_addr_next, acq->mem_addr_stop);
 	acq->in_index = 0;
 
 	/*
-	 * Repeatedly call the model-specific read response handler until
-	 * all data received in the transfer has been accounted for.
+	 * The model-specific read response handler decodes all data
+	 * received in the transfer (up to the sample limit) in one go,
+	 * and queues the samples for the session feed. A run which may
+	 * continue in the next transfer is kept pending.
 	 */
-	while (!devc->cancel_requested
-			&& (acq->run_len > 0 || acq->mem_addr_done < end_addr)
-			&& acq->samples_done < acq->samples_max) {
-
+	if (!devc->cancel_requested && acq->mem_addr_done < end_addr
+			&& !lwla_samples_complete(acq)) {
 		if ((*devc->model->handle_response)(sdi) != SR_OK) {
 			devc->transfer_error = TRUE;
 			return;
 		}
-		if (acq->out_index * logic.unitsize >= PACKET_SIZE) {
-			/* Send off full logic packet. */
-			logic.length = acq->out_index * logic.unitsize;
-			sr_session_send(sdi, &packet);
-			acq->out_index = 0;
-		}
 	}
 
 	if (!devc->cancel_requested
-			&& acq->samples_done < acq->samples_max
+			&& !lwla_samples_complete(acq)
 			&& acq->mem_addr_next < acq->mem_addr_stop) {
 		/* Request the next block. */
 		submit_request(sdi, STATE_READ_REQUEST);
 		return;
 	}
 
-	/* Send partially filled packet as it is the last one. */
-	if (!devc->cancel_requested && acq->out_index > 0) {
- 		logic.length = acq->out_index * logic.unitsize;
-		sr_session_send(sdi, &packet);
-		acq->out_index = 0;
+	/* Send the last run and the partially filled packet. */
+	if (!devc->cancel_requested) {
+		if (lwla_queue_run(acq) != SR_OK
+				|| feed_queue_logic_flush(acq->feed_queue) != SR_OK) {
+			devc->transfer_error = TRUE;
+			return;
+		}
 	}
 	submit_request(sdi, STATE_READ_FINISH);
 }
@@ -254,6 +241,7 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 	devc->acquisition = NULL;
 
 	if (acq) {
+		feed_queue_logic_free(acq->feed_queue);
 		libusb_free_transfer(acq->xfer_out);
 		libusb_free_transfer(acq->xfer_in);
 		g_free(acq);
@@ -265,7 +253,7 @@ static int transfer_event(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
 	struct timeval tv;
 	int ret;
 
@@ -273,16 +261,15 @@ static int transfer_event(int fd, int revents, void *cb_data)
 
 	sdi = cb_data;
 	devc = sdi->priv;
-	drvc = sdi->driver->context;
+	usb = sdi->conn;
 
-	if (!devc || !drvc)
+	if (!devc || !usb)
 		return G_SOURCE_REMOVE;
 
 	/* Handle pending USB events without blocking. */
 	tv.tv_sec = 0;
 	tv.tv_usec = 0;
-	ret = libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
-						     &tv, NULL);
+	ret = libusb_handle_events_timeout_completed(usb->usb_ctx, &tv, NULL);
 	if (ret != 0) {
 		sr_err("Event handling failed: %s.", libusb_error_name(ret));
 		devc->transfer_error = TRUE;
@@ -442,6 +429,7 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct acquisition_state *acq;
+	unsigned int unit_size;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -459,14 +447,25 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 	if (!acq)
 		return SR_ERR_MALLOC;
 
+	unit_size = (devc->model->num_channels + 7) / 8;
+	acq->feed_queue = feed_queue_logic_alloc(sdi,
+			PACKET_SIZE / unit_size, unit_size);
+	if (!acq->feed_queue) {
+		g_free(acq);
+		return SR_ERR_MALLOC;
+	}
+	feed_queue_logic_runs(acq->feed_queue, MIN_RUN_SAMPLES);
+
 	acq->xfer_in = libusb_alloc_transfer(0);
 	if (!acq->xfer_in) {
+		feed_queue_logic_free(acq->feed_queue);
 		g_free(acq);
 		return SR_ERR_MALLOC;
 	}
 	acq->xfer_out = libusb_alloc_transfer(0);
 	if (!acq->xfer_out) {
 		libusb_free_transfer(acq->xfer_in);
+		feed_queue_logic_free(acq->feed_queue);
 		g_free(acq);
 		return SR_ERR_MALLOC;
 	}
@@ -526,13 +525,13 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 
 SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 {
-	struct drv_context *drvc;
 	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
 	int ret;
 	const int poll_interval_ms = 100;
 
-	drvc = sdi->driver->context;
 	devc = sdi->priv;
+	usb = sdi->conn;
 
 	if (devc->state != STATE_IDLE) {
 		sr_err("Not in idle state, cannot start acquisition.");
@@ -552,8 +551,8 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 		return ret;
 	}
 	/* Register event source for asynchronous USB I/O. */
-	ret = usb_source_add(sdi->session, drvc->sr_ctx, poll_interval_ms,
-			     &transfer_event, (struct sr_dev_inst *)sdi);
+	ret = usb_context_source_add(sdi->session, usb->usb_ctx,
+			poll_interval_ms, &transfer_event, (struct sr_dev_inst *)sdi);
 	if (ret != SR_OK) {
 		clear_acquisition_state(sdi);
 		return ret;
@@ -564,7 +563,7 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 		ret = std_session_send_df_header(sdi);
 
 	if (ret != SR_OK) {
-		usb_source_remove(sdi->session, drvc->sr_ctx);
+		usb_context_source_remove(sdi->session, usb->usb_ctx);
 		clear_acquisition_state(sdi);
 	}
 
@@ -1726,6 +1726,105 @@ static int consume_str(char *buff, size_t sz, const uint8_t **p, size_t *l)
 	return SR_OK;
 }
 
+#if UT181A_WITH_TIMESTAMP
+/*
+ * Get the epoch for a recorded sample's timestamp. The conversion of the
+ * date and the hour is kept, samples of a recording mostly share them.
+ */
+static time_t ut181a_get_rec_epoch(struct dev_context *devc, uint32_t ts)
+{
+	uint32_t hour;
+
+	hour = ts & 0xfffff;
+	if (!devc->stamp_hour_epoch || hour != devc->stamp_hour) {
+		devc->stamp_hour = hour;
+		devc->stamp_hour_epoch = ut181a_get_epoch_for_timestamp(hour);
+	}
+
+	return devc->stamp_hour_epoch
+		+ ((ts >> 20) & 0x3f) * 60 + ((ts >> 26) & 0x3f);
+}
+#endif
+
+/*
+ * Feed a chunk of recorded samples to the session. Runs of samples with
+ * the same precision get sent in one packet each. The unit and scale
+ * were determined when the recording's information was received.
+ */
+static int ut181a_feed_rec_chunk(struct sr_dev_inst *sdi,
+	const uint8_t **payload, size_t *pl_dlen, size_t count)
+{
+	struct dev_context *devc;
+	const struct mq_scale_params *unit;
+	struct feed_buffer feedbuff;
+	uint8_t prec[UINT8_MAX];
+	float *values;
+	uint32_t stamp;
+	size_t idx, run;
+	int digits, ret;
+
+	devc = sdi->priv;
+	unit = &devc->info.rec_data.unit;
+	values = devc->rec_values;
+
+	/* Consume all received data, also when a limit was reached. */
+	for (idx = 0; idx < count; idx++) {
+		ret = SR_OK;
+		ret |= consume_flt(&values[idx], payload, pl_dlen);
+		ret |= consume_u8(&prec[idx], payload, pl_dlen);
+		ret |= consume_u32(&stamp, payload, pl_dlen);
+		if (ret != SR_OK)
+			return SR_ERR_DATA;
+		if (prec[idx] & (1 << 1))
+			values[idx] = -INFINITY;
+		else if (prec[idx] & (1 << 0))
+			values[idx] = +INFINITY;
+		else
+			values[idx] *= devc->info.rec_data.scale_factor;
+#if UT181A_WITH_TIMESTAMP
+		devc->rec_stamps[idx] = ut181a_get_rec_epoch(devc, stamp);
+#endif
+	}
+
+	count = sr_sw_limits_accept_samples(&devc->limits, count);
+	if (!count)
+		return SR_OK;
+
+	ut181a_feedbuff_initialize(&feedbuff);
+	ut181a_feedbuff_setup_channel(&feedbuff, UT181A_CH_MAIN, sdi);
+	feedbuff.analog.meaning->mq = unit->mq;
+	feedbuff.analog.meaning->mqflags = unit->mqflags;
+	feedbuff.analog.meaning->unit = unit->unit;
+	for (idx = 0; idx < count; idx += run) {
+		for (run = 1; idx + run < count; run++) {
+			if ((prec[idx + run] >> 4) != (prec[idx] >> 4))
+				break;
+		}
+		digits = ((prec[idx] >> 4) & 0x0f) - unit->scale;
+		feedbuff.analog.encoding->digits = digits;
+		feedbuff.analog.spec->spec_digits = digits;
+		feedbuff.analog.data = &values[idx];
+		feedbuff.analog.num_samples = run;
+		ret = sr_session_send(sdi, &feedbuff.packet);
+		if (ret != SR_OK)
+			break;
+	}
+#if UT181A_WITH_TIMESTAMP
+	if (ret == SR_OK) {
+		ut181a_feedbuff_setup_channel(&feedbuff, UT181A_CH_TIME, sdi);
+		ut181a_feedbuff_setup_unit(&feedbuff, "timestamp");
+		feedbuff.analog.encoding->digits = 0;
+		feedbuff.analog.spec->spec_digits = 0;
+		feedbuff.analog.data = devc->rec_stamps;
+		feedbuff.analog.num_samples = count;
+		ret = sr_session_send(sdi, &feedbuff.packet);
+	}
+#endif
+	ut181a_feedbuff_cleanup(&feedbuff);
+
+	return ret;
+}
+
 /* Process a DMM packet (a frame in the serial protocol). */
 static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 {
@@ -2528,6 +2627,11 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		snprintf(devc->last_data.unit_text,
 			sizeof(devc->last_data.unit_text),
 			"%s", unit_text);
+		ret = ut181a_get_mq_details_from_text(&info->rec_data.unit,
+			unit_text);
+		if (ret != SR_OK)
+			return SR_ERR_DATA;
+		info->rec_data.scale_factor = pow(10, info->rec_data.unit.scale);
 
 		/*
 		 * Optionally automatically forward the sample interval
@@ -2549,9 +2653,6 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			break;
 		if (!devc || devc->disable_feed || !info)
 			break;
-		ret = ut181a_feedbuff_initialize(&feedbuff);
-		ret = ut181a_feedbuff_setup_channel(&feedbuff, UT181A_CH_MAIN, sdi);
-		ret = ut181a_feedbuff_setup_unit(&feedbuff, devc->last_data.unit_text);
 
 		/*
 		 * Record data:
@@ -2560,43 +2661,24 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		 *   - f32 value
 		 *   - u8 precision
 		 *   - u32 timestamp
+		 *
+		 * Request the next chunk before this one gets processed,
+		 * the meter prepares its response meanwhile.
 		 */
 		ret = consume_u8(&info->rec_data.samples_chunk, &payload, &pl_dlen);
 		if (ret != SR_OK)
 			return SR_ERR_DATA;
 		info->rec_data.samples_curr += info->rec_data.samples_chunk;
-		while (info->rec_data.samples_chunk--) {
-			/*
-			 * Implementation detail: Consume all received
-			 * data, yet skip processing when a limit was
-			 * reached and previously terminated acquisition.
-			 */
-			ret = SR_OK;
-			ret |= consume_flt(&vf, &payload, &pl_dlen);
-			ret |= consume_u8(&v8, &payload, &pl_dlen);
-			ret |= consume_u32(&v32, &payload, &pl_dlen);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
-
-			if (sdi->status != SR_ST_ACTIVE)
-				continue;
-
-			ret = ut181a_feedbuff_start_frame(sdi);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
-
-			ret = SR_OK;
-			ret |= ut181a_get_value_params(&value, vf, v8);
-			ret |= ut181a_feedbuff_setup_value(&feedbuff, &value);
-			ret |= ut181a_feedbuff_send_feed(&feedbuff, sdi, 1);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
-
-			ret = ut181a_feedbuff_count_frame(sdi);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
+		if (info->rec_data.samples_curr < info->rec_data.samples_total) {
+			ret = ut181a_send_cmd_get_rec_samples(sdi->conn,
+				info->rec_data.rec_idx, info->rec_data.samples_curr);
+			if (ret < 0)
+				ut181a_cond_stop_acquisition(sdi);
 		}
-		ret = ut181a_feedbuff_cleanup(&feedbuff);
+		ret = ut181a_feed_rec_chunk(sdi, &payload, &pl_dlen,
+			info->rec_data.samples_chunk);
+		if (ret != SR_OK)
+			return ret;
 		break;
 
 	case RSP_TYPE_REPLY_DATA:
@@ -2670,17 +2752,10 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			if (!info)
 				break;
 			/*
-			 * The sample count was incremented above during
-			 * reception, because of variable length chunks
-			 * of sample data.
+			 * The next chunk was requested during reception
+			 * above. Stop after the last chunk.
 			 */
-			if (info->rec_data.samples_curr >= info->rec_data.samples_total) {
-				ut181a_cond_stop_acquisition(sdi);
-				break;
-			}
-			ret = ut181a_send_cmd_get_rec_samples(serial,
-				info->rec_data.rec_idx, info->rec_data.samples_curr);
-			if (ret < 0)
+			if (info->rec_data.samples_curr >= info->rec_data.samples_total)
 				ut181a_cond_stop_acquisition(sdi);
 			break;
 		default:
@@ -356,6 +356,9 @@ struct ut181a_info {
 		size_t samples_total;
 		size_t samples_curr;
 		uint8_t samples_chunk;
+		/* The recording's unit, parsed once from the record info. */
+		struct mq_scale_params unit;
+		float scale_factor;
 	} rec_data;
 	struct {
 		enum ut181_cmd_code code;
@@ -384,6 +387,14 @@ struct dev_context {
 	uint8_t recv_buff[RECV_BUFF_SIZE];
 	size_t recv_count;
 
+	/* Decoded samples of a recording's data chunk. */
+	float rec_values[UINT8_MAX];
+#if UT181A_WITH_TIMESTAMP
+	float rec_stamps[UINT8_MAX];
+	uint32_t stamp_hour;
+	time_t stamp_hour_epoch;
+#endif
+
 	/* Meter's internal state tracking. */
 	int disable_feed;
 	gboolean frame_started;
@@ -126,6 +126,7 @@ static void clear_helper(struct dev_context *devc)
 	dlm_scope_state_destroy(devc->model_state);
 	g_free(devc->analog_groups);
 	g_free(devc->digital_groups);
+	g_free(devc->block_buffer);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
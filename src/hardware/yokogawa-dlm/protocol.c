@@ -856,55 +856,25 @@ SR_PRIV int dlm_channel_data_request(const struct sr_dev_inst *sdi)
 }
 
 /**
- * Reads and removes the block data header from a given data input.
- * Format is #ndddd... with n being the number of decimal digits d.
- * The string dddd... contains the decimal-encoded length of the data.
- * Example: #9000000013 would yield a length of 13 bytes.
- *
- * @param data The input data.
- * @param len The determined input data length.
- */
-static int dlm_block_data_header_process(GArray *data, int *len)
-{
-	int i, n;
-	gchar s[20];
-
-	if (g_array_index(data, gchar, 0) != '#')
-		return SR_ERR;
-
-	n = (uint8_t)(g_array_index(data, gchar, 1) - '0');
-
-	for (i = 0; i < n; i++)
-		s[i] = g_array_index(data, gchar, 2 + i);
-	s[i] = 0;
-
-	if (sr_atoi(s, len) != SR_OK)
-		return SR_ERR;
-
-	g_array_remove_range(data, 0, 2 + n);
-
-	return SR_OK;
-}
-
-/**
- * Turns raw sample data into voltages and sends them off to the session bus.
+ * Sends the raw analog samples off to the session bus, in their native
+ * encoding. The encoding's scale and offset turn them into voltages
+ * according to page 269 of the Communication Interface User's Manual.
  *
  * @param data The raw sample data.
+ * @param len The number of bytes received.
+ * @ch The channel whose data we're processing.
  * @ch_state Pointer to the state of the channel whose data we're processing.
  * @sdi The device instance.
  *
  * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_analog_samples_send(GArray *data,
-		struct analog_channel_state *ch_state,
+static int dlm_analog_samples_send(const uint8_t *data, size_t len,
+		struct sr_channel *ch, struct analog_channel_state *ch_state,
 		struct sr_dev_inst *sdi)
 {
-	uint32_t i, samples;
-	float voltage, range, offset;
-	GArray *float_data;
+	uint32_t samples;
 	struct dev_context *devc;
 	struct scope_state *model_state;
-	struct sr_channel *ch;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
@@ -914,33 +884,29 @@ static int dlm_analog_samples_send(GArray *data,
 	devc = sdi->priv;
 	model_state = devc->model_state;
 	samples = model_state->samples_per_frame;
-	ch = devc->current_channel->data;
 
-	if (data->len < samples * sizeof(uint8_t)) {
+	if (len < samples * sizeof(int8_t)) {
 		sr_err("Truncated waveform data packet received.");
 		return SR_ERR;
 	}
 
-	range = ch_state->waveform_range;
-	offset = ch_state->waveform_offset;
-
-	/*
-	 * Convert byte sample to voltage according to
-	 * page 269 of the Communication Interface User's Manual.
-	 */
-	float_data = g_array_new(FALSE, FALSE, sizeof(float));
-	for (i = 0; i < samples; i++) {
-		voltage = (float)g_array_index(data, int8_t, i);
-		voltage = (range * voltage /
-				DLM_DIVISION_FOR_BYTE_FORMAT) + offset;
-		g_array_append_val(float_data, voltage);
-	}
-
 	/* TODO: Use proper 'digits' value for this device (and its modes). */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	encoding.unitsize = sizeof(int8_t);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	/*
+	 * Voltage = range * sample / DLM_DIVISION_FOR_BYTE_FORMAT + offset,
+	 * with the division being 12.5. Range and offset are floats, take
+	 * them at microvolt resolution.
+	 */
+	sr_rational_set(&encoding.scale,
+		llroundf(ch_state->waveform_range * 1e6) * 2, 25 * 1000000);
+	sr_rational_set(&encoding.offset,
+		llroundf(ch_state->waveform_offset * 1e6), 1000000);
 	analog.meaning->channels = g_slist_append(NULL, ch);
-	analog.num_samples = float_data->len;
-	analog.data = (float*)float_data->data;
+	analog.num_samples = samples;
+	analog.data = (void *)data;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
@@ -949,9 +915,6 @@ static int dlm_analog_samples_send(GArray *data,
 	sr_session_send(sdi, &packet);
 	g_slist_free(analog.meaning->channels);
 
-	g_array_free(float_data, TRUE);
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
-
 	return SR_OK;
 }
 
@@ -959,12 +922,12 @@ static int dlm_analog_samples_send(GArray *data,
  * Sends logic sample data off to the session bus.
  *
  * @param data The raw sample data.
- * @ch_state Pointer to the state of the channel whose data we're processing.
+ * @param len The number of bytes received.
  * @sdi The device instance.
  *
  * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_digital_samples_send(GArray *data,
+static int dlm_digital_samples_send(const uint8_t *data, size_t len,
 		struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -977,20 +940,18 @@ static int dlm_digital_samples_send(GArray *data,
 	model_state = devc->model_state;
 	samples = model_state->samples_per_frame;
 
-	if (data->len < samples * sizeof(uint8_t)) {
+	if (len < samples * sizeof(uint8_t)) {
 		sr_err("Truncated waveform data packet received.");
 		return SR_ERR;
 	}
 
 	logic.length = samples;
 	logic.unitsize = 1;
-	logic.data = data->data;
+	logic.data = (void *)data;
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	sr_session_send(sdi, &packet);
 
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
-
 	return SR_OK;
 }
 
@@ -1011,8 +972,9 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	struct scope_state *model_state;
 	struct dev_context *devc;
 	struct sr_channel *ch;
-	int chunk_len, num_bytes;
-	static GArray *data = NULL;
+	size_t len;
+	gboolean last_channel;
+	char eol[8];
 
 	(void)fd;
 	(void)revents;
@@ -1030,28 +992,27 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	if (!devc->data_pending)
 		return TRUE;
 
-	/* Check if a new query response is coming our way. */
-	if (!data) {
-		if (sr_scpi_read_begin(sdi->conn) == SR_OK)
-			/* The 16 here accounts for the header and EOL. */
-			data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t),
-					16 + model_state->samples_per_frame);
-		else
-			return TRUE;
+	/*
+	 * Both formats have one byte per sample. The block gets read
+	 * into the device's buffer which is kept across acquisitions.
+	 */
+	if (devc->block_buffer_size < model_state->samples_per_frame) {
+		devc->block_buffer_size = model_state->samples_per_frame;
+		g_free(devc->block_buffer);
+		devc->block_buffer = g_malloc(devc->block_buffer_size);
 	}
 
-	/* Store incoming data. */
-	chunk_len = sr_scpi_read_data(sdi->conn, devc->receive_buffer,
-			RECEIVE_BUFFER_SIZE);
-	if (chunk_len < 0) {
-		sr_err("Error while reading data: %d", chunk_len);
-		goto fail;
+	/* The query was sent already, read its response. */
+	if (sr_scpi_get_block_into(sdi->conn, NULL, devc->block_buffer,
+			devc->block_buffer_size, &len) != SR_OK) {
+		sr_err("Error while reading waveform data.");
+		return FALSE;
+	}
+	/* Discard the EOL which follows the block. */
+	while (!sr_scpi_read_complete(sdi->conn)) {
+		if (sr_scpi_read_data(sdi->conn, eol, sizeof(eol)) < 0)
+			break;
 	}
-	g_array_append_vals(data, devc->receive_buffer, chunk_len);
-
-	/* Read the entire query response before processing. */
-	if (!sr_scpi_read_complete(sdi->conn))
-		return TRUE;
 
 	/* We finished reading and are no longer waiting for data. */
 	devc->data_pending = FALSE;
@@ -1060,47 +1021,50 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	if (devc->current_channel == devc->enabled_channels)
 		std_session_send_df_frame_begin(sdi);
 
-	if (dlm_block_data_header_process(data, &num_bytes) != SR_OK) {
-		sr_err("Encountered malformed block data header.");
-		goto fail;
-	}
-
-	if (num_bytes == 0) {
+	if (len == 0) {
 		sr_warn("Zero-length waveform data packet received. " \
 				"Live mode not supported yet, stopping " \
 				"acquisition and retrying.");
 		/* Don't care about return value here. */
 		dlm_acquisition_stop(sdi->conn);
-		g_array_free(data, TRUE);
 		dlm_channel_data_request(sdi);
 		return TRUE;
 	}
 
+	/*
+	 * Set the next enabled channel and request its data before the
+	 * samples of this one get sent, so that the device prepares the
+	 * next waveform in the meantime.
+	 */
 	ch = devc->current_channel->data;
+	last_channel = !devc->current_channel->next;
+	if (!last_channel) {
+		devc->current_channel = devc->current_channel->next;
+		if (dlm_channel_data_request(sdi) != SR_OK) {
+			sr_err("Failed to request acquisition data.");
+			return FALSE;
+		}
+	}
+
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		if (dlm_analog_samples_send(data,
+		if (dlm_analog_samples_send(devc->block_buffer, len, ch,
 				&model_state->analog_states[ch->index],
 				sdi) != SR_OK)
-			goto fail;
+			return FALSE;
 		break;
 	case SR_CHANNEL_LOGIC:
-		if (dlm_digital_samples_send(data, sdi) != SR_OK)
-			goto fail;
+		if (dlm_digital_samples_send(devc->block_buffer, len,
+				sdi) != SR_OK)
+			return FALSE;
 		break;
 	default:
 		sr_err("Invalid channel type encountered.");
 		break;
 	}
 
-	g_array_free(data, TRUE);
-	data = NULL;
-
-	/*
-	 * Signal the end of this frame if this was the last enabled channel
-	 * and set the next enabled channel. Then, request its data.
-	 */
-	if (!devc->current_channel->next) {
+	/* Signal the end of this frame if this was the last enabled channel. */
+	if (last_channel) {
 		std_session_send_df_frame_end(sdi);
 		devc->current_channel = devc->enabled_channels;
 
@@ -1109,22 +1073,7 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 		 * data so we're going to stop at this point.
 		 */
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	} else
-		devc->current_channel = devc->current_channel->next;
-
-	if (dlm_channel_data_request(sdi) != SR_OK) {
-		sr_err("Failed to request acquisition data.");
-		goto fail;
 	}
 
 	return TRUE;
-
-fail:
-	if (data) {
-		g_array_free(data, TRUE);
-		data = NULL;
-	}
-
-	return FALSE;
 }
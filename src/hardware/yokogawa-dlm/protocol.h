@@ -34,7 +34,6 @@
 
 #define MAX_INSTRUMENT_VERSIONS 8
 
-#define RECEIVE_BUFFER_SIZE 4096
 
 /* See Communication Interface User's Manual on p. 268 (:WAVeform:ALL:SEND?). */
 #define DLM_MAX_FRAME_LENGTH 12500
@@ -109,7 +108,9 @@ struct dev_context {
 
 	uint64_t frame_limit;
 
-	char receive_buffer[RECEIVE_BUFFER_SIZE];
+	/* Waveform blocks get read into this buffer. */
+	uint8_t *block_buffer;
+	size_t block_buffer_size;
 	gboolean data_pending;
 };
 
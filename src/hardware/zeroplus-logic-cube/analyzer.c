@@ -512,12 +512,13 @@ SR_PRIV int analyzer_add_triggers(const struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
-	if (!(trigger = sr_session_trigger_get(sdi->session)))
-		return SR_OK;
-
+	/* Don't keep the triggers of a previous run (or another device). */
 	memset(g_trigger_status, 0, sizeof(g_trigger_status));
 	g_trigger_edge = 0;
 
+	if (!(trigger = sr_session_trigger_get(sdi->session)))
+		return SR_OK;
+
 	for (l = trigger->stages; l; l = l->next) {
 		stage = l->data;
 		for (m = stage->matches; m; m = m->next) {
@@ -24,7 +24,6 @@
 #define USB_INTERFACE			0
 #define USB_CONFIGURATION		1
 #define NUM_TRIGGER_STAGES		4
-#define PACKET_SIZE			2048	/* ?? */
 
 //#define ZP_EXPERIMENTAL
 
@@ -191,7 +190,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 
 	/* Find all ZEROPLUS analyzers and add them to device list. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist); /* TODO: Errors. */
+	sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist); /* TODO: Errors. */
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -282,17 +281,18 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 static int dev_open(struct sr_dev_inst *sdi)
 {
-	struct sr_dev_driver *di = sdi->driver;
 	struct dev_context *devc;
-	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
 	int ret;
 
-	drvc = di->context;
 	usb = sdi->conn;
 	devc = sdi->priv;
 
-	ret = sr_usb_open(drvc->sr_ctx->libusb_ctx, usb);
+	/*
+	 * Use a libusb context of our own, so that the readout of several
+	 * devices in a session runs in parallel.
+	 */
+	ret = sr_usb_open_private(usb);
 	if (ret != SR_OK)
 		return ret;
 
@@ -300,6 +300,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	if (ret < 0) {
 		sr_err("Unable to set USB configuration %d: %s.",
 		       USB_CONFIGURATION, libusb_error_name(ret));
+		sr_usb_close(usb);
 		return SR_ERR;
 	}
 
@@ -307,6 +308,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 	if (ret != 0) {
 		sr_err("Unable to claim interface: %s.",
 		       libusb_error_name(ret));
+		sr_usb_close(usb);
 		return SR_ERR;
 	}
 
@@ -357,8 +359,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
 	libusb_reset_device(usb->devhdl);
-	libusb_close(usb->devhdl);
-	usb->devhdl = NULL;
+	sr_usb_close(usb);
 
 	return SR_OK;
 }
@@ -483,27 +484,23 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
+/*
+ * The analyzer code keeps a single set of register values, which all
+ * devices share. Load this device's settings before they get pushed,
+ * another device may have been configured in the meantime.
+ */
+static void load_settings(struct dev_context *devc)
+{
+	zp_set_samplerate(devc, devc->cur_samplerate);
+	analyzer_set_memory_size(devc->memory_size);
+	set_voltage_threshold(devc, devc->cur_threshold);
+	analyzer_set_ext_clock(devc->use_ext_clock, devc->ext_clock_edge);
+}
+
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	unsigned int samples_read;
-	int res;
-	unsigned int packet_num, n;
-	unsigned char *buf;
-	unsigned int status;
-	unsigned int stop_address;
-	unsigned int now_address;
-	unsigned int trigger_address;
-	unsigned int trigger_offset;
-	unsigned int triggerbar;
-	unsigned int ramsize_trigger;
-	unsigned int memory_size;
-	unsigned int valid_samples;
-	unsigned int discard;
-	int trigger_now;
 
 	devc = sdi->priv;
 
@@ -514,157 +511,20 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	usb = sdi->conn;
 
+	load_settings(devc);
 	set_triggerbar(devc);
 
 	/* Push configured settings to device. */
 	analyzer_configure(usb->devhdl);
 
 	analyzer_start(usb->devhdl);
-	sr_info("Waiting for data.");
-	analyzer_wait_data(usb->devhdl);
-
-	status = analyzer_read_status(usb->devhdl);
-	stop_address = analyzer_get_stop_address(usb->devhdl);
-	now_address = analyzer_get_now_address(usb->devhdl);
-	trigger_address = analyzer_get_trigger_address(usb->devhdl);
-
-	triggerbar = analyzer_get_triggerbar_address();
-	ramsize_trigger = analyzer_get_ramsize_trigger_address();
-
-	n = get_memory_size(devc->memory_size);
-	memory_size = n / 4;
-
-	sr_info("Status = 0x%x.", status);
-	sr_info("Stop address       = 0x%x.", stop_address);
-	sr_info("Now address        = 0x%x.", now_address);
-	sr_info("Trigger address    = 0x%x.", trigger_address);
-	sr_info("Triggerbar address = 0x%x.", triggerbar);
-	sr_info("Ramsize trigger    = 0x%x.", ramsize_trigger);
-	sr_info("Memory size        = 0x%x.", memory_size);
-
-	std_session_send_df_header(sdi);
-
-	/* Check for empty capture */
-	if ((status & STATUS_READY) && !stop_address) {
-		std_session_send_df_end(sdi);
-		return SR_OK;
-	}
-
-	buf = g_malloc(PACKET_SIZE);
-
-	/* Check if the trigger is in the samples we are throwing away */
-	trigger_now = now_address == trigger_address ||
-		((now_address + 1) % memory_size) == trigger_address;
-
-	/*
-	 * STATUS_READY doesn't clear until now_address advances past
-	 * addr 0, but for our logic, clear it in that case
-	 */
-	if (!now_address)
-		status &= ~STATUS_READY;
-
-	analyzer_read_start(usb->devhdl);
-
-	/* Calculate how much data to discard */
-	discard = 0;
-	if (status & STATUS_READY) {
-		/*
-		 * We haven't wrapped around, we need to throw away data from
-		 * our current position to the end of the buffer.
-		 * Additionally, the first two samples captured are always
-		 * bogus.
-		 */
-		discard += memory_size - now_address + 2;
-		now_address = 2;
-	}
-
-	/* If we have more samples than we need, discard them */
-	valid_samples = (stop_address - now_address) % memory_size;
-	if (valid_samples > ramsize_trigger + triggerbar) {
-		discard += valid_samples - (ramsize_trigger + triggerbar);
-		now_address += valid_samples - (ramsize_trigger + triggerbar);
-	}
-
-	sr_info("Need to discard %d samples.", discard);
 
-	/* Calculate how far in the trigger is */
-	if (trigger_now)
-		trigger_offset = 0;
-	else
-		trigger_offset = (trigger_address - now_address) % memory_size;
-
-	/* Recalculate the number of samples available */
-	valid_samples = (stop_address - now_address) % memory_size;
-
-	/* Send the incoming transfer to the session bus. */
-	samples_read = 0;
-	for (packet_num = 0; packet_num < n / PACKET_SIZE; packet_num++) {
-		unsigned int len;
-		unsigned int buf_offset;
-
-		res = analyzer_read_data(usb->devhdl, buf, PACKET_SIZE);
-		if (res != PACKET_SIZE)
-			sr_warn("Tried to read %d bytes, actually read %d.",
-				PACKET_SIZE, res);
-
-		if (discard >= PACKET_SIZE / 4) {
-			discard -= PACKET_SIZE / 4;
-			continue;
-		}
-
-		len = PACKET_SIZE - discard * 4;
-		buf_offset = discard * 4;
-		discard = 0;
-
-		/* Check if we've read all the samples */
-		if (samples_read + len / 4 >= valid_samples)
-			len = (valid_samples - samples_read) * 4;
-		if (!len)
-			break;
-
-		if (samples_read < trigger_offset &&
-		    samples_read + len / 4 > trigger_offset) {
-			/* Send out samples remaining before trigger */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = (trigger_offset - samples_read) * 4;
-			logic.unitsize = 4;
-			logic.data = buf + buf_offset;
-			sr_session_send(sdi, &packet);
-			len -= logic.length;
-			samples_read += logic.length / 4;
-			buf_offset += logic.length;
-		}
-
-		if (samples_read == trigger_offset)
-			std_session_send_df_trigger(sdi);
-
-		/* Send out data (or data after trigger) */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = len;
-		logic.unitsize = 4;
-		logic.data = buf + buf_offset;
-		sr_session_send(sdi, &packet);
-		samples_read += len / 4;
-	}
-	analyzer_read_stop(usb->devhdl);
-	g_free(buf);
-
-	std_session_send_df_end(sdi);
-
-	return SR_OK;
+	return zp_start_acquisition(sdi);
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
-	struct sr_usb_dev_inst *usb;
-
-	std_session_send_df_end(sdi);
-
-	usb = sdi->conn;
-	analyzer_reset(usb->devhdl);
-	/* TODO: Need to cancel and free any queued up transfers. */
+	zp_abort_acquisition(sdi);
 
 	return SR_OK;
 }
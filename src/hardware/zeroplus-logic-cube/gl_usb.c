@@ -112,6 +112,37 @@ SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
 	return transferred;
 }
 
+/*
+ * Asynchronous variant of gl_read_bulk(), in two steps: The control
+ * transfer which requests the data, and the bulk transfer which gets
+ * submitted after the request has completed. The setup buffer of the
+ * request must hold GL_READ_BULK_SETUP_SIZE bytes.
+ */
+SR_PRIV void gl_fill_read_bulk_request(struct libusb_transfer *xfer,
+		libusb_device_handle *devh, unsigned char *setup,
+		unsigned int size, libusb_transfer_cb_fn cb, void *user_data)
+{
+	unsigned char *packet;
+
+	libusb_fill_control_setup(setup, CTRL_OUT, 0x4, REQ_READBULK, 0, 8);
+	packet = setup + LIBUSB_CONTROL_SETUP_SIZE;
+	packet[0] = packet[1] = packet[2] = packet[3] = 0;
+	packet[4] = size & 0xff;
+	packet[5] = (size & 0xff00) >> 8;
+	packet[6] = (size & 0xff0000) >> 16;
+	packet[7] = (size & 0xff000000) >> 24;
+	libusb_fill_control_transfer(xfer, devh, setup, cb, user_data,
+				     TIMEOUT_MS);
+}
+
+SR_PRIV void gl_fill_read_bulk(struct libusb_transfer *xfer,
+		libusb_device_handle *devh, void *buffer, unsigned int size,
+		libusb_transfer_cb_fn cb, void *user_data)
+{
+	libusb_fill_bulk_transfer(xfer, devh, EP1_BULK_IN, buffer, size,
+				  cb, user_data, TIMEOUT_MS);
+}
+
 SR_PRIV int gl_reg_write(libusb_device_handle *devh, unsigned int reg,
 		 unsigned int val)
 {
@@ -35,8 +35,16 @@
 #include <libusb.h>
 #include <libsigrok/libsigrok.h>
 
+#define GL_READ_BULK_SETUP_SIZE	(LIBUSB_CONTROL_SETUP_SIZE + 8)
+
 SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
 			 unsigned int size);
+SR_PRIV void gl_fill_read_bulk_request(struct libusb_transfer *xfer,
+		libusb_device_handle *devh, unsigned char *setup,
+		unsigned int size, libusb_transfer_cb_fn cb, void *user_data);
+SR_PRIV void gl_fill_read_bulk(struct libusb_transfer *xfer,
+		libusb_device_handle *devh, void *buffer, unsigned int size,
+		libusb_transfer_cb_fn cb, void *user_data);
 SR_PRIV int gl_reg_write(libusb_device_handle *devh, unsigned int reg,
 			 unsigned int val);
 SR_PRIV int gl_reg_read(libusb_device_handle *devh, unsigned int reg);
@@ -126,3 +126,371 @@ SR_PRIV void set_triggerbar(struct dev_context *devc)
 	sr_dbg("ramsize_triggerbar_address = %d(0x%x)",
 	       ramsize_trigger, ramsize_trigger);
 }
+
+static void LIBUSB_CALL read_request_done(struct libusb_transfer *xfer);
+static void LIBUSB_CALL read_data_done(struct libusb_transfer *xfer);
+
+/* Request the next packet, its data gets read when the request is done. */
+static int submit_read(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	gl_fill_read_bulk_request(devc->xfer_request, usb->devhdl,
+		devc->request_setup, PACKET_SIZE,
+		read_request_done, (void *)sdi);
+	ret = libusb_submit_transfer(devc->xfer_request);
+	if (ret != 0) {
+		sr_err("Failed to request data: %s.", libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static void LIBUSB_CALL read_request_done(struct libusb_transfer *xfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	int ret;
+
+	sdi = xfer->user_data;
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	if (devc->acq_aborted) {
+		devc->acq_state = ACQ_DONE;
+		return;
+	}
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Data request failed (status %d).", xfer->status);
+		devc->acq_state = ACQ_DONE;
+		return;
+	}
+
+	gl_fill_read_bulk(devc->xfer_data, usb->devhdl, devc->buf,
+		PACKET_SIZE, read_data_done, (void *)sdi);
+	ret = libusb_submit_transfer(devc->xfer_data);
+	if (ret != 0) {
+		sr_err("Failed to read data: %s.", libusb_error_name(ret));
+		devc->acq_state = ACQ_DONE;
+	}
+}
+
+/*
+ * Send the valid samples of a packet to the session bus. Returns TRUE
+ * after all samples of the capture have been sent.
+ */
+static gboolean send_packet(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	unsigned int len, buf_offset;
+
+	devc = sdi->priv;
+
+	if (devc->discard >= PACKET_SIZE / 4) {
+		devc->discard -= PACKET_SIZE / 4;
+		return FALSE;
+	}
+
+	len = PACKET_SIZE - devc->discard * 4;
+	buf_offset = devc->discard * 4;
+	devc->discard = 0;
+
+	/* Check if we've read all the samples */
+	if (devc->samples_read + len / 4 >= devc->valid_samples)
+		len = (devc->valid_samples - devc->samples_read) * 4;
+	if (!len)
+		return TRUE;
+
+	if (devc->samples_read < devc->trigger_offset &&
+	    devc->samples_read + len / 4 > devc->trigger_offset) {
+		/* Send out samples remaining before trigger */
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = (devc->trigger_offset - devc->samples_read) * 4;
+		logic.unitsize = 4;
+		logic.data = devc->buf + buf_offset;
+		sr_session_send(sdi, &packet);
+		len -= logic.length;
+		devc->samples_read += logic.length / 4;
+		buf_offset += logic.length;
+	}
+
+	if (devc->samples_read == devc->trigger_offset)
+		std_session_send_df_trigger(sdi);
+
+	/* Send out data (or data after trigger) */
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = len;
+	logic.unitsize = 4;
+	logic.data = devc->buf + buf_offset;
+	sr_session_send(sdi, &packet);
+	devc->samples_read += len / 4;
+
+	return devc->samples_read >= devc->valid_samples;
+}
+
+static void LIBUSB_CALL read_data_done(struct libusb_transfer *xfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = xfer->user_data;
+	devc = sdi->priv;
+
+	if (devc->acq_aborted) {
+		devc->acq_state = ACQ_DONE;
+		return;
+	}
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Data transfer failed (status %d).", xfer->status);
+		devc->acq_state = ACQ_DONE;
+		return;
+	}
+	if (xfer->actual_length != PACKET_SIZE)
+		sr_warn("Tried to read %d bytes, actually read %d.",
+			PACKET_SIZE, xfer->actual_length);
+
+	if (send_packet(sdi) || --devc->packets_left == 0) {
+		devc->acq_state = ACQ_DONE;
+		return;
+	}
+
+	if (submit_read(sdi) != SR_OK)
+		devc->acq_state = ACQ_DONE;
+}
+
+/*
+ * The capture has completed. Determine which part of the device's
+ * memory holds the samples of interest, and start to read them.
+ */
+static int start_readout(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	unsigned int status;
+	unsigned int stop_address;
+	unsigned int now_address;
+	unsigned int trigger_address;
+	unsigned int triggerbar;
+	unsigned int ramsize_trigger;
+	unsigned int memory_size;
+	unsigned int n;
+	int trigger_now;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	status = analyzer_read_status(usb->devhdl);
+	stop_address = analyzer_get_stop_address(usb->devhdl);
+	now_address = analyzer_get_now_address(usb->devhdl);
+	trigger_address = analyzer_get_trigger_address(usb->devhdl);
+
+	triggerbar = analyzer_get_triggerbar_address();
+	ramsize_trigger = analyzer_get_ramsize_trigger_address();
+
+	n = get_memory_size(devc->memory_size);
+	memory_size = n / 4;
+
+	sr_info("Status = 0x%x.", status);
+	sr_info("Stop address       = 0x%x.", stop_address);
+	sr_info("Now address        = 0x%x.", now_address);
+	sr_info("Trigger address    = 0x%x.", trigger_address);
+	sr_info("Triggerbar address = 0x%x.", triggerbar);
+	sr_info("Ramsize trigger    = 0x%x.", ramsize_trigger);
+	sr_info("Memory size        = 0x%x.", memory_size);
+
+	/* Check for empty capture */
+	if ((status & STATUS_READY) && !stop_address) {
+		devc->acq_state = ACQ_DONE;
+		return SR_OK;
+	}
+
+	/* Check if the trigger is in the samples we are throwing away */
+	trigger_now = now_address == trigger_address ||
+		((now_address + 1) % memory_size) == trigger_address;
+
+	/*
+	 * STATUS_READY doesn't clear until now_address advances past
+	 * addr 0, but for our logic, clear it in that case
+	 */
+	if (!now_address)
+		status &= ~STATUS_READY;
+
+	analyzer_read_start(usb->devhdl);
+	devc->read_started = TRUE;
+
+	/* Calculate how much data to discard */
+	devc->discard = 0;
+	if (status & STATUS_READY) {
+		/*
+		 * We haven't wrapped around, we need to throw away data from
+		 * our current position to the end of the buffer.
+		 * Additionally, the first two samples captured are always
+		 * bogus.
+		 */
+		devc->discard += memory_size - now_address + 2;
+		now_address = 2;
+	}
+
+	/* If we have more samples than we need, discard them */
+	devc->valid_samples = (stop_address - now_address) % memory_size;
+	if (devc->valid_samples > ramsize_trigger + triggerbar) {
+		devc->discard += devc->valid_samples - (ramsize_trigger + triggerbar);
+		now_address += devc->valid_samples - (ramsize_trigger + triggerbar);
+	}
+
+	sr_info("Need to discard %d samples.", devc->discard);
+
+	/* Calculate how far in the trigger is */
+	if (trigger_now)
+		devc->trigger_offset = 0;
+	else
+		devc->trigger_offset = (trigger_address - now_address) % memory_size;
+
+	/* Recalculate the number of samples available */
+	devc->valid_samples = (stop_address - now_address) % memory_size;
+
+	devc->samples_read = 0;
+	devc->packets_left = n / PACKET_SIZE;
+	if (!devc->packets_left) {
+		devc->acq_state = ACQ_DONE;
+		return SR_OK;
+	}
+
+	devc->acq_state = ACQ_READ;
+
+	return submit_read(sdi);
+}
+
+static void acquisition_done(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	if (devc->read_started)
+		analyzer_read_stop(usb->devhdl);
+	if (devc->acq_aborted)
+		analyzer_reset(usb->devhdl);
+
+	libusb_free_transfer(devc->xfer_request);
+	libusb_free_transfer(devc->xfer_data);
+	devc->xfer_request = NULL;
+	devc->xfer_data = NULL;
+	g_free(devc->buf);
+	devc->buf = NULL;
+	devc->acq_state = ACQ_IDLE;
+
+	std_session_send_df_end(sdi);
+}
+
+/*
+ * USB event source of the device. Polls the status while the capture
+ * runs, and handles the events of the readout transfers. The device
+ * was opened in a libusb context of its own, so that several devices
+ * in a session get read out in parallel.
+ */
+static int receive_data(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct timeval tv;
+	int ret;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	ret = libusb_handle_events_timeout_completed(usb->usb_ctx, &tv, NULL);
+	if (ret != 0) {
+		sr_err("Event handling failed: %s.", libusb_error_name(ret));
+		zp_abort_acquisition(sdi);
+	}
+
+	if (devc->acq_state == ACQ_WAIT_DATA) {
+		if (devc->acq_aborted)
+			devc->acq_state = ACQ_DONE;
+		else if (!(analyzer_read_status(usb->devhdl) & STATUS_BUSY) &&
+				start_readout(sdi) != SR_OK)
+			devc->acq_state = ACQ_DONE;
+	}
+
+	if (devc->acq_state != ACQ_DONE)
+		return G_SOURCE_CONTINUE;
+
+	acquisition_done(sdi);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Wait for the capture, which was started already, without blocking
+ * the session loop, then read the samples with asynchronous transfers.
+ */
+SR_PRIV int zp_start_acquisition(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	int ret;
+	const int poll_interval_ms = 10;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	devc->acq_aborted = FALSE;
+	devc->read_started = FALSE;
+	devc->xfer_request = libusb_alloc_transfer(0);
+	devc->xfer_data = libusb_alloc_transfer(0);
+	devc->buf = g_malloc(PACKET_SIZE);
+	devc->acq_state = ACQ_WAIT_DATA;
+
+	ret = usb_context_source_add(sdi->session, usb->usb_ctx,
+			poll_interval_ms, receive_data, (void *)sdi);
+	if (ret != SR_OK) {
+		libusb_free_transfer(devc->xfer_request);
+		libusb_free_transfer(devc->xfer_data);
+		devc->xfer_request = NULL;
+		devc->xfer_data = NULL;
+		g_free(devc->buf);
+		devc->buf = NULL;
+		devc->acq_state = ACQ_IDLE;
+		return ret;
+	}
+
+	sr_info("Waiting for data.");
+
+	return std_session_send_df_header(sdi);
+}
+
+SR_PRIV void zp_abort_acquisition(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	devc->acq_aborted = TRUE;
+	if (devc->acq_state != ACQ_READ)
+		return;
+
+	/* The cancelled transfer's callback completes the abort. */
+	libusb_cancel_transfer(devc->xfer_request);
+	libusb_cancel_transfer(devc->xfer_data);
+}
@@ -26,14 +26,24 @@
 #include <libusb.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "gl_usb.h"
 
 #define LOG_PREFIX "zeroplus-logic-cube"
 
+#define PACKET_SIZE		2048	/* ?? */
+
 typedef enum {
 	LAPC_CLOCK_EDGE_RISING,
 	LAPC_CLOCK_EDGE_FALLING,
 } ext_clock_edge_t;
 
+enum zp_acq_state {
+	ACQ_IDLE,
+	ACQ_WAIT_DATA,	/* Capture is running, poll its status. */
+	ACQ_READ,	/* Readout transfers are in flight. */
+	ACQ_DONE,	/* Readout has completed or got aborted. */
+};
+
 struct zp_model;
 struct dev_context {
 	uint64_t cur_samplerate;
@@ -48,6 +58,20 @@ struct dev_context {
 	const struct zp_model *prof;
 	gboolean use_ext_clock;
 	ext_clock_edge_t ext_clock_edge;
+
+	/* Acquisition state. */
+	enum zp_acq_state acq_state;
+	gboolean acq_aborted;
+	gboolean read_started;
+	struct libusb_transfer *xfer_request;
+	struct libusb_transfer *xfer_data;
+	unsigned char request_setup[GL_READ_BULK_SETUP_SIZE];
+	unsigned char *buf;
+	unsigned int packets_left;
+	unsigned int discard;
+	unsigned int valid_samples;
+	unsigned int trigger_offset;
+	unsigned int samples_read;
 };
 
 SR_PRIV size_t get_memory_size(int type);
@@ -55,5 +79,7 @@ SR_PRIV int zp_set_samplerate(struct dev_context *devc, uint64_t samplerate);
 SR_PRIV int set_limit_samples(struct dev_context *devc, uint64_t samples);
 SR_PRIV int set_voltage_threshold(struct dev_context *devc, double thresh);
 SR_PRIV void set_triggerbar(struct dev_context *devc);
+SR_PRIV int zp_start_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV void zp_abort_acquisition(const struct sr_dev_inst *sdi);
 
 #endif
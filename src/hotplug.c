@@ -0,0 +1,484 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_LIBUSB_1_0
+#include <libusb.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "hotplug"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Incremental device discovery on hotplug events.
+ */
+
+/**
+ * @addtogroup grp_driver
+ *
+ * @{
+ */
+
+/* How long one iteration of the hotplug thread may wait for USB events. */
+#define HOTPLUG_WAIT_US		(100 * 1000)
+/* Serial ports have no portable change notification, they get polled. */
+#define SERIAL_POLL_US		(1000 * 1000)
+
+#ifdef HAVE_LIBUSB_1_0
+/* A USB device arrival or removal, queued by the libusb callback. */
+struct usb_event {
+	gboolean arrived;
+	uint8_t bus;
+	uint8_t address;
+	uint16_t vid;
+	uint16_t pid;
+};
+
+/* A device instance which was reported for a USB bus/address. */
+struct usb_device_record {
+	uint8_t bus;
+	uint8_t address;
+	struct sr_dev_inst *sdi;
+};
+#endif
+
+struct sr_hotplug {
+	struct sr_context *ctx;
+	sr_hotplug_callback cb;
+	void *cb_data;
+	GThread *thread;
+	gint quit;
+#ifdef HAVE_LIBUSB_1_0
+	/*
+	 * Hotplug events are taken from a private libusb context, so that
+	 * the hotplug thread never runs the transfer callbacks of devices
+	 * which are acquiring on the libsigrok context.
+	 */
+	libusb_context *usb_ctx;
+	libusb_hotplug_callback_handle usb_handle;
+	gboolean usb_registered;
+	GQueue usb_events;
+	/* VID:PID -> GSList of drivers which found devices for it. */
+	GHashTable *drivers_by_id;
+	GSList *usb_devices;
+#endif
+	GSList *serial_ports;
+	gint64 serial_poll_time;
+};
+
+static void emit(struct sr_hotplug *hotplug,
+	enum sr_hotplug_event_type type, struct sr_dev_inst *sdi,
+	const char *port)
+{
+	struct sr_hotplug_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.sdi = sdi;
+	event.port = port;
+	hotplug->cb(&event, hotplug->cb_data);
+}
+
+#ifdef HAVE_LIBUSB_1_0
+static int LIBUSB_CALL usb_hotplug_cb(libusb_context *usb_ctx,
+	libusb_device *dev, libusb_hotplug_event usb_event, void *user_data)
+{
+	struct sr_hotplug *hotplug;
+	struct libusb_device_descriptor des;
+	struct usb_event *event;
+
+	(void)usb_ctx;
+
+	hotplug = user_data;
+
+	/* Only queue the event, the scans must not run in here. */
+	event = g_malloc0(sizeof(*event));
+	event->arrived = usb_event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED;
+	event->bus = libusb_get_bus_number(dev);
+	event->address = libusb_get_device_address(dev);
+	if (libusb_get_device_descriptor(dev, &des) == 0) {
+		event->vid = des.idVendor;
+		event->pid = des.idProduct;
+	}
+	g_queue_push_tail(&hotplug->usb_events, event);
+
+	return 0;
+}
+
+/* Drivers which can be pointed at one specific USB device. */
+static gboolean driver_scans_usb(const struct sr_dev_driver *driver)
+{
+	GArray *scanopts;
+	gboolean has_conn, has_serialcomm;
+	guint i;
+
+	if (!driver->context)
+		return FALSE;
+	scanopts = sr_driver_scan_options_list(driver);
+	if (!scanopts)
+		return FALSE;
+	has_conn = has_serialcomm = FALSE;
+	for (i = 0; i < scanopts->len; i++) {
+		switch (g_array_index(scanopts, uint32_t, i)) {
+		case SR_CONF_CONN:
+			has_conn = TRUE;
+			break;
+		case SR_CONF_SERIALCOMM:
+			has_serialcomm = TRUE;
+			break;
+		}
+	}
+	g_array_free(scanopts, TRUE);
+
+	return has_conn && !has_serialcomm;
+}
+
+static void usb_device_added(struct sr_hotplug *hotplug,
+	const struct usb_event *event)
+{
+	struct sr_dev_driver **drivers;
+	struct usb_device_record *record;
+	struct sr_config *src;
+	GSList *candidates, *matched, *options, *devices, *l, *d;
+	gpointer id, known_drivers;
+	gboolean known;
+	char *conn;
+	size_t i;
+
+	id = GUINT_TO_POINTER(((guint)event->vid << 16) | event->pid);
+	known = g_hash_table_lookup_extended(hotplug->drivers_by_id, id,
+		NULL, &known_drivers);
+	if (known) {
+		candidates = g_slist_copy(known_drivers);
+	} else {
+		candidates = NULL;
+		drivers = sr_driver_list(hotplug->ctx);
+		for (i = 0; drivers && drivers[i]; i++) {
+			if (driver_scans_usb(drivers[i]))
+				candidates = g_slist_append(candidates, drivers[i]);
+		}
+	}
+	if (!candidates) {
+		sr_spew("No drivers to scan USB device %04x:%04x.",
+			event->vid, event->pid);
+		return;
+	}
+
+	conn = g_strdup_printf("%d.%d", event->bus, event->address);
+	src = sr_config_new(SR_CONF_CONN, g_variant_new_string(conn));
+	options = g_slist_append(NULL, src);
+	sr_dbg("Scanning %d driver(s) for USB device %04x:%04x on %s.",
+		g_slist_length(candidates), event->vid, event->pid, conn);
+
+	sr_usb_device_list_share(hotplug->ctx->libusb_ctx);
+	matched = NULL;
+	for (l = candidates; l; l = l->next) {
+		devices = sr_driver_scan(l->data, options);
+		if (!devices)
+			continue;
+		matched = g_slist_append(matched, l->data);
+		for (d = devices; d; d = d->next) {
+			record = g_malloc0(sizeof(*record));
+			record->bus = event->bus;
+			record->address = event->address;
+			record->sdi = d->data;
+			hotplug->usb_devices = g_slist_append(hotplug->usb_devices,
+				record);
+			emit(hotplug, SR_HOTPLUG_DEVICE_ADDED, d->data, NULL);
+		}
+		g_slist_free(devices);
+	}
+	sr_usb_device_list_unshare(hotplug->ctx->libusb_ctx);
+
+	/*
+	 * Remember which drivers claimed this VID:PID, so that the next
+	 * arrival of the same kind of device skips all the others. Devices
+	 * no driver claimed are remembered as well, and cost nothing later.
+	 */
+	if (known)
+		g_slist_free(matched);
+	else
+		g_hash_table_insert(hotplug->drivers_by_id, id, matched);
+
+	g_slist_free_full(options, (GDestroyNotify)sr_config_free);
+	g_slist_free(candidates);
+	g_free(conn);
+}
+
+static void usb_device_removed(struct sr_hotplug *hotplug,
+	const struct usb_event *event)
+{
+	struct usb_device_record *record;
+	GSList *l, *next;
+
+	for (l = hotplug->usb_devices; l; l = next) {
+		next = l->next;
+		record = l->data;
+		if (record->bus != event->bus || record->address != event->address)
+			continue;
+		emit(hotplug, SR_HOTPLUG_DEVICE_REMOVED, record->sdi, NULL);
+		hotplug->usb_devices = g_slist_delete_link(hotplug->usb_devices, l);
+		g_free(record);
+	}
+}
+
+static void usb_events_process(struct sr_hotplug *hotplug)
+{
+	struct timeval tv;
+	struct usb_event *event;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = HOTPLUG_WAIT_US;
+	libusb_handle_events_timeout_completed(hotplug->usb_ctx, &tv, NULL);
+
+	while ((event = g_queue_pop_head(&hotplug->usb_events))) {
+		if (event->arrived)
+			usb_device_added(hotplug, event);
+		else
+			usb_device_removed(hotplug, event);
+		g_free(event);
+	}
+}
+
+static int usb_hotplug_register(struct sr_hotplug *hotplug)
+{
+	int ret;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		sr_info("No USB hotplug support on this platform.");
+		return SR_OK;
+	}
+	ret = libusb_init(&hotplug->usb_ctx);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
+		return SR_ERR;
+	}
+	ret = libusb_hotplug_register_callback(hotplug->usb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+		LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, usb_hotplug_cb, hotplug,
+		&hotplug->usb_handle);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("Failed to register USB hotplug callback: %s.",
+			libusb_error_name(ret));
+		libusb_exit(hotplug->usb_ctx);
+		hotplug->usb_ctx = NULL;
+		return SR_ERR;
+	}
+	hotplug->usb_registered = TRUE;
+
+	return SR_OK;
+}
+
+static void usb_hotplug_deregister(struct sr_hotplug *hotplug)
+{
+	struct usb_event *event;
+
+	if (hotplug->usb_registered)
+		libusb_hotplug_deregister_callback(hotplug->usb_ctx,
+			hotplug->usb_handle);
+	if (hotplug->usb_ctx)
+		libusb_exit(hotplug->usb_ctx);
+	while ((event = g_queue_pop_head(&hotplug->usb_events)))
+		g_free(event);
+	g_hash_table_destroy(hotplug->drivers_by_id);
+	g_slist_free_full(hotplug->usb_devices, g_free);
+}
+#endif
+
+static GSList *serial_port_names(void)
+{
+	struct sr_serial_port *port;
+	GSList *ports, *names, *l;
+
+	names = NULL;
+	ports = sr_serial_list(NULL);
+	for (l = ports; l; l = l->next) {
+		port = l->data;
+		names = g_slist_prepend(names, g_strdup(port->name));
+	}
+	g_slist_free_full(ports, (GDestroyNotify)sr_serial_free);
+
+	return names;
+}
+
+static gboolean port_listed(GSList *names, const char *name)
+{
+	return g_slist_find_custom(names, name, (GCompareFunc)strcmp) != NULL;
+}
+
+static void serial_ports_poll(struct sr_hotplug *hotplug)
+{
+	GSList *names, *l;
+
+	names = serial_port_names();
+	for (l = hotplug->serial_ports; l; l = l->next) {
+		if (!port_listed(names, l->data))
+			emit(hotplug, SR_HOTPLUG_SERIAL_REMOVED, NULL, l->data);
+	}
+	for (l = names; l; l = l->next) {
+		if (!port_listed(hotplug->serial_ports, l->data))
+			emit(hotplug, SR_HOTPLUG_SERIAL_ADDED, NULL, l->data);
+	}
+	g_slist_free_full(hotplug->serial_ports, g_free);
+	hotplug->serial_ports = names;
+}
+
+static gpointer hotplug_thread(gpointer data)
+{
+	struct sr_hotplug *hotplug;
+	gint64 now;
+
+	hotplug = data;
+	while (!g_atomic_int_get(&hotplug->quit)) {
+#ifdef HAVE_LIBUSB_1_0
+		if (hotplug->usb_registered)
+			usb_events_process(hotplug);
+		else
+			g_usleep(HOTPLUG_WAIT_US);
+#else
+		g_usleep(HOTPLUG_WAIT_US);
+#endif
+		now = g_get_monotonic_time();
+		if (now >= hotplug->serial_poll_time) {
+			serial_ports_poll(hotplug);
+			hotplug->serial_poll_time = now + SERIAL_POLL_US;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Subscribe to device arrivals and removals.
+ *
+ * When a USB device is attached, only the initialized drivers which can
+ * scan for a specific USB device (those which accept SR_CONF_CONN, but
+ * not SR_CONF_SERIALCOMM) are asked to scan for it. Once a VID:PID was
+ * seen, later arrivals of the same VID:PID are only offered to the
+ * drivers which found a device for it the first time. Devices found
+ * this way are reported as SR_HOTPLUG_DEVICE_ADDED, and as
+ * SR_HOTPLUG_DEVICE_REMOVED once their USB device is detached. Removed
+ * devices stay in their driver's device list until sr_dev_clear().
+ *
+ * Serial ports appearing or disappearing are reported by port name, as
+ * SR_HOTPLUG_SERIAL_ADDED and SR_HOTPLUG_SERIAL_REMOVED. No driver is
+ * run on them, since there is no telling what's connected to a port.
+ *
+ * Devices and ports which are present when subscribing aren't reported,
+ * use sr_driver_scan() or sr_driver_scan_all() for those.
+ *
+ * The callback runs on a thread of the subscription. The application
+ * must not scan with any of the drivers concurrently.
+ *
+ * @param ctx The libsigrok context whose drivers should scan. Must not
+ *            be NULL.
+ * @param cb The function to call for each event. Must not be NULL.
+ * @param cb_data Opaque pointer passed to the callback.
+ * @param hotplug Pointer to store the subscription in. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_subscribe(struct sr_context *ctx,
+	sr_hotplug_callback cb, void *cb_data, struct sr_hotplug **hotplug)
+{
+	struct sr_hotplug *hp;
+	GError *error;
+
+	if (!ctx || !cb || !hotplug)
+		return SR_ERR_ARG;
+	if (sr_transports_init(ctx) != SR_OK)
+		return SR_ERR;
+
+	hp = g_malloc0(sizeof(*hp));
+	hp->ctx = ctx;
+	hp->cb = cb;
+	hp->cb_data = cb_data;
+#ifdef HAVE_LIBUSB_1_0
+	g_queue_init(&hp->usb_events);
+	hp->drivers_by_id = g_hash_table_new_full(g_direct_hash,
+		g_direct_equal, NULL, (GDestroyNotify)g_slist_free);
+	if (usb_hotplug_register(hp) != SR_OK) {
+		usb_hotplug_deregister(hp);
+		g_free(hp);
+		return SR_ERR;
+	}
+#endif
+	hp->serial_ports = serial_port_names();
+	hp->serial_poll_time = g_get_monotonic_time() + SERIAL_POLL_US;
+
+	error = NULL;
+	hp->thread = g_thread_try_new("sr-hotplug", hotplug_thread, hp, &error);
+	if (!hp->thread) {
+		sr_err("Cannot create hotplug thread: %s.", error->message);
+		g_error_free(error);
+#ifdef HAVE_LIBUSB_1_0
+		usb_hotplug_deregister(hp);
+#endif
+		g_slist_free_full(hp->serial_ports, g_free);
+		g_free(hp);
+		return SR_ERR;
+	}
+
+	*hotplug = hp;
+
+	return SR_OK;
+}
+
+/**
+ * End a subscription made with sr_hotplug_subscribe().
+ *
+ * No more callbacks happen once this returns. Must not be called from
+ * within the subscription's callback.
+ *
+ * @param hotplug The subscription. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_hotplug_unsubscribe(struct sr_hotplug *hotplug)
+{
+	if (!hotplug)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&hotplug->quit, 1);
+	g_thread_join(hotplug->thread);
+
+#ifdef HAVE_LIBUSB_1_0
+	usb_hotplug_deregister(hotplug);
+#endif
+	g_slist_free_full(hotplug->serial_ports, g_free);
+	g_free(hotplug);
+
+	return SR_OK;
+}
+
+/** @} */
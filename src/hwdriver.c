@@ -220,6 +220,16 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Over-current protection delay", NULL},
 	{SR_CONF_INVERTED, SR_T_BOOL, "inverted",
 		"Signal inverted", NULL},
+	{SR_CONF_TRANSFER_PROFILE, SR_T_STRING, "transfer_profile",
+		"Transfer profile", NULL},
+	{SR_CONF_MAX_THROUGHPUT, SR_T_BOOL, "max_throughput",
+		"Maximum throughput", NULL},
+	{SR_CONF_ANALOG_ENCODING, SR_T_STRING, "analog_encoding",
+		"Analog encoding", NULL},
+	{SR_CONF_BATCH_SAMPLES, SR_T_UINT64, "batch_samples",
+		"Readings per batch", NULL},
+	{SR_CONF_BATCH_MSEC, SR_T_UINT64, "batch_time",
+		"Batch time limit", NULL},
 
 	/* Special stuff */
 	{SR_CONF_SESSIONFILE, SR_T_STRING, "sessionfile",
@@ -236,6 +246,18 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_CAPTURE_START, SR_T_UINT64, "capture_start",
+		"Capture start sample", NULL},
+	{SR_CONF_CAPTURE_START_MSEC, SR_T_UINT64, "capture_start_time",
+		"Capture start time", NULL},
+	{SR_CONF_CAPTURE_READAHEAD, SR_T_UINT64, "capture_readahead",
+		"Capture read-ahead", NULL},
+	{SR_CONF_CAPTURE_SPEED, SR_T_FLOAT, "capture_speed",
+		"Capture playback speed", NULL},
+	{SR_CONF_CAPTURE_BULK, SR_T_BOOL, "capture_bulk",
+		"Capture bulk playback", NULL},
+	{SR_CONF_CAPTURE_CHUNKSIZE, SR_T_UINT64, "capture_chunksize",
+		"Capture playback chunk size", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -454,6 +476,9 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 
 	/* No log message here, too verbose and not very useful. */
 
+	if ((ret = sr_transports_init(ctx)) != SR_OK)
+		return ret;
+
 	if ((ret = driver->init(driver, ctx)) < 0)
 		sr_err("Failed to initialize the driver: %d.", ret);
 
@@ -592,6 +617,185 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/* Drivers which sr_driver_scan_all() scans concurrently. */
+#define SCAN_ALL_THREADS 8
+
+struct scan_all_job {
+	struct sr_dev_driver *driver;
+	GSList *devices;
+	/* Scanned by the chain of drivers which need exclusive access. */
+	gboolean exclusive;
+	struct scan_all_job *next_exclusive;
+};
+
+static void scan_all_job_run(gpointer data, gpointer user_data)
+{
+	struct scan_all_job *job;
+	GSList *options;
+
+	options = user_data;
+	for (job = data; job; job = job->next_exclusive)
+		job->devices = sr_driver_scan(job->driver, options);
+}
+
+/*
+ * Check whether the driver accepts all given scan options. Drivers
+ * which don't are skipped by sr_driver_scan_all(), instead of failing
+ * the way sr_driver_scan() does.
+ */
+static gboolean scan_options_supported(const GArray *scanopts,
+		GSList *options)
+{
+	const struct sr_config *src;
+	GSList *l;
+	guint i;
+
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		if (!scanopts)
+			return FALSE;
+		for (i = 0; i < scanopts->len; i++) {
+			if (g_array_index(scanopts, uint32_t, i) == src->key)
+				break;
+		}
+		if (i == scanopts->len)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Drivers which take a serial comm spec probe serial ports (SCPI
+ * drivers also USBTMC and network resources). Several of them may
+ * probe the same port, so they get scanned one after the other.
+ */
+static gboolean scan_needs_exclusive(const GArray *scanopts)
+{
+	guint i;
+
+	if (!scanopts)
+		return FALSE;
+	for (i = 0; i < scanopts->len; i++) {
+		if (g_array_index(scanopts, uint32_t, i) == SR_CONF_SERIALCOMM)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Have all initialized hardware drivers scan for devices, concurrently.
+ *
+ * This is equivalent to calling sr_driver_scan() for each of the drivers
+ * which sr_driver_init() was called for, but runs the scans on a pool of
+ * worker threads. Drivers which probe serial ports (those which accept
+ * SR_CONF_SERIALCOMM) are scanned one after the other, since they may
+ * compete for the same ports. The list of USB devices is enumerated once,
+ * and shared by all drivers' scans. Drivers which don't support all of
+ * the given options are skipped.
+ *
+ * @param ctx The libsigrok context whose drivers should scan. Must not
+ *            be NULL.
+ * @param options A list of 'struct sr_hwopt' options to pass to the drivers'
+ *                scanners. Can be NULL/empty.
+ *
+ * @return A GSList * of 'struct sr_dev_inst', or NULL if no devices were
+ *         found. The devices are in the order of sr_driver_list(). This
+ *         list must be freed by the caller using g_slist_free(), but
+ *         without freeing the data pointed to in the list.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_driver_scan_all(struct sr_context *ctx, GSList *options)
+{
+	struct sr_dev_driver **drivers;
+	struct scan_all_job *jobs, *job, *exclusive, **exclusive_tail;
+	GArray *scanopts;
+	GThreadPool *pool;
+	GError *error;
+	GSList *devices;
+	size_t num_drivers, num_jobs, i;
+
+	if (!ctx) {
+		sr_err("Invalid context, can't scan for devices.");
+		return NULL;
+	}
+
+	if (sr_transports_init(ctx) != SR_OK)
+		return NULL;
+
+	drivers = sr_driver_list(ctx);
+	for (num_drivers = 0; drivers && drivers[num_drivers]; num_drivers++)
+		;
+	jobs = g_new0(struct scan_all_job, num_drivers + 1);
+
+	/* Set up one job per driver, chain those that need exclusivity. */
+	num_jobs = 0;
+	exclusive = NULL;
+	exclusive_tail = &exclusive;
+	for (i = 0; i < num_drivers; i++) {
+		if (!drivers[i]->context)
+			continue;
+		scanopts = sr_driver_scan_options_list(drivers[i]);
+		if (scan_options_supported(scanopts, options)) {
+			job = &jobs[num_jobs++];
+			job->driver = drivers[i];
+			if (scan_needs_exclusive(scanopts)) {
+				job->exclusive = TRUE;
+				*exclusive_tail = job;
+				exclusive_tail = &job->next_exclusive;
+			}
+		} else {
+			sr_dbg("Skipping %s, unsupported scan options.",
+				drivers[i]->name);
+		}
+		if (scanopts)
+			g_array_free(scanopts, TRUE);
+	}
+
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_device_list_share(ctx->libusb_ctx);
+#endif
+
+	pool = NULL;
+	if (num_jobs > 1) {
+		error = NULL;
+		pool = g_thread_pool_new(scan_all_job_run, options,
+			MIN(num_jobs, SCAN_ALL_THREADS), TRUE, &error);
+		if (!pool) {
+			sr_warn("Cannot create scan threads: %s.", error->message);
+			g_error_free(error);
+		}
+	}
+	/* The head of the exclusive chain runs the chain. */
+	for (i = 0; i < num_jobs; i++) {
+		job = &jobs[i];
+		if (job->exclusive && job != exclusive)
+			continue;
+		if (pool)
+			g_thread_pool_push(pool, job, NULL);
+		else
+			scan_all_job_run(job, options);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+#ifdef HAVE_LIBUSB_1_0
+	sr_usb_device_list_unshare(ctx->libusb_ctx);
+#endif
+
+	devices = NULL;
+	for (i = 0; i < num_jobs; i++)
+		devices = g_slist_concat(devices, jobs[i].devices);
+	g_free(jobs);
+
+	sr_spew("Scan of all drivers found %d devices.",
+		g_slist_length(devices));
+
+	return devices;
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
@@ -707,6 +911,10 @@ static void log_key(const struct sr_dev_inst *sdi,
 	if (key == SR_CONF_DEVICE_OPTIONS)
 		return;
 
+	/* Printing the value is costly, and only useful at spew level. */
+	if (sr_log_loglevel_get() < SR_LOG_SPEW)
+		return;
+
 	opstr = op == SR_CONF_GET ? "get" : op == SR_CONF_SET ? "set" : "list";
 	srci = sr_key_info_get(SR_KEY_CONFIG, key);
 
@@ -1006,7 +1214,9 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 
 	if ((ret = driver->config_list(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_LIST, *data);
-		g_variant_ref_sink(*data);
+		/* Cached lists come with a reference of their own already. */
+		if (g_variant_is_floating(*data))
+			g_variant_ref_sink(*data);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -1038,6 +1248,75 @@ static struct sr_key_info *get_keytable(int keytype)
 	return table;
 }
 
+/*
+ * Config keys and MQs are numbered in blocks starting at multiples of
+ * 10000, which makes for small direct-indexed tables. Keys beyond the
+ * blocks (MQ flags are bits) are searched for in the table.
+ */
+#define KEY_BLOCK_SIZE 10000
+#define KEY_BLOCKS 8
+
+struct key_index {
+	const struct sr_key_info **blocks[KEY_BLOCKS];
+	uint32_t block_len[KEY_BLOCKS];
+	/* Key id string -> key info. */
+	GHashTable *ids;
+};
+
+static struct key_index key_indexes[SR_KEY_MQFLAGS + 1];
+
+static gpointer key_index_build(gpointer data)
+{
+	struct key_index *index;
+	const struct sr_key_info *table, *info;
+	uint32_t block, offset;
+	int keytype, i;
+
+	keytype = GPOINTER_TO_INT(data);
+	index = &key_indexes[keytype];
+	table = get_keytable(keytype);
+
+	for (i = 0; table[i].key; i++) {
+		block = table[i].key / KEY_BLOCK_SIZE;
+		offset = table[i].key % KEY_BLOCK_SIZE;
+		if (block < KEY_BLOCKS && offset >= index->block_len[block])
+			index->block_len[block] = offset + 1;
+	}
+	for (block = 0; block < KEY_BLOCKS; block++) {
+		if (index->block_len[block])
+			index->blocks[block] = g_new0(const struct sr_key_info *,
+				index->block_len[block]);
+	}
+
+	/* Like the table searches, the first entry of a key wins. */
+	index->ids = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0; table[i].key; i++) {
+		info = &table[i];
+		block = info->key / KEY_BLOCK_SIZE;
+		offset = info->key % KEY_BLOCK_SIZE;
+		if (block < KEY_BLOCKS && !index->blocks[block][offset])
+			index->blocks[block][offset] = info;
+		if (info->id && !g_hash_table_lookup(index->ids, info->id))
+			g_hash_table_insert(index->ids, (gpointer)info->id,
+				(gpointer)info);
+	}
+
+	return index;
+}
+
+static const struct key_index *get_key_index(int keytype)
+{
+	static GOnce once[SR_KEY_MQFLAGS + 1] = {
+		G_ONCE_INIT, G_ONCE_INIT, G_ONCE_INIT,
+	};
+
+	if (!get_keytable(keytype))
+		return NULL;
+
+	return g_once(&once[keytype], key_index_build,
+		GINT_TO_POINTER(keytype));
+}
+
 /**
  * Get information about a key, by key.
  *
@@ -1051,12 +1330,23 @@ static struct sr_key_info *get_keytable(int keytype)
  */
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
 {
+	const struct key_index *index;
 	struct sr_key_info *table;
+	uint32_t block, offset;
 	int i;
 
-	if (!(table = get_keytable(keytype)))
+	if (!(index = get_key_index(keytype)))
 		return NULL;
 
+	block = key / KEY_BLOCK_SIZE;
+	offset = key % KEY_BLOCK_SIZE;
+	if (block < KEY_BLOCKS) {
+		if (offset >= index->block_len[block])
+			return NULL;
+		return index->blocks[block][offset];
+	}
+
+	table = get_keytable(keytype);
 	for (i = 0; table[i].key; i++) {
 		if (table[i].key == key)
 			return &table[i];
@@ -1078,20 +1368,12 @@ SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key)
  */
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid)
 {
-	struct sr_key_info *table;
-	int i;
+	const struct key_index *index;
 
-	if (!(table = get_keytable(keytype)))
+	if (!(index = get_key_index(keytype)))
 		return NULL;
 
-	for (i = 0; table[i].key; i++) {
-		if (!table[i].id)
-			continue;
-		if (!strcmp(table[i].id, keyid))
-			return &table[i];
-	}
-
-	return NULL;
+	return g_hash_table_lookup(index->ids, keyid);
 }
 
 /** @} */
@@ -66,7 +66,12 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/*
+ * Send the whole samples in data, return the number of bytes consumed.
+ * The data resides in buf when that is not NULL.
+ */
+static gsize send_samples(struct sr_input *in, const uint8_t *data, gsize len,
+		struct sr_buffer *buf)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -91,36 +96,68 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = (void *)(data + i);
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
-		sr_session_send(in->sdi, &packet);
+		if (buf)
+			sr_session_send_buffer(in->sdi, &packet, buf);
+		else
+			sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
 
-	return SR_OK;
+	return chunk_size;
 }
 
-static int receive(struct sr_input *in, GString *buf)
+static int process_buffer(struct sr_input *in)
 {
-	int ret;
+	gsize sent;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	sent = send_samples(in, (const uint8_t *)in->buf->str, in->buf->len,
+		NULL);
+	g_string_erase(in->buf, 0, sent);
+
+	return SR_OK;
+}
+
+static int receive_data(struct sr_input *in, const uint8_t *data, size_t len)
+{
+	struct context *inc;
+	gsize fill, sent;
 
 	if (!in->sdi_ready) {
+		g_string_append_len(in->buf, (const char *)data, len);
 		/* sdi is ready, notify frontend. */
 		in->sdi_ready = TRUE;
 		return SR_OK;
 	}
 
-	ret = process_buffer(in);
+	/* Complete a sample which was left over from the previous call. */
+	inc = in->priv;
+	if (in->buf->len % inc->unitsize) {
+		fill = inc->unitsize - in->buf->len % inc->unitsize;
+		fill = MIN(fill, len);
+		g_string_append_len(in->buf, (const char *)data, fill);
+		data += fill;
+		len -= fill;
+	}
+	if (in->buf->len)
+		process_buffer(in);
+
+	/* Send straight from the caller's memory, keep the partial tail. */
+	sent = send_samples(in, data, len, in->data_buffer);
+	g_string_append_len(in->buf, (const char *)data + sent, len - sent);
 
-	return ret;
+	return SR_OK;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	return receive_data(in, (const uint8_t *)buf->str, buf->len);
 }
 
 static int end(struct sr_input *in)
@@ -150,6 +187,18 @@ static int reset(struct sr_input *in)
 	return SR_OK;
 }
 
+static int seek(struct sr_input *in, uint64_t sample,
+		uint64_t *offset, size_t *sample_size)
+{
+	struct context *inc = in->priv;
+
+	g_string_truncate(in->buf, 0);
+	*offset = sample * inc->unitsize;
+	*sample_size = inc->unitsize;
+
+	return SR_OK;
+}
+
 static struct sr_option options[] = {
 	{ "numchannels", "Number of logic channels", "The number of (logic) channels in the data", NULL, NULL },
 	{ "samplerate", "Sample rate (Hz)", "The sample rate of the (logic) data in Hz", NULL, NULL },
@@ -174,6 +223,8 @@ SR_PRIV struct sr_input_module input_binary = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_data = receive_data,
 	.end = end,
 	.reset = reset,
+	.seek = seek,
 };
@@ -81,6 +81,7 @@ struct context {
 	gboolean started;
 	uint64_t samplerate;
 	uint64_t samples_remain;
+	uint64_t start_sample;
 };
 
 static int format_match(GHashTable *metadata, unsigned int *confidence)
@@ -127,7 +128,8 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send the whole samples in data, return the number of bytes consumed. */
+static gsize send_samples(struct sr_input *in, const uint8_t *data, gsize len)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -149,6 +151,7 @@ static int process_buffer(struct sr_input *in)
 
 		inc->samples_remain = CHRONOVU_LA8_DATASIZE;
 		inc->samples_remain /= unitsize;
+		inc->samples_remain -= MIN(inc->start_sample, inc->samples_remain);
 
 		inc->started = TRUE;
 	}
@@ -158,11 +161,11 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = unitsize;
 
 	/* Cut off at multiple of unitsize. Avoid sending the "header". */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 	chunk_size = MIN(chunk_size, inc->samples_remain * unitsize);
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = (void *)(data + i);
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		if (chunk) {
 			logic.length = chunk;
@@ -170,26 +173,62 @@ static int process_buffer(struct sr_input *in)
 			inc->samples_remain -= chunk / unitsize;
 		}
 	}
-	g_string_erase(in->buf, 0, chunk_size);
 
-	return SR_OK;
+	return chunk_size;
 }
 
-static int receive(struct sr_input *in, GString *buf)
+static int process_buffer(struct sr_input *in)
 {
-	int ret;
+	gsize sent;
+
+	sent = send_samples(in, (const uint8_t *)in->buf->str, in->buf->len);
+	g_string_erase(in->buf, 0, sent);
+
+	return SR_OK;
+}
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+static int receive_data(struct sr_input *in, const uint8_t *data, size_t len)
+{
+	struct context *inc;
+	gsize fill, sent;
+	uint16_t unitsize;
 
 	if (!in->sdi_ready) {
+		g_string_append_len(in->buf, (const char *)data, len);
 		/* sdi is ready, notify frontend. */
 		in->sdi_ready = TRUE;
 		return SR_OK;
 	}
 
-	ret = process_buffer(in);
+	inc = in->priv;
+	unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
 
-	return ret;
+	/* Complete a sample which was left over from the previous call. */
+	if (in->buf->len % unitsize) {
+		fill = unitsize - in->buf->len % unitsize;
+		fill = MIN(fill, len);
+		g_string_append_len(in->buf, (const char *)data, fill);
+		data += fill;
+		len -= fill;
+	}
+	if (in->buf->len)
+		process_buffer(in);
+
+	/*
+	 * Send straight from the caller's memory. Anything past the
+	 * sample data is the trailing "header" and gets dropped, same
+	 * as process_buffer() would never send it.
+	 */
+	sent = send_samples(in, data, len);
+	if (inc->samples_remain)
+		g_string_append_len(in->buf, (const char *)data + sent, len - sent);
+
+	return SR_OK;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	return receive_data(in, (const uint8_t *)buf->str, buf->len);
 }
 
 static int end(struct sr_input *in)
@@ -214,7 +253,23 @@ static int reset(struct sr_input *in)
 	struct context *inc = in->priv;
 
 	inc->started = FALSE;
+	inc->start_sample = 0;
+	g_string_truncate(in->buf, 0);
+
+	return SR_OK;
+}
+
+static int seek(struct sr_input *in, uint64_t sample,
+		uint64_t *offset, size_t *sample_size)
+{
+	struct context *inc = in->priv;
+	uint16_t unitsize;
+
+	unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
 	g_string_truncate(in->buf, 0);
+	inc->start_sample = sample;
+	*offset = MIN(sample * unitsize, CHRONOVU_LA8_DATASIZE);
+	*sample_size = unitsize;
 
 	return SR_OK;
 }
@@ -245,6 +300,8 @@ SR_PRIV struct sr_input_module input_chronovu_la8 = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_data = receive_data,
 	.end = end,
 	.reset = reset,
+	.seek = seek,
 };
@@ -91,6 +91,10 @@
  *     up to the end of the current text line. Can be empty to disable
  *     comment support. Defaults to semicolon.
  *
+ * threads: Specifies the number of threads which parse text rows in
+ *     parallel. Rows get parsed in chunks and are sent in input order.
+ *     Defaults to 0, parsing in the caller's thread.
+ *
  * Typical examples of using these options:
  * - ... -I csv:column_formats=*l ...
  *   All columns are single-bit logic data. Identical to the previous
@@ -225,6 +229,18 @@ struct context {
 	const char *column_formats;
 	size_t column_want_count;
 	struct column_details *column_details;
+	char **columns;
+	size_t *column_lengths;
+
+	/* Parallel parsing of text rows. */
+	size_t threads;
+	struct csv_parallel {
+		GThreadPool *pool;
+		GMutex mutex;
+		GCond done_cond;
+		GQueue chunks;
+		int error;
+	} parallel;
 
 	/* Line number to start processing. */
 	size_t start_line;
@@ -772,10 +788,61 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/**
+ * Splits a text line into columns in place, without allocations.
+ *
+ * @param[in] buf	The input text line to split, gets modified.
+ * @param[in] inc	The input module's context.
+ * @param[out] columns	Receives pointers to the columns' text.
+ * @param[out] lengths	Receives the columns' text lengths.
+ * @param[in] count	The maximum number of columns to split off.
+ *
+ * @returns The number of columns found, at most count.
+ *
+ * NUL terminates the columns within the caller's text and drops their
+ * trailing whitespace, like split_line() does. Text after the last
+ * requested column is not inspected. Single character separators (the
+ * common case) are searched for with memchr().
+ */
+static size_t split_columns(char *buf, struct context *inc,
+	char **columns, size_t *lengths, size_t count)
+{
+	const char *delim;
+	size_t delim_len, idx, len, line_len;
+	char *end, *next;
+
+	delim = inc->delimiter->str;
+	delim_len = inc->delimiter->len;
+	line_len = strlen(buf);
+	for (idx = 0; idx < count && buf; idx++) {
+		if (delim_len == 1)
+			end = memchr(buf, delim[0], line_len);
+		else
+			end = strstr(buf, delim);
+		if (end) {
+			*end = '\0';
+			next = end + delim_len;
+			len = end - buf;
+			line_len -= len + delim_len;
+		} else {
+			next = NULL;
+			len = line_len;
+		}
+		while (len && g_ascii_isspace(buf[len - 1]))
+			buf[--len] = '\0';
+		columns[idx] = buf;
+		lengths[idx] = len;
+		buf = next;
+	}
+
+	return idx;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
  * @param[in] column	The input text, a run of bin/hex/oct digits.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -785,10 +852,10 @@ static char **split_line(char *buf, struct context *inc)
  * This routine modifies the logic levels in the current sample set,
  * based on the text input and a user provided format spec.
  */
-static int parse_logic(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_logic(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
-	size_t length, ch_rem, ch_idx, ch_inc;
+	size_t ch_rem, ch_idx, ch_inc;
 	const char *rdptr;
 	char c;
 	gboolean valid;
@@ -801,12 +868,19 @@ static int parse_logic(const char *column, struct context *inc,
 	 * on the value's radix). Prepare the mapping of text digits to
 	 * (a number of) logic channels.
 	 */
-	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
 			inc->line_number);
 		return SR_ERR;
 	}
+
+	/* Fast path for the very common single bit binary column. */
+	if (details->text_format == FORMAT_BIN && length == 1 &&
+			details->channel_count && (column[0] == '0' || column[0] == '1')) {
+		set_logic_level(inc, details->channel_offset, column[0] == '1');
+		return SR_OK;
+	}
+
 	rdptr = &column[length];
 	ch_idx = details->channel_offset;
 	ch_rem = details->channel_count;
@@ -886,6 +960,7 @@ static int parse_logic(const char *column, struct context *inc,
  * Parse a floating point text into an analog value.
  *
  * @param[in] column	The input text, a floating point number.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -895,10 +970,9 @@ static int parse_logic(const char *column, struct context *inc,
  * This routine modifies the analog values in the current sample set,
  * based on the text input and a user provided format spec.
  */
-static int parse_analog(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_analog(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
-	size_t length;
 	double dvalue; float fvalue;
 	csv_analog_t value;
 	int ret;
@@ -906,7 +980,6 @@ static int parse_analog(const char *column, struct context *inc,
 	if (!format_is_analog(details->text_format))
 		return SR_ERR_BUG;
 
-	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
 			inc->line_number);
@@ -935,6 +1008,7 @@ static int parse_analog(const char *column, struct context *inc,
  * Parse a timestamp text, auto-determine samplerate.
  *
  * @param[in] column	The input text, a floating point number.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -945,12 +1019,14 @@ static int parse_analog(const char *column, struct context *inc,
  * samplerate from text rows' timestamp values. Only simple formats are
  * supported, user provided values always take precedence.
  */
-static int parse_timestamp(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_timestamp(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
 	double ts, rate;
 	int ret;
 
+	(void)length;
+
 	if (!format_is_timestamp(details->text_format))
 		return SR_ERR_BUG;
 
@@ -1026,18 +1102,19 @@ static int parse_timestamp(const char *column, struct context *inc,
  * This routine exists to unify dispatch code paths, mapping input file
  * columns' data types to their respective parse routines.
  */
-static int parse_ignore(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_ignore(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
 	(void)column;
+	(void)length;
 	(void)inc;
 	(void)details;
 
 	return SR_OK;
 }
 
-typedef int (*col_parse_cb)(const char *column, struct context *inc,
-	const struct column_details *details);
+typedef int (*col_parse_cb)(const char *column, size_t length,
+	struct context *inc, const struct column_details *details);
 
 static const col_parse_cb col_parse_funcs[] = {
 	[FORMAT_NONE] = parse_ignore,
@@ -1214,6 +1291,7 @@ static int init(struct sr_input *in, GHashTable *options)
 	first_column = g_variant_get_uint32(g_hash_table_lookup(options, "first_column"));
 	inc->use_header = g_variant_get_boolean(g_hash_table_lookup(options, "header"));
 	inc->start_line = g_variant_get_uint32(g_hash_table_lookup(options, "start_line"));
+	inc->threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
 	if (inc->start_line < 1) {
 		sr_err("Invalid start line %zu.", inc->start_line);
 		return SR_ERR_ARG;
@@ -1527,16 +1605,385 @@ static int initial_receive(const struct sr_input *in)
 	return ret;
 }
 
-static int process_buffer(struct sr_input *in, gboolean is_eof)
+/*
+ * Parse one text line into the current sample set. Returns SR_OK when
+ * the line holds a row of samples, SR_ERR_NA when the line got skipped
+ * (before the start line, blank, comment, header), or an error code.
+ */
+static int parse_row(struct context *inc, char *line)
 {
-	struct context *inc;
 	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	size_t col_idx, col_nr;
 	const struct column_details *details;
 	col_parse_cb parse_func;
 	int ret;
+
+	inc->line_number++;
+	if (inc->line_number < inc->start_line) {
+		sr_spew("Line %zu skipped (before start).", inc->line_number);
+		return SR_ERR_NA;
+	}
+	if (line[0] == '\0') {
+		sr_spew("Blank line %zu skipped.", inc->line_number);
+		return SR_ERR_NA;
+	}
+
+	/* Remove trailing comment. */
+	strip_comment(line, inc->comment);
+	if (line[0] == '\0') {
+		sr_spew("Comment-only line %zu skipped.", inc->line_number);
+		return SR_ERR_NA;
+	}
+
+	/* Skip the header line, its content was used as the channel names. */
+	if (inc->use_header && !inc->header_seen) {
+		sr_spew("Header line %zu skipped.", inc->line_number);
+		inc->header_seen = TRUE;
+		return SR_ERR_NA;
+	}
+
+	/* Split the line into columns, check for minimum length. */
+	num_columns = split_columns(line, inc, inc->columns,
+		inc->column_lengths, inc->column_want_count);
+	if (num_columns < inc->column_want_count) {
+		sr_err("Insufficient column count %zu in line %zu.",
+			num_columns, inc->line_number);
+		return SR_ERR;
+	}
+
+	/* Have the columns of the current text line processed. */
+	clear_logic_samples(inc);
+	clear_analog_samples(inc);
+	for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+		col_nr = col_idx + 1;
+		details = lookup_column_details(inc, col_nr);
+		if (!details || !details->text_format)
+			continue;
+		parse_func = col_parse_funcs[details->text_format];
+		if (!parse_func)
+			continue;
+		ret = parse_func(inc->columns[col_idx],
+			inc->column_lengths[col_idx], inc, details);
+		if (ret != SR_OK)
+			return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Isolate the next text line in place, return the start of the next. */
+static char *next_line(char *line, const char *termination, size_t term_len)
+{
+	char *term;
+
+	if (term_len == 1)
+		term = strchr(line, termination[0]);
+	else
+		term = strstr(line, termination);
+	if (!term)
+		return NULL;
+	*term = '\0';
+
+	return term + term_len;
+}
+
+static char **alloc_columns(size_t count, size_t **lengths)
+{
+	*lengths = g_malloc0_n(count, sizeof(**lengths));
+	return g_malloc0_n(count, sizeof(char *));
+}
+
+/*
+ * Parallel parsing of text rows. The buffered input gets cut into
+ * chunks at line boundaries. Worker threads parse the chunks' rows
+ * into chunk local sample buffers (same layout as the datafeed buffers,
+ * logic rows back to back, analog values striped per channel), using
+ * a snapshot of the context (with local line numbers and buffers). The
+ * caller's thread then copies the chunks' samples to the datafeed
+ * buffers in input order. Parallel parsing starts after the start line
+ * and the header were seen (which depend on preceeding lines).
+ */
+
+#define ROWS_CHUNK_SIZE	(1024 * 1024)
+
+struct rows_chunk {
+	char *text;
+	size_t len;
+	size_t line_count;
+	struct context ctx;
+	size_t rows;
+	int ret;
+	gboolean done;
+};
+
+static void free_rows_chunk(struct rows_chunk *chunk)
+{
+	if (!chunk)
+		return;
+
+	g_free(chunk->text);
+	g_free(chunk->ctx.datafeed_buffer);
+	g_free(chunk->ctx.analog_datafeed_buffer);
+	g_free(chunk->ctx.columns);
+	g_free(chunk->ctx.column_lengths);
+	g_free(chunk);
+}
+
+static void parse_rows_chunk(gpointer data, gpointer user_data)
+{
+	struct rows_chunk *chunk;
+	struct context *inc, *ctx;
+	char *line, *next, *text_end;
+	size_t term_len;
+	int ret;
+
+	chunk = data;
+	inc = user_data;
+	ctx = &chunk->ctx;
+
+	term_len = strlen(ctx->termination);
+	text_end = &chunk->text[chunk->len];
+	ret = SR_OK;
+	for (line = chunk->text; line && line < text_end; line = next) {
+		next = next_line(line, ctx->termination, term_len);
+		ret = parse_row(ctx, line);
+		if (ret == SR_ERR_NA) {
+			ret = SR_OK;
+			continue;
+		}
+		if (ret != SR_OK)
+			break;
+		if (ctx->logic_channels)
+			ctx->datafeed_buf_fill += ctx->sample_unit_size;
+		if (ctx->analog_channels)
+			ctx->analog_datafeed_buf_fill++;
+		chunk->rows++;
+	}
+	chunk->ret = ret;
+
+	g_mutex_lock(&inc->parallel.mutex);
+	chunk->done = TRUE;
+	g_cond_broadcast(&inc->parallel.done_cond);
+	g_mutex_unlock(&inc->parallel.mutex);
+}
+
+/* Copy a parsed chunk's samples to the datafeed buffers, in order. */
+static int apply_rows_chunk(const struct sr_input *in, struct rows_chunk *chunk)
+{
+	struct context *inc;
+	size_t pos, count, ch_idx;
+	int ret;
+
+	inc = in->priv;
+
+	if (!inc->calc_samplerate && chunk->ctx.calc_samplerate)
+		inc->calc_samplerate = chunk->ctx.calc_samplerate;
+
+	for (pos = 0; inc->logic_channels && pos < chunk->ctx.datafeed_buf_fill; pos += count) {
+		count = inc->datafeed_buf_size - inc->datafeed_buf_fill;
+		count = MIN(count, chunk->ctx.datafeed_buf_fill - pos);
+		memcpy(&inc->datafeed_buffer[inc->datafeed_buf_fill],
+			&chunk->ctx.datafeed_buffer[pos], count);
+		inc->datafeed_buf_fill += count;
+		if (inc->datafeed_buf_fill == inc->datafeed_buf_size) {
+			ret = flush_logic_samples(in);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	for (pos = 0; inc->analog_channels && pos < chunk->rows; pos += count) {
+		count = inc->analog_datafeed_buf_size - inc->analog_datafeed_buf_fill;
+		count = MIN(count, chunk->rows - pos);
+		for (ch_idx = 0; ch_idx < inc->analog_channels; ch_idx++) {
+			memcpy(&inc->analog_datafeed_buffer[ch_idx *
+				inc->analog_datafeed_buf_size +
+				inc->analog_datafeed_buf_fill],
+				&chunk->ctx.analog_datafeed_buffer[ch_idx *
+				chunk->ctx.analog_datafeed_buf_size + pos],
+				count * sizeof(inc->analog_datafeed_buffer[0]));
+		}
+		inc->analog_datafeed_buf_fill += count;
+		if (inc->analog_datafeed_buf_fill == inc->analog_datafeed_buf_size) {
+			ret = flush_analog_samples(in);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	if (chunk->ret != SR_OK)
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/*
+ * Apply parsed chunks in input order. Waits for the oldest chunk while
+ * more than keep chunks are in flight.
+ */
+static int apply_rows_chunks(const struct sr_input *in, size_t keep)
+{
+	struct context *inc;
+	struct rows_chunk *chunk;
+	int ret;
+
+	inc = in->priv;
+
+	ret = inc->parallel.error;
+	g_mutex_lock(&inc->parallel.mutex);
+	while ((chunk = g_queue_peek_head(&inc->parallel.chunks))) {
+		if (!chunk->done) {
+			if (g_queue_get_length(&inc->parallel.chunks) <= keep)
+				break;
+			g_cond_wait(&inc->parallel.done_cond,
+				&inc->parallel.mutex);
+			continue;
+		}
+		g_queue_pop_head(&inc->parallel.chunks);
+		g_mutex_unlock(&inc->parallel.mutex);
+		if (ret == SR_OK)
+			ret = apply_rows_chunk(in, chunk);
+		free_rows_chunk(chunk);
+		g_mutex_lock(&inc->parallel.mutex);
+	}
+	g_mutex_unlock(&inc->parallel.mutex);
+	inc->parallel.error = ret;
+
+	return ret;
+}
+
+static size_t count_lines(const char *text, size_t len,
+	const char *termination, size_t term_len)
+{
+	const char *p, *end;
+	size_t count;
+
+	count = 0;
+	end = &text[len];
+	for (p = text; p < end; p += term_len) {
+		if (term_len == 1)
+			p = memchr(p, termination[0], end - p);
+		else
+			p = g_strstr_len(p, end - p, termination);
+		if (!p)
+			return count + 1;
+		count++;
+	}
+
+	return count;
+}
+
+static int process_buffer_parallel(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	struct rows_chunk *chunk;
+	GError *error;
+	const char *term;
+	char *text;
+	size_t complete, pos, len, term_len, max_rows;
+	int ret;
+
+	inc = in->priv;
+
+	if (inc->parallel.error)
+		return inc->parallel.error;
+	if (!inc->parallel.pool) {
+		g_mutex_init(&inc->parallel.mutex);
+		g_cond_init(&inc->parallel.done_cond);
+		g_queue_init(&inc->parallel.chunks);
+		error = NULL;
+		inc->parallel.pool = g_thread_pool_new(parse_rows_chunk, inc,
+			inc->threads, FALSE, &error);
+		if (!inc->parallel.pool) {
+			sr_err("Cannot create parser threads: %s.",
+				error->message);
+			g_error_free(error);
+			return SR_ERR;
+		}
+	}
+
+	/* Only complete text lines get parsed before EOF. */
+	text = in->buf->str;
+	term_len = strlen(inc->termination);
+	if (is_eof) {
+		complete = in->buf->len;
+	} else {
+		term = g_strrstr_len(text, in->buf->len, inc->termination);
+		complete = term ? (size_t)(term + term_len - text) : 0;
+	}
+
+	ret = SR_OK;
+	for (pos = 0; pos < complete && ret == SR_OK; pos += len) {
+		len = complete - pos;
+		if (len > ROWS_CHUNK_SIZE) {
+			term = g_strstr_len(&text[pos + ROWS_CHUNK_SIZE],
+				len - ROWS_CHUNK_SIZE, inc->termination);
+			if (term)
+				len = term + term_len - &text[pos];
+		}
+		if (!is_eof && len < ROWS_CHUNK_SIZE)
+			break;
+
+		chunk = g_malloc0(sizeof(*chunk));
+		chunk->text = g_strndup(&text[pos], len);
+		chunk->len = len;
+		chunk->line_count = count_lines(chunk->text, len,
+			inc->termination, term_len);
+		max_rows = chunk->line_count;
+		chunk->ctx = *inc;
+		chunk->ctx.datafeed_buf_fill = 0;
+		chunk->ctx.datafeed_buffer = NULL;
+		if (inc->logic_channels)
+			chunk->ctx.datafeed_buffer = g_malloc(max_rows *
+				inc->sample_unit_size);
+		chunk->ctx.analog_datafeed_buf_fill = 0;
+		chunk->ctx.analog_datafeed_buf_size = max_rows;
+		chunk->ctx.analog_datafeed_buffer = NULL;
+		if (inc->analog_channels)
+			chunk->ctx.analog_datafeed_buffer = g_malloc_n(
+				max_rows * inc->analog_channels,
+				sizeof(inc->analog_datafeed_buffer[0]));
+		chunk->ctx.columns = alloc_columns(inc->column_want_count,
+			&chunk->ctx.column_lengths);
+		inc->line_number += chunk->line_count;
+
+		g_mutex_lock(&inc->parallel.mutex);
+		g_queue_push_tail(&inc->parallel.chunks, chunk);
+		g_mutex_unlock(&inc->parallel.mutex);
+		g_thread_pool_push(inc->parallel.pool, chunk, NULL);
+
+		ret = apply_rows_chunks(in, 2 * inc->threads);
+	}
+	g_string_erase(in->buf, 0, pos);
+
+	if (ret == SR_OK && is_eof)
+		ret = apply_rows_chunks(in, 0);
+
+	return ret;
+}
+
+static void cleanup_parallel(struct context *inc)
+{
+	struct rows_chunk *chunk;
+
+	if (!inc->parallel.pool)
+		return;
+
+	g_thread_pool_free(inc->parallel.pool, FALSE, TRUE);
+	inc->parallel.pool = NULL;
+	while ((chunk = g_queue_pop_head(&inc->parallel.chunks)))
+		free_rows_chunk(chunk);
+	g_cond_clear(&inc->parallel.done_cond);
+	g_mutex_clear(&inc->parallel.mutex);
+}
+
+static int process_buffer(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	size_t term_len;
+	int ret;
 	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+	char *line, *next;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1559,6 +2006,18 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 */
 	if (!in->buf->len)
 		return SR_OK;
+
+	/* Columns get split in place, keep one set of their references. */
+	if (!inc->columns && inc->column_want_count)
+		inc->columns = alloc_columns(inc->column_want_count,
+			&inc->column_lengths);
+
+	/* Rows after the start line and the header can be parsed in parallel. */
+	if (inc->threads > 1 && inc->line_number + 1 >= inc->start_line &&
+			(!inc->use_header || inc->header_seen))
+		return process_buffer_parallel(in, is_eof);
+
+	term_len = strlen(inc->termination);
 	if (is_eof) {
 		processed_up_to = in->buf->str + in->buf->len;
 	} else {
@@ -1567,86 +2026,33 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		if (!processed_up_to)
 			return SR_OK;
 		*processed_up_to = '\0';
-		processed_up_to += strlen(inc->termination);
+		processed_up_to += term_len;
 	}
 
-	/* Split input text lines and process their columns. */
+	/*
+	 * Walk the input text lines in place and process their columns.
+	 * Neither lines nor columns get copied, each line is terminated
+	 * right in the receive buffer.
+	 */
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
-		inc->line_number++;
-		if (inc->line_number < inc->start_line) {
-			sr_spew("Line %zu skipped (before start).", inc->line_number);
-			continue;
-		}
-		if (line[0] == '\0') {
-			sr_spew("Blank line %zu skipped.", inc->line_number);
-			continue;
-		}
-
-		/* Remove trailing comment. */
-		strip_comment(line, inc->comment);
-		if (line[0] == '\0') {
-			sr_spew("Comment-only line %zu skipped.", inc->line_number);
+	for (line = in->buf->str; line; line = next) {
+		next = next_line(line, inc->termination, term_len);
+		ret = parse_row(inc, line);
+		if (ret == SR_ERR_NA) {
+			ret = SR_OK;
 			continue;
 		}
-
-		/* Skip the header line, its content was used as the channel names. */
-		if (inc->use_header && !inc->header_seen) {
-			sr_spew("Header line %zu skipped.", inc->line_number);
-			inc->header_seen = TRUE;
-			continue;
-		}
-
-		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
-		if (num_columns < inc->column_want_count) {
-			sr_err("Insufficient column count %zu in line %zu.",
-				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
+		if (ret != SR_OK)
 			return SR_ERR;
-		}
-
-		/* Have the columns of the current text line processed. */
-		clear_logic_samples(inc);
-		clear_analog_samples(inc);
-		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
-			col_nr = col_idx + 1;
-			details = lookup_column_details(inc, col_nr);
-			if (!details || !details->text_format)
-				continue;
-			parse_func = col_parse_funcs[details->text_format];
-			if (!parse_func)
-				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
-				return SR_ERR;
-			}
-		}
 
 		/* Send sample data to the session bus (buffered). */
 		ret = queue_logic_samples(in);
 		ret += queue_analog_samples(in);
 		if (ret != SR_OK) {
 			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
-
-		g_strfreev(columns);
 	}
-	g_strfreev(lines);
 	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
 
 	return ret;
@@ -1712,6 +2118,7 @@ static void cleanup(struct sr_input *in)
 	/* Release dynamically allocated resources. */
 	inc = in->priv;
 
+	cleanup_parallel(inc);
 	g_free(inc->termination);
 	inc->termination = NULL;
 	g_free(inc->datafeed_buffer);
@@ -1724,6 +2131,10 @@ static void cleanup(struct sr_input *in)
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
 	inc->column_details = NULL;
+	g_free(inc->columns);
+	inc->columns = NULL;
+	g_free(inc->column_lengths);
+	inc->column_lengths = NULL;
 
 	/* Clear internal state, but keep what .init() has provided. */
 	save_ctx = *inc;
@@ -1734,6 +2145,7 @@ static void cleanup(struct sr_input *in)
 	inc->column_formats = save_ctx.column_formats;
 	inc->start_line = save_ctx.start_line;
 	inc->use_header = save_ctx.use_header;
+	inc->threads = save_ctx.threads;
 	inc->prev_sr_channels = save_ctx.prev_sr_channels;
 	inc->prev_df_channels = save_ctx.prev_df_channels;
 }
@@ -1761,6 +2173,7 @@ enum option_index {
 	OPT_SAMPLERATE,
 	OPT_COL_SEP,
 	OPT_COMMENT,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1815,6 +2228,11 @@ static struct sr_option options[] = {
 		"The text which starts comments at the end of text lines, semicolon by default.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"Number of threads which parse text rows in parallel. Values 0 and 1 parse in the caller's thread.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -1838,6 +2256,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(g_variant_new_uint64(0));
 		options[OPT_COL_SEP].def = g_variant_ref_sink(g_variant_new_string(","));
 		options[OPT_COMMENT].def = g_variant_ref_sink(g_variant_new_string(";"));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(0));
 	}
 
 	return options;
@@ -27,10 +27,47 @@ struct feed_queue_logic {
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	uint8_t *own_bytes;
+	struct sr_buffer *buffer;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	size_t min_run;
+	uint8_t *run_value;
 };
 
+/*
+ * Borrow the next fill buffer from the session's buffer pool. Sending
+ * pool buffers lets consumers keep the data without copying it. Falls
+ * back to the queue's own memory when there is no session (yet).
+ */
+static void *feed_queue_buffer_get(const struct sr_dev_inst *sdi,
+	size_t size, struct sr_buffer **buffer, void *own)
+{
+	*buffer = NULL;
+	if (sdi && sdi->session)
+		*buffer = sr_session_buffer_get(sdi->session, size);
+	if (!*buffer)
+		return own;
+
+	return sr_buffer_data_get(*buffer, NULL);
+}
+
+/* Send a queue's filled buffer, borrowed or own memory. */
+static int feed_queue_send(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, struct sr_buffer **buffer)
+{
+	int ret;
+
+	if (!*buffer)
+		return sr_session_send(sdi, packet);
+
+	ret = sr_session_send_buffer(sdi, packet, *buffer);
+	sr_buffer_unref(*buffer);
+	*buffer = NULL;
+
+	return ret;
+}
+
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size)
@@ -41,11 +78,13 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	q->sdi = sdi;
 	q->unit_size = unit_size;
 	q->alloc_count = sample_count;
-	q->data_bytes = g_try_malloc(q->alloc_count * q->unit_size);
-	if (!q->data_bytes) {
+	q->own_bytes = g_try_malloc(q->alloc_count * q->unit_size);
+	if (!q->own_bytes) {
 		g_free(q);
 		return NULL;
 	}
+	q->data_bytes = feed_queue_buffer_get(sdi,
+		q->alloc_count * q->unit_size, &q->buffer, q->own_bytes);
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	memset(&q->logic, 0, sizeof(q->logic));
@@ -57,22 +96,157 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	return q;
 }
 
+/*
+ * Have repeated sample values sent as SR_DF_LOGIC_RUNS when their repeat
+ * count reaches the given minimum (0 disables). Long idle spans then cost
+ * constant time. Only sources whose consumers handle the packet type
+ * should enable this.
+ */
+SR_API int feed_queue_logic_runs(struct feed_queue_logic *q, size_t min_run)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	if (min_run && !q->run_value)
+		q->run_value = g_malloc0(q->unit_size);
+	q->min_run = min_run;
+
+	return SR_OK;
+}
+
+/* Send one sample value which repeats the given number of times. */
+static int feed_queue_logic_send_run(struct feed_queue_logic *q,
+	const uint8_t *data, uint64_t length)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_runs runs;
+	int ret;
+
+	ret = feed_queue_logic_flush(q);
+	if (ret != SR_OK)
+		return ret;
+
+	memcpy(q->run_value, data, q->unit_size);
+	runs.num_runs = 1;
+	runs.unitsize = q->unit_size;
+	runs.data = q->run_value;
+	runs.lengths = &length;
+	packet.type = SR_DF_LOGIC_RUNS;
+	packet.payload = &runs;
+
+	return sr_session_send(q->sdi, &packet);
+}
+
+/*
+ * Fill memory with copies of one sample value. Byte sized units use
+ * memset(), wider units get their filled part doubled per iteration,
+ * which keeps the number of library calls logarithmic in the count.
+ */
+static void feed_queue_logic_fill(uint8_t *wrptr, const uint8_t *data,
+	size_t unit_size, size_t count)
+{
+	size_t total, filled, copy;
+
+	if (!count)
+		return;
+	if (unit_size == 1) {
+		memset(wrptr, data[0], count);
+		return;
+	}
+
+	total = count * unit_size;
+	memcpy(wrptr, data, unit_size);
+	filled = unit_size;
+	while (filled < total) {
+		copy = MIN(filled, total - filled);
+		memcpy(&wrptr[filled], wrptr, copy);
+		filled += copy;
+	}
+}
+
 SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count)
 {
 	uint8_t *wrptr;
+	size_t space, fill_count;
 	int ret;
 
-	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (repeat_count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	if (q->min_run && repeat_count >= q->min_run)
+		return feed_queue_logic_send_run(q, data, repeat_count);
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		fill_count = MIN(repeat_count, space);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		feed_queue_logic_fill(wrptr, data, q->unit_size, fill_count);
+		repeat_count -= fill_count;
+		q->fill_count += fill_count;
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_logic_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Submit a batch of run length encoded samples: the values are packed
+ * at the queue's unit size, each repeats the respective count of times.
+ * Short runs are expanded in place, runs which cross the buffer's end
+ * or qualify for SR_DF_LOGIC_RUNS take the feed_queue_logic_submit_one()
+ * path.
+ */
+SR_API int feed_queue_logic_submit_runs(struct feed_queue_logic *q,
+	const uint8_t *data, const size_t *repeat_counts, size_t run_count)
+{
+	uint8_t *wrptr;
+	size_t unit_size, count;
+	int ret;
+
+	if (!q || (run_count && (!data || !repeat_counts)))
+		return SR_ERR_ARG;
+
+	unit_size = q->unit_size;
+	while (run_count--) {
+		count = *repeat_counts++;
+		if (count > q->alloc_count - q->fill_count ||
+				(q->min_run && count >= q->min_run)) {
+			ret = feed_queue_logic_submit_one(q, data, count);
+			if (ret != SR_OK)
+				return ret;
+			data += unit_size;
+			continue;
+		}
+		wrptr = &q->data_bytes[q->fill_count * unit_size];
+		q->fill_count += count;
+		switch (unit_size) {
+		case 1:
+			memset(wrptr, data[0], count);
+			break;
+		case 2:
+			while (count--) {
+				memcpy(wrptr, data, 2);
+				wrptr += 2;
+			}
+			break;
+		case 4:
+			while (count--) {
+				memcpy(wrptr, data, 4);
+				wrptr += 4;
+			}
+			break;
+		default:
+			feed_queue_logic_fill(wrptr, data, unit_size, count);
+			break;
+		}
+		data += unit_size;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
@@ -116,7 +290,10 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 		return SR_OK;
 
 	q->logic.length = q->fill_count * q->unit_size;
-	ret = sr_session_send(q->sdi, &q->packet);
+	ret = feed_queue_send(q->sdi, &q->packet, &q->buffer);
+	q->data_bytes = feed_queue_buffer_get(q->sdi,
+		q->alloc_count * q->unit_size, &q->buffer, q->own_bytes);
+	q->logic.data = q->data_bytes;
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
@@ -145,15 +322,22 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 	if (!q)
 		return;
 
-	g_free(q->data_bytes);
+	sr_buffer_unref(q->buffer);
+	g_free(q->own_bytes);
+	g_free(q->run_value);
 	g_free(q);
 }
 
 struct feed_queue_analog {
 	const struct sr_dev_inst *sdi;
+	size_t unit_size;
 	size_t alloc_count;
 	size_t fill_count;
-	float *data_values;
+	uint8_t *data_bytes;
+	uint8_t *own_bytes;
+	struct sr_buffer *buffer;
+	int64_t *timestamps;
+	int64_t timestamp;
 	int digits;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -171,12 +355,15 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
+	q->unit_size = sizeof(float);
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
-	if (!q->data_values) {
+	q->own_bytes = g_try_malloc(q->alloc_count * q->unit_size);
+	if (!q->own_bytes) {
 		g_free(q);
 		return NULL;
 	}
+	q->data_bytes = feed_queue_buffer_get(sdi,
+		q->alloc_count * q->unit_size, &q->buffer, q->own_bytes);
 	q->digits = digits;
 	q->channels = g_slist_append(NULL, ch);
 
@@ -186,7 +373,7 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	q->packet.payload = &q->analog;
 	q->encoding.is_signed = TRUE;
 	q->meaning.channels = q->channels;
-	q->analog.data = q->data_values;
+	q->analog.data = q->data_bytes;
 
 	return q;
 }
@@ -199,6 +386,10 @@ SR_API int feed_queue_analog_mq_unit(struct feed_queue_analog *q,
 	if (!q)
 		return SR_ERR_ARG;
 
+	if (q->meaning.mq == mq && q->meaning.mqflags == mq_flag &&
+			q->meaning.unit == unit)
+		return SR_OK;
+
 	ret = feed_queue_analog_flush(q);
 	if (ret != SR_OK)
 		return ret;
@@ -230,13 +421,165 @@ SR_API int feed_queue_analog_scale_offset(struct feed_queue_analog *q,
 	return SR_OK;
 }
 
+/*
+ * Change the number of significant digits of subsequently submitted
+ * values. Sources which determine the resolution per reading (think
+ * multimeter range changes) can call this for each value, queued values
+ * only get flushed when the digits actually change.
+ */
+SR_API int feed_queue_analog_digits(struct feed_queue_analog *q,
+	int digits, int spec_digits)
+{
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	if (q->encoding.digits == digits && q->spec.spec_digits == spec_digits)
+		return SR_OK;
+
+	ret = feed_queue_analog_flush(q);
+	if (ret != SR_OK)
+		return ret;
+
+	q->digits = digits;
+	q->encoding.digits = digits;
+	q->spec.spec_digits = spec_digits;
+
+	return SR_OK;
+}
+
+/*
+ * Set the reception time of subsequently submitted values, in µs of
+ * the monotonic clock. The first call has the queue's packets carry
+ * per sample timestamps.
+ */
+SR_API int feed_queue_analog_timestamp(struct feed_queue_analog *q,
+	int64_t timestamp)
+{
+
+	if (!q)
+		return SR_ERR_ARG;
+
+	if (!q->timestamps) {
+		q->timestamps = g_try_malloc(q->alloc_count *
+			sizeof(q->timestamps[0]));
+		if (!q->timestamps)
+			return SR_ERR_MALLOC;
+	}
+	q->timestamp = timestamp;
+
+	return SR_OK;
+}
+
+/* Assign the current reception time to a number of queued values. */
+static void feed_queue_analog_stamp(struct feed_queue_analog *q,
+	size_t count)
+{
+	int64_t *wrptr;
+
+	if (!q->timestamps)
+		return;
+
+	wrptr = &q->timestamps[q->fill_count];
+	while (count--)
+		*wrptr++ = q->timestamp;
+}
+
+/*
+ * Have the queue keep and send values in the source's native format
+ * (host endianess), which saves the conversion to float for sources
+ * which have raw integer data (think ADC values, PCM samples). Scale
+ * and offset can translate these to the physical quantity. Use
+ * feed_queue_analog_submit_native() to submit values then.
+ */
+SR_API int feed_queue_analog_native(struct feed_queue_analog *q,
+	size_t unit_size, gboolean is_signed, gboolean is_float)
+{
+	uint8_t *own_bytes;
+	int ret;
+
+	if (!q)
+		return SR_ERR_ARG;
+	if (is_float && unit_size != sizeof(float) && unit_size != sizeof(double))
+		return SR_ERR_ARG;
+	if (!is_float && unit_size != 1 && unit_size != 2 && unit_size != 4)
+		return SR_ERR_ARG;
+
+	ret = feed_queue_analog_flush(q);
+	if (ret != SR_OK)
+		return ret;
+
+	if (unit_size != q->unit_size) {
+		own_bytes = g_try_malloc(q->alloc_count * unit_size);
+		if (!own_bytes)
+			return SR_ERR_MALLOC;
+		sr_buffer_unref(q->buffer);
+		g_free(q->own_bytes);
+		q->own_bytes = own_bytes;
+		q->unit_size = unit_size;
+		q->data_bytes = feed_queue_buffer_get(q->sdi,
+			q->alloc_count * q->unit_size, &q->buffer, q->own_bytes);
+		q->analog.data = q->data_bytes;
+	}
+	q->encoding.unitsize = unit_size;
+	q->encoding.is_signed = is_signed;
+	q->encoding.is_float = is_float;
+
+	return SR_OK;
+}
+
+/* Check whether the queue keeps values as float. */
+static gboolean feed_queue_analog_is_float(const struct feed_queue_analog *q)
+{
+	return q->encoding.is_float && q->unit_size == sizeof(float);
+}
+
 SR_API int feed_queue_analog_submit_one(struct feed_queue_analog *q,
 	float data, size_t repeat_count)
 {
+	float *wrptr;
+	size_t space, fill_count;
+	int ret;
+
+	if (!feed_queue_analog_is_float(q))
+		return SR_ERR_ARG;
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		fill_count = MIN(repeat_count, space);
+		wrptr = &((float *)q->data_bytes)[q->fill_count];
+		feed_queue_analog_stamp(q, fill_count);
+		repeat_count -= fill_count;
+		q->fill_count += fill_count;
+		while (fill_count--)
+			*wrptr++ = data;
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_analog_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Copy a number of values in the queue's format, flush full buffers. */
+static int feed_queue_analog_copy(struct feed_queue_analog *q,
+	const uint8_t *data, size_t samples_count)
+{
+	size_t space, copy_count;
 	int ret;
 
-	while (repeat_count--) {
-		q->data_values[q->fill_count++] = data;
+	while (samples_count) {
+		space = q->alloc_count - q->fill_count;
+		copy_count = MIN(samples_count, space);
+		memcpy(&q->data_bytes[q->fill_count * q->unit_size], data,
+			copy_count * q->unit_size);
+		feed_queue_analog_stamp(q, copy_count);
+		data += copy_count * q->unit_size;
+		samples_count -= copy_count;
+		q->fill_count += copy_count;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_analog_flush(q);
 			if (ret != SR_OK)
@@ -247,6 +590,27 @@ SR_API int feed_queue_analog_submit_one(struct feed_queue_analog *q,
 	return SR_OK;
 }
 
+SR_API int feed_queue_analog_submit_many(struct feed_queue_analog *q,
+	const float *data, size_t samples_count)
+{
+
+	if (!feed_queue_analog_is_float(q))
+		return SR_ERR_ARG;
+
+	return feed_queue_analog_copy(q, (const uint8_t *)data, samples_count);
+}
+
+/*
+ * Submit values in the format which feed_queue_analog_native() has
+ * configured, that is unit size bytes per value in host endianess.
+ */
+SR_API int feed_queue_analog_submit_native(struct feed_queue_analog *q,
+	const void *data, size_t samples_count)
+{
+
+	return feed_queue_analog_copy(q, data, samples_count);
+}
+
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 {
 	int ret;
@@ -254,8 +618,17 @@ SR_API int feed_queue_analog_flush(struct feed_queue_analog *q)
 	if (!q->fill_count)
 		return SR_OK;
 
+	/*
+	 * Pool buffers get handed to the session as they are, consumers
+	 * which keep the data take a reference instead of a copy. The
+	 * queue continues with the next buffer from the pool.
+	 */
 	q->analog.num_samples = q->fill_count;
-	ret = sr_session_send(q->sdi, &q->packet);
+	q->analog.timestamps = q->timestamps;
+	ret = feed_queue_send(q->sdi, &q->packet, &q->buffer);
+	q->data_bytes = feed_queue_buffer_get(q->sdi,
+		q->alloc_count * q->unit_size, &q->buffer, q->own_bytes);
+	q->analog.data = q->data_bytes;
 	if (ret != SR_OK)
 		return ret;
 	q->fill_count = 0;
@@ -269,7 +642,9 @@ SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 	if (!q)
 		return;
 
-	g_free(q->data_values);
+	sr_buffer_unref(q->buffer);
+	g_free(q->own_bytes);
+	g_free(q->timestamps);
 	g_slist_free(q->channels);
 	g_free(q);
 }
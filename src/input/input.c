@@ -22,6 +22,9 @@
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -31,6 +34,7 @@
 
 /** @cond PRIVATE */
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+#define LOAD_WINDOW	(16 * 1024 * 1024)
 /** @endcond */
 
 /**
@@ -348,6 +352,75 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
 	return TRUE;
 }
 
+/* Returns TRUE if the stream starts with one of the module's magics. */
+static gboolean check_magics(const struct sr_input_module *imod,
+		const GString *header)
+{
+	const char *const *magic;
+	size_t len;
+
+	if (!imod->magics)
+		return TRUE;
+
+	for (magic = imod->magics; *magic; magic++) {
+		len = strlen(*magic);
+		if (header->len >= len && memcmp(header->str, *magic, len) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Returns the number of header bytes which the module wants to see. */
+static size_t header_size_needed(const struct sr_input_module *imod)
+{
+	size_t m;
+
+	for (m = 0; m < sizeof(imod->metadata) && imod->metadata[m]; m++) {
+		if ((imod->metadata[m] & ~SR_INPUT_META_REQUIRED) != SR_INPUT_META_HEADER)
+			continue;
+		if (!imod->header_size || imod->header_size > CHUNK_SIZE)
+			return CHUNK_SIZE;
+		return imod->header_size;
+	}
+
+	return 0;
+}
+
+/* Sort modules by the header size they need, keep the list's order else. */
+static gint compare_header_size(gconstpointer a, gconstpointer b)
+{
+	const struct sr_input_module *ma, *mb;
+	size_t sa, sb;
+
+	ma = input_module_list[GPOINTER_TO_UINT(a)];
+	mb = input_module_list[GPOINTER_TO_UINT(b)];
+	sa = header_size_needed(ma);
+	sb = header_size_needed(mb);
+	if (sa != sb)
+		return sa < sb ? -1 : +1;
+
+	return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+/* Extend the file header buffer to (up to) the given size. */
+static int read_header(FILE *stream, GString *header, size_t want)
+{
+	size_t have, count;
+
+	have = header->len;
+	if (want <= have || feof(stream))
+		return SR_OK;
+
+	g_string_set_size(header, want);
+	count = fread(header->str + have, 1, want - have, stream);
+	g_string_set_size(header, have + count);
+	if (ferror(stream))
+		return SR_ERR_IO;
+
+	return SR_OK;
+}
+
 /**
  * Try to find an input module that can parse the given buffer.
  *
@@ -395,6 +468,9 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 		if (!check_required_metadata(imod->metadata, avail_metadata))
 			/* Cannot satisfy this module's requirements. */
 			continue;
+		if (!check_magics(imod, buf))
+			/* Stream does not start like files of this format. */
+			continue;
 
 		meta = g_hash_table_new(NULL, NULL);
 		for (m = 0; m < sizeof(imod->metadata); m++) {
@@ -439,28 +515,45 @@ SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 }
 
 /**
- * Try to find an input module that can parse the given file.
+ * Find the input module that can parse the given file.
  *
- * If an input module is found, an instance is created into *in.
- * Otherwise, *in contains NULL. When multiple input moduless claim
- * support for the format, the one with highest confidence takes
- * precedence. Applications will see at most one input module spec.
+ * Only inspects the start of the file, reads as much of the file's
+ * content as the format's detection routines need. Modules with magic
+ * byte sequences only get checked when the file starts with one of
+ * them. No input instance gets created, which makes this routine
+ * suitable for applications which index many files.
+ *
+ * When multiple input modules claim support for the format, the one
+ * with highest confidence takes precedence.
+ *
+ * @param[in] filename The file to inspect. Must not be NULL.
+ * @param[out] imod The matching input module. Set to NULL when none
+ *                  matches. Must not be NULL.
  *
+ * @retval SR_OK A matching input module was found.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR No input module matched, or file access failed.
+ *
+ * @since 0.6.0
  */
-SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
+SR_API int sr_input_probe_file(const char *filename,
+		const struct sr_input_module **imod)
 {
 	int64_t filesize;
 	FILE *stream;
-	const struct sr_input_module *imod, *best_imod;
+	const struct sr_input_module *mod, *best_imod;
 	GHashTable *meta;
 	GString *header;
-	size_t count;
-	unsigned int midx, i;
+	GSList *order, *l;
+	size_t want;
+	unsigned int midx, i, best_idx;
 	unsigned int conf, best_conf;
 	int ret;
 	uint8_t avail_metadata[8];
 
-	*in = NULL;
+	if (!imod)
+		return SR_ERR_ARG;
+	*imod = NULL;
 
 	if (!filename || !filename[0]) {
 		sr_err("Invalid filename.");
@@ -478,16 +571,7 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 		fclose(stream);
 		return SR_ERR;
 	}
-	header = g_string_sized_new(CHUNK_SIZE);
-	count = fread(header->str, 1, header->allocated_len - 1, stream);
-	if (count < 1 || ferror(stream)) {
-		sr_err("Failed to read %s: %s", filename, g_strerror(errno));
-		fclose(stream);
-		g_string_free(header, TRUE);
-		return SR_ERR;
-	}
-	fclose(stream);
-	g_string_set_size(header, count);
+	header = g_string_sized_new(128);
 
 	meta = g_hash_table_new(NULL, NULL);
 	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_FILENAME),
@@ -503,45 +587,107 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 	avail_metadata[midx] = 0;
 	/* TODO: MIME type */
 
-	best_imod = NULL;
-	best_conf = ~0;
+	/*
+	 * Check modules in the order of the header size they need. The
+	 * header buffer grows as needed, most files get detected without
+	 * reading the default amount of data. Ties in confidence go to
+	 * the module which comes first in the list.
+	 */
+	order = NULL;
 	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
+		mod = input_module_list[i];
+		if (!mod->metadata[0]) {
 			/* Module has no metadata for matching so will take
 			 * any input. No point in letting it try to match. */
 			continue;
 		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
+		if (!check_required_metadata(mod->metadata, avail_metadata))
 			/* Cannot satisfy this module's requirements. */
 			continue;
+		order = g_slist_prepend(order, GUINT_TO_POINTER(i));
+	}
+	order = g_slist_sort(order, compare_header_size);
+
+	best_imod = NULL;
+	best_idx = 0;
+	best_conf = ~0;
+	ret = SR_OK;
+	for (l = order; l; l = l->next) {
+		i = GPOINTER_TO_UINT(l->data);
+		mod = input_module_list[i];
+
+		want = header_size_needed(mod);
+		ret = read_header(stream, header, want);
+		if (ret != SR_OK) {
+			sr_err("Failed to read %s: %s",
+				filename, g_strerror(errno));
+			break;
+		}
+		if (want && !header->len)
+			/* Empty file, no content to match. */
+			continue;
+		if (!check_magics(mod, header))
+			/* File does not start like files of this format. */
+			continue;
 
-		sr_dbg("Trying module %s.", imod->id);
+		sr_dbg("Trying module %s.", mod->id);
 
-		ret = imod->format_match(meta, &conf);
+		ret = mod->format_match(meta, &conf);
 		if (ret == SR_ERR) {
 			/* Module didn't recognize this buffer. */
+			ret = SR_OK;
 			continue;
 		} else if (ret != SR_OK) {
 			/* Module recognized this buffer, but cannot handle it. */
+			ret = SR_OK;
 			continue;
 		}
 		/* Found a matching module. */
-		sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
+		sr_dbg("Module %s matched, confidence %u.", mod->id, conf);
+		if (conf > best_conf || (conf == best_conf && i > best_idx))
 			continue;
-		best_imod = imod;
+		best_imod = mod;
+		best_idx = i;
 		best_conf = conf;
 	}
+	g_slist_free(order);
+	fclose(stream);
 	g_hash_table_destroy(meta);
 	g_string_free(header, TRUE);
 
-	if (best_imod) {
-		*in = sr_input_new(best_imod, NULL);
-		return SR_OK;
-	}
+	if (ret != SR_OK)
+		return SR_ERR;
+	if (!best_imod)
+		return SR_ERR;
+	*imod = best_imod;
 
-	return SR_ERR;
+	return SR_OK;
+}
+
+/**
+ * Try to find an input module that can parse the given file.
+ *
+ * If an input module is found, an instance is created into *in.
+ * Otherwise, *in contains NULL. When multiple input moduless claim
+ * support for the format, the one with highest confidence takes
+ * precedence. Applications will see at most one input module spec.
+ *
+ * See sr_input_probe_file() for details on the format detection.
+ */
+SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
+{
+	const struct sr_input_module *imod;
+	int ret;
+
+	*in = NULL;
+
+	ret = sr_input_probe_file(filename, &imod);
+	if (ret != SR_OK)
+		return ret;
+
+	*in = sr_input_new(imod, NULL);
+
+	return SR_OK;
 }
 
 /**
@@ -601,6 +747,231 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+/**
+ * Send borrowed data to the specified input instance.
+ *
+ * Works like sr_input_send(), but takes a plain memory block which
+ * only needs to stay valid for the duration of the call. Modules
+ * which support it forward complete samples straight from this
+ * memory instead of copying them into their own buffer first.
+ *
+ * @param in The input instance.
+ * @param data The data to send.
+ * @param len The number of bytes in data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_data(const struct sr_input *in,
+		const void *data, size_t len)
+{
+	GString *buf;
+	int ret;
+
+	if (!in || (!data && len))
+		return SR_ERR_ARG;
+
+	sr_spew("Sending %zu bytes to %s module.", len, in->module->id);
+	if (in->module->receive_data)
+		return in->module->receive_data((struct sr_input *)in,
+				data, len);
+
+	buf = g_string_new_len(data, len);
+	ret = in->module->receive((struct sr_input *)in, buf);
+	g_string_free(buf, TRUE);
+
+	return ret;
+}
+
+/**
+ * Send a reference counted buffer to the specified input instance.
+ *
+ * Works like sr_input_send_data(), but modules which forward samples
+ * straight from the caller's memory send them as buffer backed packets,
+ * see sr_buffer_new(). Consumers which keep those packets take a
+ * reference to the buffer instead of copying the data. The buffer's
+ * release callback runs after the last of them was dropped.
+ *
+ * @param in The input instance.
+ * @param buf The buffer to send. The caller keeps its reference.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_buffer(const struct sr_input *in,
+		struct sr_buffer *buf)
+{
+	struct sr_input *input;
+	const void *data;
+	size_t len;
+	int ret;
+
+	if (!in || !buf)
+		return SR_ERR_ARG;
+
+	input = (struct sr_input *)in;
+	data = sr_buffer_data_get(buf, &len);
+	input->data_buffer = buf;
+	ret = sr_input_send_data(in, data, len);
+	input->data_buffer = NULL;
+
+	return ret;
+}
+
+/** @private */
+static void load_advise(const char *data, size_t len, gboolean done)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_SEQUENTIAL)
+	if (len)
+		(void)madvise((void *)data, len,
+			done ? MADV_DONTNEED : MADV_SEQUENTIAL);
+#else
+	(void)data;
+	(void)len;
+	(void)done;
+#endif
+}
+
+/**
+ * Feed a whole file to the specified input instance.
+ *
+ * The file is memory mapped and handed to the input module in large
+ * windows straight from the mapping, see sr_input_send_data(). Pages
+ * which have been consumed are released again, so importing files far
+ * larger than the available memory works without a read-and-copy loop
+ * in the caller. sr_input_end() is called after the last window.
+ *
+ * Since the caller usually cannot attach a session to the input's
+ * device instance before the module has seen some data, the optional
+ * ready callback is run once, as soon as sr_input_dev_inst_get()
+ * returns the device instance. Returning anything other than SR_OK
+ * from the callback aborts loading with that code.
+ *
+ * @param in The input instance.
+ * @param filename The file to load.
+ * @param ready Callback to run when the device instance is ready, or NULL.
+ * @param cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA The module did not populate its device instance.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_load_file(const struct sr_input *in, const char *filename,
+		sr_input_ready_callback ready, void *cb_data)
+{
+	return sr_input_load_file_range(in, filename, 0, 0, ready, cb_data);
+}
+
+/**
+ * Feed a range of samples from a file to the specified input instance.
+ *
+ * Same as sr_input_load_file(), but the module only receives the
+ * @a count samples starting at sample index @a start. Once the device
+ * instance is ready, the file is not parsed up to the start of the
+ * range, instead loading continues right at the range's file offset,
+ * and stops at its end. This requires the module to support seeking,
+ * which is the case for formats with fixed size samples at known
+ * locations in the file (binary, raw_analog, chronovu-la8, wav).
+ * Ranges of other formats can be selected with the "range" transform
+ * module.
+ *
+ * @param in The input instance.
+ * @param filename The file to load.
+ * @param start Index of the first sample to load.
+ * @param count Number of samples to load, 0 loads up to the end of file.
+ * @param ready Callback to run when the device instance is ready, or NULL.
+ * @param cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The module does not support seeking.
+ * @retval SR_ERR_DATA The module did not populate its device instance.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_load_file_range(const struct sr_input *in,
+		const char *filename, uint64_t start, uint64_t count,
+		sr_input_ready_callback ready, void *cb_data)
+{
+	GMappedFile *map;
+	GError *error;
+	const char *data;
+	size_t size, end, pos, len, next, sample_size;
+	uint64_t offset;
+	gboolean was_ready, ranged;
+	int ret;
+
+	if (!in || !filename || !filename[0])
+		return SR_ERR_ARG;
+	ranged = start || count;
+	if (ranged && !in->module->seek) {
+		sr_err("Module %s cannot load sample ranges.", in->module->id);
+		return SR_ERR_NA;
+	}
+
+	error = NULL;
+	map = g_mapped_file_new(filename, FALSE, &error);
+	if (!map) {
+		sr_err("Failed to map %s: %s", filename, error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+	data = g_mapped_file_get_contents(map);
+	size = g_mapped_file_get_length(map);
+	load_advise(data, size, FALSE);
+
+	sr_dbg("Loading %zu bytes from %s.", size, filename);
+	was_ready = in->sdi_ready;
+	ret = SR_OK;
+	end = size;
+	for (pos = 0; pos < end; pos = next) {
+		len = MIN(LOAD_WINDOW, end - pos);
+		next = pos + len;
+		ret = sr_input_send_data(in, data + pos, len);
+		if (ret != SR_OK)
+			break;
+		if (!was_ready && in->sdi_ready) {
+			was_ready = TRUE;
+			if (ranged) {
+				ret = in->module->seek((struct sr_input *)in,
+					start, &offset, &sample_size);
+				if (ret != SR_OK)
+					break;
+				next = MIN(offset, size);
+				if (count && count <= (size - next) / sample_size)
+					end = next + count * sample_size;
+				sr_dbg("Loading samples from offset %zu to %zu.",
+					next, end);
+			}
+			if (ready)
+				ret = ready(in, cb_data);
+			if (ret != SR_OK)
+				break;
+		}
+		/* The module is done with this window. */
+		load_advise(data + pos, len, TRUE);
+	}
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+	if (ret == SR_OK && !in->sdi_ready) {
+		sr_err("No device instance for %s.", filename);
+		ret = SR_ERR_DATA;
+	}
+	g_mapped_file_unref(map);
+
+	return ret;
+}
+
 /**
  * Signal the input module no more data will come.
  *
@@ -42,6 +42,12 @@
  * Item "BYT_NR" specifies bytes per sample.
  * Samples can be stored in three formats: signed integer (RI),
  * unsigned integer (RP) or floating point/IEEE754 (FP).
+ *
+ * Analog waveforms get sent in the file's native encoding, straight
+ * from the input buffer. The YMULT, YOFF and YZERO items translate to
+ * the encoding's scale and offset. RF waveforms (which are converted
+ * to dBm) as well as integers wider than 4 bytes get converted to
+ * float values.
  */
 
 #include <config.h>
@@ -123,6 +129,9 @@ struct context {
 	enum format bn_fmt;
 	enum waveform_type wfmtype;
 	char channel_name[MAX_CHANNEL_NAME_SIZE];
+	gboolean send_native;
+	struct sr_rational scale;
+	struct sr_rational offset;
 };
 
 /* Header items used to process the input file. */
@@ -547,10 +556,10 @@ static float read_int_sample(struct sr_input *in, size_t offset)
 	}
 
 	/* Check if the loaded value is negative. */
-	if ((value & (1 << (8 * bytnr - 1))) != 0) {
+	if (bytnr < MAX_INT_BYTNR &&
+			(value & (INT64_C(1) << (8 * bytnr - 1))) != 0) {
 		/* Extend the 64-bit integer if the value is negative. */
-		i = ~((1 << (8 * bytnr - 1)) - 1);
-		value |= i;
+		value |= ~((INT64_C(1) << (8 * bytnr - 1)) - 1);
 	}
 
 	return (float)value;
@@ -565,7 +574,7 @@ static float read_unsigned_int_sample(struct sr_input *in, size_t offset)
 {
 	struct context *inc;
 	uint64_t value = 0;
-	char data[MAX_INT_BYTNR];
+	uint8_t data[MAX_INT_BYTNR];
 	int i;
 
 	inc = in->priv;
@@ -580,7 +589,7 @@ static float read_unsigned_int_sample(struct sr_input *in, size_t offset)
 			value |= data[i];
 		}
 	} else {
-		for (i = (int)inc->bytnr; i >= 0; i--) {
+		for (i = (int)inc->bytnr - 1; i >= 0; i--) {
 			value <<= 8;
 			value |= data[i];
 		}
@@ -626,6 +635,99 @@ static float read_float_sample(struct sr_input *in, size_t offset)
 	return fp.f;
 }
 
+/*
+ * Get the exact rational representation of a (single precision) value.
+ * Binary floating point values are fractions with a power of two as
+ * the denominator. Fails for magnitudes which don't fit 64bit numbers.
+ */
+static gboolean float_to_rational(struct sr_rational *r, double value)
+{
+	double mant;
+	int exp, shift;
+	int64_t p;
+	uint64_t q;
+
+	if (value == 0.0 || !isfinite(value)) {
+		sr_rational_set(r, 0, 1);
+		return value == 0.0;
+	}
+	mant = frexp(value, &exp);
+	p = (int64_t)llround(ldexp(mant, 24));
+	shift = 24 - exp;
+	if (shift < 0) {
+		if (-shift > 62 - 24)
+			return FALSE;
+		p *= INT64_C(1) << -shift;
+		shift = 0;
+	}
+	if (shift > 63)
+		return FALSE;
+	q = UINT64_C(1) << shift;
+	while (q > 1 && !(p & 1)) {
+		p /= 2;
+		q /= 2;
+	}
+	sr_rational_set(r, p, q);
+
+	return TRUE;
+}
+
+/*
+ * Check whether the curve data can be sent as is. Derive the scale
+ * and offset which apply to all raw values:
+ *   (raw - YOFF) * YMULT + YZERO = raw * YMULT + (YZERO - YOFF * YMULT)
+ */
+static gboolean check_native_format(struct context *inc)
+{
+	double offset;
+
+	if (inc->wfmtype != ANALOG)
+		return FALSE;
+	if (inc->bn_fmt == FP && inc->bytnr != FLOAT_BYTNR)
+		return FALSE;
+	if (inc->bn_fmt != FP && (inc->bytnr < 1 || inc->bytnr > 4))
+		return FALSE;
+	if (!float_to_rational(&inc->scale, inc->ymult))
+		return FALSE;
+	offset = (double)inc->yzero - (double)inc->yoff * inc->ymult;
+	if (!float_to_rational(&inc->offset, (float)offset))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Send a sample chunk in the file's native encoding. */
+static void send_chunk_native(struct sr_input *in,
+	size_t offset, size_t num_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct context *inc;
+
+	inc = in->priv;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	encoding.unitsize = inc->bytnr;
+	encoding.is_signed = inc->bn_fmt == RI;
+	encoding.is_float = inc->bn_fmt == FP;
+	encoding.is_bigendian = inc->byte_order == MSB;
+	encoding.scale = inc->scale;
+	encoding.offset = inc->offset;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	analog.num_samples = num_samples;
+	analog.data = in->buf->str + offset;
+	analog.meaning->channels = in->sdi->channels;
+	analog.meaning->mq = 0;
+	analog.meaning->mqflags = 0;
+	analog.meaning->unit = 0;
+
+	sr_session_send(in->sdi, &packet);
+}
+
 /* Send a sample chunk to the sigrok session. */
 static void send_chunk(struct sr_input *in, size_t initial_offset, size_t num_samples)
 {
@@ -639,6 +741,11 @@ static void send_chunk(struct sr_input *in, size_t initial_offset, size_t num_sa
 	size_t offset, i;
 
 	inc = in->priv;
+	if (inc->send_native) {
+		send_chunk_native(in, initial_offset, num_samples);
+		return;
+	}
+
 	offset = initial_offset;
 	fdata = g_malloc0(sizeof(float) * num_samples);
 	for (i = 0; i < num_samples; i++) {
@@ -762,6 +869,10 @@ static int receive(struct sr_input *in, GString *buf)
 			return SR_ERR_NA;
 		}
 
+		inc->send_native = check_native_format(inc);
+		sr_dbg("Sending %s sample data.",
+			inc->send_native ? "native" : "float");
+
 		/* Set default channel name if WFID couldn't be found. */
 		if (strlen(inc->channel_name) == 0)
 			snprintf(inc->channel_name, MAX_CHANNEL_NAME_SIZE, "CH");
@@ -811,6 +922,7 @@ SR_PRIV struct sr_input_module input_isf = {
 		.desc = "Tektronix isf format",
 		.exts = (const char *[]) {"isf", NULL},
 		.metadata = {SR_INPUT_META_FILENAME, SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED},
+		.header_size = MAX_HEADER_SIZE,
 		.format_match = format_match,
 		.init = init,
 		.receive = receive,
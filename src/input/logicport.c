@@ -415,32 +415,43 @@ static int process_inverted_channels(struct context *inc, char **flags)
 	return SR_OK;
 }
 
-static int process_sample_line(struct context *inc, char **values)
+static int process_sample_line(struct context *inc, const char *line)
 {
-	size_t count, idx;
+	size_t idx;
 	struct sample_data_entry *entry;
 	uint64_t mask;
+	const char *field;
+	size_t len;
 	long conv_ret;
 	int rc;
 
 	/*
-	 * The 'values' array contains '0'/'1' text representation of
-	 * wire's values, as well as a (a textual representation of a)
-	 * repeat counter for that set of samples.
+	 * The line contains comma separated '0'/'1' text representation
+	 * of wire's values, as well as a (a textual representation of a)
+	 * repeat counter for that set of samples. Scan the text in a
+	 * single pass, don't split it into allocated fields. This is the
+	 * hot path for huge exports.
 	 */
-	count = g_strv_length(values);
-	if (count != inc->channel_count + 1)
-		return SR_ERR_DATA;
 	entry = &inc->sample_data_queue[inc->sample_lines_read];
 	entry->bits = 0;
 	mask = UINT64_C(1);
 	for (idx = 0; idx < inc->channel_count; idx++, mask <<= 1) {
-		if (strcmp(values[idx], "1") == 0)
+		field = line;
+		while (*line && *line != ',')
+			line++;
+		if (!*line)
+			return SR_ERR_DATA;
+		len = line++ - field;
+		if (len != 1)
+			continue;
+		if (*field == '1')
 			entry->bits |= mask;
-		if (strcmp(values[idx], "U") == 0)
+		else if (*field == 'U')
 			inc->wires_undefined |= mask;
 	}
-	rc = sr_atol(values[inc->channel_count], &conv_ret);
+	if (strchr(line, ','))
+		return SR_ERR_DATA;
+	rc = sr_atol(line, &conv_ret);
 	if (rc != SR_OK)
 		return rc;
 	entry->repeat = conv_ret;
@@ -489,9 +500,7 @@ static int process_keyvalue_line(struct context *inc, char *line)
 	case SAMPLEDATA_DATA_LINES:
 		while (isspace(*line))
 			line++;
-		args = g_strsplit(line, ",", 0);
-		rc = process_sample_line(inc, args);
-		g_strfreev(args);
+		rc = process_sample_line(inc, line);
 		if (rc)
 			return rc;
 		inc->sample_lines_read++;
@@ -635,13 +644,12 @@ static int process_keyvalue_line(struct context *inc, char *line)
 }
 
 /* Check for, and isolate another line of text input. */
-static int have_text_line(struct sr_input *in, char **line, char **next)
+static int have_text_line(char *sol_ptr, char **line, char **next)
 {
-	char *sol_ptr, *eol_ptr;
+	char *eol_ptr;
 
-	if (!in || !in->buf || !in->buf->str)
+	if (!sol_ptr)
 		return 0;
-	sol_ptr = in->buf->str;
 	eol_ptr = strstr(sol_ptr, CRLF);
 	if (!eol_ptr)
 		return 0;
@@ -732,15 +740,25 @@ static int parse_header(struct sr_input *in)
 	char *line, *next;
 	int rc;
 
+	if (!in->buf || !in->buf->str)
+		return SR_OK;
+
+	/*
+	 * Walk all complete lines, and remove the consumed text from the
+	 * receive buffer in a single step. Erasing each line would move
+	 * the remaining buffer content for every sample line.
+	 */
 	inc = in->priv;
-	while (have_text_line(in, &line, &next)) {
+	rc = SR_OK;
+	next = in->buf->str;
+	while (have_text_line(next, &line, &next)) {
 		rc = process_text_line(inc, line);
-		g_string_erase(in->buf, 0, next - line);
 		if (rc)
-			return rc;
+			break;
 	}
+	g_string_erase(in->buf, 0, next - in->buf->str);
 
-	return SR_OK;
+	return rc;
 }
 
 /* Create sigrok channels and groups. */
@@ -863,7 +881,7 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 	struct context *inc;
 	uint8_t sample_buffer[sizeof(uint64_t)];
 	size_t idx;
-	size_t copy_count;
+	size_t copy_count, filled, todo;
 	uint8_t *p;
 	int rc;
 
@@ -878,12 +896,23 @@ static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
 			copy_count = count;
 		count -= copy_count;
 
+		/*
+		 * Put one sample into the buffer, then replicate the
+		 * already filled region. Keeps the number of memcpy()
+		 * calls logarithmic for long runs of the same value.
+		 */
 		p = inc->feed_buffer + inc->samples_in_buffer * inc->unitsize;
-		while (copy_count-- > 0) {
-			memcpy(p, sample_buffer, inc->unitsize);
-			p += inc->unitsize;
-			inc->samples_in_buffer++;
+		memcpy(p, sample_buffer, inc->unitsize);
+		filled = 1;
+		while (filled < copy_count) {
+			todo = copy_count - filled;
+			if (todo > filled)
+				todo = filled;
+			memcpy(p + filled * inc->unitsize, p,
+				todo * inc->unitsize);
+			filled += todo;
 		}
+		inc->samples_in_buffer += copy_count;
 
 		if (inc->samples_in_buffer == inc->samples_per_chunk) {
 			rc = send_buffer(in);
@@ -1166,6 +1195,7 @@ SR_PRIV struct sr_input_module input_logicport = {
 	.desc = "Intronix LA1034 LogicPort project",
 	.exts = (const char *[]){ "lpf", NULL },
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.header_size = 1024,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
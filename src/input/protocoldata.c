@@ -230,6 +230,7 @@
 #define LOG_PREFIX	"input/protocoldata"
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+#define TEMPLATES_MAX_SIZE	(64 * 1024 * 1024)
 
 /*
  * Support optional automatic file type detection. Support optionally
@@ -480,6 +481,24 @@ struct context {
 		uint8_t idle_levels;
 		uint8_t curr_levels;
 	} samples;
+	/*
+	 * Cache of rendered waveforms. Protocol handlers can tag a frame
+	 * with a key which (together with the traces' levels at the start
+	 * of the frame) fully determines its samples. Previously seen
+	 * frames then get sent by copying the cached sample data, instead
+	 * of walking the frame's bits again.
+	 */
+	struct {
+		GHashTable *frames;
+		size_t size;
+		gboolean pending;
+		guint key;
+		struct frame_template {
+			uint8_t end_levels;
+			size_t count;
+			uint8_t samples[];
+		} *hit;
+	} templates;
 	/* Internal state of the input text reader. */
 	struct {
 		int base;
@@ -697,6 +716,64 @@ static int wave_append_buffer(struct context *inc)
 	return wave_append_pattern(inc, inc->samples.curr_levels);
 }
 
+/*
+ * Check for a previously rendered waveform of the frame that is about
+ * to get constructed. The key must be unique for the protocol handler's
+ * frame content, and must be less than 2^24. When a template exists the
+ * caller can skip the waveform construction, send_frame() will use the
+ * cached samples. Otherwise send_frame() keeps the rendered samples for
+ * later use.
+ */
+static gboolean wave_template_select(struct context *inc, uint32_t key)
+{
+	struct frame_template *tpl;
+
+	if (!inc->templates.frames) {
+		inc->templates.frames = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+	}
+	inc->templates.key = (key << 8) | inc->samples.curr_levels;
+	inc->templates.pending = TRUE;
+	tpl = g_hash_table_lookup(inc->templates.frames,
+		GUINT_TO_POINTER(inc->templates.key));
+	inc->templates.hit = tpl;
+	if (!tpl)
+		return FALSE;
+
+	inc->samples.curr_levels = tpl->end_levels;
+	return TRUE;
+}
+
+/* Render the current waveform's samples, keep them as a template. */
+static struct frame_template *wave_template_create(struct context *inc)
+{
+	struct frame_template *tpl;
+	size_t count, index, width;
+	uint8_t *p;
+
+	count = 0;
+	for (index = 0; index < inc->top_frame_bits; index++)
+		count += inc->sample_widths[index];
+	tpl = g_malloc(sizeof(*tpl) + count);
+	tpl->end_levels = inc->samples.curr_levels;
+	tpl->count = count;
+	p = tpl->samples;
+	for (index = 0; index < inc->top_frame_bits; index++) {
+		width = inc->sample_widths[index];
+		memset(p, inc->sample_levels[index], width);
+		p += width;
+	}
+
+	if (inc->templates.size + count > TEMPLATES_MAX_SIZE)
+		return tpl;
+	inc->templates.size += count;
+	g_hash_table_insert(inc->templates.frames,
+		GUINT_TO_POINTER(inc->templates.key), tpl);
+	inc->templates.hit = tpl;
+
+	return tpl;
+}
+
 /* Send idle level before the first generated frame and at end of capture. */
 static int send_idle_capture(struct context *inc)
 {
@@ -748,10 +825,25 @@ static int send_frame(struct sr_input *in)
 	struct context *inc;
 	size_t count, index;
 	uint8_t data;
+	struct frame_template *tpl;
 	int ret;
 
 	inc = in->priv;
 
+	/* Use (and fill in) the template cache when the handler asked. */
+	if (inc->templates.pending) {
+		inc->templates.pending = FALSE;
+		tpl = inc->templates.hit;
+		if (!tpl)
+			tpl = wave_template_create(inc);
+		ret = feed_queue_logic_submit_many(inc->feed_logic,
+			tpl->samples, tpl->count);
+		if (tpl != inc->templates.hit)
+			g_free(tpl);
+		inc->templates.hit = NULL;
+		return ret;
+	}
+
 	for (index = 0; index < inc->top_frame_bits; index++) {
 		data = inc->sample_levels[index];
 		count = inc->sample_widths[index];
@@ -1029,7 +1121,8 @@ static int uart_proc_pseudo(struct sr_input *in, char *line)
  * IDLE frames, or complicate their construction and recovery afterwards.
  * A future implementation might as well support UART traffic on multiple
  * traces, including interleaved bidirectional communication. So let's
- * keep the implementation simple. Execution time is not a priority.
+ * keep the implementation simple. The waveform only depends on the data
+ * value, repeated values get sent from the template cache.
  */
 static int uart_proc_value(struct context *inc, uint32_t value)
 {
@@ -1042,6 +1135,10 @@ static int uart_proc_value(struct context *inc, uint32_t value)
 		return SR_ERR_ARG;
 	fmt_opts = &inc->curr_opts.frame_format.uart;
 
+	value &= (1UL << fmt_opts->databit_count) - 1;
+	if (wave_template_select(inc, value))
+		return SR_OK;
+
 	ret = wave_clear_sequence(inc);
 	if (ret != SR_OK)
 		return ret;
@@ -1329,6 +1426,7 @@ static int spi_write_frame_patterns(struct context *inc,
 	int ret;
 	uint8_t mosi_bit, miso_bit;
 	size_t bits;
+	uint32_t key;
 
 	if (!inc)
 		return SR_ERR_ARG;
@@ -1341,6 +1439,21 @@ static int spi_write_frame_patterns(struct context *inc,
 	if (incs->miso_is_fixed)
 		incs->miso_byte = incs->miso_fixed_value;
 
+	/*
+	 * Regular data frames without CS changes only depend on the data
+	 * bytes and the select state. Bits get shifted out completely.
+	 */
+	if (!idle && !cs_release) {
+		key = incs->mosi_byte;
+		key |= incs->miso_byte << 8;
+		key |= incs->cs_active ? (1UL << 16) : 0;
+		if (wave_template_select(inc, key)) {
+			incs->mosi_byte = 0;
+			incs->miso_byte = 0;
+			return SR_OK;
+		}
+	}
+
 	ret = wave_clear_sequence(inc);
 	if (ret != SR_OK)
 		return ret;
@@ -2379,6 +2492,9 @@ static int i2c_proc_value(struct context *inc, uint32_t value)
 		return SR_ERR_ARG;
 
 	with_ack = i2c_auto_ack_avail(inc);
+	value &= 0xff;
+	if (wave_template_select(inc, value | (with_ack ? 0x100 : 0)))
+		return 0;
 
 	ret = wave_clear_sequence(inc);
 	if (ret != SR_OK)
@@ -3523,6 +3639,10 @@ static void cleanup(struct sr_input *in)
 	inc->sample_levels = NULL;
 	g_free(inc->bit_scale);
 	inc->bit_scale = NULL;
+	if (inc->templates.frames)
+		g_hash_table_destroy(inc->templates.frames);
+	inc->templates.frames = NULL;
+	inc->templates.size = 0;
 }
 
 static int reset(struct sr_input *in)
@@ -3624,6 +3744,12 @@ SR_PRIV struct sr_input_module input_protocoldata = {
 	.desc = "Generate logic traces from protocol's data values",
 	.exts = (const char *[]){ "sr-protocol", "protocol", "bin", NULL, },
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.magics = (const char*[]){
+		MAGIC_FILE_TYPE,
+		"\xef\xbb\xbf" MAGIC_FILE_TYPE,
+		NULL,
+	},
+	.header_size = 128,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
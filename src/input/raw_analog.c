@@ -279,6 +279,18 @@ static int reset(struct sr_input *in)
 	return SR_OK;
 }
 
+static int seek(struct sr_input *in, uint64_t sample,
+		uint64_t *offset, size_t *sample_size)
+{
+	struct context *inc = in->priv;
+
+	g_string_truncate(in->buf, 0);
+	*offset = sample * inc->samplesize;
+	*sample_size = inc->samplesize;
+
+	return SR_OK;
+}
+
 SR_PRIV struct sr_input_module input_raw_analog = {
 	.id = "raw_analog",
 	.name = "RAW analog",
@@ -290,4 +302,5 @@ SR_PRIV struct sr_input_module input_raw_analog = {
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
+	.seek = seek,
 };
@@ -37,7 +37,11 @@
  * "special" file types like directories. Some of them will even actively
  * reject such input specs. Merging multiple exported channels into either
  * another input file or a sigrok session is supposed to be done outside
- * of this input module. Support for ZIP archives is currently missing.
+ * of this input module. The exception are the .sal save files of the
+ * Logic 2 application, which are ZIP archives with a digital-N.bin file
+ * per channel (plus analog data and a meta.json dictionary). These get
+ * buffered in memory, their digital channels get decoded in parallel,
+ * and merged into a single logic data stream.
  *
  * TODO
  * - Need to create a channel group in addition to channels?
@@ -45,18 +49,9 @@
  * - Fixup 'digits' use for analog data. The current implementation made
  *   an educated guess, assuming some 12bit resolution and logic levels
  *   which roughly results in the single digit mV range.
- * - Add support for "local I/O" in the input module when the common
- *   support code becomes available. The .sal save files of the Logic
- *   application appears to be a ZIP archive with *.bin files in it
- *   plus some meta.json dictionary. This will also introduce a new
- *   JSON reader dependency.
- * - When ZIP support gets added and .sal files become accepted, this
- *   import module needs to merge the content of several per-channel
- *   files, which may be of different types (mixed signal), and/or may
- *   even differ in their samplerate (which becomes complex, similar to
- *   VCD or CSV input). Given the .sal archive's layout this format may
- *   even only become attractive when common sigrok infrastructure has
- *   support for per-channel compression and rate(?).
+ * - The .sal archive support ignores analog data, and the meta.json
+ *   dictionary (which would introduce a JSON reader dependency). The
+ *   samplerate and the channel count need to get specified by the user.
  */
 
 #include <config.h>
@@ -64,6 +59,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <zip.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -71,13 +67,18 @@
 
 /*
  * Saleae Logic "save files" (ZIP archives with .sal file extension)
- * could get detected, but are not yet supported. Usability would be
- * rather limited when the current development support gets enabled.
- * This compile time switch is strictly for internal developer use.
+ * get opened from memory, which requires libzip 1.0 or later.
  */
+#if HAVE_ZIP_OPEN_FROM_SOURCE
+#define SALEAE_WITH_SAL_SUPPORT 1
+#else
 #define SALEAE_WITH_SAL_SUPPORT 0
+#endif
+
+#define SAL_ZIP_MAGIC "PK\x03\x04"
 
 #define CHUNK_SIZE  (4 * 1024 * 1024)
+#define RUNS_COUNT  4096
 
 #define LOGIC2_MAGIC "<SALEAE>"
 #define LOGIC2_VERSION 0
@@ -109,6 +110,7 @@ enum input_stage {
 	STAGE_L2D_CHANGE_VALUE,
 	STAGE_L2A_FIRST_VALUE,
 	STAGE_L2A_EVERY_VALUE,
+	STAGE_SAL_ARCHIVE,
 };
 
 struct context {
@@ -161,6 +163,14 @@ struct context {
 		uint8_t *buffer_digital;
 		float *buffer_analog;
 		uint8_t *write_pos;
+		gboolean chunk_uniform;
+		uint64_t chunk_value;
+		struct {
+			uint64_t *values;
+			uint64_t *lengths;
+			size_t count;
+			uint64_t samples;
+		} runs;
 		struct {
 			uint64_t stamp;
 			double time;
@@ -211,6 +221,7 @@ static int create_channels(struct sr_input *in)
 	switch (inc->logic_state.format) {
 	case FMT_LOGIC1_DIGITAL:
 	case FMT_LOGIC2_DIGITAL:
+	case FMT_LOGIC2_ARCHIVE:
 		type = SR_CHANNEL_LOGIC;
 		break;
 	case FMT_LOGIC1_ANALOG:
@@ -244,6 +255,7 @@ static int alloc_feed_buffer(struct sr_input *in)
 	switch (inc->logic_state.format) {
 	case FMT_LOGIC1_DIGITAL:
 	case FMT_LOGIC2_DIGITAL:
+	case FMT_LOGIC2_ARCHIVE:
 		inc->feed.unit_size = sizeof(inc->feed.last.digital);
 		alloc_size /= inc->feed.unit_size;
 		inc->feed.samples_per_chunk = alloc_size;
@@ -252,6 +264,12 @@ static int alloc_feed_buffer(struct sr_input *in)
 		if (!inc->feed.buffer_digital)
 			return SR_ERR_MALLOC;
 		inc->feed.write_pos = inc->feed.buffer_digital;
+		inc->feed.runs.values = g_try_malloc(RUNS_COUNT *
+			sizeof(inc->feed.runs.values[0]));
+		inc->feed.runs.lengths = g_try_malloc(RUNS_COUNT *
+			sizeof(inc->feed.runs.lengths[0]));
+		if (!inc->feed.runs.values || !inc->feed.runs.lengths)
+			return SR_ERR_MALLOC;
 		break;
 	case FMT_LOGIC1_ANALOG:
 	case FMT_LOGIC2_ANALOG:
@@ -287,6 +305,13 @@ static int relse_feed_buffer(struct sr_input *in)
 	g_free(inc->feed.buffer_analog);
 	inc->feed.buffer_analog = NULL;
 	inc->feed.write_pos = NULL;
+	inc->feed.chunk_uniform = FALSE;
+	g_free(inc->feed.runs.values);
+	inc->feed.runs.values = NULL;
+	g_free(inc->feed.runs.lengths);
+	inc->feed.runs.lengths = NULL;
+	inc->feed.runs.count = 0;
+	inc->feed.runs.samples = 0;
 
 	return SR_OK;
 }
@@ -310,7 +335,7 @@ static int setup_feed_buffer_channel(struct sr_input *in, size_t ch_idx)
 	return SR_OK;
 }
 
-static int flush_feed_buffer(struct sr_input *in)
+static int send_feed_buffer(struct sr_input *in)
 {
 	struct context *inc;
 	struct sr_datafeed_packet packet;
@@ -374,31 +399,152 @@ static int flush_feed_buffer(struct sr_input *in)
 	return sr_session_send(in->sdi, &packet);
 }
 
+/*
+ * Write a number of copies of a logic value to the sample buffer. The
+ * first unit gets encoded, the filled part then gets doubled until the
+ * requested count of samples was written.
+ */
+static int fill_feed_buffer_logic(struct sr_input *in,
+	uint64_t data, size_t count)
+{
+	struct context *inc;
+	uint8_t *start;
+	size_t total, filled, copy;
+
+	inc = in->priv;
+
+	if (!count)
+		return SR_OK;
+
+	start = inc->feed.write_pos;
+	if (inc->feed.unit_size == sizeof(uint64_t))
+		write_u64le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint32_t))
+		write_u32le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint16_t))
+		write_u16le_inc(&inc->feed.write_pos, data);
+	else if (inc->feed.unit_size == sizeof(uint8_t))
+		write_u8_inc(&inc->feed.write_pos, data);
+	else
+		return SR_ERR_BUG;
+	total = count * inc->feed.unit_size;
+	filled = inc->feed.unit_size;
+	while (filled < total) {
+		copy = MIN(filled, total - filled);
+		memcpy(&start[filled], start, copy);
+		filled += copy;
+	}
+	inc->feed.write_pos = &start[total];
+	inc->feed.samples_in_buffer += count;
+
+	return SR_OK;
+}
+
+/*
+ * Expand the pending run length segments to dense logic samples, and
+ * send sample buffers as they fill up. A buffer which got filled with
+ * a single value completely is re-sent as is for another full chunk of
+ * that value, long idle phases don't even cost memory bandwidth then.
+ */
+static int expand_feed_runs(struct sr_input *in)
+{
+	struct context *inc;
+	size_t idx, space, count;
+	uint64_t value, length;
+	gboolean full_chunk;
+	int rc;
+
+	inc = in->priv;
+
+	rc = SR_OK;
+	for (idx = 0; idx < inc->feed.runs.count; idx++) {
+		value = inc->feed.runs.values[idx];
+		length = inc->feed.runs.lengths[idx];
+		while (length) {
+			space = inc->feed.samples_per_chunk;
+			space -= inc->feed.samples_in_buffer;
+			count = MIN(length, space);
+			full_chunk = count == inc->feed.samples_per_chunk;
+			if (full_chunk && inc->feed.chunk_uniform &&
+					inc->feed.chunk_value == value) {
+				inc->feed.samples_in_buffer = count;
+				inc->feed.write_pos += count * inc->feed.unit_size;
+			} else {
+				rc = fill_feed_buffer_logic(in, value, count);
+				if (rc)
+					break;
+				inc->feed.chunk_uniform = full_chunk;
+				inc->feed.chunk_value = value;
+			}
+			length -= count;
+			if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk) {
+				rc = send_feed_buffer(in);
+				if (rc)
+					break;
+			}
+		}
+		if (rc)
+			break;
+	}
+	inc->feed.runs.count = 0;
+	inc->feed.runs.samples = 0;
+
+	return rc;
+}
+
+/* Send buffered samples, pending run length segments included. */
+static int flush_feed_buffer(struct sr_input *in)
+{
+	struct context *inc;
+	int rc;
+
+	inc = in->priv;
+
+	if (inc->feed.runs.count) {
+		rc = expand_feed_runs(in);
+		if (rc)
+			return rc;
+	}
+
+	return send_feed_buffer(in);
+}
+
+/*
+ * Queue a number of copies of a logic value as a run length segment.
+ * Expansion to dense samples is deferred until a packet's worth of
+ * samples is pending.
+ */
 static int addto_feed_buffer_logic(struct sr_input *in,
 	uint64_t data, size_t count)
 {
 	struct context *inc;
+	size_t idx;
+	int rc;
 
 	inc = in->priv;
 
 	if (inc->feed.is_analog)
 		return SR_ERR_ARG;
+	if (!count)
+		return SR_OK;
 
-	while (count--) {
-		if (inc->feed.unit_size == sizeof(uint64_t))
-			write_u64le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint32_t))
-			write_u32le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint16_t))
-			write_u16le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint8_t))
-			write_u8_inc(&inc->feed.write_pos, data);
-		else
-			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
-		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
-			flush_feed_buffer(in);
+	idx = inc->feed.runs.count;
+	if (idx && inc->feed.runs.values[idx - 1] == data) {
+		inc->feed.runs.lengths[idx - 1] += count;
+	} else {
+		if (idx == RUNS_COUNT) {
+			rc = expand_feed_runs(in);
+			if (rc)
+				return rc;
+			idx = 0;
+		}
+		inc->feed.runs.values[idx] = data;
+		inc->feed.runs.lengths[idx] = count;
+		inc->feed.runs.count = idx + 1;
 	}
+	inc->feed.runs.samples += count;
+	if (inc->feed.runs.samples >= inc->feed.samples_per_chunk)
+		return expand_feed_runs(in);
 
 	return SR_OK;
 }
@@ -433,14 +579,16 @@ static enum logic_format check_format(const uint8_t *data, size_t dlen)
 	const char *s;
 	uint32_t v, t;
 
-	/* TODO
-	 * Can we check ZIP content here in useful ways? Probably only
-	 * when the input module got extended to optionally handle local
-	 * file I/O, and passes some archive handle to this routine.
+	/*
+	 * ZIP archives are assumed to be .sal files. Their content only
+	 * gets inspected when the complete archive was received.
 	 */
+	s = (void *)data;
+	if (SALEAE_WITH_SAL_SUPPORT && dlen >= strlen(SAL_ZIP_MAGIC) &&
+			memcmp(s, SAL_ZIP_MAGIC, strlen(SAL_ZIP_MAGIC)) == 0)
+		return FMT_LOGIC2_ARCHIVE;
 
 	/* Check for the magic literal. */
-	s = (void *)data;
 	if (dlen < strlen(LOGIC2_MAGIC))
 		return FMT_UNKNOWN;
 	if (strncmp(s, LOGIC2_MAGIC, strlen(LOGIC2_MAGIC)) != 0)
@@ -657,8 +805,33 @@ static int parse_header(struct sr_input *in)
 		inc->logic_state.stage = STAGE_L2A_FIRST_VALUE;
 		break;
 	case FMT_LOGIC2_ARCHIVE:
-		sr_err("Support for .sal archives not implemented yet.");
-		return SR_ERR_NA;
+		if (!SALEAE_WITH_SAL_SUPPORT) {
+			sr_err("Support for .sal archives not available.");
+			return SR_ERR_NA;
+		}
+		/*
+		 * The archive's members only can get accessed when all of
+		 * it was received. Which channels to expect needs to get
+		 * specified (or is derived from the word size).
+		 */
+		channel_count = inc->logic_state.channel_count;
+		if (!channel_count) {
+			channel_count = inc->logic_state.word_size;
+			channel_count *= 8;
+			inc->logic_state.channel_count = channel_count;
+		}
+		if (channel_count > 8 * sizeof(inc->feed.last.digital)) {
+			sr_err("Excessive channel count %zu.", channel_count);
+			return SR_ERR_ARG;
+		}
+		if (!inc->logic_state.sample_rate) {
+			sr_err("Need a samplerate.");
+			return SR_ERR_ARG;
+		}
+		sr_dbg("SAL archive, chans %zu, rate %" PRIu64 ".",
+			channel_count, inc->logic_state.sample_rate);
+		inc->logic_state.stage = STAGE_SAL_ARCHIVE;
+		break;
 	default:
 		sr_err("Unknown or unsupported file format.");
 		return SR_ERR_NA;
@@ -871,6 +1044,329 @@ static int parse_samples(struct sr_input *in)
 	return SR_OK;
 }
 
+#if SALEAE_WITH_SAL_SUPPORT
+
+/* One digital channel of a .sal archive, decoded by a worker thread. */
+struct sal_channel {
+	const uint8_t *zip_data;
+	size_t zip_len;
+	size_t index;
+	uint64_t sample_rate;
+	gboolean found;
+	uint32_t init_state;
+	double begin_time, end_time;
+	uint64_t *stamps;
+	uint64_t stamp_count;
+	uint64_t shift;
+	uint64_t next_idx;
+	int ret;
+};
+
+/* Convert a timestamp to the number of whole sample periods. */
+static uint64_t sal_time_to_samples(double t, uint64_t rate)
+{
+	if (t <= 0.0)
+		return 0;
+	t *= rate;
+	t += 0.5;
+	return (uint64_t)t;
+}
+
+/*
+ * Parse a Logic 2 digital channel file (the format which binary exports
+ * use, too). Convert transition timestamps to sample numbers relative
+ * to the channel's begin time.
+ */
+static int sal_parse_digital(struct sal_channel *ch,
+	const uint8_t *data, size_t len)
+{
+	const uint8_t *read_pos;
+	size_t want_len;
+	uint64_t count, idx;
+	double t;
+
+	want_len = sizeof(uint64_t); /* magic */
+	want_len += 2 * sizeof(uint32_t); /* version, type */
+	want_len += sizeof(uint32_t); /* initial state */
+	want_len += 2 * sizeof(double); /* begin time, end time */
+	want_len += sizeof(uint64_t); /* transition count */
+	if (len < want_len)
+		return SR_ERR_DATA;
+	if (check_format(data, len) != FMT_LOGIC2_DIGITAL)
+		return SR_ERR_DATA;
+	read_pos = data;
+	(void)read_u64le_inc(&read_pos);
+	(void)read_u32le_inc(&read_pos);
+	(void)read_u32le_inc(&read_pos);
+	ch->init_state = read_u32le_inc(&read_pos);
+	ch->begin_time = read_dblle_inc(&read_pos);
+	ch->end_time = read_dblle_inc(&read_pos);
+	count = read_u64le_inc(&read_pos);
+	len -= read_pos - data;
+	if (count > len / sizeof(double))
+		return SR_ERR_DATA;
+
+	ch->stamps = g_try_malloc(count * sizeof(ch->stamps[0]));
+	if (count && !ch->stamps)
+		return SR_ERR_MALLOC;
+	for (idx = 0; idx < count; idx++) {
+		t = read_dblle_inc(&read_pos);
+		ch->stamps[idx] = sal_time_to_samples(t - ch->begin_time,
+			ch->sample_rate);
+	}
+	ch->stamp_count = count;
+
+	return SR_OK;
+}
+
+/*
+ * Open a private handle to the (memory resident) archive, and decode
+ * one channel's member. Each worker has its own handle, libzip archive
+ * handles must not be shared across threads.
+ */
+static int sal_read_channel(struct sal_channel *ch)
+{
+	static const char *name_fmts[] = { "digital-%zu.bin", "digital_%zu.bin", };
+
+	zip_error_t zerr;
+	zip_source_t *src;
+	zip_t *archive;
+	zip_int64_t entry;
+	zip_stat_t st;
+	zip_file_t *file;
+	char name[32];
+	size_t fmt_idx;
+	uint8_t *data;
+	int ret;
+
+	zip_error_init(&zerr);
+	src = zip_source_buffer_create(ch->zip_data, ch->zip_len, 0, &zerr);
+	archive = src ? zip_open_from_source(src, ZIP_RDONLY, &zerr) : NULL;
+	if (!archive) {
+		sr_err("Cannot open archive: %s.", zip_error_strerror(&zerr));
+		zip_source_free(src);
+		zip_error_fini(&zerr);
+		return SR_ERR_DATA;
+	}
+	zip_error_fini(&zerr);
+
+	entry = -1;
+	for (fmt_idx = 0; fmt_idx < ARRAY_SIZE(name_fmts); fmt_idx++) {
+		snprintf(name, sizeof(name), name_fmts[fmt_idx], ch->index);
+		entry = zip_name_locate(archive, name, 0);
+		if (entry >= 0)
+			break;
+	}
+	if (entry < 0) {
+		zip_discard(archive);
+		return SR_OK;
+	}
+	ch->found = TRUE;
+
+	ret = SR_ERR_DATA;
+	data = NULL;
+	file = NULL;
+	if (zip_stat_index(archive, entry, 0, &st) < 0)
+		goto out;
+	data = g_try_malloc(st.size);
+	if (st.size && !data) {
+		ret = SR_ERR_MALLOC;
+		goto out;
+	}
+	file = zip_fopen_index(archive, entry, 0);
+	if (!file)
+		goto out;
+	if (zip_fread(file, data, st.size) != (zip_int64_t)st.size)
+		goto out;
+	ret = sal_parse_digital(ch, data, st.size);
+	if (ret != SR_OK)
+		sr_err("Unsupported content in archive member %s.", name);
+
+out:
+	if (file)
+		zip_fclose(file);
+	g_free(data);
+	zip_discard(archive);
+
+	return ret;
+}
+
+static void sal_decode_channel(gpointer data, gpointer user_data)
+{
+	struct sal_channel *ch;
+
+	(void)user_data;
+
+	ch = data;
+	ch->ret = sal_read_channel(ch);
+}
+
+/* Get a channel's next transition's sample number. */
+static inline uint64_t sal_next_stamp(const struct sal_channel *ch)
+{
+	return ch->stamps[ch->next_idx] + ch->shift;
+}
+
+/* Restore the min-heap property of channels by their next transition. */
+static void sal_heap_down(struct sal_channel **heap, size_t count, size_t idx)
+{
+	struct sal_channel *ch;
+	size_t child;
+
+	ch = heap[idx];
+	while ((child = 2 * idx + 1) < count) {
+		if (child + 1 < count &&
+				sal_next_stamp(heap[child + 1]) < sal_next_stamp(heap[child]))
+			child++;
+		if (sal_next_stamp(ch) <= sal_next_stamp(heap[child]))
+			break;
+		heap[idx] = heap[child];
+		idx = child;
+	}
+	heap[idx] = ch;
+}
+
+/*
+ * Merge the channels' transitions into run length segments of logic
+ * values. A min-heap of the channels which have transitions left keeps
+ * the cost per transition at O(log N) for N channels. All transitions
+ * at the same sample number get applied before the segment up to the
+ * next transition gets queued.
+ */
+static int sal_merge_channels(struct sr_input *in,
+	struct sal_channel *chans, size_t count, uint64_t total)
+{
+	struct sal_channel **heap, *ch;
+	size_t heap_count, idx;
+	uint64_t value, pos, next;
+	int rc;
+
+	value = 0;
+	heap = g_malloc(count * sizeof(*heap));
+	heap_count = 0;
+	for (idx = 0; idx < count; idx++) {
+		ch = &chans[idx];
+		if (ch->init_state)
+			value |= UINT64_C(1) << idx;
+		if (ch->stamp_count)
+			heap[heap_count++] = ch;
+	}
+	for (idx = heap_count / 2; idx-- > 0; )
+		sal_heap_down(heap, heap_count, idx);
+
+	rc = SR_OK;
+	pos = 0;
+	while (pos < total) {
+		next = heap_count ? MIN(sal_next_stamp(heap[0]), total) : total;
+		rc = addto_feed_buffer_logic(in, value, next - pos);
+		if (rc)
+			break;
+		pos = next;
+		while (heap_count && sal_next_stamp(heap[0]) == pos) {
+			ch = heap[0];
+			value ^= UINT64_C(1) << ch->index;
+			if (++ch->next_idx == ch->stamp_count)
+				heap[0] = heap[--heap_count];
+			if (heap_count)
+				sal_heap_down(heap, heap_count, 0);
+		}
+	}
+	g_free(heap);
+
+	return rc;
+}
+
+/*
+ * Import the complete .sal archive which was accumulated in the receive
+ * buffer. The channels' members get decompressed and decoded by a pool
+ * of worker threads, the merge runs in the caller's thread.
+ */
+static int parse_archive(struct sr_input *in)
+{
+	struct context *inc;
+	struct sal_channel *chans, *ch;
+	GThreadPool *pool;
+	size_t count, idx, found;
+	double begin_time;
+	uint64_t total, end;
+	int rc;
+
+	inc = in->priv;
+	count = inc->logic_state.channel_count;
+	chans = g_malloc0(count * sizeof(*chans));
+	pool = g_thread_pool_new(sal_decode_channel, NULL,
+		(gint)MIN(count, g_get_num_processors()), FALSE, NULL);
+	for (idx = 0; idx < count; idx++) {
+		ch = &chans[idx];
+		ch->zip_data = (const uint8_t *)in->buf->str;
+		ch->zip_len = in->buf->len;
+		ch->index = idx;
+		ch->sample_rate = inc->logic_state.sample_rate;
+		if (pool)
+			g_thread_pool_push(pool, ch, NULL);
+		else
+			sal_decode_channel(ch, NULL);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	/*
+	 * Check for errors. Align the channels to a common start time,
+	 * and determine the total capture length.
+	 */
+	rc = SR_OK;
+	found = 0;
+	begin_time = 0.0;
+	for (idx = 0; idx < count; idx++) {
+		ch = &chans[idx];
+		if (ch->ret != SR_OK && rc == SR_OK)
+			rc = ch->ret;
+		if (!ch->found) {
+			sr_warn("No data for channel %zu in archive.", idx);
+			continue;
+		}
+		if (!found++ || begin_time > ch->begin_time)
+			begin_time = ch->begin_time;
+	}
+	if (rc == SR_OK && !found) {
+		sr_err("No digital channels found in archive.");
+		rc = SR_ERR_DATA;
+	}
+	total = 0;
+	for (idx = 0; rc == SR_OK && idx < count; idx++) {
+		ch = &chans[idx];
+		if (!ch->found)
+			continue;
+		ch->shift = sal_time_to_samples(ch->begin_time - begin_time,
+			ch->sample_rate);
+		end = sal_time_to_samples(ch->end_time - begin_time,
+			ch->sample_rate);
+		if (total < end)
+			total = end;
+	}
+
+	if (rc == SR_OK)
+		rc = sal_merge_channels(in, chans, count, total);
+
+	for (idx = 0; idx < count; idx++)
+		g_free(chans[idx].stamps);
+	g_free(chans);
+	g_string_truncate(in->buf, 0);
+
+	return rc;
+}
+
+#else
+
+static int parse_archive(struct sr_input *in)
+{
+	(void)in;
+
+	return SR_ERR_NA;
+}
+
+#endif
+
 /*
  * Try to auto detect an input's file format. Mismatch is non-fatal.
  * Silent operation by design. Not all details need to be available.
@@ -1040,9 +1536,14 @@ static int end(struct sr_input *in)
 
 	/*
 	 * Process input data which may not have been inspected before.
+	 * Archives only can get processed after all input was received.
 	 * Flush any potentially queued samples.
 	 */
-	rc = parse_samples(in);
+	inc = in->priv;
+	if (inc->logic_state.stage == STAGE_SAL_ARCHIVE)
+		rc = parse_archive(in);
+	else
+		rc = parse_samples(in);
 	if (rc)
 		return rc;
 	rc = flush_feed_buffer(in);
@@ -1050,7 +1551,6 @@ static int end(struct sr_input *in)
 		return rc;
 
 	/* End the session feed if one was started. */
-	inc = in->priv;
 	if (inc->module_state.header_sent) {
 		rc = std_session_send_df_end(in->sdi);
 		if (rc)
@@ -1151,7 +1651,7 @@ static struct sr_option options[] = {
 	},
 	[OPT_SAMPLERATE] = {
 		"samplerate", "Samplerate.",
-		"The samplerate. Needed when the file content lacks this information.",
+		"The samplerate. Needed when the file content lacks this information. For transition based formats (logic2-digital, archives) this is the output rate, lower rates downsample on the fly.",
 		NULL, NULL,
 	},
 	[OPT_MAX] = ALL_ZERO,
@@ -1205,6 +1705,7 @@ SR_PRIV struct sr_input_module input_saleae = {
 		SR_INPUT_META_FILENAME,
 		SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED
 	},
+	.header_size = LOGIC2_MIN_SIZE,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
@@ -143,6 +143,13 @@
  */
 #define CHUNKSIZE		(4 * 1024 * 1024)
 
+/*
+ * Records are compressed independently. With several decoder threads
+ * records get checked and uncompressed in parallel, up to this many
+ * records per thread are decoded ahead of their in order processing.
+ */
+#define STF_RECORDS_PER_THREAD	2
+
 /*
  * A chunk is associated with 32 bytes of information, and contains
  * 64 clusters with one 64bit timestamp and 7 sample data items of
@@ -190,8 +197,16 @@ struct context {
 	} record_data;
 	struct keep_specs {
 		uint64_t sample_rate;
+		size_t threads;
 		GSList *prev_sr_channels;
 	} keep;
+	struct stf_parallel {
+		GThreadPool *pool;
+		GMutex mutex;
+		GCond done_cond;
+		GQueue jobs;
+		int error;
+	} parallel;
 	struct {
 		uint64_t sample_rate;	/* User specified or from header. */
 		uint64_t sample_count;	/* Samples count as per header. */
@@ -201,6 +216,7 @@ struct context {
 		size_t bits_per_sample;	/* 1x 16, 2x 8, or 4x 4 per 16bit. */
 		size_t unit_size;
 		uint16_t curr_data;	/* Current sample data. */
+		uint16_t xlat[4][2][256]; /* Sample set, input byte to channels. */
 		struct feed_queue_logic *feed;	/* Session feed helper. */
 	} submit;
 };
@@ -527,6 +543,94 @@ static int eval_header(const struct sr_input *in)
 	return SR_OK;
 }
 
+/*
+ * Get one or several sample sets from a 16bit raw sample memory item.
+ * Ideally would be shared with the asix-sigma driver source files. But
+ * is kept private to each of them so that the compiler can optimize the
+ * hot code path to a maximum extent.
+ */
+static uint16_t get_sample_bits_16(uint16_t indata)
+{
+	return indata;
+}
+
+static uint16_t get_sample_bits_8(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+
+	indata >>= idx;
+	outdata = 0;
+	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
+	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
+	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
+	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
+	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
+	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
+	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
+	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
+	return outdata;
+}
+
+static uint16_t get_sample_bits_4(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+
+	indata >>= idx;
+	outdata = 0;
+	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
+	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
+	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
+	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
+	return outdata;
+}
+
+/*
+ * Prepare the translation from input bits to sigrok channel bits. The
+ * extraction of a sample set from a 16bit memory item and the mapping
+ * of its bits to channels are combined in one table per sample set and
+ * input byte. Both steps are bitwise, so the lookup results for the low
+ * and high byte just get OR-ed. This replaces the shift cascade and the
+ * iteration over the list of channels for every sample.
+ */
+static uint16_t map_sample_bits(struct context *inc,
+	uint16_t indata, size_t idx)
+{
+	switch (inc->submit.bits_per_sample) {
+	case 16:
+		return get_sample_bits_16(indata);
+	case 8:
+		return get_sample_bits_8(indata, idx);
+	case 4:
+		return get_sample_bits_4(indata, idx);
+	}
+	return 0;
+}
+
+static void build_remap_table(struct context *inc)
+{
+	GSList *l;
+	struct stf_channel *ch;
+	size_t set_idx, set_count, byte_idx, value;
+	uint16_t bits, *entry;
+
+	memset(inc->submit.xlat, 0, sizeof(inc->submit.xlat));
+	set_count = 16 / inc->submit.bits_per_sample;
+	for (set_idx = 0; set_idx < set_count; set_idx++) {
+		for (byte_idx = 0; byte_idx < 2; byte_idx++) {
+			for (value = 0; value < 256; value++) {
+				bits = value << (8 * byte_idx);
+				bits = map_sample_bits(inc, bits, set_idx);
+				entry = &inc->submit.xlat[set_idx][byte_idx][value];
+				for (l = inc->channels; l; l = l->next) {
+					ch = l->data;
+					if (bits & ch->src_bitmask)
+						*entry |= ch->dst_bitmask;
+				}
+			}
+		}
+	}
+}
+
 /* Preare datafeed submission in the DATA phase. */
 static int data_enter(const struct sr_input *in)
 {
@@ -558,6 +662,7 @@ static int data_enter(const struct sr_input *in)
 	if (!inc->channel_count)
 		return SR_ERR_DATA;
 	inc->submit.unit_size = (inc->channel_count + 8 - 1) / 8;
+	build_remap_table(inc);
 	inc->submit.feed = feed_queue_logic_alloc(in->sdi,
 		CHUNKSIZE, inc->submit.unit_size);
 	if (!inc->submit.feed)
@@ -776,70 +881,12 @@ static int parse_header(struct sr_input *in)
 	return SR_OK;
 }
 
-/*
- * Get one or several sample sets from a 16bit raw sample memory item.
- * Ideally would be shared with the asix-sigma driver source files. But
- * is kept private to each of them so that the compiler can optimize the
- * hot code path to a maximum extent.
- */
-static uint16_t get_sample_bits_16(uint16_t indata)
-{
-	return indata;
-}
-
-static uint16_t get_sample_bits_8(uint16_t indata, int idx)
-{
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
-}
-
-static uint16_t get_sample_bits_4(uint16_t indata, int idx)
-{
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
-}
-
-/* Map from Sigma file bit position to sigrok channel bit position. */
-static uint16_t map_input_chans(struct sr_input *in, uint16_t bits)
-{
-	struct context *inc;
-	uint16_t data;
-	GSList *l;
-	struct stf_channel *ch;
-
-	inc = in->priv;
-	data = 0;
-	for (l = inc->channels; l; l = l->next) {
-		ch = l->data;
-		if (bits & ch->src_bitmask)
-			data |= ch->dst_bitmask;
-	}
-	return data;
-}
-
 /* Forward one 16bit entity to the session feed. */
 static void xlat_send_sample_data(struct sr_input *in, uint16_t indata)
 {
 	struct context *inc;
-	uint16_t bits, data;
+	uint16_t lo, hi, data;
+	size_t set_idx;
 
 	/*
 	 * Depending on the sample rate the memory layout for sample
@@ -852,41 +899,30 @@ static void xlat_send_sample_data(struct sr_input *in, uint16_t indata)
 	 * the next sample's timestamp is not adjacent to the current.
 	 */
 	inc = in->priv;
+	lo = inc->submit.xlat[0][0][indata & 0xff];
+	hi = inc->submit.xlat[0][1][indata >> 8];
+	data = lo | hi;
 	switch (inc->submit.bits_per_sample) {
 	case 16:
-		bits = get_sample_bits_16(indata);
-		data = map_input_chans(in, bits);
 		add_sample(in, data, 1);
-		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
 		break;
 	case 8:
-		bits = get_sample_bits_8(indata, 0);
-		data = map_input_chans(in, bits);
 		add_sample(in, data, 1);
-		bits = get_sample_bits_8(indata, 1);
-		data = map_input_chans(in, bits);
+		data = inc->submit.xlat[1][0][indata & 0xff] |
+			inc->submit.xlat[1][1][indata >> 8];
 		add_sample(in, data, 1);
-		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
 		break;
 	case 4:
-		bits = get_sample_bits_4(indata, 0);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 1);
-		data = map_input_chans(in, bits);
 		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 2);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		bits = get_sample_bits_4(indata, 3);
-		data = map_input_chans(in, bits);
-		add_sample(in, data, 1);
-		inc->submit.last_submit_ts++;
-		inc->submit.curr_data = data;
+		for (set_idx = 1; set_idx < 4; set_idx++) {
+			data = inc->submit.xlat[set_idx][0][indata & 0xff] |
+				inc->submit.xlat[set_idx][1][indata >> 8];
+			add_sample(in, data, 1);
+		}
 		break;
 	}
+	inc->submit.last_submit_ts++;
+	inc->submit.curr_data = data;
 }
 
 /* Parse one "chunk" of a "record" of the file. */
@@ -1024,16 +1060,177 @@ static int stf_parse_data_record(struct sr_input *in, struct stf_record *rec)
 	return SR_OK;
 }
 
+/*
+ * Check a record's (compressed) payload, and uncompress it. Does not
+ * access the input module's context, runs in decoder threads.
+ */
+static int stf_decode_record(const uint8_t *compressed, size_t len,
+	uint32_t crc, struct stf_record *rec)
+{
+	uint32_t crc_calc;
+	lzo_uint raw_len;
+	int rc;
+
+	crc_calc = crc32(0, compressed, len);
+	sr_spew("DBG: CRC32 calc comp 0x%08lx.",
+		(unsigned long)crc_calc);
+	if (crc_calc != crc) {
+		sr_err("Data: Record payload CRC mismatch.");
+		return SR_ERR_DATA;
+	}
+
+	raw_len = sizeof(rec->raw);
+	memset(&rec->raw, 0, sizeof(rec->raw));
+	rc = lzo1x_decompress_safe(compressed, len, rec->raw, &raw_len, NULL);
+	if (rc) {
+		sr_err("Data: Decompression error %d.", rc);
+		return SR_ERR_DATA;
+	}
+	if (raw_len > sizeof(rec->raw)) {
+		sr_err("Data: Excessive decompressed size %zu.",
+			(size_t)raw_len);
+		return SR_ERR_DATA;
+	}
+	rec->len = raw_len;
+	sr_spew("Data: Uncompressed record, len %zu.", rec->len);
+
+	return SR_OK;
+}
+
+/* A record which gets decoded by a thread of the pool. */
+struct stf_job {
+	uint8_t *compressed;
+	size_t len;
+	uint32_t crc;
+	struct stf_record *record;
+	int ret;
+	gboolean done;
+};
+
+static void free_job(struct stf_job *job)
+{
+	g_free(job->compressed);
+	g_free(job->record);
+	g_free(job);
+}
+
+static void decode_job(gpointer data, gpointer user_data)
+{
+	struct stf_job *job;
+	struct context *inc;
+
+	job = data;
+	inc = user_data;
+
+	job->ret = stf_decode_record(job->compressed, job->len,
+		job->crc, job->record);
+
+	g_mutex_lock(&inc->parallel.mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&inc->parallel.done_cond);
+	g_mutex_unlock(&inc->parallel.mutex);
+}
+
+/*
+ * Process decoded records in file order, until at most the given number
+ * of records is pending. Waits for the oldest record's decoder.
+ */
+static int apply_jobs(struct sr_input *in, size_t keep)
+{
+	struct context *inc;
+	struct stf_job *job;
+	int ret;
+
+	inc = in->priv;
+	if (!inc->parallel.pool)
+		return SR_OK;
+
+	ret = inc->parallel.error;
+	g_mutex_lock(&inc->parallel.mutex);
+	while ((job = g_queue_peek_head(&inc->parallel.jobs))) {
+		if (!job->done) {
+			if (g_queue_get_length(&inc->parallel.jobs) <= keep)
+				break;
+			g_cond_wait(&inc->parallel.done_cond,
+				&inc->parallel.mutex);
+			continue;
+		}
+		g_queue_pop_head(&inc->parallel.jobs);
+		g_mutex_unlock(&inc->parallel.mutex);
+		if (ret == SR_OK)
+			ret = job->ret;
+		if (ret == SR_OK)
+			ret = stf_parse_data_record(in, job->record);
+		free_job(job);
+		g_mutex_lock(&inc->parallel.mutex);
+	}
+	g_mutex_unlock(&inc->parallel.mutex);
+	inc->parallel.error = ret;
+
+	return ret;
+}
+
+/* Have a record decoded in the background. */
+static int push_job(struct sr_input *in,
+	const uint8_t *compressed, size_t len, uint32_t crc)
+{
+	struct context *inc;
+	struct stf_job *job;
+	GError *error;
+
+	inc = in->priv;
+
+	if (!inc->parallel.pool) {
+		g_mutex_init(&inc->parallel.mutex);
+		g_cond_init(&inc->parallel.done_cond);
+		g_queue_init(&inc->parallel.jobs);
+		error = NULL;
+		inc->parallel.pool = g_thread_pool_new(decode_job, inc,
+			inc->keep.threads, FALSE, &error);
+		if (!inc->parallel.pool) {
+			sr_err("Cannot create decoder threads: %s.",
+				error->message);
+			g_error_free(error);
+			return SR_ERR;
+		}
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->compressed = g_memdup2(compressed, len);
+	job->len = len;
+	job->crc = crc;
+	job->record = g_malloc(sizeof(*job->record));
+	g_mutex_lock(&inc->parallel.mutex);
+	g_queue_push_tail(&inc->parallel.jobs, job);
+	g_mutex_unlock(&inc->parallel.mutex);
+	g_thread_pool_push(inc->parallel.pool, job, NULL);
+
+	return apply_jobs(in, STF_RECORDS_PER_THREAD * inc->keep.threads);
+}
+
+static void cleanup_parallel(struct context *inc)
+{
+	struct stf_job *job;
+
+	if (!inc->parallel.pool)
+		return;
+
+	g_thread_pool_free(inc->parallel.pool, FALSE, TRUE);
+	inc->parallel.pool = NULL;
+	while ((job = g_queue_pop_head(&inc->parallel.jobs)))
+		free_job(job);
+	g_cond_clear(&inc->parallel.done_cond);
+	g_mutex_clear(&inc->parallel.mutex);
+}
+
 /* Parse the "data" section of the file (sample data). */
 static int parse_file_data(struct sr_input *in)
 {
 	struct context *inc;
 	size_t len, final_len;
-	uint32_t crc, crc_calc;
+	uint32_t crc;
 	size_t have_len, want_len;
 	const uint8_t *read_ptr;
-	void *compressed;
-	lzo_uint raw_len;
 	int rc;
 
 	inc = in->priv;
@@ -1062,7 +1259,6 @@ static int parse_file_data(struct sr_input *in)
 		 * Wait for record data to become available. Check for
 		 * the availability of a header, get the payload size
 		 * from the header, check for the data's availability.
-		 * Check the CRC of the (compressed) payload data.
 		 */
 		have_len = in->buf->len;
 		if (have_len < STF_DATA_REC_HDRLEN) {
@@ -1076,7 +1272,7 @@ static int parse_file_data(struct sr_input *in)
 			sr_dbg("Data: Last record seen.");
 			g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN);
 			inc->file_stage = STF_STAGE_DONE;
-			return SR_OK;
+			return apply_jobs(in, 0);
 		}
 		sr_dbg("Data: Record header, len %zu, crc 0x%08lx.",
 			len, (unsigned long)crc);
@@ -1084,43 +1280,30 @@ static int parse_file_data(struct sr_input *in)
 			sr_err("Data: Illegal record length %zu.", len);
 			return SR_ERR_DATA;
 		}
-		inc->record_data.len = len;
-		inc->record_data.crc = crc;
-		want_len = inc->record_data.len;
+		want_len = len;
 		if (have_len < STF_DATA_REC_HDRLEN + want_len) {
 			sr_dbg("Data: Need more receive data (payload).");
 			return SR_OK;
 		}
-		crc_calc = crc32(0, read_ptr, want_len);
-		sr_spew("DBG: CRC32 calc comp 0x%08lx.",
-			(unsigned long)crc_calc);
-		if (crc_calc != inc->record_data.crc) {
-			sr_err("Data: Record payload CRC mismatch.");
-			return SR_ERR_DATA;
-		}
 
 		/*
-		 * Uncompress the payload data, have the record processed.
-		 * Drop the compressed receive data from the input buffer.
+		 * Have the payload data checked and uncompressed, and the
+		 * record processed. Either in the background (processing
+		 * stays in order), or right here. Drop the compressed
+		 * receive data from the input buffer.
 		 */
-		compressed = (void *)read_ptr;
-		raw_len = sizeof(inc->record_data.raw);
-		memset(&inc->record_data.raw, 0, sizeof(inc->record_data.raw));
-		rc = lzo1x_decompress_safe(compressed, want_len,
-			inc->record_data.raw, &raw_len, NULL);
-		g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
-		if (rc) {
-			sr_err("Data: Decompression error %d.", rc);
-			return SR_ERR_DATA;
-		}
-		if (raw_len > sizeof(inc->record_data.raw)) {
-			sr_err("Data: Excessive decompressed size %zu.",
-				(size_t)raw_len);
-			return SR_ERR_DATA;
+		if (inc->keep.threads > 1) {
+			rc = push_job(in, read_ptr, want_len, crc);
+			g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
+			if (rc != SR_OK)
+				return rc;
+			continue;
 		}
-		inc->record_data.len = raw_len;
-		sr_spew("Data: Uncompressed record, len %zu.",
-			inc->record_data.len);
+		rc = stf_decode_record(read_ptr, want_len, crc,
+			&inc->record_data);
+		if (rc != SR_OK)
+			return rc;
+		g_string_erase(in->buf, 0, STF_DATA_REC_HDRLEN + want_len);
 		rc = stf_parse_data_record(in, &inc->record_data);
 		if (rc != SR_OK)
 			return rc;
@@ -1260,6 +1443,8 @@ static int init(struct sr_input *in, GHashTable *options)
 	var = g_hash_table_lookup(options, "samplerate");
 	sample_rate = g_variant_get_uint64(var);
 	inc->keep.sample_rate = sample_rate;
+	var = g_hash_table_lookup(options, "threads");
+	inc->keep.threads = g_variant_get_uint32(var);
 
 	return SR_OK;
 }
@@ -1289,6 +1474,8 @@ static int end(struct sr_input *in)
 	 * session end packet if a session start was sent before.
 	 */
 	ret = process_data(in);
+	if (ret == SR_OK)
+		ret = apply_jobs(in, 0);
 	if (ret != SR_OK)
 		return ret;
 
@@ -1308,6 +1495,7 @@ static void cleanup(struct sr_input *in)
 	/* Release dynamically allocated resources. */
 	inc = in->priv;
 
+	cleanup_parallel(inc);
 	g_slist_free_full(inc->channels, free_channel);
 	feed_queue_logic_free(inc->submit.feed);
 	inc->submit.feed = NULL;
@@ -1337,6 +1525,7 @@ static int reset(struct sr_input *in)
 
 enum option_index {
 	OPT_SAMPLERATE,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1346,6 +1535,12 @@ static struct sr_option options[] = {
 		"The input data's sample rate in Hz. No default value.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Decoder threads",
+		"Number of threads which check and uncompress data records in parallel. "
+		"Values 0 and 1 decode records in the caller's thread.",
+		NULL, NULL,
+	},
 	ALL_ZERO,
 };
 
@@ -1356,6 +1551,8 @@ static const struct sr_option *get_options(void)
 	if (!options[0].def) {
 		var = g_variant_new_uint64(0);
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(var);
+		var = g_variant_new_uint32(0);
+		options[OPT_THREADS].def = g_variant_ref_sink(var);
 	}
 
 	return options;
@@ -1370,6 +1567,7 @@ SR_PRIV struct sr_input_module input_stf = {
 		SR_INPUT_META_FILENAME | SR_INPUT_META_REQUIRED,
 		SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED,
 	},
+	.header_size = STF_MAGIC_LENGTH,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
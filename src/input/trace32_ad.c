@@ -86,6 +86,11 @@ enum ad_compr {
 	AD_COMPR_QCOMP = 6, /* File created with /COMPRESS or /QUICKCOMPRESS */
 };
 
+/* Location of a PowerIntegrator pod's data and clock in a record. */
+struct pi_pod {
+	uint8_t data_offset, clk_offset, clk_bit;
+};
+
 struct context {
 	gboolean meta_sent;
 	gboolean header_read, records_read, trigger_sent;
@@ -95,6 +100,9 @@ struct context {
 	enum ad_compr compression;
 	char pod_status[MAX_POD_COUNT];
 	struct sr_channel *channels[MAX_POD_COUNT][17]; /* 16 + CLK */
+	int unit_size;
+	struct pi_pod pi_pods[MAX_POD_COUNT];
+	int pi_pod_count;
 	uint64_t trigger_timestamp;
 	uint32_t header_size, record_size, record_count, cur_record;
 	int32_t last_record;
@@ -403,6 +411,64 @@ static void create_channels(struct sr_input *in)
 			sr_channel_new(in->sdi, chan_id, SR_CHANNEL_LOGIC, TRUE, name);
 		chan_id++;
 	}
+	inc->unit_size = (chan_id + 7) / 8;
+}
+
+/*
+ * Prepare the extraction of PowerIntegrator pod data. Get the enabled
+ * pods' offsets of their data and clock fields in a record, such that
+ * records need not get inspected pod by pod with a case for each pod.
+ */
+static void setup_pi_pods(struct context *inc)
+{
+	int pod, pod_count, clk_offset, idx;
+
+	if (inc->record_mode == AD_MODE_500MHZ) {
+		pod_count = 6;
+		clk_offset = 0x18;
+	} else {
+		pod_count = 12;
+		clk_offset = 0x28;
+	}
+
+	idx = 0;
+	for (pod = 0; pod < pod_count; pod++) {
+		if (!inc->pod_status[pod])
+			continue;
+		if (pod < 6) {
+			/* A..F */
+			inc->pi_pods[idx].data_offset = 0x08 + 2 * pod;
+			inc->pi_pods[idx].clk_offset = clk_offset;
+		} else {
+			/* J..O */
+			inc->pi_pods[idx].data_offset = 0x18 + 2 * (pod - 6);
+			inc->pi_pods[idx].clk_offset = 0x29;
+		}
+		inc->pi_pods[idx].clk_bit = pod % 6;
+		idx++;
+	}
+	inc->pi_pod_count = idx;
+}
+
+/* Append a number of copies of a sample to the output buffer. */
+static void append_samples(GString *out, const char *sample, size_t len,
+	size_t count)
+{
+	size_t start, total, filled, copy;
+
+	if (!count)
+		return;
+
+	start = out->len;
+	total = len * count;
+	g_string_append_len(out, sample, len);
+	g_string_set_size(out, start + total);
+	filled = len;
+	while (filled < total) {
+		copy = MIN(filled, total - filled);
+		memcpy(&out->str[start + filled], &out->str[start], copy);
+		filled += copy;
+	}
 }
 
 static void send_metadata(struct sr_input *in)
@@ -440,10 +506,11 @@ static void process_record_pi(struct sr_input *in, gsize start)
 	struct context *inc;
 	uint64_t timestamp, next_timestamp;
 	uint32_t pod_data;
+	uint64_t acc;
 	char single_payload[12 * 3];
 	GString *buf;
-	int i, pod_count, clk_offset, packet_count, pod;
-	int payload_bit, payload_len, value;
+	int idx, packet_count, acc_bits, payload_len;
+	const struct pi_pod *pod;
 
 	inc = in->priv;
 	buf = in->buf;
@@ -473,96 +540,33 @@ static void process_record_pi(struct sr_input *in, gsize start)
 
 	timestamp = RL64(buf->str + start);
 
-	if (inc->record_mode == AD_MODE_500MHZ) {
-		pod_count = 6;
-		clk_offset = 0x18;
-	} else {
-		pod_count = 12;
-		clk_offset = 0x28;
-	}
-
-	payload_bit = 0;
+	/*
+	 * Each enabled pod contributes 17 bits (16 data bits and the clock)
+	 * to the sample. Collect them in an accumulator and emit whole
+	 * bytes, instead of transferring the sample bit by bit.
+	 */
 	payload_len = 0;
-	single_payload[0] = 0;
-
-	for (pod = 0; pod < pod_count; pod++) {
-		if (!inc->pod_status[pod])
-			continue;
-
-		switch (pod) {
-		case 0: /* A */
-			pod_data = RL16(buf->str + start + 0x08);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 1) << 16;
-			break;
-		case 1: /* B */
-			pod_data = RL16(buf->str + start + 0x0A);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 2) << 15;
-			break;
-		case 2: /* C */
-			pod_data = RL16(buf->str + start + 0x0C);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 4) << 14;
-			break;
-		case 3: /* D */
-			pod_data = RL16(buf->str + start + 0x0E);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 8) << 13;
-			break;
-		case 4: /* E */
-			pod_data = RL16(buf->str + start + 0x10);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 16) << 12;
-			break;
-		case 5: /* F */
-			pod_data = RL16(buf->str + start + 0x12);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 32) << 11;
-			break;
-		case 6: /* J */
-			pod_data = RL16(buf->str + start + 0x18);
-			pod_data |= (RL16(buf->str + start + 0x29) & 1) << 16;
-			break;
-		case 7: /* K */
-			pod_data = RL16(buf->str + start + 0x1A);
-			pod_data |= (RL16(buf->str + start + 0x29) & 2) << 15;
-			break;
-		case 8: /* L */
-			pod_data = RL16(buf->str + start + 0x1C);
-			pod_data |= (RL16(buf->str + start + 0x29) & 4) << 14;
-			break;
-		case 9: /* M */
-			pod_data = RL16(buf->str + start + 0x1E);
-			pod_data |= (RL16(buf->str + start + 0x29) & 8) << 13;
-			break;
-		case 10: /* N */
-			pod_data = RL16(buf->str + start + 0x20);
-			pod_data |= (RL16(buf->str + start + 0x29) & 16) << 12;
-			break;
-		case 11: /* O */
-			pod_data = RL16(buf->str + start + 0x22);
-			pod_data |= (RL16(buf->str + start + 0x29) & 32) << 11;
-			break;
-		default:
-			pod_data = 0;
-			sr_err("Don't know how to obtain data for pod %d.", pod);
-		}
-
-		for (i = 0; i < 17; i++) {
-			value = (pod_data >> i) & 1;
-			single_payload[payload_len] |= value << payload_bit;
-
-			payload_bit++;
-			if (payload_bit > 7) {
-				payload_bit = 0;
-				payload_len++;
-				single_payload[payload_len] = 0;
-			}
+	acc = 0;
+	acc_bits = 0;
+	for (idx = 0; idx < inc->pi_pod_count; idx++) {
+		pod = &inc->pi_pods[idx];
+		pod_data = RL16(buf->str + start + pod->data_offset);
+		pod_data |= ((RL16(buf->str + start + pod->clk_offset)
+			>> pod->clk_bit) & 1) << 16;
+		acc |= (uint64_t)pod_data << acc_bits;
+		acc_bits += 17;
+		while (acc_bits >= 8) {
+			single_payload[payload_len++] = acc & 0xff;
+			acc >>= 8;
+			acc_bits -= 8;
 		}
 	}
+	if (acc_bits)
+		single_payload[payload_len++] = acc & 0xff;
 
-	/* Make sure that payload_len accounts for any incomplete bytes used. */
-	if (payload_bit)
-		payload_len++;
-
-	i = (g_slist_length(in->sdi->channels) + 7) / 8;
-	if (payload_len != i) {
-		sr_err("Payload unit size is %d but should be %d!", payload_len, i);
+	if (payload_len != inc->unit_size) {
+		sr_err("Payload unit size is %d but should be %d!",
+			payload_len, inc->unit_size);
 		return;
 	}
 
@@ -586,8 +590,8 @@ static void process_record_pi(struct sr_input *in, gsize start)
 		if (packet_count == 0)
 			packet_count = 1;
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
+		append_samples(inc->out_buf, single_payload, payload_len,
+			packet_count);
 	}
 
 	if (inc->out_buf->len >= CHUNK_SIZE)
@@ -599,7 +603,7 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 	struct context *inc;
 	uint64_t timestamp, next_timestamp;
 	char single_payload[3];
-	int i, payload_len, packet_count;
+	int payload_len, packet_count;
 
 	inc = in->priv;
 
@@ -635,8 +639,8 @@ static void process_record_iprobe(struct sr_input *in, gsize start)
 		if (packet_count == 0)
 			packet_count = 1;
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
+		append_samples(inc->out_buf, single_payload, payload_len,
+			packet_count);
 	}
 
 	if (inc->out_buf->len >= CHUNK_SIZE)
@@ -764,6 +768,7 @@ static int process_buffer(struct sr_input *in)
 		g_string_erase(in->buf, 0, inc->header_size);
 		if (res != SR_OK)
 			return res;
+		setup_pi_pods(inc);
 	}
 
 	if (!inc->meta_sent) {
@@ -904,6 +909,7 @@ SR_PRIV struct sr_input_module input_trace32_ad = {
 	.exts = (const char*[]){"ad", NULL},
 	.options = get_options,
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.header_size = 256,
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
@@ -45,6 +45,15 @@
  *   only this many timescale ticks. This can speed up operation on long
  *   captures (default 0, don't compress).
  *
+ * threads: Parse the value change section on this many worker threads
+ *   (default 0, parse in the caller's thread). Speeds up the import of
+ *   huge simulator dumps on multi-core machines.
+ *
+ * runs: Send logic data as runs of values (SR_DF_LOGIC_RUNS packets)
+ *   instead of expanding every timestamp delta into samples. Sessions
+ *   which understand these packets import sparse dumps with tiny
+ *   timescales in time proportional to the number of value changes.
+ *
  * Based on Verilog standard IEEE Std 1364-2001 Version C
  *
  * Supported features:
@@ -114,6 +123,7 @@
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -121,6 +131,7 @@
 #define LOG_PREFIX "input/vcd"
 
 #define CHUNK_SIZE (4 * 1024 * 1024)
+#define RUNS_COUNT (64 * 1024)
 #define SCOPE_SEP '.'
 
 struct context {
@@ -131,6 +142,8 @@ struct context {
 		uint64_t compress;
 		uint64_t skip_starttime;
 		gboolean skip_specified;
+		size_t threads;
+		gboolean runs;
 	} options;
 	gboolean use_skip;
 	gboolean started;
@@ -139,6 +152,8 @@ struct context {
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
 	GSList *ignored_signals;
+	GHashTable *ignored_ids; /* identifier -> (set) */
+	GHashTable *channel_ids; /* identifier -> list of vcd_channel */
 	gboolean data_after_timestamp;
 	gboolean ignore_end_keyword;
 	gboolean skip_until_end;
@@ -156,6 +171,11 @@ struct context {
 	} conv_bits;
 	GString *scope_prefix;
 	struct feed_queue_logic *feed_logic;
+	struct vcd_runs {
+		uint8_t *values;
+		uint64_t *lengths;
+		size_t count;
+	} runs;
 	struct ts_stats {
 		size_t total_ts_seen;
 		uint64_t last_ts_value;
@@ -172,6 +192,13 @@ struct context {
 		GSList *sr_channels;
 		GSList *sr_groups;
 	} prev;
+	struct vcd_parallel {
+		GThreadPool *pool;
+		GMutex mutex;
+		GCond done_cond;
+		GQueue blocks;
+		int error;
+	} parallel;
 };
 
 struct vcd_channel {
@@ -898,6 +925,34 @@ static char *get_channel_name(struct vcd_channel *vcd_ch, size_t idx)
 	return ch_name;
 }
 
+/*
+ * Map VCD identifiers to the channels which they feed. Value changes
+ * look up their channels here instead of scanning the channel list,
+ * which does not scale to dumps with thousands of signals. Lookup keys
+ * are owned by the channels and the ignored signals list.
+ */
+static void create_id_lookup(struct context *inc)
+{
+	GSList *l, *list;
+	struct vcd_channel *vcd_ch;
+
+	inc->ignored_ids = g_hash_table_new(g_str_hash, g_str_equal);
+	for (l = inc->ignored_signals; l; l = l->next)
+		g_hash_table_add(inc->ignored_ids, l->data);
+
+	inc->channel_ids = g_hash_table_new_full(g_str_hash, g_str_equal,
+		NULL, (GDestroyNotify)g_slist_free);
+	for (l = inc->channels; l; l = l->next) {
+		vcd_ch = l->data;
+		list = g_hash_table_lookup(inc->channel_ids, vcd_ch->identifier);
+		if (list)
+			list = g_slist_append(list, vcd_ch);
+		else
+			g_hash_table_insert(inc->channel_ids, vcd_ch->identifier,
+				g_slist_append(NULL, vcd_ch));
+	}
+}
+
 /*
  * Create (analog or logic) sigrok channels for the VCD signals. Create
  * multiple sigrok channels for vector input since sigrok has no concept
@@ -961,8 +1016,12 @@ static void create_feeds(const struct sr_input *in)
 
 	inc = in->priv;
 
-	/* Create one feed for logic data. */
-	if (inc->logic_count) {
+	/* Create one feed for logic data, or a buffer for its runs. */
+	if (inc->logic_count && inc->options.runs) {
+		inc->unit_size = (inc->logic_count + 7) / 8;
+		inc->runs.values = g_malloc(RUNS_COUNT * inc->unit_size);
+		inc->runs.lengths = g_malloc(RUNS_COUNT * sizeof(uint64_t));
+	} else if (inc->logic_count) {
 		inc->unit_size = (inc->logic_count + 7) / 8;
 		inc->feed_logic = feed_queue_logic_alloc(in->sdi,
 			CHUNK_SIZE / inc->unit_size, inc->unit_size);
@@ -1102,6 +1161,8 @@ done_section:
 	if (!inc->got_header)
 		return SR_ERR_DATA;
 
+	create_id_lookup(inc);
+
 	/* Create sigrok channels here, late, logic before analog. */
 	create_channels(in, in->sdi, SR_CHANNEL_LOGIC);
 	create_channels(in, in->sdi, SR_CHANNEL_ANALOG);
@@ -1151,6 +1212,57 @@ done_section:
  * subsequent value changes will update the data buffer. Locally buffer
  * sample data to minimize the number of send() calls.
  */
+static void flush_runs(const struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_runs runs;
+
+	inc = in->priv;
+	if (!inc->runs.count)
+		return;
+
+	runs.num_runs = inc->runs.count;
+	runs.unitsize = inc->unit_size;
+	runs.data = inc->runs.values;
+	runs.lengths = inc->runs.lengths;
+	packet.type = SR_DF_LOGIC_RUNS;
+	packet.payload = &runs;
+	sr_session_send(in->sdi, &packet);
+	inc->runs.count = 0;
+}
+
+/*
+ * Add N copies of the current logic value as a run. Extends the most
+ * recent run when the value did not change (signals which are not fed
+ * to sigrok channels, or changes which got merged by downsampling).
+ */
+static void add_runs(const struct sr_input *in, size_t count, gboolean flush)
+{
+	struct context *inc;
+	uint8_t *last;
+
+	inc = in->priv;
+
+	last = NULL;
+	if (inc->runs.count)
+		last = &inc->runs.values[(inc->runs.count - 1) * inc->unit_size];
+	if (count) {
+		if (last && memcmp(last, inc->current_logic,
+				inc->unit_size) == 0) {
+			inc->runs.lengths[inc->runs.count - 1] += count;
+		} else {
+			if (inc->runs.count == RUNS_COUNT)
+				flush_runs(in);
+			memcpy(&inc->runs.values[inc->runs.count * inc->unit_size],
+				inc->current_logic, inc->unit_size);
+			inc->runs.lengths[inc->runs.count++] = count;
+		}
+	}
+	if (flush)
+		flush_runs(in);
+}
+
 static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 {
 	struct context *inc;
@@ -1161,7 +1273,9 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 
 	inc = in->priv;
 
-	if (inc->logic_count) {
+	if (inc->logic_count && inc->options.runs) {
+		add_runs(in, count, flush);
+	} else if (inc->logic_count) {
 		feed_queue_logic_submit_one(inc->feed_logic,
 			inc->current_logic, count);
 		if (flush)
@@ -1181,17 +1295,9 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
-{
-	return strcmp((const char *)a, (const char *)b);
-}
-
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
-
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	return g_hash_table_contains(inc->ignored_ids, id);
 }
 
 /*
@@ -1241,10 +1347,9 @@ static void process_bits(struct context *inc, char *identifier,
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
+	l = g_hash_table_lookup(inc->channel_ids, identifier);
+	for (; l; l = l->next) {
 		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1315,12 +1420,11 @@ static void process_real(struct context *inc, char *identifier, float real_val)
 	struct vcd_channel *vcd_ch;
 
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
+	l = g_hash_table_lookup(inc->channel_ids, identifier);
+	for (; l; l = l->next) {
 		vcd_ch = l->data;
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
@@ -1466,6 +1570,111 @@ static gboolean vcd_string_valid(const char *s)
 	return TRUE;
 }
 
+/*
+ * Handle a $keyword section within the data part of the input file.
+ * Some sections' content gets inspected, others get skipped up to
+ * their $end keyword.
+ */
+static void process_section(struct context *inc, const char *word)
+{
+	gboolean inspect_data;
+
+	inspect_data = FALSE;
+	inspect_data |= g_strcmp0(word, "$dumpvars") == 0;
+	inspect_data |= g_strcmp0(word, "$dumpon") == 0;
+	inspect_data |= g_strcmp0(word, "$dumpoff") == 0;
+	if (inspect_data) {
+		/* Ignore keywords, yet parse contents. */
+		sr_dbg("%s section, will parse content", word);
+		inc->ignore_end_keyword = TRUE;
+	} else {
+		/* Ignore section from here up to $end. */
+		sr_dbg("%s section, will skip until $end", word);
+		inc->skip_until_end = TRUE;
+	}
+}
+
+/*
+ * Numbers prefixed by '#' are timestamps, which translate to sigrok
+ * sample numbers. Apply optional downsampling, and apply the 'skip'
+ * logic. Check the recent timestamp for plausibility. Submit the
+ * corresponding number of samples of previously accumulated data
+ * values to the session feed.
+ */
+static int process_timestamp(const struct sr_input *in, uint64_t timestamp)
+{
+	struct context *inc;
+	size_t count;
+	int ret;
+
+	inc = in->priv;
+
+	sr_spew("Got timestamp: %" PRIu64, timestamp);
+	ret = ts_stats_check(&inc->ts_stats, timestamp);
+	if (ret != SR_OK)
+		return ret;
+	if (inc->options.downsample > 1) {
+		timestamp /= inc->options.downsample;
+		sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
+	}
+
+	/*
+	 * Skip < 0 => skip until first timestamp.
+	 * Skip = 0 => don't skip
+	 * Skip > 0 => skip until timestamp >= skip.
+	 */
+	if (inc->options.skip_specified && !inc->use_skip) {
+		sr_dbg("Seeding skip from user spec %" PRIu64,
+			inc->options.skip_starttime);
+		inc->prev_timestamp = inc->options.skip_starttime;
+		inc->use_skip = TRUE;
+	}
+	if (!inc->use_skip) {
+		sr_dbg("Seeding skip from first timestamp");
+		inc->options.skip_starttime = timestamp;
+		inc->prev_timestamp = timestamp;
+		inc->use_skip = TRUE;
+		return SR_OK;
+	}
+	if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
+		sr_spew("Timestamp skipped, before user spec");
+		inc->prev_timestamp = inc->options.skip_starttime;
+		return SR_OK;
+	}
+	if (timestamp == inc->prev_timestamp) {
+		/*
+		 * Ignore repeated timestamps (e.g. sigrok outputs these).
+		 * Can also happen when downsampling makes distinct input
+		 * values end up at the same scaled down value. Also
+		 * transparently covers the initial timestamp.
+		 */
+		sr_spew("Timestamp is identical to previous timestamp");
+		return SR_OK;
+	}
+	if (timestamp < inc->prev_timestamp) {
+		sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
+		return SR_ERR_DATA;
+	}
+	if (inc->options.compress) {
+		/* Compress long idle periods */
+		count = timestamp - inc->prev_timestamp;
+		if (count > inc->options.compress) {
+			sr_dbg("Long idle period, compressing");
+			count = timestamp - inc->options.compress;
+			inc->prev_timestamp = count;
+		}
+	}
+
+	/* Generate samples from prev_timestamp up to timestamp - 1. */
+	count = timestamp - inc->prev_timestamp;
+	sr_spew("Got a new timestamp, feeding %zu samples", count);
+	add_samples(in, count, FALSE);
+	inc->prev_timestamp = timestamp;
+	inc->data_after_timestamp = FALSE;
+
+	return SR_OK;
+}
+
 /* Parse one text line of the data section. */
 static int parse_textline(const struct sr_input *in, char *line)
 {
@@ -1475,8 +1684,7 @@ static int parse_textline(const struct sr_input *in, char *line)
 	gboolean is_timestamp, is_section;
 	gboolean is_real, is_multibit, is_singlebit, is_string;
 	uint64_t timestamp;
-	char *identifier, *endptr;
-	size_t count;
+	char *identifier;
 
 	inc = in->priv;
 
@@ -1544,106 +1752,21 @@ static int parse_textline(const struct sr_input *in, char *line)
 		 */
 		is_section = curr_first == '$' && curr_word[1];
 		if (is_section) {
-			gboolean inspect_data;
-
-			inspect_data = FALSE;
-			inspect_data |= g_strcmp0(curr_word, "$dumpvars") == 0;
-			inspect_data |= g_strcmp0(curr_word, "$dumpon") == 0;
-			inspect_data |= g_strcmp0(curr_word, "$dumpoff") == 0;
-			if (inspect_data) {
-				/* Ignore keywords, yet parse contents. */
-				sr_dbg("%s section, will parse content", curr_word);
-				inc->ignore_end_keyword = TRUE;
-			} else {
-				/* Ignore section from here up to $end. */
-				sr_dbg("%s section, will skip until $end", curr_word);
-				inc->skip_until_end = TRUE;
-			}
+			process_section(inc, curr_word);
 			continue;
 		}
 
-		/*
-		 * Numbers prefixed by '#' are timestamps, which translate
-		 * to sigrok sample numbers. Apply optional downsampling,
-		 * and apply the 'skip' logic. Check the recent timestamp
-		 * for plausibility. Submit the corresponding number of
-		 * samples of previously accumulated data values to the
-		 * session feed.
-		 */
+		/* Numbers prefixed by '#' are timestamps. */
 		is_timestamp = curr_first == '#' && g_ascii_isdigit(curr_word[1]);
 		if (is_timestamp) {
-			endptr = NULL;
-			timestamp = strtoull(&curr_word[1], &endptr, 10);
-			if (!endptr || *endptr) {
+			if (sr_atou64(&curr_word[1], &timestamp) != SR_OK) {
 				sr_err("Invalid timestamp: %s.", curr_word);
 				ret = SR_ERR_DATA;
 				break;
 			}
-			sr_spew("Got timestamp: %" PRIu64, timestamp);
-			ret = ts_stats_check(&inc->ts_stats, timestamp);
+			ret = process_timestamp(in, timestamp);
 			if (ret != SR_OK)
 				break;
-			if (inc->options.downsample > 1) {
-				timestamp /= inc->options.downsample;
-				sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
-			}
-
-			/*
-			 * Skip < 0 => skip until first timestamp.
-			 * Skip = 0 => don't skip
-			 * Skip > 0 => skip until timestamp >= skip.
-			 */
-			if (inc->options.skip_specified && !inc->use_skip) {
-				sr_dbg("Seeding skip from user spec %" PRIu64,
-					inc->options.skip_starttime);
-				inc->prev_timestamp = inc->options.skip_starttime;
-				inc->use_skip = TRUE;
-			}
-			if (!inc->use_skip) {
-				sr_dbg("Seeding skip from first timestamp");
-				inc->options.skip_starttime = timestamp;
-				inc->prev_timestamp = timestamp;
-				inc->use_skip = TRUE;
-				continue;
-			}
-			if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
-				sr_spew("Timestamp skipped, before user spec");
-				inc->prev_timestamp = inc->options.skip_starttime;
-				continue;
-			}
-			if (timestamp == inc->prev_timestamp) {
-				/*
-				 * Ignore repeated timestamps (e.g. sigrok
-				 * outputs these). Can also happen when
-				 * downsampling makes distinct input values
-				 * end up at the same scaled down value.
-				 * Also transparently covers the initial
-				 * timestamp.
-				 */
-				sr_spew("Timestamp is identical to previous timestamp");
-				continue;
-			}
-			if (timestamp < inc->prev_timestamp) {
-				sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			if (inc->options.compress) {
-				/* Compress long idle periods */
-				count = timestamp - inc->prev_timestamp;
-				if (count > inc->options.compress) {
-					sr_dbg("Long idle period, compressing");
-					count = timestamp - inc->options.compress;
-					inc->prev_timestamp = count;
-				}
-			}
-
-			/* Generate samples from prev_timestamp up to timestamp - 1. */
-			count = timestamp - inc->prev_timestamp;
-			sr_spew("Got a new timestamp, feeding %zu samples", count);
-			add_samples(in, count, FALSE);
-			inc->prev_timestamp = timestamp;
-			inc->data_after_timestamp = FALSE;
 			continue;
 		}
 		inc->data_after_timestamp = TRUE;
@@ -1863,6 +1986,478 @@ static int parse_textline(const struct sr_input *in, char *line)
 	return ret;
 }
 
+/*
+ * Parallel parsing of the value change section. The input text gets
+ * cut into blocks at timestamp lines. Worker threads isolate lines and
+ * words, and convert values and timestamps into per-block lists of
+ * change events. The events then get applied in file order by the
+ * caller's thread, which keeps all state (sections, skip, timestamps,
+ * sample values, feed queues) in one place, and which reproduces the
+ * serial parser's behaviour (errors within skipped sections are just
+ * as harmless as they are in parse_textline()).
+ */
+
+#define BLOCK_SIZE (1024 * 1024)
+/* Text lines which a worker splits off its block at a time. */
+#define VCD_LINE_BATCH 64
+
+enum vcd_event_type {
+	VCD_EV_END,
+	VCD_EV_SECTION,
+	VCD_EV_TIME,
+	VCD_EV_BITS,
+	VCD_EV_REAL,
+	VCD_EV_STRING,
+	VCD_EV_ERROR,
+};
+
+struct vcd_event {
+	enum vcd_event_type type;
+	gboolean end_second; /* second word of the token was "$end" */
+	size_t text; /* identifier, section name, or error message */
+	size_t data; /* bit value */
+	union {
+		uint64_t timestamp;
+		size_t bit_count;
+		float real;
+	} u;
+};
+
+struct vcd_block {
+	char *text;
+	size_t len;
+	GArray *events;
+	GString *strings;
+	gboolean done;
+};
+
+static void free_block(struct vcd_block *block)
+{
+	if (!block)
+		return;
+
+	g_free(block->text);
+	if (block->events)
+		g_array_free(block->events, TRUE);
+	if (block->strings)
+		g_string_free(block->strings, TRUE);
+	g_free(block);
+}
+
+/* Keep a NUL terminated copy of the text, return its position. */
+static size_t block_text(struct vcd_block *block, const char *text)
+{
+	size_t pos;
+
+	pos = block->strings->len;
+	g_string_append_len(block->strings, text, strlen(text) + 1);
+
+	return pos;
+}
+
+static const char *block_str(const struct vcd_block *block, size_t pos)
+{
+	return &block->strings->str[pos];
+}
+
+static void block_event(struct vcd_block *block, struct vcd_event *ev,
+	enum vcd_event_type type, const char *second)
+{
+	ev->type = type;
+	ev->end_second = g_strcmp0(second, "$end") == 0;
+	g_array_append_val(block->events, *ev);
+}
+
+G_GNUC_PRINTF(4, 5)
+static void block_error(struct vcd_block *block, struct vcd_event *ev,
+	const char *second, const char *format, ...)
+{
+	va_list args;
+	char *msg;
+
+	va_start(args, format);
+	msg = g_strdup_vprintf(format, args);
+	va_end(args);
+	ev->text = block_text(block, msg);
+	g_free(msg);
+	block_event(block, ev, VCD_EV_ERROR, second);
+}
+
+/*
+ * Convert one text line into events. Runs in worker threads, must only
+ * read the input module's context (which won't change after the header
+ * was parsed). Mirrors the tokenization in parse_textline().
+ */
+static void parse_block_line(const struct context *inc,
+	struct vcd_block *block, char *line)
+{
+	struct vcd_event ev;
+	char *curr_word, curr_first, *identifier, *second;
+	char *bits_text, *bits_text_start, bit_char;
+	uint8_t *value_ptr, value_mask, bit_value;
+	size_t bit_count;
+
+	while (line) {
+		curr_word = sr_text_next_word(line, &line);
+		if (!curr_word)
+			break;
+		if (!*curr_word)
+			continue;
+		curr_first = g_ascii_tolower(curr_word[0]);
+		memset(&ev, 0, sizeof(ev));
+		second = NULL;
+
+		if (strcmp(curr_word, "$end") == 0) {
+			block_event(block, &ev, VCD_EV_END, NULL);
+			continue;
+		}
+		if (curr_first == '$' && curr_word[1]) {
+			ev.text = block_text(block, curr_word);
+			block_event(block, &ev, VCD_EV_SECTION, NULL);
+			continue;
+		}
+		if (curr_first == '#' && g_ascii_isdigit(curr_word[1])) {
+			if (sr_atou64(&curr_word[1], &ev.u.timestamp) != SR_OK) {
+				block_error(block, &ev, NULL,
+					"Invalid timestamp: %s.", curr_word);
+				continue;
+			}
+			block_event(block, &ev, VCD_EV_TIME, NULL);
+			continue;
+		}
+
+		if (curr_first == 'r' && curr_word[1]) {
+			second = sr_text_next_word(line, &line);
+			if (!second || !*second) {
+				block_error(block, &ev, second,
+					"Unexpected real format.");
+				continue;
+			}
+			if (sr_atof_ascii(&curr_word[1], &ev.u.real) != SR_OK) {
+				block_error(block, &ev, second,
+					"Cannot convert value: %s.", &curr_word[1]);
+				continue;
+			}
+			ev.text = block_text(block, second);
+			block_event(block, &ev, VCD_EV_REAL, second);
+			continue;
+		}
+		if (curr_first == 'b' && curr_word[1]) {
+			second = sr_text_next_word(line, &line);
+			if (!second || !*second) {
+				block_error(block, &ev, second,
+					"Unexpected integer/vector format.");
+				continue;
+			}
+			bits_text_start = &curr_word[1];
+			bits_text = bits_text_start + strlen(bits_text_start);
+			bit_count = bits_text - bits_text_start;
+			if (bit_count > inc->conv_bits.max_bits) {
+				block_error(block, &ev, second,
+					"Value exceeds conversion buffer: %s",
+					bits_text_start);
+				continue;
+			}
+			ev.data = block->strings->len;
+			g_string_set_size(block->strings,
+				ev.data + inc->conv_bits.unit_size);
+			value_ptr = (uint8_t *)&block->strings->str[ev.data];
+			memset(value_ptr, 0, inc->conv_bits.unit_size);
+			value_mask = 1 << 0;
+			while (bits_text > bits_text_start) {
+				ev.u.bit_count++;
+				bit_char = *(--bits_text);
+				bit_value = vcd_char_to_value(bit_char, NULL);
+				if (bit_value == 0) {
+					/* EMPTY */
+				} else if (bit_value == 1) {
+					*value_ptr |= value_mask;
+				} else {
+					ev.u.bit_count = 0;
+					break;
+				}
+				value_mask <<= 1;
+				if (!value_mask) {
+					value_ptr++;
+					value_mask = 1 << 0;
+				}
+			}
+			if (!ev.u.bit_count) {
+				block_error(block, &ev, second,
+					"Unexpected vector format: %s",
+					bits_text_start);
+				continue;
+			}
+			ev.text = block_text(block, second);
+			block_event(block, &ev, VCD_EV_BITS, second);
+			continue;
+		}
+		if (strchr("01lhxzu-", curr_first)) {
+			bit_char = curr_word[0];
+			identifier = &curr_word[1];
+			if (!*identifier)
+				identifier = second = sr_text_next_word(line, &line);
+			if (!identifier || !*identifier) {
+				block_error(block, &ev, second,
+					"Identifier missing.");
+				continue;
+			}
+			bit_value = vcd_char_to_value(bit_char, NULL);
+			if (bit_value != 0 && bit_value != 1) {
+				block_error(block, &ev, second,
+					"Unsupported bit value '%c'.", bit_char);
+				continue;
+			}
+			ev.data = block->strings->len;
+			g_string_append_c(block->strings, bit_value);
+			ev.u.bit_count = 1;
+			ev.text = block_text(block, identifier);
+			block_event(block, &ev, VCD_EV_BITS, second);
+			continue;
+		}
+		if (curr_first == 's') {
+			second = sr_text_next_word(line, &line);
+			if (!vcd_string_valid(&curr_word[1])) {
+				block_error(block, &ev, second,
+					"Invalid string data: %s", &curr_word[1]);
+				continue;
+			}
+			if (!second || !*second) {
+				block_error(block, &ev, second,
+					"String value without identifier.");
+				continue;
+			}
+			ev.text = block_text(block, second);
+			block_event(block, &ev, VCD_EV_STRING, second);
+			continue;
+		}
+
+		block_error(block, &ev, NULL, "Unknown token '%s'.", curr_word);
+	}
+}
+
+static void parse_block(gpointer data, gpointer user_data)
+{
+	struct vcd_block *block;
+	struct context *inc;
+	char *rdptr, *lines[VCD_LINE_BATCH];
+	size_t rdlen, taken, count, idx;
+
+	block = data;
+	inc = user_data;
+
+	rdptr = block->text;
+	taken = 0;
+	while (rdptr) {
+		rdlen = &block->text[block->len] - rdptr;
+		count = sr_text_next_lines(rdptr, rdlen, lines,
+			ARRAY_SIZE(lines), &rdptr, &taken);
+		for (idx = 0; idx < count; idx++) {
+			if (*lines[idx])
+				parse_block_line(inc, block, lines[idx]);
+		}
+	}
+
+	g_mutex_lock(&inc->parallel.mutex);
+	block->done = TRUE;
+	g_cond_broadcast(&inc->parallel.done_cond);
+	g_mutex_unlock(&inc->parallel.mutex);
+}
+
+/* Apply a block's events in order, like parse_textline() would. */
+static int apply_block(const struct sr_input *in, struct vcd_block *block)
+{
+	struct context *inc;
+	struct vcd_event *ev;
+	const char *text;
+	size_t idx;
+	int ret;
+
+	inc = in->priv;
+
+	for (idx = 0; idx < block->events->len; idx++) {
+		ev = &g_array_index(block->events, struct vcd_event, idx);
+		text = block_str(block, ev->text);
+
+		if (inc->skip_until_end) {
+			if (ev->type == VCD_EV_END || ev->end_second) {
+				sr_dbg("done skipping until $end");
+				inc->skip_until_end = FALSE;
+			}
+			continue;
+		}
+		if (inc->ignore_end_keyword && ev->type == VCD_EV_END) {
+			sr_dbg("done ignoring $end keyword");
+			inc->ignore_end_keyword = FALSE;
+			continue;
+		}
+
+		switch (ev->type) {
+		case VCD_EV_END:
+			process_section(inc, "$end");
+			continue;
+		case VCD_EV_SECTION:
+			process_section(inc, text);
+			continue;
+		case VCD_EV_TIME:
+			ret = process_timestamp(in, ev->u.timestamp);
+			if (ret != SR_OK)
+				return ret;
+			continue;
+		default:
+			break;
+		}
+		inc->data_after_timestamp = TRUE;
+
+		switch (ev->type) {
+		case VCD_EV_BITS:
+			process_bits(inc, (char *)text,
+				(uint8_t *)&block->strings->str[ev->data],
+				ev->u.bit_count);
+			break;
+		case VCD_EV_REAL:
+			process_real(inc, (char *)text, ev->u.real);
+			break;
+		case VCD_EV_STRING:
+			if (!is_ignored(inc, text)) {
+				sr_err("String value for identifier '%s'.", text);
+				return SR_ERR_DATA;
+			}
+			break;
+		default:
+			sr_err("%s", text);
+			return SR_ERR_DATA;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Apply parsed blocks in file order. Waits for the oldest block when
+ * the number of blocks in flight reaches the limit, or when all blocks
+ * must be done (end of input).
+ */
+static int apply_blocks(const struct sr_input *in, size_t keep)
+{
+	struct context *inc;
+	struct vcd_block *block;
+	int ret;
+
+	inc = in->priv;
+
+	ret = inc->parallel.error;
+	g_mutex_lock(&inc->parallel.mutex);
+	while ((block = g_queue_peek_head(&inc->parallel.blocks))) {
+		if (!block->done) {
+			if (g_queue_get_length(&inc->parallel.blocks) <= keep)
+				break;
+			g_cond_wait(&inc->parallel.done_cond,
+				&inc->parallel.mutex);
+			continue;
+		}
+		g_queue_pop_head(&inc->parallel.blocks);
+		g_mutex_unlock(&inc->parallel.mutex);
+		if (ret == SR_OK)
+			ret = apply_block(in, block);
+		free_block(block);
+		g_mutex_lock(&inc->parallel.mutex);
+	}
+	g_mutex_unlock(&inc->parallel.mutex);
+	inc->parallel.error = ret;
+
+	return ret;
+}
+
+/* Find the end of the next block, prefer to cut before timestamps. */
+static size_t next_block_len(const char *text, size_t len)
+{
+	const char *p;
+
+	if (len <= BLOCK_SIZE)
+		return len;
+	p = g_strstr_len(&text[BLOCK_SIZE - 1], len - BLOCK_SIZE + 1, "\n#");
+	if (!p)
+		return len;
+
+	return p + 1 - text;
+}
+
+static int process_buffer_parallel(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	struct vcd_block *block;
+	GError *error;
+	char *eol;
+	size_t complete, pos, len;
+	int ret;
+
+	inc = in->priv;
+
+	if (inc->parallel.error)
+		return inc->parallel.error;
+	if (!inc->parallel.pool) {
+		g_mutex_init(&inc->parallel.mutex);
+		g_cond_init(&inc->parallel.done_cond);
+		g_queue_init(&inc->parallel.blocks);
+		error = NULL;
+		inc->parallel.pool = g_thread_pool_new(parse_block, inc,
+			inc->options.threads, FALSE, &error);
+		if (!inc->parallel.pool) {
+			sr_err("Cannot create parser threads: %s.",
+				error->message);
+			g_error_free(error);
+			return SR_ERR;
+		}
+	}
+
+	/* Only complete text lines go to the workers. */
+	eol = g_strrstr_len(in->buf->str, in->buf->len, "\n");
+	complete = eol ? (size_t)(eol + 1 - in->buf->str) : 0;
+	if (!is_eof && complete < BLOCK_SIZE)
+		return SR_OK;
+
+	ret = SR_OK;
+	for (pos = 0; pos < complete && ret == SR_OK; pos += len) {
+		len = next_block_len(&in->buf->str[pos], complete - pos);
+		if (!is_eof && len < BLOCK_SIZE)
+			break;
+		block = g_malloc0(sizeof(*block));
+		block->text = g_strndup(&in->buf->str[pos], len);
+		block->len = len;
+		block->events = g_array_sized_new(FALSE, FALSE,
+			sizeof(struct vcd_event), len / 8);
+		block->strings = g_string_sized_new(len / 2);
+		g_mutex_lock(&inc->parallel.mutex);
+		g_queue_push_tail(&inc->parallel.blocks, block);
+		g_mutex_unlock(&inc->parallel.mutex);
+		g_thread_pool_push(inc->parallel.pool, block, NULL);
+
+		ret = apply_blocks(in, 2 * inc->options.threads);
+	}
+	g_string_erase(in->buf, 0, pos);
+
+	if (ret == SR_OK && is_eof)
+		ret = apply_blocks(in, 0);
+
+	return ret;
+}
+
+static void cleanup_parallel(struct context *inc)
+{
+	struct vcd_block *block;
+
+	if (!inc->parallel.pool)
+		return;
+
+	g_thread_pool_free(inc->parallel.pool, FALSE, TRUE);
+	inc->parallel.pool = NULL;
+	while ((block = g_queue_pop_head(&inc->parallel.blocks)))
+		free_block(block);
+	g_cond_clear(&inc->parallel.done_cond);
+	g_mutex_clear(&inc->parallel.mutex);
+}
+
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
@@ -1898,6 +2493,9 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	if (is_eof)
 		g_string_append_c(in->buf, '\n');
 
+	if (inc->options.threads > 1)
+		return process_buffer_parallel(in, is_eof);
+
 	/* Find and process complete text lines in the input data. */
 	ret = SR_OK;
 	rdptr = in->buf->str;
@@ -1971,6 +2569,12 @@ static int init(struct sr_input *in, GHashTable *options)
 	inc->options.compress = g_variant_get_uint64(data);
 	inc->options.compress /= inc->options.downsample;
 
+	data = g_hash_table_lookup(options, "threads");
+	inc->options.threads = g_variant_get_uint32(data);
+
+	data = g_hash_table_lookup(options, "runs");
+	inc->options.runs = g_variant_get_boolean(data);
+
 	data = g_hash_table_lookup(options, "skip");
 	if (data) {
 		inc->options.skip_specified = TRUE;
@@ -2059,10 +2663,22 @@ static void cleanup(struct sr_input *in)
 
 	keep_header_for_reread(in);
 
+	cleanup_parallel(inc);
+	if (inc->channel_ids)
+		g_hash_table_destroy(inc->channel_ids);
+	inc->channel_ids = NULL;
+	if (inc->ignored_ids)
+		g_hash_table_destroy(inc->ignored_ids);
+	inc->ignored_ids = NULL;
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 	feed_queue_logic_free(inc->feed_logic);
 	inc->feed_logic = NULL;
+	g_free(inc->runs.values);
+	inc->runs.values = NULL;
+	g_free(inc->runs.lengths);
+	inc->runs.lengths = NULL;
+	inc->runs.count = 0;
 	g_free(inc->conv_bits.value);
 	inc->conv_bits.value = NULL;
 	g_free(inc->current_logic);
@@ -2104,6 +2720,8 @@ enum vcd_option_t {
 	OPT_DOWN_SAMPLE,
 	OPT_SKIP_COUNT,
 	OPT_COMPRESS,
+	OPT_THREADS,
+	OPT_RUNS,
 	OPT_MAX,
 };
 
@@ -2138,6 +2756,19 @@ static struct sr_option options[] = {
 		"Compress idle periods which are longer than the specified number of timescale ticks.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"Number of threads which parse the value change section in parallel. "
+		"Values 0 and 1 parse the input in the caller's thread.",
+		NULL, NULL,
+	},
+	[OPT_RUNS] = {
+		"runs", "Send logic value runs",
+		"Send logic data as runs of values (SR_DF_LOGIC_RUNS) instead of expanded samples. "
+		"Imports sparse dumps in time proportional to the number of changes. "
+		"Analog channels still get expanded.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -2149,6 +2780,8 @@ static const struct sr_option *get_options(void)
 		options[OPT_DOWN_SAMPLE].def = g_variant_ref_sink(g_variant_new_uint64(1));
 		options[OPT_SKIP_COUNT].def = g_variant_ref_sink(g_variant_new_uint64(~UINT64_C(0)));
 		options[OPT_COMPRESS].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[OPT_RUNS].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 	}
 
 	return options;
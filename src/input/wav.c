@@ -70,15 +70,19 @@ static int parse_wav_header(GString *buf, struct context *inc)
 	if (num_channels == 0)
 		return SR_ERR;
 	unitsize = samplesize / num_channels;
-	if (unitsize != 1 && unitsize != 2 && unitsize != 4) {
-		sr_err("Only 8, 16 or 32 bits per sample supported.");
+	if (unitsize < 1 || (unitsize > 4 && unitsize != 8)) {
+		sr_err("Only 8, 16, 24, 32 or 64 bits per sample supported.");
 		return SR_ERR_DATA;
 	}
 
 	if (fmt_code == WAVE_FORMAT_PCM_) {
+		if (unitsize > 4) {
+			sr_err("Only 8, 16, 24 or 32 bit integers supported.");
+			return SR_ERR_DATA;
+		}
 	} else if (fmt_code == WAVE_FORMAT_IEEE_FLOAT_) {
-		if (unitsize != 4) {
-			sr_err("only 32-bit floats supported.");
+		if (unitsize != 4 && unitsize != 8) {
+			sr_err("Only 32 or 64 bit floats supported.");
 			return SR_ERR_DATA;
 		}
 	} else if (fmt_code == WAVE_FORMAT_EXTENSIBLE_) {
@@ -104,8 +108,13 @@ static int parse_wav_header(GString *buf, struct context *inc)
 			sr_err("Only PCM and floating point samples are supported.");
 			return SR_ERR_DATA;
 		}
-		if (fmt_code == WAVE_FORMAT_IEEE_FLOAT_ && unitsize != 4) {
-			sr_err("only 32-bit floats supported.");
+		if (fmt_code == WAVE_FORMAT_PCM_ && unitsize > 4) {
+			sr_err("Only 8, 16, 24 or 32 bit integers supported.");
+			return SR_ERR_DATA;
+		}
+		if (fmt_code == WAVE_FORMAT_IEEE_FLOAT_ &&
+				unitsize != 4 && unitsize != 8) {
+			sr_err("Only 32 or 64 bit floats supported.");
 			return SR_ERR_DATA;
 		}
 	} else {
@@ -184,6 +193,14 @@ static int find_data_chunk(GString *buf, int initial_offset)
 	return offset;
 }
 
+/*
+ * Send a chunk of samples in the file's native format, straight from
+ * the input buffer. WAV data is little endian. PCM samples are integers
+ * (8-bit unsigned, otherwise signed, 24-bit is packed into 3 bytes),
+ * which scale to the [-1, 1] range.
+ * Consumers convert to float as needed, sr_analog_to_float() handles
+ * the encoding. This avoids the per sample conversion and the copy.
+ */
 static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 {
 	struct sr_datafeed_packet packet;
@@ -192,57 +209,44 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct context *inc;
-	float *fdata;
-	int total_samples, samplenum;
-	char *s, *d;
 
 	inc = in->priv;
 
-	total_samples = num_samples * inc->num_channels;
-	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
-	d = (char *)fdata;
-
-	for (samplenum = 0; samplenum < total_samples; samplenum++) {
-		if (inc->fmt_code == WAVE_FORMAT_PCM_) {
-			switch (inc->unitsize) {
-			case 1:
-				/* 8-bit PCM samples are unsigned. */
-				fdata[samplenum] = *(uint8_t*)(s) / (float)255;
-				break;
-			case 2:
-				fdata[samplenum] = RL16S(s) / (float)INT16_MAX;
-				break;
-			case 4:
-				fdata[samplenum] = RL32S(s) / (float)INT32_MAX;
-				break;
-			}
-		} else {
-			/* BINARY32 float */
-#ifdef WORDS_BIGENDIAN
-			int i;
-			for (i = 0; i < inc->unitsize; i++)
-				d[i] = s[inc->unitsize - 1 - i];
-#else
-			memcpy(d, s, inc->unitsize);
-#endif
-		}
-		s += inc->unitsize;
-		d += inc->unitsize;
-	}
-
 	/* TODO: Use proper 'digits' value for this device (and its modes). */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+	encoding.unitsize = inc->unitsize;
+	encoding.is_bigendian = FALSE;
+	if (inc->fmt_code == WAVE_FORMAT_PCM_) {
+		encoding.is_float = FALSE;
+		encoding.is_signed = inc->unitsize != 1;
+		encoding.scale.p = 1;
+		switch (inc->unitsize) {
+		case 1:
+			encoding.scale.q = UINT8_MAX;
+			break;
+		case 2:
+			encoding.scale.q = INT16_MAX;
+			break;
+		case 3:
+			encoding.scale.q = (1UL << 23) - 1;
+			break;
+		case 4:
+			encoding.scale.q = INT32_MAX;
+			break;
+		}
+	} else {
+		/* BINARY32 or BINARY64 float */
+		encoding.is_float = TRUE;
+	}
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	analog.num_samples = num_samples;
-	analog.data = fdata;
+	analog.data = in->buf->str + offset;
 	analog.meaning->channels = in->sdi->channels;
 	analog.meaning->mq = 0;
 	analog.meaning->mqflags = 0;
 	analog.meaning->unit = 0;
 	sr_session_send(in->sdi, &packet);
-	g_free(fdata);
 }
 
 static int process_buffer(struct sr_input *in)
@@ -417,15 +421,39 @@ static int reset(struct sr_input *in)
 	return SR_OK;
 }
 
+static int seek(struct sr_input *in, uint64_t sample,
+		uint64_t *offset, size_t *sample_size)
+{
+	struct context *inc;
+	int data_offset;
+
+	inc = in->priv;
+	/* The header is still buffered, skip past the 'fmt ' chunk. */
+	data_offset = find_data_chunk(in->buf, 20 + RL32(in->buf->str + 16));
+	if (data_offset < 0) {
+		sr_err("Couldn't find data chunk.");
+		return SR_ERR_DATA;
+	}
+	g_string_truncate(in->buf, 0);
+	inc->found_data = TRUE;
+	*offset = data_offset + sample * inc->samplesize;
+	*sample_size = inc->samplesize;
+
+	return SR_OK;
+}
+
 SR_PRIV struct sr_input_module input_wav = {
 	.id = "wav",
 	.name = "WAV",
 	.desc = "Microsoft WAV file format data",
 	.exts = (const char*[]){"wav", NULL},
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.magics = (const char*[]){"RIFF", NULL},
+	.header_size = MAX_DATA_CHUNK_OFFSET,
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
 	.end = end,
 	.reset = reset,
+	.seek = seek,
 };
@@ -1095,6 +1095,26 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 	*p += sizeof(x);
 }
 
+/**
+ * Transpose an 8x8 bit matrix which is kept in a 64bit register.
+ * Bit c of byte r moves to bit r of byte c.
+ * @param[in] x The matrix, byte r holds row r.
+ * @return The transposed matrix.
+ */
+static inline uint64_t sr_bit_transpose_8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
 /* Portability fixes for FreeBSD. */
 #ifdef __FreeBSD__
 #define LIBUSB_CLASS_APPLICATION 0xfe
@@ -1213,6 +1233,18 @@ struct sr_context {
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	/* Resource content by type and name, see resource.c. */
+	GHashTable *resource_cache;
+	/* Checksum of the resource each device runs, see resource.c. */
+	GHashTable *resource_uploads;
+	/* SCPI responses by instrument, see scpi/scpi_cache.c. */
+	GHashTable *scpi_cache;
+	/* Whether libusb and HIDAPI were initialized, see sr_transports_init(). */
+	gboolean transports_ready;
+	/* Memory accounting in bytes, see memory.c. */
+	uint64_t mem_budget;
+	uint64_t mem_used;
+	uint64_t mem_peak;
 };
 
 /** Input module metadata keys. */
@@ -1238,6 +1270,11 @@ struct sr_input {
 	struct sr_dev_inst *sdi;
 	gboolean sdi_ready;
 	void *priv;
+	/**
+	 * Buffer which holds the data of the running receive_data() call,
+	 * see sr_input_send_buffer(). NULL when the data is only borrowed.
+	 */
+	struct sr_buffer *data_buffer;
 };
 
 /** Input (file) module driver. */
@@ -1284,6 +1321,23 @@ struct sr_input_module {
 	 */
 	const uint8_t metadata[8];
 
+	/**
+	 * A NULL terminated list of leading byte sequences, one of which
+	 * every input stream of this format starts with. Or NULL if the
+	 * format has no such magic. Format detection only runs the
+	 * module's format_match() for streams which start with one of
+	 * the sequences.
+	 */
+	const char *const *magics;
+
+	/**
+	 * The number of bytes at the start of the stream which
+	 * format_match() needs to inspect in the SR_INPUT_META_HEADER
+	 * item. Zero when the module cannot tell, a default size applies.
+	 * Lets format detection read less of the input file.
+	 */
+	size_t header_size;
+
 	/**
 	 * Returns a NULL-terminated list of options this module can take.
 	 * Can be NULL, if the module has no options.
@@ -1339,6 +1393,20 @@ struct sr_input_module {
 	 */
 	int (*receive) (struct sr_input *in, GString *buf);
 
+	/**
+	 * Send borrowed data to the specified input instance (optional).
+	 *
+	 * Same as receive(), but the data is only valid for the duration
+	 * of the call. Modules implementing this send complete samples
+	 * straight from the caller's memory and only keep a partial
+	 * trailing record in in->buf, saving a copy of every block.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_data) (struct sr_input *in, const uint8_t *data,
+			size_t len);
+
 	/**
 	 * Signal the input module no more data will come.
 	 *
@@ -1359,6 +1427,24 @@ struct sr_input_module {
 	 */
 	int (*reset) (struct sr_input *in);
 
+	/**
+	 * Prepare to receive data starting at the given sample (optional).
+	 *
+	 * Called once the device instance is ready, for modules whose
+	 * samples have a fixed size and location in the file. The module
+	 * discards any buffered sample data and expects the next data it
+	 * receives to start at the returned file offset.
+	 *
+	 * @param[in] sample Index of the first sample to receive.
+	 * @param[out] offset File offset of that sample.
+	 * @param[out] sample_size Number of bytes per sample.
+	 *
+	 * @retval SR_OK Success.
+	 * @retval other Negative error code.
+	 */
+	int (*seek) (struct sr_input *in, uint64_t sample,
+			uint64_t *offset, size_t *sample_size);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the input module, and can be used to free any internal
@@ -1396,6 +1482,9 @@ struct sr_output {
 	 * there, and only flush it when it reaches a certain size.
 	 */
 	void *priv;
+
+	/** Reusable buffer of sr_output_send_file(), or NULL. */
+	GString *sink;
 };
 
 /** Output module driver. */
@@ -1478,6 +1567,24 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Append the output for a packet to a caller provided buffer.
+	 *
+	 * Alternative to receive(), modules implement either of them.
+	 * The caller can reuse the buffer across packets, which saves
+	 * an allocation per packet. Modules do not modify the buffer's
+	 * existing content.
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param out The buffer to append the output to.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_append) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet, GString *out);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1505,6 +1612,9 @@ struct sr_transform {
 	 * state between calls into its callback functions.
 	 */
 	void *priv;
+
+	/** Run time statistics, see sr_session_stats_get(). */
+	struct sr_dispatch_timing timing;
 };
 
 struct sr_transform_module {
@@ -1565,6 +1675,25 @@ struct sr_transform_module {
 			struct sr_datafeed_packet *packet_in,
 			struct sr_datafeed_packet **packet_out);
 
+	/**
+	 * Optional in-place kernel for logic samples. When present, it is
+	 * used instead of receive() for SR_DF_LOGIC packets, receive()
+	 * still gets all other packets. The kernels of consecutive
+	 * transforms get fused: the session runs all of them on a block
+	 * of samples, before it moves on to the next block. The blocks
+	 * need not be aligned to anything but the unit size.
+	 *
+	 * @param t Pointer to the respective 'struct sr_transform'.
+	 * @param data The block's samples, modified in place.
+	 * @param unitsize The size of a sample in bytes.
+	 * @param count The number of samples in the block.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*logic_kernel) (const struct sr_transform *t,
+			uint8_t *data, uint16_t unitsize, size_t count);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the transform module, and can be used to free any internal
@@ -1585,7 +1714,88 @@ struct sr_usb_dev_inst {
 	uint8_t address;
 	/** libusb device handle */
 	struct libusb_device_handle *devhdl;
+	/** Private libusb context, see sr_usb_open_private(), or NULL */
+	struct libusb_context *usb_ctx;
+};
+
+struct sr_usb_stream;
+
+/**
+ * Callback for the data of a completed streaming transfer.
+ *
+ * Returning anything but SR_OK ends the stream, as does calling
+ * sr_usb_stream_abort() from within the callback.
+ */
+typedef int (*sr_usb_stream_data_cb)(struct sr_usb_stream *stream,
+		uint8_t *data, size_t length, void *cb_data);
+
+/**
+ * Callback for the end of a stream, once all of its transfers are
+ * freed. The stream may be freed from within the callback.
+ */
+typedef void (*sr_usb_stream_done_cb)(struct sr_usb_stream *stream,
+		void *cb_data);
+
+/**
+ * How a bulk IN stream trades latency for robustness, see
+ * sr_usb_stream_config_profile(). The order matches the values
+ * of SR_CONF_TRANSFER_PROFILE.
+ */
+enum sr_usb_stream_profile {
+	/** Default transfer size and queue depth. */
+	SR_USB_STREAM_BALANCED,
+	/** Small transfers, short queue: data arrives promptly. */
+	SR_USB_STREAM_LOW_LATENCY,
+	/** Large transfers, deep queue: rides out long host stalls. */
+	SR_USB_STREAM_ROBUST,
+};
+
+/** Parameters of a bulk IN streaming acquisition. */
+struct sr_usb_stream_config {
+	/** Bulk IN endpoint address. */
+	unsigned char endpoint;
+	/** Expected data rate, used for sizing the transfers. */
+	uint64_t bytes_per_sec;
+	/** Duration of data per transfer in ms, 0 for the default (10). */
+	unsigned int transfer_ms;
+	/** Duration of data in the whole queue in ms, 0 for the default (500). */
+	unsigned int queue_ms;
+	/** Upper limit of queued transfers, 0 for the default (32). */
+	unsigned int max_transfers;
+	/** Transfer sizes are a multiple of this, 0 for the default (512). */
+	size_t align;
+	/** Device to report the statistics for, see sr_session_stats_get(). */
+	const struct sr_dev_inst *sdi;
+	sr_usb_stream_data_cb data_cb;
+	sr_usb_stream_done_cb done_cb;
+	void *cb_data;
+};
+
+/** Queue of bulk IN transfers, continuously resubmitted. */
+struct sr_usb_stream {
+	struct libusb_device_handle *devhdl;
+	struct sr_usb_stream_config cfg;
+	size_t buffer_size;
+	unsigned int num_transfers;
+	unsigned int timeout;
+	struct libusb_transfer **transfers;
+	/* Per transfer: whether its buffer is in device memory. */
+	gboolean *dev_mem;
+	unsigned int submitted;
+	unsigned int in_flight;
+	unsigned int empty_count;
+	gboolean aborted;
+	int64_t queue_us;
+	int64_t last_us;
+	struct sr_transfer_stats stats;
 };
+
+/** Decoding thread for received data, see sr_usb_decoder_new(). */
+struct sr_usb_decoder;
+
+/** Callback which decodes a buffer of received data. */
+typedef void (*sr_usb_decode_cb)(const uint8_t *data, size_t length,
+		void *cb_data);
 #endif
 
 /** Raw TCP device instance. */
@@ -1593,10 +1803,23 @@ struct sr_tcp_dev_inst {
 	char *host_addr;	/**!< IP address or host name */
 	char *tcp_port;		/**!< TCP port number/name */
 	int sock_fd;		/**!< TCP socket's file descriptor */
+	uint8_t *rx_buf;	/**!< Receive buffer, allocated on first use */
+	size_t rx_pos;		/**!< Position of the oldest unread byte */
+	size_t rx_len;		/**!< Number of unread bytes */
 };
 
 struct sr_serial_dev_inst;
 #ifdef HAVE_SERIAL_COMM
+/** RX data queue of a serial port, a ring buffer. */
+struct sr_ser_rx_queue {
+	uint8_t *data;
+	/** Capacity, grows only when data doesn't fit. */
+	size_t size;
+	/** Position of the oldest byte. */
+	size_t head;
+	/** Number of queued bytes. */
+	size_t len;
+};
 struct ser_lib_functions;
 struct ser_hid_chip_functions;
 struct sr_bt_desc;
@@ -1614,7 +1837,9 @@ struct sr_serial_dev_inst {
 		int parity_bits;
 		int stop_bits;
 	} comm_params;
-	GString *rcv_buffer;
+	struct sr_ser_rx_queue *rcv_buffer;
+	/** Monotonic time [us] of the most recent data reception. */
+	int64_t rx_time;
 	serial_rx_chunk_callback rx_chunk_cb_func;
 	void *rx_chunk_cb_data;
 #ifdef HAVE_LIBSERIALPORT
@@ -1676,6 +1901,10 @@ struct drv_context {
 	GSList *instances;
 };
 
+/*--- backend.c -------------------------------------------------------------*/
+
+SR_PRIV int sr_transports_init(struct sr_context *ctx);
+
 /*--- log.c -----------------------------------------------------------------*/
 
 /* Provide a macro for other source code locations to re-use. */
@@ -1690,14 +1919,24 @@ struct drv_context {
 #define ATTR_FMT_PRINTF(fmt_pos, arg_pos)	G_GNUC_PRINTF(fmt_pos, arg_pos)
 #endif
 
+extern SR_PRIV int sr_log_cur_loglevel;
+
 SR_PRIV int sr_log(int loglevel, const char *format, ...) ATTR_FMT_PRINTF(2, 3);
 
+/*
+ * Check the loglevel before the call, so that suppressed messages don't
+ * evaluate their arguments, nor get formatted.
+ */
+#define sr_log_level(level, ...) \
+	((level) <= sr_log_cur_loglevel ? \
+		sr_log((level), LOG_PREFIX ": " __VA_ARGS__) : SR_OK)
+
 /* Message logging helpers with subsystem-specific prefix string. */
-#define sr_spew(...)	sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_dbg(...)	sr_log(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
-#define sr_info(...)	sr_log(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_err(...)	sr_log(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
+#define sr_spew(...)	sr_log_level(SR_LOG_SPEW, __VA_ARGS__)
+#define sr_dbg(...)	sr_log_level(SR_LOG_DBG,  __VA_ARGS__)
+#define sr_info(...)	sr_log_level(SR_LOG_INFO, __VA_ARGS__)
+#define sr_warn(...)	sr_log_level(SR_LOG_WARN, __VA_ARGS__)
+#define sr_err(...)	sr_log_level(SR_LOG_ERR,  __VA_ARGS__)
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -1758,10 +1997,23 @@ struct sr_dev_inst {
 	void *priv;
 	/** Session to which this device is currently assigned. */
 	struct sr_session *session;
+	/**
+	 * Settings which were last applied to the device, by key. Lets
+	 * drivers skip unchanged settings when an acquisition starts.
+	 */
+	GHashTable *applied;
 };
 
 /* Generic device instances */
 SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi);
+SR_PRIV gboolean sr_dev_setting_changed(const struct sr_dev_inst *sdi,
+	const char *key, const void *value, size_t size);
+SR_PRIV void sr_dev_setting_applied(const struct sr_dev_inst *sdi,
+	const char *key, const void *value, size_t size);
+SR_PRIV gboolean sr_dev_command_changed(const struct sr_dev_inst *sdi,
+	const char *command);
+SR_PRIV void sr_dev_command_applied(const struct sr_dev_inst *sdi,
+	const char *command);
 
 #ifdef HAVE_LIBUSB_1_0
 /* USB-specific instances */
@@ -1816,6 +2068,28 @@ SR_PRIV void sr_config_free(struct sr_config *src);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
+/*--- memory.c --------------------------------------------------------------*/
+
+SR_PRIV int sr_mem_reserve(struct sr_context *ctx, size_t size);
+SR_PRIV void sr_mem_charge(struct sr_context *ctx, size_t size);
+SR_PRIV void sr_mem_release(struct sr_context *ctx, size_t size);
+SR_PRIV gboolean sr_mem_fits(struct sr_context *ctx, uint64_t size);
+SR_PRIV struct sr_context *sr_dev_inst_mem_ctx(const struct sr_dev_inst *sdi);
+
+/*--- thread_policy.c -------------------------------------------------------*/
+
+/** CPU affinity and scheduling of a class of threads. */
+struct sr_thread_policy {
+	/** CPUs to run on, all of them when cpu_count is 0. */
+	unsigned int *cpus;
+	size_t cpu_count;
+	/** SCHED_FIFO priority, 0 for the default scheduling. */
+	int rt_priority;
+};
+
+SR_PRIV void sr_thread_policy_apply(const struct sr_thread_policy *policy,
+		const char *name);
+
 /*--- session.c -------------------------------------------------------------*/
 
 struct sr_session {
@@ -1835,7 +2109,10 @@ struct sr_session {
 	/** User data to be passed to the session stop callback. */
 	void *stopped_cb_data;
 
-	/** Mutex protecting the main context pointer. */
+	/**
+	 * Mutex protecting the main context pointer, the registered event
+	 * sources, and the stop check source ID.
+	 */
 	GMutex main_mutex;
 	/** Context of the session main loop. */
 	GMainContext *main_context;
@@ -1848,6 +2125,59 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Restart acquisition when the current run completes (atomic). */
+	gint rearm;
+
+	/** Depth of the asynchronous dispatch queue, 0 to dispatch inline. */
+	size_t dispatch_depth;
+	/** Back-pressure policy of the asynchronous dispatch queue. */
+	enum sr_dispatch_policy dispatch_policy;
+	/** Asynchronous dispatch queue and thread, while running. */
+	struct session_dispatch *dispatch;
+	/** Number of sample data packets dropped by the dispatch queue. */
+	uint64_t dispatch_dropped;
+	/** Number of fan-out threads for datafeed callbacks, 0 to disable. */
+	unsigned int fanout_threads;
+	/** Fan-out worker pool, while running. */
+	struct session_fanout *fanout;
+	/** Transforms and callbacks, resolved for the datafeed hot path. */
+	struct dispatch_table *dispatch_table;
+	/** Whether the dispatch table needs to get rebuilt. */
+	gboolean dispatch_table_stale;
+	/** Pool of sample data buffers, see sr_session_buffer_get(). */
+	struct buffer_pool *buffer_pool;
+	/** Highest fill level of the dispatch queue. */
+	size_t dispatch_high_water;
+	/** Protects the datafeed statistics. */
+	GMutex stats_mutex;
+	/** Per-device datafeed statistics, keyed by sdi. */
+	GHashTable *dev_stats;
+	/** Monotonic time of the session start. */
+	int64_t stats_start;
+	/** Whether each device runs in a thread of its own. */
+	gboolean device_threads;
+	/** Whether consumers accept SR_DF_LOGIC_PLANAR packets. */
+	gboolean logic_planar;
+	/** List of struct device_loop pointers, while running. */
+	GSList *device_loops;
+	/** Serializes the datafeed of device threads. */
+	GRecMutex feed_mutex;
+	/** Flight recorder, see sr_session_recorder_set(). */
+	struct session_recorder *recorder;
+	/** Logic channel layouts, keyed by sdi, see sr_logic_layout_get(). */
+	GHashTable *logic_layouts;
+	/** Devices' time bases, see sr_session_timebase_get(). */
+	struct session_timebase *timebase;
+	/** Outputs on worker threads, see sr_session_output_add(). */
+	struct session_outputs *outputs;
+	/** Capture store, see sr_session_store_set(). */
+	struct session_store *store;
+	/** Kernel event sets of the main contexts, see session_poller.c. */
+	struct session_pollers *pollers;
+	/** Policies of device, dispatch and fan-out threads. */
+	struct sr_thread_policy device_thread_policy;
+	struct sr_thread_policy dispatch_thread_policy;
+	struct sr_thread_policy fanout_thread_policy;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1856,6 +2186,7 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 		void *key);
 SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		void *key, GSource *source);
+SR_PRIV GMainContext *sr_session_source_context(struct sr_session *session);
 SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 		void *key, gintptr fd, int events, int timeout,
 		sr_receive_data_callback cb, void *cb_data);
@@ -1878,6 +2209,18 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_many(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *const *packets, size_t count);
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf);
+SR_PRIV gboolean sr_session_logic_planar_accepted(const struct sr_session *session);
+SR_PRIV struct sr_buffer *sr_session_buffer_get(struct sr_session *session,
+		size_t size);
+SR_PRIV void sr_session_dispatch_invalidate(struct sr_session *session);
+SR_PRIV int sr_transform_send(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_transfer_stats_set(const struct sr_dev_inst *sdi,
+		const struct sr_transfer_stats *stats);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
@@ -1892,6 +2235,86 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
+/*
+ * Uncompressed session files ("srraw"): a header of SR_RAWFILE_ALIGN
+ * bytes, the logic plane, one plane per analog channel (native float
+ * values), and the metadata. Planes and metadata start at multiples of
+ * SR_RAWFILE_ALIGN. The header has the magic, the format version, the
+ * alignment, and the metadata's offset and size (all little endian).
+ * The metadata has the srzip keys, plus the planes' offsets and sizes.
+ */
+#define SR_RAWFILE_MAGIC "SRRAW01\n"
+#define SR_RAWFILE_VERSION 1
+#define SR_RAWFILE_ALIGN 4096
+#define SR_RAWFILE_HDR_VERSION 8
+#define SR_RAWFILE_HDR_ALIGN 12
+#define SR_RAWFILE_HDR_META_OFFSET 16
+#define SR_RAWFILE_HDR_META_SIZE 24
+#define SR_RAWFILE_HDR_SIZE 32
+
+SR_PRIV int sr_rawfile_check(const char *filename);
+SR_PRIV GKeyFile *sr_rawfile_read_metadata(const char *data, size_t size);
+SR_PRIV int sr_sessionfile_compression_lookup(const char *name,
+			int32_t *method, gboolean compress);
+SR_PRIV GSList *sr_sessionfile_compression_names(void);
+SR_PRIV int sr_sessionfile_analog_encoding(GKeyFile *kf, const char *group,
+		int ch_nr, struct sr_analog_encoding *encoding);
+
+/*--- session_output.c ------------------------------------------------------*/
+
+struct session_outputs;
+
+SR_PRIV void sr_session_outputs_feed(struct session_outputs *outputs,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_outputs_free(struct session_outputs *outputs);
+
+/*--- session_poller.c ------------------------------------------------------*/
+
+struct session_pollers;
+struct sr_poller;
+
+SR_PRIV struct session_pollers *sr_session_pollers_new(void);
+SR_PRIV void sr_session_pollers_free(struct session_pollers *pollers);
+SR_PRIV struct sr_poller *sr_session_poller_get(struct sr_session *session);
+SR_PRIV void sr_session_poller_unref(struct sr_poller *poller);
+SR_PRIV int sr_session_poller_add(struct sr_poller *poller, gintptr fd,
+		gushort events, gushort *revents);
+SR_PRIV void sr_session_poller_rearm(struct sr_poller *poller, gintptr fd);
+SR_PRIV void sr_session_poller_remove(struct sr_poller *poller, gintptr fd);
+
+/*--- session_recorder.c ----------------------------------------------------*/
+
+struct session_recorder;
+
+SR_PRIV void sr_session_recorder_feed(struct session_recorder *recorder,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_recorder_free(struct session_recorder *recorder);
+
+/*--- session_store.c -------------------------------------------------------*/
+
+struct session_store;
+
+SR_PRIV void sr_session_store_feed(struct session_store *store,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_store_free(struct session_store *store);
+
+/*--- session_timebase.c ----------------------------------------------------*/
+
+struct session_timebase;
+
+SR_PRIV struct session_timebase *sr_session_timebase_new(void);
+SR_PRIV void sr_session_timebase_free(struct session_timebase *timebase);
+SR_PRIV void sr_session_timebase_reset(struct session_timebase *timebase);
+SR_PRIV void sr_session_timebase_feed(struct session_timebase *timebase,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV int64_t sr_session_timebase_sample_time(
+		struct session_timebase *timebase,
+		const struct sr_dev_inst *sdi, uint64_t sample,
+		uint64_t *samplerate);
 
 /*--- analog.c --------------------------------------------------------------*/
 
@@ -1900,6 +2323,15 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV gboolean sr_analog_raw_supported(const struct sr_analog_encoding *encoding);
+SR_PRIV void sr_analog_raw_load(const struct sr_analog_encoding *encoding,
+		const uint8_t *p, size_t step, size_t n, int64_t *raw);
+
+/*--- conversion.c ----------------------------------------------------------*/
+
+SR_PRIV void sr_bit_planes64_to_logic(const uint8_t *src, size_t num_blocks,
+		size_t num_planes, const uint8_t *plane_bits,
+		uint8_t *out, size_t unitsize);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -1991,12 +2423,53 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV gboolean sr_resource_upload_matches(struct sr_context *ctx,
+		const char *device, int type, const char *name);
+SR_PRIV void sr_resource_upload_done(struct sr_context *ctx,
+		const char *device, int type, const char *name);
+
+/*--- output/output.c -------------------------------------------------------*/
+
+SR_PRIV void sr_output_logic_transpose(const uint8_t *data,
+		size_t unitsize, size_t count, uint8_t *rows, size_t row_size);
+SR_PRIV size_t sr_output_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *last);
+
+/*
+ * Logic data decimated to a bounded number of columns per channel.
+ * Each column covers span samples, and has the first and last value of
+ * the channel in that range, plus whether the channel toggled at all.
+ * When all columns are used up, neighbours get merged and the span
+ * doubles. So the whole capture always fits the given width.
+ */
+#define SR_LOGIC_COLUMN_FIRST (1 << 0)
+#define SR_LOGIC_COLUMN_LAST (1 << 1)
+#define SR_LOGIC_COLUMN_TOGGLED (1 << 2)
+
+struct sr_logic_columns {
+	size_t num_channels;
+	size_t max_columns;
+	size_t num_columns;
+	uint64_t span;
+	uint64_t filled;
+	/* max_columns columns for each channel. */
+	uint8_t *columns;
+};
+
+SR_PRIV struct sr_logic_columns *sr_logic_columns_new(size_t num_channels,
+		size_t max_columns);
+SR_PRIV void sr_logic_columns_add(struct sr_logic_columns *lc,
+		const int *channel_index, const uint8_t *data,
+		size_t unitsize, size_t count);
+SR_PRIV size_t sr_logic_columns_count(const struct sr_logic_columns *lc);
+SR_PRIV void sr_logic_columns_free(struct sr_logic_columns *lc);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
 SR_PRIV int sr_atol(const char *str, long *ret);
 SR_PRIV int sr_atol_base(const char *str, long *ret, char **end, int base);
 SR_PRIV int sr_atoul_base(const char *str, unsigned long *ret, char **end, int base);
+SR_PRIV int sr_atou64(const char *str, uint64_t *ret);
 SR_PRIV int sr_atoi(const char *str, int *ret);
 SR_PRIV int sr_atod(const char *str, double *ret);
 SR_PRIV int sr_atof(const char *str, float *ret);
@@ -2004,21 +2477,40 @@ SR_PRIV int sr_atod_ascii(const char *str, double *ret);
 SR_PRIV int sr_atod_ascii_digits(const char *str, double *ret, int *digits);
 SR_PRIV int sr_atof_ascii(const char *str, float *ret);
 SR_PRIV int sr_atof_ascii_digits(const char *str, float *ret, int *digits);
+SR_PRIV int sr_atof_ascii_list(const char *str, char separator,
+	float *values, size_t size, size_t *count);
 
 SR_PRIV int sr_count_digits(const char *str, int *digits);
 
 SR_PRIV GString *sr_hexdump_new(const uint8_t *data, const size_t len);
 SR_PRIV void sr_hexdump_free(GString *s);
+SR_PRIV void sr_string_append_u64(GString *s, uint64_t value);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+struct soft_trigger_stage;
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
 	int unitsize;
-	int cur_stage;
+	/* Trigger stages, compiled to masks of 64-bit sample words. */
+	struct soft_trigger_stage *stages;
+	int num_stages;
+	int num_words;
+	uint64_t *masks;
+	uint64_t *words;
+	gboolean have_prev;
 	uint8_t *prev_sample;
+	/* Position of the next sample, for stage timing. */
+	uint64_t pos;
+	/* Segmented acquisition, see soft_trigger_logic_segments_set(). */
+	uint64_t post_trigger_samples;
+	uint64_t post_trigger_left;
+	gboolean segment_open;
+	uint64_t segments;
+	/* Pre-trigger circular buffer, memory of a reference counted buffer. */
+	struct sr_buffer *pre_trigger_buf;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
 	int pre_trigger_size;
@@ -2030,9 +2522,26 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples);
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
+SR_PRIV void soft_trigger_logic_reset(struct soft_trigger_logic *stl);
+SR_PRIV void soft_trigger_logic_segments_set(struct soft_trigger_logic *stl,
+		uint64_t post_trigger_samples);
+SR_PRIV int soft_trigger_logic_segments_feed(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len);
+SR_PRIV void soft_trigger_logic_segment_close(struct soft_trigger_logic *stl);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
 
+struct soft_trigger_analog;
+
+SR_PRIV gboolean soft_trigger_is_analog(const struct sr_trigger *trigger);
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		uint64_t pre_trigger_samples);
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta);
+SR_PRIV int soft_trigger_analog_send(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV gboolean soft_trigger_analog_fired(const struct soft_trigger_analog *sta);
+
 /*--- serial.c --------------------------------------------------------------*/
 
 #ifdef HAVE_SERIAL_COMM
@@ -2085,8 +2594,14 @@ SR_PRIV int serial_source_remove(struct sr_session *session,
 SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id);
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes);
 
+SR_PRIV void sr_ser_alloc_rx_queue(struct sr_serial_dev_inst *serial,
+		size_t size);
 SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial);
 SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial);
+SR_PRIV size_t sr_ser_peek_queued_data(struct sr_serial_dev_inst *serial,
+		const uint8_t **data);
+SR_PRIV void sr_ser_consume_queued_data(struct sr_serial_dev_inst *serial,
+		size_t len);
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 		const uint8_t *data, size_t len);
 SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
@@ -2183,6 +2698,8 @@ SR_PRIV int sr_bt_config_notify(struct sr_bt_desc *desc,
 	uint16_t read_handle, uint16_t write_handle,
 	uint16_t cccd_handle, uint16_t cccd_value,
 	uint16_t ble_mtu);
+SR_PRIV int sr_bt_config_ble_link(struct sr_bt_desc *desc,
+	uint16_t att_mtu, uint16_t conn_interval_ms);
 
 SR_PRIV int sr_bt_scan_le(struct sr_bt_desc *desc, int duration);
 SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration);
@@ -2198,6 +2715,7 @@ SR_PRIV ssize_t sr_bt_write(struct sr_bt_desc *desc,
 
 SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc);
 SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc);
+SR_PRIV int sr_bt_check_notify_batch(struct sr_bt_desc *desc, size_t max_count);
 #endif
 
 /*--- ezusb.c ---------------------------------------------------------------*/
@@ -2208,6 +2726,10 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx, libusb_device_handle
 				   const char *name);
 SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 				  int configuration, const char *name);
+/* Takes >= 300ms for the FX2 to be gone from the USB bus. */
+#define EZUSB_RENUM_GONE_DELAY_MS 300
+SR_PRIV int ezusb_wait_renum(struct sr_dev_inst *sdi, int64_t fw_updated,
+	int gone_ms, int max_delay_ms, int (*open_cb)(struct sr_dev_inst *sdi));
 #endif
 
 /*--- usb.c -----------------------------------------------------------------*/
@@ -2215,20 +2737,45 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 SR_PRIV int sr_usb_split_conn(const char *conn,
 	uint16_t *vid, uint16_t *pid, uint8_t *bus, uint8_t *addr);
 #ifdef HAVE_LIBUSB_1_0
+SR_PRIV void sr_usb_device_list_share(libusb_context *usb_ctx);
+SR_PRIV void sr_usb_device_list_unshare(libusb_context *usb_ctx);
+SR_PRIV ssize_t sr_usb_get_device_list(libusb_context *usb_ctx,
+		libusb_device ***list);
 SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
+SR_PRIV int sr_usb_open_private(struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+SR_PRIV int usb_context_source_add(struct sr_session *session,
+		libusb_context *usb_ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data);
+SR_PRIV int usb_context_source_remove(struct sr_session *session,
+		libusb_context *usb_ctx);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
+SR_PRIV void sr_usb_stream_config_profile(struct sr_usb_stream_config *cfg,
+		enum sr_usb_stream_profile profile,
+		const struct sr_transfer_stats *prev);
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(
+		struct libusb_device_handle *devhdl,
+		const struct sr_usb_stream_config *cfg);
+SR_PRIV int sr_usb_stream_start(struct sr_usb_stream *stream);
+SR_PRIV void sr_usb_stream_abort(struct sr_usb_stream *stream);
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream);
+SR_PRIV struct sr_usb_decoder *sr_usb_decoder_new(size_t buffer_size,
+		unsigned int num_buffers, sr_usb_decode_cb cb, void *cb_data);
+SR_PRIV void sr_usb_decoder_push(struct sr_usb_decoder *dec,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_decoder_finish(struct sr_usb_decoder *dec);
 #endif
 
 /*--- tcp.c -----------------------------------------------------------------*/
 
 SR_PRIV gboolean sr_fd_is_readable(int fd);
+SR_PRIV int sr_tcp_set_sock_opts(int fd);
 
 SR_PRIV struct sr_tcp_dev_inst *sr_tcp_dev_inst_new(
 	const char *host_addr, const char *tcp_port);
@@ -2236,17 +2783,51 @@ SR_PRIV void sr_tcp_dev_inst_free(struct sr_tcp_dev_inst *tcp);
 SR_PRIV int sr_tcp_get_port_path(struct sr_tcp_dev_inst *tcp,
 	const char *prefix, char separator, char *path, size_t path_len);
 SR_PRIV int sr_tcp_connect(struct sr_tcp_dev_inst *tcp);
+SR_PRIV int sr_tcp_listen(struct sr_tcp_dev_inst *tcp);
+SR_PRIV struct sr_tcp_dev_inst *sr_tcp_accept(struct sr_tcp_dev_inst *listener);
 SR_PRIV int sr_tcp_disconnect(struct sr_tcp_dev_inst *tcp);
 SR_PRIV int sr_tcp_write_bytes(struct sr_tcp_dev_inst *tcp,
 	const uint8_t *data, size_t dlen);
 SR_PRIV int sr_tcp_read_bytes(struct sr_tcp_dev_inst *tcp,
 	uint8_t *data, size_t dlen, gboolean nonblocking);
+SR_PRIV gboolean sr_tcp_is_readable(struct sr_tcp_dev_inst *tcp);
+SR_PRIV gboolean sr_tcp_wait_readable(struct sr_tcp_dev_inst *tcp,
+	int timeout_ms);
 SR_PRIV int sr_tcp_source_add(struct sr_session *session,
 	struct sr_tcp_dev_inst *tcp, int events, int timeout,
 	sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int sr_tcp_source_remove(struct sr_session *session,
 	struct sr_tcp_dev_inst *tcp);
 
+/*
+ * Datafeed streams over TCP, which the "remote" output module serves,
+ * and the sigrok-remote driver receives. Both directions carry frames
+ * of an SR_NETSTREAM_FRAME_HEADER bytes header (type, flags, and the
+ * payload size; u16, u16, u32) and the payload. All numbers are little
+ * endian. The server sends an SR_NETSTREAM_HELLO frame to new clients,
+ * and the datafeed of the running acquisition (frames of the SR_DF_*
+ * packet types) once the client sent SR_NETSTREAM_START. Clients
+ * acknowledge the frames which they processed in SR_NETSTREAM_CREDIT
+ * frames, the server keeps no more sample data in flight than the
+ * client's window. Payloads with SR_NETSTREAM_FLAG_LZO are the raw
+ * size (u32) and the LZO1X compressed payload. See output/remote.c
+ * for the payloads' layout.
+ */
+#define SR_NETSTREAM_VERSION 1
+#define SR_NETSTREAM_DEFAULT_PORT "37231"
+#define SR_NETSTREAM_FRAME_HEADER 8
+#define SR_NETSTREAM_MAX_PAYLOAD (256 * 1024 * 1024)
+#define SR_NETSTREAM_FLAG_LZO (1 << 0)
+
+enum sr_netstream_frame {
+	/* Server: version, device and channels. */
+	SR_NETSTREAM_HELLO = 1,
+	/* Client: start streaming, u32 window in bytes. */
+	SR_NETSTREAM_START,
+	/* Client: u32 number of bytes processed. */
+	SR_NETSTREAM_CREDIT,
+};
+
 /*--- binary_helpers.c ------------------------------------------------------*/
 
 /** Binary value type */
@@ -2333,8 +2914,12 @@ struct sr_modbus_dev_inst {
 	void (*free)(void *priv);
 	unsigned int read_timeout_ms;
 	void *priv;
+	/** Monotonic time [us] of the most recent data reception. */
+	int64_t rx_time;
 };
 
+struct sr_modbus_read_plan;
+
 SR_PRIV GSList *sr_modbus_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_modbus_dev_inst *modbus));
 SR_PRIV struct sr_modbus_dev_inst *modbus_dev_inst_new(const char *resource,
@@ -2357,6 +2942,14 @@ SR_PRIV int sr_modbus_read_coils(struct sr_modbus_dev_inst *modbus,
 SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
                                              int address, int nb_registers,
                                              uint16_t *registers);
+SR_PRIV struct sr_modbus_read_plan *sr_modbus_read_plan_new(
+                                 unsigned int max_gap);
+SR_PRIV int sr_modbus_read_plan_add(struct sr_modbus_read_plan *plan,
+                                    int address, int nb_registers,
+                                    uint16_t *registers);
+SR_PRIV int sr_modbus_read_plan_run(struct sr_modbus_dev_inst *modbus,
+                                    struct sr_modbus_read_plan *plan);
+SR_PRIV void sr_modbus_read_plan_free(struct sr_modbus_read_plan *plan);
 SR_PRIV int sr_modbus_write_coil(struct sr_modbus_dev_inst *modbus,
                                  int address, int value);
 SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
@@ -2833,6 +3426,41 @@ SR_PRIV gboolean sr_kern_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_kern_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
 
+/*--- logic_layout.c --------------------------------------------------------*/
+
+/** Location of an enabled logic channel in sample data. */
+struct sr_logic_layout_channel {
+	struct sr_channel *ch;
+	/** Bit position in the sample data, the channel's index. */
+	size_t index;
+	/** Byte offset within a sample. */
+	size_t offset;
+	/** Bit mask within that byte. */
+	uint8_t mask;
+};
+
+/** Immutable layout of a device's enabled logic channels. */
+struct sr_logic_layout {
+	gint refcount;
+	/** Number of enabled logic channels. */
+	size_t count;
+	/** Enabled logic channels, in the order of the channel list. */
+	struct sr_logic_layout_channel *channels;
+	/** Size of the by_index[] table, highest enabled index plus one. */
+	size_t index_count;
+	/** Enabled logic channels by index, NULL for disabled ones. */
+	struct sr_logic_layout_channel **by_index;
+	/** Number of bytes which cover all enabled channels. */
+	size_t unitsize;
+	/** Mask of all enabled channels, unitsize bytes. */
+	uint8_t *enabled_mask;
+};
+
+SR_PRIV struct sr_logic_layout *sr_logic_layout_get(const struct sr_dev_inst *sdi);
+SR_PRIV struct sr_logic_layout *sr_logic_layout_ref(struct sr_logic_layout *layout);
+SR_PRIV void sr_logic_layout_unref(struct sr_logic_layout *layout);
+SR_PRIV void sr_logic_layout_session_update(struct sr_session *session);
+
 /*--- sw_limits.c -----------------------------------------------------------*/
 
 struct sr_sw_limits {
@@ -2842,6 +3470,9 @@ struct sr_sw_limits {
 	uint64_t samples_read;
 	uint64_t frames_read;
 	uint64_t start_time;
+	/* Session of the time limit timer, see sr_sw_limits_start_timer(). */
+	struct sr_session *msec_timer;
+	gint msec_expired;
 };
 
 SR_PRIV int sr_sw_limits_config_get(const struct sr_sw_limits *limits, uint32_t key,
@@ -2853,8 +3484,13 @@ SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits);
 SR_PRIV int sr_sw_limits_get_remain(const struct sr_sw_limits *limits,
 	uint64_t *samples, uint64_t *frames, uint64_t *msecs,
 	gboolean *exceeded);
+SR_PRIV int sr_sw_limits_start_timer(struct sr_sw_limits *limits,
+	struct sr_session *session);
+SR_PRIV void sr_sw_limits_stop_timer(struct sr_sw_limits *limits);
 SR_PRIV void sr_sw_limits_update_samples_read(struct sr_sw_limits *limits,
 	uint64_t samples_read);
+SR_PRIV uint64_t sr_sw_limits_accept_samples(struct sr_sw_limits *limits,
+	uint64_t count);
 SR_PRIV void sr_sw_limits_update_frames_read(struct sr_sw_limits *limits,
 	uint64_t frames_read);
 SR_PRIV void sr_sw_limits_init(struct sr_sw_limits *limits);
@@ -2867,8 +3503,11 @@ struct feed_queue_analog;
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size);
+SR_API int feed_queue_logic_runs(struct feed_queue_logic *q, size_t min_run);
 SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count);
+SR_API int feed_queue_logic_submit_runs(struct feed_queue_logic *q,
+	const uint8_t *data, const size_t *repeat_counts, size_t run_count);
 SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	const uint8_t *data, size_t samples_count);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
@@ -2882,8 +3521,18 @@ SR_API int feed_queue_analog_mq_unit(struct feed_queue_analog *q,
 	enum sr_mq mq, enum sr_mqflag mq_flag, enum sr_unit unit);
 SR_API int feed_queue_analog_scale_offset(struct feed_queue_analog *q,
 	const struct sr_rational *scale, const struct sr_rational *offset);
+SR_API int feed_queue_analog_digits(struct feed_queue_analog *q,
+	int digits, int spec_digits);
+SR_API int feed_queue_analog_timestamp(struct feed_queue_analog *q,
+	int64_t timestamp);
+SR_API int feed_queue_analog_native(struct feed_queue_analog *q,
+	size_t unit_size, gboolean is_signed, gboolean is_float);
 SR_API int feed_queue_analog_submit_one(struct feed_queue_analog *q,
 	float data, size_t repeat_count);
+SR_API int feed_queue_analog_submit_many(struct feed_queue_analog *q,
+	const float *data, size_t samples_count);
+SR_API int feed_queue_analog_submit_native(struct feed_queue_analog *q,
+	const void *data, size_t samples_count);
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q);
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q);
 
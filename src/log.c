@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -42,8 +43,11 @@
  * @{
  */
 
-/* Currently selected libsigrok loglevel. Default: SR_LOG_WARN. */
-static int cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
+/*
+ * Currently selected libsigrok loglevel. Default: SR_LOG_WARN.
+ * The message helpers (sr_err() etc.) check it before formatting.
+ */
+SR_PRIV int sr_log_cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
 
 /* Function prototype. */
 static int sr_logv(void *cb_data, int loglevel, const char *format,
@@ -58,6 +62,36 @@ static sr_log_callback sr_log_cb = sr_logv;
  */
 static void *sr_log_cb_data = NULL;
 
+/* Structured log callback, takes precedence over sr_log_cb when set. */
+static sr_log_record_callback sr_log_record_cb = NULL;
+static void *sr_log_record_cb_data = NULL;
+
+/*
+ * Messages are formatted into a buffer of the logging thread, which
+ * is kept for the thread's lifetime. A message logged while the buffer
+ * is in use (from within a log callback) gets a temporary one.
+ */
+struct log_buffer {
+	char *data;
+	size_t size;
+	gboolean busy;
+};
+
+/** @cond PRIVATE */
+#define LOG_BUFFER_SIZE 256
+/** @endcond */
+
+static void log_buffer_free(gpointer data)
+{
+	struct log_buffer *buf;
+
+	buf = data;
+	g_free(buf->data);
+	g_free(buf);
+}
+
+static GPrivate log_buffer_key = G_PRIVATE_INIT(log_buffer_free);
+
 /** @cond PRIVATE */
 #define LOGLEVEL_TIMESTAMP SR_LOG_DBG
 /** @endcond */
@@ -90,7 +124,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
 	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
 		sr_log_start_time = g_get_monotonic_time();
 
-	cur_loglevel = loglevel;
+	sr_log_cur_loglevel = loglevel;
 
 	sr_dbg("libsigrok loglevel set to %d.", loglevel);
 
@@ -106,7 +140,7 @@ SR_API int sr_log_loglevel_set(int loglevel)
  */
 SR_API int sr_log_loglevel_get(void)
 {
-	return cur_loglevel;
+	return sr_log_cur_loglevel;
 }
 
 /**
@@ -182,27 +216,119 @@ SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data)
 	return SR_OK;
 }
 
+/**
+ * Set a structured log callback.
+ *
+ * Log messages are passed to this callback instead of the one set with
+ * sr_log_callback_set(), already formatted and split into the prefix and
+ * the message text. Formatting happens in a buffer of the logging thread
+ * which is reused for its messages, so no allocations or locks are
+ * involved. Messages of suppressed loglevels are not formatted at all.
+ *
+ * The callback may run on any thread which logs. The record and its
+ * strings are only valid during the callback.
+ *
+ * @param cb Function pointer to the callback, or NULL to pass messages
+ *           to the sr_log_callback_set() callback again.
+ * @param cb_data Pointer to private data to be passed on. Can be NULL.
+ *
+ * @return SR_OK upon success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_record_callback_set(sr_log_record_callback cb, void *cb_data)
+{
+	sr_log_record_cb_data = cb_data;
+	sr_log_record_cb = cb;
+
+	return SR_OK;
+}
+
+static struct log_buffer *log_buffer_acquire(void)
+{
+	struct log_buffer *buf;
+
+	buf = g_private_get(&log_buffer_key);
+	if (!buf) {
+		buf = g_malloc0(sizeof(*buf));
+		g_private_set(&log_buffer_key, buf);
+	}
+	if (buf->busy)
+		buf = g_malloc0(sizeof(*buf));
+	if (!buf->data) {
+		buf->size = LOG_BUFFER_SIZE;
+		buf->data = g_malloc(buf->size);
+	}
+	buf->busy = TRUE;
+
+	return buf;
+}
+
+static void log_buffer_release(struct log_buffer *buf)
+{
+	if (buf != g_private_get(&log_buffer_key)) {
+		log_buffer_free(buf);
+		return;
+	}
+	buf->busy = FALSE;
+}
+
+/*
+ * Format a message into the buffer at an offset, dropping line breaks.
+ * Returns the length of the message text, or a negative value.
+ */
+static int log_buffer_vprintf(struct log_buffer *buf, size_t offset,
+		const char *format, va_list args)
+{
+	va_list args_copy;
+	int len;
+	char *rd, *wr, c;
+
+	va_copy(args_copy, args);
+	len = g_vsnprintf(buf->data + offset, buf->size - offset,
+			format, args_copy);
+	va_end(args_copy);
+	if (len < 0)
+		return len;
+	if (offset + len >= buf->size) {
+		buf->size = offset + len + 1;
+		buf->data = g_realloc(buf->data, buf->size);
+		va_copy(args_copy, args);
+		len = g_vsnprintf(buf->data + offset, buf->size - offset,
+				format, args_copy);
+		va_end(args_copy);
+		if (len < 0)
+			return len;
+	}
+
+	wr = rd = buf->data + offset;
+	while ((c = *rd++)) {
+		if (c == '\r' || c == '\n')
+			continue;
+		*wr++ = c;
+	}
+	*wr = '\0';
+
+	return wr - (buf->data + offset);
+}
+
 static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
 {
-	int ret;
+	struct log_buffer *buf;
 	uint64_t elapsed_us, minutes;
 	unsigned int rest_us, seconds, microseconds;
-	char *raw_output, *output, c;
-	ssize_t print_len;
-	size_t raw_len;
-	const char *raw_ptr;
-	char *out_ptr;
+	int offset, len;
+	size_t written;
 
 	/* This specific log callback doesn't need the void pointer data. */
 	(void)cb_data;
 
 	(void)loglevel;
 
+	buf = log_buffer_acquire();
+
 	/* Prefix with 'sr:'. Optionally prefix with timestamp. */
-	ret = fputs("sr: ", stderr);
-	if (ret < 0)
-		return SR_ERR;
-	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
+	if (sr_log_cur_loglevel >= LOGLEVEL_TIMESTAMP) {
 		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
@@ -210,42 +336,59 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 		seconds = rest_us / G_TIME_SPAN_SECOND;
 		microseconds = rest_us % G_TIME_SPAN_SECOND;
 
-		ret = g_fprintf(stderr, "[%.2" PRIu64 ":%.2u.%.6u] ",
+		offset = g_snprintf(buf->data, buf->size,
+				"sr: [%.2" PRIu64 ":%.2u.%.6u] ",
 				minutes, seconds, microseconds);
-		if (ret < 0)
-			return SR_ERR;
+	} else {
+		offset = g_snprintf(buf->data, buf->size, "sr: ");
 	}
 
-	/* Print the caller's message into a local buffer. */
-	raw_output = NULL;
-	print_len = g_vasprintf(&raw_output, format, args);
-	if (print_len < 0) {
-		g_free(raw_output);
+	/* Append the caller's message, and print all of it at once. */
+	len = log_buffer_vprintf(buf, offset, format, args);
+	if (len < 0) {
+		log_buffer_release(buf);
 		return SR_ERR;
 	}
-	raw_len = (size_t)print_len;
+	len += offset;
+	buf->data[len++] = '\n';
+	written = fwrite(buf->data, 1, len, stderr);
+	fflush(stderr);
+	log_buffer_release(buf);
+
+	return (written == (size_t)len) ? SR_OK : SR_ERR;
+}
 
-	/* Copy the string. Strip unwanted line breaks. */
-	output = g_malloc(raw_len + 1);
-	if (!output) {
-		g_free(raw_output);
+static int log_record_emit(sr_log_record_callback cb, void *cb_data,
+		int loglevel, const char *format, va_list args)
+{
+	struct sr_log_record record;
+	struct log_buffer *buf;
+	char *sep;
+	int len;
+
+	buf = log_buffer_acquire();
+	len = log_buffer_vprintf(buf, 0, format, args);
+	if (len < 0) {
+		log_buffer_release(buf);
 		return SR_ERR;
 	}
-	out_ptr = output;
-	raw_ptr = raw_output;
-	while (*raw_ptr) {
-		c = *raw_ptr++;
-		if (c == '\r' || c == '\n')
-			continue;
-		*out_ptr++ = c;
-	}
-	*out_ptr = '\0';
-	g_free(raw_output);
 
-	/* Print the trimmed output text. */
-	g_fprintf(stderr, "%s\n", output);
-	fflush(stderr);
-	g_free(output);
+	record.loglevel = loglevel;
+	record.timestamp = g_get_monotonic_time();
+	/* Messages start with the logging subsystem's LOG_PREFIX. */
+	sep = strstr(buf->data, ": ");
+	if (sep) {
+		*sep = '\0';
+		record.prefix = buf->data;
+		record.message = sep + 2;
+		record.message_len = len - (record.message - buf->data);
+	} else {
+		record.prefix = "";
+		record.message = buf->data;
+		record.message_len = len;
+	}
+	cb(&record, cb_data);
+	log_buffer_release(buf);
 
 	return SR_OK;
 }
@@ -255,11 +398,21 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 {
 	int ret;
 	va_list args;
+	sr_log_record_callback record_cb;
 
 	/* Only output messages of at least the selected loglevel(s). */
-	if (loglevel > cur_loglevel)
+	if (loglevel > sr_log_cur_loglevel)
 		return SR_OK;
 
+	record_cb = sr_log_record_cb;
+	if (record_cb) {
+		va_start(args, format);
+		ret = log_record_emit(record_cb, sr_log_record_cb_data,
+				loglevel, format, args);
+		va_end(args);
+		return ret;
+	}
+
 	/* Silently succeed when no logging callback is registered. */
 	if (!sr_log_cb)
 		return SR_OK;
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * Logic channel layout of a device's sample data
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include <string.h>
+
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "logic-layout"
+
+/*
+ * A layout describes where the enabled logic channels of a device are
+ * located in its sample data: the byte offset and bit mask of every
+ * channel in the order of the device's channel list, a lookup table by
+ * channel index, and the mask of all enabled bits. Consumers determine
+ * the layout once and don't need to walk channel lists or divide bit
+ * positions while they process sample data.
+ *
+ * Layouts are immutable after construction. The session determines
+ * a layout for each of its devices when acquisition starts, modules
+ * get a reference to it by means of sr_logic_layout_get().
+ */
+
+static struct sr_logic_layout *logic_layout_new(const struct sr_dev_inst *sdi)
+{
+	struct sr_logic_layout *layout;
+	struct sr_logic_layout_channel *lc;
+	struct sr_channel *ch;
+	GSList *l;
+	size_t count, index_count;
+
+	count = 0;
+	index_count = 0;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		if (ch->index < 0)
+			continue;
+		count++;
+		index_count = MAX(index_count, (size_t)ch->index + 1);
+	}
+
+	layout = g_malloc0(sizeof(*layout));
+	layout->refcount = 1;
+	layout->count = count;
+	layout->index_count = index_count;
+	layout->unitsize = (index_count + 7) / 8;
+	layout->channels = g_malloc0(MAX(count, 1) * sizeof(layout->channels[0]));
+	layout->by_index = g_malloc0(MAX(index_count, 1) *
+		sizeof(layout->by_index[0]));
+	layout->enabled_mask = g_malloc0(MAX(layout->unitsize, 1));
+
+	lc = layout->channels;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		if (ch->index < 0)
+			continue;
+		lc->ch = ch;
+		lc->index = ch->index;
+		lc->offset = ch->index / 8;
+		lc->mask = 1 << (ch->index % 8);
+		layout->by_index[lc->index] = lc;
+		layout->enabled_mask[lc->offset] |= lc->mask;
+		lc++;
+	}
+
+	return layout;
+}
+
+/**
+ * Get the logic channel layout of a device.
+ *
+ * When the device is part of a session which has started acquisition,
+ * the layout which the session determined at acquisition start gets
+ * shared. Otherwise the layout is determined from the device's current
+ * channel configuration.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @return A reference to the layout, to get released by the caller
+ *         by means of sr_logic_layout_unref(). NULL on invalid input.
+ *
+ * @private
+ */
+SR_PRIV struct sr_logic_layout *sr_logic_layout_get(const struct sr_dev_inst *sdi)
+{
+	struct sr_logic_layout *layout;
+
+	if (!sdi)
+		return NULL;
+
+	layout = NULL;
+	if (sdi->session && sdi->session->logic_layouts)
+		layout = g_hash_table_lookup(sdi->session->logic_layouts, sdi);
+	if (layout)
+		return sr_logic_layout_ref(layout);
+
+	return logic_layout_new(sdi);
+}
+
+/** @private */
+SR_PRIV struct sr_logic_layout *sr_logic_layout_ref(struct sr_logic_layout *layout)
+{
+	if (layout)
+		g_atomic_int_inc(&layout->refcount);
+
+	return layout;
+}
+
+/** @private */
+SR_PRIV void sr_logic_layout_unref(struct sr_logic_layout *layout)
+{
+	if (!layout)
+		return;
+	if (!g_atomic_int_dec_and_test(&layout->refcount))
+		return;
+
+	g_free(layout->channels);
+	g_free(layout->by_index);
+	g_free(layout->enabled_mask);
+	g_free(layout);
+}
+
+/**
+ * Determine the logic channel layouts of all devices in a session.
+ *
+ * Gets called when acquisition starts, after device configurations were
+ * committed. Layouts of a previous acquisition get replaced, consumers
+ * which still hold references keep their (now stale) copy.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_layout_session_update(struct sr_session *session)
+{
+	struct sr_dev_inst *sdi;
+	GSList *l;
+
+	if (!session->logic_layouts)
+		session->logic_layouts = g_hash_table_new_full(NULL, NULL,
+			NULL, (GDestroyNotify)sr_logic_layout_unref);
+	g_hash_table_remove_all(session->logic_layouts);
+
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		g_hash_table_insert(session->logic_layouts, sdi,
+			logic_layout_new(sdi));
+	}
+}
@@ -0,0 +1,231 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * Accounting of large allocations, and an optional memory budget
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "memory"
+
+/**
+ * @defgroup grp_memory Memory budget
+ *
+ * Accounting of memory which acquisitions hold, and an optional limit.
+ *
+ * Components which hold large amounts of memory during acquisition
+ * (driver sample buffers, the session's buffer pool, output modules'
+ * queues) account for it with the context they run in. This gives
+ * applications a global view of the memory use. When a budget is set,
+ * those components fall back to streaming operation where they can,
+ * or refuse configurations which would exceed the budget.
+ *
+ * Small and short lived allocations are not accounted for.
+ *
+ * @{
+ */
+
+/* Protects the accounting fields of all contexts. */
+G_LOCK_DEFINE_STATIC(memory);
+
+/**
+ * Set the memory budget of a context.
+ *
+ * Allocations which are accounted for fail when they would exceed the
+ * budget. The budget does not affect memory which is held already.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param budget The budget in bytes, 0 for no limit (the default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_memory_budget_set(struct sr_context *ctx, uint64_t budget)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	G_LOCK(memory);
+	ctx->mem_budget = budget;
+	G_UNLOCK(memory);
+
+	return SR_OK;
+}
+
+/**
+ * Get the memory budget of a context.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param budget Pointer to store the budget in bytes, 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_memory_budget_get(struct sr_context *ctx, uint64_t *budget)
+{
+	if (!ctx || !budget)
+		return SR_ERR_ARG;
+
+	G_LOCK(memory);
+	*budget = ctx->mem_budget;
+	G_UNLOCK(memory);
+
+	return SR_OK;
+}
+
+/**
+ * Get the amount of memory which is accounted for in a context.
+ *
+ * @param ctx The context to use. Must not be NULL.
+ * @param used Pointer to store the number of bytes currently held.
+ *             Can be NULL.
+ * @param peak Pointer to store the highest number of bytes held since
+ *             the context was created. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_memory_usage_get(struct sr_context *ctx,
+		uint64_t *used, uint64_t *peak)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	G_LOCK(memory);
+	if (used)
+		*used = ctx->mem_used;
+	if (peak)
+		*peak = ctx->mem_peak;
+	G_UNLOCK(memory);
+
+	return SR_OK;
+}
+
+/** @} */
+
+/**
+ * Account for memory which is about to get allocated, within the budget.
+ *
+ * @param ctx The context to account with. NULL disables accounting.
+ * @param size The number of bytes.
+ *
+ * @retval SR_OK Success, release with sr_mem_release().
+ * @retval SR_ERR_MALLOC The allocation would exceed the budget. Nothing
+ *                       was accounted for.
+ *
+ * @private
+ */
+SR_PRIV int sr_mem_reserve(struct sr_context *ctx, size_t size)
+{
+	if (!ctx)
+		return SR_OK;
+
+	G_LOCK(memory);
+	if (ctx->mem_budget && ctx->mem_used + size > ctx->mem_budget) {
+		G_UNLOCK(memory);
+		return SR_ERR_MALLOC;
+	}
+	ctx->mem_used += size;
+	ctx->mem_peak = MAX(ctx->mem_peak, ctx->mem_used);
+	G_UNLOCK(memory);
+
+	return SR_OK;
+}
+
+/**
+ * Account for memory regardless of the budget.
+ *
+ * For allocations which cannot be avoided, like the minimum a component
+ * needs to make progress.
+ *
+ * @private
+ */
+SR_PRIV void sr_mem_charge(struct sr_context *ctx, size_t size)
+{
+	if (!ctx)
+		return;
+
+	G_LOCK(memory);
+	ctx->mem_used += size;
+	ctx->mem_peak = MAX(ctx->mem_peak, ctx->mem_used);
+	G_UNLOCK(memory);
+}
+
+/** @private */
+SR_PRIV void sr_mem_release(struct sr_context *ctx, size_t size)
+{
+	if (!ctx)
+		return;
+
+	G_LOCK(memory);
+	ctx->mem_used -= MIN(size, ctx->mem_used);
+	G_UNLOCK(memory);
+}
+
+/**
+ * Check whether an allocation would fit into the budget.
+ *
+ * For checks at configuration time. Nothing gets accounted for.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_mem_fits(struct sr_context *ctx, uint64_t size)
+{
+	gboolean fits;
+
+	if (!ctx)
+		return TRUE;
+
+	G_LOCK(memory);
+	fits = !ctx->mem_budget || ctx->mem_used + size <= ctx->mem_budget;
+	G_UNLOCK(memory);
+
+	return fits;
+}
+
+/**
+ * Get the context which a device instance accounts its memory with.
+ *
+ * @return The context of the device's driver, or of the session which
+ *         the device is part of. NULL when neither is known.
+ *
+ * @private
+ */
+SR_PRIV struct sr_context *sr_dev_inst_mem_ctx(const struct sr_dev_inst *sdi)
+{
+	struct drv_context *drvc;
+
+	if (!sdi)
+		return NULL;
+	if (sdi->driver && (drvc = sdi->driver->context) && drvc->sr_ctx)
+		return drvc->sr_ctx;
+	if (sdi->session)
+		return sdi->session->ctx;
+
+	return NULL;
+}
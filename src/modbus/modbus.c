@@ -274,6 +274,7 @@ SR_PRIV int sr_modbus_reply(struct sr_modbus_dev_inst *modbus,
 			return SR_ERR;
 		} else if (len > 0) {
 			laststart = g_get_monotonic_time();
+			modbus->rx_time = laststart;
 		}
 		reply += len;
 		reply_size -= len;
@@ -478,6 +479,149 @@ SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return SR_OK;
 }
 
+/* Registers per read holding registers transaction, by the spec. */
+#define MODBUS_MAX_READ_REGISTERS 125
+
+struct modbus_plan_read {
+	int address;
+	int nb_registers;
+	uint16_t *registers;
+};
+
+/** Holding register reads, coalesced into as few transactions as possible. */
+struct sr_modbus_read_plan {
+	GArray *reads;
+	unsigned int max_gap;
+};
+
+/**
+ * Create a plan for reading several ranges of holding registers.
+ *
+ * Ranges which are adjacent, overlap, or are at most max_gap registers
+ * apart get read in one transaction, as long as it does not exceed the
+ * protocol's limit. Skipping a gap costs two bytes per register, while
+ * every transaction costs its request, the reply's framing and the
+ * device's turnaround time. So a few registers of gap are cheaper than
+ * a separate transaction, especially on serial links.
+ *
+ * @param max_gap The number of unwanted registers which may get read
+ *                to join two ranges.
+ *
+ * @return The new plan, free it with sr_modbus_read_plan_free().
+ */
+SR_PRIV struct sr_modbus_read_plan *sr_modbus_read_plan_new(
+		unsigned int max_gap)
+{
+	struct sr_modbus_read_plan *plan;
+
+	plan = g_malloc0(sizeof(*plan));
+	plan->reads = g_array_new(FALSE, FALSE, sizeof(struct modbus_plan_read));
+	plan->max_gap = max_gap;
+
+	return plan;
+}
+
+/**
+ * Add a range of holding registers to a read plan.
+ *
+ * @param plan The read plan.
+ * @param address The Modbus address of the range's first register.
+ * @param nb_registers The number of registers in the range.
+ * @param registers Buffer for the registers' values, in the format of
+ *                  sr_modbus_read_holding_registers(). Must stay valid
+ *                  until the plan has run.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments.
+ */
+SR_PRIV int sr_modbus_read_plan_add(struct sr_modbus_read_plan *plan,
+		int address, int nb_registers, uint16_t *registers)
+{
+	struct modbus_plan_read read;
+
+	if (!plan || !registers || address < 0 || address > 0xFFFF
+	    || nb_registers < 1 || nb_registers > MODBUS_MAX_READ_REGISTERS
+	    || address + nb_registers > 0x10000)
+		return SR_ERR_ARG;
+
+	read.address = address;
+	read.nb_registers = nb_registers;
+	read.registers = registers;
+	g_array_append_val(plan->reads, read);
+
+	return SR_OK;
+}
+
+static gint compare_plan_read(gconstpointer a, gconstpointer b)
+{
+	const struct modbus_plan_read *ra = a, *rb = b;
+
+	return ra->address - rb->address;
+}
+
+/**
+ * Read all ranges of a plan, in as few transactions as possible.
+ *
+ * The plan can run again, e.g. once per poll cycle.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param plan The read plan.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_read_plan_run(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_read_plan *plan)
+{
+	uint16_t buffer[MODBUS_MAX_READ_REGISTERS];
+	struct modbus_plan_read *reads;
+	int start, end, read_end, ret;
+	guint i, j, k;
+
+	if (!modbus || !plan)
+		return SR_ERR_ARG;
+
+	g_array_sort(plan->reads, compare_plan_read);
+	reads = (struct modbus_plan_read *)plan->reads->data;
+
+	for (i = 0; i < plan->reads->len; i = j) {
+		start = reads[i].address;
+		end = start + reads[i].nb_registers;
+		for (j = i + 1; j < plan->reads->len; j++) {
+			if (reads[j].address > end + (int)plan->max_gap)
+				break;
+			read_end = reads[j].address + reads[j].nb_registers;
+			if (MAX(end, read_end) - start > MODBUS_MAX_READ_REGISTERS)
+				break;
+			end = MAX(end, read_end);
+		}
+
+		ret = sr_modbus_read_holding_registers(modbus, start,
+			end - start, buffer);
+		if (ret != SR_OK)
+			return ret;
+		for (k = i; k < j; k++) {
+			memcpy(reads[k].registers, &buffer[reads[k].address - start],
+				2 * reads[k].nb_registers);
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Free a read plan.
+ *
+ * @param plan The read plan. If NULL, this function does nothing.
+ */
+SR_PRIV void sr_modbus_read_plan_free(struct sr_modbus_read_plan *plan)
+{
+	if (!plan)
+		return;
+
+	g_array_free(plan->reads, TRUE);
+	g_free(plan);
+}
+
 /**
  * Send a Modbus write coil command.
  *
@@ -29,13 +29,72 @@
 
 #define BIN_TO_DEC_DIGITS (log(2) / log(10))
 
+/*
+ * Decimal places up to which a float times the power of ten is exact
+ * in a double: 5^12 fits in 29 bits, next to the float's 24 bits.
+ */
+#define FIXED_DIGITS_MAX 12
+
 struct context {
 	int num_enabled_channels;
 	GPtrArray *channellist;
 	int digits;
 	float *fdata;
+	/* Each channel's label ("name: ") of the current packet. */
+	GPtrArray *labels;
+};
+
+static const uint64_t pow10_table[FIXED_DIGITS_MAX + 1] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL,
 };
 
+/*
+ * Append a value with the given number of decimal places, like "%.*f"
+ * does in the C locale, without going through printf(). The scaled
+ * value and its fractional part are exact, so rounding (ties to even)
+ * matches printf(). Values which don't fit take the printf() path.
+ */
+static void append_fixed(GString *out, float value, int digits)
+{
+	char buf[48], *p;
+	double x, whole, frac;
+	uint64_t n, ipart, fpart;
+	int i;
+
+	x = fabs((double)value);
+	if (digits > FIXED_DIGITS_MAX || !(x * pow10_table[digits] < 1e18)) {
+		g_string_append_printf(out, "%.*f", digits, value);
+		return;
+	}
+	x *= pow10_table[digits];
+	whole = floor(x);
+	frac = x - whole;
+	n = (uint64_t)whole;
+	if (frac > 0.5 || (frac == 0.5 && (n & 1)))
+		n++;
+	ipart = n / pow10_table[digits];
+	fpart = n % pow10_table[digits];
+
+	/* Fill the buffer from its end. */
+	p = buf + sizeof(buf);
+	for (i = 0; i < digits; i++) {
+		*--p = '0' + fpart % 10;
+		fpart /= 10;
+	}
+	if (digits)
+		*--p = '.';
+	do {
+		*--p = '0' + ipart % 10;
+		ipart /= 10;
+	} while (ipart);
+	if (signbit(value))
+		*--p = '-';
+
+	g_string_append_len(out, p, buf + sizeof(buf) - p);
+}
+
 enum {
 	DIGITS_ALL,
 	DIGITS_SPEC,
@@ -68,6 +127,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->num_enabled_channels++;
 	}
 	ctx->fdata = NULL;
+	ctx->labels = g_ptr_array_new_with_free_func(g_free);
 
 	return SR_OK;
 }
@@ -85,7 +145,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	float *fdata;
 	unsigned int i;
 	int num_channels, c, ret, digits, actual_digits;
-	char *number, *suffix;
+	gboolean si_friendly;
+	float value;
+	const char *prefix;
+	char *suffix;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -134,31 +197,35 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		ctx->fdata = fdata;
 		if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 			return ret;
-		*out = g_string_sized_new(512);
 		if (ctx->digits == DIGITS_ALL)
 			digits = analog->encoding->digits;
 		else
 			digits = analog->spec->spec_digits;
 		if (!analog->encoding->is_digits_decimal)
 			digits = copysign(ceil(abs(digits) * BIN_TO_DEC_DIGITS), digits);
-		gboolean si_friendly = sr_analog_si_prefix_friendly(analog->meaning->unit);
+		si_friendly = sr_analog_si_prefix_friendly(analog->meaning->unit);
 		sr_analog_unit_to_string(analog, &suffix);
+		/* Everything but the values is the same for all samples. */
+		g_ptr_array_set_size(ctx->labels, 0);
+		for (l = analog->meaning->channels; l; l = l->next) {
+			ch = l->data;
+			g_ptr_array_add(ctx->labels, g_strconcat(ch->name, ": ", NULL));
+		}
+		*out = g_string_sized_new(MAX(512,
+			analog->num_samples * num_channels * 32));
 		for (i = 0; i < analog->num_samples; i++) {
-			for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
-				float value = fdata[i * num_channels + c];
-				const char *prefix = "";
+			for (c = 0; c < num_channels; c++) {
+				value = fdata[i * num_channels + c];
+				prefix = "";
 				actual_digits = digits;
 				if (si_friendly)
 					prefix = sr_analog_si_prefix(&value, &actual_digits);
-				ch = l->data;
-				g_string_append_printf(*out, "%s: ", ch->name);
-				number = g_strdup_printf("%.*f", MAX(actual_digits, 0), value);
-				g_string_append(*out, number);
-				g_free(number);
-				g_string_append(*out, " ");
+				g_string_append(*out, g_ptr_array_index(ctx->labels, c));
+				append_fixed(*out, value, MAX(actual_digits, 0));
+				g_string_append_c(*out, ' ');
 				g_string_append(*out, prefix);
 				g_string_append(*out, suffix);
-				g_string_append(*out, "\n");
+				g_string_append_c(*out, '\n');
 			}
 		}
 		g_free(suffix);
@@ -204,6 +271,7 @@ static int cleanup(struct sr_output *o)
 		options[0].values = NULL;
 	}
 	g_free(ctx->fdata);
+	g_ptr_array_free(ctx->labels, TRUE);
 	g_free(ctx);
 	o->priv = NULL;
 
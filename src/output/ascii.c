@@ -51,6 +51,10 @@ struct context {
 	GString **lines;
 	const char *charset;
 	gboolean edges;
+	/* Decimated output of the whole capture, when columns are limited. */
+	struct sr_logic_columns *decimate;
+	uint64_t samplenum;
+	int64_t trigger_sample;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -59,6 +63,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct sr_channel *ch;
 	GSList *l;
 	size_t j, max_namelen, alloc_line_len;
+	uint32_t columns;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -74,6 +79,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->charset = g_strdup(DEFAULT_ASCII_CHARS);
 	}
 	ctx->edges = (strlen(ctx->charset) >= 4) ? TRUE : FALSE;
+	ctx->trigger_sample = -1;
 
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -118,6 +124,10 @@ static int init(struct sr_output *o, GHashTable *options)
 		j++;
 	}
 
+	columns = g_variant_get_uint32(g_hash_table_lookup(options, "columns"));
+	if (columns)
+		ctx->decimate = sr_logic_columns_new(ctx->num_enabled_channels, columns);
+
 	return SR_OK;
 }
 
@@ -172,6 +182,35 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
+/*
+ * Render the decimated capture. Columns with toggles show the edge of
+ * their last transition if the charset has edges, else the final value.
+ */
+static void render_decimated(struct context *ctx, GString *out)
+{
+	struct sr_logic_columns *lc;
+	const uint8_t *col;
+	size_t count, i, j, charidx;
+
+	lc = ctx->decimate;
+	count = sr_logic_columns_count(lc);
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		col = lc->columns + j * lc->max_columns;
+		for (i = 0; i < count; i++) {
+			charidx = (col[i] & SR_LOGIC_COLUMN_LAST) ? 1 : 0;
+			if (ctx->edges && (col[i] & SR_LOGIC_COLUMN_TOGGLED))
+				charidx += 2;
+			g_string_append_c(out, ctx->charset[charidx]);
+		}
+		g_string_append_c(out, '\n');
+	}
+	if (ctx->trigger_sample >= 0) {
+		ctx->trigger = ctx->trigger_sample / lc->span;
+		maybe_add_trigger(ctx, out);
+	}
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -206,6 +245,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_TRIGGER:
 		ctx->trigger = ctx->spl_cnt;
+		ctx->trigger_sample = ctx->samplenum;
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
@@ -218,6 +258,12 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		logic = packet->payload;
 		num_samples = logic->length / logic->unitsize;
 		curr_sample = logic->data;
+		ctx->samplenum += num_samples;
+		if (ctx->decimate) {
+			sr_logic_columns_add(ctx->decimate, ctx->channel_index,
+				curr_sample, logic->unitsize, num_samples);
+			break;
+		}
 		while (num_samples--) {
 			ctx->spl_cnt++;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
@@ -252,7 +298,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		}
 		break;
 	case SR_DF_END:
-		if (ctx->spl_cnt) {
+		if (ctx->decimate) {
+			*out = g_string_sized_new(512);
+			render_decimated(ctx, *out);
+		} else if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
 			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
@@ -287,6 +336,7 @@ static int cleanup(struct sr_output *o)
 	g_free(ctx->aligned_names);
 	g_free(ctx->lines);
 	g_free((gpointer)ctx->charset);
+	sr_logic_columns_free(ctx->decimate);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -296,6 +346,7 @@ static int cleanup(struct sr_output *o)
 static struct sr_option options[] = {
 	{ "width", "Width", "Number of samples per line", NULL, NULL },
 	{ "charset", "Charset", "Characters for 0/1 bits (and fall/rise edges)", NULL, NULL },
+	{ "columns", "Columns", "Render the whole capture in at most this many columns, 0 for all samples", NULL, NULL },
 	ALL_ZERO
 };
 
@@ -306,6 +357,8 @@ static const struct sr_option *get_options(void)
 		g_variant_ref_sink(options[0].def);
 		options[1].def = g_variant_new_string(DEFAULT_ASCII_CHARS);
 		g_variant_ref_sink(options[1].def);
+		options[2].def = g_variant_new_uint32(0);
+		g_variant_ref_sink(options[2].def);
 	}
 
 	return options;
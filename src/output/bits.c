@@ -38,6 +38,9 @@ struct context {
 	char **channel_names;
 	gboolean header_done;
 	GString **lines;
+	/* Transposed samples of a packet. */
+	uint8_t *rows;
+	size_t rows_size;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -124,9 +127,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	struct context *ctx;
 	GSList *l;
-	int idx, offset;
-	uint64_t i, j;
-	gchar *p, c;
+	int offset, cnt;
+	uint64_t i, j, idx, count, pos, n;
+	size_t row_size, size;
+	const uint8_t *row;
+	gchar c;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -155,37 +160,61 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
+		if (!logic->unitsize)
+			break;
+		count = logic->length / logic->unitsize;
+		row_size = (count + 7) / 8;
+		size = logic->unitsize * 8 * row_size;
+		if (size > ctx->rows_size) {
+			ctx->rows = g_realloc(ctx->rows, size);
+			ctx->rows_size = size;
+		}
+		sr_output_logic_transpose(logic->data, logic->unitsize,
+			count, ctx->rows, row_size);
+
+		/*
+		 * Append runs of samples to each channel's line, up to
+		 * the next line break.
+		 */
+		for (pos = 0; pos < count; pos += n) {
+			n = count - pos;
+			if (ctx->spl > 0)
+				n = MIN(n, (uint64_t)(ctx->spl - ctx->spl_cnt));
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
 				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = (*p & (1 << (idx % 8))) ? '1' : '0';
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per bit,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				} else if ((ctx->spl_cnt & 7) == 0) {
+				row = NULL;
+				if (idx < logic->unitsize * 8)
+					row = ctx->rows + idx * row_size;
+				cnt = ctx->spl_cnt;
+				for (i = pos; i < pos + n; i++) {
+					c = row && (row[i / 8] >> (i % 8)) & 1 ? '1' : '0';
+					g_string_append_c(ctx->lines[j], c);
 					/* Add a space every 8th bit. */
-					g_string_append_c(ctx->lines[j], ' ');
+					if (++cnt != ctx->spl && (cnt & 7) == 0)
+						g_string_append_c(ctx->lines[j], ' ');
 				}
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
-				ctx->spl_cnt = 0;
+			ctx->spl_cnt += n;
+			if (ctx->spl_cnt != ctx->spl)
+				continue;
+
+			/* Flush line buffers. */
+			for (j = 0; j < ctx->num_enabled_channels; j++) {
+				g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
+				g_string_append_c(*out, '\n');
+				g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+			}
+			if (ctx->trigger > -1) {
+				/*
+				 * Sample data lines have one character per bit,
+				 * plus one separator per byte. Align trigger marker
+				 * to this layout.
+				 */
+				offset = ctx->trigger + ctx->trigger / 8;
+				g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+				ctx->trigger = -1;
+			}
+			ctx->spl_cnt = 0;
 		}
 		break;
 	case SR_DF_END:
@@ -219,6 +248,7 @@ static int cleanup(struct sr_output *o)
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
+	g_free(ctx->rows);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -0,0 +1,498 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Columnar output for data analysis tools. Every enabled channel is a
+ * column. The samples are written in chunks, each column of a chunk
+ * comes with statistics, so tools can skip chunks without looking at
+ * their data. All values are little endian, all data is 8 byte aligned.
+ *
+ * The stream header:
+ *   magic "SRCOL01\n", u32 version, u32 column count, u64 samplerate,
+ *   then for each column: u32 type, u32 name length, the name padded
+ *   with zeros to a multiple of 8 bytes.
+ *
+ * Each chunk:
+ *   magic "SRCC", u32 column count, u64 number of the chunk's first
+ *   sample, u64 payload size, then for each column: u64 value count,
+ *   u64 data offset within the payload, three u64 statistics. Then the
+ *   payload, with the columns' data.
+ *
+ * Logic columns (type 1) are bitmaps, the first sample in the least
+ * significant bit. Their statistics are the number of high samples,
+ * the number of transitions (including the one from the previous
+ * chunk's last sample), and the chunk's last value.
+ *
+ * Analog columns (type 2) are 32bit floats. Their statistics are the
+ * minimum, maximum and sum of the values (excluding NaN) as 64bit
+ * doubles.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/columns"
+
+#define COLUMNS_MAGIC "SRCOL01\n"
+#define COLUMNS_VERSION 1
+#define CHUNK_MAGIC "SRCC"
+#define COLUMN_LOGIC 1
+#define COLUMN_ANALOG 2
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+
+struct column {
+	struct sr_channel *ch;
+	int type;
+	/* Logic: previous chunk's last value, or -1 at the start. */
+	int last_value;
+	/* Analog: the channel's values not written yet. */
+	GArray *values;
+};
+
+struct out_context {
+	gboolean header_done;
+	uint64_t samplerate;
+	uint64_t chunk_size;
+	uint64_t chunk_start;
+	size_t num_columns;
+	struct column *columns;
+	size_t num_logic;
+	size_t unitsize;
+	/* Logic samples not written yet. */
+	GByteArray *logic;
+	uint8_t *rows;
+	size_t rows_size;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	struct sr_channel *ch;
+	struct column *col;
+	GSList *l;
+	size_t logic_channels;
+
+	outc = g_malloc0(sizeof(*outc));
+	o->priv = outc;
+
+	/* Whole bytes of logic bitmaps in all but the last chunk. */
+	outc->chunk_size = g_variant_get_uint64(g_hash_table_lookup(options, "chunksize"));
+	outc->chunk_size = (outc->chunk_size + 7) & ~(uint64_t)7;
+	if (!outc->chunk_size)
+		outc->chunk_size = DEFAULT_CHUNK_SIZE;
+
+	logic_channels = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			logic_channels++;
+		if (ch->enabled)
+			outc->num_columns++;
+	}
+	outc->unitsize = (logic_channels + 7) / 8;
+
+	/* Logic columns first, then analog columns. */
+	outc->columns = g_malloc0(sizeof(*outc->columns) * (outc->num_columns + 1));
+	col = outc->columns;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		col->ch = ch;
+		col->type = COLUMN_LOGIC;
+		col->last_value = -1;
+		col++;
+		outc->num_logic++;
+	}
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG || !ch->enabled)
+			continue;
+		col->ch = ch;
+		col->type = COLUMN_ANALOG;
+		col->values = g_array_new(FALSE, FALSE, sizeof(float));
+		col++;
+	}
+	outc->num_columns = col - outc->columns;
+	outc->logic = g_byte_array_new();
+
+	return SR_OK;
+}
+
+static void append_le32(GString *out, uint32_t value)
+{
+	uint8_t tmp[sizeof(uint32_t)];
+
+	WL32(tmp, value);
+	g_string_append_len(out, (const char *)tmp, sizeof(tmp));
+}
+
+static void append_le64(GString *out, uint64_t value)
+{
+	uint8_t tmp[sizeof(uint64_t)];
+
+	WL64(tmp, value);
+	g_string_append_len(out, (const char *)tmp, sizeof(tmp));
+}
+
+static void append_padding(GString *out, size_t start)
+{
+	while ((out->len - start) % 8)
+		g_string_append_c(out, '\0');
+}
+
+static uint64_t double_bits(double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+static void gen_header(const struct sr_output *o, GString *out)
+{
+	struct out_context *outc;
+	const struct column *col;
+	GVariant *gvar;
+	size_t start, len, i;
+
+	outc = o->priv;
+	if (outc->samplerate == 0 && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		outc->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	start = out->len;
+	g_string_append_len(out, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC) - 1);
+	append_le32(out, COLUMNS_VERSION);
+	append_le32(out, outc->num_columns);
+	append_le64(out, outc->samplerate);
+	for (i = 0; i < outc->num_columns; i++) {
+		col = &outc->columns[i];
+		len = strlen(col->ch->name);
+		append_le32(out, col->type);
+		append_le32(out, len);
+		g_string_append_len(out, col->ch->name, len);
+		append_padding(out, start);
+	}
+}
+
+static size_t count_bits(uint8_t v)
+{
+	size_t n;
+
+	for (n = 0; v; v &= v - 1)
+		n++;
+
+	return n;
+}
+
+/* Number of high samples and transitions in a logic column's bitmap. */
+static void logic_stats(struct column *col, const uint8_t *row,
+		size_t count, uint64_t *stats)
+{
+	uint64_t ones, edges;
+	uint8_t v, prev, mask;
+	size_t i, bytes;
+
+	if (!count)
+		return;
+
+	ones = edges = 0;
+	bytes = (count + 7) / 8;
+	prev = col->last_value < 0 ? row[0] & 1 : col->last_value;
+	for (i = 0; i < bytes; i++) {
+		v = row[i];
+		mask = 0xff;
+		if (i == bytes - 1 && count % 8)
+			mask = (1 << (count % 8)) - 1;
+		ones += count_bits(v & mask);
+		edges += count_bits((v ^ (uint8_t)((v << 1) | prev)) & mask);
+		prev = v >> 7;
+	}
+	col->last_value = (row[(count - 1) / 8] >> ((count - 1) % 8)) & 1;
+
+	stats[0] = ones;
+	stats[1] = edges;
+	stats[2] = col->last_value;
+}
+
+static void analog_stats(const float *values, size_t count, uint64_t *stats)
+{
+	double min, max, sum;
+	size_t i;
+
+	min = INFINITY;
+	max = -INFINITY;
+	sum = 0;
+	for (i = 0; i < count; i++) {
+		if (isnan(values[i]))
+			continue;
+		min = MIN(min, values[i]);
+		max = MAX(max, values[i]);
+		sum += values[i];
+	}
+
+	stats[0] = double_bits(min);
+	stats[1] = double_bits(max);
+	stats[2] = double_bits(sum);
+}
+
+/* Write up to one chunk's worth of every column's pending values. */
+static void write_chunk(const struct sr_output *o, GString *out)
+{
+	struct out_context *outc;
+	struct column *col;
+	uint64_t stats[3];
+	size_t logic_count, count, row_size, hdr, payload, offset, size, i;
+
+	outc = o->priv;
+
+	logic_count = 0;
+	if (outc->num_logic)
+		logic_count = MIN(outc->logic->len / outc->unitsize, outc->chunk_size);
+	row_size = (logic_count + 7) / 8;
+	if (logic_count) {
+		size = outc->unitsize * 8 * row_size;
+		if (size > outc->rows_size) {
+			outc->rows = g_realloc(outc->rows, size);
+			outc->rows_size = size;
+		}
+		sr_output_logic_transpose(outc->logic->data, outc->unitsize,
+			logic_count, outc->rows, row_size);
+	}
+
+	hdr = out->len;
+	g_string_append_len(out, CHUNK_MAGIC, sizeof(CHUNK_MAGIC) - 1);
+	append_le32(out, outc->num_columns);
+	append_le64(out, outc->chunk_start);
+	/* Payload size gets filled in below. */
+	append_le64(out, 0);
+
+	offset = 0;
+	for (i = 0; i < outc->num_columns; i++) {
+		col = &outc->columns[i];
+		memset(stats, 0, sizeof(stats));
+		if (col->type == COLUMN_LOGIC) {
+			count = logic_count;
+			size = row_size;
+			logic_stats(col, outc->rows + col->ch->index * row_size,
+				count, stats);
+		} else {
+			count = MIN(col->values->len, outc->chunk_size);
+			size = count * sizeof(float);
+			analog_stats((const float *)col->values->data, count, stats);
+		}
+		append_le64(out, count);
+		append_le64(out, offset);
+		append_le64(out, stats[0]);
+		append_le64(out, stats[1]);
+		append_le64(out, stats[2]);
+		offset += (size + 7) & ~(size_t)7;
+	}
+
+	payload = out->len;
+	for (i = 0; i < outc->num_columns; i++) {
+		col = &outc->columns[i];
+		if (col->type == COLUMN_LOGIC) {
+			g_string_append_len(out, (const char *)outc->rows
+				+ col->ch->index * row_size, row_size);
+		} else {
+			count = MIN(col->values->len, outc->chunk_size);
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+			g_string_append_len(out, col->values->data,
+				count * sizeof(float));
+#else
+			for (size = 0; size < count; size++) {
+				uint32_t bits;
+				memcpy(&bits, &g_array_index(col->values, float, size),
+					sizeof(bits));
+				append_le32(out, bits);
+			}
+#endif
+			g_array_remove_range(col->values, 0, count);
+		}
+		append_padding(out, payload);
+	}
+	WL64((uint8_t *)out->str + hdr + 16, out->len - payload);
+
+	if (logic_count)
+		g_byte_array_remove_range(outc->logic, 0,
+			logic_count * outc->unitsize);
+	outc->chunk_start += outc->chunk_size;
+}
+
+/* Number of samples ready in all columns, or the most in any column. */
+static uint64_t pending_samples(const struct out_context *outc, gboolean any)
+{
+	const struct column *col;
+	uint64_t count, n;
+	size_t i;
+
+	count = any ? 0 : UINT64_MAX;
+	for (i = 0; i < outc->num_columns; i++) {
+		col = &outc->columns[i];
+		if (col->type == COLUMN_LOGIC)
+			n = outc->logic->len / outc->unitsize;
+		else
+			n = col->values->len;
+		count = any ? MAX(count, n) : MIN(count, n);
+	}
+
+	return outc->num_columns ? count : 0;
+}
+
+static int receive(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	struct sr_channel *ch;
+	struct column *col;
+	GSList *l;
+	float *values;
+	size_t count, len, num_channels, i, j;
+	int ret;
+
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			outc->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!outc->num_logic || !logic->unitsize)
+			break;
+		if (!outc->header_done) {
+			gen_header(o, out);
+			outc->header_done = TRUE;
+		}
+		count = logic->length / logic->unitsize;
+		len = outc->logic->len;
+		g_byte_array_set_size(outc->logic, len + count * outc->unitsize);
+		sr_logic_unitsize_convert(logic->data, logic->unitsize,
+			outc->logic->data + len, outc->unitsize, count);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		if (!outc->header_done) {
+			gen_header(o, out);
+			outc->header_done = TRUE;
+		}
+		count = analog->num_samples;
+		num_channels = g_slist_length(analog->meaning->channels);
+		values = g_try_malloc(sizeof(float) * count * num_channels);
+		if (!values)
+			return SR_ERR_MALLOC;
+		if ((ret = sr_analog_to_float(analog, values)) != SR_OK) {
+			g_free(values);
+			return ret;
+		}
+		for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+			ch = l->data;
+			col = NULL;
+			for (i = outc->num_logic; i < outc->num_columns; i++) {
+				if (outc->columns[i].ch == ch)
+					col = &outc->columns[i];
+			}
+			if (!col)
+				continue;
+			if (num_channels == 1) {
+				g_array_append_vals(col->values, values, count);
+				continue;
+			}
+			for (i = 0; i < count; i++)
+				g_array_append_val(col->values,
+					values[i * num_channels + j]);
+		}
+		g_free(values);
+		break;
+	case SR_DF_END:
+		while (pending_samples(outc, TRUE) > 0)
+			write_chunk(o, out);
+		return SR_OK;
+	default:
+		return SR_OK;
+	}
+
+	while (pending_samples(outc, FALSE) >= outc->chunk_size)
+		write_chunk(o, out);
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "chunksize", "Chunk size", "Number of samples per chunk", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_CHUNK_SIZE));
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+	size_t i;
+
+	if (!o || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	for (i = 0; i < outc->num_columns; i++) {
+		if (outc->columns[i].values)
+			g_array_free(outc->columns[i].values, TRUE);
+	}
+	g_free(outc->columns);
+	g_byte_array_free(outc->logic, TRUE);
+	g_free(outc->rows);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_columns = {
+	.id = "columns",
+	.name = "Columns",
+	.desc = "Binary column chunks with statistics, for data analysis",
+	.exts = (const char*[]){"srcol", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive_append = receive,
+	.cleanup = cleanup,
+};
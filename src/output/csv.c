@@ -67,6 +67,10 @@ struct ctx_channel {
 	struct sr_channel *ch;
 	char *label;
 	float min, max;
+	/* Text of the last value, analog values tend to repeat. */
+	float last_value;
+	size_t last_len;
+	char last_text[32];
 };
 
 struct context {
@@ -99,6 +103,7 @@ struct context {
 	uint8_t *previous_sample;
 	float *analog_samples;
 	uint8_t *logic_samples;
+	struct sr_logic_layout *layout;
 	const char *xlabel;	/* Don't free: will point to a static string. */
 	const char *title;	/* Don't free: will point into the driver struct. */
 
@@ -184,7 +189,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		sr_info("Outputting %d logic values", logic_channels);
 		ctx->num_logic_channels = logic_channels;
 	}
-	ctx->channels = g_malloc(sizeof(struct ctx_channel)
+	ctx->channels = g_malloc0(sizeof(struct ctx_channel)
 		* (ctx->num_analog_channels + ctx->num_logic_channels));
 
 	/* Once more to map the enabled channels. */
@@ -215,19 +220,17 @@ static const char *xlabels[] = {
 	"femtoseconds", "attoseconds",
 };
 
-static GString *gen_header(const struct sr_output *o,
-			   const struct sr_datafeed_header *hdr)
+static void gen_header(const struct sr_output *o,
+			   const struct sr_datafeed_header *hdr, GString *header)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
 	GSList *channels, *l;
 	unsigned int num_channels, i;
 	char *samplerate_s;
 
 	ctx = o->priv;
-	header = g_string_sized_new(512);
 
 	if (ctx->sample_rate == 0) {
 		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
@@ -288,8 +291,6 @@ static GString *gen_header(const struct sr_output *o,
 	/* Time column requested but samplerate unknown. Emit a warning. */
 	if (ctx->time && !ctx->sample_rate)
 		sr_warn("Samplerate unknown, cannot provide timestamps.");
-
-	return header;
 }
 
 /*
@@ -374,13 +375,15 @@ static void process_analog(struct context *ctx,
  * We treat logic packets the same as analog packets, though it's not
  * strictly required. This allows us to process mixed signals properly.
  */
-static void process_logic(struct context *ctx,
+static void process_logic(const struct sr_output *o,
 			  const struct sr_datafeed_logic *logic)
 {
-	unsigned int i, j, ch, num_samples;
-	int idx;
-	uint8_t *sample;
+	struct context *ctx;
+	const struct sr_logic_layout_channel *lc;
+	unsigned int i, j, ch, num_samples, num_logic;
+	uint8_t *sample, *row;
 
+	ctx = o->priv;
 	num_samples = logic->length / logic->unitsize;
 	ctx->channels_seen += ctx->logic_channel_count;
 	sr_dbg("Logic packet had %d channels", logic->unitsize * 8);
@@ -393,27 +396,68 @@ static void process_logic(struct context *ctx,
 		sr_warn("Expecting %u samples, got %u",
 			ctx->num_samples, num_samples);
 
-	for (j = ch = 0; ch < ctx->num_logic_channels; j++) {
-		if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-			for (i = 0; i < num_samples; i++) {
-				sample = logic->data + i * logic->unitsize;
-				idx = ctx->channels[j].ch->index;
-				if (ctx->label_do && !ctx->label_names)
-					ctx->channels[j].label = "logic";
-				ctx->logic_samples[i * ctx->num_logic_channels + ch] = sample[idx / 8] & (1 << (idx % 8));
-			}
-			ch++;
+	/* Byte offsets and masks of the logic channels, in output order. */
+	if (!ctx->layout)
+		ctx->layout = sr_logic_layout_get(o->sdi);
+	num_logic = MIN(ctx->layout->count, ctx->num_logic_channels);
+	if (ctx->label_do && !ctx->label_names) {
+		for (j = 0; j < ctx->num_logic_channels +
+				ctx->num_analog_channels; j++) {
+			if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC)
+				ctx->channels[j].label = "logic";
 		}
 	}
+
+	/* Walk samples and output rows in memory order. */
+	sample = logic->data;
+	row = ctx->logic_samples;
+	for (i = 0; i < num_samples; i++) {
+		lc = ctx->layout->channels;
+		for (ch = 0; ch < num_logic; ch++, lc++)
+			row[ch] = sample[lc->offset] & lc->mask;
+		sample += logic->unitsize;
+		row += ctx->num_logic_channels;
+	}
+}
+
+/*
+ * Append an analog value in "%g" format. Integral values within %g's
+ * fixed notation range print as plain integers, and a channel's last
+ * text gets reused when the value repeats. Only the remaining values
+ * go through printf().
+ */
+static void append_value(GString *out, struct ctx_channel *channel,
+	float value)
+{
+	if (channel->last_len && !memcmp(&value, &channel->last_value,
+			sizeof(value))) {
+		g_string_append_len(out, channel->last_text, channel->last_len);
+		return;
+	}
+
+	if (value == (int32_t)value && fabsf(value) < 1e6f &&
+			!(value == 0 && signbit(value))) {
+		if (value < 0)
+			g_string_append_c(out, '-');
+		sr_string_append_u64(out, (uint64_t)fabsf(value));
+		return;
+	}
+
+	channel->last_len = g_snprintf(channel->last_text,
+		sizeof(channel->last_text), "%g", value);
+	channel->last_value = value;
+	g_string_append_len(out, channel->last_text, channel->last_len);
 }
 
-static void dump_saved_values(struct context *ctx, GString **out)
+static void dump_saved_values(struct context *ctx, GString *out)
 {
-	unsigned int i, j, analog_size, num_channels;
+	unsigned int i, j, a, l, analog_size, num_channels;
 	double sample_time_dbl;
 	uint64_t sample_time_u64;
 	float *analog_sample, value;
 	uint8_t *logic_sample;
+	gboolean first;
+	size_t len;
 
 	/* If we haven't seen samples we're expecting, skip them. */
 	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
@@ -422,29 +466,27 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
 
-		if (!*out)
-			*out = g_string_sized_new(512);
 		num_channels =
 		    ctx->num_logic_channels + ctx->num_analog_channels;
 
 		if (ctx->label_do) {
 			if (ctx->time)
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->label_names ? "Time" : ctx->xlabel,
 					ctx->value);
 			for (i = 0; i < num_channels; i++) {
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->channels[i].label, ctx->value);
 				if (ctx->channels[i].ch->type == SR_CHANNEL_ANALOG
 						&& ctx->label_names)
 					g_free(ctx->channels[i].label);
 			}
 			if (ctx->do_trigger)
-				g_string_append_printf(*out, "Trigger%s",
+				g_string_append_printf(out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 
 			ctx->label_do = FALSE;
 		}
@@ -453,6 +495,12 @@ static void dump_saved_values(struct context *ctx, GString **out)
 		if (ctx->dedup && !ctx->previous_sample)
 			ctx->previous_sample = g_malloc0(analog_size + ctx->num_logic_channels);
 
+		/* Reserve space for the batch of rows up front. */
+		len = out->len;
+		g_string_set_size(out, len + ctx->num_samples
+			* (num_channels + 1) * (strlen(ctx->value) + 8));
+		g_string_truncate(out, len);
+
 		for (i = 0; i < ctx->num_samples; i++) {
 			analog_sample =
 			    &ctx->analog_samples[i * ctx->num_analog_channels];
@@ -475,42 +523,48 @@ static void dump_saved_values(struct context *ctx, GString **out)
 				       analog_sample, analog_size);
 			}
 
+			/* Cells get separated, there is no trailing separator. */
+			first = TRUE;
 			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
+				g_string_append_c(out, '0');
+				first = FALSE;
 			} else if (ctx->time) {
 				sample_time_dbl = ctx->out_sample_count++;
 				sample_time_dbl /= ctx->sample_rate;
 				sample_time_dbl *= ctx->sample_scale;
 				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
+				sr_string_append_u64(out, sample_time_u64);
+				first = FALSE;
 			}
 
+			a = l = 0;
 			for (j = 0; j < num_channels; j++) {
+				if (!first)
+					g_string_append(out, ctx->value);
+				first = FALSE;
 				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
+					value = analog_sample[a++];
 					ctx->channels[j].max =
 					    fmax(value, ctx->channels[j].max);
 					ctx->channels[j].min =
 					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
+					append_value(out, &ctx->channels[j], value);
 				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
+					g_string_append_c(out,
+						logic_sample[l++] ? '1' : '0');
 				} else {
 					sr_warn("Unexpected channel type: %d",
-						ctx->channels[i].ch->type);
+						ctx->channels[j].ch->type);
 				}
 			}
 
 			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
+				if (!first)
+					g_string_append(out, ctx->value);
+				g_string_append_c(out, ctx->trigger ? '1' : '0');
 				ctx->trigger = FALSE;
 			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_append(out, ctx->record);
 		}
 	}
 
@@ -657,13 +711,12 @@ static void check_input_constraints(struct context *ctx)
 }
 
 static int receive(const struct sr_output *o,
-		   const struct sr_datafeed_packet *packet, GString **out)
+		   const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -675,21 +728,19 @@ static int receive(const struct sr_output *o,
 		ctx->have_checked = FALSE;
 		ctx->have_frames = FALSE;
 		ctx->pkt_snums = FALSE;
-		*out = gen_header(o, packet->payload);
+		gen_header(o, packet->payload, out);
 		break;
 	case SR_DF_TRIGGER:
 		ctx->trigger = TRUE;
 		break;
 	case SR_DF_LOGIC:
-		*out = g_string_sized_new(512);
 		logic = packet->payload;
 		ctx->pkt_snums = logic->length;
 		ctx->pkt_snums /= logic->length;
 		check_input_constraints(ctx);
-		process_logic(ctx, logic);
+		process_logic(o, logic);
 		break;
 	case SR_DF_ANALOG:
-		*out = g_string_sized_new(512);
 		analog = packet->payload;
 		ctx->pkt_snums = analog->num_samples;
 		ctx->pkt_snums /= g_slist_length(analog->meaning->channels);
@@ -698,7 +749,7 @@ static int receive(const struct sr_output *o,
 		break;
 	case SR_DF_FRAME_BEGIN:
 		ctx->have_frames = TRUE;
-		*out = g_string_new(ctx->frame);
+		g_string_append(out, ctx->frame);
 		/* Fallthrough */
 	case SR_DF_END:
 		/* Got to end of frame/session with part of the data. */
@@ -731,6 +782,7 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
 		g_free(ctx->previous_sample);
+		sr_logic_layout_unref(ctx->layout);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -787,6 +839,6 @@ SR_PRIV struct sr_output_module output_csv = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive,
 	.cleanup = cleanup,
 };
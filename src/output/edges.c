@@ -0,0 +1,308 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compact binary list of logic transitions. Numbers are unsigned
+ * LEB128 varints: 7 bits per byte, least significant group first, the
+ * top bit set on all but the last byte.
+ *
+ * The stream header:
+ *   magic "SREDGE1\n", mode byte ('c' combined, 'p' per channel),
+ *   varint unit size, varint samplerate, varint channel count, then
+ *   for each enabled logic channel: varint bit index, varint name
+ *   length, the name.
+ *
+ * Combined mode, one record for each sample which differs from its
+ * predecessor in any enabled channel: varint sample number delta to
+ * the previous record, then the new sample's unit size bytes (disabled
+ * channels' bits are zero).
+ *
+ * Per channel mode, one record for each channel's transition: varint
+ * (channel number << 1 | new value), then varint sample number delta
+ * to the previous record. The channel number counts the header's
+ * channels, starting at 0.
+ *
+ * The first record is for sample 0 (delta 0) and has the initial values
+ * of all channels.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/edges"
+
+#define EDGES_MAGIC "SREDGE1\n"
+
+struct context {
+	gboolean header_done;
+	gboolean per_channel;
+	uint64_t samplerate;
+	size_t unitsize;
+	size_t num_channels;
+	/* Bit index of the enabled channels, and the mask they form. */
+	size_t *bits;
+	uint8_t *mask;
+	/* Last raw sample, last and next masked sample. */
+	uint8_t *raw;
+	uint8_t *value;
+	uint8_t *next;
+	gboolean have_last;
+	uint64_t samplenum;
+	uint64_t last_edge;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	GSList *l;
+	const char *mode;
+	size_t logic_channels;
+
+	mode = g_variant_get_string(g_hash_table_lookup(options, "mode"), NULL);
+	if (strcmp(mode, "combined") && strcmp(mode, "channel")) {
+		sr_err("Unknown mode '%s', use combined or channel.", mode);
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->per_channel = !strcmp(mode, "channel");
+
+	logic_channels = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		logic_channels++;
+		if (ch->enabled)
+			ctx->num_channels++;
+	}
+	ctx->unitsize = (logic_channels + 7) / 8;
+	ctx->bits = g_malloc0(sizeof(*ctx->bits) * (ctx->num_channels + 1));
+	ctx->mask = g_malloc0(ctx->unitsize + 1);
+	ctx->raw = g_malloc0(ctx->unitsize + 1);
+	ctx->value = g_malloc0(ctx->unitsize + 1);
+	ctx->next = g_malloc0(ctx->unitsize + 1);
+
+	ctx->num_channels = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		ctx->bits[ctx->num_channels++] = ch->index;
+		ctx->mask[ch->index / 8] |= 1 << (ch->index % 8);
+	}
+
+	return SR_OK;
+}
+
+static void append_varint(GString *out, uint64_t value)
+{
+	while (value >= 0x80) {
+		g_string_append_c(out, (char)(value | 0x80));
+		value >>= 7;
+	}
+	g_string_append_c(out, (char)value);
+}
+
+static void gen_header(const struct sr_output *o, GString *out)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	GVariant *gvar;
+	GSList *l;
+	size_t len;
+
+	ctx = o->priv;
+	if (ctx->samplerate == 0 && sr_config_get(o->sdi->driver, o->sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	g_string_append_len(out, EDGES_MAGIC, sizeof(EDGES_MAGIC) - 1);
+	g_string_append_c(out, ctx->per_channel ? 'p' : 'c');
+	append_varint(out, ctx->unitsize);
+	append_varint(out, ctx->samplerate);
+	append_varint(out, ctx->num_channels);
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		len = strlen(ch->name);
+		append_varint(out, ch->index);
+		append_varint(out, len);
+		g_string_append_len(out, ch->name, len);
+	}
+}
+
+/* Emit the change from the last masked sample to the next one. */
+static void append_edge(struct context *ctx, GString *out)
+{
+	uint64_t delta;
+	size_t i, bit;
+	int value;
+
+	delta = ctx->samplenum - ctx->last_edge;
+	ctx->last_edge = ctx->samplenum;
+
+	if (!ctx->per_channel) {
+		append_varint(out, delta);
+		g_string_append_len(out, (const char *)ctx->next, ctx->unitsize);
+	} else {
+		for (i = 0; i < ctx->num_channels; i++) {
+			bit = ctx->bits[i];
+			value = (ctx->next[bit / 8] >> (bit % 8)) & 1;
+			if (ctx->have_last && value == ((ctx->value[bit / 8] >> (bit % 8)) & 1))
+				continue;
+			append_varint(out, (uint64_t)i << 1 | value);
+			append_varint(out, delta);
+			/* Further channels of this sample are no distance away. */
+			delta = 0;
+		}
+	}
+	memcpy(ctx->value, ctx->next, ctx->unitsize);
+}
+
+static void process_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic, GString *out)
+{
+	const uint8_t *data;
+	size_t count, unitsize, index, i;
+	gboolean same_unitsize;
+
+	same_unitsize = logic->unitsize == ctx->unitsize;
+	unitsize = MIN(logic->unitsize, ctx->unitsize);
+	data = logic->data;
+	count = logic->length / logic->unitsize;
+	while (count) {
+		/* Skip over runs of identical samples, like output/vcd. */
+		if (ctx->have_last && same_unitsize) {
+			index = sr_output_logic_find_change(data, count,
+				ctx->unitsize, ctx->raw);
+			data += index * ctx->unitsize;
+			count -= index;
+			ctx->samplenum += index;
+			if (!count)
+				break;
+		}
+
+		/* Only changes in the enabled channels are of interest. */
+		memset(ctx->next, 0, ctx->unitsize);
+		for (i = 0; i < unitsize; i++)
+			ctx->next[i] = data[i] & ctx->mask[i];
+		if (!ctx->have_last || memcmp(ctx->next, ctx->value, ctx->unitsize))
+			append_edge(ctx, out);
+		if (same_unitsize)
+			memcpy(ctx->raw, data, ctx->unitsize);
+		ctx->have_last = TRUE;
+
+		data += logic->unitsize;
+		count--;
+		ctx->samplenum++;
+	}
+}
+
+static int receive(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_config *src;
+	GSList *l;
+
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!ctx->num_channels || !logic->unitsize)
+			break;
+		if (!ctx->header_done) {
+			gen_header(o, out);
+			ctx->header_done = TRUE;
+		}
+		process_logic(ctx, logic, out);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "mode", "Mode", "Records for all channels combined, or per channel (combined, channel)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("combined"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("combined")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("channel")));
+		options[0].values = l;
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	g_free(ctx->bits);
+	g_free(ctx->mask);
+	g_free(ctx->raw);
+	g_free(ctx->value);
+	g_free(ctx->next);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_edges = {
+	.id = "edges",
+	.name = "Edges",
+	.desc = "Binary list of logic transitions, varint encoded",
+	.exts = (const char*[]){"sredge", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive_append = receive,
+	.cleanup = cleanup,
+};
@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -63,9 +64,13 @@ extern SR_PRIV struct sr_output_module output_chronovu_la8;
 extern SR_PRIV struct sr_output_module output_csv;
 extern SR_PRIV struct sr_output_module output_analog;
 extern SR_PRIV struct sr_output_module output_srzip;
+extern SR_PRIV struct sr_output_module output_srraw;
 extern SR_PRIV struct sr_output_module output_wav;
 extern SR_PRIV struct sr_output_module output_wavedrom;
+extern SR_PRIV struct sr_output_module output_columns;
+extern SR_PRIV struct sr_output_module output_edges;
 extern SR_PRIV struct sr_output_module output_null;
+extern SR_PRIV struct sr_output_module output_remote;
 /** @endcond */
 
 static const struct sr_output_module *output_module_list[] = {
@@ -79,9 +84,13 @@ static const struct sr_output_module *output_module_list[] = {
 	&output_chronovu_la8,
 	&output_analog,
 	&output_srzip,
+	&output_srraw,
 	&output_wav,
 	&output_wavedrom,
+	&output_columns,
+	&output_edges,
 	&output_null,
+	&output_remote,
 	NULL,
 };
 
@@ -275,6 +284,7 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	op->module = omod;
 	op->sdi = sdi;
 	op->filename = g_strdup(filename);
+	op->sink = NULL;
 
 	new_opts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
 			(GDestroyNotify)g_variant_unref);
@@ -325,6 +335,48 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/* Samples per SR_DF_LOGIC packet, when runs get expanded for a module. */
+#define RUNS_EXPAND_SAMPLES (64 * 1024)
+
+static gboolean output_expands_runs(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet)
+{
+	return packet->type == SR_DF_LOGIC_RUNS
+		&& !(o->module->flags & SR_OUTPUT_LOGIC_RUNS);
+}
+
+/* Send the samples of runs to a module which doesn't handle them. */
+static int output_send_runs_expanded(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *buf)
+{
+	const struct sr_datafeed_logic_runs *runs;
+	struct sr_datafeed_packet logic_packet;
+	struct sr_datafeed_logic logic;
+	uint64_t run, offset, count;
+	uint8_t *samples;
+	int ret;
+
+	runs = packet->payload;
+	if (!runs->unitsize)
+		return SR_OK;
+
+	samples = g_malloc(RUNS_EXPAND_SAMPLES * runs->unitsize);
+	logic.unitsize = runs->unitsize;
+	logic.data = samples;
+	logic_packet.type = SR_DF_LOGIC;
+	logic_packet.payload = &logic;
+	ret = SR_OK;
+	run = offset = 0;
+	while (ret == SR_OK && (count = sr_logic_runs_expand(runs,
+			&run, &offset, samples, RUNS_EXPAND_SAMPLES))) {
+		logic.length = count * runs->unitsize;
+		ret = sr_output_send_append(o, &logic_packet, buf);
+	}
+	g_free(samples);
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
@@ -336,7 +388,108 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	GString *buf;
+	int ret;
+
+	if (o->module->receive && !output_expands_runs(o, packet))
+		return o->module->receive(o, packet, out);
+
+	buf = g_string_new(NULL);
+	ret = sr_output_send_append(o, packet, buf);
+	if (ret != SR_OK || !buf->len) {
+		g_string_free(buf, TRUE);
+		buf = NULL;
+	}
+	*out = buf;
+
+	return ret;
+}
+
+/**
+ * Send a packet to the specified output instance, append the output
+ * to a buffer.
+ *
+ * Unlike sr_output_send(), the instance's output is appended to a
+ * buffer which the caller provides. Reusing the buffer across packets
+ * avoids an allocation and a copy per packet for modules which support
+ * appending (like CSV, hex and VCD), other modules' output is copied.
+ *
+ * @param o The output instance.
+ * @param packet The packet to send.
+ * @param buf The buffer to append the output to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *buf)
+{
+	GString *out;
+	int ret;
+
+	if (!o || !packet || !buf)
+		return SR_ERR_ARG;
+
+	if (output_expands_runs(o, packet))
+		return output_send_runs_expanded(o, packet, buf);
+
+	if (o->module->receive_append)
+		return o->module->receive_append(o, packet, buf);
+
+	out = NULL;
+	ret = o->module->receive(o, packet, &out);
+	if (out) {
+		g_string_append_len(buf, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+
+	return ret;
+}
+
+/**
+ * Send a packet to the specified output instance, write the output
+ * to a file.
+ *
+ * The output gets collected in a buffer which the instance keeps
+ * across packets, see sr_output_send_append(), and gets written to
+ * the file in one go.
+ *
+ * @param o The output instance.
+ * @param packet The packet to send.
+ * @param file The file to write the output to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Writing to the file failed.
+ * @retval other Negative error code.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_file(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, FILE *file)
+{
+	struct sr_output *op;
+	int ret;
+
+	if (!o || !packet || !file)
+		return SR_ERR_ARG;
+
+	op = (struct sr_output *)o;
+	if (!op->sink)
+		op->sink = g_string_sized_new(512);
+
+	ret = sr_output_send_append(o, packet, op->sink);
+	if (op->sink->len && fwrite(op->sink->str, 1, op->sink->len,
+			file) != op->sink->len) {
+		sr_err("Failed to write output: %s.", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	g_string_truncate(op->sink, 0);
+
+	return ret;
 }
 
 /**
@@ -354,10 +507,206 @@ SR_API int sr_output_free(const struct sr_output *o)
 	ret = SR_OK;
 	if (o->module->cleanup)
 		ret = o->module->cleanup((struct sr_output *)o);
+	if (o->sink)
+		g_string_free(o->sink, TRUE);
 	g_free((char *)o->filename);
 	g_free((gpointer)o);
 
 	return ret;
 }
 
+/**
+ * Transpose logic samples into per-channel bit streams.
+ *
+ * Row k of the output holds bit k of consecutive samples, the first
+ * sample in the least significant bit of the row's first byte. This
+ * suits output modules which print channels in lines rather than
+ * samples in rows. Blocks of 8 samples by 8 channels are transposed
+ * in a 64bit register, instead of extracting every single bit.
+ *
+ * @param[in] data The logic samples.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples.
+ * @param[out] rows The bit streams, unitsize * 8 rows.
+ * @param[in] row_size The distance of rows in bytes, at least
+ *                     (count + 7) / 8.
+ *
+ * @private
+ */
+SR_PRIV void sr_output_logic_transpose(const uint8_t *data,
+		size_t unitsize, size_t count, uint8_t *rows, size_t row_size)
+{
+	const uint8_t *sample;
+	uint64_t x;
+	size_t blk, n, byte, s, c;
+
+	for (blk = 0; blk * 8 < count; blk++) {
+		n = MIN(count - blk * 8, 8);
+		sample = data + blk * 8 * unitsize;
+		for (byte = 0; byte < unitsize; byte++) {
+			/* Sample s' byte goes to the register's byte s. */
+			x = 0;
+			for (s = 0; s < n; s++)
+				x |= (uint64_t)sample[s * unitsize + byte] << (8 * s);
+			x = sr_bit_transpose_8x8(x);
+			/* Now the register's byte c holds bit c of the samples. */
+			for (c = 0; c < 8; c++)
+				rows[(byte * 8 + c) * row_size + blk] = x >> (8 * c);
+		}
+	}
+}
+
+/**
+ * Find the next logic sample which differs from the last one.
+ *
+ * Compares machine words instead of individual samples while the data
+ * remains unchanged, which is the common case for mostly idle captures.
+ *
+ * @param[in] data The logic samples.
+ * @param[in] count The number of samples.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] last The previous sample, unitsize bytes.
+ *
+ * @return The sample's index, or the count when nothing has changed.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_output_logic_find_change(const uint8_t *data, size_t count,
+		size_t unitsize, const uint8_t *last)
+{
+	uint64_t pattern, word;
+	size_t pos, i;
+
+	pos = 0;
+	if (8 % unitsize == 0) {
+		for (i = 0; i < 8; i += unitsize)
+			memcpy((uint8_t *)&pattern + i, last, unitsize);
+		while (count - pos >= 8 / unitsize) {
+			memcpy(&word, data + pos * unitsize, sizeof(word));
+			if (word != pattern)
+				break;
+			pos += 8 / unitsize;
+		}
+	}
+	while (pos < count && !memcmp(data + pos * unitsize, last, unitsize))
+		pos++;
+
+	return pos;
+}
+
+/**
+ * Create a logic data decimator.
+ *
+ * @param[in] num_channels The number of channels to track.
+ * @param[in] max_columns The maximum number of columns per channel,
+ *                        rounded up to an even number.
+ *
+ * @return The decimator, free it with sr_logic_columns_free().
+ *
+ * @private
+ */
+SR_PRIV struct sr_logic_columns *sr_logic_columns_new(size_t num_channels,
+		size_t max_columns)
+{
+	struct sr_logic_columns *lc;
+
+	lc = g_malloc0(sizeof(*lc));
+	lc->num_channels = num_channels;
+	lc->max_columns = MAX((max_columns + 1) & ~(size_t)1, 2);
+	lc->span = 1;
+	lc->columns = g_malloc0(lc->num_channels * lc->max_columns + 1);
+
+	return lc;
+}
+
+/* Merge neighbouring columns, each one then covers twice the span. */
+static void logic_columns_merge(struct sr_logic_columns *lc)
+{
+	uint8_t *col, a, b, c;
+	size_t ch, i;
+
+	for (ch = 0; ch < lc->num_channels; ch++) {
+		col = lc->columns + ch * lc->max_columns;
+		for (i = 0; i < lc->num_columns / 2; i++) {
+			a = col[2 * i];
+			b = col[2 * i + 1];
+			c = (a & SR_LOGIC_COLUMN_FIRST) | (b & SR_LOGIC_COLUMN_LAST);
+			c |= (a | b) & SR_LOGIC_COLUMN_TOGGLED;
+			if (!(a & SR_LOGIC_COLUMN_LAST) != !(b & SR_LOGIC_COLUMN_FIRST))
+				c |= SR_LOGIC_COLUMN_TOGGLED;
+			col[i] = c;
+		}
+	}
+	lc->num_columns /= 2;
+	lc->span *= 2;
+}
+
+/**
+ * Add logic samples to a decimator.
+ *
+ * @param[in] lc The decimator.
+ * @param[in] channel_index The bit index of each tracked channel.
+ * @param[in] data The logic samples.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_columns_add(struct sr_logic_columns *lc,
+		const int *channel_index, const uint8_t *data,
+		size_t unitsize, size_t count)
+{
+	uint8_t *col, bit;
+	size_t ch, idx;
+
+	while (count--) {
+		for (ch = 0; ch < lc->num_channels; ch++) {
+			idx = channel_index[ch];
+			bit = 0;
+			if (idx / 8 < unitsize)
+				bit = (data[idx / 8] >> (idx % 8)) & 1;
+			col = lc->columns + ch * lc->max_columns + lc->num_columns;
+			if (!lc->filled) {
+				*col = bit ? SR_LOGIC_COLUMN_FIRST | SR_LOGIC_COLUMN_LAST : 0;
+				continue;
+			}
+			if (!(*col & SR_LOGIC_COLUMN_LAST) != !bit)
+				*col |= SR_LOGIC_COLUMN_TOGGLED;
+			if (bit)
+				*col |= SR_LOGIC_COLUMN_LAST;
+			else
+				*col &= ~SR_LOGIC_COLUMN_LAST;
+		}
+		data += unitsize;
+		if (++lc->filled < lc->span)
+			continue;
+		lc->filled = 0;
+		if (++lc->num_columns == lc->max_columns)
+			logic_columns_merge(lc);
+	}
+}
+
+/**
+ * Get the number of columns in use, including a partial last one.
+ *
+ * @private
+ */
+SR_PRIV size_t sr_logic_columns_count(const struct sr_logic_columns *lc)
+{
+	return lc->num_columns + (lc->filled ? 1 : 0);
+}
+
+/**
+ * Free a logic data decimator.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_columns_free(struct sr_logic_columns *lc)
+{
+	if (!lc)
+		return;
+	g_free(lc->columns);
+	g_free(lc);
+}
+
 /** @} */
@@ -0,0 +1,729 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Serves the datafeed to remote clients over TCP, see the SR_NETSTREAM_*
+ * definitions for the framing. The sigrok-remote driver is the client,
+ * which re-emits the packets into its local session.
+ *
+ * Payloads (strings are u16 length and the text):
+ * - SR_NETSTREAM_HELLO: u32 version, u64 samplerate, vendor, model,
+ *   version and serial number strings, u32 number of channels, and
+ *   for each channel: u32 index, u32 type, u8 enabled, name string.
+ * - SR_DF_HEADER: i32 feed version, i64 start time seconds and
+ *   microseconds.
+ * - SR_DF_META: u32 number of items, and for each item: u32 key,
+ *   GVariant type string, u32 size and the (little endian) serialized
+ *   normal form of the value.
+ * - SR_DF_LOGIC: u16 unitsize and the samples.
+ * - SR_DF_ANALOG: u32 number of samples, u8 flags (bit 0: timestamps
+ *   follow the data); encoding: u8 unitsize, is_signed, is_float,
+ *   is_bigendian, i8 digits, u8 is_digits_decimal, scale and offset
+ *   (i64 p, u64 q each); meaning: u32 mq, u32 unit, u64 mqflags,
+ *   u32 number of channels and their u32 indices; spec: i8 digits;
+ *   then the data, and the i64 timestamps.
+ * - Other packet types have no payload.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "minilzo/minilzo.h"
+
+#define LOG_PREFIX "output/remote"
+
+/* Clients which don't acknowledge data in time get dropped. */
+#define CLIENT_TIMEOUT_MS 10000
+/* Batched logic data gets sent after this time at the latest. */
+#define BATCH_MAX_DELAY_US (100 * 1000)
+/* Payloads smaller than this are not worth compressing. */
+#define COMPRESS_MIN_SIZE 256
+
+struct client {
+	struct sr_tcp_dev_inst *tcp;
+	char name[64];
+	GByteArray *rx;
+	gboolean started;
+	uint64_t window;
+	uint64_t sent;
+	uint64_t credited;
+	uint64_t dropped;
+};
+
+struct context {
+	struct sr_tcp_dev_inst *listener;
+	GSList *clients;
+	gboolean wait;
+	gboolean compress;
+	gboolean drop;
+	uint64_t batch_size;
+	/* Header and meta frames of the running acquisition. */
+	GString *preamble;
+	GString *frame;
+	GByteArray *batch;
+	uint16_t batch_unitsize;
+	int64_t batch_start;
+	uint8_t *lzo_buf;
+	size_t lzo_buf_size;
+	void *lzo_wrkmem;
+};
+
+static void put_u8(GString *s, uint8_t v)
+{
+	g_string_append_c(s, v);
+}
+
+static void put_u16(GString *s, uint16_t v)
+{
+	uint8_t b[sizeof(v)];
+
+	WL16(b, v);
+	g_string_append_len(s, (const char *)b, sizeof(b));
+}
+
+static void put_u32(GString *s, uint32_t v)
+{
+	uint8_t b[sizeof(v)];
+
+	WL32(b, v);
+	g_string_append_len(s, (const char *)b, sizeof(b));
+}
+
+static void put_u64(GString *s, uint64_t v)
+{
+	uint8_t b[sizeof(v)];
+
+	WL64(b, v);
+	g_string_append_len(s, (const char *)b, sizeof(b));
+}
+
+static void put_str(GString *s, const char *text)
+{
+	size_t len;
+
+	len = text ? MIN(strlen(text), G_MAXUINT16) : 0;
+	put_u16(s, len);
+	g_string_append_len(s, text, len);
+}
+
+/* Start a frame, the payload gets appended by the caller. */
+static void frame_begin(GString *frame)
+{
+	g_string_truncate(frame, 0);
+	g_string_set_size(frame, SR_NETSTREAM_FRAME_HEADER);
+}
+
+/* Complete the frame's header, compress the payload when that pays off. */
+static void frame_end(struct context *ctx, GString *frame, uint16_t type,
+		gboolean compressible)
+{
+	uint8_t *hdr;
+	size_t raw_len;
+	lzo_uint lzo_len;
+	uint16_t flags;
+
+	raw_len = frame->len - SR_NETSTREAM_FRAME_HEADER;
+	flags = 0;
+	if (compressible && ctx->compress && raw_len >= COMPRESS_MIN_SIZE) {
+		/* Worst case expansion of LZO1X, see its documentation. */
+		lzo_len = raw_len + raw_len / 16 + 64 + 3;
+		if (lzo_len > ctx->lzo_buf_size) {
+			g_free(ctx->lzo_buf);
+			ctx->lzo_buf = g_malloc(lzo_len);
+			ctx->lzo_buf_size = lzo_len;
+		}
+		if (lzo1x_1_compress((uint8_t *)frame->str + SR_NETSTREAM_FRAME_HEADER,
+				raw_len, ctx->lzo_buf, &lzo_len,
+				ctx->lzo_wrkmem) == LZO_E_OK
+				&& lzo_len + sizeof(uint32_t) < raw_len) {
+			g_string_truncate(frame, SR_NETSTREAM_FRAME_HEADER);
+			put_u32(frame, raw_len);
+			g_string_append_len(frame, (const char *)ctx->lzo_buf, lzo_len);
+			flags |= SR_NETSTREAM_FLAG_LZO;
+		}
+	}
+
+	hdr = (uint8_t *)frame->str;
+	WL16(&hdr[0], type);
+	WL16(&hdr[2], flags);
+	WL32(&hdr[4], frame->len - SR_NETSTREAM_FRAME_HEADER);
+}
+
+static void hello_encode(const struct sr_output *o, GString *frame)
+{
+	struct context *ctx;
+	const struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GVariant *gvar;
+	uint64_t samplerate;
+	GSList *l;
+
+	ctx = o->priv;
+	sdi = o->sdi;
+
+	samplerate = 0;
+	if (sr_config_get(sdi->driver, sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	frame_begin(frame);
+	put_u32(frame, SR_NETSTREAM_VERSION);
+	put_u64(frame, samplerate);
+	put_str(frame, sdi->vendor);
+	put_str(frame, sdi->model);
+	put_str(frame, sdi->version);
+	put_str(frame, sdi->serial_num);
+	put_u32(frame, g_slist_length(sdi->channels));
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		put_u32(frame, ch->index);
+		put_u32(frame, ch->type);
+		put_u8(frame, ch->enabled);
+		put_str(frame, ch->name);
+	}
+	frame_end(ctx, frame, SR_NETSTREAM_HELLO, FALSE);
+}
+
+static void meta_encode(GString *frame, const struct sr_datafeed_meta *meta)
+{
+	struct sr_config *src;
+	GVariant *value, *swapped;
+	GSList *l;
+	size_t size;
+
+	put_u32(frame, g_slist_length(meta->config));
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		value = g_variant_get_normal_form(src->data);
+		if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+			swapped = g_variant_byteswap(value);
+			g_variant_unref(value);
+			value = swapped;
+		}
+		size = g_variant_get_size(value);
+		put_u32(frame, src->key);
+		put_str(frame, g_variant_get_type_string(value));
+		put_u32(frame, size);
+		g_string_append_len(frame, g_variant_get_data(value), size);
+		g_variant_unref(value);
+	}
+}
+
+static void analog_encode(GString *frame, const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+	const struct sr_analog_meaning *mn;
+	struct sr_channel *ch;
+	GSList *l;
+	size_t num_channels, i;
+
+	enc = analog->encoding;
+	mn = analog->meaning;
+	num_channels = g_slist_length(mn->channels);
+
+	put_u32(frame, analog->num_samples);
+	put_u8(frame, analog->timestamps ? 1 : 0);
+	put_u8(frame, enc->unitsize);
+	put_u8(frame, enc->is_signed);
+	put_u8(frame, enc->is_float);
+	put_u8(frame, enc->is_bigendian);
+	put_u8(frame, (uint8_t)enc->digits);
+	put_u8(frame, enc->is_digits_decimal);
+	put_u64(frame, (uint64_t)enc->scale.p);
+	put_u64(frame, enc->scale.q);
+	put_u64(frame, (uint64_t)enc->offset.p);
+	put_u64(frame, enc->offset.q);
+	put_u32(frame, mn->mq);
+	put_u32(frame, mn->unit);
+	put_u64(frame, mn->mqflags);
+	put_u32(frame, num_channels);
+	for (l = mn->channels; l; l = l->next) {
+		ch = l->data;
+		put_u32(frame, ch->index);
+	}
+	put_u8(frame, (uint8_t)(analog->spec ? analog->spec->spec_digits : 0));
+	g_string_append_len(frame, analog->data,
+		(size_t)analog->num_samples * num_channels * enc->unitsize);
+	if (analog->timestamps) {
+		for (i = 0; i < analog->num_samples; i++)
+			put_u64(frame, (uint64_t)analog->timestamps[i]);
+	}
+}
+
+/* Encode a datafeed packet. Returns whether it carries sample data. */
+static gboolean packet_encode(struct context *ctx, GString *frame,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_logic *logic;
+	gboolean samples;
+
+	frame_begin(frame);
+	samples = FALSE;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		put_u32(frame, (uint32_t)header->feed_version);
+		put_u64(frame, (uint64_t)header->starttime.tv_sec);
+		put_u64(frame, (uint64_t)header->starttime.tv_usec);
+		break;
+	case SR_DF_META:
+		meta_encode(frame, packet->payload);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		put_u16(frame, logic->unitsize);
+		g_string_append_len(frame, logic->data, logic->length);
+		samples = TRUE;
+		break;
+	case SR_DF_ANALOG:
+		analog_encode(frame, packet->payload);
+		samples = TRUE;
+		break;
+	}
+	frame_end(ctx, frame, packet->type, samples);
+
+	return samples;
+}
+
+static void client_free(struct client *c)
+{
+	sr_tcp_dev_inst_free(c->tcp);
+	g_byte_array_free(c->rx, TRUE);
+	g_free(c);
+}
+
+static void client_drop(struct context *ctx, struct client *c)
+{
+	sr_info("Client %s disconnected.", c->name);
+	ctx->clients = g_slist_remove(ctx->clients, c);
+	client_free(c);
+}
+
+static int client_write(struct client *c, const GString *frame)
+{
+	const uint8_t *data;
+	size_t len;
+	int ret;
+
+	data = (const uint8_t *)frame->str;
+	len = frame->len;
+	while (len) {
+		ret = sr_tcp_write_bytes(c->tcp, data, len);
+		if (ret <= 0)
+			return SR_ERR_IO;
+		data += ret;
+		len -= ret;
+	}
+	c->sent += frame->len;
+
+	return SR_OK;
+}
+
+/* Process the control frames which a client sent. */
+static int client_receive(struct context *ctx, struct client *c)
+{
+	uint8_t buf[256];
+	const uint8_t *p;
+	uint32_t len;
+	int ret;
+
+	while (sr_tcp_is_readable(c->tcp)) {
+		ret = sr_tcp_read_bytes(c->tcp, buf, sizeof(buf), TRUE);
+		/* Readable without data means the peer closed the connection. */
+		if (ret <= 0)
+			return SR_ERR_IO;
+		g_byte_array_append(c->rx, buf, ret);
+	}
+
+	while (c->rx->len >= SR_NETSTREAM_FRAME_HEADER) {
+		p = c->rx->data;
+		len = RL32(&p[4]);
+		if (len > sizeof(buf)) {
+			sr_err("Client %s sent an invalid frame.", c->name);
+			return SR_ERR_DATA;
+		}
+		if (c->rx->len < SR_NETSTREAM_FRAME_HEADER + len)
+			break;
+		p += SR_NETSTREAM_FRAME_HEADER;
+		switch (RL16(c->rx->data)) {
+		case SR_NETSTREAM_START:
+			if (len < sizeof(uint32_t) || c->started)
+				break;
+			c->window = RL32(p);
+			c->started = TRUE;
+			sr_dbg("Client %s started, window %" PRIu64 " bytes.",
+				c->name, c->window);
+			/* Catch up with the running acquisition. */
+			if (ctx->preamble->len && client_write(c, ctx->preamble) != SR_OK)
+				return SR_ERR_IO;
+			break;
+		case SR_NETSTREAM_CREDIT:
+			if (len >= sizeof(uint32_t))
+				c->credited += RL32(p);
+			break;
+		}
+		g_byte_array_remove_range(c->rx, 0, SR_NETSTREAM_FRAME_HEADER + len);
+	}
+
+	return SR_OK;
+}
+
+/* Accept new clients, and process the control frames of all clients. */
+static void clients_service(const struct sr_output *o)
+{
+	struct context *ctx;
+	struct sr_tcp_dev_inst *tcp;
+	struct client *c;
+	GString *hello;
+	GSList *l, *next;
+
+	ctx = o->priv;
+
+	while ((tcp = sr_tcp_accept(ctx->listener))) {
+		c = g_malloc0(sizeof(*c));
+		c->tcp = tcp;
+		c->rx = g_byte_array_new();
+		sr_tcp_get_port_path(tcp, NULL, ':', c->name, sizeof(c->name));
+		sr_info("Client %s connected.", c->name);
+		hello = g_string_sized_new(256);
+		hello_encode(o, hello);
+		if (client_write(c, hello) != SR_OK) {
+			client_free(c);
+		} else {
+			c->sent = 0;
+			ctx->clients = g_slist_append(ctx->clients, c);
+		}
+		g_string_free(hello, TRUE);
+	}
+
+	for (l = ctx->clients; l; l = next) {
+		next = l->next;
+		c = l->data;
+		if (client_receive(ctx, c) != SR_OK)
+			client_drop(ctx, c);
+	}
+}
+
+/* Hold back the acquisition until a client started receiving. */
+static void clients_wait(const struct sr_output *o)
+{
+	struct context *ctx;
+	GSList *l;
+
+	ctx = o->priv;
+	sr_info("Waiting for a client on port %s.", ctx->listener->tcp_port);
+	while (TRUE) {
+		clients_service(o);
+		for (l = ctx->clients; l; l = l->next) {
+			if (((struct client *)l->data)->started)
+				return;
+		}
+		g_usleep(10 * 1000);
+	}
+}
+
+static uint64_t client_in_flight(const struct client *c)
+{
+	return c->sent - MIN(c->credited, c->sent);
+}
+
+/* Check whether the client's window has room for len more bytes. */
+static gboolean client_has_room(const struct client *c, size_t len)
+{
+	uint64_t in_flight;
+
+	/* Frames larger than the window go out when nothing else is pending. */
+	in_flight = client_in_flight(c);
+	return !in_flight || in_flight + len <= c->window;
+}
+
+static int client_wait_room(struct context *ctx, struct client *c, size_t len)
+{
+	int64_t deadline;
+
+	deadline = g_get_monotonic_time() + CLIENT_TIMEOUT_MS * 1000;
+	while (!client_has_room(c, len)) {
+		if (g_get_monotonic_time() > deadline) {
+			sr_warn("Client %s stalled.", c->name);
+			return SR_ERR_TIMEOUT;
+		}
+		if (!sr_tcp_wait_readable(c->tcp, 100))
+			continue;
+		if (client_receive(ctx, c) != SR_OK)
+			return SR_ERR_IO;
+	}
+
+	return SR_OK;
+}
+
+static void broadcast(struct context *ctx, const GString *frame,
+		gboolean samples)
+{
+	struct client *c;
+	GSList *l, *next;
+
+	for (l = ctx->clients; l; l = next) {
+		next = l->next;
+		c = l->data;
+		if (!c->started)
+			continue;
+		/* Only sample data is subject to flow control. */
+		if (samples && !client_has_room(c, frame->len)) {
+			if (ctx->drop) {
+				c->dropped++;
+				continue;
+			}
+			if (client_wait_room(ctx, c, frame->len) != SR_OK) {
+				client_drop(ctx, c);
+				continue;
+			}
+		}
+		if (client_write(c, frame) != SR_OK)
+			client_drop(ctx, c);
+	}
+}
+
+static void send_packet(struct context *ctx,
+		const struct sr_datafeed_packet *packet)
+{
+	gboolean samples;
+
+	samples = packet_encode(ctx, ctx->frame, packet);
+	broadcast(ctx, ctx->frame, samples);
+}
+
+static void batch_flush(struct context *ctx)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	if (!ctx->batch->len)
+		return;
+
+	logic.length = ctx->batch->len;
+	logic.unitsize = ctx->batch_unitsize;
+	logic.data = ctx->batch->data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	send_packet(ctx, &packet);
+	g_byte_array_set_size(ctx->batch, 0);
+}
+
+static void batch_add(struct context *ctx, const struct sr_datafeed_logic *logic)
+{
+	struct sr_datafeed_packet packet;
+
+	if (!ctx->batch_size) {
+		packet.type = SR_DF_LOGIC;
+		packet.payload = logic;
+		send_packet(ctx, &packet);
+		return;
+	}
+
+	if (ctx->batch->len && ctx->batch_unitsize != logic->unitsize)
+		batch_flush(ctx);
+	if (!ctx->batch->len)
+		ctx->batch_start = g_get_monotonic_time();
+	ctx->batch_unitsize = logic->unitsize;
+	g_byte_array_append(ctx->batch, logic->data, logic->length);
+	if (ctx->batch->len >= ctx->batch_size
+			|| g_get_monotonic_time() - ctx->batch_start >= BATCH_MAX_DELAY_US)
+		batch_flush(ctx);
+}
+
+static void planar_add(struct context *ctx,
+		const struct sr_datafeed_logic_planar *planar)
+{
+	struct sr_datafeed_logic logic;
+	uint8_t *samples;
+
+	samples = g_malloc(planar->num_blocks * 32 * planar->unitsize);
+	if (sr_logic_planar_to_logic(planar, samples) == SR_OK) {
+		logic.length = planar->num_blocks * 32 * planar->unitsize;
+		logic.unitsize = planar->unitsize;
+		logic.data = samples;
+		batch_add(ctx, &logic);
+	}
+	g_free(samples);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	const char *address, *port, *policy;
+
+	address = g_variant_get_string(g_hash_table_lookup(options, "address"), NULL);
+	port = g_variant_get_string(g_hash_table_lookup(options, "port"), NULL);
+	policy = g_variant_get_string(g_hash_table_lookup(options, "policy"), NULL);
+	if (!*port) {
+		sr_err("A port is required.");
+		return SR_ERR_ARG;
+	}
+	if (strcmp(policy, "block") && strcmp(policy, "drop")) {
+		sr_err("Unknown flow control policy '%s'.", policy);
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	ctx->wait = g_variant_get_boolean(g_hash_table_lookup(options, "wait"));
+	ctx->compress = g_variant_get_boolean(g_hash_table_lookup(options, "compress"));
+	ctx->batch_size = g_variant_get_uint64(g_hash_table_lookup(options, "batch"));
+	ctx->drop = !strcmp(policy, "drop");
+
+	/* LZO got initialized by sr_init(). */
+	if (ctx->compress)
+		ctx->lzo_wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+
+	ctx->listener = sr_tcp_dev_inst_new(address, port);
+	if (sr_tcp_listen(ctx->listener) != SR_OK) {
+		sr_tcp_dev_inst_free(ctx->listener);
+		g_free(ctx->lzo_wrkmem);
+		g_free(ctx);
+		return SR_ERR_IO;
+	}
+	sr_info("Listening on %s:%s.", *address ? address : "*", port);
+
+	ctx->preamble = g_string_new(NULL);
+	ctx->frame = g_string_new(NULL);
+	ctx->batch = g_byte_array_new();
+	o->priv = ctx;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct context *ctx;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	clients_service(o);
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		batch_add(ctx, packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar_add(ctx, packet->payload);
+		break;
+	case SR_DF_HEADER:
+		batch_flush(ctx);
+		g_string_truncate(ctx->preamble, 0);
+		if (ctx->wait)
+			clients_wait(o);
+		send_packet(ctx, packet);
+		g_string_append_len(ctx->preamble, ctx->frame->str, ctx->frame->len);
+		break;
+	case SR_DF_META:
+		batch_flush(ctx);
+		send_packet(ctx, packet);
+		g_string_append_len(ctx->preamble, ctx->frame->str, ctx->frame->len);
+		break;
+	case SR_DF_END:
+		batch_flush(ctx);
+		send_packet(ctx, packet);
+		g_string_truncate(ctx->preamble, 0);
+		break;
+	case SR_DF_TRIGGER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+	case SR_DF_ANALOG:
+		batch_flush(ctx);
+		send_packet(ctx, packet);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "port", "Port", "TCP port to listen on", NULL, NULL },
+	{ "address", "Address", "Local address to listen on, all when empty", NULL, NULL },
+	{ "wait", "Wait for client", "Hold back the acquisition until a client started receiving", NULL, NULL },
+	{ "compress", "Compress", "Compress sample data", NULL, NULL },
+	{ "batch", "Batch size", "Collect this many bytes of logic data per frame, 0 to disable", NULL, NULL },
+	{ "policy", "Flow control", "Block the acquisition or drop sample data when a client falls behind", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l = NULL;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(SR_NETSTREAM_DEFAULT_PORT));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+		options[3].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[4].def = g_variant_ref_sink(g_variant_new_uint64(64 * 1024));
+		options[5].def = g_variant_ref_sink(g_variant_new_string("block"));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("block")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("drop")));
+		options[5].values = l;
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	struct client *c;
+	GSList *l;
+
+	if (!o || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	for (l = ctx->clients; l; l = l->next) {
+		c = l->data;
+		if (c->dropped)
+			sr_warn("Dropped %" PRIu64 " packets for client %s.",
+				c->dropped, c->name);
+		client_free(c);
+	}
+	g_slist_free(ctx->clients);
+	sr_tcp_dev_inst_free(ctx->listener);
+	g_string_free(ctx->preamble, TRUE);
+	g_string_free(ctx->frame, TRUE);
+	g_byte_array_free(ctx->batch, TRUE);
+	g_free(ctx->lzo_buf);
+	g_free(ctx->lzo_wrkmem);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_remote = {
+	.id = "remote",
+	.name = "Remote",
+	.desc = "Datafeed stream for the sigrok-remote driver, over TCP",
+	.exts = NULL,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,454 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/srraw"
+#define COPY_SIZE (4 * 1024 * 1024)
+
+/*
+ * The uncompressed session file format, see libsigrok-internal.h for
+ * its layout. The logic plane gets written to the file as the data is
+ * received. The analog planes get collected in temporary files, one for
+ * each channel, and get appended to the file at the end, followed by
+ * the metadata. The header gets written last.
+ */
+struct out_context {
+	gboolean file_created;
+	uint64_t samplerate;
+	char *filename;
+	FILE *file;
+	GKeyFile *meta;
+	uint64_t pos;
+	size_t unitsize;
+	uint64_t logic_size;
+	size_t first_analog_index;
+	size_t analog_ch_count;
+	gint *analog_index_map;
+	FILE **analog_files;
+	uint64_t *analog_sizes;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+
+	(void)options;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("srraw output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+
+	outc = g_malloc0(sizeof(*outc));
+	outc->filename = g_strdup(o->filename);
+	o->priv = outc;
+
+	return SR_OK;
+}
+
+static int file_write(struct out_context *outc, const void *data, size_t len)
+{
+	if (len && fwrite(data, 1, len, outc->file) != len) {
+		sr_err("Failed to write %s: %s", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->pos += len;
+
+	return SR_OK;
+}
+
+/* Pad the file up to the next multiple of SR_RAWFILE_ALIGN. */
+static int file_align(struct out_context *outc)
+{
+	static const uint8_t zeros[SR_RAWFILE_ALIGN];
+	size_t len;
+
+	len = outc->pos % SR_RAWFILE_ALIGN;
+	if (!len)
+		return SR_OK;
+
+	return file_write(outc, zeros, SR_RAWFILE_ALIGN - len);
+}
+
+static int file_create(const struct sr_output *o)
+{
+	static const uint8_t header[SR_RAWFILE_ALIGN];
+	struct out_context *outc;
+	struct sr_channel *ch;
+	GVariant *gvar;
+	GKeyFile *meta;
+	GSList *l;
+	const char *devgroup;
+	char *s;
+	size_t ch_nr, idx;
+	guint logic_channels, enabled_logic_channels;
+
+	outc = o->priv;
+
+	if (outc->samplerate == 0 && sr_config_get(o->sdi->driver, o->sdi, NULL,
+					SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+		outc->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	if (!(outc->file = g_fopen(outc->filename, "wb"))) {
+		sr_err("Cannot create %s: %s", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	/* The header gets written when the file is complete. */
+	outc->pos = 0;
+	if (file_write(outc, header, sizeof(header)) != SR_OK)
+		return SR_ERR_IO;
+
+	meta = g_key_file_new();
+	g_key_file_set_string(meta, "global", "sigrok version",
+			sr_package_version_string_get());
+	g_key_file_set_string(meta, "global", "byteorder",
+			G_BYTE_ORDER == G_BIG_ENDIAN ? "big" : "little");
+
+	devgroup = "device 1";
+
+	logic_channels = 0;
+	enabled_logic_channels = 0;
+	outc->analog_ch_count = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			logic_channels++;
+			if (ch->enabled)
+				enabled_logic_channels++;
+		} else if (ch->type == SR_CHANNEL_ANALOG && ch->enabled) {
+			outc->analog_ch_count++;
+		}
+	}
+
+	/* Same channel numbering as srzip, see there. */
+	outc->first_analog_index = enabled_logic_channels ? logic_channels + 1 : 1;
+	if (enabled_logic_channels > 0) {
+		g_key_file_set_string(meta, devgroup, "capturefile", "logic-1");
+		g_key_file_set_integer(meta, devgroup, "total probes", logic_channels);
+	}
+
+	s = sr_samplerate_string(outc->samplerate);
+	g_key_file_set_string(meta, devgroup, "samplerate", s);
+	g_free(s);
+
+	g_key_file_set_integer(meta, devgroup, "total analog", outc->analog_ch_count);
+
+	outc->unitsize = (logic_channels + 8 - 1) / 8;
+	outc->logic_size = 0;
+	if (enabled_logic_channels > 0)
+		g_key_file_set_integer(meta, devgroup, "unitsize", outc->unitsize);
+
+	outc->analog_index_map = g_malloc0(sizeof(gint) * outc->analog_ch_count + 1);
+	outc->analog_files = g_malloc0(sizeof(FILE *) * outc->analog_ch_count + 1);
+	outc->analog_sizes = g_malloc0(sizeof(uint64_t) * outc->analog_ch_count + 1);
+
+	idx = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+
+		s = NULL;
+		switch (ch->type) {
+		case SR_CHANNEL_LOGIC:
+			ch_nr = ch->index + 1;
+			s = g_strdup_printf("probe%zu", ch_nr);
+			break;
+		case SR_CHANNEL_ANALOG:
+			ch_nr = outc->first_analog_index + idx;
+			outc->analog_index_map[idx] = ch->index;
+			if (!(outc->analog_files[idx] = tmpfile())) {
+				sr_err("Cannot create temporary file: %s",
+					g_strerror(errno));
+				g_key_file_free(meta);
+				return SR_ERR_IO;
+			}
+			s = g_strdup_printf("analog%zu", ch_nr);
+			idx++;
+			break;
+		}
+		if (s) {
+			g_key_file_set_string(meta, devgroup, s, ch->name);
+			g_free(s);
+		}
+	}
+
+	outc->meta = meta;
+
+	return SR_OK;
+}
+
+static int append_logic(const struct sr_output *o,
+		const struct sr_datafeed_logic *logic)
+{
+	struct out_context *outc;
+	uint8_t *buf;
+	size_t count;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->unitsize || !logic->unitsize)
+		return SR_OK;
+
+	count = logic->length / logic->unitsize;
+	if (logic->unitsize == outc->unitsize) {
+		ret = file_write(outc, logic->data, count * outc->unitsize);
+	} else {
+		/* Discard excess bits, or pad with zeros. */
+		buf = g_try_malloc(count * outc->unitsize);
+		if (!buf)
+			return SR_ERR_MALLOC;
+		sr_logic_unitsize_convert(logic->data, logic->unitsize,
+			buf, outc->unitsize, count);
+		ret = file_write(outc, buf, count * outc->unitsize);
+		g_free(buf);
+	}
+	if (ret == SR_OK)
+		outc->logic_size += count * outc->unitsize;
+
+	return ret;
+}
+
+static int append_analog(const struct sr_output *o,
+		const struct sr_datafeed_analog *analog)
+{
+	struct out_context *outc;
+	const struct sr_channel *ch;
+	float *values;
+	size_t idx, len;
+	int ret;
+
+	outc = o->priv;
+
+	/* TODO: support packets covering multiple channels */
+	if (g_slist_length(analog->meaning->channels) != 1) {
+		sr_err("Analog packets covering multiple channels not supported yet");
+		return SR_ERR;
+	}
+	ch = g_slist_nth_data(analog->meaning->channels, 0);
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
+		if (outc->analog_index_map[idx] == ch->index)
+			break;
+	}
+	if (idx == outc->analog_ch_count)
+		return SR_ERR_ARG;
+
+	values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
+	if (!values)
+		return SR_ERR_MALLOC;
+	ret = sr_analog_to_float(analog, values);
+	len = analog->num_samples * sizeof(values[0]);
+	if (ret == SR_OK && fwrite(values, 1, len, outc->analog_files[idx]) != len) {
+		sr_err("Failed to write temporary file: %s", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	if (ret == SR_OK)
+		outc->analog_sizes[idx] += len;
+	g_free(values);
+
+	return ret;
+}
+
+static void set_plane(struct out_context *outc, const char *name,
+		uint64_t offset, uint64_t size)
+{
+	char *key;
+
+	key = g_strdup_printf("%s offset", name);
+	g_key_file_set_uint64(outc->meta, "planes", key, offset);
+	g_free(key);
+	key = g_strdup_printf("%s size", name);
+	g_key_file_set_uint64(outc->meta, "planes", key, size);
+	g_free(key);
+}
+
+/* Append the analog planes and the metadata, then write the header. */
+static int file_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	uint8_t header[SR_RAWFILE_HDR_SIZE];
+	uint8_t *buf;
+	char *name, *metabuf;
+	gsize metalen;
+	uint64_t meta_offset;
+	size_t idx, len;
+	int ret;
+
+	outc = o->priv;
+
+	if (outc->logic_size)
+		set_plane(outc, "logic-1", SR_RAWFILE_ALIGN, outc->logic_size);
+
+	buf = g_malloc(COPY_SIZE);
+	ret = SR_OK;
+	for (idx = 0; idx < outc->analog_ch_count && ret == SR_OK; idx++) {
+		if ((ret = file_align(outc)) != SR_OK)
+			break;
+		name = g_strdup_printf("analog-1-%zu",
+			outc->first_analog_index + idx);
+		set_plane(outc, name, outc->pos, outc->analog_sizes[idx]);
+		g_free(name);
+		rewind(outc->analog_files[idx]);
+		while (ret == SR_OK && (len = fread(buf, 1, COPY_SIZE,
+				outc->analog_files[idx])) > 0)
+			ret = file_write(outc, buf, len);
+	}
+	g_free(buf);
+	if (ret != SR_OK)
+		return ret;
+
+	if ((ret = file_align(outc)) != SR_OK)
+		return ret;
+	meta_offset = outc->pos;
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	ret = file_write(outc, metabuf, metalen);
+	g_free(metabuf);
+	if (ret != SR_OK)
+		return ret;
+
+	memcpy(header, SR_RAWFILE_MAGIC, sizeof(SR_RAWFILE_MAGIC) - 1);
+	WL32(header + SR_RAWFILE_HDR_VERSION, SR_RAWFILE_VERSION);
+	WL32(header + SR_RAWFILE_HDR_ALIGN, SR_RAWFILE_ALIGN);
+	WL64(header + SR_RAWFILE_HDR_META_OFFSET, meta_offset);
+	WL64(header + SR_RAWFILE_HDR_META_SIZE, metalen);
+	if (fseek(outc->file, 0, SEEK_SET) != 0
+			|| fwrite(header, 1, sizeof(header), outc->file) != sizeof(header)
+			|| fflush(outc->file) != 0) {
+		sr_err("Failed to write %s: %s", outc->filename,
+			g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
+	return SR_OK;
+}
+
+static void file_close(struct out_context *outc)
+{
+	size_t idx;
+
+	if (outc->file)
+		fclose(outc->file);
+	outc->file = NULL;
+	for (idx = 0; idx < outc->analog_ch_count; idx++) {
+		if (outc->analog_files[idx])
+			fclose(outc->analog_files[idx]);
+	}
+	g_free(outc->analog_files);
+	outc->analog_files = NULL;
+	g_free(outc->analog_sizes);
+	outc->analog_sizes = NULL;
+	g_free(outc->analog_index_map);
+	outc->analog_index_map = NULL;
+	outc->analog_ch_count = 0;
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	outc->meta = NULL;
+	outc->file_created = FALSE;
+}
+
+static int receive(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString **out)
+{
+	struct out_context *outc;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(outc = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			outc->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+	case SR_DF_ANALOG:
+		if (!outc->file_created) {
+			if ((ret = file_create(o)) != SR_OK) {
+				file_close(outc);
+				return ret;
+			}
+			outc->file_created = TRUE;
+		}
+		if (packet->type == SR_DF_LOGIC)
+			ret = append_logic(o, packet->payload);
+		else
+			ret = append_analog(o, packet->payload);
+		if (ret != SR_OK)
+			return ret;
+		break;
+	case SR_DF_END:
+		if (outc->file_created) {
+			ret = file_finish(o);
+			file_close(outc);
+			if (ret != SR_OK)
+				return ret;
+		}
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct out_context *outc;
+
+	outc = o->priv;
+
+	/* No SR_DF_END seen, still save what was received. */
+	if (outc->file_created)
+		file_finish(o);
+	file_close(outc);
+	g_free(outc->filename);
+	g_free(outc);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_srraw = {
+	.id = "srraw",
+	.name = "srraw",
+	.desc = "Uncompressed, memory mappable session file format data",
+	.exts = (const char*[]){"srraw", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = NULL,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -30,10 +31,41 @@
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+/* Highest compression level of any method (zstd). */
+#define MAX_LEVEL 22
+
+/*
+ * The archive gets written once, at the end of the acquisition. libzip
+ * only writes archives when they get closed, and re-opening the archive
+ * for every chunk would rewrite it completely each time. Until then the
+ * metadata is kept in memory. Filled chunk buffers get handed to a pool
+ * of worker threads, which compress every chunk into a single entry
+ * archive in a temporary directory. The final archive copies these
+ * entries in their compressed form, in the order of the chunks. The
+ * number of chunks in flight is limited, to bound memory use.
+ */
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	GKeyFile *meta;
+	char *chunk_dir;
+	GSList *chunk_names;
+	GThreadPool *pool;
+	GMutex mutex;
+	GCond done;
+	unsigned int in_flight;
+	unsigned int max_in_flight;
+	struct sr_context *mem_ctx;
+	gboolean chunk_error;
+	char *compression;
+	zip_int32_t method;
+	uint32_t level;
+	gboolean rle;
+	unsigned int logic_chunks;
+	unsigned int *analog_chunks;
+	uint64_t logic_samples;
+	uint64_t analog_samples;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -43,26 +75,71 @@ struct out_context {
 		uint8_t *samples;
 		size_t fill_size;
 	} logic_buff;
+	gboolean analog_native;
+	gboolean analog_native_used;
 	struct analog_buff {
+		/* Encoding of the chunks, unitsize 0 until the first packet. */
+		struct sr_analog_encoding encoding;
 		size_t alloc_size;
-		float *samples;
+		uint8_t *samples;
 		size_t fill_size;
+		gboolean requantized;
 	} *analog_buff;
 };
 
+static void chunk_compress(gpointer data, gpointer user_data);
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
 
-	(void)options;
+	const char *compression;
+	zip_int32_t method;
+	uint32_t level;
+	int ret;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	compression = g_variant_get_string(g_hash_table_lookup(options,
+		"compression"), NULL);
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "level"));
+	ret = sr_sessionfile_compression_lookup(compression, &method, TRUE);
+#if !HAVE_ZIP_SET_FILE_COMPRESSION
+	/* Without per-entry settings libzip always deflates. */
+	if (ret == SR_OK && (method != ZIP_CM_DEFLATE || level))
+		ret = SR_ERR_NA;
+#endif
+	if (ret == SR_ERR_NA) {
+		sr_err("Compression '%s' is not supported by libzip.",
+			compression);
+		return SR_ERR_ARG;
+	} else if (ret != SR_OK) {
+		sr_err("Unknown compression '%s'.", compression);
+		return SR_ERR_ARG;
+	}
+	if (level > MAX_LEVEL) {
+		sr_err("Invalid compression level %" PRIu32 ".", level);
+		return SR_ERR_ARG;
+	}
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->compression = g_strdup(compression);
+	outc->method = method;
+	outc->level = level;
+	outc->rle = !strcmp(g_variant_get_string(g_hash_table_lookup(options,
+		"encoding"), NULL), "rle");
+	outc->analog_native = !strcmp(g_variant_get_string(
+		g_hash_table_lookup(options, "analog"), NULL), "native");
+	g_mutex_init(&outc->mutex);
+	g_cond_init(&outc->done);
+	outc->max_in_flight = MAX(2, 2 * g_get_num_processors());
+	outc->mem_ctx = sr_dev_inst_mem_ctx(o->sdi);
+	outc->pool = g_thread_pool_new(chunk_compress, outc,
+		g_get_num_processors(), FALSE, NULL);
 	o->priv = outc;
 
 	return SR_OK;
@@ -71,8 +148,6 @@ static int init(struct sr_output *o, GHashTable *options)
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
-	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
@@ -80,8 +155,8 @@ static int zip_create(const struct sr_output *o)
 	GKeyFile *meta;
 	GSList *l;
 	const char *devgroup;
-	char *s, *metabuf;
-	gsize metalen;
+	char *s;
+	GError *error;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
@@ -94,19 +169,15 @@ static int zip_create(const struct sr_output *o)
 		g_variant_unref(gvar);
 	}
 
-	/* Quietly delete it first, libzip wants replace ops otherwise. */
-	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
-		return SR_ERR;
+	outc->logic_samples = 0;
+	outc->analog_samples = 0;
+	outc->analog_native_used = FALSE;
 
-	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_add(zipfile, "version", versrc) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
+	error = NULL;
+	outc->chunk_dir = g_dir_make_tmp("sigrok-srzip-XXXXXX", &error);
+	if (!outc->chunk_dir) {
+		sr_err("Cannot create chunk directory: %s", error->message);
+		g_error_free(error);
 		return SR_ERR;
 	}
 
@@ -115,6 +186,11 @@ static int zip_create(const struct sr_output *o)
 
 	g_key_file_set_string(meta, "global", "sigrok version",
 			sr_package_version_string_get());
+	g_key_file_set_string(meta, "global", "compression",
+			outc->compression);
+	if (outc->level)
+		g_key_file_set_integer(meta, "global", "compression level",
+				outc->level);
 
 	devgroup = "device 1";
 
@@ -156,6 +232,8 @@ static int zip_create(const struct sr_output *o)
 	g_free(s);
 
 	g_key_file_set_integer(meta, devgroup, "total analog", enabled_analog_channels);
+	if (outc->rle && enabled_logic_channels > 0)
+		g_key_file_set_string(meta, devgroup, "logic encoding", "rle");
 
 	outc->analog_ch_count = enabled_analog_channels;
 	alloc_size = sizeof(gint) * outc->analog_ch_count + 1;
@@ -191,10 +269,11 @@ static int zip_create(const struct sr_output *o)
 	 * several samples buffers for the analog channels. Allocate
 	 * buffers of CHUNK_SIZE size (in bytes), and determine the
 	 * sample counts from the respective channel counts and data
-	 * type widths.
+	 * type widths. The analog channels' data type gets determined
+	 * by their first packet.
 	 *
 	 * These buffers are intended to reduce the number of ZIP
-	 * archive update calls, and decouple the srzip output module
+	 * archive entries, and decouple the srzip output module
 	 * from implementation details in other acquisition device
 	 * drivers and input modules.
 	 *
@@ -222,31 +301,207 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].samples = g_try_malloc0(alloc_size);
 		if (!outc->analog_buff[index].samples)
 			return SR_ERR_MALLOC;
-		alloc_size /= sizeof(outc->analog_buff[0].samples[0]);
-		outc->analog_buff[index].alloc_size = alloc_size;
 		outc->analog_buff[index].fill_size = 0;
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
-	g_key_file_free(meta);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	outc->meta = meta;
+	g_free(outc->analog_chunks);
+	outc->analog_chunks = g_malloc0(sizeof(outc->analog_chunks[0])
+		* outc->analog_ch_count + 1);
 
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
-		sr_err("Error saving metadata into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(metasrc);
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	return SR_OK;
+}
+
+/** A chunk which a worker thread compresses. */
+struct chunk_job {
+	char *name;
+	char *path;
+	void *data;
+	size_t size;
+	size_t rle_unitsize;
+};
+
+/*
+ * Run length encode a logic chunk ("logic encoding" rle, archive version
+ * 3): the number of samples (uint64_t, little endian), then each run as
+ * the sample value (unitsize bytes) and the run length (LEB128). Runs
+ * of length L take at most L * (unitsize + 1) bytes, which bounds the
+ * encoded size.
+ */
+static uint8_t *rle_encode(const uint8_t *data, size_t size,
+	size_t unitsize, size_t *enc_size)
+{
+	uint8_t *enc, *wrptr;
+	const uint8_t *sample;
+	size_t count, idx;
+	uint64_t run;
+
+	count = size / unitsize;
+	enc = g_try_malloc(sizeof(uint64_t) + count * (unitsize + 1));
+	if (!enc)
+		return NULL;
+
+	WL64(enc, count);
+	wrptr = enc + sizeof(uint64_t);
+	idx = 0;
+	while (idx < count) {
+		sample = &data[idx * unitsize];
+		run = 1;
+		while (idx + run < count && !memcmp(sample,
+				&data[(idx + run) * unitsize], unitsize))
+			run++;
+		idx += run;
+		memcpy(wrptr, sample, unitsize);
+		wrptr += unitsize;
+		while (run >= 0x80) {
+			*wrptr++ = (run & 0x7f) | 0x80;
+			run >>= 7;
+		}
+		*wrptr++ = run;
 	}
+	*enc_size = wrptr - enc;
 
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
-		return SR_ERR;
+	return enc;
+}
+
+static void chunk_compress(gpointer data, gpointer user_data)
+{
+	struct chunk_job *job;
+	struct out_context *outc;
+	struct zip *zipfile;
+	struct zip_source *src;
+	zip_int64_t idx;
+	uint8_t *enc;
+	size_t size;
+	gboolean ok;
+
+	job = data;
+	outc = user_data;
+
+	ok = FALSE;
+	if (job->rle_unitsize) {
+		enc = rle_encode(job->data, job->size, job->rle_unitsize, &size);
+		g_free(job->data);
+		job->data = enc;
+		job->size = size;
+	}
+	g_unlink(job->path);
+	zipfile = job->data ? zip_open(job->path, ZIP_CREATE, NULL) : NULL;
+	if (zipfile) {
+		src = zip_source_buffer(zipfile, job->data, job->size, FALSE);
+		idx = src ? zip_add(zipfile, job->name, src) : -1;
+		if (src && idx < 0)
+			zip_source_free(src);
+#if HAVE_ZIP_SET_FILE_COMPRESSION
+		else if (src && zip_set_file_compression(zipfile, idx,
+				outc->method, outc->level) < 0)
+			ok = FALSE;
+#endif
+		else if (src)
+			ok = zip_close(zipfile) == 0;
+		if (!ok) {
+			sr_err("Failed to compress chunk '%s': %s",
+				job->name, zip_strerror(zipfile));
+			zip_discard(zipfile);
+		}
+	} else {
+		sr_err("Failed to create chunk '%s'.", job->name);
 	}
-	g_free(metabuf);
+
+	g_free(job->data);
+	g_free(job->path);
+	g_free(job);
+
+	sr_mem_release(outc->mem_ctx, CHUNK_SIZE);
+
+	g_mutex_lock(&outc->mutex);
+	if (!ok)
+		outc->chunk_error = TRUE;
+	outc->in_flight--;
+	g_cond_signal(&outc->done);
+	g_mutex_unlock(&outc->mutex);
+}
+
+/* Wait until the workers completed all chunks. */
+static void chunks_wait(struct out_context *outc)
+{
+	g_mutex_lock(&outc->mutex);
+	while (outc->in_flight)
+		g_cond_wait(&outc->done, &outc->mutex);
+	g_mutex_unlock(&outc->mutex);
+}
+
+static char *chunk_path(const struct out_context *outc, const char *name)
+{
+	char *file, *path;
+
+	file = g_strconcat(name, ".zip", NULL);
+	path = g_build_filename(outc->chunk_dir, file, NULL);
+	g_free(file);
+
+	return path;
+}
+
+/**
+ * Hand an archive entry's data to the compression workers.
+ *
+ * Takes ownership of the buffer, and replaces it by a fresh buffer of
+ * CHUNK_SIZE bytes for the caller to continue with.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] name The entry's name in the archive. Takes ownership.
+ * @param[in,out] data The entry's data.
+ * @param[in] size The data's size in bytes.
+ * @param[in] rle_unitsize Unit size of logic data to run length encode,
+ *                         0 to store the data as is.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_chunk_write(const struct sr_output *o, char *name,
+	void **data, size_t size, size_t rle_unitsize)
+{
+	struct out_context *outc;
+	struct chunk_job *job;
+	void *fresh;
+
+	outc = o->priv;
+	fresh = g_try_malloc0(CHUNK_SIZE);
+	if (!fresh) {
+		g_free(name);
+		return SR_ERR_MALLOC;
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->name = name;
+	job->path = chunk_path(outc, name);
+	job->data = *data;
+	job->size = size;
+	job->rle_unitsize = rle_unitsize;
+	*data = fresh;
+	outc->chunk_names = g_slist_append(outc->chunk_names, name);
+
+	/*
+	 * Chunks in flight are accounted with the memory budget. When
+	 * the budget is exhausted, wait for pending chunks to complete.
+	 * A single chunk is always allowed, so that output makes progress.
+	 */
+	g_mutex_lock(&outc->mutex);
+	while (TRUE) {
+		if (outc->in_flight < outc->max_in_flight) {
+			if (sr_mem_reserve(outc->mem_ctx, CHUNK_SIZE) == SR_OK)
+				break;
+			if (!outc->in_flight) {
+				sr_mem_charge(outc->mem_ctx, CHUNK_SIZE);
+				break;
+			}
+		}
+		g_cond_wait(&outc->done, &outc->mutex);
+	}
+	outc->in_flight++;
+	g_mutex_unlock(&outc->mutex);
+	g_thread_pool_push(outc->pool, job, NULL);
 
 	return SR_OK;
 }
@@ -255,133 +510,34 @@ static int zip_create(const struct sr_output *o)
  * Append a block of logic data to an srzip archive.
  *
  * @param[in] o Output module instance.
- * @param[in] buf Logic data samples as byte sequence.
+ * @param[in,out] buf Logic data samples as byte sequence. Gets replaced
+ *                    by a fresh buffer, see zip_chunk_write().
  * @param[in] unitsize Logic data unit size (bytes per sample).
  * @param[in] length Byte sequence length (in bytes, not samples).
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append(const struct sr_output *o,
-	uint8_t *buf, size_t unitsize, size_t length)
+	uint8_t **buf, size_t unitsize, size_t length)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
-	char *chunkname;
-	unsigned int next_chunk_num;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
-	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
-	}
-	g_key_file_free(kf);
-
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
-	}
-
+	if (!outc->logic_chunks)
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize", unitsize);
 	if (length % unitsize != 0) {
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
-	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
-	}
-	g_free(metabuf);
 
-	return SR_OK;
+	outc->logic_chunks++;
+
+	return zip_chunk_write(o,
+		g_strdup_printf("logic-1-%u", outc->logic_chunks),
+		(void **)buf, length, outc->rle ? unitsize : 0);
 }
 
 /**
@@ -464,22 +620,15 @@ static int zip_append_queue(const struct sr_output *o,
 		wrptr = &buff->samples[buff->fill_size * buff->zip_unit_size];
 		if (remain) {
 			copy_count = MIN(send_count, remain);
-			if (sample_skip_size || sample_pad_size)
-				copy_count = 1;
 			send_count -= copy_count;
 			buff->fill_size += copy_count;
-			memcpy(wrptr, rdptr, copy_count * sample_copy_size);
-			if (sample_pad_size) {
-				wrptr += sample_copy_size;
-				memset(wrptr, 0, sample_pad_size);
-			}
-			rdptr += copy_count * sample_copy_size;
-			if (sample_skip_size)
-				rdptr += sample_skip_size;
+			sr_logic_unitsize_convert(rdptr, feed_unitsize,
+				wrptr, buff->zip_unit_size, copy_count);
+			rdptr += copy_count * feed_unitsize;
 			remain -= copy_count;
 		}
 		if (send_count && !remain) {
-			ret = zip_append(o, buff->samples, buff->zip_unit_size,
+			ret = zip_append(o, &buff->samples, buff->zip_unit_size,
 				buff->fill_size * buff->zip_unit_size);
 			if (ret != SR_OK)
 				return ret;
@@ -489,7 +638,7 @@ static int zip_append_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append(o, buff->samples, buff->zip_unit_size,
+		ret = zip_append(o, &buff->samples, buff->zip_unit_size,
 			buff->fill_size * buff->zip_unit_size);
 		if (ret != SR_OK)
 			return ret;
@@ -503,77 +652,288 @@ static int zip_append_queue(const struct sr_output *o,
  * Append analog data of a channel to an srzip archive.
  *
  * @param[in] o Output module instance.
- * @param[in] values Sample data as array of floating point values.
- * @param[in] count Number of samples (float items, not bytes).
+ * @param[in,out] buff The channel's buffer. Its samples get replaced by
+ *                     a fresh buffer, see zip_chunk_write().
  * @param[in] ch_nr 1-based channel number.
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+	struct analog_buff *buff, size_t ch_nr)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
-	char *chunkname;
-	unsigned int next_chunk_num;
+	unsigned int *chunks;
+	int ret;
+
+	outc = o->priv;
+	chunks = &outc->analog_chunks[ch_nr - outc->first_analog_index];
+	(*chunks)++;
+
+	ret = zip_chunk_write(o,
+		g_strdup_printf("analog-1-%zu-%u", ch_nr, *chunks),
+		(void **)&buff->samples,
+		buff->fill_size * buff->encoding.unitsize, 0);
+	if (ret == SR_OK)
+		buff->fill_size = 0;
+
+	return ret;
+}
+
+/*
+ * Record the device's position in the session's time base, so that
+ * archives of several devices of a session can get aligned.
+ */
+static void meta_timebase_set(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct sr_timebase tb;
 
 	outc = o->priv;
 
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
+	if (!o->sdi->session || sr_session_timebase_get(o->sdi->session,
+			o->sdi, &tb) != SR_OK)
+		return;
+
+	g_key_file_set_int64(outc->meta, "device 1", "session start ns",
+		tb.start);
+	if (tb.triggered) {
+		g_key_file_set_uint64(outc->meta, "device 1", "trigger sample",
+			tb.trigger_sample);
+		g_key_file_set_int64(outc->meta, "device 1", "trigger ns",
+			tb.trigger_time);
+	}
+}
+
+/**
+ * Write the srzip archive, from the metadata and the stored chunks.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip *zipfile, *chunkzip;
+	struct zip_source *versrc, *metasrc, *chunksrc;
+	const char *version;
+	char *metabuf, *path;
+	gsize metalen;
+	GSList *l, *chunkzips;
+	int ret;
+
+	outc = o->priv;
+
+	chunks_wait(outc);
+	if (outc->chunk_error)
+		return SR_ERR;
+
+	/* Quietly delete it first, libzip wants replace ops otherwise. */
+	g_unlink(outc->filename);
+	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
+	if (!zipfile)
+		return SR_ERR;
+
+	/* "version" */
+	/*
+	 * Run length encoded logic chunks need readers of version 3,
+	 * integer analog chunks need readers of version 4.
+	 */
+	version = outc->analog_native_used ? "4" : outc->rle ? "3" : "2";
+	versrc = zip_source_buffer(zipfile, version, 1, FALSE);
+	if (zip_add(zipfile, "version", versrc) < 0) {
+		sr_err("Error saving version into zipfile: %s",
+			zip_strerror(zipfile));
+		zip_source_free(versrc);
+		zip_discard(zipfile);
 		return SR_ERR;
+	}
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
+	/* "metadata" */
+	/* Lets readers count the samples without inflating the chunks. */
+	g_key_file_set_uint64(outc->meta, "device 1", "total samples",
+		outc->logic_chunks ? outc->logic_samples : outc->analog_samples);
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
+	if (zip_add(zipfile, "metadata", metasrc) < 0) {
+		sr_err("Error saving metadata into zipfile: %s",
+			zip_strerror(zipfile));
+		zip_source_free(metasrc);
+		zip_discard(zipfile);
+		g_free(metabuf);
 		return SR_ERR;
 	}
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+	/*
+	 * The data chunks, copied in their compressed form. libzip reads
+	 * the chunk archives while writing, keep them open until then.
+	 */
+	chunkzips = NULL;
+	ret = SR_OK;
+	for (l = outc->chunk_names; l; l = l->next) {
+		path = chunk_path(outc, l->data);
+		chunkzip = zip_open(path, 0, NULL);
+		g_free(path);
+		if (!chunkzip) {
+			sr_err("Failed to open chunk '%s'.",
+				(const char *)l->data);
+			ret = SR_ERR;
+			break;
+		}
+		chunkzips = g_slist_prepend(chunkzips, chunkzip);
+		chunksrc = zip_source_zip(zipfile, chunkzip, 0, 0, 0, -1);
+		if (!chunksrc || zip_add(zipfile, l->data, chunksrc) < 0) {
+			sr_err("Failed to add chunk '%s': %s",
+				(const char *)l->data, zip_strerror(zipfile));
+			if (chunksrc)
+				zip_source_free(chunksrc);
+			ret = SR_ERR;
+			break;
 		}
 	}
 
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
+	if (ret != SR_OK) {
+		zip_discard(zipfile);
+	} else if (zip_close(zipfile) < 0) {
+		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
+		zip_discard(zipfile);
+		ret = SR_ERR;
 	}
-	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
+	for (l = chunkzips; l; l = l->next)
+		zip_discard(l->data);
+	g_slist_free(chunkzips);
+	g_free(metabuf);
+
+	return ret;
+}
+
+/* Remove the stored chunks and their directory. */
+static void zip_chunks_remove(struct out_context *outc)
+{
+	char *path;
+	GSList *l;
+
+	if (!outc->chunk_dir)
+		return;
+
+	chunks_wait(outc);
+	outc->chunk_error = FALSE;
+	for (l = outc->chunk_names; l; l = l->next) {
+		path = chunk_path(outc, l->data);
+		g_unlink(path);
+		g_free(path);
 	}
+	g_slist_free_full(outc->chunk_names, g_free);
+	outc->chunk_names = NULL;
+	g_rmdir(outc->chunk_dir);
+	g_free(outc->chunk_dir);
+	outc->chunk_dir = NULL;
+}
 
-	g_free(basename);
+/* Whether samples of this encoding get stored as they are. */
+static gboolean analog_native_encoding(const struct sr_analog_encoding *enc)
+{
+	if (enc->is_float || enc->is_bigendian)
+		return FALSE;
 
-	return SR_OK;
+	return enc->unitsize == 1 || enc->unitsize == 2 || enc->unitsize == 4;
+}
+
+static gboolean analog_same_encoding(const struct sr_analog_encoding *a,
+	const struct sr_analog_encoding *b)
+{
+	if (a->unitsize != b->unitsize || a->is_float != b->is_float
+			|| a->is_bigendian != b->is_bigendian)
+		return FALSE;
+	if (!a->is_float && a->is_signed != b->is_signed)
+		return FALSE;
+
+	return sr_rational_eq(&a->scale, &b->scale)
+		&& sr_rational_eq(&a->offset, &b->offset);
+}
+
+/*
+ * Pick the encoding of a channel's chunks from its first packet. Integer
+ * samples get stored as they are, with their scale and offset in the
+ * metadata. Everything else gets converted to float.
+ */
+static void analog_encoding_select(const struct sr_output *o,
+	struct analog_buff *buff, size_t ch_nr,
+	const struct sr_analog_encoding *enc)
+{
+	struct out_context *outc;
+	char *key, *val;
+
+	outc = o->priv;
+
+	if (outc->analog_native && analog_native_encoding(enc)) {
+		buff->encoding = *enc;
+		outc->analog_native_used = TRUE;
+
+		key = g_strdup_printf("analog%zu encoding", ch_nr);
+		val = g_strdup_printf("%sint%d", enc->is_signed ? "" : "u",
+			enc->unitsize * 8);
+		g_key_file_set_string(outc->meta, "device 1", key, val);
+		g_free(key);
+		g_free(val);
+		key = g_strdup_printf("analog%zu scale", ch_nr);
+		val = g_strdup_printf("%" PRId64 "/%" PRIu64,
+			enc->scale.p, enc->scale.q);
+		g_key_file_set_string(outc->meta, "device 1", key, val);
+		g_free(key);
+		g_free(val);
+		key = g_strdup_printf("analog%zu offset", ch_nr);
+		val = g_strdup_printf("%" PRId64 "/%" PRIu64,
+			enc->offset.p, enc->offset.q);
+		g_key_file_set_string(outc->meta, "device 1", key, val);
+		g_free(key);
+		g_free(val);
+	} else {
+		memset(&buff->encoding, 0, sizeof(buff->encoding));
+		buff->encoding.unitsize = sizeof(float);
+		buff->encoding.is_signed = TRUE;
+		buff->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+		buff->encoding.is_bigendian = TRUE;
+#endif
+		sr_rational_set(&buff->encoding.scale, 1, 1);
+		sr_rational_set(&buff->encoding.offset, 0, 1);
+	}
+	buff->alloc_size = CHUNK_SIZE / buff->encoding.unitsize;
+}
+
+/* Map values to a channel's integer encoding, clamped to its range. */
+static void analog_quantize(const struct sr_analog_encoding *enc,
+	const float *values, size_t count, uint8_t *wrptr)
+{
+	double scale, offset, lo, hi, raw;
+	int64_t v;
+	size_t idx;
+
+	scale = (double)enc->scale.p / enc->scale.q;
+	offset = (double)enc->offset.p / enc->offset.q;
+	if (enc->is_signed) {
+		lo = -ldexp(1.0, enc->unitsize * 8 - 1);
+		hi = ldexp(1.0, enc->unitsize * 8 - 1) - 1;
+	} else {
+		lo = 0;
+		hi = ldexp(1.0, enc->unitsize * 8) - 1;
+	}
+	for (idx = 0; idx < count; idx++) {
+		raw = scale ? round((values[idx] - offset) / scale) : 0;
+		v = (int64_t)CLAMP(raw, lo, hi);
+		switch (enc->unitsize) {
+		case 1:
+			write_u8_inc(&wrptr, v);
+			break;
+		case 2:
+			write_u16le_inc(&wrptr, v);
+			break;
+		case 4:
+			write_u32le_inc(&wrptr, v);
+			break;
+		}
+	}
 }
 
 /**
@@ -592,8 +952,10 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	const struct sr_channel *ch;
 	size_t idx, nr;
 	struct analog_buff *buff;
-	float *values, *wrptr, *rdptr;
-	size_t send_size, remain, copy_size;
+	const uint8_t *rdptr;
+	uint8_t *conv;
+	float *values;
+	size_t unitsize, send_size, remain, copy_size;
 	int ret;
 
 	outc = o->priv;
@@ -605,11 +967,9 @@ static int zip_append_analog_queue(const struct sr_output *o,
 			buff = &outc->analog_buff[idx];
 			if (!buff->fill_size)
 				continue;
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+			ret = zip_append_analog(o, buff, nr);
 			if (ret != SR_OK)
 				return ret;
-			buff->fill_size = 0;
 		}
 		return SR_OK;
 	}
@@ -629,53 +989,78 @@ static int zip_append_analog_queue(const struct sr_output *o,
 		return SR_ERR_ARG;
 	nr = outc->first_analog_index + idx;
 	buff = &outc->analog_buff[idx];
+	if (idx == 0)
+		outc->analog_samples += analog->num_samples;
+	if (!buff->encoding.unitsize)
+		analog_encoding_select(o, buff, nr, analog->encoding);
+	unitsize = buff->encoding.unitsize;
 
-	/* Convert the analog data to an array of float values. */
-	values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
-	if (!values)
-		return SR_ERR_MALLOC;
-	ret = sr_analog_to_float(analog, values);
-	if (ret != SR_OK) {
-		g_free(values);
-		return ret;
+	/*
+	 * Take samples in the chunks' encoding as they are. Convert the
+	 * others to float values, and these to the chunks' integers when
+	 * the encoding changed after the first packet.
+	 */
+	conv = NULL;
+	if (analog_same_encoding(analog->encoding, &buff->encoding)) {
+		rdptr = analog->data;
+	} else {
+		values = g_try_malloc0(analog->num_samples * sizeof(values[0]));
+		if (!values)
+			return SR_ERR_MALLOC;
+		ret = sr_analog_to_float(analog, values);
+		if (ret != SR_OK) {
+			g_free(values);
+			return ret;
+		}
+		if (buff->encoding.is_float) {
+			conv = (uint8_t *)values;
+		} else {
+			if (!buff->requantized)
+				sr_warn("Encoding of analog channel %zu changed, "
+					"requantizing its samples.", nr);
+			buff->requantized = TRUE;
+			conv = g_try_malloc(analog->num_samples * unitsize);
+			if (conv)
+				analog_quantize(&buff->encoding, values,
+					analog->num_samples, conv);
+			g_free(values);
+			if (!conv)
+				return SR_ERR_MALLOC;
+		}
+		rdptr = conv;
 	}
 
 	/*
 	 * Queue most recently received samples to the local buffer.
 	 * Flush to the ZIP archive when the buffer space is exhausted.
 	 */
-	rdptr = values;
 	send_size = analog->num_samples;
 	while (send_size) {
 		remain = buff->alloc_size - buff->fill_size;
 		if (remain) {
-			wrptr = &buff->samples[buff->fill_size];
 			copy_size = MIN(send_size, remain);
+			memcpy(&buff->samples[buff->fill_size * unitsize],
+				rdptr, copy_size * unitsize);
 			send_size -= copy_size;
 			buff->fill_size += copy_size;
-			memcpy(wrptr, rdptr, copy_size * sizeof(values[0]));
-			rdptr += copy_size;
+			rdptr += copy_size * unitsize;
 			remain -= copy_size;
 		}
 		if (send_size && !remain) {
-			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+			ret = zip_append_analog(o, buff, nr);
 			if (ret != SR_OK) {
-				g_free(values);
+				g_free(conv);
 				return ret;
 			}
-			buff->fill_size = 0;
-			remain = buff->alloc_size - buff->fill_size;
 		}
 	}
-	g_free(values);
+	g_free(conv);
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
+		ret = zip_append_analog(o, buff, nr);
 		if (ret != SR_OK)
 			return ret;
-		buff->fill_size = 0;
 	}
 
 	return SR_OK;
@@ -713,6 +1098,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			outc->zip_created = TRUE;
 		}
 		logic = packet->payload;
+		if (logic->unitsize)
+			outc->logic_samples += logic->length / logic->unitsize;
 		ret = zip_append_queue(o,
 			logic->data, logic->unitsize, logic->length,
 			FALSE);
@@ -738,6 +1125,12 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			meta_timebase_set(o);
+			ret = zip_finish(o);
+			zip_chunks_remove(outc);
+			outc->zip_created = FALSE;
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -746,11 +1139,37 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{ "compression", "Compression", "Compression method for the data (store, deflate, bzip2, xz, zstd)", NULL, NULL },
+	{ "level", "Compression level", "Compression level, 0 selects the method's default", NULL, NULL },
+	{ "encoding", "Logic encoding", "Logic data encoding (raw, rle)", NULL, NULL },
+	{ "analog", "Analog encoding", "Analog data encoding (native, float)", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	GSList *names, *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		names = sr_sessionfile_compression_names();
+		for (l = names; l; l = l->next)
+			options[0].values = g_slist_append(options[0].values,
+				g_variant_ref_sink(g_variant_new_string(l->data)));
+		g_slist_free(names);
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_string("raw"));
+		options[2].values = g_slist_append(options[2].values,
+			g_variant_ref_sink(g_variant_new_string("raw")));
+		options[2].values = g_slist_append(options[2].values,
+			g_variant_ref_sink(g_variant_new_string("rle")));
+		options[3].def = g_variant_ref_sink(g_variant_new_string("native"));
+		options[3].values = g_slist_append(options[3].values,
+			g_variant_ref_sink(g_variant_new_string("native")));
+		options[3].values = g_slist_append(options[3].values,
+			g_variant_ref_sink(g_variant_new_string("float")));
+	}
+
 	return options;
 }
 
@@ -761,8 +1180,22 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* No SR_DF_END seen, still save what was received. */
+	if (outc->zip_created) {
+		if (zip_append_queue(o, NULL, 0, 0, TRUE) == SR_OK
+				&& zip_append_analog_queue(o, NULL, TRUE) == SR_OK)
+			zip_finish(o);
+	}
+	zip_chunks_remove(outc);
+	g_thread_pool_free(outc->pool, FALSE, TRUE);
+	g_cond_clear(&outc->done);
+	g_mutex_clear(&outc->mutex);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	g_free(outc->analog_chunks);
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
+	g_free(outc->compression);
 	g_free(outc->logic_buff.samples);
 	for (idx = 0; idx < outc->analog_ch_count; idx++)
 		g_free(outc->analog_buff[idx].samples);
@@ -65,14 +65,24 @@ struct context {
 	size_t analog_count;
 	gboolean header_done;
 	uint64_t period;
+	/* Session time of the first sample, in timescale units. */
+	gboolean align;
+	uint64_t ts_offset;
 	struct vcd_channel_desc *channels;
 	uint64_t samplerate;
-	GSList *free_list, *used_list;
-	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	/* Queued items, as a min-heap by sample number. */
+	GPtrArray *queue_heap;
+	GHashTable *queue_items;
+	struct vcd_queue_item *queue_curr;
+	/* Released items for reuse. */
+	GPtrArray *queue_pool;
+	size_t alloced, reused;
 	gboolean immediate_write;
 	uint8_t *last_logic;
+	size_t last_logic_size;
+	/* Logic channel descriptions by bit position in the samples. */
+	struct vcd_channel_desc **logic_descs;
+	size_t logic_descs_count;
 };
 
 /*
@@ -177,12 +187,12 @@ static GString *vcd_identifier(size_t idx)
  *   writer and the reader.
  */
 
-static void append_vcd_timestamp(GString *s, double ts, gboolean lf)
+static void append_vcd_timestamp(GString *s, uint64_t ts, gboolean lf)
 {
 
 	g_string_append_c(s, '\n');
 	g_string_append_c(s, '#');
-	g_string_append_printf(s, "%.0f", ts);
+	sr_string_append_u64(s, ts);
 	g_string_append_c(s, lf ? '\n' : ' ');
 }
 
@@ -208,21 +218,21 @@ static int init(struct sr_output *o, GHashTable *options)
 	size_t alloc_size;
 	struct sr_channel *ch;
 	GSList *l;
-	size_t num_enabled, num_logic, num_analog, desc_idx;
+	size_t num_enabled, num_logic, num_analog, desc_idx, num_bits;
 	struct vcd_channel_desc *desc;
 
-	(void)options;
-
 	/* Determine the number of involved channels. */
 	num_enabled = 0;
 	num_logic = 0;
 	num_analog = 0;
+	num_bits = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (!ch->enabled)
 			continue;
 		if (ch->type == SR_CHANNEL_LOGIC) {
 			num_logic++;
+			num_bits = MAX(num_bits, (size_t)ch->index + 1);
 		} else if (ch->type == SR_CHANNEL_ANALOG) {
 			num_analog++;
 		} else {
@@ -243,6 +253,12 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->analog_count = num_analog;
 	alloc_size = sizeof(ctx->channels[0]) * ctx->enabled_count;
 	ctx->channels = g_malloc0(alloc_size);
+	ctx->queue_heap = g_ptr_array_new();
+	ctx->queue_items = g_hash_table_new(g_int64_hash, g_int64_equal);
+	ctx->queue_pool = g_ptr_array_new();
+	ctx->logic_descs_count = num_bits;
+	ctx->logic_descs = g_malloc0(sizeof(ctx->logic_descs[0]) * num_bits);
+	ctx->align = g_variant_get_boolean(g_hash_table_lookup(options, "align"));
 
 	/*
 	 * Reiterate input descriptions, to fill in output descriptions.
@@ -264,6 +280,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		if (desc->type == SR_CHANNEL_LOGIC && num_logic) {
 			num_logic--;
 			desc->last.logic = ~0;
+			ctx->logic_descs[desc->index] = desc;
 		} else if (desc->type == SR_CHANNEL_ANALOG && num_analog) {
 			num_analog--;
 			/* "Construct" NaN, avoid a compile time error. */
@@ -287,17 +304,6 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (ctx->logic_count == 0 && ctx->analog_count == 1)
 		ctx->immediate_write = TRUE;
 
-	/*
-	 * Keep a copy of the last logic data bitmap around. To avoid
-	 * iterating over individual bits when nothing in the set has
-	 * changed. The overhead of two byte array compares should
-	 * outweight the tenfold bit count compared to byte counts.
-	 */
-	alloc_size = (ctx->logic_count + 7) / 8;
-	ctx->last_logic = g_malloc0(alloc_size);
-	if (ctx->logic_count && !ctx->last_logic)
-		return SR_ERR_MALLOC;
-
 	return SR_OK;
 }
 
@@ -333,13 +339,38 @@ static uint64_t get_timescale_freq(uint64_t samplerate)
 	return timescale;
 }
 
+/*
+ * Determine the device's start in session time, in timescale units.
+ * Files of several devices of a session then share the time axis.
+ */
+static void get_ts_offset(const struct sr_output *o)
+{
+	struct context *ctx;
+	int64_t ns;
+	uint64_t ns_per_ts;
+
+	ctx = o->priv;
+
+	ctx->ts_offset = 0;
+	if (!o->sdi->session || sr_session_sample_time(o->sdi->session,
+			o->sdi, 0, &ns) != SR_OK || ns <= 0)
+		return;
+
+	/* The timescale is a decade, either a multiple or a divisor of 1GHz. */
+	if (ctx->period >= SR_GHZ(1)) {
+		ctx->ts_offset = (uint64_t)ns * (ctx->period / SR_GHZ(1));
+	} else {
+		ns_per_ts = SR_GHZ(1) / ctx->period;
+		ctx->ts_offset = ((uint64_t)ns + ns_per_ts / 2) / ns_per_ts;
+	}
+}
+
 /* Emit a VCD file header. */
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
 	GSList *l;
 	time_t t;
 	size_t num_channels, i;
@@ -368,10 +399,11 @@ static GString *gen_header(const struct sr_output *o)
 	if (ctx->samplerate)
 		samplerate_s = sr_samplerate_string(ctx->samplerate);
 	frequency_s = sr_period_string(1, ctx->period);
+	if (ctx->align)
+		get_ts_offset(o);
 
 	/* Construct the VCD output file header. */
-	header = g_string_sized_new(512);
-	g_string_printf(header, "$date %s $end\n", timestamp);
+	g_string_append_printf(header, "$date %s $end\n", timestamp);
 	g_string_append_printf(header, "$version %s %s $end\n",
 		PACKAGE_NAME, sr_package_version_string_get());
 	g_string_append_printf(header, "$comment\n");
@@ -379,6 +411,10 @@ static GString *gen_header(const struct sr_output *o)
 		"  Acquisition with %zu/%zu channels%s%s\n",
 		ctx->enabled_count, num_channels,
 		samplerate_s ? " at " : "", samplerate_s ? : "");
+	if (ctx->ts_offset)
+		g_string_append_printf(header,
+			"  Aligned to session time, starts at #%" PRIu64 "\n",
+			ctx->ts_offset);
 	g_string_append_printf(header, "$end\n");
 	g_string_append_printf(header, "$timescale %s $end\n", frequency_s);
 
@@ -410,31 +446,24 @@ static GString *gen_header(const struct sr_output *o)
 	g_free(timestamp);
 	g_free(samplerate_s);
 	g_free(frequency_s);
-
-	return header;
 }
 
 /*
- * Gets called when a session feed packet was received. Either creates
- * a VCD file header (once in the output module's lifetime), or an empty
- * GString. Callers will append the text representation of sample data
+ * Gets called when a session feed packet was received. Appends the
+ * VCD file header (once in the output module's lifetime) to the
+ * output. Callers will append the text representation of sample data
  * to that string as needed.
  */
-static GString *chk_header(const struct sr_output *o)
+static void chk_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
-	GString *s;
 
 	ctx = o->priv;
 
 	if (!ctx->header_done) {
 		ctx->header_done = TRUE;
-		s = gen_header(o);
-	} else {
-		s = g_string_sized_new(512);
+		gen_header(o, out);
 	}
-
-	return s;
 }
 
 /*
@@ -447,311 +476,131 @@ static GString *chk_header(const struct sr_output *o)
 
 static struct vcd_queue_item *queue_alloc_item(struct context *ctx, uint64_t snum)
 {
-	GSList *node;
 	struct vcd_queue_item *item;
 
-	/* Get an item from the free list if available. */
-	node = ctx->free_list;
-	if (node) {
+	/* Get an item from the pool if available. */
+	if (ctx->queue_pool->len) {
 		ctx->reused++;
-
-		/* Unlink GSList node from the free list. */
-		ctx->free_list = node->next;
-		node->next = NULL;
-		item = node->data;
-		node->data = NULL;
-
-		/* Setup content of the item. */
-		item->samplenum = snum;
-		if (!item->values)
-			item->values = g_string_sized_new(32);
-		else
-			g_string_truncate(item->values, 0);
-
-		/* Keep GSList node in the used list (avoid free/alloc). */
-		node->next = ctx->used_list;
-		ctx->used_list = node;
-
-		return item;
+		item = g_ptr_array_remove_index_fast(ctx->queue_pool,
+			ctx->queue_pool->len - 1);
+		g_string_truncate(item->values, 0);
+	} else {
+		ctx->alloced++;
+		item = g_malloc0(sizeof(*item));
+		item->values = g_string_sized_new(32);
 	}
-
-	/* Dynamic allocation of an item. */
-	ctx->alloced++;
-	item = g_malloc0(sizeof(*item));
-	if (!item)
-		return NULL;
 	item->samplenum = snum;
-	item->values = g_string_sized_new(32);
-
-	/* Create a used list item, to later move to the free list. */
-	ctx->used_list = g_slist_prepend(ctx->used_list, item);
 
 	return item;
 }
 
-static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
+static void queue_free_item(gpointer data, gpointer cb_data)
 {
-	GSList *node;
-
-	/*
-	 * Put item back into the free list. We can assume to find a
-	 * used list node, it got allocated when the item was acquired.
-	 */
-	node = ctx->used_list;
-	if (node) {
-		ctx->pooled++;
-
-		ctx->used_list = node->next;
-		node->next = NULL;
-		node->data = item;
-
-		item->samplenum = 0;
-		g_string_truncate(item->values, 0);
-
-		node->next = ctx->free_list;
-		ctx->free_list = node;
+	struct vcd_queue_item *item;
 
-		return;
-	}
+	(void)cb_data;
 
-	/*
-	 * Release dynamically allocated resources. Could also be used
-	 * to release free list items when the use list is empty.
-	 */
-	ctx->freed++;
-	if (item->values)
-		g_string_free(item->values, TRUE);
+	item = data;
+	g_string_free(item->values, TRUE);
 	g_free(item);
 }
 
-static void queue_drain_pool_cb(gpointer data, gpointer cb_data)
+static void queue_drain_pool(struct context *ctx)
+{
+	g_ptr_array_foreach(ctx->queue_heap, queue_free_item, NULL);
+	g_ptr_array_set_size(ctx->queue_heap, 0);
+	g_hash_table_remove_all(ctx->queue_items);
+	ctx->queue_curr = NULL;
+	g_ptr_array_foreach(ctx->queue_pool, queue_free_item, NULL);
+	g_ptr_array_set_size(ctx->queue_pool, 0);
+}
+
+static uint64_t queue_heap_snum(struct context *ctx, size_t idx)
 {
-	struct context *ctx;
 	struct vcd_queue_item *item;
 
-	item = data;
-	ctx = cb_data;
-	queue_free_item(ctx, item);
+	item = g_ptr_array_index(ctx->queue_heap, idx);
+
+	return item->samplenum;
 }
 
-static void queue_drain_pool(struct context *ctx)
+static void queue_heap_swap(struct context *ctx, size_t a, size_t b)
 {
-	GSList *list;
+	gpointer tmp;
 
-	/*
-	 * Grab the list and "empty" the context member. Then
-	 * iterate over the items, have dymamic memory released.
-	 * Then free the GSList nodes (but not their data parts).
-	 * Do this for the used and the free lists.
-	 */
-	list = ctx->used_list;
-	ctx->used_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-
-	list = ctx->free_list;
-	ctx->free_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
+	tmp = ctx->queue_heap->pdata[a];
+	ctx->queue_heap->pdata[a] = ctx->queue_heap->pdata[b];
+	ctx->queue_heap->pdata[b] = tmp;
 }
 
-static int cmp_snum(gconstpointer l, gconstpointer d)
+static void queue_heap_push(struct context *ctx, struct vcd_queue_item *item)
 {
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
+	size_t idx, parent;
+
+	g_ptr_array_add(ctx->queue_heap, item);
+	idx = ctx->queue_heap->len - 1;
+	while (idx) {
+		parent = (idx - 1) / 2;
+		if (queue_heap_snum(ctx, parent) <= item->samplenum)
+			break;
+		queue_heap_swap(ctx, idx, parent);
+		idx = parent;
+	}
 }
 
-static int cmp_items(gconstpointer a, gconstpointer b)
+static struct vcd_queue_item *queue_heap_pop(struct context *ctx)
 {
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	struct vcd_queue_item *item;
+	size_t idx, child, len;
+
+	item = g_ptr_array_index(ctx->queue_heap, 0);
+	len = ctx->queue_heap->len - 1;
+	ctx->queue_heap->pdata[0] = ctx->queue_heap->pdata[len];
+	g_ptr_array_set_size(ctx->queue_heap, len);
+	idx = 0;
+	while ((child = 2 * idx + 1) < len) {
+		if (child + 1 < len && queue_heap_snum(ctx, child + 1)
+				< queue_heap_snum(ctx, child))
+			child++;
+		if (queue_heap_snum(ctx, idx) <= queue_heap_snum(ctx, child))
+			break;
+		queue_heap_swap(ctx, idx, child);
+		idx = child;
+	}
+
+	return item;
 }
 
 /*
  * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
+ * sample number. Create a new queue item when needed.
  *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
- * cases (logic only, one analog channel only) this queue is bypassed.
+ * Items are kept in a min-heap by sample number, which allows to emit
+ * them in order, and are found by sample number in a hash table. This
+ * keeps the cost per sample number constant (lookup) or logarithmic
+ * (insert) regardless of how analog and logic channels interleave.
+ * For trivial cases (logic only, one analog channel only) this queue
+ * is bypassed.
  */
 static int queue_samplenum(struct context *ctx, uint64_t snum)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
+	struct vcd_queue_item *item;
 
 	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
+	item = ctx->queue_curr;
 	if (item && item->samplenum == snum)
 		return SR_OK;
 
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
-			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
-	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
-		return SR_OK;
+	item = g_hash_table_lookup(ctx->queue_items, &snum);
+	if (!item) {
+		if (with_queue_stats)
+			sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
+		item = queue_alloc_item(ctx, snum);
+		queue_heap_push(ctx, item);
+		g_hash_table_insert(ctx->queue_items, &item->samplenum, item);
 	}
+	ctx->queue_curr = item;
 
-	/*
-	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
-	 */
-	if (with_queue_stats)
-		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
-		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
 	return SR_OK;
 }
 
@@ -766,16 +615,10 @@ static GString *queue_value_text_prep(struct context *ctx)
 	GString *buff;
 
 	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
+	item = ctx->queue_curr;
 	if (!item)
 		return NULL;
-
-	/* Create a GString if not done already. */
 	buff = item->values;
-	if (!buff) {
-		buff = g_string_sized_new(20);
-		item->values = buff;
-	}
 
 	/* Separate items with spaces (if previous content is present). */
 	if (buff->len)
@@ -784,15 +627,27 @@ static GString *queue_value_text_prep(struct context *ctx)
 	return buff;
 }
 
-static double snum_to_ts(struct context *ctx, uint64_t snum)
+/*
+ * Convert a sample number to a timestamp in timescale units, which
+ * includes the session time offset when aligning. Uses integer math
+ * to not lose precision in long captures. The timescale usually is a
+ * multiple of the samplerate, otherwise round to the nearest unit like
+ * the former floating point calculation did.
+ */
+static uint64_t snum_to_ts(struct context *ctx, uint64_t snum)
 {
-	double ts;
-
-	ts = (double)snum;
-	ts /= ctx->samplerate;
-	ts *= ctx->period;
-
-	return ts;
+	uint64_t rate, mult, rem;
+
+	rate = ctx->samplerate;
+	if (!rate)
+		return ctx->ts_offset + snum;
+	mult = ctx->period / rate;
+	rem = ctx->period % rate;
+	if (!rem)
+		return ctx->ts_offset + snum * mult;
+
+	return ctx->ts_offset + snum * mult + snum / rate * rem
+		+ ((snum % rate) * rem + rate / 2) / rate;
 }
 
 /*
@@ -802,7 +657,7 @@ static double snum_to_ts(struct context *ctx, uint64_t snum)
 static int unqueue_item(struct context *ctx,
 	struct vcd_queue_item *item, GString *s)
 {
-	double ts;
+	uint64_t ts;
 	GString *buff;
 	gboolean is_empty;
 
@@ -934,10 +789,8 @@ static uint64_t get_max_snum_flush(struct context *ctx)
 static int write_completed_changes(struct context *ctx, GString *out)
 {
 	uint64_t upto_snum;
-	GList **listref, *node;
 	struct vcd_queue_item *item;
 	int rc;
-	size_t dumped;
 
 	/* Determine the number which all data was received for so far. */
 	upto_snum = get_max_snum_export(ctx);
@@ -945,33 +798,27 @@ static int write_completed_changes(struct context *ctx, GString *out)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
 	/*
-	 * Forward and consume those items from the head of the list
+	 * Forward and consume those items from the top of the heap
 	 * which we completely have accumulated and are certain about.
 	 */
-	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
+	while (ctx->queue_heap->len) {
 		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
-		if (item->samplenum >= upto_snum)
+		if (queue_heap_snum(ctx, 0) >= upto_snum)
 			break;
 
 		/*
-		 * Unlink the item from the list. Void cached positions.
-		 * Append its timestamp and values to the caller's text.
+		 * Unqueue the item. Void cached positions. Append its
+		 * timestamp and values to the caller's text.
 		 */
-		dumped++;
+		item = queue_heap_pop(ctx);
 		if (with_queue_stats)
 			sr_dbg("%s(), dump nr %" PRIu64,
 				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
+		g_hash_table_remove(ctx->queue_items, &item->samplenum);
+		if (ctx->queue_curr == item)
+			ctx->queue_curr = NULL;
 		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
+		g_ptr_array_add(ctx->queue_pool, item);
 		if (rc != SR_OK)
 			return rc;
 	}
@@ -980,28 +827,107 @@ static int write_completed_changes(struct context *ctx, GString *out)
 }
 
 /* Get packets from the session feed, generate output text. */
+/* Get the previous logic sample's image, sized for the given unit size. */
+static uint8_t *logic_last_prep(struct context *ctx, size_t unit_size)
+{
+	if (unit_size > ctx->last_logic_size) {
+		ctx->last_logic = g_realloc(ctx->last_logic, unit_size);
+		memset(ctx->last_logic + ctx->last_logic_size, 0,
+			unit_size - ctx->last_logic_size);
+		ctx->last_logic_size = unit_size;
+	}
+
+	return ctx->last_logic;
+}
+
+/*
+ * Emit (or queue) the value changes of one logic sample against the
+ * previous sample. The very first sample has all its values emitted.
+ */
+static void logic_sample_changes(struct context *ctx, GString *out,
+	const uint8_t *sample, size_t unit_size, uint64_t snum_curr)
+{
+	struct vcd_channel_desc *desc;
+	uint8_t *last_logic, curbit, changed_bits;
+	size_t index, p;
+	GString *s_val;
+	uint64_t ts;
+	int bit;
+
+	last_logic = ctx->last_logic;
+
+	/*
+	 * Start or continue tracking that sample number.
+	 * Avoid string copies for logic-only setups.
+	 */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(out, ts, FALSE);
+	} else {
+		queue_samplenum(ctx, snum_curr);
+	}
+
+	/*
+	 * Only visit the channels whose bits have changed.
+	 * Bit positions in the data image are taken to be
+	 * channel indices.
+	 */
+	for (p = 0; p < unit_size; p++) {
+		changed_bits = sample[p] ^ last_logic[p];
+		if (!snum_curr)
+			changed_bits = 0xff;
+		while (changed_bits) {
+			bit = g_bit_nth_lsf(changed_bits, -1);
+			changed_bits &= changed_bits - 1;
+			index = p * 8 + bit;
+			if (index >= ctx->logic_descs_count)
+				break;
+			desc = ctx->logic_descs[index];
+			if (!desc)
+				continue;
+			curbit = (sample[p] >> bit) & 1;
+			desc->last.logic = curbit;
+
+			/*
+			 * Queue, or immediately emit the text
+			 * for the observed value change.
+			 */
+			if (ctx->immediate_write) {
+				g_string_append_c(out, ' ');
+				s_val = out;
+			} else {
+				s_val = queue_value_text_prep(ctx);
+				if (!s_val)
+					break;
+			}
+			format_vcd_value_bit(s_val, curbit, desc->name);
+		}
+	}
+	memcpy(last_logic, sample, unit_size);
+}
+
 static int receive(const struct sr_output *o,
-	const struct sr_datafeed_packet *packet, GString **out)
+	const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_runs *runs;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	uint8_t *sample, *last_logic;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
-	double ts;
+	uint64_t ts;
 
-	*out = NULL;
 	if (!o || !o->priv)
 		return SR_ERR_BUG;
 	ctx = o->priv;
@@ -1017,82 +943,69 @@ static int receive(const struct sr_output *o,
 		}
 		break;
 	case SR_DF_LOGIC:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		logic = packet->payload;
 		sample = logic->data;
 		unit_size = logic->unitsize;
+		if (!unit_size)
+			break;
 		count = logic->length / unit_size;
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
 
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
+		last_logic = logic_last_prep(ctx, unit_size);
+		while (count) {
 			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
+			 * Skip to the next change, the very first sample
+			 * always has all its values emitted.
 			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
+			if (snum_curr) {
+				index = sr_output_logic_find_change(sample, count,
+					unit_size, last_logic);
+				snum_curr += index;
+				sample += index * unit_size;
+				count -= index;
+				if (!count)
+					break;
 			}
+			logic_sample_changes(ctx, out, sample, unit_size,
+				snum_curr);
 
 			/* Advance to next set of logic samples. */
 			snum_curr++;
 			sample += unit_size;
+			count--;
+		}
+		write_completed_changes(ctx, out);
+		break;
+	case SR_DF_LOGIC_RUNS:
+		chk_header(o, out);
+
+		/* Only the first sample of each run can be a change. */
+		runs = packet->payload;
+		sample = runs->data;
+		unit_size = runs->unitsize;
+		if (!unit_size)
+			break;
+		snum_curr = get_last_snum_logic(ctx);
+		last_logic = logic_last_prep(ctx, unit_size);
+		for (run = 0; run < runs->num_runs; run++) {
+			if (!runs->lengths[run]) {
+				sample += unit_size;
+				continue;
+			}
+			if (!snum_curr || memcmp(sample, last_logic, unit_size))
+				logic_sample_changes(ctx, out, sample,
+					unit_size, snum_curr);
+			snum_curr += runs->lengths[run];
+			sample += unit_size;
 		}
-		write_completed_changes(ctx, *out);
+		upd_last_snum_logic(ctx, snum_curr - get_last_snum_logic(ctx));
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_ANALOG:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		/*
 		 * This implementation expects one analog packet per
@@ -1150,8 +1063,8 @@ static int receive(const struct sr_output *o,
 			/* Queue, or emit the timestamp and the new value. */
 			if (ctx->immediate_write) {
 				ts = snum_to_ts(ctx, snum_curr + index);
-				append_vcd_timestamp(*out, ts, FALSE);
-				s_val = *out;
+				append_vcd_timestamp(out, ts, FALSE);
+				s_val = out;
 			} else {
 				queue_samplenum(ctx, snum_curr + index);
 				s_val = queue_value_text_prep(ctx);
@@ -1160,15 +1073,15 @@ static int receive(const struct sr_output *o,
 		}
 
 		g_free(floats);
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_END:
-		*out = chk_header(o);
+		chk_header(o, out);
 		/* Push the final timestamp as length indicator. */
 		snum_curr = get_max_snum_flush(ctx);
 		queue_samplenum(ctx, snum_curr);
 		/* Flush previously queued value changes. */
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	}
 
@@ -1186,31 +1099,46 @@ static int cleanup(struct sr_output *o)
 	ctx = o->priv;
 
 	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
+		sr_info("STATS: alloc/reuse %zu/%zu",
+			ctx->alloced, ctx->reused);
 	queue_drain_pool(ctx);
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
+	g_ptr_array_free(ctx->queue_heap, TRUE);
+	g_hash_table_destroy(ctx->queue_items);
+	g_ptr_array_free(ctx->queue_pool, TRUE);
 
 	while (ctx->enabled_count--) {
 		desc = &ctx->channels[ctx->enabled_count];
 		g_string_free(desc->name, TRUE);
 	}
 	g_free(ctx->channels);
+	g_free(ctx->logic_descs);
+	g_free(ctx->last_logic);
 	g_free(ctx);
 
 	return SR_OK;
 }
 
+static struct sr_option options[] = {
+	{ "align", "Align to session time", "Offset timestamps by the device's start in the session, to align files of several devices", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+
+	return options;
+}
+
 struct sr_output_module output_vcd = {
 	.id = "vcd",
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
-	.options = NULL,
+	.flags = SR_OUTPUT_LOGIC_RUNS,
+	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive,
 	.cleanup = cleanup,
 };
@@ -18,17 +18,23 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/wav"
 
-/* Minimum/maximum number of samples per channel to put in a data chunk */
-#define MIN_DATA_CHUNK_SAMPLES 10
+/*
+ * Number of samples per channel to collect before they get written
+ * out in one large block.
+ */
+#define FLUSH_CHUNK_SAMPLES (16 * 1024)
 
 struct out_context {
 	double scale;
+	unsigned int bits;
+	int sample_size;
 	gboolean header_done;
 	uint64_t samplerate;
 	int num_channels;
@@ -37,8 +43,10 @@ struct out_context {
 	int *chanbuf_used;
 	uint8_t **chanbuf;
 	float *fdata;
+	int *chan_idx;
 };
 
+/* Grow the channel buffers to the given size, keep their content. */
 static int realloc_chanbufs(const struct sr_output *o, int size)
 {
 	struct out_context *outc;
@@ -46,41 +54,43 @@ static int realloc_chanbufs(const struct sr_output *o, int size)
 
 	outc = o->priv;
 	for (i = 0; i < outc->num_channels; i++) {
-		if (!(outc->chanbuf[i] = g_try_realloc(outc->chanbuf[i], sizeof(float) * size))) {
+		if (!(outc->chanbuf[i] = g_try_realloc(outc->chanbuf[i], outc->sample_size * size))) {
 			sr_err("Unable to allocate enough output buffer memory.");
 			return SR_ERR;
 		}
-		outc->chanbuf_used[i] = 0;
 	}
 	outc->chanbuf_size = size;
 
 	return SR_OK;
 }
 
+/* Interleave the channel buffers' samples, straight into the output. */
 static int flush_chanbufs(const struct sr_output *o, GString *out)
 {
 	struct out_context *outc;
-	int num_samples, i, j;
-	char *buf, *bufp;
+	int num_samples, sample_size, stride, i, j;
+	size_t len;
+	uint8_t *dst;
+	const uint8_t *src;
 
 	outc = o->priv;
 
 	/* Any one of them will do. */
 	num_samples = outc->chanbuf_used[0];
-	if (!(buf = g_try_malloc(4 * num_samples * outc->num_channels))) {
-		sr_err("Unable to allocate enough interleaved output buffer memory.");
-		return SR_ERR;
-	}
-
-	bufp = buf;
-	for (i = 0; i < num_samples; i++) {
-		for (j = 0; j < outc->num_channels; j++) {
-			memcpy(bufp, outc->chanbuf[j] + i * 4, 4);
-			bufp += 4;
+	sample_size = outc->sample_size;
+	stride = sample_size * outc->num_channels;
+	len = out->len;
+	g_string_set_size(out, len + (size_t)stride * num_samples);
+
+	for (j = 0; j < outc->num_channels; j++) {
+		dst = (uint8_t *)out->str + len + j * sample_size;
+		src = outc->chanbuf[j];
+		for (i = 0; i < num_samples; i++) {
+			memcpy(dst, src, sample_size);
+			dst += stride;
+			src += sample_size;
 		}
 	}
-	g_string_append_len(out, buf, 4 * num_samples * outc->num_channels);
-	g_free(buf);
 
 	for (i = 0; i < outc->num_channels; i++)
 		outc->chanbuf_used[i] = 0;
@@ -93,10 +103,19 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct out_context *outc;
 	struct sr_channel *ch;
 	GSList *l;
+	unsigned int bits;
+
+	bits = g_variant_get_uint32(g_hash_table_lookup(options, "bits"));
+	if (bits != 16 && bits != 32) {
+		sr_err("Unsupported sample size %u, use 16 or 32 bits.", bits);
+		return SR_ERR_ARG;
+	}
 
 	outc = g_malloc0(sizeof(struct out_context));
 	o->priv = outc;
 	outc->scale = g_variant_get_double(g_hash_table_lookup(options, "scale"));
+	outc->bits = bits;
+	outc->sample_size = bits / 8;
 
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -110,6 +129,7 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	outc->chanbuf = g_malloc0(sizeof(float *) * outc->num_channels);
 	outc->chanbuf_used = g_malloc0(sizeof(int) * outc->num_channels);
+	outc->chan_idx = g_malloc0(sizeof(int) * outc->num_channels);
 
 	/* Start off the interleaved buffer with 100 samples/channel. */
 	realloc_chanbufs(o, 100);
@@ -127,8 +147,8 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Remaining chunk size */
 	WL32(tmp, 0x12);
 	g_string_append_len(gs, tmp, 4);
-	/* Format code 3 = IEEE float */
-	WL16(tmp, 0x0003);
+	/* Format code 3 = IEEE float, 1 = PCM */
+	WL16(tmp, outc->bits == 32 ? 0x0003 : 0x0001);
 	g_string_append_len(gs, tmp, 2);
 	/* Number of channels */
 	WL16(tmp, outc->num_channels);
@@ -136,14 +156,14 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Samplerate */
 	WL32(tmp, outc->samplerate);
 	g_string_append_len(gs, tmp, 4);
-	/* Byterate, using 32-bit floats. */
-	WL32(tmp, outc->samplerate * outc->num_channels * 4);
+	/* Byterate */
+	WL32(tmp, outc->samplerate * outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 4);
 	/* Blockalign */
-	WL16(tmp, outc->num_channels * 4);
+	WL16(tmp, outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 2);
 	/* Bits per sample */
-	WL16(tmp, 32);
+	WL16(tmp, outc->bits);
 	g_string_append_len(gs, tmp, 2);
 	WL16(tmp, 0);
 	g_string_append_len(gs, tmp, 2);
@@ -154,11 +174,10 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	g_string_append_len(gs, tmp, 4);
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *header)
 {
 	struct out_context *outc;
 	GVariant *gvar;
-	GString *header;
 	char tmp[4];
 
 	outc = o->priv;
@@ -170,36 +189,45 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
 	g_string_append(header, "RIFF");
 	/* Total size. Max out the field. */
 	WL32(tmp, 0xffffffff);
 	g_string_append_len(header, tmp, 4);
 	g_string_append(header, "WAVE");
 	add_data_chunk(o, header);
-
-	return header;
 }
 
 /*
- * Stores the float in little-endian BINARY32 IEEE-754 2008 format.
+ * Encode one channel's samples of a packet, in little endian BINARY32
+ * IEEE-754 2008 format, or as 16-bit PCM which clips to the [-1, 1]
+ * range. Works on a whole block of samples at a time, which the
+ * compiler can vectorize.
  */
-static void float_to_le(uint8_t *buf, float value)
+static void encode_samples(const struct out_context *outc, uint8_t *buf,
+	const float *data, size_t stride, size_t count)
 {
-	uint8_t *old;
-
-	old = (uint8_t *)&value;
-#ifdef WORDS_BIGENDIAN
-	buf[0] = old[3];
-	buf[1] = old[2];
-	buf[2] = old[1];
-	buf[3] = old[0];
-#else
-	buf[0] = old[0];
-	buf[1] = old[1];
-	buf[2] = old[2];
-	buf[3] = old[3];
-#endif
+	float f, mult;
+	uint32_t u;
+	int16_t v;
+	size_t i;
+
+	mult = 1.0 / outc->scale;
+	if (outc->bits == 16) {
+		for (i = 0; i < count; i++) {
+			f = data[i * stride] * mult;
+			f = CLAMP(f, -1.0f, 1.0f);
+			v = (int16_t)lrintf(f * INT16_MAX);
+			WL16(buf, v);
+			buf += sizeof(v);
+		}
+		return;
+	}
+	for (i = 0; i < count; i++) {
+		f = data[i * stride] * mult;
+		memcpy(&u, &f, sizeof(u));
+		WL32(buf, u);
+		buf += sizeof(u);
+	}
 }
 
 /*
@@ -234,7 +262,7 @@ static int check_chanbuf_size(const struct sr_output *o)
 }
 
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+		GString *out)
 {
 	struct out_context *outc;
 	const struct sr_datafeed_meta *meta;
@@ -243,12 +271,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	struct sr_channel *ch;
 	GSList *l;
 	const GSList *channels;
-	float f;
-	int num_channels, num_samples, size, *chan_idx, idx, i, j, ret;
+	int num_channels, num_samples, size, idx, i, ret;
 	float *data;
-	uint8_t *buf;
 
-	*out = NULL;
 	if (!o || !o->sdi || !(outc = o->priv))
 		return SR_ERR_ARG;
 
@@ -264,10 +289,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_ANALOG:
 		if (!outc->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			outc->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		analog = packet->payload;
@@ -290,40 +313,40 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			return SR_ERR;
 		}
 
-		if (num_samples > outc->chanbuf_size) {
-			if (realloc_chanbufs(o, analog->num_samples) != SR_OK)
+		/* Index the channels in this packet, so we can interleave quicker. */
+		size = 0;
+		for (i = 0, l = (GSList *)channels; l; l = l->next, i++) {
+			ch = l->data;
+			idx = g_slist_index(outc->channels, ch);
+			if (idx < 0)
+				return SR_ERR;
+			outc->chan_idx[i] = idx;
+			size = MAX(size, outc->chanbuf_used[idx] + num_samples);
+		}
+		if (size > outc->chanbuf_size) {
+			if (realloc_chanbufs(o, MAX(size, 2 * outc->chanbuf_size)) != SR_OK)
 				return SR_ERR_MALLOC;
 		}
 
-		/* Index the channels in this packet, so we can interleave quicker. */
-		chan_idx = g_malloc(sizeof(int) * outc->num_channels);
+		/* Encode blocks of samples, one channel at a time. */
 		for (i = 0; i < num_channels; i++) {
-			ch = g_slist_nth_data((GSList *) channels, i);
-			chan_idx[i] = g_slist_index(outc->channels, ch);
+			idx = outc->chan_idx[i];
+			encode_samples(outc, outc->chanbuf[idx]
+				+ outc->chanbuf_used[idx] * outc->sample_size,
+				data + i, num_channels, num_samples);
+			outc->chanbuf_used[idx] += num_samples;
 		}
 
-		for (i = 0; i < num_samples; i++) {
-			for (j = 0; j < num_channels; j++) {
-				idx = chan_idx[j];
-				buf = outc->chanbuf[idx] + outc->chanbuf_used[idx]++ * 4;
-				f = data[i * num_channels + j];
-				if (outc->scale != 1.0)
-					f /= outc->scale;
-				float_to_le(buf, f);
-			}
-		}
-		g_free(chan_idx);
-
+		/* Write large chunks once all channels are complete. */
 		size = check_chanbuf_size(o);
-		if (size > MIN_DATA_CHUNK_SAMPLES)
-			if (flush_chanbufs(o, *out) != SR_OK)
+		if (size >= FLUSH_CHUNK_SAMPLES)
+			if (flush_chanbufs(o, out) != SR_OK)
 				return SR_ERR;
 		break;
 	case SR_DF_END:
 		size = check_chanbuf_size(o);
 		if (size > 0) {
-			*out = g_string_sized_new(4 * size * outc->num_channels);
-			if (flush_chanbufs(o, *out) != SR_OK)
+			if (flush_chanbufs(o, out) != SR_OK)
 				return SR_ERR;
 		}
 		break;
@@ -334,13 +357,16 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 static struct sr_option options[] = {
 	{ "scale", "Scale", "Scale values by factor", NULL, NULL },
+	{ "bits", "Bits", "Bits per sample, 32 for float or 16 for PCM", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
-	if (!options[0].def)
+	if (!options[0].def) {
 		options[0].def = g_variant_ref_sink(g_variant_new_double(1.0));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(32));
+	}
 
 	return options;
 }
@@ -352,12 +378,12 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 	g_slist_free(outc->channels);
-	g_variant_unref(options[0].def);
 	for (i = 0; i < outc->num_channels; i++)
 		g_free(outc->chanbuf[i]);
 	g_free(outc->chanbuf_used);
 	g_free(outc->chanbuf);
 	g_free(outc->fdata);
+	g_free(outc->chan_idx);
 	g_free(outc);
 	o->priv = NULL;
 
@@ -372,6 +398,6 @@ SR_PRIV struct sr_output_module output_wav = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_append = receive,
 	.cleanup = cleanup,
 };
@@ -27,36 +27,77 @@
 struct context {
 	uint32_t channel_count;
 	struct sr_channel **channels;
-	GString **channel_outputs; /* output strings */
+	/* Run lengths of each channel's values, the first run is low. */
+	GArray **channel_runs;
+	int *channel_index;
+	size_t num_enabled;
+	uint8_t *prev_sample;
+	size_t unitsize;
+	gboolean have_prev;
+	/* Decimated output of the whole capture, when columns are limited. */
+	struct sr_logic_columns *decimate;
 };
 
+static void render_runs(GString *output, const GArray *runs)
+{
+	uint64_t run;
+	size_t i;
+
+	for (i = 0; i < runs->len; i++) {
+		run = g_array_index(runs, uint64_t, i);
+		if (!run)
+			continue;
+		/* Data point, then repetitions. */
+		g_string_append_c(output, (i & 1) ? '1' : '0');
+		while (--run)
+			g_string_append_c(output, '.');
+	}
+}
+
+/* Toggling columns are shown as undefined, 'x'. */
+static void render_columns(GString *output, const struct sr_logic_columns *lc,
+	size_t idx)
+{
+	const uint8_t *col;
+	size_t count, i;
+	char last_char, curr_char;
+
+	col = lc->columns + idx * lc->max_columns;
+	count = sr_logic_columns_count(lc);
+	last_char = 0;
+	for (i = 0; i < count; i++) {
+		if (col[i] & SR_LOGIC_COLUMN_TOGGLED)
+			curr_char = 'x';
+		else
+			curr_char = (col[i] & SR_LOGIC_COLUMN_LAST) ? '1' : '0';
+		if (curr_char == last_char && curr_char != 'x') {
+			g_string_append_c(output, '.');
+		} else {
+			g_string_append_c(output, curr_char);
+			last_char = curr_char;
+		}
+	}
+}
+
 /* Converts accumulated output data to a JSON string. */
 static GString *wavedrom_render(const struct context *ctx)
 {
 	GString *output;
-	size_t ch, i;
-	char last_char, curr_char;
+	size_t ch, idx;
 
 	output = g_string_new("{ \"signal\": [");
-	for (ch = 0; ch < ctx->channel_count; ch++) {
-		if (!ctx->channel_outputs[ch])
+	for (ch = 0, idx = 0; ch < ctx->channel_count; ch++) {
+		if (!ctx->channel_runs[ch])
 			continue;
 
 		/* Channel strip. */
 		g_string_append_printf(output,
 			"{ \"name\": \"%s\", \"wave\": \"", ctx->channels[ch]->name);
-
-		last_char = 0;
-		for (i = 0; i < ctx->channel_outputs[ch]->len; i++) {
-			curr_char = ctx->channel_outputs[ch]->str[i];
-			/* Data point. */
-			if (curr_char == last_char) {
-				g_string_append_c(output, '.');
-			} else {
-				g_string_append_c(output, curr_char);
-				last_char = curr_char;
-			}
-		}
+		if (ctx->decimate)
+			render_columns(output, ctx->decimate, idx);
+		else
+			render_runs(output, ctx->channel_runs[ch]);
+		idx++;
 		if (ch < ctx->channel_count - 1) {
 			g_string_append(output, "\" },");
 		} else {
@@ -69,52 +110,64 @@ static GString *wavedrom_render(const struct context *ctx)
 	return output;
 }
 
-static void process_logic(const struct context *ctx,
+static void process_logic(struct context *ctx,
 	const struct sr_datafeed_logic *logic)
 {
-	size_t sample_count, ch, i;
-	uint8_t *sample, bit;
-	GString *accu;
+	size_t sample_count, unitsize, ch, i, j;
+	const uint8_t *sample;
+	uint64_t *run;
+	GArray *runs;
+	int bit;
 
-	if (!ctx->channel_count)
+	if (!ctx->num_enabled || !logic->unitsize)
 		return;
 
+	sample_count = logic->length / logic->unitsize;
+	if (ctx->decimate) {
+		sr_logic_columns_add(ctx->decimate, ctx->channel_index,
+			logic->data, logic->unitsize, sample_count);
+		return;
+	}
+
 	/*
-	 * Extract the logic bits for each channel and store them
-	 * as wavedrom letters (1/0) in each channel's text string.
-	 * This transforms the input which consists of sample sets
-	 * that span multiple channels into output stripes per logic
-	 * channel which consist of bits for that individual channel.
-	 *
-	 * TODO Reduce memory consumption during accumulation of
-	 * output data.
-	 *
-	 * Ideally we'd accumulate binary chunks, and defer conversion
-	 * to the text format. Analog data already won't get here, only
-	 * logic data does. When the per-channel transformation also
-	 * gets deferred until later, then the only overhead would be
-	 * for disabled logic channels. Which may be acceptable or even
-	 * negligable.
-	 *
-	 * An optional addition to the above mentioned accumulation of
-	 * binary data is RLE compression. Mark both the position in the
-	 * accumulated data as well as a repetition counter, instead of
-	 * repeatedly storing the same sample set. The efficiency of
-	 * this approach of course depends on the change rate of input
-	 * data. But the approach perfectly matches the WaveDrom syntax
-	 * for repeated bit patterns, and thus is easily handled in the
-	 * text rendering stage of the output module.
+	 * Accumulate run lengths rather than characters per sample, so
+	 * memory use is in the order of the number of edges. The text
+	 * only gets generated at the end of the capture. Runs of equal
+	 * samples are skipped quickly, then only the channels of
+	 * changing samples get inspected.
 	 */
-	sample_count = logic->length / logic->unitsize;
-	for (i = 0; i < sample_count; i++) {
-		sample = logic->data + i * logic->unitsize;
+	unitsize = MIN(logic->unitsize, ctx->unitsize);
+	sample = logic->data;
+	i = 0;
+	while (i < sample_count) {
+		if (ctx->have_prev && logic->unitsize == ctx->unitsize) {
+			j = sr_output_logic_find_change(sample, sample_count - i,
+				logic->unitsize, ctx->prev_sample);
+			for (ch = 0; ch < ctx->channel_count; ch++) {
+				if (!(runs = ctx->channel_runs[ch]))
+					continue;
+				g_array_index(runs, uint64_t, runs->len - 1) += j;
+			}
+			i += j;
+			sample += j * logic->unitsize;
+			if (i == sample_count)
+				break;
+		}
 		for (ch = 0; ch < ctx->channel_count; ch++) {
-			accu = ctx->channel_outputs[ch];
-			if (!accu)
+			if (!(runs = ctx->channel_runs[ch]))
 				continue;
-			bit = sample[ch / 8] & (1 << (ch % 8));
-			g_string_append_c(accu, bit ? '1' : '0');
+			bit = ch / 8 < unitsize && (sample[ch / 8] & (1 << (ch % 8)));
+			/* Odd runs are high, even runs are low. */
+			if (((runs->len - 1) & 1) != (size_t)bit)
+				g_array_set_size(runs, runs->len + 1);
+			run = &g_array_index(runs, uint64_t, runs->len - 1);
+			(*run)++;
 		}
+		memset(ctx->prev_sample, 0, ctx->unitsize);
+		memcpy(ctx->prev_sample, sample, unitsize);
+		ctx->have_prev = TRUE;
+		sample += logic->unitsize;
+		i++;
 	}
 }
 
@@ -147,9 +200,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct context *ctx;
 	struct sr_channel *channel;
 	GSList *l;
-	size_t i;
-
-	(void)options;
+	size_t i, logic_channels;
+	uint32_t columns;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -159,16 +211,30 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_count = g_slist_length(o->sdi->channels);
 	ctx->channels = g_malloc0(
 		sizeof(ctx->channels[0]) * ctx->channel_count);
-	ctx->channel_outputs = g_malloc0(
-		sizeof(ctx->channel_outputs[0]) * ctx->channel_count);
+	ctx->channel_runs = g_malloc0(
+		sizeof(ctx->channel_runs[0]) * ctx->channel_count);
+	ctx->channel_index = g_malloc0(
+		sizeof(ctx->channel_index[0]) * (ctx->channel_count + 1));
 
+	logic_channels = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
 		channel = l->data;
+		if (channel->type == SR_CHANNEL_LOGIC)
+			logic_channels++;
 		if (channel->enabled && channel->type == SR_CHANNEL_LOGIC) {
 			ctx->channels[i] = channel;
-			ctx->channel_outputs[i] = g_string_new(NULL);
+			/* Starts with an empty low run. */
+			ctx->channel_runs[i] = g_array_new(FALSE, TRUE, sizeof(uint64_t));
+			g_array_set_size(ctx->channel_runs[i], 1);
+			ctx->channel_index[ctx->num_enabled++] = i;
 		}
 	}
+	ctx->unitsize = (logic_channels + 7) / 8;
+	ctx->prev_sample = g_malloc0(ctx->unitsize + 1);
+
+	columns = g_variant_get_uint32(g_hash_table_lookup(options, "columns"));
+	if (columns)
+		ctx->decimate = sr_logic_columns_new(ctx->num_enabled, columns);
 
 	return SR_OK;
 }
@@ -176,7 +242,7 @@ static int init(struct sr_output *o, GHashTable *options)
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	GString *s;
+	size_t i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -185,26 +251,41 @@ static int cleanup(struct sr_output *o)
 	o->priv = NULL;
 
 	if (ctx) {
-		while (--ctx->channel_count) {
-			s = ctx->channel_outputs[ctx->channel_count];
-			if (s)
-				g_string_free(s, TRUE);
+		for (i = 0; i < ctx->channel_count; i++) {
+			if (ctx->channel_runs[i])
+				g_array_free(ctx->channel_runs[i], TRUE);
 		}
-		g_free(ctx->channel_outputs);
+		g_free(ctx->channel_runs);
+		g_free(ctx->channel_index);
 		g_free(ctx->channels);
+		g_free(ctx->prev_sample);
+		sr_logic_columns_free(ctx->decimate);
 		g_free(ctx);
 	}
 
 	return SR_OK;
 }
 
+static struct sr_option options[] = {
+	{ "columns", "Columns", "Render the whole capture in at most this many columns, 0 for all samples", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(0));
+
+	return options;
+}
+
 SR_PRIV struct sr_output_module output_wavedrom = {
 	.id = "wavedrom",
 	.name = "WaveDrom",
 	.desc = "WaveDrom.com file format",
 	.exts = (const char *[]){"wavedrom", "json", NULL},
 	.flags = 0,
-	.options = NULL,
+	.options = get_options,
 	.init = init,
 	.receive = receive,
 	.cleanup = cleanup,
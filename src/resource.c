@@ -20,6 +20,7 @@
 #include <config.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -35,6 +36,25 @@
  * Access to resource files.
  */
 
+/*
+ * Resources are read through the context's hooks only once, and then
+ * served from memory. Drivers re-open firmware and FPGA bitstreams on
+ * every device open, and some of them on configuration changes.
+ */
+struct resource_cache_entry {
+	GBytes *data;
+	char *checksum;
+};
+
+/* The handle of an open resource: a read position in its cached data. */
+struct resource_cursor {
+	GBytes *data;
+	size_t offset;
+};
+
+/* Guards the context's resource cache and upload records. */
+G_LOCK_DEFINE_STATIC(resource_cache);
+
 /**
  * Get a list of paths where we look for resource (e.g. firmware) files.
  *
@@ -283,12 +303,122 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_err("%s: inconsistent callback pointers.", __func__);
 		return SR_ERR_ARG;
 	}
+
+	/* Resources may come out differently with the new hooks. */
+	G_LOCK(resource_cache);
+	if (ctx->resource_cache)
+		g_hash_table_remove_all(ctx->resource_cache);
+	G_UNLOCK(resource_cache);
+
 	return SR_OK;
 }
 
+static void cache_entry_free(struct resource_cache_entry *entry)
+{
+	g_bytes_unref(entry->data);
+	g_free(entry->checksum);
+	g_free(entry);
+}
+
+/* Read the complete resource through the context's hooks. */
+static struct resource_cache_entry *resource_read_hooks(struct sr_context *ctx,
+		int type, const char *name)
+{
+	struct resource_cache_entry *entry;
+	struct sr_resource res;
+	uint8_t *buf;
+	size_t size;
+	gssize n_read;
+
+	res.size = 0;
+	res.handle = NULL;
+	res.type = type;
+	if ((*ctx->resource_open_cb)(&res, name, ctx->resource_cb_data) != SR_OK)
+		return NULL;
+
+	size = res.size;
+	buf = g_try_malloc(size ? size : 1);
+	if (!buf) {
+		sr_err("Failed to allocate buffer for '%s'.", name);
+		(*ctx->resource_close_cb)(&res, ctx->resource_cb_data);
+		return NULL;
+	}
+	n_read = (*ctx->resource_read_cb)(&res, buf, size,
+			ctx->resource_cb_data);
+	if ((*ctx->resource_close_cb)(&res, ctx->resource_cb_data) != SR_OK)
+		sr_err("Failed to close resource.");
+	if (n_read < 0 || (size_t)n_read != size) {
+		if (n_read >= 0)
+			sr_err("Failed to read '%s': premature end of file.",
+				name);
+		g_free(buf);
+		return NULL;
+	}
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+			buf, size);
+	entry->data = g_bytes_new_take(buf, size);
+
+	return entry;
+}
+
+/*
+ * Get a resource's cache entry, reading it first when needed. Returns
+ * a reference to the data, and optionally a copy of the checksum.
+ */
+static GBytes *resource_get(struct sr_context *ctx, int type,
+		const char *name, char **checksum)
+{
+	struct resource_cache_entry *entry, *new_entry;
+	char *key;
+	GBytes *data;
+
+	key = g_strdup_printf("%d/%s", type, name);
+	new_entry = NULL;
+	data = NULL;
+	while (!data) {
+		G_LOCK(resource_cache);
+		if (!ctx->resource_cache) {
+			ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+				g_str_equal, g_free,
+				(GDestroyNotify)cache_entry_free);
+		}
+		entry = g_hash_table_lookup(ctx->resource_cache, key);
+		if (!entry && new_entry) {
+			g_hash_table_insert(ctx->resource_cache, g_strdup(key),
+				new_entry);
+			entry = new_entry;
+			new_entry = NULL;
+		}
+		if (entry) {
+			data = g_bytes_ref(entry->data);
+			if (checksum)
+				*checksum = g_strdup(entry->checksum);
+		}
+		G_UNLOCK(resource_cache);
+		if (data)
+			break;
+
+		/* Not holding the lock, the hooks may take a while. */
+		new_entry = resource_read_hooks(ctx, type, name);
+		if (!new_entry)
+			break;
+	}
+	/* Another thread got to read the resource first. */
+	if (new_entry)
+		cache_entry_free(new_entry);
+	g_free(key);
+
+	return data;
+}
+
 /**
  * Open resource.
  *
+ * The resource is read through the context's hooks on its first use,
+ * later opens are served from memory.
+ *
  * @param ctx libsigrok context. Must not be NULL.
  * @param[out] res Resource descriptor to fill in. Must not be NULL.
  * @param type Resource type ID.
@@ -303,19 +433,26 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 SR_PRIV int sr_resource_open(struct sr_context *ctx,
 		struct sr_resource *res, int type, const char *name)
 {
-	int ret;
+	struct resource_cursor *cursor;
+	GBytes *data;
 
 	res->size = 0;
 	res->handle = NULL;
 	res->type = type;
 
-	ret = (*ctx->resource_open_cb)(res, name, ctx->resource_cb_data);
-
-	if (ret != SR_OK)
+	data = resource_get(ctx, type, name, NULL);
+	if (!data) {
 		sr_err("Failed to open resource '%s' (use loglevel 5/spew for"
 		       " details).", name);
+		return SR_ERR;
+	}
+
+	cursor = g_malloc0(sizeof(*cursor));
+	cursor->data = data;
+	res->size = g_bytes_get_size(data);
+	res->handle = cursor;
 
-	return ret;
+	return SR_OK;
 }
 
 /**
@@ -332,14 +469,20 @@ SR_PRIV int sr_resource_open(struct sr_context *ctx,
  */
 SR_PRIV int sr_resource_close(struct sr_context *ctx, struct sr_resource *res)
 {
-	int ret;
+	struct resource_cursor *cursor;
 
-	ret = (*ctx->resource_close_cb)(res, ctx->resource_cb_data);
+	(void)ctx;
 
-	if (ret != SR_OK)
-		sr_err("Failed to close resource.");
+	cursor = res->handle;
+	if (!cursor) {
+		sr_err("%s: invalid handle.", __func__);
+		return SR_ERR_ARG;
+	}
+	g_bytes_unref(cursor->data);
+	g_free(cursor);
+	res->handle = NULL;
 
-	return ret;
+	return SR_OK;
 }
 
 /**
@@ -359,14 +502,28 @@ SR_PRIV int sr_resource_close(struct sr_context *ctx, struct sr_resource *res)
 SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 		const struct sr_resource *res, void *buf, size_t count)
 {
-	gssize n_read;
+	struct resource_cursor *cursor;
+	const uint8_t *data;
+	size_t size;
 
-	n_read = (*ctx->resource_read_cb)(res, buf, count,
-			ctx->resource_cb_data);
-	if (n_read < 0)
-		sr_err("Failed to read resource.");
+	(void)ctx;
 
-	return n_read;
+	cursor = res->handle;
+	if (!cursor) {
+		sr_err("%s: invalid handle.", __func__);
+		return SR_ERR_ARG;
+	}
+	if (count > G_MAXSSIZE) {
+		sr_err("%s: count %zu too large.", __func__, count);
+		return SR_ERR_ARG;
+	}
+
+	data = g_bytes_get_data(cursor->data, &size);
+	count = MIN(count, size - cursor->offset);
+	memcpy(buf, data + cursor->offset, count);
+	cursor->offset += count;
+
+	return count;
 }
 
 /**
@@ -386,40 +543,125 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 		int type, const char *name, size_t *size, size_t max_size)
 {
-	struct sr_resource res;
+	GBytes *data;
+	const void *src;
 	void *buf;
 	size_t res_size;
-	gssize n_read;
 
-	if (sr_resource_open(ctx, &res, type, name) != SR_OK)
+	data = resource_get(ctx, type, name, NULL);
+	if (!data) {
+		sr_err("Failed to open resource '%s' (use loglevel 5/spew for"
+		       " details).", name);
 		return NULL;
+	}
+	src = g_bytes_get_data(data, &res_size);
 
-	if (res.size > max_size) {
-		sr_err("Size %" PRIu64 " of '%s' exceeds limit %zu.",
-			res.size, name, max_size);
-		sr_resource_close(ctx, &res);
+	if (res_size > max_size) {
+		sr_err("Size %zu of '%s' exceeds limit %zu.",
+			res_size, name, max_size);
+		g_bytes_unref(data);
 		return NULL;
 	}
-	res_size = res.size;
 
-	buf = g_try_malloc(res_size);
+	/* Callers modify the buffer, hand out a copy of the cached data. */
+	buf = g_try_malloc(res_size ? res_size : 1);
 	if (!buf) {
 		sr_err("Failed to allocate buffer for '%s'.", name);
-		sr_resource_close(ctx, &res);
+		g_bytes_unref(data);
 		return NULL;
 	}
+	memcpy(buf, src, res_size);
+	g_bytes_unref(data);
 
-	n_read = sr_resource_read(ctx, &res, buf, res_size);
-	sr_resource_close(ctx, &res);
+	*size = res_size;
+	return buf;
+}
 
-	if (n_read < 0 || (size_t)n_read != res_size) {
-		if (n_read >= 0)
-			sr_err("Failed to read '%s': premature end of file.",
-				name);
-		g_free(buf);
-		return NULL;
+/**
+ * Check whether a device already runs a resource (e.g. an FPGA bitstream).
+ *
+ * Drivers can use this to skip uploads on re-open, which may otherwise
+ * take seconds. This only compares against what was recorded with
+ * sr_resource_upload_done() for the device, including the resource's
+ * content. Whenever the device can tell, drivers should still check it
+ * is operational and upload again if not.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param device Identifies the physical device and its current attachment,
+ *               e.g. "usb/<bus>.<address>". Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @return TRUE if the same content was last uploaded to the device.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_resource_upload_matches(struct sr_context *ctx,
+		const char *device, int type, const char *name)
+{
+	GBytes *data;
+	const char *uploaded;
+	char *checksum;
+	gboolean match;
+
+	G_LOCK(resource_cache);
+	uploaded = NULL;
+	if (ctx->resource_uploads)
+		uploaded = g_hash_table_lookup(ctx->resource_uploads, device);
+	G_UNLOCK(resource_cache);
+	if (!uploaded)
+		return FALSE;
+
+	data = resource_get(ctx, type, name, &checksum);
+	if (!data)
+		return FALSE;
+	g_bytes_unref(data);
+
+	G_LOCK(resource_cache);
+	uploaded = g_hash_table_lookup(ctx->resource_uploads, device);
+	match = uploaded && !strcmp(uploaded, checksum);
+	G_UNLOCK(resource_cache);
+	g_free(checksum);
+
+	return match;
+}
+
+/**
+ * Record which resource a device runs, see sr_resource_upload_matches().
+ *
+ * Drivers should call this with a NULL name before starting an upload,
+ * and with the resource's name once the upload succeeded.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param device Identifies the physical device and its current attachment.
+ *               Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource, or NULL to forget about the device.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_upload_done(struct sr_context *ctx,
+		const char *device, int type, const char *name)
+{
+	GBytes *data;
+	char *checksum;
+
+	checksum = NULL;
+	if (name) {
+		data = resource_get(ctx, type, name, &checksum);
+		if (data)
+			g_bytes_unref(data);
 	}
 
-	*size = res_size;
-	return buf;
+	G_LOCK(resource_cache);
+	if (!ctx->resource_uploads) {
+		ctx->resource_uploads = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, g_free);
+	}
+	if (checksum)
+		g_hash_table_replace(ctx->resource_uploads, g_strdup(device),
+			checksum);
+	else
+		g_hash_table_remove(ctx->resource_uploads, device);
+	G_UNLOCK(resource_cache);
 }
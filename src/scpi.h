@@ -87,6 +87,22 @@ struct sr_scpi_hw_info {
 	char *firmware_version;
 };
 
+/**
+ * Callback for chunks of a definite length block's payload.
+ *
+ * @param data The chunk's data.
+ * @param length The chunk's length.
+ * @param offset The chunk's position within the payload.
+ * @param total The payload's length as announced by the block header.
+ * @param cb_data Opaque data, as passed to sr_scpi_get_block_stream().
+ *
+ * @return SR_OK to continue, other values abort the read.
+ */
+typedef int (*sr_scpi_block_callback)(const uint8_t *data, size_t length,
+		size_t offset, size_t total, void *cb_data);
+
+struct sr_scpi_pipeline;
+
 struct sr_scpi_dev_inst {
 	const char *name;
 	const char *prefix;
@@ -103,17 +119,24 @@ struct sr_scpi_dev_inst {
 	int (*send)(void *priv, const char *command);
 	int (*read_begin)(void *priv);
 	int (*read_data)(void *priv, char *buf, int maxlen);
+	int (*read_ready)(void *priv);
 	int (*write_data)(void *priv, char *buf, int len);
 	int (*read_complete)(void *priv);
 	int (*close)(struct sr_scpi_dev_inst *scpi);
 	void (*free)(void *priv);
 	unsigned int read_timeout_us;
 	void *priv;
+	/* Monotonic time [us] of the most recent data reception. */
+	int64_t rx_time;
 	/* Only used for quirk workarounds, notably the Rigol DS1000 series. */
 	uint64_t firmware_version;
 	GMutex scpi_mutex;
 	char *actual_channel_name;
 	gboolean no_opc_command;
+	/* Response cache, see scpi_cache.c. */
+	struct sr_context *ctx;
+	char *cache_key;
+	const char *const *cache_commands;
 };
 
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
@@ -134,6 +157,9 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 		const char *format, va_list args);
 SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen);
+SR_PRIV gboolean sr_scpi_read_ready(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_read_data_nonblocking(struct sr_scpi_dev_inst *scpi,
+		char *buf, int maxlen);
 SR_PRIV int sr_scpi_write_data(struct sr_scpi_dev_inst *scpi, char *buf, int len);
 SR_PRIV int sr_scpi_read_complete(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi);
@@ -160,10 +186,41 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+			const char *command, uint8_t *buf, size_t size,
+			size_t *length);
+SR_PRIV int sr_scpi_get_block_stream(struct sr_scpi_dev_inst *scpi,
+			const char *command, size_t chunk_size,
+			sr_scpi_block_callback cb, void *cb_data, size_t *length);
+SR_PRIV struct sr_scpi_pipeline *sr_scpi_pipeline_new(
+			struct sr_scpi_dev_inst *scpi);
+SR_PRIV void sr_scpi_pipeline_free(struct sr_scpi_pipeline *pl);
+SR_PRIV size_t sr_scpi_pipeline_query(struct sr_scpi_pipeline *pl,
+			const char *command);
+SR_PRIV int sr_scpi_pipeline_run(struct sr_scpi_pipeline *pl);
+SR_PRIV const char *sr_scpi_pipeline_response(struct sr_scpi_pipeline *pl,
+			size_t index);
+SR_PRIV int sr_scpi_pipeline_get_bool(struct sr_scpi_pipeline *pl,
+			size_t index, gboolean *value);
+SR_PRIV int sr_scpi_pipeline_get_int(struct sr_scpi_pipeline *pl,
+			size_t index, int *value);
+SR_PRIV int sr_scpi_pipeline_get_float(struct sr_scpi_pipeline *pl,
+			size_t index, float *value);
+SR_PRIV int sr_scpi_pipeline_get_double(struct sr_scpi_pipeline *pl,
+			size_t index, double *value);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
 
+SR_PRIV void sr_scpi_cache_key_set(struct sr_scpi_dev_inst *scpi,
+		const struct sr_scpi_hw_info *hw_info);
+SR_PRIV void sr_scpi_cache_commands(struct sr_scpi_dev_inst *scpi,
+		const char *const *commands);
+SR_PRIV char *sr_scpi_cache_lookup(struct sr_scpi_dev_inst *scpi,
+		const char *command);
+SR_PRIV void sr_scpi_cache_store(struct sr_scpi_dev_inst *scpi,
+		const char *command, const char *response);
+
 SR_PRIV const char *sr_scpi_unquote_string(char *s);
 
 SR_PRIV const char *sr_vendor_alias(const char *raw_vendor);
@@ -19,7 +19,9 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -78,6 +80,21 @@ static int parse_strict_bool(const char *str, gboolean *ret)
 	return SR_ERR;
 }
 
+/* Parse an integer response, which may come in a rational's form. */
+static int parse_int(const char *str, int *ret)
+{
+	struct sr_rational ret_rational;
+
+	if (sr_parse_rational(str, &ret_rational) == SR_OK
+			&& (ret_rational.p % ret_rational.q) == 0) {
+		*ret = ret_rational.p / ret_rational.q;
+		return SR_OK;
+	}
+	sr_dbg("get_int: non-integer response '%s'", str);
+
+	return SR_ERR_DATA;
+}
+
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_serial_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_raw_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_rigol_dev;
@@ -218,7 +235,13 @@ static int scpi_write_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
  */
 static int scpi_read_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
 {
-	return scpi->read_data(scpi->priv, buf, maxlen);
+	int ret;
+
+	ret = scpi->read_data(scpi->priv, buf, maxlen);
+	if (ret > 0)
+		scpi->rx_time = g_get_monotonic_time();
+
+	return ret;
 }
 
 /**
@@ -237,7 +260,7 @@ static int scpi_read_response(struct sr_scpi_dev_inst *scpi,
 	int len, space;
 
 	space = response->allocated_len - response->len;
-	len = scpi->read_data(scpi->priv, &response->str[response->len], space);
+	len = scpi_read_data(scpi, &response->str[response->len], space);
 
 	if (len < 0) {
 		sr_err("Incompletely read SCPI response.");
@@ -311,13 +334,106 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	return SR_OK;
 }
 
+/* Resources which sr_scpi_scan() probes concurrently. */
+#define SCAN_THREADS 8
+/* Probes which have not started this long after the scan get skipped. */
+#define SCAN_DEADLINE_US (30 * G_USEC_PER_SEC)
+
+struct scan_context {
+	struct drv_context *drvc;
+	struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi);
+	gint64 deadline;
+};
+
+struct scan_job {
+	char *resource;
+	char *conn;
+	char *comm;
+	struct sr_dev_inst *sdi;
+};
+
+static void scan_job_run(gpointer data, gpointer user_data)
+{
+	struct scan_job *job;
+	struct scan_context *scan;
+
+	job = data;
+	scan = user_data;
+
+	if (g_get_monotonic_time() > scan->deadline) {
+		sr_warn("Scan deadline passed, skipping %s.", job->conn);
+		return;
+	}
+	job->sdi = sr_scpi_scan_resource(scan->drvc, job->conn, job->comm,
+		scan->probe_device);
+}
+
+/*
+ * Probe the resources, on several threads when there are many of
+ * them. Each resource has its own SCPI instance, so the probes don't
+ * interfere. Found devices are returned in the resources' order, not
+ * in the order their probes completed.
+ */
+static GSList *scan_resources(struct scan_context *scan, GPtrArray *jobs)
+{
+	struct scan_job *job;
+	GThreadPool *pool;
+	GError *error;
+	GSList *devices;
+	guint i;
+
+	pool = NULL;
+	if (jobs->len > 1) {
+		error = NULL;
+		pool = g_thread_pool_new(scan_job_run, scan,
+			MIN(jobs->len, SCAN_THREADS), TRUE, &error);
+		if (!pool) {
+			sr_warn("Cannot create scan threads: %s.", error->message);
+			g_error_free(error);
+		}
+	}
+	for (i = 0; i < jobs->len; i++) {
+		if (pool)
+			g_thread_pool_push(pool, jobs->pdata[i], NULL);
+		else
+			scan_job_run(jobs->pdata[i], scan);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	devices = NULL;
+	for (i = 0; i < jobs->len; i++) {
+		job = jobs->pdata[i];
+		if (job->sdi) {
+			job->sdi->connection_id = g_strdup(job->resource);
+			devices = g_slist_append(devices, job->sdi);
+		}
+	}
+
+	return devices;
+}
+
+static void scan_job_free(gpointer data)
+{
+	struct scan_job *job;
+
+	job = data;
+	g_free(job->resource);
+	g_free(job->conn);
+	g_free(job->comm);
+	g_free(job);
+}
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi))
 {
 	GSList *resources, *l, *devices;
+	GPtrArray *jobs;
+	struct scan_context scan;
+	struct scan_job *job;
 	struct sr_dev_inst *sdi;
-	const char *resource, *conn;
-	const char *serialcomm, *comm;
+	const char *resource;
+	const char *serialcomm;
 	gchar **res;
 	unsigned i;
 
@@ -325,30 +441,34 @@ SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 	serialcomm = NULL;
 	(void)sr_serial_extract_options(options, &resource, &serialcomm);
 
-	devices = NULL;
+	scan.drvc = drvc;
+	scan.probe_device = probe_device;
+	scan.deadline = g_get_monotonic_time() + SCAN_DEADLINE_US;
+
+	/* Serial resources have their serial comm spec after a colon. */
+	jobs = g_ptr_array_new_with_free_func(scan_job_free);
+	resources = NULL;
 	for (i = 0; i < ARRAY_SIZE(scpi_devs); i++) {
 		if (resource && strcmp(resource, scpi_devs[i]->prefix) != 0)
 			continue;
 		if (!scpi_devs[i]->scan)
 			continue;
-		resources = scpi_devs[i]->scan(drvc);
-		for (l = resources; l; l = l->next) {
-			res = g_strsplit(l->data, ":", 2);
-			if (!res[0]) {
-				g_strfreev(res);
-				continue;
-			}
-			conn = res[0];
-			comm = serialcomm ? : res[1];
-			sdi = sr_scpi_scan_resource(drvc, conn, comm, probe_device);
-			if (sdi) {
-				devices = g_slist_append(devices, sdi);
-				sdi->connection_id = g_strdup(l->data);
-			}
-			g_strfreev(res);
+		resources = g_slist_concat(resources, scpi_devs[i]->scan(drvc));
+	}
+	for (l = resources; l; l = l->next) {
+		res = g_strsplit(l->data, ":", 2);
+		if (res[0]) {
+			job = g_malloc0(sizeof(*job));
+			job->resource = g_strdup(l->data);
+			job->conn = g_strdup(res[0]);
+			job->comm = g_strdup(serialcomm ? serialcomm : res[1]);
+			g_ptr_array_add(jobs, job);
 		}
-		g_slist_free_full(resources, g_free);
+		g_strfreev(res);
 	}
+	devices = scan_resources(&scan, jobs);
+	g_ptr_array_free(jobs, TRUE);
+	g_slist_free_full(resources, g_free);
 
 	if (!devices && resource) {
 		sdi = sr_scpi_scan_resource(drvc, resource, serialcomm, probe_device);
@@ -379,6 +499,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
 			*scpi = *scpi_dev;
 			scpi->priv = g_malloc0(scpi->priv_size);
 			scpi->read_timeout_us = 1000 * 1000;
+			scpi->ctx = drvc ? drvc->sr_ctx : NULL;
 			params = g_strsplit(resource, "/", 0);
 			if (scpi->dev_inst_new(scpi->priv, drvc, resource,
 			                       params, serialcomm) != SR_OK) {
@@ -537,6 +658,51 @@ SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/**
+ * Check whether response data can be read without blocking.
+ *
+ * Session callbacks use this to only read what has already arrived, and
+ * to return to the session loop otherwise, so that other sources get
+ * served while a device is still sending. Transports which cannot tell
+ * (or whose reads don't block anyway) are always considered ready.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ *
+ * @return TRUE if a read would not block, FALSE otherwise.
+ */
+SR_PRIV gboolean sr_scpi_read_ready(struct sr_scpi_dev_inst *scpi)
+{
+	if (!scpi->read_ready)
+		return TRUE;
+
+	return scpi->read_ready(scpi->priv) != 0;
+}
+
+/**
+ * Read part of a response from SCPI device, if data is available.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store result.
+ * @param maxlen Maximum number of bytes to read.
+ *
+ * @return Number of bytes read (0 when no data was available yet),
+ *         or SR_ERR upon failure.
+ */
+SR_PRIV int sr_scpi_read_data_nonblocking(struct sr_scpi_dev_inst *scpi,
+			char *buf, int maxlen)
+{
+	int ret;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	if (scpi->read_ready && !scpi->read_ready(scpi->priv))
+		ret = 0;
+	else
+		ret = scpi_read_data(scpi, buf, maxlen);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
 /**
  * Send data to SCPI device.
  *
@@ -606,6 +772,7 @@ SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 	scpi->free(scpi->priv);
 	g_free(scpi->priv);
 	g_free(scpi->actual_channel_name);
+	g_free(scpi->cache_key);
 	g_free(scpi);
 }
 
@@ -628,6 +795,9 @@ SR_PRIV int sr_scpi_get_string(struct sr_scpi_dev_inst *scpi,
 
 	*scpi_response = NULL;
 
+	if (command && (*scpi_response = sr_scpi_cache_lookup(scpi, command)))
+		return SR_OK;
+
 	response = g_string_sized_new(1024);
 	if (sr_scpi_get_data(scpi, command, &response) != SR_OK) {
 		if (response)
@@ -647,6 +817,8 @@ SR_PRIV int sr_scpi_get_string(struct sr_scpi_dev_inst *scpi,
 		response->str, response->len);
 
 	*scpi_response = g_string_free(response, FALSE);
+	if (command)
+		sr_scpi_cache_store(scpi, command, *scpi_response);
 
 	return SR_OK;
 }
@@ -731,7 +903,6 @@ SR_PRIV int sr_scpi_get_int(struct sr_scpi_dev_inst *scpi,
 			    const char *command, int *scpi_response)
 {
 	int ret;
-	struct sr_rational ret_rational;
 	char *response;
 
 	response = NULL;
@@ -740,14 +911,7 @@ SR_PRIV int sr_scpi_get_int(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	ret = sr_parse_rational(response, &ret_rational);
-	if (ret == SR_OK && (ret_rational.p % ret_rational.q) == 0) {
-		*scpi_response = ret_rational.p / ret_rational.q;
-	} else {
-		sr_dbg("get_int: non-integer rational=%" PRId64 "/%" PRIu64,
-			ret_rational.p, ret_rational.q);
-		ret = SR_ERR_DATA;
-	}
+	ret = parse_int(response, scpi_response);
 
 	g_free(response);
 
@@ -842,6 +1006,22 @@ SR_PRIV int sr_scpi_get_opc(struct sr_scpi_dev_inst *scpi)
 	return SR_ERR;
 }
 
+/* Number of items in a separated list, an empty text has none. */
+static size_t count_items(const char *str, char separator)
+{
+	const char *p, *end;
+	size_t count;
+
+	end = str + strlen(str);
+	if (str == end)
+		return 0;
+	count = 1;
+	for (p = str; (p = memchr(p, separator, end - p)); p++)
+		count++;
+
+	return count;
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as comma separated list of
  * floats and store the as an result in scpi_response.
@@ -860,10 +1040,8 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
 	int ret;
-	float tmp;
 	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	size_t count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -873,23 +1051,16 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
-	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(float), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atof_ascii(*ptr, &tmp);
-		if (ret != SR_OK) {
-			ret = SR_ERR_DATA;
-			break;
-		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
-	}
-	g_strfreev(tokens);
+	/* Size the array once, then convert the values right into it. */
+	count = count_items(response, ',');
+	response_array = g_array_sized_new(TRUE, FALSE, sizeof(float), count);
+	g_array_set_size(response_array, count);
+	ret = sr_atof_ascii_list(response, ',',
+		(float *)(void *)response_array->data,
+		response_array->len, &count);
+	if (ret != SR_OK)
+		ret = SR_ERR_DATA;
+	g_array_set_size(response_array, count);
 	g_free(response);
 
 	if (ret != SR_OK && response_array->len == 0) {
@@ -919,10 +1090,10 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
-	int tmp, ret;
-	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	int ret;
+	long value;
+	char *response, *p, *end;
+	size_t count;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -932,23 +1103,26 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
-	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(uint8_t), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atoi(*ptr, &tmp);
-		if (ret != SR_OK) {
+	count = count_items(response, ',');
+	response_array = g_array_sized_new(TRUE, FALSE, sizeof(uint8_t), count);
+	g_array_set_size(response_array, count);
+
+	/* Single pass, the conversion stops at the separator. */
+	count = 0;
+	p = response;
+	while (*p) {
+		errno = 0;
+		value = strtol(p, &end, 10);
+		if (end == p || errno || (*end && *end != ',')) {
 			ret = SR_ERR_DATA;
 			break;
 		}
-		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
+		response_array->data[count++] = (uint8_t)value;
+		if (!*end)
+			break;
+		p = end + 1;
 	}
-	g_strfreev(tokens);
+	g_array_set_size(response_array, count);
 	g_free(response);
 
 	if (response_array->len == 0) {
@@ -961,63 +1135,50 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
-/**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
- *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
- *
- * @param[in] scpi Previously initialised SCPI device structure.
- * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
- *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+/*
+ * Read exactly 'len' bytes of a response, without mutex. The timeout is
+ * relative to the last received data. Returns the number of bytes read
+ * (less than 'len' upon timeout), or SR_ERR* upon failure.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+static int scpi_read_exact(struct sr_scpi_dev_inst *scpi,
+		uint8_t *buf, size_t len, gint64 *timeout)
 {
+	size_t got;
 	int ret;
-	GString* response;
-	gsize oldlen;
-	char buf[10];
-	long llen;
-	long datalen;
-	gint64 timeout;
 
-	*scpi_response = NULL;
-
-	g_mutex_lock(&scpi->scpi_mutex);
-
-	if (command)
-		if (scpi_send(scpi, command) != SR_OK) {
-			g_mutex_unlock(&scpi->scpi_mutex);
+	got = 0;
+	while (got < len) {
+		ret = scpi_read_data(scpi, (char *)buf + got,
+			MIN(len - got, (size_t)G_MAXINT));
+		if (ret < 0) {
+			sr_err("Incompletely read SCPI response.");
 			return SR_ERR;
 		}
-
-	if (sr_scpi_read_begin(scpi) != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		return SR_ERR;
+		if (ret > 0) {
+			got += ret;
+			*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+			continue;
+		}
+		if (g_get_monotonic_time() > *timeout) {
+			sr_err("Timed out waiting for SCPI response.");
+			break;
+		}
 	}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
-
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+	return got;
+}
 
-	/* Get (the first chunk of) the response. */
-	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
-	} while (response->len < 2);
+/*
+ * Read the header of a definite length block, without mutex. The header
+ * bytes are read exactly, so that the payload is left for the caller to
+ * read into its final location.
+ */
+static int scpi_read_block_header(struct sr_scpi_dev_inst *scpi,
+		size_t *datalen, gint64 *timeout)
+{
+	uint8_t hdr[2 + 9 + 1];
+	long llen, len;
+	int ret;
 
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
@@ -1026,18 +1187,16 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * respective number of characters which specify the data block's
 	 * length. Raw data bytes follow (thus one must no longer assume
 	 * that the received input stream would be an ASCIIZ string).
-	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
 	 */
-	if (response->str[0] != '#') {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	ret = scpi_read_exact(scpi, hdr, 2, timeout);
+	if (ret < 0)
+		return ret;
+	if (ret < 2)
+		return SR_ERR_TIMEOUT;
+	if (hdr[0] != '#' || !g_ascii_isdigit(hdr[1]))
 		return SR_ERR_DATA;
-	}
-	buf[0] = response->str[1];
-	buf[1] = '\0';
-	ret = sr_atol(buf, &llen);
+	llen = hdr[1] - '0';
+
 	/*
 	 * The form "#0..." is legal, and does not mean "empty response",
 	 * but means that the number of data bytes is not known (or was
@@ -1056,74 +1215,497 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE DATA. The latter
 	 * with a leading "#0" length and a trailing "NL^END" marker.
 	 */
-	if (ret == SR_OK && !llen) {
+	if (!llen) {
 		sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
-		ret = SR_ERR_NA;
+		return SR_ERR_NA;
 	}
-	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+
+	ret = scpi_read_exact(scpi, &hdr[2], llen, timeout);
+	if (ret < 0)
 		return ret;
-	}
+	if (ret < llen)
+		return SR_ERR_TIMEOUT;
+	hdr[2 + llen] = '\0';
+	ret = sr_atol((const char *)&hdr[2], &len);
+	if (ret != SR_OK)
+		return ret;
+	if (len < 0)
+		return SR_ERR_DATA;
+	*datalen = len;
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
-	}
+	return SR_OK;
+}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+/*
+ * Read a definite length block, without mutex. The payload goes to the
+ * caller's buffer when one is given (of at least the block's length),
+ * in chunks to the callback when one is given, or else into a newly
+ * allocated buffer of the block's exact length.
+ */
+static int scpi_get_block(struct sr_scpi_dev_inst *scpi, const char *command,
+		uint8_t *buf, size_t size, size_t chunk_size,
+		sr_scpi_block_callback cb, void *cb_data,
+		uint8_t **alloc_buf, size_t *length)
+{
+	uint8_t *dest;
+	size_t datalen, done, count;
+	gint64 timeout;
+	int ret, got;
+
+	*length = 0;
+
+	if (command && scpi_send(scpi, command) != SR_OK)
+		return SR_ERR;
+	if (sr_scpi_read_begin(scpi) != SR_OK)
+		return SR_ERR;
+
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+	ret = scpi_read_block_header(scpi, &datalen, &timeout);
+	if (ret != SR_OK)
 		return ret;
+	if (!datalen)
+		return SR_OK;
+	sr_spew("Reading a block of %zu bytes.", datalen);
+
+	if (cb) {
+		chunk_size = MIN(chunk_size ? chunk_size : 64 * 1024, datalen);
+		dest = g_malloc(chunk_size);
+	} else if (buf) {
+		if (datalen > size) {
+			sr_err("Block of %zu bytes exceeds the buffer's %zu.",
+				datalen, size);
+			return SR_ERR_DATA;
+		}
+		dest = buf;
+		chunk_size = datalen;
+	} else {
+		dest = g_malloc(datalen);
+		*alloc_buf = dest;
+		chunk_size = datalen;
 	}
-	g_string_erase(response, 0, 2 + llen);
 
 	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
+	 * On timeout truncate the block and return the partial response
+	 * instead of getting stuck on timeouts...
 	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
-
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
-
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
+	done = 0;
+	ret = SR_OK;
+	while (done < datalen) {
+		count = MIN(chunk_size, datalen - done);
+		got = scpi_read_exact(scpi, cb ? dest : dest + done,
+			count, &timeout);
+		if (got < 0) {
+			ret = got;
+			break;
+		}
+		if (cb && got > 0) {
+			ret = cb(dest, got, done, datalen, cb_data);
+			if (ret != SR_OK)
 				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
+		}
+		done += got;
+		if ((size_t)got < count)
+			break;
 	}
+	if (cb)
+		g_free(dest);
+	if (ret != SR_OK)
+		return ret;
 
+	*length = done;
+
+	return SR_OK;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * The payload is read into a buffer of the exact size which the header
+ * announced.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	uint8_t *data;
+	size_t length;
+	int ret;
+
+	*scpi_response = NULL;
+	data = NULL;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, NULL, 0, 0, NULL, NULL,
+		&data, &length);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
+	if (ret != SR_OK || !data) {
+		g_free(data);
+		return ret;
+	}
+
 	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	*scpi_response = g_byte_array_new_take(data, length);
 
 	return SR_OK;
 }
 
+/**
+ * Send a SCPI command, and read the "definite length block" reply into
+ * a caller provided buffer.
+ *
+ * The block's header is parsed first, then its payload is read straight
+ * into the buffer, in large transport reads.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] buf The buffer for the payload.
+ * @param[in] size The buffer's size. Blocks which exceed it are an error.
+ * @param[out] length The number of bytes read. Less than announced by
+ *             the header when the device timed out during the payload.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t *buf, size_t size, size_t *length)
+{
+	int ret;
+
+	if (!buf || !length)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, buf, size, 0, NULL, NULL,
+		NULL, length);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
+/**
+ * Send a SCPI command, and pass the "definite length block" reply's
+ * payload to a callback in chunks.
+ *
+ * This lets drivers process (e.g. send analog packets for) the start of
+ * a large waveform while the rest is still coming in.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in] chunk_size Number of bytes per callback (the last chunk can
+ *            be shorter), 0 for a default of 64 KiB.
+ * @param[in] cb The callback. Returning other than SR_OK aborts the read.
+ * @param[in] cb_data Opaque data for the callback.
+ * @param[out] length The number of payload bytes read (can be NULL).
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_get_block_stream(struct sr_scpi_dev_inst *scpi,
+		const char *command, size_t chunk_size,
+		sr_scpi_block_callback cb, void *cb_data, size_t *length)
+{
+	size_t len;
+	int ret;
+
+	if (!cb)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_get_block(scpi, command, NULL, 0, chunk_size, cb, cb_data,
+		NULL, &len);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	if (length)
+		*length = len;
+
+	return ret;
+}
+
+/*
+ * A pipeline collects queries, sends them joined into few messages, and
+ * keeps the responses in order. IEEE 488.2 program messages can hold
+ * several queries separated by ';', which the device answers in a single
+ * response message, its units separated by ';' as well. This saves the
+ * round trip per query, which dominates on LAN and USBTMC connections.
+ *
+ * Within a message, a header after ';' is relative to the previous
+ * header's path, so that queries get joined with ";:" to start at the
+ * root again. Common commands ("*...") are always absolute.
+ *
+ * Devices which don't answer a joined message in the expected way get
+ * the queries one by one, for the rest of the pipeline.
+ */
+
+#define PIPELINE_MAX_QUERIES	16
+#define PIPELINE_MAX_LENGTH	240
+
+struct sr_scpi_pipeline {
+	struct sr_scpi_dev_inst *scpi;
+	GPtrArray *commands;
+	GPtrArray *responses;
+	gboolean no_join;
+};
+
+/**
+ * Create a SCPI query pipeline.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ *
+ * @return The pipeline. Free it with sr_scpi_pipeline_free().
+ */
+SR_PRIV struct sr_scpi_pipeline *sr_scpi_pipeline_new(
+		struct sr_scpi_dev_inst *scpi)
+{
+	struct sr_scpi_pipeline *pl;
+
+	pl = g_malloc0(sizeof(*pl));
+	pl->scpi = scpi;
+	pl->commands = g_ptr_array_new_with_free_func(g_free);
+	pl->responses = g_ptr_array_new_with_free_func(g_free);
+
+	return pl;
+}
+
+/**
+ * Free a SCPI query pipeline, and its responses.
+ *
+ * @param[in] pl The pipeline, can be NULL.
+ */
+SR_PRIV void sr_scpi_pipeline_free(struct sr_scpi_pipeline *pl)
+{
+	if (!pl)
+		return;
+
+	g_ptr_array_free(pl->commands, TRUE);
+	g_ptr_array_free(pl->responses, TRUE);
+	g_free(pl);
+}
+
+/**
+ * Queue a query. Nothing gets sent before sr_scpi_pipeline_run().
+ *
+ * @param[in] pl The pipeline.
+ * @param[in] command The query.
+ *
+ * @return The index of the query's response.
+ */
+SR_PRIV size_t sr_scpi_pipeline_query(struct sr_scpi_pipeline *pl,
+		const char *command)
+{
+	g_ptr_array_add(pl->commands, g_strdup(command));
+
+	return pl->commands->len - 1;
+}
+
+/*
+ * Split a joined response into its units, in place. Separators within
+ * quoted strings don't count. Returns the number of units, more than
+ * max when there are too many.
+ */
+static size_t pipeline_split(char *response, char **units, size_t max)
+{
+	size_t count;
+	char *p, quote;
+
+	count = 0;
+	units[count++] = response;
+	quote = '\0';
+	for (p = response; *p; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = '\0';
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		} else if (*p == ';') {
+			*p = '\0';
+			if (count == max)
+				return max + 1;
+			units[count++] = p + 1;
+		}
+	}
+
+	return count;
+}
+
+/* Send a batch of queries as a single message, FALSE when that failed. */
+static gboolean pipeline_run_joined(struct sr_scpi_pipeline *pl,
+		size_t first, size_t count)
+{
+	GString *message;
+	const char *command;
+	char *response, *units[PIPELINE_MAX_QUERIES];
+	size_t i;
+	int ret;
+
+	message = g_string_sized_new(PIPELINE_MAX_LENGTH);
+	for (i = first; i < first + count; i++) {
+		command = g_ptr_array_index(pl->commands, i);
+		if (i > first)
+			g_string_append(message,
+				(*command == ':' || *command == '*') ? ";" : ";:");
+		g_string_append(message, command);
+	}
+	ret = sr_scpi_get_string(pl->scpi, message->str, &response);
+	g_string_free(message, TRUE);
+	if (ret != SR_OK) {
+		g_free(response);
+		return FALSE;
+	}
+
+	if (pipeline_split(response, units, count) != count) {
+		g_free(response);
+		return FALSE;
+	}
+	for (i = 0; i < count; i++)
+		g_ptr_array_add(pl->responses, g_strdup(units[i]));
+	g_free(response);
+
+	return TRUE;
+}
+
+/**
+ * Send the queued queries, and collect their responses.
+ *
+ * Queries which were queued after a previous run get sent by the next
+ * run, their responses add to the previous ones.
+ *
+ * @param[in] pl The pipeline.
+ *
+ * @return SR_OK when all queries got a response, SR_ERR* otherwise.
+ */
+SR_PRIV int sr_scpi_pipeline_run(struct sr_scpi_pipeline *pl)
+{
+	const char *command;
+	char *response;
+	size_t first, count, length;
+	int ret;
+
+	if (!pl)
+		return SR_ERR_ARG;
+
+	while ((first = pl->responses->len) < pl->commands->len) {
+		/* Batch up as many queries as fit into a message. */
+		count = 0;
+		length = 0;
+		while (!pl->no_join && first + count < pl->commands->len
+				&& count < PIPELINE_MAX_QUERIES) {
+			command = g_ptr_array_index(pl->commands, first + count);
+			length += strlen(command) + 2;
+			if (count && length > PIPELINE_MAX_LENGTH)
+				break;
+			count++;
+		}
+		if (count > 1) {
+			if (pipeline_run_joined(pl, first, count))
+				continue;
+			sr_dbg("No response to joined queries, sending them "
+				"one by one.");
+			pl->no_join = TRUE;
+		}
+
+		command = g_ptr_array_index(pl->commands, first);
+		ret = sr_scpi_get_string(pl->scpi, command, &response);
+		if (ret != SR_OK) {
+			g_free(response);
+			return ret;
+		}
+		g_ptr_array_add(pl->responses, response);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get a query's response text.
+ *
+ * @param[in] pl The pipeline.
+ * @param[in] index The query's index, see sr_scpi_pipeline_query().
+ *
+ * @return The response, or NULL when there's none (yet). It belongs to
+ *         the pipeline.
+ */
+SR_PRIV const char *sr_scpi_pipeline_response(struct sr_scpi_pipeline *pl,
+		size_t index)
+{
+	if (!pl || index >= pl->responses->len)
+		return NULL;
+
+	return g_ptr_array_index(pl->responses, index);
+}
+
+/**
+ * Get a query's response, parsed like sr_scpi_get_bool() does.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_get_bool(struct sr_scpi_pipeline *pl,
+		size_t index, gboolean *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_pipeline_response(pl, index)))
+		return SR_ERR;
+
+	return parse_strict_bool(response, value) == SR_OK ? SR_OK : SR_ERR_DATA;
+}
+
+/**
+ * Get a query's response, parsed like sr_scpi_get_int() does.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_get_int(struct sr_scpi_pipeline *pl,
+		size_t index, int *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_pipeline_response(pl, index)))
+		return SR_ERR;
+
+	return parse_int(response, value);
+}
+
+/**
+ * Get a query's response, parsed like sr_scpi_get_float() does.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_get_float(struct sr_scpi_pipeline *pl,
+		size_t index, float *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_pipeline_response(pl, index)))
+		return SR_ERR;
+
+	return sr_atof_ascii(response, value) == SR_OK ? SR_OK : SR_ERR_DATA;
+}
+
+/**
+ * Get a query's response, parsed like sr_scpi_get_double() does.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_get_double(struct sr_scpi_pipeline *pl,
+		size_t index, double *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_pipeline_response(pl, index)))
+		return SR_ERR;
+
+	return sr_atod_ascii(response, value) == SR_OK ? SR_OK : SR_ERR_DATA;
+}
+
 /**
  * Send the *IDN? SCPI command, receive the reply, parse it and store the
  * reply as a sr_scpi_hw_info structure in the supplied scpi_response pointer.
@@ -1196,6 +1778,8 @@ SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 
 	g_strfreev(tokens);
 
+	sr_scpi_cache_key_set(scpi, hw_info);
+
 	*scpi_response = hw_info;
 
 	return SR_OK;
@@ -0,0 +1,294 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cache of the responses to queries for static instrument properties,
+ * like installed options or channel ranges. Drivers list the queries
+ * which are safe to cache with sr_scpi_cache_commands(). Responses are
+ * kept per instrument, keyed by the manufacturer, model, serial number
+ * and firmware version of its *IDN? response. A firmware update thus
+ * starts over with an empty cache.
+ *
+ * The cache is opt-in, by the SIGROK_SCPI_CACHE environment variable.
+ * The value "1" keeps responses in memory for the lifetime of the
+ * libsigrok context. Other values name a directory which keeps them
+ * across processes, in one file per instrument. Each line of the file
+ * holds a query and its response, escaped and separated by a TAB.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+#define LOG_PREFIX "scpi"
+
+#define CACHE_ENV "SIGROK_SCPI_CACHE"
+#define CACHE_FILE_SUFFIX ".scpicache"
+
+/* Guards the context's cache, instruments may be used in threads. */
+G_LOCK_DEFINE_STATIC(scpi_cache);
+
+/* Whether the cache is enabled, and its directory (NULL for memory). */
+static gboolean cache_enabled(const char **dir)
+{
+	const char *env;
+
+	env = g_getenv(CACHE_ENV);
+	if (!env || !*env || !strcmp(env, "0"))
+		return FALSE;
+	*dir = strcmp(env, "1") ? env : NULL;
+
+	return TRUE;
+}
+
+static char *cache_path(const char *dir, const char *key)
+{
+	char *name, *path, *p;
+
+	name = g_strconcat(key, CACHE_FILE_SUFFIX, NULL);
+	for (p = name; *p; p++) {
+		if (!g_ascii_isalnum(*p) && *p != '.' && *p != '-')
+			*p = '_';
+	}
+	path = g_build_filename(dir, name, NULL);
+	g_free(name);
+
+	return path;
+}
+
+static void cache_load(GHashTable *table, const char *path)
+{
+	char *contents, **lines, **fields;
+	size_t i;
+
+	if (!g_file_get_contents(path, &contents, NULL, NULL))
+		return;
+	lines = g_strsplit(contents, "\n", 0);
+	g_free(contents);
+	for (i = 0; lines[i]; i++) {
+		fields = g_strsplit(lines[i], "\t", 2);
+		if (fields[0] && fields[1]) {
+			g_hash_table_replace(table, g_strcompress(fields[0]),
+				g_strcompress(fields[1]));
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(lines);
+	sr_dbg("Loaded %u cached responses from %s.",
+		g_hash_table_size(table), path);
+}
+
+/* The instrument's responses, with the lock held. */
+static GHashTable *cache_table(struct sr_context *ctx, const char *key,
+		const char *dir)
+{
+	GHashTable *table;
+	char *path;
+
+	if (!ctx->scpi_cache) {
+		ctx->scpi_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)g_hash_table_destroy);
+	}
+	table = g_hash_table_lookup(ctx->scpi_cache, key);
+	if (table)
+		return table;
+
+	table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_insert(ctx->scpi_cache, g_strdup(key), table);
+	if (dir) {
+		path = cache_path(dir, key);
+		cache_load(table, path);
+		g_free(path);
+	}
+
+	return table;
+}
+
+static gboolean command_cacheable(const struct sr_scpi_dev_inst *scpi,
+		const char *command)
+{
+	const char *const *c;
+
+	if (!scpi->ctx || !scpi->cache_key || !scpi->cache_commands)
+		return FALSE;
+	for (c = scpi->cache_commands; *c; c++) {
+		if (!strcmp(*c, command))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Derive the instrument's cache key from its *IDN? response.
+ *
+ * Instruments without a serial number are not cached, since they
+ * could not be told apart.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param hw_info The instrument's parsed *IDN? response.
+ */
+SR_PRIV void sr_scpi_cache_key_set(struct sr_scpi_dev_inst *scpi,
+		const struct sr_scpi_hw_info *hw_info)
+{
+	const char *dir;
+
+	g_free(scpi->cache_key);
+	scpi->cache_key = NULL;
+
+	if (!cache_enabled(&dir))
+		return;
+	if (!hw_info->serial_number || !strcmp(hw_info->serial_number, "Unknown"))
+		return;
+
+	scpi->cache_key = g_strdup_printf("%s_%s_%s_%s",
+		hw_info->manufacturer, hw_info->model,
+		hw_info->serial_number,
+		hw_info->firmware_version ? hw_info->firmware_version : "");
+}
+
+/**
+ * Set the queries whose responses are static, and may be cached.
+ *
+ * Only list queries whose response does not depend on the instrument's
+ * state, including earlier commands like channel selections.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param commands NULL terminated list of queries. Must stay valid
+ *                 for the lifetime of the device, like a static array.
+ */
+SR_PRIV void sr_scpi_cache_commands(struct sr_scpi_dev_inst *scpi,
+		const char *const *commands)
+{
+	scpi->cache_commands = commands;
+}
+
+/**
+ * Look up a query's cached response.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The query.
+ *
+ * @return A copy of the response which the caller must g_free(),
+ *         or NULL when it's not cached.
+ */
+SR_PRIV char *sr_scpi_cache_lookup(struct sr_scpi_dev_inst *scpi,
+		const char *command)
+{
+	const char *dir, *response;
+	char *ret;
+
+	if (!command_cacheable(scpi, command) || !cache_enabled(&dir))
+		return NULL;
+
+	G_LOCK(scpi_cache);
+	response = g_hash_table_lookup(cache_table(scpi->ctx,
+		scpi->cache_key, dir), command);
+	ret = g_strdup(response);
+	G_UNLOCK(scpi_cache);
+
+	if (ret)
+		sr_spew("Cached response to '%s': '%.70s'.", command, ret);
+
+	return ret;
+}
+
+/**
+ * Keep a query's response, if the query is cacheable.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The query.
+ * @param response The query's response.
+ */
+SR_PRIV void sr_scpi_cache_store(struct sr_scpi_dev_inst *scpi,
+		const char *command, const char *response)
+{
+	GHashTable *table;
+	const char *dir;
+	char *path, *cmd_esc, *resp_esc;
+	FILE *f;
+
+	if (!command_cacheable(scpi, command) || !cache_enabled(&dir))
+		return;
+
+	G_LOCK(scpi_cache);
+	table = cache_table(scpi->ctx, scpi->cache_key, dir);
+	g_hash_table_replace(table, g_strdup(command), g_strdup(response));
+	if (dir) {
+		g_mkdir_with_parents(dir, 0755);
+		path = cache_path(dir, scpi->cache_key);
+		if ((f = g_fopen(path, "a"))) {
+			cmd_esc = g_strescape(command, NULL);
+			resp_esc = g_strescape(response, NULL);
+			fprintf(f, "%s\t%s\n", cmd_esc, resp_esc);
+			g_free(cmd_esc);
+			g_free(resp_esc);
+			fclose(f);
+		} else {
+			sr_warn("Cannot write SCPI cache file %s.", path);
+		}
+		g_free(path);
+	}
+	G_UNLOCK(scpi_cache);
+}
+
+/**
+ * Invalidate the SCPI response cache.
+ *
+ * Drops all responses kept in memory, as well as the cache files in the
+ * directory which SIGROK_SCPI_CACHE names (if any). Use this after an
+ * instrument's configuration changed in ways which its *IDN? response
+ * does not reflect, like installed options.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_scpi_cache_clear(struct sr_context *ctx)
+{
+	const char *dir, *name;
+	char *path;
+	GDir *d;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	G_LOCK(scpi_cache);
+	if (ctx->scpi_cache)
+		g_hash_table_remove_all(ctx->scpi_cache);
+	if (cache_enabled(&dir) && dir && (d = g_dir_open(dir, 0, NULL))) {
+		while ((name = g_dir_read_name(d))) {
+			if (!g_str_has_suffix(name, CACHE_FILE_SUFFIX))
+				continue;
+			path = g_build_filename(dir, name, NULL);
+			g_remove(path);
+			g_free(path);
+		}
+		g_dir_close(d);
+	}
+	G_UNLOCK(scpi_cache);
+
+	return SR_OK;
+}
@@ -242,6 +242,14 @@ static int scpi_tcp_rigol_read_data(void *priv, char *buf, int maxlen)
 }
 
 /* Check reception completion. tcp-raw and tcp-rigol modes. */
+/* Check for receive data which can be read without blocking. */
+static int scpi_tcp_read_ready(void *priv)
+{
+	struct scpi_tcp *tcp = priv;
+
+	return sr_tcp_is_readable(tcp->tcp_dev);
+}
+
 static int scpi_tcp_read_complete(void *priv)
 {
 	struct scpi_tcp *tcp = priv;
@@ -285,6 +293,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_raw_dev = {
 	.send          = scpi_tcp_send,
 	.read_begin    = scpi_tcp_read_begin,
 	.read_data     = scpi_tcp_raw_read_data,
+	.read_ready    = scpi_tcp_read_ready,
 	.write_data    = scpi_tcp_raw_write_data,
 	.read_complete = scpi_tcp_read_complete,
 	.close         = scpi_tcp_close,
@@ -304,6 +313,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_rigol_dev = {
 	.send          = scpi_tcp_send,
 	.read_begin    = scpi_tcp_read_begin,
 	.read_data     = scpi_tcp_rigol_read_data,
+	.read_ready    = scpi_tcp_read_ready,
 	.read_complete = scpi_tcp_read_complete,
 	.close         = scpi_tcp_close,
 	.free          = scpi_tcp_free,
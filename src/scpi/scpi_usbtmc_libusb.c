@@ -29,6 +29,10 @@
 #define MAX_TRANSFER_LENGTH 2048
 #define TRANSFER_TIMEOUT 1000
 
+/* Bulk in transfers straight into the caller's buffer. */
+#define DEFAULT_DIRECT_TRANSFER_SIZE (64 * 1024)
+#define NUM_DIRECT_TRANSFERS 4
+
 struct scpi_usbtmc_libusb {
 	struct sr_context *ctx;
 	struct sr_usb_dev_inst *usb;
@@ -42,6 +46,8 @@ struct scpi_usbtmc_libusb {
 	uint8_t usb488_dev_cap;
 	uint8_t bTag;
 	uint8_t bulkin_attributes;
+	int max_packet_size;
+	int transfer_size;
 	uint8_t buffer[MAX_TRANSFER_LENGTH];
 	int response_length;
 	int response_bytes_read;
@@ -130,7 +136,7 @@ static GSList *scpi_usbtmc_libusb_scan(struct drv_context *drvc)
 	int confidx, intfidx, ret, i;
 	char *res;
 
-	ret = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	ret = sr_usb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(ret));
@@ -195,6 +201,14 @@ static int scpi_usbtmc_libusb_dev_inst_new(void *priv, struct drv_context *drvc,
 	uscpi->usb = devices->data;
 	g_slist_free(devices);
 
+	/* Optional size of the bulk in transfers, "usbtmc/<bus>.<addr>/<size>". */
+	uscpi->transfer_size = DEFAULT_DIRECT_TRANSFER_SIZE;
+	if (params[2] && (sr_atoi(params[2], &uscpi->transfer_size) != SR_OK ||
+			uscpi->transfer_size <= 0)) {
+		sr_err("Invalid transfer size '%s'.", params[2]);
+		return SR_ERR;
+	}
+
 	return SR_OK;
 }
 
@@ -338,6 +352,7 @@ static int scpi_usbtmc_libusb_open(struct sr_scpi_dev_inst *scpi)
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_BULK &&
 				    ep->bEndpointAddress & (LIBUSB_ENDPOINT_DIR_MASK)) {
 					uscpi->bulk_in_ep = ep->bEndpointAddress;
+					uscpi->max_packet_size = ep->wMaxPacketSize;
 					sr_dbg("Bulk IN EP %d", uscpi->bulk_in_ep & 0x7f);
 				}
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_INTERRUPT &&
@@ -410,6 +425,19 @@ static int scpi_usbtmc_libusb_open(struct sr_scpi_dev_inst *scpi)
 	       uscpi->usb488_dev_cap & USB488_DEV_CAP_RL1         ? "RL1"  : "RL0",
 	       uscpi->usb488_dev_cap & USB488_DEV_CAP_DT1         ? "DT1"  : "DT0");
 
+	/*
+	 * Direct bulk in transfers consist of whole packets only. So the
+	 * device cannot overrun the caller's buffer, and its alignment
+	 * bytes at the message's end go to the bounce buffer.
+	 */
+	if (uscpi->max_packet_size <= 0)
+		uscpi->max_packet_size = 64;
+	uscpi->transfer_size -= uscpi->transfer_size % uscpi->max_packet_size;
+	if (!uscpi->transfer_size)
+		uscpi->transfer_size = uscpi->max_packet_size;
+	sr_dbg("Bulk IN packet size %d, transfer size %d.",
+	       uscpi->max_packet_size, uscpi->transfer_size);
+
 	scpi_usbtmc_remote(uscpi);
 
 	return SR_OK;
@@ -591,6 +619,110 @@ static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi,
 	return transferred;
 }
 
+struct bulkin_direct {
+	struct libusb_transfer *transfers[NUM_DIRECT_TRANSFERS];
+	int num_transfers;
+	int pending;
+};
+
+static void LIBUSB_CALL bulkin_direct_cb(struct libusb_transfer *transfer)
+{
+	struct bulkin_direct *direct = transfer->user_data;
+	int i;
+
+	direct->pending--;
+
+	/*
+	 * A short or failed transfer ends the message. Later transfers
+	 * would wait for data which does not come, cancel them.
+	 */
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED &&
+	    transfer->actual_length == transfer->length)
+		return;
+	for (i = 0; i < direct->num_transfers; i++) {
+		if (direct->transfers[i] == transfer)
+			break;
+	}
+	for (i++; i < direct->num_transfers; i++)
+		libusb_cancel_transfer(direct->transfers[i]);
+}
+
+/*
+ * Continue a bulk in message straight into the caller's buffer, with
+ * several transfers in flight. The size must be a multiple of the
+ * packet size, and must not exceed the message's remaining length.
+ */
+static int scpi_usbtmc_bulkin_direct(struct scpi_usbtmc_libusb *uscpi,
+                                     uint8_t *data, int size)
+{
+	struct sr_usb_dev_inst *usb = uscpi->usb;
+	struct bulkin_direct direct;
+	struct libusb_transfer *transfer;
+	struct timeval tv;
+	int offset, length, transferred, ret, i;
+	gboolean ended;
+
+	memset(&direct, 0, sizeof(direct));
+	for (offset = 0; offset < size &&
+	     direct.num_transfers < NUM_DIRECT_TRANSFERS; offset += length) {
+		length = MIN(size - offset, uscpi->transfer_size);
+		if (!(transfer = libusb_alloc_transfer(0)))
+			break;
+		libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			uscpi->bulk_in_ep, data + offset, length,
+			bulkin_direct_cb, &direct, TRANSFER_TIMEOUT);
+		if ((ret = libusb_submit_transfer(transfer)) < 0) {
+			sr_err("USBTMC bulk in submit error: %s.",
+			       libusb_error_name(ret));
+			libusb_free_transfer(transfer);
+			break;
+		}
+		direct.transfers[direct.num_transfers++] = transfer;
+		direct.pending++;
+	}
+	if (!direct.num_transfers)
+		return SR_ERR;
+
+	while (direct.pending > 0) {
+		tv.tv_sec = 0;
+		tv.tv_usec = TRANSFER_TIMEOUT * 1000 / 10;
+		ret = libusb_handle_events_timeout(uscpi->ctx->libusb_ctx, &tv);
+		if (ret < 0) {
+			sr_err("USBTMC bulk in event error: %s.",
+			       libusb_error_name(ret));
+			for (i = 0; i < direct.num_transfers; i++)
+				libusb_cancel_transfer(direct.transfers[i]);
+		}
+	}
+
+	/* Transfers complete in order, the first short one ends the data. */
+	transferred = 0;
+	ended = FALSE;
+	ret = SR_OK;
+	for (i = 0; i < direct.num_transfers; i++) {
+		transfer = direct.transfers[i];
+		if (!ended) {
+			if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+				sr_err("USBTMC bulk in transfer failed, status %d.",
+				       transfer->status);
+				ret = SR_ERR;
+			}
+			transferred += transfer->actual_length;
+			ended = transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+				transfer->actual_length < transfer->length;
+		}
+		libusb_free_transfer(transfer);
+	}
+	if (ret != SR_OK && !transferred)
+		return ret;
+
+	uscpi->response_length = 0;
+	uscpi->response_bytes_read = 0;
+	uscpi->remaining_length = ended ? 0 : uscpi->remaining_length - transferred;
+
+	return transferred;
+}
+
 static int scpi_usbtmc_libusb_send(void *priv, const char *command)
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
@@ -627,6 +759,12 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 	int read_length;
 
 	if (uscpi->response_bytes_read >= uscpi->response_length) {
+		/* Deliver whole packets of large reads without a copy. */
+		read_length = MIN(uscpi->remaining_length, maxlen);
+		read_length -= read_length % uscpi->max_packet_size;
+		if (read_length > (int)sizeof(uscpi->buffer))
+			return scpi_usbtmc_bulkin_direct(uscpi,
+			                                 (uint8_t *)buf, read_length);
 		if (uscpi->remaining_length > 0) {
 			if (scpi_usbtmc_bulkin_continue(uscpi, uscpi->buffer,
 			                                sizeof(uscpi->buffer)) <= 0)
@@ -170,7 +170,8 @@ SR_PRIV int serial_close(struct sr_serial_dev_inst *serial)
 
 	rc = serial->lib_funcs->close(serial);
 	if (rc == SR_OK && serial->rcv_buffer) {
-		g_string_free(serial->rcv_buffer, TRUE);
+		g_free(serial->rcv_buffer->data);
+		g_free(serial->rcv_buffer);
 		serial->rcv_buffer = NULL;
 	}
 
@@ -276,6 +277,57 @@ SR_PRIV int serial_set_read_chunk_cb(struct sr_serial_dev_inst *serial,
 	return SR_OK;
 }
 
+/*
+ * The RX queue is a ring buffer. Transports sized it for the chunks they
+ * receive, so that queueing and unqueueing are just copies, without
+ * moving the remaining data around. It only grows when a consumer falls
+ * behind by more than its size.
+ */
+
+/* Make room for at least 'need' more bytes, keeping the queued data. */
+static void rx_queue_reserve(struct sr_ser_rx_queue *q, size_t need)
+{
+	uint8_t *data;
+	size_t size, first;
+
+	if (q->len + need <= q->size)
+		return;
+
+	size = MAX(q->size * 2, q->len + need);
+	data = g_malloc(size);
+	first = MIN(q->len, q->size - q->head);
+	memcpy(data, q->data + q->head, first);
+	memcpy(data + first, q->data, q->len - first);
+	g_free(q->data);
+	q->data = data;
+	q->size = size;
+	q->head = 0;
+}
+
+/**
+ * Allocate the RX queue, unless it already exists. Internal to the
+ * serial subsystem, transports which queue received data call this
+ * from their open routine.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[in] size Initial capacity, in bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_ser_alloc_rx_queue(struct sr_serial_dev_inst *serial,
+	size_t size)
+{
+	struct sr_ser_rx_queue *q;
+
+	if (!serial || serial->rcv_buffer)
+		return;
+
+	q = g_malloc0(sizeof(*q));
+	q->size = MAX(size, 1);
+	q->data = g_malloc(q->size);
+	serial->rcv_buffer = q;
+}
+
 /**
  * Discard previously queued RX data. Internal to the serial subsystem,
  * coordination between common and transport specific support code.
@@ -289,7 +341,8 @@ SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial)
 	if (!serial || !serial->rcv_buffer)
 		return;
 
-	g_string_truncate(serial->rcv_buffer, 0);
+	serial->rcv_buffer->head = 0;
+	serial->rcv_buffer->len = 0;
 }
 
 /**
@@ -308,6 +361,53 @@ SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 	return serial->rcv_buffer->len;
 }
 
+/**
+ * Access queued RX data in place. Internal to the serial subsystem,
+ * coordination between common and transport specific support code.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[out] data Pointer to store the start of the oldest data in.
+ *
+ * @returns The number of contiguous bytes at @a data. More data can
+ * follow after these are consumed, also see sr_ser_has_queued_data().
+ *
+ * @private
+ */
+SR_PRIV size_t sr_ser_peek_queued_data(struct sr_serial_dev_inst *serial,
+	const uint8_t **data)
+{
+	struct sr_ser_rx_queue *q;
+
+	if (!serial || !(q = serial->rcv_buffer) || !q->len)
+		return 0;
+
+	*data = q->data + q->head;
+
+	return MIN(q->len, q->size - q->head);
+}
+
+/**
+ * Drop data from the front of the RX queue, after it was accessed by
+ * sr_ser_peek_queued_data(). Internal to the serial subsystem.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[in] len Number of bytes to drop.
+ *
+ * @private
+ */
+SR_PRIV void sr_ser_consume_queued_data(struct sr_serial_dev_inst *serial,
+	size_t len)
+{
+	struct sr_ser_rx_queue *q;
+
+	if (!serial || !(q = serial->rcv_buffer))
+		return;
+
+	len = MIN(len, q->len);
+	q->len -= len;
+	q->head = q->len ? (q->head + len) % q->size : 0;
+}
+
 /**
  * Queue received data. Internal to the serial subsystem, coordination
  * between common and transport specific support code.
@@ -321,13 +421,26 @@ SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 	const uint8_t *data, size_t len)
 {
+	struct sr_ser_rx_queue *q;
+	size_t tail, first;
+
 	if (!serial || !data || !len)
 		return;
 
-	if (serial->rx_chunk_cb_func)
+	serial->rx_time = g_get_monotonic_time();
+	if (serial->rx_chunk_cb_func) {
 		serial->rx_chunk_cb_func(serial, serial->rx_chunk_cb_data, data, len);
-	else if (serial->rcv_buffer)
-		g_string_append_len(serial->rcv_buffer, (const gchar *)data, len);
+		return;
+	}
+	if (!(q = serial->rcv_buffer))
+		return;
+
+	rx_queue_reserve(q, len);
+	tail = (q->head + q->len) % q->size;
+	first = MIN(len, q->size - tail);
+	memcpy(q->data + tail, data, first);
+	memcpy(q->data, data + first, len - first);
+	q->len += len;
 }
 
 /**
@@ -343,25 +456,22 @@ SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
 	uint8_t *data, size_t len)
 {
-	size_t qlen;
-	GString *buf;
+	const uint8_t *chunk;
+	size_t got, n;
 
 	if (!serial || !data || !len)
 		return 0;
 
-	qlen = sr_ser_has_queued_data(serial);
-	if (!qlen)
-		return 0;
-
-	buf = serial->rcv_buffer;
-	if (len > buf->len)
-		len = buf->len;
-	if (len) {
-		memcpy(data, buf->str, len);
-		g_string_erase(buf, 0, len);
+	/* At most two pieces, before and after the buffer's wrap. */
+	got = 0;
+	while (got < len && (n = sr_ser_peek_queued_data(serial, &chunk))) {
+		n = MIN(n, len - got);
+		memcpy(data + got, chunk, n);
+		sr_ser_consume_queued_data(serial, n);
+		got += n;
 	}
 
-	return len;
+	return got;
 }
 
 /**
@@ -456,6 +566,7 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
 {
 	ssize_t ret;
+	size_t queued;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -464,8 +575,22 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 
 	if (!serial->lib_funcs || !serial->lib_funcs->read)
 		return SR_ERR_NA;
-	ret = serial->lib_funcs->read(serial, buf, count,
-		nonblocking, timeout_ms);
+
+	/*
+	 * Queued data comes first. Either the transport queued it, or
+	 * serial_readline() read ahead of the line's end.
+	 */
+	queued = sr_ser_unqueue_rx_data(serial, buf, count);
+	if (queued == count || (queued && nonblocking))
+		return queued;
+
+	ret = serial->lib_funcs->read(serial, (uint8_t *)buf + queued,
+		count - queued, nonblocking, timeout_ms);
+	if (ret < 0)
+		return queued ? (int)queued : ret;
+	if (ret > 0)
+		serial->rx_time = g_get_monotonic_time();
+	ret += queued;
 	if (ret > 0)
 		sr_spew("Read %zd/%zu bytes.", ret, count);
 
@@ -721,6 +846,37 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 			flow, rts, dtr);
 }
 
+/* Put data which was read ahead back in front of the RX queue. */
+static void serial_unread(struct sr_serial_dev_inst *serial,
+	const char *data, size_t len)
+{
+	struct sr_ser_rx_queue *q;
+	size_t first;
+
+	if (!len)
+		return;
+
+	sr_ser_alloc_rx_queue(serial, len);
+	q = serial->rcv_buffer;
+	rx_queue_reserve(q, len);
+	q->head = (q->head + q->size - len) % q->size;
+	first = MIN(len, q->size - q->head);
+	memcpy(q->data + q->head, data, first);
+	memcpy(q->data, data + first, len - first);
+	q->len += len;
+}
+
+/* Find the first CR or LF in a chunk of data. */
+static char *find_eol(char *data, size_t len)
+{
+	char *cr, *lf;
+
+	cr = memchr(data, '\r', len);
+	lf = memchr(data, '\n', cr ? (size_t)(cr - data) : len);
+
+	return lf ? lf : cr;
+}
+
 /**
  * Read a line from the specified serial port.
  *
@@ -731,6 +887,10 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
  *
  * Reading stops when CR or LF is found, which is stripped from the buffer.
  *
+ * Data is read in chunks of what's available, when nothing is, the
+ * read blocks until the next byte comes in. Data past the line's end
+ * is kept for subsequent reads.
+ *
  * @retval SR_OK Success.
  * @retval SR_ERR Failure.
  *
@@ -741,6 +901,7 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 {
 	gint64 start, remaining;
 	int maxlen, len;
+	char *chunk, *eol;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -761,24 +922,26 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 		len = maxlen - *buflen - 1;
 		if (len < 1)
 			break;
-		len = serial_read_blocking(serial, *buf + *buflen, 1, remaining);
-		if (len > 0) {
-			*buflen += len;
+		chunk = *buf + *buflen;
+		len = serial_read_nonblocking(serial, chunk, len);
+		if (len == 0)
+			len = serial_read_blocking(serial, chunk, 1, remaining);
+		if (len < 0)
+			break;
+		if ((eol = find_eol(chunk, len))) {
+			/* Strip CR/LF and terminate, keep what follows. */
+			serial_unread(serial, eol + 1, chunk + len - eol - 1);
+			*buflen += eol - chunk;
 			*(*buf + *buflen) = '\0';
-			if (*buflen > 0 && (*(*buf + *buflen - 1) == '\r'
-					|| *(*buf + *buflen - 1) == '\n')) {
-				/* Strip CR/LF and terminate. */
-				*(*buf + --*buflen) = '\0';
-				break;
-			}
+			break;
 		}
+		*buflen += len;
+		*(*buf + *buflen) = '\0';
 		/* Reduce timeout by time elapsed. */
 		remaining = timeout_ms - ((g_get_monotonic_time() - start) / 1000);
 		if (remaining <= 0)
 			/* Timeout */
 			break;
-		if (len < 1)
-			g_usleep(2000);
 	}
 	if (*buflen)
 		sr_dbg("Received %d: '%s'.", *buflen, *buf);
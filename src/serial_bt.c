@@ -31,6 +31,7 @@
 
 #define SER_BT_CONN_PREFIX	"bt"
 #define SER_BT_CHUNK_SIZE	1200
+#define SER_BT_NOTIFY_BATCH	32	/* Max notifications per read attempt. */
 
 #define SER_BT_PARAM_PREFIX_CHANNEL	"channel="
 #define SER_BT_PARAM_PREFIX_HDL_RX	"handle_rx="
@@ -38,6 +39,8 @@
 #define SER_BT_PARAM_PREFIX_HDL_CCCD	"handle_cccd="
 #define SER_BT_PARAM_PREFIX_VAL_CCCD	"value_cccd="
 #define SER_BT_PARAM_PREFIX_BLE_MTU	"mtu="
+#define SER_BT_PARAM_PREFIX_ATT_MTU	"att_mtu="
+#define SER_BT_PARAM_PREFIX_INTERVAL	"interval="
 
 /**
  * @file
@@ -156,6 +159,9 @@ static const char *conn_name_text(enum ser_bt_conn_t type)
  * @param[out] write_hdl The BLE notify write handle (if applicable).
  * @param[out] cccd_hdl The BLE notify CCCD handle (if applicable).
  * @param[out] cccd_val The BLE notify CCCD value (if applicable).
+ * @param[out] ble_mtu The BLE MTU to respond with (if applicable).
+ * @param[out] att_mtu The ATT MTU to propose (if applicable).
+ * @param[out] conn_interval The connection interval in ms (if applicable).
  *
  * @return 0 upon success, non-zero upon failure.
  *
@@ -183,6 +189,7 @@ static const char *conn_name_text(enum ser_bt_conn_t type)
  *   bt/rfcomm/11-22-33-44-55-66/channel=2
  *   bt/ble122/88:6b:12:34:56:78
  *   bt/cc254x/0123456789ab
+ *   bt/notify/0123456789ab/handle_rx=21/att_mtu=247/interval=15
  *
  * It's assumed that users easily can create those conn= specs from
  * available information, or that scan routines will create such specs
@@ -195,7 +202,7 @@ static int ser_bt_parse_conn_spec(
 	size_t *rfcomm_channel,
 	uint16_t *read_hdl, uint16_t *write_hdl,
 	uint16_t *cccd_hdl, uint16_t *cccd_val,
-	uint16_t *ble_mtu)
+	uint16_t *ble_mtu, uint16_t *att_mtu, uint16_t *conn_interval)
 {
 	char **fields, *field;
 	enum ser_bt_conn_t type;
@@ -221,6 +228,10 @@ static int ser_bt_parse_conn_spec(
 		*cccd_val = 0;
 	if (ble_mtu)
 		*ble_mtu = 0;
+	if (att_mtu)
+		*att_mtu = 0;
+	if (conn_interval)
+		*conn_interval = 0;
 
 	if (!serial || !spec || !spec[0])
 		return SR_ERR_ARG;
@@ -413,6 +424,30 @@ static int ser_bt_parse_conn_spec(
 				*ble_mtu = parm_val;
 			continue;
 		}
+		if (g_str_has_prefix(field, SER_BT_PARAM_PREFIX_ATT_MTU)) {
+			field += strlen(SER_BT_PARAM_PREFIX_ATT_MTU);
+			endp = NULL;
+			ret = sr_atoul_base(field, &parm_val, &endp, 0);
+			if (ret != SR_OK || !endp || *endp != '\0') {
+				ret_parse = SR_ERR_ARG;
+				break;
+			}
+			if (att_mtu)
+				*att_mtu = parm_val;
+			continue;
+		}
+		if (g_str_has_prefix(field, SER_BT_PARAM_PREFIX_INTERVAL)) {
+			field += strlen(SER_BT_PARAM_PREFIX_INTERVAL);
+			endp = NULL;
+			ret = sr_atoul_base(field, &parm_val, &endp, 0);
+			if (ret != SR_OK || !endp || *endp != '\0') {
+				ret_parse = SR_ERR_ARG;
+				break;
+			}
+			if (conn_interval)
+				*conn_interval = parm_val;
+			continue;
+		}
 		return SR_ERR_DATA;
 	}
 
@@ -487,7 +522,7 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 	const char *remote_addr;
 	size_t rfcomm_channel;
 	uint16_t read_hdl, write_hdl, cccd_hdl, cccd_val;
-	uint16_t ble_mtu;
+	uint16_t ble_mtu, att_mtu, conn_interval;
 	int rc;
 	struct sr_bt_desc *desc;
 
@@ -499,7 +534,7 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 			&rfcomm_channel,
 			&read_hdl, &write_hdl,
 			&cccd_hdl, &cccd_val,
-			&ble_mtu);
+			&ble_mtu, &att_mtu, &conn_interval);
 	if (rc != SR_OK)
 		return SR_ERR_ARG;
 
@@ -533,6 +568,9 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 		rc = sr_bt_config_notify(desc,
 			read_hdl, write_hdl, cccd_hdl, cccd_val,
 			ble_mtu);
+		if (rc < 0)
+			return SR_ERR;
+		rc = sr_bt_config_ble_link(desc, att_mtu, conn_interval);
 		if (rc < 0)
 			return SR_ERR;
 		serial->bt_notify_handle_read = read_hdl;
@@ -548,8 +586,7 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 	serial->bt_conn_type = conn_type;
 
 	/* Make sure the receive buffer can accept input data. */
-	if (!serial->rcv_buffer)
-		serial->rcv_buffer = g_string_sized_new(SER_BT_CHUNK_SIZE);
+	sr_ser_alloc_rx_queue(serial, SER_BT_CHUNK_SIZE);
 	rc = sr_bt_config_cb_data(desc, ser_bt_data_cb, serial);
 	if (rc < 0)
 		return SR_ERR;
@@ -714,14 +751,17 @@ static int ser_bt_read(struct sr_serial_dev_inst *serial,
 		case SER_BT_CONN_AC6328:
 		case SER_BT_CONN_DIALOG:
 		case SER_BT_CONN_NOTIFY:
-			dlen = sr_ser_has_queued_data(serial);
-			rc = sr_bt_check_notify(serial->bt_desc);
+			/*
+			 * Process all pending notifications. Count them
+			 * instead of checking the RX queue, which does not
+			 * grow when a chunk callback consumes the data.
+			 */
+			rc = sr_bt_check_notify_batch(serial->bt_desc,
+				SER_BT_NOTIFY_BATCH);
 			if (rc < 0)
 				rdlen = -1;
-			else if (sr_ser_has_queued_data(serial) != dlen)
-				rdlen = +1;
 			else
-				rdlen = 0;
+				rdlen = rc;
 			break;
 		default:
 			rdlen = -1;
@@ -780,7 +820,6 @@ static int bt_source_cb(int fd, int revents, void *cb_data)
 	struct sr_serial_dev_inst *serial;
 	uint8_t rx_buf[SER_BT_CHUNK_SIZE];
 	ssize_t rdlen;
-	size_t dlen;
 	int rc;
 
 	args = cb_data;
@@ -814,14 +853,17 @@ static int bt_source_cb(int fd, int revents, void *cb_data)
 		case SER_BT_CONN_AC6328:
 		case SER_BT_CONN_DIALOG:
 		case SER_BT_CONN_NOTIFY:
-			dlen = sr_ser_has_queued_data(serial);
-			rc = sr_bt_check_notify(serial->bt_desc);
+			/*
+			 * Process all pending notifications. Count them
+			 * instead of checking the RX queue, which does not
+			 * grow when a chunk callback consumes the data.
+			 */
+			rc = sr_bt_check_notify_batch(serial->bt_desc,
+				SER_BT_NOTIFY_BATCH);
 			if (rc < 0)
 				rdlen = -1;
-			else if (sr_ser_has_queued_data(serial) != dlen)
-				rdlen = +1;
 			else
-				rdlen = 0;
+				rdlen = rc;
 			break;
 		default:
 			rdlen = -1;
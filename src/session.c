@@ -48,9 +48,239 @@
 
 struct datafeed_callback {
 	sr_datafeed_callback cb;
+	sr_datafeed_batch_callback batch_cb;
 	void *cb_data;
+	/* Whether SR_DF_LOGIC_RUNS gets passed without expansion. */
+	gboolean runs;
+	struct sr_dispatch_timing timing;
 };
 
+/** Packet which is waiting in the asynchronous dispatch queue. */
+struct dispatch_item {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+/** Bounded queue and worker thread for asynchronous datafeed dispatch.
+ * The ring of queued items is protected by the mutex. Senders block on
+ * the not_full condition (or drop the packet, depending on the policy),
+ * the worker thread waits for the not_empty condition.
+ */
+struct session_dispatch {
+	struct sr_session *session;
+	GThread *thread;
+	GMutex mutex;
+	GCond not_empty;
+	GCond not_full;
+	struct dispatch_item *items;
+	size_t depth;
+	size_t head;
+	size_t count;
+	gboolean quit;
+};
+
+/** Reference counted memory which carries datafeed payload data. */
+struct sr_buffer {
+	gint refcount;
+	void *data;
+	size_t size;
+	sr_buffer_release_callback release;
+	void *release_data;
+	/* Pool which the buffer returns to, and its slab class. */
+	struct buffer_pool *pool;
+	unsigned int pool_class;
+};
+
+/*
+ * Slab classes of the session's buffer pool. Class N holds blocks of
+ * (4KiB << N) bytes. Larger requests bypass the pool. A limited number
+ * of blocks per class is kept for later re-use, the rest gets released.
+ */
+#define POOL_MIN_SHIFT	12
+#define POOL_CLASSES	16
+#define POOL_MAX_FREE	8
+
+/**
+ * Session owned pool of sample data buffers. Outlives the session when
+ * buffers are still referenced at the time the session gets destroyed.
+ */
+struct buffer_pool {
+	GMutex mutex;
+	gint refcount;
+	/* Context which the pool's blocks are accounted with. */
+	struct sr_context *ctx;
+	gboolean closed;
+	GSList *free_list[POOL_CLASSES];
+	size_t free_count[POOL_CLASSES];
+};
+
+/**
+ * Reference counted datafeed packet, see sr_packet_ref(). Either wraps
+ * a deep copy of a packet, or a shallow copy of the packet's meta data
+ * with the sample data residing in a (driver provided) buffer.
+ */
+struct shared_packet {
+	gint refcount;
+	struct sr_datafeed_packet *packet;
+	struct sr_buffer *buffer;
+	/* Storage for the shallow copy of buffer backed packets. */
+	struct sr_datafeed_packet buf_packet;
+	union {
+		struct sr_datafeed_logic logic;
+		struct sr_datafeed_analog analog;
+	} buf_payload;
+	struct sr_analog_encoding buf_encoding;
+	struct sr_analog_meaning buf_meaning;
+	struct sr_analog_spec buf_spec;
+};
+
+/*
+ * Registry of shared packets, keyed by the packet pointer which was
+ * handed out. Lets sr_packet_ref() recognize packets which already are
+ * reference counted, regardless of the thread which holds them.
+ */
+static GMutex shared_packets_mutex;
+static GHashTable *shared_packets;
+
+/** Callback invocation which was handed to a fan-out worker thread. */
+struct fanout_job {
+	struct session_fanout *fanout;
+	struct datafeed_callback *cb_struct;
+	const struct sr_dev_inst *sdi;
+	const struct sr_datafeed_packet *packet;
+};
+
+/** Worker pool which runs datafeed callbacks concurrently. The mutex
+ * protects the bookkeeping of jobs which are pending for the current
+ * packet. The dispatching thread waits for the done condition before
+ * it proceeds to the next packet.
+ */
+struct session_fanout {
+	GThreadPool *pool;
+	GMutex mutex;
+	GCond done;
+	size_t pending;
+	gboolean busy;
+	struct fanout_job *jobs;
+	size_t jobs_size;
+};
+
+/**
+ * Transforms and datafeed callbacks of a session, resolved into arrays
+ * for the datafeed hot path. The decision whether to dump packets for
+ * debugging is latched when the table gets built.
+ */
+struct dispatch_table {
+	struct sr_transform **transforms;
+	size_t transforms_count;
+	struct datafeed_callback **callbacks;
+	size_t callbacks_count;
+	/* Some callback needs SR_DF_LOGIC_RUNS expanded. */
+	gboolean expand_runs;
+	gboolean dump;
+	gboolean spew;
+};
+
+/**
+ * Thread and main context which run the event sources of one device,
+ * see sr_session_device_threads_set().
+ */
+struct device_loop {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
+};
+
+/* The device loop whose event sources the current thread installs. */
+static GPrivate current_device_loop = G_PRIVATE_INIT(NULL);
+
+/* The fan-out pool which the calling worker thread applied policy for. */
+static GPrivate fanout_policy_applied = G_PRIVATE_INIT(NULL);
+
+static void stats_reset(struct sr_session *session);
+static void dispatch_table_free(struct dispatch_table *table);
+static struct dispatch_table *dispatch_table_update(struct sr_session *session);
+static int dispatch_start(struct sr_session *session);
+static void dispatch_stop(struct sr_session *session);
+static void device_loops_stop(struct sr_session *session);
+static int session_rearm_devices(struct sr_session *session);
+static int stop_check_later(struct sr_session *session);
+
+static struct buffer_pool *buffer_pool_new(struct sr_context *ctx)
+{
+	struct buffer_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	pool->ctx = ctx;
+	g_mutex_init(&pool->mutex);
+	pool->refcount = 1;
+
+	return pool;
+}
+
+static void buffer_pool_unref(struct buffer_pool *pool)
+{
+	if (!g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+/* Release all cached blocks. Outstanding buffers get freed upon release. */
+static void buffer_pool_close(struct buffer_pool *pool)
+{
+	struct sr_buffer *buf;
+	GSList *l;
+	size_t idx;
+
+	g_mutex_lock(&pool->mutex);
+	pool->closed = TRUE;
+	for (idx = 0; idx < POOL_CLASSES; idx++) {
+		for (l = pool->free_list[idx]; l; l = l->next) {
+			buf = l->data;
+			sr_mem_release(pool->ctx,
+				(size_t)1 << (POOL_MIN_SHIFT + buf->pool_class));
+			g_free(buf->data);
+			g_free(buf);
+		}
+		g_slist_free(pool->free_list[idx]);
+		pool->free_list[idx] = NULL;
+		pool->free_count[idx] = 0;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	buffer_pool_unref(pool);
+}
+
+/* Return a buffer whose last reference was dropped to its pool. */
+static void buffer_pool_put(struct sr_buffer *buf)
+{
+	struct buffer_pool *pool;
+	unsigned int idx;
+	gboolean keep;
+
+	pool = buf->pool;
+	idx = buf->pool_class;
+
+	g_mutex_lock(&pool->mutex);
+	keep = !pool->closed && pool->free_count[idx] < POOL_MAX_FREE;
+	if (keep) {
+		pool->free_list[idx] = g_slist_prepend(pool->free_list[idx], buf);
+		pool->free_count[idx]++;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (!keep) {
+		sr_mem_release(pool->ctx, (size_t)1 << (POOL_MIN_SHIFT + idx));
+		g_free(buf->data);
+		g_free(buf);
+	}
+	buffer_pool_unref(pool);
+}
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  */
@@ -65,6 +295,8 @@ struct fd_source {
 	void *key;
 
 	GPollFD pollfd;
+	/* The kernel event set which polls the fd, or NULL for GLib. */
+	struct sr_poller *poller;
 };
 
 /** FD event source prepare() method.
@@ -91,6 +323,10 @@ static gboolean fd_source_prepare(GSource *source, int *timeout)
 	}
 	*timeout = remaining_ms;
 
+	/* The poller reported an event since the last dispatch. */
+	if (fsource->poller && fsource->pollfd.revents)
+		return TRUE;
+
 	return (remaining_ms == 0);
 }
 
@@ -121,6 +357,8 @@ static gboolean fd_source_dispatch(GSource *source,
 
 	fsource = (struct fd_source *)source;
 	revents = fsource->pollfd.revents;
+	if (fsource->poller)
+		fsource->pollfd.revents = 0;
 
 	if (!callback) {
 		sr_err("Callback not set, cannot dispatch event.");
@@ -129,6 +367,10 @@ static gboolean fd_source_dispatch(GSource *source,
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))
 			(fsource->pollfd.fd, revents, user_data);
 
+	if (fsource->poller && revents && G_LIKELY(keep)
+			&& G_LIKELY(!g_source_is_destroyed(source)))
+		sr_session_poller_rearm(fsource->poller, fsource->pollfd.fd);
+
 	if (fsource->timeout_us >= 0 && G_LIKELY(keep)
 			&& G_LIKELY(!g_source_is_destroyed(source)))
 		fsource->due_us = g_source_get_time(source)
@@ -146,6 +388,11 @@ static void fd_source_finalize(GSource *source)
 
 	sr_dbg("%s: key %p", __func__, fsource->key);
 
+	if (fsource->poller) {
+		sr_session_poller_remove(fsource->poller, fsource->pollfd.fd);
+		sr_session_poller_unref(fsource->poller);
+	}
+
 	sr_session_source_destroyed(fsource->session, fsource->key, source);
 }
 
@@ -154,6 +401,10 @@ static void fd_source_finalize(GSource *source)
  * In order to maintain API compatibility, this event source also doubles
  * as a timer event source.
  *
+ * Where available, the fd goes to the kernel event set of the main
+ * context which the source gets attached to. GLib then polls a single
+ * fd for all sources of a context, instead of one per source.
+ *
  * @param session The session the event source belongs to.
  * @param key The key used to identify this source.
  * @param fd The file descriptor or HANDLE.
@@ -193,7 +444,16 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	fsource->pollfd.events = events;
 	fsource->pollfd.revents = 0;
 
-	if (fd >= 0)
+	if (fd < 0)
+		return source;
+
+	fsource->poller = sr_session_poller_get(session);
+	if (fsource->poller && sr_session_poller_add(fsource->poller, fd,
+			events, &fsource->pollfd.revents) != SR_OK) {
+		sr_session_poller_unref(fsource->poller);
+		fsource->poller = NULL;
+	}
+	if (!fsource->poller)
 		g_source_add_poll(source, &fsource->pollfd);
 
 	return source;
@@ -231,6 +491,16 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	 */
 	session->event_sources = g_hash_table_new(NULL, NULL);
 
+	session->buffer_pool = buffer_pool_new(ctx);
+	session->dispatch_table_stale = TRUE;
+
+	g_mutex_init(&session->stats_mutex);
+	session->dev_stats = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	session->timebase = sr_session_timebase_new();
+	session->pollers = sr_session_pollers_new();
+
+	g_rec_mutex_init(&session->feed_mutex);
+
 	*new_session = session;
 
 	return SR_OK;
@@ -254,12 +524,34 @@ SR_API int sr_session_destroy(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
+	dispatch_stop(session);
+	sr_session_outputs_free(session->outputs);
+
 	sr_session_dev_remove_all(session);
 	g_slist_free_full(session->owned_devs, (GDestroyNotify)sr_dev_inst_free);
 
 	sr_session_datafeed_callback_remove_all(session);
 
 	g_hash_table_unref(session->event_sources);
+	sr_session_pollers_free(session->pollers);
+
+	buffer_pool_close(session->buffer_pool);
+	dispatch_table_free(session->dispatch_table);
+
+	g_hash_table_unref(session->dev_stats);
+	g_mutex_clear(&session->stats_mutex);
+
+	g_rec_mutex_clear(&session->feed_mutex);
+
+	sr_session_recorder_free(session->recorder);
+	sr_session_store_free(session->store);
+	sr_session_timebase_free(session->timebase);
+
+	if (session->logic_layouts)
+		g_hash_table_unref(session->logic_layouts);
+	g_free(session->device_thread_policy.cpus);
+	g_free(session->dispatch_thread_policy.cpus);
+	g_free(session->fanout_thread_policy.cpus);
 
 	g_mutex_clear(&session->main_mutex);
 
@@ -463,6 +755,7 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 
 	g_slist_free_full(session->datafeed_callbacks, g_free);
 	session->datafeed_callbacks = NULL;
+	session->dispatch_table_stale = TRUE;
 
 	return SR_OK;
 }
@@ -501,141 +794,628 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
+	session->dispatch_table_stale = TRUE;
 
 	return SR_OK;
 }
 
 /**
- * Get the trigger assigned to this session.
+ * Add a batched datafeed callback to a session.
  *
- * @param session The session to use.
+ * The callback receives several packets of a device at once, when the
+ * driver submits them as a batch. Packets which get sent individually
+ * are passed to the callback as batches of one packet. Batches never
+ * mix packets of different devices. Batched and regular callbacks get
+ * invoked in the order of their registration.
  *
- * @retval NULL Invalid (NULL) session was passed to the function.
- * @retval other The trigger assigned to this session (can be NULL).
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when packets are received. Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
  *
- * @since 0.4.0
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_BUG No session exists.
+ *
+ * @since 0.6.0
  */
-SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session)
+SR_API int sr_session_datafeed_batch_callback_add(struct sr_session *session,
+		sr_datafeed_batch_callback cb, void *cb_data)
 {
-	if (!session)
-		return NULL;
+	struct datafeed_callback *cb_struct;
 
-	return session->trigger;
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!cb) {
+		sr_err("%s: cb was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
+	cb_struct->batch_cb = cb;
+	cb_struct->cb_data = cb_data;
+
+	session->datafeed_callbacks =
+	    g_slist_append(session->datafeed_callbacks, cb_struct);
+	session->dispatch_table_stale = TRUE;
+
+	return SR_OK;
 }
 
 /**
- * Set the trigger of this session.
+ * Have datafeed callbacks receive run length encoded logic data.
+ *
+ * By default, SR_DF_LOGIC_RUNS packets get expanded into SR_DF_LOGIC
+ * packets before they are passed to datafeed callbacks, so consumers
+ * which don't know about runs keep working. Callbacks which handle
+ * SR_DF_LOGIC_RUNS can have them passed as they are, their memory use
+ * and processing time then scale with the number of value changes
+ * rather than with the number of samples.
  *
  * @param session The session to use. Must not be NULL.
- * @param trig The trigger to assign to this session. Can be NULL.
+ * @param cb_data The opaque pointer the callbacks were added with. All
+ *                regular and batched callbacks with it are affected.
+ * @param accept TRUE to pass runs as they are, FALSE to expand them.
  *
  * @retval SR_OK Success.
- * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_ARG Invalid argument, or no such callback.
  *
- * @since 0.4.0
+ * @since 0.6.0
  */
-SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig)
+SR_API int sr_session_datafeed_callback_runs_set(struct sr_session *session,
+		void *cb_data, gboolean accept)
 {
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+	int ret;
+
 	if (!session)
 		return SR_ERR_ARG;
 
-	session->trigger = trig;
+	ret = SR_ERR_ARG;
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->cb_data != cb_data)
+			continue;
+		cb_struct->runs = accept;
+		ret = SR_OK;
+	}
+	session->dispatch_table_stale = TRUE;
 
-	return SR_OK;
+	return ret;
 }
 
-static int verify_trigger(struct sr_trigger *trigger)
+/**
+ * Configure asynchronous dispatch of the session's datafeed.
+ *
+ * By default, sr_session_send() runs all transforms and datafeed callbacks
+ * synchronously in the context of the sending driver. With asynchronous
+ * dispatch enabled, packets get copied into a bounded queue instead, and
+ * a dedicated thread runs the transforms and callbacks. This decouples
+ * slow consumers from the driver's I/O handling.
+ *
+ * Note that datafeed callbacks then get invoked from the dispatch thread,
+ * not from the thread which executes the session main loop. All packets
+ * which were queued before the session stops are delivered before the
+ * stopped callback gets invoked.
+ *
+ * Control packets (header, end, meta, trigger, frame markers) are never
+ * dropped, senders always block until there is room for them.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param queue_depth Maximum number of queued packets, or 0 to dispatch
+ *                    synchronously (the default).
+ * @param policy What to do with sample data packets when the queue is full.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_dispatch_async_set(struct sr_session *session,
+		size_t queue_depth, enum sr_dispatch_policy policy)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *m;
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
 
-	if (!trigger->stages) {
-		sr_err("No trigger stages defined.");
-		return SR_ERR;
+	if (policy != SR_DISPATCH_BLOCK && policy != SR_DISPATCH_DROP) {
+		sr_err("%s: invalid policy %d", __func__, policy);
+		return SR_ERR_ARG;
 	}
 
-	sr_spew("Checking trigger:");
-	for (l = trigger->stages; l; l = l->next) {
-		stage = l->data;
-		if (!stage->matches) {
-			sr_err("Stage %d has no matches defined.", stage->stage);
-			return SR_ERR;
-		}
-		for (m = stage->matches; m; m = m->next) {
-			match = m->data;
-			if (!match->channel) {
-				sr_err("Stage %d match has no channel.", stage->stage);
-				return SR_ERR;
-			}
-			if (!match->match) {
-				sr_err("Stage %d match is not defined.", stage->stage);
-				return SR_ERR;
-			}
-			sr_spew("Stage %d match on channel %s, match %d", stage->stage,
-					match->channel->name, match->match);
-		}
+	if (session->running) {
+		sr_err("Cannot change dispatch mode while session is running.");
+		return SR_ERR;
 	}
 
+	session->dispatch_depth = queue_depth;
+	session->dispatch_policy = policy;
+
 	return SR_OK;
 }
 
-/** Set up the main context the session will be executing in.
+/**
+ * Get the number of packets which were dropped by asynchronous dispatch.
  *
- * Must be called just before the session starts, by the thread which
- * will execute the session main loop. Once acquired, the main context
- * pointer is immutable for the duration of the session run.
+ * The counter accumulates sample data packets which were discarded due
+ * to the SR_DISPATCH_DROP policy. It gets reset when the session starts.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param dropped Pointer to store the number of dropped packets in.
+ *                Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
  */
-static int set_main_context(struct sr_session *session)
+SR_API int sr_session_dispatch_dropped_get(struct sr_session *session,
+		uint64_t *dropped)
 {
-	GMainContext *main_context;
+	if (!session || !dropped)
+		return SR_ERR_ARG;
 
-	g_mutex_lock(&session->main_mutex);
+	if (session->dispatch) {
+		g_mutex_lock(&session->dispatch->mutex);
+		*dropped = session->dispatch_dropped;
+		g_mutex_unlock(&session->dispatch->mutex);
+	} else {
+		*dropped = session->dispatch_dropped;
+	}
 
-	/* May happen if sr_session_start() is called a second time
-	 * while the session is still running.
-	 */
-	if (session->main_context) {
-		sr_err("Main context already set.");
+	return SR_OK;
+}
 
-		g_mutex_unlock(&session->main_mutex);
-		return SR_ERR;
+/**
+ * Run the session's datafeed callbacks concurrently.
+ *
+ * When several datafeed callbacks are registered, they usually run one
+ * after the other for each packet. With parallel fan-out enabled, the
+ * callbacks for a packet get distributed to a pool of worker threads,
+ * and all of them must have returned before the next packet is passed
+ * on. Each callback still sees the packets in their original order.
+ *
+ * Callbacks must not depend on each other, and must be safe to execute
+ * from arbitrary threads.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param num_threads Number of worker threads, or 0 to run the callbacks
+ *                    sequentially (the default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_parallel_set(struct sr_session *session,
+		unsigned int num_threads)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
 	}
-	main_context = g_main_context_ref_thread_default();
-	/*
-	 * Try to use an existing main context if possible, but only if we
-	 * can make it owned by the current thread. Otherwise, create our
-	 * own main context so that event source callbacks can execute in
-	 * the session thread.
-	 */
-	if (g_main_context_acquire(main_context)) {
-		g_main_context_release(main_context);
-
-		sr_dbg("Using thread-default main context.");
-	} else {
-		g_main_context_unref(main_context);
 
-		sr_dbg("Creating our own main context.");
-		main_context = g_main_context_new();
+	if (session->running) {
+		sr_err("Cannot change fan-out while session is running.");
+		return SR_ERR;
 	}
-	session->main_context = main_context;
 
-	g_mutex_unlock(&session->main_mutex);
+	session->fanout_threads = num_threads;
 
 	return SR_OK;
 }
 
-/** Unset the main context used for the current session run.
+/**
+ * Run the event sources of each device in a thread of its own.
  *
- * Must be called right after stopping the session. Note that if the
- * session is stopped asynchronously, the main loop may still be running
- * after the main context has been unset. This is OK as long as no new
- * event sources are created -- the main loop holds its own reference
- * to the main context.
+ * Usually the event sources of all devices in a session get handled
+ * by the session main loop, in the thread which started the session.
+ * With device threads enabled, each device gets a GLib main context
+ * and a thread which runs it. This lets captures with several devices
+ * scale across CPU cores.
+ *
+ * Drivers start and stop acquisition in the context of their device's
+ * thread. Their datafeed packets still get serialized, so transforms
+ * and datafeed callbacks never run concurrently for different devices.
+ * Use sr_session_dispatch_async_set() to decouple the device threads
+ * from the datafeed consumers. The session stops when all devices did.
+ *
+ * Event sources which share a key (like the libusb event source) are
+ * handled by the thread of the device which installs them first.
+ *
+ * For USB devices, this gives libusb event handling a thread of its
+ * own: transfer completions get handled (and transfers resubmitted)
+ * in the device's thread, at a higher priority than other sources.
+ * Together with asynchronous dispatch, slow datafeed consumers then
+ * no longer delay the resubmission of transfers.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to run devices in threads of their own, FALSE to
+ *               run all of them in the session main loop (the default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
  */
-static int unset_main_context(struct sr_session *session)
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable)
 {
-	int ret;
+	if (!session)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change device threads while session is running.");
+		return SR_ERR;
+	}
+
+	session->device_threads = enable;
+
+	return SR_OK;
+}
+
+static void thread_policy_set(struct sr_thread_policy *policy,
+		const unsigned int *cpus, size_t cpu_count, int rt_priority)
+{
+	g_free(policy->cpus);
+	policy->cpus = NULL;
+	if (cpu_count) {
+		policy->cpus = g_malloc(cpu_count * sizeof(*cpus));
+		memcpy(policy->cpus, cpus, cpu_count * sizeof(*cpus));
+	}
+	policy->cpu_count = cpu_count;
+	policy->rt_priority = rt_priority;
+}
+
+/**
+ * Set the CPU affinity and scheduling of threads which a session creates.
+ *
+ * On capture hosts with several CPU sockets, sample data which crosses
+ * sockets on its way from the device to the consumer costs throughput.
+ * Pinning the session's threads to the CPUs which are local to the
+ * device's host controller avoids that, see sr_dev_local_cpus_get().
+ * Buffers get placed on the NUMA node of the thread which first writes
+ * to them, so the session's sample buffers of pinned device threads
+ * become local as well.
+ *
+ * A real-time priority lets device threads keep up with transfer
+ * completions when the host is busy otherwise. It usually needs extra
+ * privileges. Failure to apply a policy is not fatal, the thread then
+ * runs with the defaults.
+ *
+ * Policies apply to threads which get created when the session starts.
+ * The thread which runs the session main loop belongs to the caller.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param classes Bitwise OR of enum sr_thread_class values.
+ * @param cpus CPU numbers to run on. May be NULL to not restrict CPUs.
+ * @param cpu_count Number of CPU numbers in @p cpus.
+ * @param rt_priority SCHED_FIFO priority (1-99), 0 to keep the default
+ *                    scheduling.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_thread_policy_set(struct sr_session *session,
+		int classes, const unsigned int *cpus, size_t cpu_count,
+		int rt_priority)
+{
+	if (!session)
+		return SR_ERR_ARG;
+	if (cpu_count && !cpus)
+		return SR_ERR_ARG;
+	if (rt_priority < 0 || rt_priority > 99)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change thread policy while session is running.");
+		return SR_ERR;
+	}
+
+	if (classes & SR_THREAD_DEVICE)
+		thread_policy_set(&session->device_thread_policy,
+			cpus, cpu_count, rt_priority);
+	if (classes & SR_THREAD_DISPATCH)
+		thread_policy_set(&session->dispatch_thread_policy,
+			cpus, cpu_count, rt_priority);
+	if (classes & SR_THREAD_FANOUT)
+		thread_policy_set(&session->fanout_thread_policy,
+			cpus, cpu_count, rt_priority);
+
+	return SR_OK;
+}
+
+/**
+ * Accept bit planar logic data in the session's datafeed.
+ *
+ * Some devices capture logic data as a sequence of words per channel.
+ * By default their drivers convert it to SR_DF_LOGIC packets. When the
+ * session's transforms and datafeed callbacks handle SR_DF_LOGIC_PLANAR
+ * packets, those drivers can send the data as it was received instead,
+ * see struct sr_datafeed_logic_planar. Drivers without planar support
+ * keep sending SR_DF_LOGIC packets.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param accept TRUE to accept planar packets, FALSE to only receive
+ *               SR_DF_LOGIC packets (the default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_logic_planar_set(struct sr_session *session,
+		gboolean accept)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change planar logic while session is running.");
+		return SR_ERR;
+	}
+
+	session->logic_planar = accept;
+
+	return SR_OK;
+}
+
+/**
+ * Check whether drivers may send SR_DF_LOGIC_PLANAR packets.
+ *
+ * @param session The session to check.
+ *
+ * @return TRUE when the session accepts planar logic data.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_logic_planar_accepted(const struct sr_session *session)
+{
+	return session && session->logic_planar;
+}
+
+/**
+ * Get a snapshot of the session's datafeed statistics.
+ *
+ * The statistics cover the number of packets, bytes and samples which
+ * each device has sent, the run time of each transform and datafeed
+ * callback, and the fill level of the asynchronous dispatch queue.
+ * Streaming drivers also report their data transfers' timing, see
+ * struct sr_transfer_stats. Counters get reset when the session starts. The snapshot can be taken
+ * at any time, including while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Pointer to store the newly allocated statistics in.
+ *              Must not be NULL. The caller must release it with
+ *              sr_session_stats_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats)
+{
+	struct sr_session_stats *s;
+	struct datafeed_callback *cb_struct;
+	struct sr_transform *t;
+	GHashTableIter iter;
+	gpointer value;
+	GSList *l;
+	size_t idx;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	s = g_malloc0(sizeof(*s));
+
+	g_mutex_lock(&session->stats_mutex);
+
+	if (session->stats_start)
+		s->elapsed = g_get_monotonic_time() - session->stats_start;
+
+	s->num_devices = g_hash_table_size(session->dev_stats);
+	s->devices = g_malloc0((s->num_devices + 1) * sizeof(s->devices[0]));
+	idx = 0;
+	g_hash_table_iter_init(&iter, session->dev_stats);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		s->devices[idx++] = *(struct sr_dev_stats *)value;
+
+	s->num_transforms = g_slist_length(session->transforms);
+	s->transforms = g_malloc0((s->num_transforms + 1)
+		* sizeof(s->transforms[0]));
+	for (l = session->transforms, idx = 0; l; l = l->next) {
+		t = l->data;
+		s->transforms[idx++] = t->timing;
+	}
+
+	s->num_callbacks = g_slist_length(session->datafeed_callbacks);
+	s->callbacks = g_malloc0((s->num_callbacks + 1)
+		* sizeof(s->callbacks[0]));
+	for (l = session->datafeed_callbacks, idx = 0; l; l = l->next) {
+		cb_struct = l->data;
+		s->callbacks[idx++] = cb_struct->timing;
+	}
+
+	g_mutex_unlock(&session->stats_mutex);
+
+	if (session->dispatch) {
+		g_mutex_lock(&session->dispatch->mutex);
+		s->queue_high_water = session->dispatch_high_water;
+		s->queue_dropped = session->dispatch_dropped;
+		g_mutex_unlock(&session->dispatch->mutex);
+	} else {
+		s->queue_high_water = session->dispatch_high_water;
+		s->queue_dropped = session->dispatch_dropped;
+	}
+
+	*stats = s;
+
+	return SR_OK;
+}
+
+/**
+ * Free a snapshot of datafeed statistics.
+ *
+ * @param stats The statistics to free, as returned by
+ *              sr_session_stats_get(). Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_stats_free(struct sr_session_stats *stats)
+{
+	if (!stats)
+		return;
+
+	g_free(stats->devices);
+	g_free(stats->transforms);
+	g_free(stats->callbacks);
+	g_free(stats);
+}
+
+/**
+ * Get the trigger assigned to this session.
+ *
+ * @param session The session to use.
+ *
+ * @retval NULL Invalid (NULL) session was passed to the function.
+ * @retval other The trigger assigned to this session (can be NULL).
+ *
+ * @since 0.4.0
+ */
+SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session)
+{
+	if (!session)
+		return NULL;
+
+	return session->trigger;
+}
+
+/**
+ * Set the trigger of this session.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param trig The trigger to assign to this session. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	session->trigger = trig;
+
+	return SR_OK;
+}
+
+static int verify_trigger(struct sr_trigger *trigger)
+{
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	GSList *l, *m;
+
+	if (!trigger->stages) {
+		sr_err("No trigger stages defined.");
+		return SR_ERR;
+	}
+
+	sr_spew("Checking trigger:");
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		if (!stage->matches) {
+			sr_err("Stage %d has no matches defined.", stage->stage);
+			return SR_ERR;
+		}
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel) {
+				sr_err("Stage %d match has no channel.", stage->stage);
+				return SR_ERR;
+			}
+			if (!match->match) {
+				sr_err("Stage %d match is not defined.", stage->stage);
+				return SR_ERR;
+			}
+			sr_spew("Stage %d match on channel %s, match %d", stage->stage,
+					match->channel->name, match->match);
+		}
+	}
+
+	return SR_OK;
+}
+
+/** Set up the main context the session will be executing in.
+ *
+ * Must be called just before the session starts, by the thread which
+ * will execute the session main loop. Once acquired, the main context
+ * pointer is immutable for the duration of the session run.
+ */
+static int set_main_context(struct sr_session *session)
+{
+	GMainContext *main_context;
+
+	g_mutex_lock(&session->main_mutex);
+
+	/* May happen if sr_session_start() is called a second time
+	 * while the session is still running.
+	 */
+	if (session->main_context) {
+		sr_err("Main context already set.");
+
+		g_mutex_unlock(&session->main_mutex);
+		return SR_ERR;
+	}
+	main_context = g_main_context_ref_thread_default();
+	/*
+	 * Try to use an existing main context if possible, but only if we
+	 * can make it owned by the current thread. Otherwise, create our
+	 * own main context so that event source callbacks can execute in
+	 * the session thread.
+	 */
+	if (g_main_context_acquire(main_context)) {
+		g_main_context_release(main_context);
+
+		sr_dbg("Using thread-default main context.");
+	} else {
+		g_main_context_unref(main_context);
+
+		sr_dbg("Creating our own main context.");
+		main_context = g_main_context_new();
+	}
+	session->main_context = main_context;
+
+	g_mutex_unlock(&session->main_mutex);
+
+	return SR_OK;
+}
+
+/** Unset the main context used for the current session run.
+ *
+ * Must be called right after stopping the session. Note that if the
+ * session is stopped asynchronously, the main loop may still be running
+ * after the main context has been unset. This is OK as long as no new
+ * event sources are created -- the main loop holds its own reference
+ * to the main context.
+ */
+static int unset_main_context(struct sr_session *session)
+{
+	int ret;
 
 	g_mutex_lock(&session->main_mutex);
 
@@ -677,17 +1457,42 @@ static unsigned int session_source_attach(struct sr_session *session,
 static gboolean delayed_stop_check(void *data)
 {
 	struct sr_session *session;
+	unsigned int num_sources;
 
 	session = data;
+
+	g_mutex_lock(&session->main_mutex);
 	session->stop_check_id = 0;
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
 
 	/* Session already ended? */
 	if (!session->running)
 		return G_SOURCE_REMOVE;
 
 	/* New event sources may have been installed in the meantime. */
-	if (g_hash_table_size(session->event_sources) != 0)
+	if (num_sources != 0)
+		return G_SOURCE_REMOVE;
+
+	/*
+	 * Restart acquisition when requested, keeping the main context
+	 * and the session's threads. Check again after the devices have
+	 * (re-)installed their event sources. The next completion stops
+	 * the session, unless re-arming was requested again.
+	 */
+	if (g_atomic_int_compare_and_exchange(&session->rearm, TRUE, FALSE)) {
+		session_rearm_devices(session);
+		g_mutex_lock(&session->main_mutex);
+		num_sources = g_hash_table_size(session->event_sources);
+		g_mutex_unlock(&session->main_mutex);
+		if (num_sources == 0)
+			stop_check_later(session);
 		return G_SOURCE_REMOVE;
+	}
+
+	/* Terminate idle device threads, deliver packets still queued. */
+	device_loops_stop(session);
+	dispatch_stop(session);
 
 	session->running = FALSE;
 	unset_main_context(session);
@@ -710,25 +1515,251 @@ static gboolean delayed_stop_check(void *data)
 	return G_SOURCE_REMOVE;
 }
 
+/*
+ * Install the stop check in the session main context. May get called
+ * from device threads, which is why the source gets attached with the
+ * mutex held.
+ */
 static int stop_check_later(struct sr_session *session)
 {
 	GSource *source;
 	unsigned int source_id;
 
-	if (session->stop_check_id != 0)
-		return SR_OK; /* idle handler already installed */
+	g_mutex_lock(&session->main_mutex);
 
+	if (session->stop_check_id != 0) {
+		/* idle handler already installed */
+		g_mutex_unlock(&session->main_mutex);
+		return SR_OK;
+	}
+	if (!session->main_context) {
+		sr_err("Cannot add event source without main context.");
+		g_mutex_unlock(&session->main_mutex);
+		return SR_ERR;
+	}
+
+	/* Completion shall not wait for other pending events. */
 	source = g_idle_source_new();
+	g_source_set_priority(source, G_PRIORITY_HIGH);
 	g_source_set_callback(source, &delayed_stop_check, session, NULL);
 
-	source_id = session_source_attach(session, source);
+	source_id = g_source_attach(source, session->main_context);
 	session->stop_check_id = source_id;
 
+	g_mutex_unlock(&session->main_mutex);
+
 	g_source_unref(source);
 
 	return (source_id != 0) ? SR_OK : SR_ERR;
 }
 
+/* Thread routine which runs the main loop of one device. */
+static gpointer device_loop_thread(gpointer data)
+{
+	struct device_loop *dl;
+
+	dl = data;
+
+	sr_thread_policy_apply(&dl->session->device_thread_policy, "device");
+	g_main_context_push_thread_default(dl->context);
+	g_private_set(&current_device_loop, dl);
+	g_main_loop_run(dl->loop);
+	g_private_set(&current_device_loop, NULL);
+	g_main_context_pop_thread_default(dl->context);
+
+	return NULL;
+}
+
+static gboolean device_loop_quit(void *data)
+{
+	struct device_loop *dl;
+
+	dl = data;
+	g_main_loop_quit(dl->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Main context of the device loop which the current thread works for. */
+static GMainContext *device_loop_context(struct sr_session *session)
+{
+	struct device_loop *dl;
+
+	dl = g_private_get(&current_device_loop);
+	if (!dl || dl->session != session)
+		return NULL;
+
+	return dl->context;
+}
+
+/**
+ * The main context which event sources get attached to, when they are
+ * added by the calling thread: the device thread's own context, or the
+ * session's main context.
+ *
+ * @private
+ */
+SR_PRIV GMainContext *sr_session_source_context(struct sr_session *session)
+{
+	GMainContext *context;
+
+	context = device_loop_context(session);
+	if (context)
+		return context;
+
+	g_mutex_lock(&session->main_mutex);
+	context = session->main_context;
+	g_mutex_unlock(&session->main_mutex);
+
+	return context;
+}
+
+/*
+ * Start acquisition of a device, in a thread of its own. The device's
+ * event sources get attached to the device's main context before the
+ * thread starts to run it.
+ */
+static int device_loop_start(struct sr_session *session,
+		struct sr_dev_inst *sdi)
+{
+	struct device_loop *dl;
+	GError *error;
+	int ret;
+
+	dl = g_malloc0(sizeof(*dl));
+	dl->session = session;
+	dl->sdi = sdi;
+	dl->context = g_main_context_new();
+	dl->loop = g_main_loop_new(dl->context, FALSE);
+	session->device_loops = g_slist_append(session->device_loops, dl);
+
+	g_private_set(&current_device_loop, dl);
+	ret = sr_dev_acquisition_start(sdi);
+	g_private_set(&current_device_loop, NULL);
+	if (ret != SR_OK)
+		return ret;
+
+	error = NULL;
+	dl->thread = g_thread_try_new("sr-device", device_loop_thread, dl, &error);
+	if (!dl->thread) {
+		sr_err("Cannot create device thread: %s.", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Stop acquisition of a device. Runs in the device's thread. */
+static gboolean device_loop_stop_sync(void *data)
+{
+	struct device_loop *dl;
+
+	dl = data;
+	sr_dev_acquisition_stop(dl->sdi);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Get the device loop of a device. */
+static struct device_loop *device_loop_find(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	struct device_loop *dl;
+	GSList *l;
+
+	for (l = session->device_loops; l; l = l->next) {
+		dl = l->data;
+		if (dl->sdi == sdi)
+			return dl;
+	}
+
+	return NULL;
+}
+
+/*
+ * Restart acquisition of all devices within a running session. Runs in
+ * the session main context, after all devices have finished. Devices
+ * which have device threads get started with their loop selected.
+ */
+static int session_rearm_devices(struct sr_session *session)
+{
+	struct sr_dev_inst *sdi;
+	struct device_loop *dl;
+	GSList *l, *lend;
+	int ret;
+
+	sr_info("Re-arming.");
+
+	ret = SR_OK;
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		ret = sr_config_commit(sdi);
+		if (ret != SR_OK) {
+			sr_err("Failed to commit %s device %s settings "
+				"before re-arming acquisition.",
+				sdi->driver->name, sdi->connection_id);
+			break;
+		}
+		dl = device_loop_find(session, sdi);
+		if (dl)
+			g_private_set(&current_device_loop, dl);
+		ret = sr_dev_acquisition_start(sdi);
+		if (dl)
+			g_private_set(&current_device_loop, NULL);
+		if (ret != SR_OK) {
+			sr_err("Could not re-arm %s device %s acquisition.",
+				sdi->driver->name, sdi->connection_id);
+			break;
+		}
+	}
+	if (ret == SR_OK)
+		return SR_OK;
+
+	/* Stop the devices which did start, the session completes then. */
+	lend = l;
+	for (l = session->devs; l != lend; l = l->next) {
+		sdi = l->data;
+		dl = device_loop_find(session, sdi);
+		if (dl)
+			g_main_context_invoke(dl->context,
+				&device_loop_stop_sync, dl);
+		else
+			sr_dev_acquisition_stop(sdi);
+	}
+
+	return ret;
+}
+
+/* Terminate all device threads, and release their main contexts. */
+static void device_loops_stop(struct sr_session *session)
+{
+	struct device_loop *dl;
+	GSource *source;
+	GSList *l;
+
+	for (l = session->device_loops; l; l = l->next) {
+		dl = l->data;
+		if (dl->thread) {
+			/*
+			 * Quit from within the loop. A quit request which
+			 * happens before the thread entered the loop would
+			 * get lost.
+			 */
+			source = g_idle_source_new();
+			g_source_set_callback(source, &device_loop_quit, dl, NULL);
+			g_source_attach(source, dl->context);
+			g_source_unref(source);
+			g_thread_join(dl->thread);
+		}
+		g_main_loop_unref(dl->loop);
+		g_main_context_unref(dl->context);
+		g_free(dl);
+	}
+	g_slist_free(session->device_loops);
+	session->device_loops = NULL;
+}
+
 /**
  * Start a session.
  *
@@ -754,7 +1785,9 @@ SR_API int sr_session_start(struct sr_session *session)
 {
 	struct sr_dev_inst *sdi;
 	struct sr_channel *ch;
+	struct device_loop *dl;
 	GSList *l, *c, *lend;
+	unsigned int num_sources;
 	int ret;
 
 	if (!session) {
@@ -806,8 +1839,21 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
+	/* Resolve transforms and callbacks, latch the log level. */
+	dispatch_table_update(session);
+	sr_logic_layout_session_update(session);
+	stats_reset(session);
+	sr_session_timebase_reset(session->timebase);
+
+	ret = dispatch_start(session);
+	if (ret != SR_OK) {
+		unset_main_context(session);
+		return ret;
+	}
+
 	sr_info("Starting.");
 
+	g_atomic_int_set(&session->rearm, FALSE);
 	session->running = TRUE;
 
 	/* Have all devices start acquisition. */
@@ -817,7 +1863,10 @@ SR_API int sr_session_start(struct sr_session *session)
 			ret = SR_ERR;
 			break;
 		}
-		ret = sr_dev_acquisition_start(sdi);
+		if (session->device_threads)
+			ret = device_loop_start(session, sdi);
+		else
+			ret = sr_dev_acquisition_start(sdi);
 		if (ret != SR_OK) {
 			sr_err("Could not start %s device %s acquisition.",
 				sdi->driver->name, sdi->connection_id);
@@ -831,17 +1880,27 @@ SR_API int sr_session_start(struct sr_session *session)
 		lend = l->next;
 		for (l = session->devs; l != lend; l = l->next) {
 			sdi = l->data;
-			sr_dev_acquisition_stop(sdi);
+			dl = device_loop_find(session, sdi);
+			if (dl && dl->thread)
+				g_main_context_invoke(dl->context,
+					&device_loop_stop_sync, dl);
+			else
+				sr_dev_acquisition_stop(sdi);
 		}
 		/* TODO: Handle delayed stops. Need to iterate the event
 		 * sources... */
+		device_loops_stop(session);
+		dispatch_stop(session);
 		session->running = FALSE;
 
 		unset_main_context(session);
 		return ret;
 	}
 
-	if (g_hash_table_size(session->event_sources) == 0)
+	g_mutex_lock(&session->main_mutex);
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+	if (num_sources == 0)
 		stop_check_later(session);
 
 	return SR_OK;
@@ -903,6 +1962,7 @@ static gboolean session_stop_sync(void *user_data)
 {
 	struct sr_session *session;
 	struct sr_dev_inst *sdi;
+	struct device_loop *dl;
 	GSList *node;
 
 	session = user_data;
@@ -912,9 +1972,17 @@ static gboolean session_stop_sync(void *user_data)
 
 	sr_info("Stopping.");
 
+	/* An explicit stop overrides pending re-arm requests. */
+	g_atomic_int_set(&session->rearm, FALSE);
+
 	for (node = session->devs; node; node = node->next) {
 		sdi = node->data;
-		sr_dev_acquisition_stop(sdi);
+		dl = device_loop_find(session, sdi);
+		if (dl)
+			g_main_context_invoke(dl->context,
+				&device_loop_stop_sync, dl);
+		else
+			sr_dev_acquisition_stop(sdi);
 	}
 
 	return G_SOURCE_REMOVE;
@@ -971,6 +2039,48 @@ SR_API int sr_session_stop(struct sr_session *session)
 	return SR_OK;
 }
 
+/**
+ * Restart acquisition when the current session run completes.
+ *
+ * Instead of stopping when all devices have finished acquisition, the
+ * session restarts acquisition on the same devices right away. The
+ * session main context, sr_session_run(), the asynchronous dispatch
+ * and fan-out threads as well as device threads keep running. This
+ * avoids the turnaround time of a full stop and start for back-to-back
+ * captures. Each acquisition run sends its own SR_DF_HEADER and
+ * SR_DF_END packets. Statistics accumulate over re-armed runs.
+ *
+ * The request applies to the next completion only, call it again for
+ * each further re-arm. It can be issued from any thread, including
+ * from within datafeed callbacks (typically upon SR_DF_END). The
+ * session stops as usual when sr_session_stop() was called, or when
+ * restarting a device fails.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is not running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_rearm(struct sr_session *session)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!session->running) {
+		sr_err("Cannot re-arm a session which is not running.");
+		return SR_ERR;
+	}
+
+	g_atomic_int_set(&session->rearm, TRUE);
+
+	return SR_OK;
+}
+
 /**
  * Return whether the session is currently running.
  *
@@ -1035,6 +2145,9 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_runs *runs;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_logic_edges *edges;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1066,46 +2179,867 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RUNS:
+		runs = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RUNS packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", runs->num_runs, runs->unitsize);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_PLANAR packet (%" PRIu64
+		       " blocks, %d planes).", planar->num_blocks,
+		       planar->num_planes);
+		break;
+	case SR_DF_LOGIC_EDGES:
+		edges = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_EDGES packet (%" PRIu64
+		       " samples, %d channels).", edges->num_samples,
+		       edges->num_channels);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
 	}
 }
 
-/**
- * Helper to send a meta datafeed package (SR_DF_META) to the session bus.
- *
- * @param sdi The device instance to send the package from. Must not be NULL.
- * @param key The config key to send to the session bus.
- * @param var The value to send to the session bus.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR_ARG Invalid argument.
- *
- * @private
- */
-SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
-		uint32_t key, GVariant *var)
+/**
+ * Helper to send a meta datafeed package (SR_DF_META) to the session bus.
+ *
+ * @param sdi The device instance to send the package from. Must not be NULL.
+ * @param key The config key to send to the session bus.
+ * @param var The value to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
+		uint32_t key, GVariant *var)
+{
+	struct sr_config *cfg;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	int ret;
+
+	cfg = sr_config_new(key, var);
+
+	memset(&meta, 0, sizeof(meta));
+
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+
+	meta.config = g_slist_append(NULL, cfg);
+
+	ret = sr_session_send(sdi, &packet);
+	g_slist_free(meta.config);
+	sr_config_free(cfg);
+
+	return ret;
+}
+
+static void stats_reset(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	struct sr_transform *t;
+	GSList *l;
+
+	g_mutex_lock(&session->stats_mutex);
+	g_hash_table_remove_all(session->dev_stats);
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		memset(&t->timing, 0, sizeof(t->timing));
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		memset(&cb_struct->timing, 0, sizeof(cb_struct->timing));
+	}
+	session->stats_start = g_get_monotonic_time();
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/* Look up a device's statistics, the stats mutex must be held. */
+static struct sr_dev_stats *stats_dev_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_stats *dev_stats;
+
+	dev_stats = g_hash_table_lookup(session->dev_stats, sdi);
+	if (G_UNLIKELY(!dev_stats)) {
+		dev_stats = g_malloc0(sizeof(*dev_stats));
+		dev_stats->sdi = sdi;
+		g_hash_table_insert(session->dev_stats, (void *)sdi, dev_stats);
+	}
+
+	return dev_stats;
+}
+
+/* Account a packet which a device has sent. */
+static void stats_packet_add(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_runs *runs;
+	const struct sr_datafeed_logic_planar *planar;
+	uint64_t run;
+	struct sr_dev_stats *dev_stats;
+
+	g_mutex_lock(&session->stats_mutex);
+	dev_stats = stats_dev_get(session, sdi);
+	dev_stats->packets++;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		dev_stats->bytes += logic->length;
+		if (logic->unitsize)
+			dev_stats->samples += logic->length / logic->unitsize;
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		dev_stats->samples += analog->num_samples;
+		if (analog->encoding)
+			dev_stats->bytes += (uint64_t)analog->num_samples
+				* analog->encoding->unitsize;
+	} else if (packet->type == SR_DF_LOGIC_RUNS) {
+		runs = packet->payload;
+		dev_stats->bytes += runs->num_runs * runs->unitsize;
+		for (run = 0; run < runs->num_runs; run++)
+			dev_stats->samples += runs->lengths[run];
+	} else if (packet->type == SR_DF_LOGIC_PLANAR) {
+		planar = packet->payload;
+		dev_stats->bytes += planar->num_blocks * planar->num_planes
+			* sizeof(uint32_t);
+		dev_stats->samples += planar->num_blocks * 32;
+	}
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/**
+ * Publish a device's data transfer statistics.
+ *
+ * Streaming drivers (or their transfer engine) call this as their
+ * transfers complete. The statistics are part of the device's entry in
+ * sr_session_stats_get(), until the session is started again.
+ *
+ * @param sdi The device. Its session must be set.
+ * @param stats The current totals, copied.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_transfer_stats_set(const struct sr_dev_inst *sdi,
+		const struct sr_transfer_stats *stats)
+{
+	struct sr_session *session;
+
+	if (!sdi || !(session = sdi->session) || !stats)
+		return;
+
+	g_mutex_lock(&session->stats_mutex);
+	stats_dev_get(session, sdi)->transfers = *stats;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/* Account the run time since a start timestamp to a transform or callback. */
+static void stats_timing_add(struct sr_session *session,
+		struct sr_dispatch_timing *timing, int64_t start)
+{
+	uint64_t elapsed;
+
+	elapsed = g_get_monotonic_time() - start;
+
+	g_mutex_lock(&session->stats_mutex);
+	timing->calls++;
+	timing->time_total += elapsed;
+	if (elapsed > timing->time_max)
+		timing->time_max = elapsed;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+static void dispatch_table_free(struct dispatch_table *table)
+{
+	if (!table)
+		return;
+
+	g_free(table->transforms);
+	g_free(table->callbacks);
+	g_free(table);
+}
+
+/*
+ * (Re-)build the session's dispatch table. Called when the session
+ * starts, and by the dispatching thread after transforms or callbacks
+ * have changed.
+ */
+static struct dispatch_table *dispatch_table_update(struct sr_session *session)
+{
+	struct dispatch_table *table;
+	GSList *l;
+	size_t idx;
+
+	table = g_malloc0(sizeof(*table));
+
+	table->transforms_count = g_slist_length(session->transforms);
+	table->transforms = g_malloc0((table->transforms_count + 1)
+		* sizeof(table->transforms[0]));
+	for (l = session->transforms, idx = 0; l; l = l->next)
+		table->transforms[idx++] = l->data;
+
+	table->callbacks_count = g_slist_length(session->datafeed_callbacks);
+	table->callbacks = g_malloc0((table->callbacks_count + 1)
+		* sizeof(table->callbacks[0]));
+	for (l = session->datafeed_callbacks, idx = 0; l; l = l->next) {
+		table->callbacks[idx++] = l->data;
+		if (!table->callbacks[idx - 1]->runs)
+			table->expand_runs = TRUE;
+	}
+
+	table->dump = sr_log_loglevel_get() >= SR_LOG_DBG;
+	table->spew = sr_log_loglevel_get() >= SR_LOG_SPEW;
+
+	dispatch_table_free(session->dispatch_table);
+	session->dispatch_table = table;
+	session->dispatch_table_stale = FALSE;
+
+	return table;
+}
+
+/**
+ * Mark the session's dispatch table for re-build.
+ *
+ * Must be called after the list of transforms was modified.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_dispatch_invalidate(struct sr_session *session)
+{
+	session->dispatch_table_stale = TRUE;
+}
+
+/* Pass packets to a regular or a batched datafeed callback. */
+static void callback_run(struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *const *packets, size_t count)
+{
+	size_t idx;
+
+	if (cb_struct->batch_cb) {
+		cb_struct->batch_cb(sdi, packets, count, cb_struct->cb_data);
+		return;
+	}
+	for (idx = 0; idx < count; idx++)
+		cb_struct->cb(sdi, packets[idx], cb_struct->cb_data);
+}
+
+/* Fan-out worker thread routine, runs one datafeed callback. */
+static void fanout_worker(gpointer data, gpointer user_data)
+{
+	struct fanout_job *job;
+	struct session_fanout *fanout;
+	int64_t start;
+
+	job = data;
+	fanout = user_data;
+
+	/* Pool threads are exclusive, apply the policy once per thread. */
+	if (g_private_get(&fanout_policy_applied) != fanout) {
+		sr_thread_policy_apply(&job->sdi->session->fanout_thread_policy,
+			"fan-out");
+		g_private_set(&fanout_policy_applied, fanout);
+	}
+
+	start = g_get_monotonic_time();
+	callback_run(job->cb_struct, job->sdi, &job->packet, 1);
+	stats_timing_add(job->sdi->session, &job->cb_struct->timing, start);
+
+	g_mutex_lock(&fanout->mutex);
+	if (!--fanout->pending)
+		g_cond_signal(&fanout->done);
+	g_mutex_unlock(&fanout->mutex);
+}
+
+/* Run all callbacks for one packet on the workers, wait for completion. */
+static int fanout_run(struct session_fanout *fanout,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		struct datafeed_callback **callbacks, size_t count)
+{
+	struct datafeed_callback *cb_struct;
+	struct fanout_job *job;
+	int64_t start;
+	size_t idx;
+
+	if (count < 2)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&fanout->mutex);
+	if (fanout->busy) {
+		g_mutex_unlock(&fanout->mutex);
+		return SR_ERR_NA;
+	}
+	fanout->busy = TRUE;
+	if (fanout->jobs_size < count) {
+		g_free(fanout->jobs);
+		fanout->jobs = g_malloc0(count * sizeof(fanout->jobs[0]));
+		fanout->jobs_size = count;
+	}
+	fanout->pending = count - 1;
+	g_mutex_unlock(&fanout->mutex);
+
+	/* Hand all but the first callback to workers, run that one here. */
+	for (idx = 1; idx < count; idx++) {
+		job = &fanout->jobs[idx];
+		job->fanout = fanout;
+		job->cb_struct = callbacks[idx];
+		job->sdi = sdi;
+		job->packet = packet;
+		g_thread_pool_push(fanout->pool, job, NULL);
+	}
+	cb_struct = callbacks[0];
+	start = g_get_monotonic_time();
+	callback_run(cb_struct, sdi, &packet, 1);
+	stats_timing_add(sdi->session, &cb_struct->timing, start);
+
+	/* All consumers are done with this packet before the next one. */
+	g_mutex_lock(&fanout->mutex);
+	while (fanout->pending)
+		g_cond_wait(&fanout->done, &fanout->mutex);
+	fanout->busy = FALSE;
+	g_mutex_unlock(&fanout->mutex);
+
+	return SR_OK;
+}
+
+static int fanout_start(struct sr_session *session)
+{
+	struct session_fanout *fanout;
+	GError *error;
+
+	if (!session->fanout_threads)
+		return SR_OK;
+
+	fanout = g_malloc0(sizeof(*fanout));
+	g_mutex_init(&fanout->mutex);
+	g_cond_init(&fanout->done);
+
+	error = NULL;
+	fanout->pool = g_thread_pool_new(fanout_worker, fanout,
+		session->fanout_threads, TRUE, &error);
+	if (!fanout->pool) {
+		sr_err("Cannot create fan-out threads: %s.", error->message);
+		g_error_free(error);
+		g_cond_clear(&fanout->done);
+		g_mutex_clear(&fanout->mutex);
+		g_free(fanout);
+		return SR_ERR;
+	}
+	sr_dbg("Running datafeed callbacks on %u threads.",
+		session->fanout_threads);
+	session->fanout = fanout;
+
+	return SR_OK;
+}
+
+static void fanout_stop(struct sr_session *session)
+{
+	struct session_fanout *fanout;
+
+	fanout = session->fanout;
+	if (!fanout)
+		return;
+
+	session->fanout = NULL;
+	g_thread_pool_free(fanout->pool, FALSE, TRUE);
+	g_cond_clear(&fanout->done);
+	g_mutex_clear(&fanout->mutex);
+	g_free(fanout->jobs);
+	g_free(fanout);
+}
+
+/* Logic samples per block, when kernels of transforms get fused. */
+#define FUSED_BLOCK_SAMPLES 4096
+
+/*
+ * Run the logic kernels of consecutive transforms, starting at the
+ * given one. All of them process one block of samples, while it is in
+ * the cache, before the next block is done. Returns the index of the
+ * first transform after the fused ones.
+ */
+static size_t transforms_run_fused(struct sr_session *session,
+		struct dispatch_table *table, size_t first,
+		const struct sr_datafeed_logic *logic, int *ret)
+{
+	struct sr_transform *t;
+	uint8_t *data;
+	size_t last, count, pos, n, idx;
+	int64_t start;
+
+	for (last = first; last < table->transforms_count; last++) {
+		if (!table->transforms[last]->module->logic_kernel)
+			break;
+	}
+
+	*ret = SR_OK;
+	count = logic->unitsize ? logic->length / logic->unitsize : 0;
+	for (pos = 0; pos < count && *ret == SR_OK; pos += n) {
+		n = MIN(count - pos, FUSED_BLOCK_SAMPLES);
+		data = (uint8_t *)logic->data + pos * logic->unitsize;
+		for (idx = first; idx < last && *ret == SR_OK; idx++) {
+			t = table->transforms[idx];
+			start = g_get_monotonic_time();
+			*ret = t->module->logic_kernel(t, data, logic->unitsize, n);
+			stats_timing_add(session, &t->timing, start);
+		}
+	}
+
+	return last;
+}
+
+/* Samples per SR_DF_LOGIC packet, when runs get expanded for callbacks. */
+#define RUNS_EXPAND_SAMPLES (64 * 1024)
+
+/*
+ * Pass a SR_DF_LOGIC_RUNS packet to the datafeed callbacks. Those which
+ * accept runs get the packet as it is, the others get its samples
+ * expanded into SR_DF_LOGIC packets of bounded size.
+ */
+static void callbacks_run_runs(const struct sr_dev_inst *sdi,
+		struct dispatch_table *table,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	const struct sr_datafeed_logic_runs *runs;
+	struct sr_datafeed_packet logic_packet;
+	const struct sr_datafeed_packet *logic_ptr;
+	struct sr_datafeed_logic logic;
+	struct datafeed_callback *cb_struct;
+	uint64_t run, offset, count;
+	uint8_t *buf;
+	int64_t start;
+	size_t idx;
+
+	session = sdi->session;
+	for (idx = 0; idx < table->callbacks_count; idx++) {
+		cb_struct = table->callbacks[idx];
+		if (!cb_struct->runs)
+			continue;
+		start = g_get_monotonic_time();
+		callback_run(cb_struct, sdi, &packet, 1);
+		stats_timing_add(session, &cb_struct->timing, start);
+	}
+
+	runs = packet->payload;
+	if (!runs->unitsize)
+		return;
+	buf = g_malloc(RUNS_EXPAND_SAMPLES * runs->unitsize);
+	logic.unitsize = runs->unitsize;
+	logic.data = buf;
+	logic_packet.type = SR_DF_LOGIC;
+	logic_packet.payload = &logic;
+	logic_ptr = &logic_packet;
+	run = offset = 0;
+	while ((count = sr_logic_runs_expand(runs, &run, &offset,
+			buf, RUNS_EXPAND_SAMPLES))) {
+		logic.length = count * runs->unitsize;
+		for (idx = 0; idx < table->callbacks_count; idx++) {
+			cb_struct = table->callbacks[idx];
+			if (cb_struct->runs)
+				continue;
+			start = g_get_monotonic_time();
+			callback_run(cb_struct, sdi, &logic_ptr, 1);
+			stats_timing_add(session, &cb_struct->timing, start);
+		}
+	}
+	g_free(buf);
+}
+
+/*
+ * Run the transforms from the given one on, then the datafeed callbacks
+ * for a packet.
+ */
+static int dispatch_from(const struct sr_dev_inst *sdi,
+		struct dispatch_table *table, size_t first,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	struct datafeed_callback *cb_struct;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	int64_t start;
+	size_t idx;
+	int ret;
+
+	session = sdi->session;
+
+	/*
+	 * Pass the packet to the first transform module. If that returns
+	 * another packet (instead of NULL), pass that packet to the next
+	 * transform module in the list, and so on. Transforms with logic
+	 * kernels get run in one fused pass over logic packets.
+	 */
+	packet_in = (struct sr_datafeed_packet *)packet;
+	idx = first;
+	while (idx < table->transforms_count) {
+		t = table->transforms[idx];
+		if (packet_in->type == SR_DF_LOGIC && t->module->logic_kernel) {
+			idx = transforms_run_fused(session, table, idx,
+				packet_in->payload, &ret);
+			if (ret < 0) {
+				sr_err("Error while running transform kernel: %d.", ret);
+				return SR_ERR;
+			}
+			continue;
+		}
+		if (G_UNLIKELY(table->spew))
+			sr_spew("Running transform module '%s'.", t->module->id);
+		start = g_get_monotonic_time();
+		ret = t->module->receive(t, packet_in, &packet_out);
+		stats_timing_add(session, &t->timing, start);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			return SR_ERR;
+		}
+		if (!packet_out) {
+			/*
+			 * The transform consumed the packet. It may have
+			 * passed on (several) packets of its own already,
+			 * see sr_transform_send().
+			 */
+			if (G_UNLIKELY(table->spew))
+				sr_spew("Transform module didn't return a packet, done.");
+			return SR_OK;
+		}
+		/*
+		 * Use this transform module's output packet as input
+		 * for the next transform module.
+		 */
+		packet_in = packet_out;
+		idx++;
+	}
+	packet = packet_in;
+
+	if (G_UNLIKELY(table->dump))
+		datafeed_dump(packet);
+
+	/* Outputs get going on their threads while the callbacks run. */
+	if (session->outputs)
+		sr_session_outputs_feed(session->outputs, sdi, packet);
+	if (session->store)
+		sr_session_store_feed(session->store, sdi, packet);
+
+	if (packet->type == SR_DF_LOGIC_RUNS && table->expand_runs) {
+		callbacks_run_runs(sdi, table, packet);
+		return SR_OK;
+	}
+
+	/*
+	 * If the last transform did output a packet, pass it to all datafeed
+	 * callbacks. Use the worker threads when parallel fan-out is enabled
+	 * (and not busy with an outer packet already, for nested sends).
+	 */
+	if (session->fanout) {
+		ret = fanout_run(session->fanout, sdi, packet,
+			table->callbacks, table->callbacks_count);
+		if (ret == SR_OK)
+			return SR_OK;
+	}
+	for (idx = 0; idx < table->callbacks_count; idx++) {
+		cb_struct = table->callbacks[idx];
+		start = g_get_monotonic_time();
+		callback_run(cb_struct, sdi, &packet, 1);
+		stats_timing_add(session, &cb_struct->timing, start);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Run the transforms and the datafeed callbacks for a packet. This is
+ * where the packet actually gets dispatched, either immediately from
+ * within sr_session_send(), or in the asynchronous dispatch thread.
+ */
+static int session_dispatch_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	struct dispatch_table *table;
+
+	session = sdi->session;
+	table = session->dispatch_table;
+	if (G_UNLIKELY(session->dispatch_table_stale || !table))
+		table = dispatch_table_update(session);
+
+	stats_packet_add(session, sdi, packet);
+	if (session->recorder)
+		sr_session_recorder_feed(session->recorder, sdi, packet);
+
+	return dispatch_from(sdi, table, 0, packet);
+}
+
+/**
+ * Pass a packet on from within a transform's receive() callback.
+ *
+ * The packet runs through the transforms after the given one, and then
+ * gets sent to the datafeed callbacks. This lets a transform split a
+ * packet into several ones, or emit packets of its own. The packet only
+ * needs to be valid during this call. The transform then typically
+ * returns NULL from its receive() callback.
+ *
+ * @param t The transform which emits the packet. Must not be NULL.
+ * @param packet The packet to pass on. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or not called from within the
+ *                    session's dispatch.
+ *
+ * @private
+ */
+SR_PRIV int sr_transform_send(const struct sr_transform *t,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	struct dispatch_table *table;
+	size_t idx;
+
+	if (!t || !t->sdi || !packet || !(session = t->sdi->session))
+		return SR_ERR_ARG;
+	table = session->dispatch_table;
+	if (!table)
+		return SR_ERR_ARG;
+
+	for (idx = 0; idx < table->transforms_count; idx++) {
+		if (table->transforms[idx] == t)
+			return dispatch_from(t->sdi, table, idx + 1, packet);
+	}
+
+	return SR_ERR_ARG;
+}
+
+/*
+ * Dispatch several packets of a device at once. Without transforms,
+ * each callback gets invoked once for the whole batch. Transforms can
+ * return packets which only are valid until their next invocation, so
+ * batches get dispatched packet by packet when transforms are present.
+ * So do batches with runs which need expanding for some callback.
+ */
+static int session_dispatch_batch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *const *packets, size_t count)
+{
+	struct sr_session *session;
+	struct dispatch_table *table;
+	struct datafeed_callback *cb_struct;
+	gboolean per_packet;
+	int64_t start;
+	size_t idx;
+	int ret;
+
+	session = sdi->session;
+	table = session->dispatch_table;
+	if (G_UNLIKELY(session->dispatch_table_stale || !table))
+		table = dispatch_table_update(session);
+
+	per_packet = table->transforms_count > 0;
+	for (idx = 0; idx < count && !per_packet; idx++) {
+		if (packets[idx]->type == SR_DF_LOGIC_RUNS && table->expand_runs)
+			per_packet = TRUE;
+	}
+	if (per_packet) {
+		for (idx = 0; idx < count; idx++) {
+			ret = session_dispatch_packet(sdi, packets[idx]);
+			if (ret != SR_OK)
+				return ret;
+		}
+		return SR_OK;
+	}
+
+	for (idx = 0; idx < count; idx++) {
+		stats_packet_add(session, sdi, packets[idx]);
+		if (session->recorder)
+			sr_session_recorder_feed(session->recorder,
+				sdi, packets[idx]);
+		if (G_UNLIKELY(table->dump))
+			datafeed_dump(packets[idx]);
+		if (session->outputs)
+			sr_session_outputs_feed(session->outputs,
+				sdi, packets[idx]);
+		if (session->store)
+			sr_session_store_feed(session->store,
+				sdi, packets[idx]);
+	}
+
+	for (idx = 0; idx < table->callbacks_count; idx++) {
+		cb_struct = table->callbacks[idx];
+		start = g_get_monotonic_time();
+		callback_run(cb_struct, sdi, packets, count);
+		stats_timing_add(session, &cb_struct->timing, start);
+	}
+
+	return SR_OK;
+}
+
+/* Worker thread of the asynchronous datafeed dispatch. */
+static gpointer dispatch_thread(gpointer data)
+{
+	struct session_dispatch *dispatch;
+	struct dispatch_item item;
+
+	dispatch = data;
+
+	sr_thread_policy_apply(&dispatch->session->dispatch_thread_policy,
+		"dispatch");
+
+	g_mutex_lock(&dispatch->mutex);
+	while (TRUE) {
+		while (!dispatch->count && !dispatch->quit)
+			g_cond_wait(&dispatch->not_empty, &dispatch->mutex);
+		/* Only terminate after the queue was drained. */
+		if (!dispatch->count)
+			break;
+		item = dispatch->items[dispatch->head];
+		dispatch->head = (dispatch->head + 1) % dispatch->depth;
+		dispatch->count--;
+		g_cond_signal(&dispatch->not_full);
+		g_mutex_unlock(&dispatch->mutex);
+
+		session_dispatch_packet(item.sdi, item.packet);
+		sr_packet_unref(item.packet);
+
+		g_mutex_lock(&dispatch->mutex);
+	}
+	g_mutex_unlock(&dispatch->mutex);
+
+	return NULL;
+}
+
+/* Setup the dispatch queue and thread, if the session asked for it. */
+static int dispatch_start(struct sr_session *session)
+{
+	struct session_dispatch *dispatch;
+	GError *error;
+	int ret;
+
+	session->dispatch_dropped = 0;
+	session->dispatch_high_water = 0;
+
+	ret = fanout_start(session);
+	if (ret != SR_OK)
+		return ret;
+	if (!session->dispatch_depth)
+		return SR_OK;
+
+	dispatch = g_malloc0(sizeof(*dispatch));
+	dispatch->session = session;
+	dispatch->depth = session->dispatch_depth;
+	dispatch->items = g_malloc0(dispatch->depth * sizeof(dispatch->items[0]));
+	g_mutex_init(&dispatch->mutex);
+	g_cond_init(&dispatch->not_empty);
+	g_cond_init(&dispatch->not_full);
+
+	error = NULL;
+	dispatch->thread = g_thread_try_new("sr-dispatch",
+		dispatch_thread, dispatch, &error);
+	if (!dispatch->thread) {
+		sr_err("Cannot create dispatch thread: %s.", error->message);
+		g_error_free(error);
+		g_cond_clear(&dispatch->not_full);
+		g_cond_clear(&dispatch->not_empty);
+		g_mutex_clear(&dispatch->mutex);
+		g_free(dispatch->items);
+		g_free(dispatch);
+		fanout_stop(session);
+		return SR_ERR;
+	}
+	sr_dbg("Dispatching datafeed asynchronously, queue depth %zu.",
+		dispatch->depth);
+	session->dispatch = dispatch;
+
+	return SR_OK;
+}
+
+/* Drain the dispatch queue, and terminate the dispatch threads. */
+static void dispatch_stop(struct sr_session *session)
 {
-	struct sr_config *cfg;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_meta meta;
-	int ret;
+	struct session_dispatch *dispatch;
 
-	cfg = sr_config_new(key, var);
+	dispatch = session->dispatch;
+	if (!dispatch) {
+		fanout_stop(session);
+		return;
+	}
 
-	memset(&meta, 0, sizeof(meta));
+	g_mutex_lock(&dispatch->mutex);
+	dispatch->quit = TRUE;
+	g_cond_signal(&dispatch->not_empty);
+	g_mutex_unlock(&dispatch->mutex);
+	g_thread_join(dispatch->thread);
+
+	/* Queue contents may be sent again after this point. */
+	session->dispatch = NULL;
+	if (session->dispatch_dropped)
+		sr_warn("Dispatch queue dropped %" PRIu64 " packets.",
+			session->dispatch_dropped);
+
+	g_cond_clear(&dispatch->not_full);
+	g_cond_clear(&dispatch->not_empty);
+	g_mutex_clear(&dispatch->mutex);
+	g_free(dispatch->items);
+	g_free(dispatch);
+
+	fanout_stop(session);
+}
 
-	packet.type = SR_DF_META;
-	packet.payload = &meta;
+/* Queue a reference to a packet for the dispatch thread. */
+static int dispatch_push(struct session_dispatch *dispatch,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	struct sr_datafeed_packet *copy;
+	struct dispatch_item *item;
+	gboolean droppable;
+	int ret;
 
-	meta.config = g_slist_append(NULL, cfg);
+	session = dispatch->session;
+	droppable = session->dispatch_policy == SR_DISPATCH_DROP
+		&& (packet->type == SR_DF_LOGIC || packet->type == SR_DF_ANALOG
+		|| packet->type == SR_DF_LOGIC_RUNS
+		|| packet->type == SR_DF_LOGIC_PLANAR);
+
+	/* Check before copying, dropping shall be cheap. */
+	g_mutex_lock(&dispatch->mutex);
+	if (droppable && dispatch->count == dispatch->depth) {
+		session->dispatch_dropped++;
+		g_mutex_unlock(&dispatch->mutex);
+		return SR_OK;
+	}
+	g_mutex_unlock(&dispatch->mutex);
 
-	ret = sr_session_send(sdi, &packet);
-	g_slist_free(meta.config);
-	sr_config_free(cfg);
+	/* Buffer backed packets get queued without copying sample data. */
+	ret = sr_packet_ref(packet, &copy);
+	if (ret != SR_OK)
+		return ret;
 
-	return ret;
+	g_mutex_lock(&dispatch->mutex);
+	while (dispatch->count == dispatch->depth) {
+		if (droppable) {
+			session->dispatch_dropped++;
+			g_mutex_unlock(&dispatch->mutex);
+			sr_packet_unref(copy);
+			return SR_OK;
+		}
+		g_cond_wait(&dispatch->not_full, &dispatch->mutex);
+	}
+	item = &dispatch->items[(dispatch->head + dispatch->count) % dispatch->depth];
+	item->sdi = sdi;
+	item->packet = copy;
+	dispatch->count++;
+	if (dispatch->count > session->dispatch_high_water)
+		session->dispatch_high_water = dispatch->count;
+	g_cond_signal(&dispatch->not_empty);
+	g_mutex_unlock(&dispatch->mutex);
+
+	return SR_OK;
 }
 
 /**
@@ -1124,10 +3058,7 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
+	struct session_dispatch *dispatch;
 	int ret;
 
 	if (!sdi) {
@@ -1145,49 +3076,159 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	sr_session_timebase_feed(sdi->session->timebase, sdi, packet);
+
 	/*
-	 * Pass the packet to the first transform module. If that returns
-	 * another packet (instead of NULL), pass that packet to the next
-	 * transform module in the list, and so on.
+	 * Packets which get sent from within the dispatch thread itself
+	 * (by datafeed callbacks) must not wait for the queue to drain.
 	 */
-	packet_in = (struct sr_datafeed_packet *)packet;
-	for (l = sdi->session->transforms; l; l = l->next) {
-		t = l->data;
-		sr_spew("Running transform module '%s'.", t->module->id);
-		ret = t->module->receive(t, packet_in, &packet_out);
-		if (ret < 0) {
-			sr_err("Error while running transform module: %d.", ret);
-			return SR_ERR;
-		}
-		if (!packet_out) {
-			/*
-			 * If any of the transforms don't return an output
-			 * packet, abort.
-			 */
-			sr_spew("Transform module didn't return a packet, aborting.");
-			return SR_OK;
-		} else {
-			/*
-			 * Use this transform module's output packet as input
-			 * for the next transform module.
-			 */
-			packet_in = packet_out;
+	dispatch = sdi->session->dispatch;
+	if (dispatch && g_thread_self() != dispatch->thread)
+		return dispatch_push(dispatch, sdi, packet);
+
+	/* Device threads take turns in feeding the session. */
+	if (sdi->session->device_loops) {
+		g_rec_mutex_lock(&sdi->session->feed_mutex);
+		ret = session_dispatch_packet(sdi, packet);
+		g_rec_mutex_unlock(&sdi->session->feed_mutex);
+		return ret;
+	}
+
+	return session_dispatch_packet(sdi, packet);
+}
+
+/**
+ * Send several packets of a device to the datafeed bus at once.
+ *
+ * Drivers which produce many small packets can use this to save the
+ * per packet dispatch overhead. Batched datafeed callbacks receive the
+ * packets in a single invocation, regular callbacks receive them one
+ * after the other. The packets only need to remain valid until this
+ * routine returns.
+ *
+ * @param sdi The device instance which sends the packets. Must not be NULL.
+ * @param packets Array of the packets to send. Must not be NULL.
+ * @param count The number of packets in @a packets.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_many(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *const *packets, size_t count)
+{
+	struct session_dispatch *dispatch;
+	size_t idx;
+	int ret;
+
+	if (!sdi) {
+		sr_err("%s: sdi was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!packets) {
+		sr_err("%s: packets was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!sdi->session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!count)
+		return SR_OK;
+
+	for (idx = 0; idx < count; idx++)
+		sr_session_timebase_feed(sdi->session->timebase,
+			sdi, packets[idx]);
+
+	dispatch = sdi->session->dispatch;
+	if (dispatch && g_thread_self() != dispatch->thread) {
+		for (idx = 0; idx < count; idx++) {
+			ret = dispatch_push(dispatch, sdi, packets[idx]);
+			if (ret != SR_OK)
+				return ret;
 		}
+		return SR_OK;
 	}
-	packet = packet_in;
 
-	/*
-	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
-	 */
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
-		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	if (sdi->session->device_loops) {
+		g_rec_mutex_lock(&sdi->session->feed_mutex);
+		ret = session_dispatch_batch(sdi, packets, count);
+		g_rec_mutex_unlock(&sdi->session->feed_mutex);
+		return ret;
 	}
 
-	return SR_OK;
+	return session_dispatch_batch(sdi, packets, count);
+}
+
+/**
+ * Send a packet whose sample data resides in a reference counted buffer.
+ *
+ * The packet's logic or analog data pointer must point into @a buf.
+ * Consumers which need the packet beyond the callback's lifetime can
+ * take a reference by means of sr_packet_ref(), which then does not
+ * copy the sample data. The buffer's release callback runs when the
+ * last reference to the packet was dropped, which may be after this
+ * routine returns. The caller keeps its own reference to @a buf.
+ *
+ * Other packet types are sent like sr_session_send() does.
+ *
+ * @param sdi The device instance to send the packet from.
+ * @param packet The datafeed packet to send to the session bus.
+ * @param buf The buffer which holds the packet's sample data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf)
+{
+	struct shared_packet *shared;
+	const struct sr_datafeed_analog *analog;
+	int ret;
+
+	if (!packet || !buf)
+		return SR_ERR_ARG;
+
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_ANALOG)
+		return sr_session_send(sdi, packet);
+
+	shared = g_malloc0(sizeof(*shared));
+	shared->refcount = 1;
+	shared->buffer = sr_buffer_ref(buf);
+	shared->packet = &shared->buf_packet;
+	shared->buf_packet.type = packet->type;
+	if (packet->type == SR_DF_LOGIC) {
+		shared->buf_payload.logic = *(const struct sr_datafeed_logic *)packet->payload;
+		shared->buf_packet.payload = &shared->buf_payload.logic;
+	} else {
+		analog = packet->payload;
+		shared->buf_payload.analog = *analog;
+		shared->buf_encoding = *analog->encoding;
+		shared->buf_meaning = *analog->meaning;
+		shared->buf_meaning.channels = g_slist_copy(analog->meaning->channels);
+		shared->buf_spec = *analog->spec;
+		shared->buf_payload.analog.encoding = &shared->buf_encoding;
+		shared->buf_payload.analog.meaning = &shared->buf_meaning;
+		shared->buf_payload.analog.spec = &shared->buf_spec;
+		shared->buf_packet.payload = &shared->buf_payload.analog;
+	}
+
+	g_mutex_lock(&shared_packets_mutex);
+	if (!shared_packets)
+		shared_packets = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(shared_packets, shared->packet, shared);
+	g_mutex_unlock(&shared_packets_mutex);
+
+	ret = sr_session_send(sdi, shared->packet);
+	sr_packet_unref(shared->packet);
+
+	return ret;
 }
 
 /**
@@ -1213,13 +3254,25 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 	 * already installed source. (Well it would, if we did not have
 	 * another sanity check there.)
 	 */
+	GMainContext *context;
+	unsigned int id;
+
+	g_mutex_lock(&session->main_mutex);
 	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source with key %p already exists.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (session_source_attach(session, source) == 0)
+	/* Sources of device threads go to the device's main context. */
+	context = device_loop_context(session);
+	if (context)
+		id = g_source_attach(source, context);
+	else
+		id = session_source_attach(session, source);
+	if (id == 0)
 		return SR_ERR;
 
 	return SR_OK;
@@ -1357,7 +3410,11 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 {
 	GSource *source;
 
+	g_mutex_lock(&session->main_mutex);
 	source = g_hash_table_lookup(session->event_sources, key);
+	if (source)
+		g_source_ref(source);
+	g_mutex_unlock(&session->main_mutex);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
@@ -1366,7 +3423,9 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 		sr_warn("Cannot remove non-existing event source %p.", key);
 		return SR_ERR_BUG;
 	}
+	/* Finalization unregisters the source, which takes the mutex. */
 	g_source_destroy(source);
+	g_source_unref(source);
 
 	return SR_OK;
 }
@@ -1453,24 +3512,30 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		void *key, GSource *source)
 {
 	GSource *registered_source;
+	unsigned int num_sources;
 
+	g_mutex_lock(&session->main_mutex);
 	registered_source = g_hash_table_lookup(session->event_sources, key);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
 	 */
 	if (!registered_source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("No event source for key %p found.", key);
 		return SR_ERR_BUG;
 	}
 	if (registered_source != source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source for key %p does not match"
 			" destroyed source.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_remove(session->event_sources, key);
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (g_hash_table_size(session->event_sources) > 0)
+	if (num_sources > 0)
 		return SR_OK;
 
 	/* If no event sources are left, consider the acquisition finished.
@@ -1503,9 +3568,17 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_logic *logic_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
+	const struct sr_datafeed_logic_runs *runs;
+	struct sr_datafeed_logic_runs *runs_copy;
+	const struct sr_datafeed_logic_planar *planar;
+	struct sr_datafeed_logic_planar *planar_copy;
+	const struct sr_datafeed_logic_edges *edges;
+	struct sr_datafeed_logic_edges *edges_copy;
+	size_t words;
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
+	int64_t *timestamps_copy;
 	uint8_t *payload;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
@@ -1514,6 +3587,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +3599,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,12 +3609,15 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
+		/* The logic length is in bytes, not in samples. */
+		logic_copy->data = g_try_malloc(logic->length);
+		if (logic->length && !logic_copy->data) {
 			g_free(logic_copy);
-			return SR_ERR;
+			g_free(*copy);
+			*copy = NULL;
+			return SR_ERR_MALLOC;
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
+		memcpy(logic_copy->data, logic->data, logic->length);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
@@ -1550,6 +3628,14 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		memcpy(analog_copy->data, analog->data,
 				analog->encoding->unitsize * analog->num_samples);
 		analog_copy->num_samples = analog->num_samples;
+		analog_copy->timestamps = NULL;
+		if (analog->timestamps) {
+			timestamps_copy = g_malloc(analog->num_samples *
+				sizeof(analog->timestamps[0]));
+			memcpy(timestamps_copy, analog->timestamps,
+				analog->num_samples * sizeof(analog->timestamps[0]));
+			analog_copy->timestamps = timestamps_copy;
+		}
 #if GLIB_CHECK_VERSION(2, 67, 3)
 		encoding_copy = g_memdup2(analog->encoding, sizeof(*analog->encoding));
 		meaning_copy = g_memdup2(analog->meaning, sizeof(*analog->meaning));
@@ -1566,6 +3652,50 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RUNS:
+		runs = packet->payload;
+		runs_copy = g_malloc(sizeof(*runs_copy));
+		runs_copy->num_runs = runs->num_runs;
+		runs_copy->unitsize = runs->unitsize;
+		runs_copy->data = g_malloc(runs->num_runs * runs->unitsize);
+		memcpy(runs_copy->data, runs->data,
+				runs->num_runs * runs->unitsize);
+		runs_copy->lengths = g_malloc(runs->num_runs * sizeof(uint64_t));
+		memcpy(runs_copy->lengths, runs->lengths,
+				runs->num_runs * sizeof(uint64_t));
+		(*copy)->payload = runs_copy;
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		planar_copy = g_malloc(sizeof(*planar_copy));
+		*planar_copy = *planar;
+		planar_copy->plane_bits = g_malloc(planar->num_planes);
+		memcpy(planar_copy->plane_bits, planar->plane_bits,
+				planar->num_planes);
+		words = planar->num_blocks * planar->num_planes;
+		planar_copy->data = g_malloc(words * sizeof(uint32_t));
+		memcpy(planar_copy->data, planar->data,
+				words * sizeof(uint32_t));
+		(*copy)->payload = planar_copy;
+		break;
+	case SR_DF_LOGIC_EDGES:
+		edges = packet->payload;
+		edges_copy = g_malloc(sizeof(*edges_copy));
+		*edges_copy = *edges;
+		edges_copy->channels = g_malloc(edges->num_channels
+				* sizeof(uint16_t));
+		memcpy(edges_copy->channels, edges->channels,
+				edges->num_channels * sizeof(uint16_t));
+		edges_copy->offsets = g_malloc((edges->num_channels + 1)
+				* sizeof(uint64_t));
+		memcpy(edges_copy->offsets, edges->offsets,
+				(edges->num_channels + 1) * sizeof(uint64_t));
+		words = edges->offsets[edges->num_channels];
+		edges_copy->positions = g_malloc(words * sizeof(uint64_t));
+		memcpy(edges_copy->positions, edges->positions,
+				words * sizeof(uint64_t));
+		(*copy)->payload = edges_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1579,12 +3709,17 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_runs *runs;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_logic_edges *edges;
 	struct sr_config *src;
 	GSList *l;
 
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1609,16 +3744,302 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		g_free(analog->data);
+		g_free((void *)analog->timestamps);
 		g_free(analog->encoding);
 		g_slist_free(analog->meaning->channels);
 		g_free(analog->meaning);
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RUNS:
+		runs = packet->payload;
+		g_free(runs->data);
+		g_free(runs->lengths);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		g_free(planar->plane_bits);
+		g_free(planar->data);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_EDGES:
+		edges = packet->payload;
+		g_free(edges->channels);
+		g_free(edges->offsets);
+		g_free(edges->positions);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
 	g_free(packet);
 }
 
+/**
+ * Create a reference counted memory buffer for datafeed sample data.
+ *
+ * Drivers use buffers to pass their own transfer memory through the
+ * session without copying it, see sr_session_send_buffer().
+ *
+ * @param data The memory which the buffer refers to.
+ * @param size The size of the memory in bytes.
+ * @param cb Routine to invoke when the last reference is dropped. Can be
+ *           NULL in which case the memory gets released using g_free().
+ * @param cb_data Opaque pointer passed to the release callback.
+ *
+ * @return The new buffer with a reference count of 1.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_buffer_new(void *data, size_t size,
+		sr_buffer_release_callback cb, void *cb_data)
+{
+	struct sr_buffer *buf;
+
+	buf = g_malloc0(sizeof(*buf));
+	buf->refcount = 1;
+	buf->data = data;
+	buf->size = size;
+	buf->release = cb;
+	buf->release_data = cb_data;
+
+	return buf;
+}
+
+/**
+ * Take another reference to a buffer.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @return The buffer.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf)
+{
+	g_atomic_int_inc(&buf->refcount);
+
+	return buf;
+}
+
+/**
+ * Drop a reference to a buffer, release the memory if it was the last.
+ *
+ * @param buf The buffer. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_buffer_unref(struct sr_buffer *buf)
+{
+	if (!buf)
+		return;
+	if (!g_atomic_int_dec_and_test(&buf->refcount))
+		return;
+
+	if (buf->pool) {
+		buffer_pool_put(buf);
+		return;
+	}
+	if (buf->release)
+		buf->release(buf->data, buf->release_data);
+	else
+		g_free(buf->data);
+	g_free(buf);
+}
+
+/**
+ * Get the memory which a buffer refers to.
+ *
+ * @param buf The buffer. Must not be NULL.
+ * @param size Pointer to store the buffer size in. Can be NULL.
+ *
+ * @return The buffer's memory.
+ *
+ * @since 0.6.0
+ */
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf, size_t *size)
+{
+	if (size)
+		*size = buf->size;
+
+	return buf->data;
+}
+
+/**
+ * Get a sample data buffer from the session's buffer pool.
+ *
+ * The pool keeps released buffers for re-use, across acquisitions of the
+ * session. This avoids allocation and page fault overhead in drivers with
+ * high data rates, which repeatedly need large payload buffers. Use
+ * sr_session_send_buffer() to pass the buffer's content to the session,
+ * and drop the driver's reference by means of sr_buffer_unref().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param size The number of bytes which the caller needs.
+ *
+ * Pool blocks are accounted with the session's context. Requests fail
+ * when they would exceed its memory budget, see sr_memory_budget_set().
+ *
+ * @return A buffer of at least @a size bytes, or NULL upon allocation
+ *         failure. The buffer content is undefined.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer *sr_session_buffer_get(struct sr_session *session,
+		size_t size)
+{
+	struct buffer_pool *pool;
+	struct sr_buffer *buf;
+	unsigned int idx;
+	size_t alloc_size;
+	void *data;
+
+	if (!session || !size)
+		return NULL;
+	pool = session->buffer_pool;
+
+	idx = 0;
+	alloc_size = (size_t)1 << POOL_MIN_SHIFT;
+	while (alloc_size < size && idx < POOL_CLASSES) {
+		alloc_size <<= 1;
+		idx++;
+	}
+	if (idx == POOL_CLASSES) {
+		/* Too large for the pool, use a private allocation. */
+		data = g_try_malloc(size);
+		return data ? sr_buffer_new(data, size, NULL, NULL) : NULL;
+	}
+
+	g_mutex_lock(&pool->mutex);
+	buf = NULL;
+	if (pool->free_list[idx]) {
+		buf = pool->free_list[idx]->data;
+		pool->free_list[idx] = g_slist_delete_link(pool->free_list[idx],
+			pool->free_list[idx]);
+		pool->free_count[idx]--;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (!buf) {
+		if (sr_mem_reserve(pool->ctx, alloc_size) != SR_OK) {
+			sr_dbg("Buffer of %zu bytes exceeds the memory budget.",
+				alloc_size);
+			return NULL;
+		}
+		data = g_try_malloc(alloc_size);
+		if (!data) {
+			sr_mem_release(pool->ctx, alloc_size);
+			return NULL;
+		}
+		buf = sr_buffer_new(data, size, NULL, NULL);
+		buf->pool_class = idx;
+	}
+	buf->refcount = 1;
+	buf->size = size;
+	buf->pool = pool;
+	g_atomic_int_inc(&pool->refcount);
+
+	return buf;
+}
+
+/**
+ * Take a reference to a datafeed packet.
+ *
+ * This is the preferred way for datafeed consumers to keep packets
+ * beyond the callback's lifetime. When the packet already is reference
+ * counted (because it was sent from a buffer, or was referenced before),
+ * the same packet is returned and no data gets copied. Otherwise a deep
+ * copy of the packet is created, which subsequent references will share.
+ *
+ * Release the packet using sr_packet_unref(), never sr_packet_free().
+ *
+ * @param packet The packet to reference. Must not be NULL.
+ * @param ref Pointer to store the referenced packet in. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Packet cannot be copied.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_packet_ref(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **ref)
+{
+	struct shared_packet *shared;
+	struct sr_datafeed_packet *copy;
+	int ret;
+
+	if (!packet || !ref)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&shared_packets_mutex);
+	shared = shared_packets
+		? g_hash_table_lookup(shared_packets, packet) : NULL;
+	if (shared) {
+		shared->refcount++;
+		g_mutex_unlock(&shared_packets_mutex);
+		*ref = shared->packet;
+		return SR_OK;
+	}
+	g_mutex_unlock(&shared_packets_mutex);
+
+	ret = sr_packet_copy(packet, &copy);
+	if (ret != SR_OK)
+		return ret;
+
+	shared = g_malloc0(sizeof(*shared));
+	shared->refcount = 1;
+	shared->packet = copy;
+
+	g_mutex_lock(&shared_packets_mutex);
+	if (!shared_packets)
+		shared_packets = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(shared_packets, copy, shared);
+	g_mutex_unlock(&shared_packets_mutex);
+
+	*ref = copy;
+
+	return SR_OK;
+}
+
+/**
+ * Drop a reference to a packet which was taken by sr_packet_ref().
+ *
+ * @param packet The packet. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet)
+{
+	struct shared_packet *shared;
+
+	if (!packet)
+		return;
+
+	g_mutex_lock(&shared_packets_mutex);
+	shared = shared_packets
+		? g_hash_table_lookup(shared_packets, packet) : NULL;
+	if (!shared) {
+		g_mutex_unlock(&shared_packets_mutex);
+		sr_err("%s: packet %p is not reference counted.",
+			__func__, (void *)packet);
+		return;
+	}
+	if (--shared->refcount > 0) {
+		g_mutex_unlock(&shared_packets_mutex);
+		return;
+	}
+	g_hash_table_remove(shared_packets, packet);
+	g_mutex_unlock(&shared_packets_mutex);
+
+	if (shared->buffer) {
+		g_slist_free(shared->buf_meaning.channels);
+		sr_buffer_unref(shared->buffer);
+	} else {
+		sr_packet_free(shared->packet);
+	}
+	g_free(shared);
+}
+
 /** @} */
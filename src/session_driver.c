@@ -29,9 +29,10 @@
 
 #define LOG_PREFIX "virtual-session"
 
-/* size of payloads sent across the session bus */
+/* Default size of payloads sent across the session bus. */
 /** @cond PRIVATE */
 #define CHUNKSIZE (4 * 1024 * 1024)
+#define MIN_CHUNKSIZE 4096
 /** @endcond */
 
 SR_PRIV struct sr_dev_driver session_driver_info;
@@ -50,8 +51,66 @@ struct session_vdev {
 	GArray *analog_channels;
 	int cur_chunk;
 	gboolean finished;
+	uint64_t start_sample;
+	uint64_t start_msec;
+	uint64_t limit_samples;
+	/* Playback state of the current capture file (logic, or channel). */
+	uint64_t skip_bytes;
+	uint64_t samples_left;
+	gboolean stream_done;
+	/* Playback pacing. */
+	double speed;
+	gboolean bulk;
+	int64_t stream_start_us;
+	uint64_t stream_samples;
+	uint64_t budget;
+	/* Read-ahead of the next chunks, by worker threads. */
+	uint64_t readahead;
+	GThreadPool *pool;
+	GAsyncQueue *archives;
+	GMutex mutex;
+	GCond inflated;
+	GQueue jobs;
+	struct chunk_job *cur_job;
+	uint64_t job_pos;
+	int next_prefetch;
+	uint64_t chunk_size;
+	/* Uncompressed (srraw) session files get played from a mapping. */
+	GMappedFile *map;
+	struct raw_plane {
+		uint64_t offset;
+		uint64_t size;
+	} *planes;
+	gboolean plane_open;
+	uint64_t plane_pos;
+	/* Encodings of the analog channels' data, NULL for float. */
+	struct sr_analog_encoding *analog_encodings;
+	/* Run length encoded logic chunks (archive version 3). */
+	gboolean rle;
+	uint8_t *rle_in;
+	size_t rle_fill;
+	size_t rle_pos;
+	uint8_t *rle_sample;
+	uint64_t rle_left;
 };
 
+/* A chunk which gets inflated by a worker thread. */
+struct chunk_job {
+	char *name;
+	uint8_t *data;
+	uint64_t size;
+	gboolean done;
+};
+
+/* Default number of chunks to inflate ahead of their playback. */
+#define DEFAULT_READAHEAD 4
+
+/* Poll interval of paced playback, in ms. */
+#define PACE_INTERVAL 10
+
+/* Input buffer size of the run length decoder. */
+#define RLE_IN_SIZE (64 * 1024)
+
 static const uint32_t devopts[] = {
 	SR_CONF_CAPTUREFILE | SR_CONF_SET,
 	SR_CONF_CAPTURE_UNITSIZE | SR_CONF_GET | SR_CONF_SET,
@@ -59,9 +118,433 @@ static const uint32_t devopts[] = {
 	SR_CONF_NUM_ANALOG_CHANNELS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
+	SR_CONF_CAPTURE_START | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_START_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_READAHEAD | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_SPEED | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_BULK | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_CHUNKSIZE | SR_CONF_GET | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+/*
+ * Inflate a chunk, in a worker thread. libzip archive handles must not
+ * be shared between threads, every worker takes an archive handle of
+ * its own from the queue of handles.
+ */
+static void chunk_inflate(gpointer data, gpointer user_data)
+{
+	struct chunk_job *job;
+	struct session_vdev *vdev;
+	struct zip *archive;
+	struct zip_file *zf;
+	struct zip_stat zs;
+	zip_int64_t ret;
+	uint64_t pos;
+
+	job = data;
+	vdev = user_data;
+
+	archive = g_async_queue_pop(vdev->archives);
+	zf = NULL;
+	if (zip_stat(archive, job->name, 0, &zs) != -1)
+		zf = zip_fopen(archive, job->name, 0);
+	if (zf) {
+		job->data = g_try_malloc(zs.size ? zs.size : 1);
+		pos = 0;
+		while (job->data && pos < zs.size) {
+			ret = zip_fread(zf, job->data + pos, zs.size - pos);
+			if (ret <= 0)
+				break;
+			pos += ret;
+		}
+		job->size = pos;
+		if (pos != zs.size)
+			sr_err("Failed to read %s.", job->name);
+		zip_fclose(zf);
+	}
+	g_async_queue_push(vdev->archives, archive);
+
+	g_mutex_lock(&vdev->mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&vdev->inflated);
+	g_mutex_unlock(&vdev->mutex);
+}
+
+static void chunk_job_free(struct chunk_job *job)
+{
+	g_free(job->name);
+	g_free(job->data);
+	g_free(job);
+}
+
+static void chunk_prefetch(struct session_vdev *vdev, char *name)
+{
+	struct chunk_job *job;
+
+	job = g_malloc0(sizeof(*job));
+	job->name = name;
+	g_queue_push_tail(&vdev->jobs, job);
+	g_thread_pool_push(vdev->pool, job, NULL);
+}
+
+/*
+ * Take a chunk from the read-ahead, and queue the following chunks.
+ * Chunks are inflated in parallel, and are delivered in order.
+ */
+static struct chunk_job *chunk_take(struct session_vdev *vdev,
+		const char *name)
+{
+	struct chunk_job *job;
+
+	/* Drop chunks which got skipped, after a stream change. */
+	while ((job = g_queue_peek_head(&vdev->jobs))
+			&& strcmp(job->name, name)) {
+		g_queue_pop_head(&vdev->jobs);
+		g_mutex_lock(&vdev->mutex);
+		while (!job->done)
+			g_cond_wait(&vdev->inflated, &vdev->mutex);
+		g_mutex_unlock(&vdev->mutex);
+		chunk_job_free(job);
+	}
+	if (!job) {
+		chunk_prefetch(vdev, g_strdup(name));
+		vdev->next_prefetch = vdev->cur_chunk + 1;
+	}
+
+	/* Unchunked capture files have nothing to read ahead. */
+	while (vdev->cur_chunk && g_queue_get_length(&vdev->jobs)
+			<= vdev->readahead) {
+		chunk_prefetch(vdev, g_strdup_printf("%s-%d",
+				vdev->capturefile, vdev->next_prefetch));
+		vdev->next_prefetch++;
+	}
+
+	job = g_queue_pop_head(&vdev->jobs);
+	g_mutex_lock(&vdev->mutex);
+	while (!job->done)
+		g_cond_wait(&vdev->inflated, &vdev->mutex);
+	g_mutex_unlock(&vdev->mutex);
+	if (!job->data) {
+		chunk_job_free(job);
+		return NULL;
+	}
+
+	return job;
+}
+
+static gboolean capture_is_open(const struct session_vdev *vdev)
+{
+	return vdev->capfile || vdev->cur_job;
+}
+
+static int capture_read_raw(struct session_vdev *vdev, void *buf, uint64_t len)
+{
+	struct chunk_job *job;
+
+	if (!vdev->cur_job)
+		return zip_fread(vdev->capfile, buf, len);
+
+	job = vdev->cur_job;
+	len = MIN(len, job->size - vdev->job_pos);
+	memcpy(buf, job->data + vdev->job_pos, len);
+	vdev->job_pos += len;
+
+	return len;
+}
+
+/* Logic chunks of the current capture file are run length encoded. */
+static gboolean rle_active(const struct session_vdev *vdev)
+{
+	return vdev->rle && vdev->cur_analog_channel == 0 && vdev->unitsize;
+}
+
+/* Have at least the given number of encoded bytes at hand, unless EOF. */
+static size_t rle_refill(struct session_vdev *vdev, size_t need)
+{
+	size_t avail;
+	int ret;
+
+	avail = vdev->rle_fill - vdev->rle_pos;
+	if (avail >= need)
+		return avail;
+
+	memmove(vdev->rle_in, vdev->rle_in + vdev->rle_pos, avail);
+	vdev->rle_fill = avail;
+	vdev->rle_pos = 0;
+	while (vdev->rle_fill < need) {
+		ret = capture_read_raw(vdev, vdev->rle_in + vdev->rle_fill,
+				RLE_IN_SIZE - vdev->rle_fill);
+		if (ret <= 0)
+			break;
+		vdev->rle_fill += ret;
+	}
+
+	return vdev->rle_fill;
+}
+
+/* Decode the next run: the sample value, then its length (LEB128). */
+static gboolean rle_next_run(struct session_vdev *vdev)
+{
+	const uint8_t *rdptr, *end;
+	uint64_t run;
+	unsigned int shift;
+	uint8_t b;
+
+	if (rle_refill(vdev, vdev->unitsize + 10) < (size_t)vdev->unitsize + 1)
+		return FALSE;
+
+	rdptr = vdev->rle_in + vdev->rle_pos;
+	end = vdev->rle_in + vdev->rle_fill;
+	memcpy(vdev->rle_sample, rdptr, vdev->unitsize);
+	rdptr += vdev->unitsize;
+	run = 0;
+	shift = 0;
+	do {
+		if (rdptr == end || shift >= 64)
+			return FALSE;
+		b = *rdptr++;
+		run |= (uint64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	vdev->rle_pos = rdptr - vdev->rle_in;
+	vdev->rle_left = run;
+
+	return TRUE;
+}
+
+static gboolean capture_open(struct session_vdev *vdev, const char *name)
+{
+	if (!vdev->pool) {
+		if (!(vdev->capfile = zip_fopen(vdev->archive, name, 0)))
+			return FALSE;
+	} else {
+		vdev->cur_job = chunk_take(vdev, name);
+		vdev->job_pos = 0;
+		if (!vdev->cur_job)
+			return FALSE;
+	}
+
+	if (rle_active(vdev)) {
+		/* Skip the sample count, the decoder does not need it. */
+		vdev->rle_fill = vdev->rle_pos = 0;
+		vdev->rle_left = 0;
+		if (rle_refill(vdev, sizeof(uint64_t)) >= sizeof(uint64_t))
+			vdev->rle_pos = sizeof(uint64_t);
+		else
+			vdev->rle_pos = vdev->rle_fill;
+	}
+
+	return TRUE;
+}
+
+/* Read the capture data, expands run length encoded data on the fly. */
+static int capture_read(struct session_vdev *vdev, void *buf, uint64_t len)
+{
+	uint8_t *wrptr;
+	uint64_t count, i;
+	size_t unitsize;
+
+	if (!rle_active(vdev))
+		return capture_read_raw(vdev, buf, len);
+
+	unitsize = vdev->unitsize;
+	wrptr = buf;
+	len = MIN(len, G_MAXINT) / unitsize;
+	while (len) {
+		if (!vdev->rle_left && !rle_next_run(vdev))
+			break;
+		count = MIN(vdev->rle_left, len);
+		if (unitsize == 1) {
+			memset(wrptr, vdev->rle_sample[0], count);
+		} else {
+			for (i = 0; i < count; i++)
+				memcpy(wrptr + i * unitsize, vdev->rle_sample, unitsize);
+		}
+		wrptr += count * unitsize;
+		vdev->rle_left -= count;
+		len -= count;
+	}
+
+	return wrptr - (uint8_t *)buf;
+}
+
+/* The size of a chunk's data, after run length decoding. */
+static uint64_t chunk_size(struct session_vdev *vdev, const char *name,
+		const struct zip_stat *zs)
+{
+	struct zip_file *zf;
+	uint8_t count[sizeof(uint64_t)];
+	zip_int64_t ret;
+
+	if (!rle_active(vdev))
+		return zs->size;
+
+	/* Rle chunks start with their sample count. */
+	if (!(zf = zip_fopen(vdev->archive, name, 0)))
+		return 0;
+	ret = zip_fread(zf, count, sizeof(count));
+	zip_fclose(zf);
+	if (ret != sizeof(count))
+		return 0;
+
+	return RL64(count) * vdev->unitsize;
+}
+
+static void capture_close(struct session_vdev *vdev)
+{
+	if (vdev->capfile)
+		zip_fclose(vdev->capfile);
+	vdev->capfile = NULL;
+	if (vdev->cur_job)
+		chunk_job_free(vdev->cur_job);
+	vdev->cur_job = NULL;
+}
+
+/* Stop the read-ahead, drop the chunks which it inflated. */
+static void readahead_stop(struct session_vdev *vdev)
+{
+	struct chunk_job *job;
+	struct zip *archive;
+
+	if (!vdev->pool)
+		return;
+
+	g_thread_pool_free(vdev->pool, TRUE, TRUE);
+	vdev->pool = NULL;
+	while ((job = g_queue_pop_head(&vdev->jobs)))
+		chunk_job_free(job);
+	while ((archive = g_async_queue_try_pop(vdev->archives)))
+		zip_discard(archive);
+	g_async_queue_unref(vdev->archives);
+	vdev->archives = NULL;
+	g_cond_clear(&vdev->inflated);
+	g_mutex_clear(&vdev->mutex);
+}
+
+/* Start worker threads with archive handles of their own. */
+static int readahead_start(struct session_vdev *vdev)
+{
+	struct zip *archive;
+	unsigned int i, threads;
+
+	if (!vdev->readahead)
+		return SR_OK;
+
+	threads = MIN(vdev->readahead, g_get_num_processors());
+	g_mutex_init(&vdev->mutex);
+	g_cond_init(&vdev->inflated);
+	g_queue_init(&vdev->jobs);
+	vdev->archives = g_async_queue_new();
+	for (i = 0; i < threads; i++) {
+		if (!(archive = zip_open(vdev->sessionfile, 0, NULL)))
+			break;
+		g_async_queue_push(vdev->archives, archive);
+	}
+	if (!i) {
+		g_async_queue_unref(vdev->archives);
+		vdev->archives = NULL;
+		g_cond_clear(&vdev->inflated);
+		g_mutex_clear(&vdev->mutex);
+		return SR_ERR;
+	}
+	vdev->pool = g_thread_pool_new(chunk_inflate, vdev, i, FALSE, NULL);
+
+	return SR_OK;
+}
+
+/* Size of one sample in the current capture file, 0 when unknown. */
+static size_t stream_samplesize(const struct session_vdev *vdev)
+{
+	if (vdev->cur_analog_channel != 0 && vdev->analog_encodings)
+		return vdev->analog_encodings[vdev->cur_analog_channel - 1].unitsize;
+	if (vdev->cur_analog_channel != 0)
+		return sizeof(float);
+
+	return vdev->unitsize;
+}
+
+/*
+ * Find the chunk which holds the first sample to play back. The chunk
+ * index is derived from the sizes of the archive members, which the
+ * archive's central directory has, so the chunks before the start are
+ * neither read nor decompressed (run length encoded chunks have their
+ * sample count up front, only that gets read). Only the part of the
+ * chunk before the start sample gets read and discarded.
+ *
+ * Returns the chunk number, 0 when the capture has no chunks.
+ */
+static int stream_seek(struct session_vdev *vdev)
+{
+	struct zip_stat zs;
+	char capturefile[128];
+	uint64_t offset, pos, size;
+	int chunk;
+
+	offset = vdev->start_sample * stream_samplesize(vdev);
+	pos = 0;
+	for (chunk = 1; ; chunk++) {
+		snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d",
+				vdev->capturefile, chunk);
+		if (zip_stat(vdev->archive, capturefile, 0, &zs) == -1)
+			break;
+		size = chunk_size(vdev, capturefile, &zs);
+		if (pos + size > offset) {
+			vdev->skip_bytes = offset - pos;
+			return chunk;
+		}
+		pos += size;
+	}
+
+	/* Start is past the end of the capture, nothing to play back. */
+	vdev->stream_done = TRUE;
+
+	return chunk - 1;
+}
+
+static gboolean paced(const struct session_vdev *vdev)
+{
+	return vdev->speed > 0 && vdev->samplerate && !vdev->bulk;
+}
+
+/* Number of samples which play in the given time, at least 1. */
+static uint64_t pace_samples(const struct session_vdev *vdev, int64_t us)
+{
+	double samples;
+
+	samples = (double)us * vdev->samplerate * vdev->speed / 1000000;
+
+	return MAX(samples, 1);
+}
+
+/*
+ * Determine how many samples of the current capture file are due, when
+ * playback is paced. Returns FALSE when the playback is ahead.
+ */
+static gboolean pace(struct session_vdev *vdev)
+{
+	uint64_t due;
+
+	vdev->budget = UINT64_MAX;
+	if (!paced(vdev))
+		return TRUE;
+
+	due = pace_samples(vdev, g_get_monotonic_time() - vdev->stream_start_us);
+	if (due <= vdev->stream_samples) {
+		vdev->budget = 0;
+		return FALSE;
+	}
+	vdev->budget = due - vdev->stream_samples;
+
+	return TRUE;
+}
+
+/*
+ * Send the data of the current capture file, logic or analog. The data
+ * resides in the given buffer when there is one.
+ */
+static gboolean send_capture_data(struct sr_dev_inst *sdi, void *buf, int ret,
+		struct sr_buffer *sbuf)
 {
 	struct session_vdev *vdev;
 	struct sr_datafeed_packet packet;
@@ -70,49 +553,117 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	gboolean got_data;
+
+	vdev = sdi->priv;
+	got_data = FALSE;
+	if (vdev->cur_analog_channel != 0) {
+		got_data = TRUE;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, vdev->cur_analog_channel - 1));
+		if (vdev->analog_encodings && !vdev->analog_encodings[
+				vdev->cur_analog_channel - 1].is_float) {
+			encoding = vdev->analog_encodings[vdev->cur_analog_channel - 1];
+			encoding.digits = 2;
+			encoding.is_digits_decimal = TRUE;
+		}
+		analog.num_samples = ret / encoding.unitsize;
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = buf;
+	} else if (vdev->unitsize) {
+		got_data = TRUE;
+		if (ret % vdev->unitsize != 0)
+			sr_warn("Read size %d not a multiple of the"
+				" unit size %d.", ret, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = ret;
+		logic.unitsize = vdev->unitsize;
+		logic.data = buf;
+	} else {
+		/*
+		 * Neither analog data, nor logic which has
+		 * unitsize, must be an unexpected API use.
+		 */
+		sr_warn("Neither analog nor logic data. Ignoring.");
+	}
+	if (got_data) {
+		vdev->bytes_read += ret;
+		if (sbuf)
+			sr_session_send_buffer(sdi, &packet, sbuf);
+		else
+			sr_session_send(sdi, &packet);
+	}
+
+	return got_data;
+}
+
+static gboolean stream_session_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
 	struct zip_stat zs;
 	int ret, got_data;
 	char capturefile[128];
+	struct sr_buffer *sbuf;
 	void *buf;
+	uint64_t len;
+	size_t samplesize;
 
 	got_data = FALSE;
 	vdev = sdi->priv;
 
-	if (!vdev->capfile) {
+	if (!capture_is_open(vdev)) {
 		/* No capture file opened yet, or finished with the last
 		 * chunked one. */
 		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
+			vdev->skip_bytes = 0;
+			vdev->samples_left = vdev->limit_samples ?
+					vdev->limit_samples : UINT64_MAX;
+			vdev->stream_done = FALSE;
+			vdev->stream_start_us = g_get_monotonic_time();
+			vdev->stream_samples = 0;
+			if (paced(vdev))
+				vdev->budget = pace_samples(vdev, PACE_INTERVAL * 1000);
 			/* capturefile is always the unchunked base name. */
 			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
 				/* No chunks, just a single capture file. */
 				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
+				vdev->skip_bytes = vdev->start_sample *
+						stream_samplesize(vdev);
+				if (!capture_open(vdev, vdev->capturefile))
 					return FALSE;
 				sr_dbg("Opened %s.", vdev->capturefile);
 			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
+				/* Try as chunk filename, the start might be in any. */
+				vdev->cur_chunk = stream_seek(vdev);
+				if (vdev->cur_chunk == 0) {
 					sr_err("No capture file '%s' in " "session file '%s'.",
 							vdev->capturefile, vdev->sessionfile);
 					return FALSE;
 				}
+				if (vdev->stream_done)
+					return TRUE;
+				snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d",
+						vdev->capturefile, vdev->cur_chunk);
+				if (!capture_open(vdev, capturefile))
+					return FALSE;
+				sr_dbg("Opened %s.", capturefile);
 			}
 		} else {
 			/* Capture data is chunked, advance to the next chunk. */
 			vdev->cur_chunk++;
 			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
 					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
+			if (!vdev->stream_done &&
+					zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
+				if (!capture_open(vdev, capturefile))
 					return FALSE;
 				sr_dbg("Opened %s.", capturefile);
 			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
@@ -140,66 +691,246 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 		}
 	}
 
-	buf = g_malloc(CHUNKSIZE);
+	/* Recycled by the session's pool, after the last consumer is done. */
+	sbuf = sr_session_buffer_get(sdi->session, vdev->chunk_size);
+	if (!sbuf)
+		return FALSE;
+	buf = sr_buffer_data_get(sbuf, NULL);
+
+	/* Discard the chunk's data before the start sample. */
+	ret = 1;
+	while (vdev->skip_bytes && ret > 0) {
+		len = MIN(vdev->skip_bytes, vdev->chunk_size);
+		ret = capture_read(vdev, buf, len);
+		if (ret > 0)
+			vdev->skip_bytes -= ret;
+	}
 
 	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
+	samplesize = stream_samplesize(vdev);
+	len = vdev->chunk_size;
+	if (samplesize) {
+		len = vdev->chunk_size / samplesize;
+		len = MIN(len, MIN(vdev->samples_left, vdev->budget));
+		len *= samplesize;
+	}
+	if (ret > 0 && len)
+		ret = capture_read(vdev, buf, len);
+	else if (ret > 0)
+		ret = 0;
+	if (ret > 0 && samplesize) {
+		/* Skip the remaining chunks once the limit is reached. */
+		vdev->samples_left -= ret / samplesize;
+		if (!vdev->samples_left)
+			vdev->stream_done = TRUE;
+		vdev->stream_samples += ret / samplesize;
+	}
 
 	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
-		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
+		got_data = send_capture_data(sdi, buf, ret, sbuf);
 	} else {
 		/* done with this capture file */
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
+		capture_close(vdev);
 		if (vdev->cur_chunk != 0) {
 			/* There might be more chunks, so don't fall through
 			 * to the SR_DF_END here. */
 			got_data = TRUE;
 		}
 	}
-	g_free(buf);
+	sr_buffer_unref(sbuf);
 
 	return got_data;
 }
 
+/*
+ * Play back the planes of an uncompressed session file, the logic plane
+ * first, then the analog channels. The packets point into the mapping,
+ * the data is not copied.
+ */
+static gboolean stream_mapped_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct raw_plane *plane;
+	uint64_t count;
+	size_t samplesize;
+	char *data;
+
+	vdev = sdi->priv;
+
+	while (vdev->cur_analog_channel <= vdev->num_analog_channels) {
+		plane = &vdev->planes[vdev->cur_analog_channel];
+		samplesize = stream_samplesize(vdev);
+		if (!vdev->plane_open) {
+			vdev->plane_open = TRUE;
+			vdev->plane_pos = vdev->start_sample * samplesize;
+			vdev->samples_left = vdev->limit_samples ?
+					vdev->limit_samples : UINT64_MAX;
+			vdev->stream_start_us = g_get_monotonic_time();
+			vdev->stream_samples = 0;
+			if (paced(vdev))
+				vdev->budget = pace_samples(vdev, PACE_INTERVAL * 1000);
+		}
+		count = 0;
+		if (samplesize && vdev->plane_pos < plane->size) {
+			count = (plane->size - vdev->plane_pos) / samplesize;
+			count = MIN(count, vdev->chunk_size / samplesize);
+			count = MIN(count, MIN(vdev->samples_left, vdev->budget));
+		}
+		if (!count) {
+			/* Done with this plane, continue with the next. */
+			vdev->cur_analog_channel++;
+			vdev->plane_open = FALSE;
+			continue;
+		}
+		data = g_mapped_file_get_contents(vdev->map);
+		send_capture_data(sdi, data + plane->offset + vdev->plane_pos,
+				count * samplesize, NULL);
+		vdev->plane_pos += count * samplesize;
+		vdev->samples_left -= count;
+		vdev->stream_samples += count;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean stream_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+
+	vdev = sdi->priv;
+	if (vdev->map)
+		return stream_mapped_data(sdi);
+
+	return stream_session_data(sdi);
+}
+
+/* Pick up the archive's encoding details from its metadata. */
+static int metadata_read(struct session_vdev *vdev)
+{
+	struct sr_analog_encoding *encodings;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	char *val;
+	gboolean native;
+	int i, ret;
+
+	vdev->rle = FALSE;
+	if (zip_stat(vdev->archive, "metadata", 0, &zs) < 0)
+		return SR_ERR_DATA;
+	if (!(kf = sr_sessionfile_read_metadata(vdev->archive, &zs)))
+		return SR_ERR_DATA;
+	val = g_key_file_get_string(kf, "device 1", "logic encoding", NULL);
+	if (val && strcmp(val, "rle")) {
+		sr_err("Unsupported logic encoding '%s'.", val);
+		g_free(val);
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+	vdev->rle = val != NULL;
+	g_free(val);
+
+	/* Analog channels may have their samples stored as integers. */
+	native = FALSE;
+	encodings = g_malloc0(sizeof(encodings[0])
+		* (vdev->num_analog_channels + 1));
+	for (i = 0; i < vdev->num_analog_channels; i++) {
+		ret = sr_sessionfile_analog_encoding(kf, "device 1",
+			vdev->num_logic_channels + i + 1, &encodings[i]);
+		if (ret != SR_OK) {
+			g_free(encodings);
+			g_key_file_free(kf);
+			return ret;
+		}
+		if (!encodings[i].is_float)
+			native = TRUE;
+	}
+	g_key_file_free(kf);
+	g_free(vdev->analog_encodings);
+	vdev->analog_encodings = NULL;
+	if (native)
+		vdev->analog_encodings = encodings;
+	else
+		g_free(encodings);
+
+	if (vdev->rle && vdev->unitsize) {
+		vdev->rle_in = g_malloc(RLE_IN_SIZE);
+		vdev->rle_sample = g_malloc(vdev->unitsize);
+	}
+
+	return SR_OK;
+}
+
+/* Map an uncompressed session file, and locate its planes. */
+static int mapped_open(struct session_vdev *vdev)
+{
+	GKeyFile *kf;
+	GError *error;
+	char *name, *key, *val;
+	uint64_t length;
+	int i;
+
+	error = NULL;
+	if (!(vdev->map = g_mapped_file_new(vdev->sessionfile, FALSE, &error))) {
+		sr_err("Failed to map session file '%s': %s",
+			vdev->sessionfile, error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+	length = g_mapped_file_get_length(vdev->map);
+	kf = sr_rawfile_read_metadata(g_mapped_file_get_contents(vdev->map),
+			length);
+	if (!kf)
+		return SR_ERR_DATA;
+
+	val = g_key_file_get_string(kf, "global", "byteorder", NULL);
+	if (vdev->num_analog_channels && g_strcmp0(val,
+			G_BYTE_ORDER == G_BIG_ENDIAN ? "big" : "little")) {
+		sr_err("Analog data of foreign byte order is not supported.");
+		g_free(val);
+		g_key_file_free(kf);
+		return SR_ERR_DATA;
+	}
+	g_free(val);
+
+	vdev->planes = g_malloc0(sizeof(vdev->planes[0])
+			* (vdev->num_analog_channels + 1));
+	for (i = 0; i <= vdev->num_analog_channels; i++) {
+		if (i == 0)
+			name = g_strdup("logic-1");
+		else
+			name = g_strdup_printf("analog-1-%d",
+				vdev->num_logic_channels + i);
+		key = g_strdup_printf("%s offset", name);
+		vdev->planes[i].offset = g_key_file_get_uint64(kf, "planes",
+				key, NULL);
+		g_free(key);
+		key = g_strdup_printf("%s size", name);
+		vdev->planes[i].size = g_key_file_get_uint64(kf, "planes",
+				key, NULL);
+		g_free(key);
+		if (vdev->planes[i].offset > length || vdev->planes[i].size
+				> length - vdev->planes[i].offset) {
+			sr_err("Truncated plane '%s'.", name);
+			vdev->planes[i].size = 0;
+		}
+		g_free(name);
+	}
+	g_key_file_free(kf);
+	vdev->plane_open = FALSE;
+
+	return SR_OK;
+}
+
+static void mapped_close(struct session_vdev *vdev)
+{
+	if (vdev->map)
+		g_mapped_file_unref(vdev->map);
+	vdev->map = NULL;
+	g_free(vdev->planes);
+	vdev->planes = NULL;
+}
+
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
@@ -211,15 +942,29 @@ static int receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	vdev = sdi->priv;
 
-	if (!vdev->finished && !stream_session_data(sdi))
+	if (vdev->bulk) {
+		/*
+		 * Pump the whole capture without returning to the main
+		 * loop. Stop requests from datafeed callbacks still apply.
+		 */
+		while (!vdev->finished && stream_data(sdi))
+			;
 		vdev->finished = TRUE;
+	} else if (!vdev->finished && pace(vdev) && !stream_data(sdi)) {
+		vdev->finished = TRUE;
+	}
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
-	if (vdev->capfile) {
-		zip_fclose(vdev->capfile);
-		vdev->capfile = NULL;
-	}
+	capture_close(vdev);
+	readahead_stop(vdev);
+	mapped_close(vdev);
+	g_free(vdev->rle_in);
+	vdev->rle_in = NULL;
+	g_free(vdev->rle_sample);
+	vdev->rle_sample = NULL;
+	g_free(vdev->analog_encodings);
+	vdev->analog_encodings = NULL;
 	if (vdev->archive) {
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
@@ -241,6 +986,8 @@ static int dev_open(struct sr_dev_inst *sdi)
 	di = sdi->driver;
 	drvc = di->context;
 	vdev = g_malloc0(sizeof(struct session_vdev));
+	vdev->readahead = DEFAULT_READAHEAD;
+	vdev->chunk_size = CHUNKSIZE;
 	sdi->priv = vdev;
 	drvc->instances = g_slist_append(drvc->instances, sdi);
 
@@ -278,6 +1025,27 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_CAPTURE_START:
+		*data = g_variant_new_uint64(vdev->start_sample);
+		break;
+	case SR_CONF_CAPTURE_START_MSEC:
+		*data = g_variant_new_uint64(vdev->start_msec);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		*data = g_variant_new_uint64(vdev->limit_samples);
+		break;
+	case SR_CONF_CAPTURE_READAHEAD:
+		*data = g_variant_new_uint64(vdev->readahead);
+		break;
+	case SR_CONF_CAPTURE_SPEED:
+		*data = g_variant_new_double(vdev->speed);
+		break;
+	case SR_CONF_CAPTURE_CHUNKSIZE:
+		*data = g_variant_new_uint64(vdev->chunk_size);
+		break;
+	case SR_CONF_CAPTURE_BULK:
+		*data = g_variant_new_boolean(vdev->bulk);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -318,6 +1086,31 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_NUM_ANALOG_CHANNELS:
 		vdev->num_analog_channels = g_variant_get_int32(data);
 		break;
+	case SR_CONF_CAPTURE_START:
+		vdev->start_sample = g_variant_get_uint64(data);
+		vdev->start_msec = 0;
+		break;
+	case SR_CONF_CAPTURE_START_MSEC:
+		vdev->start_msec = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		vdev->limit_samples = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_CAPTURE_READAHEAD:
+		vdev->readahead = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_CAPTURE_SPEED:
+		vdev->speed = g_variant_get_double(data);
+		break;
+	case SR_CONF_CAPTURE_CHUNKSIZE:
+		if (g_variant_get_uint64(data) < MIN_CHUNKSIZE
+				|| g_variant_get_uint64(data) > G_MAXINT)
+			return SR_ERR_ARG;
+		vdev->chunk_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_CAPTURE_BULK:
+		vdev->bulk = g_variant_get_boolean(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -334,7 +1127,7 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
-	int ret;
+	int ret, timeout;
 	GSList *l;
 	struct sr_channel *ch;
 
@@ -350,20 +1143,45 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	}
 	vdev->cur_chunk = 0;
 	vdev->finished = FALSE;
+	if (vdev->start_msec)
+		vdev->start_sample = vdev->start_msec * vdev->samplerate / 1000;
 
-	sr_info("Opening archive %s file %s", vdev->sessionfile,
-		vdev->capturefile);
+	if (sr_rawfile_check(vdev->sessionfile) == SR_OK) {
+		sr_info("Mapping uncompressed session file %s",
+			vdev->sessionfile);
+		if ((ret = mapped_open(vdev)) != SR_OK) {
+			mapped_close(vdev);
+			return ret;
+		}
+	} else {
+		sr_info("Opening archive %s file %s", vdev->sessionfile,
+			vdev->capturefile);
 
-	if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
-		sr_err("Failed to open session file '%s': "
-		       "zip error %d.", vdev->sessionfile, ret);
-		return SR_ERR;
+		if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
+			sr_err("Failed to open session file '%s': "
+			       "zip error %d.", vdev->sessionfile, ret);
+			return SR_ERR;
+		}
+		if ((ret = metadata_read(vdev)) != SR_OK) {
+			zip_discard(vdev->archive);
+			vdev->archive = NULL;
+			return ret;
+		}
+		if (readahead_start(vdev) != SR_OK) {
+			sr_err("Failed to start the read-ahead.");
+			zip_discard(vdev->archive);
+			vdev->archive = NULL;
+			return SR_ERR;
+		}
 	}
 
 	std_session_send_df_header(sdi);
 
-	/* freewheeling source */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	/* Freewheeling source, unless the playback is paced. */
+	vdev->budget = UINT64_MAX;
+	timeout = paced(vdev) ? PACE_INTERVAL : 0;
+	sr_session_source_add(sdi->session, -1, 0, timeout,
+			receive_data, (void *)sdi);
 
 	return SR_OK;
 }
@@ -58,6 +58,178 @@ SR_PRIV void sr_zip_discard(struct zip *archive)
 }
 #endif
 
+/* Compression methods for the archive members, by their metadata names. */
+static const struct {
+	const char *name;
+	zip_int32_t method;
+} compression_methods[] = {
+	{ "store", ZIP_CM_STORE },
+	{ "deflate", ZIP_CM_DEFLATE },
+	{ "bzip2", ZIP_CM_BZIP2 },
+#ifdef ZIP_CM_XZ
+	{ "xz", ZIP_CM_XZ },
+#endif
+#ifdef ZIP_CM_ZSTD
+	{ "zstd", ZIP_CM_ZSTD },
+#endif
+};
+
+/**
+ * Lookup a compression method for session archive members.
+ *
+ * @param[in] name The method's name, as used in the metadata.
+ * @param[out] method The libzip compression method.
+ * @param[in] compress TRUE to check for compression support, FALSE to
+ *                     check for decompression support.
+ *
+ * @retval SR_OK The method is known, and supported by libzip.
+ * @retval SR_ERR_NA The method is known, but libzip lacks support for it.
+ * @retval SR_ERR_ARG Unknown method name.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_compression_lookup(const char *name,
+		int32_t *method, gboolean compress)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(compression_methods); i++) {
+		if (strcmp(name, compression_methods[i].name))
+			continue;
+		*method = compression_methods[i].method;
+#if HAVE_ZIP_COMPRESSION_METHOD_SUPPORTED
+		if (!zip_compression_method_supported(*method, compress))
+			return SR_ERR_NA;
+#else
+		/* Older libzip versions only know about deflate. */
+		if (*method != ZIP_CM_STORE && *method != ZIP_CM_DEFLATE)
+			return SR_ERR_NA;
+		(void)compress;
+#endif
+		return SR_OK;
+	}
+
+	return SR_ERR_ARG;
+}
+
+/**
+ * Get the names of the known compression methods.
+ *
+ * @return A list of the names. The caller must free the list, but not
+ *         the names.
+ *
+ * @private
+ */
+SR_PRIV GSList *sr_sessionfile_compression_names(void)
+{
+	GSList *names;
+	size_t i;
+
+	names = NULL;
+	for (i = 0; i < ARRAY_SIZE(compression_methods); i++)
+		names = g_slist_append(names,
+			(gpointer)compression_methods[i].name);
+
+	return names;
+}
+
+/* Parse a rational number of the metadata, "p/q" or "p". */
+static gboolean rational_parse(const char *str, struct sr_rational *r)
+{
+	char *end;
+	int64_t p;
+	uint64_t q;
+
+	p = g_ascii_strtoll(str, &end, 10);
+	if (end == str)
+		return FALSE;
+	q = 1;
+	if (*end == '/') {
+		str = end + 1;
+		q = g_ascii_strtoull(str, &end, 10);
+		if (end == str || !q)
+			return FALSE;
+	}
+	if (*end)
+		return FALSE;
+	sr_rational_set(r, p, q);
+
+	return TRUE;
+}
+
+/**
+ * Get the encoding of an analog channel's data in a session archive.
+ *
+ * Channels with an "analog<N> encoding" key have their samples stored
+ * as little endian integers ("int8", "uint16", ..., up to 32 bits), and
+ * "analog<N> scale" and "analog<N> offset" keys which map them to
+ * values. The samples of other channels are float values.
+ *
+ * @param[in] kf The archive's metadata.
+ * @param[in] group The device's group in the metadata.
+ * @param[in] ch_nr The channel's number, as in "analog<N>".
+ * @param[out] encoding The encoding of the channel's samples.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA Invalid or unsupported encoding.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_analog_encoding(GKeyFile *kf, const char *group,
+		int ch_nr, struct sr_analog_encoding *encoding)
+{
+	char *key, *val, *scale, *offset;
+	const char *bits;
+	gboolean ok;
+
+	memset(encoding, 0, sizeof(*encoding));
+	encoding->unitsize = sizeof(float);
+	encoding->is_signed = TRUE;
+	encoding->is_float = TRUE;
+	sr_rational_set(&encoding->scale, 1, 1);
+	sr_rational_set(&encoding->offset, 0, 1);
+
+	key = g_strdup_printf("analog%d encoding", ch_nr);
+	val = g_key_file_get_string(kf, group, key, NULL);
+	g_free(key);
+	if (!val)
+		return SR_OK;
+
+	key = g_strdup_printf("analog%d scale", ch_nr);
+	scale = g_key_file_get_string(kf, group, key, NULL);
+	g_free(key);
+	key = g_strdup_printf("analog%d offset", ch_nr);
+	offset = g_key_file_get_string(kf, group, key, NULL);
+	g_free(key);
+
+	bits = val;
+	encoding->is_signed = *bits != 'u';
+	if (*bits == 'u')
+		bits++;
+	ok = g_str_has_prefix(bits, "int");
+	encoding->is_float = FALSE;
+	encoding->unitsize = 0;
+	if (ok && !strcmp(bits + 3, "8"))
+		encoding->unitsize = 1;
+	else if (ok && !strcmp(bits + 3, "16"))
+		encoding->unitsize = 2;
+	else if (ok && !strcmp(bits + 3, "32"))
+		encoding->unitsize = 4;
+	ok = encoding->unitsize != 0;
+	if (ok && scale)
+		ok = rational_parse(scale, &encoding->scale);
+	if (ok && offset)
+		ok = rational_parse(offset, &encoding->offset);
+	if (!ok)
+		sr_err("Unsupported encoding '%s' of analog channel %d.",
+			val, ch_nr);
+	g_free(val);
+	g_free(scale);
+	g_free(offset);
+
+	return ok ? SR_OK : SR_ERR_DATA;
+}
+
 /**
  * Read metadata entries from a session archive.
  *
@@ -111,6 +283,79 @@ SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 	return keyfile;
 }
 
+/**
+ * Check whether a file is an uncompressed (srraw) session file.
+ *
+ * @param[in] filename The file to check.
+ *
+ * @retval SR_OK The file has the srraw magic.
+ * @retval SR_ERR The file is something else, or cannot be read.
+ *
+ * @private
+ */
+SR_PRIV int sr_rawfile_check(const char *filename)
+{
+	FILE *file;
+	char magic[sizeof(SR_RAWFILE_MAGIC) - 1];
+	size_t len;
+
+	if (!filename || !(file = g_fopen(filename, "rb")))
+		return SR_ERR;
+	len = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+	if (len != sizeof(magic) || memcmp(magic, SR_RAWFILE_MAGIC, len))
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/**
+ * Read the metadata of an uncompressed (srraw) session file.
+ *
+ * @param[in] data The file's content, usually memory mapped.
+ * @param[in] size The file's size in bytes.
+ *
+ * @return A new key/value store containing the session metadata.
+ *
+ * @private
+ */
+SR_PRIV GKeyFile *sr_rawfile_read_metadata(const char *data, size_t size)
+{
+	GKeyFile *keyfile;
+	GError *error;
+	uint64_t offset, len;
+
+	if (size < SR_RAWFILE_HDR_SIZE || memcmp(data, SR_RAWFILE_MAGIC,
+			sizeof(SR_RAWFILE_MAGIC) - 1)) {
+		sr_err("Not an srraw file.");
+		return NULL;
+	}
+	if (RL32(data + SR_RAWFILE_HDR_VERSION) != SR_RAWFILE_VERSION) {
+		sr_err("Unsupported srraw version %" PRIu32 ".",
+			RL32(data + SR_RAWFILE_HDR_VERSION));
+		return NULL;
+	}
+	offset = RL64(data + SR_RAWFILE_HDR_META_OFFSET);
+	len = RL64(data + SR_RAWFILE_HDR_META_SIZE);
+	if (!offset || offset > size || len > size - offset) {
+		sr_err("Truncated srraw file, no metadata.");
+		return NULL;
+	}
+
+	keyfile = g_key_file_new();
+	error = NULL;
+	g_key_file_load_from_data(keyfile, data + offset, len,
+			G_KEY_FILE_NONE, &error);
+	if (error) {
+		sr_err("Failed to parse metadata: %s", error->message);
+		g_error_free(error);
+		g_key_file_free(keyfile);
+		return NULL;
+	}
+
+	return keyfile;
+}
+
 /** @private */
 SR_PRIV int sr_sessionfile_check(const char *filename)
 {
@@ -151,7 +396,7 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	zip_fclose(zf);
 	s[ret] = '\0';
 	version = g_ascii_strtoull(s, NULL, 10);
-	if (version == 0 || version > 2) {
+	if (version == 0 || version > 4) {
 		sr_dbg("Cannot handle sigrok session file version %" PRIu64 ".",
 			version);
 		zip_discard(archive);
@@ -195,6 +440,9 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct
 /**
  * Load the session from the specified filename.
  *
+ * Loads srzip archives as well as uncompressed srraw session files. The
+ * latter get memory mapped for their playback.
+ *
  * @param ctx The context in which to load the session.
  * @param filename The name of the session file to load.
  * @param session The session to load the file into.
@@ -218,24 +466,37 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	int total_channels, total_analog, k;
 	GSList *l;
 	int unitsize;
+	zip_int32_t method;
+	GMappedFile *map;
 	char **sections, **keys, *val;
 	char channelname[SR_MAX_CHANNELNAME_LEN + 1];
 	gboolean file_has_logic;
 
-	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
-		return ret;
-
-	if (!(archive = zip_open(filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
+	if (sr_rawfile_check(filename) == SR_OK) {
+		/* Uncompressed file, the session driver maps it. */
+		if (!(map = g_mapped_file_new(filename, FALSE, NULL)))
+			return SR_ERR;
+		kf = sr_rawfile_read_metadata(g_mapped_file_get_contents(map),
+				g_mapped_file_get_length(map));
+		g_mapped_file_unref(map);
+		if (!kf)
+			return SR_ERR_DATA;
+	} else {
+		if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+			return ret;
+
+		if (!(archive = zip_open(filename, 0, NULL)))
+			return SR_ERR;
+
+		if (zip_stat(archive, "metadata", 0, &zs) < 0) {
+			zip_discard(archive);
+			return SR_ERR;
+		}
+		kf = sr_sessionfile_read_metadata(archive, &zs);
 		zip_discard(archive);
-		return SR_ERR;
+		if (!kf)
+			return SR_ERR_DATA;
 	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	zip_discard(archive);
-	if (!kf)
-		return SR_ERR_DATA;
 
 	if ((ret = sr_session_new(ctx, session)) != SR_OK) {
 		g_key_file_free(kf);
@@ -249,9 +510,21 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	file_has_logic = FALSE;
 	sections = g_key_file_get_groups(kf, NULL);
 	for (i = 0; sections[i] && ret == SR_OK; i++) {
-		if (!strcmp(sections[i], "global"))
-			/* nothing really interesting in here yet */
+		if (!strcmp(sections[i], "global")) {
+			/*
+			 * libzip decompresses the members transparently,
+			 * only check that it is able to.
+			 */
+			val = g_key_file_get_string(kf, sections[i],
+				"compression", NULL);
+			if (val && sr_sessionfile_compression_lookup(val,
+					&method, FALSE) != SR_OK) {
+				sr_err("Unsupported compression '%s'.", val);
+				ret = SR_ERR_NA;
+			}
+			g_free(val);
 			continue;
+		}
 		if (!strncmp(sections[i], "device ", 7)) {
 			/* device section */
 			sdi = NULL;
@@ -393,4 +666,249 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+static void file_channel_free(void *data)
+{
+	struct sr_session_file_channel *ch;
+
+	ch = data;
+	g_free(ch->name);
+	g_free(ch);
+}
+
+/* Sum up the sizes of a capture's chunks, from the central directory. */
+static uint64_t zip_capture_size(struct zip *archive, const char *capturefile)
+{
+	struct zip_stat zs;
+	zip_int64_t i, count;
+	uint64_t size;
+	size_t len;
+
+	len = strlen(capturefile);
+	size = 0;
+	count = zip_get_num_entries(archive, 0);
+	for (i = 0; i < count; i++) {
+		if (zip_stat_index(archive, i, 0, &zs) < 0)
+			continue;
+		if (!(zs.valid & ZIP_STAT_NAME) || !(zs.valid & ZIP_STAT_SIZE))
+			continue;
+		/* Either "<capturefile>" or its chunks "<capturefile>-<n>". */
+		if (strncmp(zs.name, capturefile, len) != 0)
+			continue;
+		if (zs.name[len] != '\0' && zs.name[len] != '-')
+			continue;
+		size += zs.size;
+	}
+
+	return size;
+}
+
+/*
+ * Count the samples of a session file without reading its data. Files
+ * without the "total samples" key get counted from the size of their
+ * logic data, or of their first analog channel's data. Run length
+ * encoded chunks give no clue, their number of samples is unknown.
+ */
+static uint64_t file_info_samples(GKeyFile *kf, const char *group,
+		struct zip *archive, const struct sr_session_file_info *info)
+{
+	struct sr_analog_encoding encoding;
+	char *capturefile, *key, *val;
+	uint64_t samples, size, sample_size;
+	gboolean rle;
+
+	samples = g_key_file_get_uint64(kf, group, "total samples", NULL);
+	if (samples)
+		return samples;
+
+	if (info->unitsize) {
+		capturefile = g_strdup("logic-1");
+		sample_size = info->unitsize;
+		val = g_key_file_get_string(kf, group, "logic encoding", NULL);
+		rle = val && !strcmp(val, "rle");
+		g_free(val);
+		if (rle)
+			return 0;
+	} else if (info->num_analog_channels) {
+		capturefile = g_strdup_printf("analog-1-%d",
+			info->num_logic_channels + 1);
+		if (sr_sessionfile_analog_encoding(kf, group,
+				info->num_logic_channels + 1, &encoding) != SR_OK) {
+			g_free(capturefile);
+			return 0;
+		}
+		sample_size = encoding.unitsize;
+	} else {
+		return 0;
+	}
+
+	if (archive) {
+		size = zip_capture_size(archive, capturefile);
+	} else {
+		key = g_strdup_printf("%s size", capturefile);
+		size = g_key_file_get_uint64(kf, "planes", key, NULL);
+		g_free(key);
+	}
+	g_free(capturefile);
+
+	return size / sample_size;
+}
+
+static int file_info_parse(GKeyFile *kf, const char *group,
+		struct sr_session_file_info *info)
+{
+	struct sr_session_file_channel *ch;
+	char **keys, *val;
+	uint64_t tmp_u64;
+	int i, type, num;
+
+	val = g_key_file_get_string(kf, group, "samplerate", NULL);
+	if (val && sr_parse_sizestring(val, &info->samplerate) != SR_OK) {
+		g_free(val);
+		return SR_ERR_DATA;
+	}
+	g_free(val);
+
+	num = g_key_file_get_integer(kf, group, "total probes", NULL);
+	if (num < 0)
+		return SR_ERR_DATA;
+	info->num_logic_channels = num;
+	num = g_key_file_get_integer(kf, group, "total analog", NULL);
+	if (num < 0)
+		return SR_ERR_DATA;
+	info->num_analog_channels = num;
+
+	/* File contains logic data if a capturefile is set. */
+	if (g_key_file_has_key(kf, group, "capturefile", NULL)) {
+		num = g_key_file_get_integer(kf, group, "unitsize", NULL);
+		if (num < 0)
+			return SR_ERR_DATA;
+		info->unitsize = num;
+	}
+
+	keys = g_key_file_get_keys(kf, group, NULL, NULL);
+	for (i = 0; keys && keys[i]; i++) {
+		if (!strncmp(keys[i], "probe", 5)) {
+			type = SR_CHANNEL_LOGIC;
+			tmp_u64 = g_ascii_strtoull(keys[i] + 5, NULL, 10);
+		} else if (!strncmp(keys[i], "analog", 6)) {
+			type = SR_CHANNEL_ANALOG;
+			tmp_u64 = g_ascii_strtoull(keys[i] + 6, NULL, 10);
+		} else {
+			continue;
+		}
+		if (tmp_u64 == 0 || tmp_u64 > G_MAXINT) {
+			g_strfreev(keys);
+			return SR_ERR_DATA;
+		}
+		ch = g_malloc0(sizeof(*ch));
+		ch->index = tmp_u64 - 1;
+		ch->type = type;
+		ch->name = g_key_file_get_string(kf, group, keys[i], NULL);
+		info->channels = g_slist_append(info->channels, ch);
+	}
+	g_strfreev(keys);
+
+	return SR_OK;
+}
+
+/**
+ * Read the metadata of a session file.
+ *
+ * Unlike sr_session_load(), this creates neither a session nor devices,
+ * and doesn't open the file's sample data. Only the metadata and, for
+ * files which don't record their number of samples, the archive's
+ * directory get read. Suitable for scanning many files.
+ *
+ * @param[in] filename The name of the session file.
+ * @param[out] info Receives the file's metadata, to be released by
+ *                  sr_session_file_info_free(). Must not be NULL.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_DATA Malformed session file
+ * @retval SR_ERR This is not a session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_info_get(const char *filename,
+		struct sr_session_file_info **info)
+{
+	struct sr_session_file_info *fi;
+	GKeyFile *kf;
+	GMappedFile *map;
+	struct zip *archive;
+	struct zip_stat zs;
+	char **sections;
+	int ret, i;
+
+	if (!filename || !info)
+		return SR_ERR_ARG;
+
+	archive = NULL;
+	if (sr_rawfile_check(filename) == SR_OK) {
+		if (!(map = g_mapped_file_new(filename, FALSE, NULL)))
+			return SR_ERR;
+		kf = sr_rawfile_read_metadata(g_mapped_file_get_contents(map),
+				g_mapped_file_get_length(map));
+		g_mapped_file_unref(map);
+	} else {
+		if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+			return ret;
+		if (!(archive = zip_open(filename, 0, NULL)))
+			return SR_ERR;
+		if (zip_stat(archive, "metadata", 0, &zs) < 0) {
+			zip_discard(archive);
+			return SR_ERR;
+		}
+		kf = sr_sessionfile_read_metadata(archive, &zs);
+	}
+	if (!kf) {
+		if (archive)
+			zip_discard(archive);
+		return SR_ERR_DATA;
+	}
+
+	/* Session files hold a single device. */
+	fi = g_malloc0(sizeof(*fi));
+	ret = SR_ERR_DATA;
+	sections = g_key_file_get_groups(kf, NULL);
+	for (i = 0; sections[i]; i++) {
+		if (strncmp(sections[i], "device ", 7) != 0)
+			continue;
+		ret = file_info_parse(kf, sections[i], fi);
+		if (ret == SR_OK)
+			fi->num_samples = file_info_samples(kf, sections[i],
+				archive, fi);
+		break;
+	}
+	g_strfreev(sections);
+	g_key_file_free(kf);
+	if (archive)
+		zip_discard(archive);
+
+	if (ret != SR_OK) {
+		sr_session_file_info_free(fi);
+		return ret;
+	}
+	*info = fi;
+
+	return SR_OK;
+}
+
+/**
+ * Free the metadata which sr_session_file_info_get() returned.
+ *
+ * @param[in] info The metadata. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_file_info_free(struct sr_session_file_info *info)
+{
+	if (!info)
+		return;
+
+	g_slist_free_full(info->channels, file_channel_free);
+	g_free(info);
+}
+
 /** @} */
@@ -0,0 +1,349 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-output"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Output modules which the session runs on worker threads.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/** Default depth of an output's packet queue. */
+#define OUTPUT_QUEUE_DEPTH 64
+
+/** Packet which is waiting in an output's queue, a reference. */
+struct output_item {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+/**
+ * An output module and its worker thread. The ring of queued items is
+ * protected by the mutex. The dispatching thread blocks on the not_full
+ * condition, the worker thread waits for the not_empty condition.
+ */
+struct session_output {
+	struct sr_session *session;
+	const struct sr_output *o;
+	FILE *file;
+	GThread *thread;
+	GMutex mutex;
+	GCond not_empty;
+	GCond not_full;
+	struct output_item *items;
+	size_t depth;
+	size_t head;
+	size_t count;
+	gboolean quit;
+	/* First error of the output module, or of writing the file. */
+	int error;
+};
+
+/**
+ * The session's outputs. The mutex protects the list, outputs can get
+ * added and removed while the datafeed keeps going.
+ */
+struct session_outputs {
+	GMutex mutex;
+	GSList *list;
+};
+
+/* Worker thread of an output, runs the module and writes the file. */
+static gpointer output_thread(gpointer data)
+{
+	struct session_output *so;
+	struct output_item item;
+	GString *out;
+	int ret;
+
+	so = data;
+
+	sr_thread_policy_apply(&so->session->fanout_thread_policy, "output");
+
+	g_mutex_lock(&so->mutex);
+	while (TRUE) {
+		while (!so->count && !so->quit)
+			g_cond_wait(&so->not_empty, &so->mutex);
+		/* Only terminate after the queue was drained. */
+		if (!so->count)
+			break;
+		item = so->items[so->head];
+		so->head = (so->head + 1) % so->depth;
+		so->count--;
+		g_cond_signal(&so->not_full);
+		g_mutex_unlock(&so->mutex);
+
+		/* Keep draining after an error, but don't bother the module. */
+		if (!so->error) {
+			if (so->file) {
+				ret = sr_output_send_file(so->o, item.packet,
+					so->file);
+				if (ret == SR_OK && item.packet->type == SR_DF_END
+						&& fflush(so->file) != 0)
+					ret = SR_ERR_IO;
+			} else {
+				out = NULL;
+				ret = sr_output_send(so->o, item.packet, &out);
+				if (out)
+					g_string_free(out, TRUE);
+			}
+			if (ret != SR_OK) {
+				sr_err("Output module '%s' failed: %d.",
+					so->o->module->id, ret);
+				so->error = ret;
+			}
+		}
+		sr_packet_unref(item.packet);
+
+		g_mutex_lock(&so->mutex);
+	}
+	g_mutex_unlock(&so->mutex);
+
+	return NULL;
+}
+
+/* Drain an output's queue, terminate its thread and free it. */
+static int output_stop(struct session_output *so)
+{
+	int ret;
+
+	g_mutex_lock(&so->mutex);
+	so->quit = TRUE;
+	g_cond_signal(&so->not_empty);
+	g_mutex_unlock(&so->mutex);
+	g_thread_join(so->thread);
+
+	ret = so->error;
+	g_cond_clear(&so->not_full);
+	g_cond_clear(&so->not_empty);
+	g_mutex_clear(&so->mutex);
+	g_free(so->items);
+	g_free(so);
+
+	return ret;
+}
+
+/**
+ * Queue a packet for all of the session's outputs. Runs in the
+ * dispatching thread, after the transforms, and blocks while an output's
+ * queue is full.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_outputs_feed(struct session_outputs *outputs,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct session_output *so;
+	struct sr_datafeed_packet *copy;
+	struct output_item *item;
+	GSList *l;
+
+	g_mutex_lock(&outputs->mutex);
+	for (l = outputs->list; l; l = l->next) {
+		so = l->data;
+		if (so->o->sdi && so->o->sdi != sdi)
+			continue;
+		if (sr_packet_ref(packet, &copy) != SR_OK)
+			continue;
+		g_mutex_lock(&so->mutex);
+		while (so->count == so->depth)
+			g_cond_wait(&so->not_full, &so->mutex);
+		item = &so->items[(so->head + so->count) % so->depth];
+		item->sdi = sdi;
+		item->packet = copy;
+		so->count++;
+		g_cond_signal(&so->not_empty);
+		g_mutex_unlock(&so->mutex);
+	}
+	g_mutex_unlock(&outputs->mutex);
+}
+
+/**
+ * Drain and remove all of the session's outputs.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_outputs_free(struct session_outputs *outputs)
+{
+	GSList *l;
+
+	if (!outputs)
+		return;
+
+	for (l = outputs->list; l; l = l->next)
+		output_stop(l->data);
+	g_slist_free(outputs->list);
+	g_mutex_clear(&outputs->mutex);
+	g_free(outputs);
+}
+
+/**
+ * Run an output module on a worker thread of its own.
+ *
+ * The session passes all packets of the output's device to the output
+ * module, after the transforms, like it does for datafeed callbacks.
+ * Each output has a bounded queue of references to the packets, see
+ * sr_packet_ref(). The output module runs, and its output gets written
+ * to the file, in the output's worker thread. Several outputs thus run
+ * concurrently, and the datafeed only waits for an output when its
+ * queue is full. The file gets flushed after the SR_DF_END packet.
+ *
+ * The output must not be used otherwise while it is part of the
+ * session. Use sr_session_output_remove() before sr_output_free(), and
+ * before closing the file.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param o The output instance. Must not be NULL.
+ * @param file The file to write the output to. Must be NULL for output
+ *             modules which do their own I/O, see
+ *             SR_OUTPUT_INTERNAL_IO_HANDLING, and must not be NULL
+ *             otherwise.
+ * @param queue_depth The number of packets to queue, or 0 for the
+ *                    default.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the output already is part of
+ *                    the session.
+ * @retval SR_ERR The worker thread could not be created.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_output_add(struct sr_session *session,
+		const struct sr_output *o, FILE *file, size_t queue_depth)
+{
+	struct session_outputs *outputs;
+	struct session_output *so;
+	GError *error;
+	gboolean internal_io;
+	GSList *l;
+
+	if (!session || !o)
+		return SR_ERR_ARG;
+	internal_io = (o->module->flags & SR_OUTPUT_INTERNAL_IO_HANDLING) != 0;
+	if (internal_io != !file)
+		return SR_ERR_ARG;
+
+	if (!session->outputs) {
+		outputs = g_malloc0(sizeof(*outputs));
+		g_mutex_init(&outputs->mutex);
+		session->outputs = outputs;
+	}
+	outputs = session->outputs;
+
+	g_mutex_lock(&outputs->mutex);
+	for (l = outputs->list; l; l = l->next) {
+		so = l->data;
+		if (so->o == o) {
+			g_mutex_unlock(&outputs->mutex);
+			sr_err("Output is part of the session already.");
+			return SR_ERR_ARG;
+		}
+	}
+	g_mutex_unlock(&outputs->mutex);
+
+	so = g_malloc0(sizeof(*so));
+	so->session = session;
+	so->o = o;
+	so->file = file;
+	so->depth = queue_depth ? queue_depth : OUTPUT_QUEUE_DEPTH;
+	so->items = g_malloc0(so->depth * sizeof(so->items[0]));
+	g_mutex_init(&so->mutex);
+	g_cond_init(&so->not_empty);
+	g_cond_init(&so->not_full);
+
+	error = NULL;
+	so->thread = g_thread_try_new("sr-output", output_thread, so, &error);
+	if (!so->thread) {
+		sr_err("Cannot create output thread: %s.", error->message);
+		g_error_free(error);
+		g_cond_clear(&so->not_full);
+		g_cond_clear(&so->not_empty);
+		g_mutex_clear(&so->mutex);
+		g_free(so->items);
+		g_free(so);
+		return SR_ERR;
+	}
+	sr_dbg("Running output module '%s' on a thread of its own.",
+		o->module->id);
+
+	g_mutex_lock(&outputs->mutex);
+	outputs->list = g_slist_append(outputs->list, so);
+	g_mutex_unlock(&outputs->mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Remove an output from a session.
+ *
+ * Waits until the output has processed the packets in its queue, and
+ * terminates its worker thread. The output then can get freed, and its
+ * file is complete when the SR_DF_END packet was processed.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param o The output instance. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or the output is not part of the
+ *                    session.
+ * @retval other The first error of the output module, or of writing
+ *               the file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_output_remove(struct sr_session *session,
+		const struct sr_output *o)
+{
+	struct session_output *so;
+	GSList *l;
+
+	if (!session || !o || !session->outputs)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->outputs->mutex);
+	for (l = session->outputs->list; l; l = l->next) {
+		so = l->data;
+		if (so->o == o)
+			break;
+	}
+	if (l)
+		session->outputs->list = g_slist_delete_link(
+			session->outputs->list, l);
+	g_mutex_unlock(&session->outputs->mutex);
+	if (!l)
+		return SR_ERR_ARG;
+
+	return output_stop(so);
+}
+
+/** @} */
@@ -0,0 +1,508 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-poller"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Kernel event sets for the descriptors of the session's event sources.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/* Unix descriptors of sources, and NULL prepare() need GLib 2.36. */
+#if (defined(HAVE_SYS_EPOLL_H) || defined(HAVE_SYS_EVENT_H)) \
+		&& GLIB_CHECK_VERSION(2, 36, 0)
+
+/** Number of events which one dispatch takes from the kernel. */
+#define POLLER_EVENTS 64
+
+/** A descriptor in the poller's set, and the event source it serves. */
+struct poller_entry {
+	gushort events;
+	gushort *revents;
+};
+
+/**
+ * An epoll (or kqueue) set, which GLib polls as a single descriptor.
+ * Descriptors are registered one-shot. A ready descriptor gets reported
+ * to its event source once, by setting the source's revents, and only
+ * is reported again after the source was dispatched and re-armed it.
+ * The mutex protects the entries, sources get added and removed from
+ * any thread, while the poller gets dispatched in its context's thread.
+ */
+struct sr_poller {
+	GSource base;
+	GMainContext *context;
+	int kfd;
+	GMutex mutex;
+	GHashTable *entries;
+};
+
+/** The session's pollers, one per main context. */
+struct session_pollers {
+	GMutex mutex;
+	GSList *list;
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+
+static int kernel_set_new(void)
+{
+	return epoll_create1(EPOLL_CLOEXEC);
+}
+
+static int kernel_set_ctl(int kfd, int op, int fd, gushort events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLONESHOT;
+	if (events & G_IO_IN)
+		ev.events |= EPOLLIN;
+	if (events & G_IO_OUT)
+		ev.events |= EPOLLOUT;
+	if (events & G_IO_PRI)
+		ev.events |= EPOLLPRI;
+	ev.data.fd = fd;
+
+	return epoll_ctl(kfd, op, fd, &ev);
+}
+
+static int kernel_set_add(int kfd, int fd, gushort events)
+{
+	return kernel_set_ctl(kfd, EPOLL_CTL_ADD, fd, events);
+}
+
+static int kernel_set_rearm(int kfd, int fd, gushort events)
+{
+	return kernel_set_ctl(kfd, EPOLL_CTL_MOD, fd, events);
+}
+
+static void kernel_set_remove(int kfd, int fd, gushort events)
+{
+	(void)events;
+
+	epoll_ctl(kfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/* Take ready descriptors from the set, and map their events. */
+static int kernel_set_wait(int kfd, int *fds, gushort *revents)
+{
+	struct epoll_event evs[POLLER_EVENTS];
+	int i, n;
+
+	n = epoll_wait(kfd, evs, POLLER_EVENTS, 0);
+	for (i = 0; i < n; i++) {
+		fds[i] = evs[i].data.fd;
+		revents[i] = 0;
+		if (evs[i].events & EPOLLIN)
+			revents[i] |= G_IO_IN;
+		if (evs[i].events & EPOLLOUT)
+			revents[i] |= G_IO_OUT;
+		if (evs[i].events & EPOLLPRI)
+			revents[i] |= G_IO_PRI;
+		if (evs[i].events & EPOLLERR)
+			revents[i] |= G_IO_ERR;
+		if (evs[i].events & EPOLLHUP)
+			revents[i] |= G_IO_HUP;
+	}
+
+	return n;
+}
+
+#else
+
+static int kernel_set_new(void)
+{
+	return kqueue();
+}
+
+/* Read and write are separate kqueue filters. */
+static int kernel_set_ctl(int kfd, int fd, gushort events, u_short flags)
+{
+	struct kevent kev[2];
+	int n;
+
+	n = 0;
+	if (events & (G_IO_IN | G_IO_PRI))
+		EV_SET(&kev[n++], fd, EVFILT_READ, flags, 0, 0, NULL);
+	if (events & G_IO_OUT)
+		EV_SET(&kev[n++], fd, EVFILT_WRITE, flags, 0, 0, NULL);
+
+	return kevent(kfd, kev, n, NULL, 0, NULL);
+}
+
+static int kernel_set_add(int kfd, int fd, gushort events)
+{
+	return kernel_set_ctl(kfd, fd, events, EV_ADD | EV_DISPATCH);
+}
+
+static int kernel_set_rearm(int kfd, int fd, gushort events)
+{
+	return kernel_set_ctl(kfd, fd, events, EV_ENABLE | EV_DISPATCH);
+}
+
+static void kernel_set_remove(int kfd, int fd, gushort events)
+{
+	kernel_set_ctl(kfd, fd, events, EV_DELETE);
+}
+
+static int kernel_set_wait(int kfd, int *fds, gushort *revents)
+{
+	struct kevent kev[POLLER_EVENTS];
+	struct timespec ts;
+	int i, n;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 0;
+	n = kevent(kfd, NULL, 0, kev, POLLER_EVENTS, &ts);
+	for (i = 0; i < n; i++) {
+		fds[i] = (int)kev[i].ident;
+		revents[i] = 0;
+		if (kev[i].flags & EV_ERROR)
+			revents[i] |= G_IO_ERR;
+		else if (kev[i].filter == EVFILT_READ)
+			revents[i] |= G_IO_IN;
+		else if (kev[i].filter == EVFILT_WRITE)
+			revents[i] |= G_IO_OUT;
+		if (kev[i].flags & EV_EOF)
+			revents[i] |= G_IO_HUP;
+	}
+
+	return n;
+}
+
+#endif
+
+/** Poller dispatch() method, called when the kernel set is readable. */
+static gboolean poller_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct sr_poller *poller;
+	struct poller_entry *entry;
+	int fds[POLLER_EVENTS];
+	gushort revents[POLLER_EVENTS];
+	int i, n;
+
+	(void)callback;
+	(void)user_data;
+
+	poller = (struct sr_poller *)source;
+
+	n = kernel_set_wait(poller->kfd, fds, revents);
+	if (n < 0 && errno != EINTR)
+		sr_err("Cannot wait for events: %s.", g_strerror(errno));
+
+	/*
+	 * The sources' prepare() methods check revents in the next
+	 * iteration of the main loop, which dispatches them.
+	 */
+	g_mutex_lock(&poller->mutex);
+	for (i = 0; i < n; i++) {
+		entry = g_hash_table_lookup(poller->entries,
+			GINT_TO_POINTER(fds[i]));
+		if (entry)
+			*entry->revents |= revents[i];
+	}
+	g_mutex_unlock(&poller->mutex);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/** Poller finalize() method. */
+static void poller_finalize(GSource *source)
+{
+	struct sr_poller *poller;
+
+	poller = (struct sr_poller *)source;
+
+	g_hash_table_unref(poller->entries);
+	g_mutex_clear(&poller->mutex);
+	close(poller->kfd);
+}
+
+static struct sr_poller *poller_new(GMainContext *context)
+{
+	static GSourceFuncs poller_funcs = {
+		.dispatch = &poller_dispatch,
+		.finalize = &poller_finalize,
+	};
+	struct sr_poller *poller;
+	GSource *source;
+	int kfd;
+
+	kfd = kernel_set_new();
+	if (kfd < 0) {
+		sr_warn("Cannot create kernel event set: %s.",
+			g_strerror(errno));
+		return NULL;
+	}
+
+	source = g_source_new(&poller_funcs, sizeof(struct sr_poller));
+	poller = (struct sr_poller *)source;
+	g_source_set_name(source, "poller");
+	poller->context = context;
+	poller->kfd = kfd;
+	g_mutex_init(&poller->mutex);
+	poller->entries = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	g_source_add_unix_fd(source, kfd, G_IO_IN);
+	g_source_attach(source, context);
+
+	return poller;
+}
+
+/** @private */
+SR_PRIV struct session_pollers *sr_session_pollers_new(void)
+{
+	struct session_pollers *pollers;
+
+	pollers = g_malloc0(sizeof(*pollers));
+	g_mutex_init(&pollers->mutex);
+
+	return pollers;
+}
+
+/** @private */
+SR_PRIV void sr_session_pollers_free(struct session_pollers *pollers)
+{
+	GSList *l;
+
+	if (!pollers)
+		return;
+
+	for (l = pollers->list; l; l = l->next) {
+		g_source_destroy(l->data);
+		g_source_unref(l->data);
+	}
+	g_slist_free(pollers->list);
+	g_mutex_clear(&pollers->mutex);
+	g_free(pollers);
+}
+
+/**
+ * Get the poller for event sources which are about to be attached to
+ * the session, to the main context of the calling device thread or to
+ * the session's main context. The poller gets created on first use.
+ *
+ * @return A new reference to the poller, or NULL when descriptors have
+ *         to be polled by GLib.
+ *
+ * @private
+ */
+SR_PRIV struct sr_poller *sr_session_poller_get(struct sr_session *session)
+{
+	struct session_pollers *pollers;
+	struct sr_poller *poller;
+	GMainContext *context;
+	GSList *l;
+
+	pollers = session->pollers;
+	context = sr_session_source_context(session);
+	if (!pollers || !context)
+		return NULL;
+
+	g_mutex_lock(&pollers->mutex);
+	poller = NULL;
+	for (l = pollers->list; l; l = l->next) {
+		poller = l->data;
+		if (poller->context == context)
+			break;
+	}
+	/* A device thread's context went away, with its poller. */
+	if (l && g_source_is_destroyed(&poller->base)) {
+		pollers->list = g_slist_delete_link(pollers->list, l);
+		g_source_unref(&poller->base);
+		l = NULL;
+	}
+	if (!l) {
+		poller = poller_new(context);
+		if (poller)
+			pollers->list = g_slist_prepend(pollers->list, poller);
+	}
+	if (poller)
+		g_source_ref(&poller->base);
+	g_mutex_unlock(&pollers->mutex);
+
+	return poller;
+}
+
+/** @private */
+SR_PRIV void sr_session_poller_unref(struct sr_poller *poller)
+{
+	if (poller)
+		g_source_unref(&poller->base);
+}
+
+/**
+ * Add a descriptor to the poller's set. Its events get or'ed into
+ * @a revents, which the event source must clear when it dispatches.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The descriptor can't be polled by the kernel set, e.g.
+ *                because it's a regular file or is in the set already.
+ *                GLib has to poll it.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_poller_add(struct sr_poller *poller, gintptr fd,
+		gushort events, gushort *revents)
+{
+	struct poller_entry *entry;
+	int ret;
+
+	g_mutex_lock(&poller->mutex);
+	if (g_hash_table_contains(poller->entries, GINT_TO_POINTER(fd))) {
+		g_mutex_unlock(&poller->mutex);
+		return SR_ERR;
+	}
+	ret = kernel_set_add(poller->kfd, fd, events);
+	if (ret == 0) {
+		entry = g_malloc0(sizeof(*entry));
+		entry->events = events;
+		entry->revents = revents;
+		g_hash_table_insert(poller->entries, GINT_TO_POINTER(fd),
+			entry);
+	}
+	g_mutex_unlock(&poller->mutex);
+
+	if (ret != 0) {
+		sr_dbg("Cannot add fd %" G_GINTPTR_FORMAT " to the set: %s.",
+			fd, g_strerror(errno));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Re-arm a descriptor after its event source was dispatched.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_poller_rearm(struct sr_poller *poller, gintptr fd)
+{
+	struct poller_entry *entry;
+
+	g_mutex_lock(&poller->mutex);
+	entry = g_hash_table_lookup(poller->entries, GINT_TO_POINTER(fd));
+	if (entry && kernel_set_rearm(poller->kfd, fd, entry->events) != 0)
+		sr_err("Cannot re-arm fd %" G_GINTPTR_FORMAT ": %s.",
+			fd, g_strerror(errno));
+	g_mutex_unlock(&poller->mutex);
+}
+
+/**
+ * Remove a descriptor from the poller's set. The poller won't touch the
+ * event source's revents any more after this returns.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_poller_remove(struct sr_poller *poller, gintptr fd)
+{
+	struct poller_entry *entry;
+
+	g_mutex_lock(&poller->mutex);
+	entry = g_hash_table_lookup(poller->entries, GINT_TO_POINTER(fd));
+	if (entry) {
+		kernel_set_remove(poller->kfd, fd, entry->events);
+		g_hash_table_remove(poller->entries, GINT_TO_POINTER(fd));
+	}
+	g_mutex_unlock(&poller->mutex);
+}
+
+#else
+
+/* Without epoll or kqueue, GLib polls all descriptors. */
+
+/** @private */
+SR_PRIV struct session_pollers *sr_session_pollers_new(void)
+{
+	return NULL;
+}
+
+/** @private */
+SR_PRIV void sr_session_pollers_free(struct session_pollers *pollers)
+{
+	(void)pollers;
+}
+
+/** @private */
+SR_PRIV struct sr_poller *sr_session_poller_get(struct sr_session *session)
+{
+	(void)session;
+
+	return NULL;
+}
+
+/** @private */
+SR_PRIV void sr_session_poller_unref(struct sr_poller *poller)
+{
+	(void)poller;
+}
+
+/** @private */
+SR_PRIV int sr_session_poller_add(struct sr_poller *poller, gintptr fd,
+		gushort events, gushort *revents)
+{
+	(void)poller;
+	(void)fd;
+	(void)events;
+	(void)revents;
+
+	return SR_ERR;
+}
+
+/** @private */
+SR_PRIV void sr_session_poller_rearm(struct sr_poller *poller, gintptr fd)
+{
+	(void)poller;
+	(void)fd;
+}
+
+/** @private */
+SR_PRIV void sr_session_poller_remove(struct sr_poller *poller, gintptr fd)
+{
+	(void)poller;
+	(void)fd;
+}
+
+#endif
+
+/** @} */
@@ -0,0 +1,506 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-recorder"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Flight recorder, which keeps the most recent sample data of a session.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/** Recorded packet, a reference to a datafeed packet. */
+struct recorder_item {
+	struct sr_datafeed_packet *packet;
+	uint64_t seq;
+	uint64_t samples;
+	int64_t time;
+};
+
+/**
+ * Recorded packets of one stream of a device: the logic data, or the
+ * analog data of one channel.
+ */
+struct recorder_stream {
+	int type;
+	const struct sr_channel *channel;
+	GQueue items;
+	uint64_t samples;
+};
+
+/** Recorded data of one device, since its most recent SR_DF_HEADER. */
+struct device_recorder {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *header;
+	GSList *meta;
+	GSList *streams;
+	uint64_t seq;
+};
+
+/**
+ * The session's flight recorder. The mutex protects the recorded data
+ * against concurrent snapshots while the datafeed keeps going.
+ */
+struct session_recorder {
+	GMutex mutex;
+	uint64_t max_samples;
+	int64_t max_age;
+	GHashTable *devices;
+};
+
+static void recorder_item_free(struct recorder_item *item)
+{
+	sr_packet_unref(item->packet);
+	g_free(item);
+}
+
+static void recorder_stream_free(struct recorder_stream *stream)
+{
+	struct recorder_item *item;
+
+	while ((item = g_queue_pop_head(&stream->items)))
+		recorder_item_free(item);
+	g_free(stream);
+}
+
+static void device_recorder_clear(struct device_recorder *dr)
+{
+	if (dr->header)
+		sr_packet_unref(dr->header);
+	dr->header = NULL;
+	g_slist_free_full(dr->meta, (GDestroyNotify)sr_packet_unref);
+	dr->meta = NULL;
+	g_slist_free_full(dr->streams, (GDestroyNotify)recorder_stream_free);
+	dr->streams = NULL;
+}
+
+static void device_recorder_free(struct device_recorder *dr)
+{
+	device_recorder_clear(dr);
+	g_free(dr);
+}
+
+/** @private */
+SR_PRIV void sr_session_recorder_free(struct session_recorder *recorder)
+{
+	if (!recorder)
+		return;
+
+	g_hash_table_unref(recorder->devices);
+	g_mutex_clear(&recorder->mutex);
+	g_free(recorder);
+}
+
+/**
+ * Keep the most recent sample data of all devices in a session.
+ *
+ * The flight recorder keeps the logic data, and the analog data of each
+ * channel, which the session's devices sent most recently. Older data
+ * gets discarded when either of the limits is exceeded. The recorded
+ * data can get retrieved at any time by means of
+ * sr_session_recorder_snapshot() or sr_session_recorder_save(), without
+ * stopping the acquisition. Recording starts over when a device sends
+ * a new SR_DF_HEADER packet.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_samples The number of samples to keep per stream, or 0
+ *                    for no limit.
+ * @param max_age_ms Keep data which was received within this number of
+ *                   milliseconds, or 0 for no limit.
+ *
+ * Passing 0 for both limits disables the flight recorder, and releases
+ * all recorded data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_recorder_set(struct sr_session *session,
+		uint64_t max_samples, uint64_t max_age_ms)
+{
+	struct session_recorder *recorder;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change the flight recorder while session is running.");
+		return SR_ERR;
+	}
+
+	sr_session_recorder_free(session->recorder);
+	session->recorder = NULL;
+	if (!max_samples && !max_age_ms)
+		return SR_OK;
+
+	recorder = g_malloc0(sizeof(*recorder));
+	g_mutex_init(&recorder->mutex);
+	recorder->max_samples = max_samples;
+	recorder->max_age = (int64_t)max_age_ms * 1000;
+	recorder->devices = g_hash_table_new_full(NULL, NULL, NULL,
+		(GDestroyNotify)device_recorder_free);
+	session->recorder = recorder;
+
+	sr_dbg("Flight recorder keeps %" PRIu64 " samples, %" PRIu64 " ms.",
+		max_samples, max_age_ms);
+
+	return SR_OK;
+}
+
+static struct recorder_stream *stream_get(struct device_recorder *dr,
+		int type, const struct sr_channel *channel)
+{
+	struct recorder_stream *stream;
+	GSList *l;
+
+	for (l = dr->streams; l; l = l->next) {
+		stream = l->data;
+		if (stream->type == type && stream->channel == channel)
+			return stream;
+	}
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->type = type;
+	stream->channel = channel;
+	g_queue_init(&stream->items);
+	dr->streams = g_slist_append(dr->streams, stream);
+
+	return stream;
+}
+
+/* Discard the oldest packets which are beyond the recorder's limits. */
+static void stream_trim(struct session_recorder *recorder,
+		struct recorder_stream *stream, int64_t now)
+{
+	struct recorder_item *item;
+	gboolean too_many, too_old;
+
+	while ((item = g_queue_peek_head(&stream->items))) {
+		too_many = recorder->max_samples
+			&& stream->samples - item->samples >= recorder->max_samples;
+		too_old = recorder->max_age && now - item->time > recorder->max_age;
+		if (!too_many && !too_old)
+			break;
+		g_queue_pop_head(&stream->items);
+		stream->samples -= item->samples;
+		recorder_item_free(item);
+	}
+}
+
+/**
+ * Record a packet which a device has sent. Runs in the dispatching
+ * thread, before the packet gets passed to transforms.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_recorder_feed(struct session_recorder *recorder,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct device_recorder *dr;
+	struct recorder_stream *stream;
+	struct recorder_item *item;
+	struct sr_datafeed_packet *ref;
+	const struct sr_channel *channel;
+	uint64_t samples;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+	case SR_DF_META:
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!logic->unitsize || !logic->length)
+			return;
+		samples = logic->length / logic->unitsize;
+		channel = NULL;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		if (!analog->num_samples)
+			return;
+		samples = analog->num_samples;
+		channel = (analog->meaning && analog->meaning->channels)
+			? analog->meaning->channels->data : NULL;
+		break;
+	default:
+		return;
+	}
+
+	if (sr_packet_ref(packet, &ref) != SR_OK)
+		return;
+
+	g_mutex_lock(&recorder->mutex);
+
+	dr = g_hash_table_lookup(recorder->devices, sdi);
+	if (!dr) {
+		dr = g_malloc0(sizeof(*dr));
+		dr->sdi = sdi;
+		g_hash_table_insert(recorder->devices, (void *)sdi, dr);
+	}
+
+	if (packet->type == SR_DF_HEADER) {
+		device_recorder_clear(dr);
+		dr->header = ref;
+	} else if (packet->type == SR_DF_META) {
+		dr->meta = g_slist_append(dr->meta, ref);
+	} else {
+		item = g_malloc0(sizeof(*item));
+		item->packet = ref;
+		item->seq = dr->seq++;
+		item->samples = samples;
+		item->time = g_get_monotonic_time();
+		stream = stream_get(dr, packet->type, channel);
+		g_queue_push_tail(&stream->items, item);
+		stream->samples += samples;
+		stream_trim(recorder, stream, item->time);
+	}
+
+	g_mutex_unlock(&recorder->mutex);
+}
+
+/* Snapshot item, references a recorded packet. */
+struct snapshot_item {
+	struct sr_datafeed_packet *packet;
+	uint64_t seq;
+	uint64_t skip;
+};
+
+static gint snapshot_item_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct snapshot_item *ia, *ib;
+
+	ia = a;
+	ib = b;
+	if (ia->seq < ib->seq)
+		return -1;
+
+	return ia->seq > ib->seq;
+}
+
+/* Pass a recorded packet on, skipping leading samples beyond the limit. */
+static void snapshot_send(const struct sr_dev_inst *sdi,
+		const struct snapshot_item *si,
+		sr_datafeed_callback cb, void *cb_data)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+
+	if (!si->skip || (si->packet->type == SR_DF_ANALOG
+			&& !((const struct sr_datafeed_analog *)
+				si->packet->payload)->encoding)) {
+		cb(sdi, si->packet, cb_data);
+		return;
+	}
+
+	packet.type = si->packet->type;
+	if (packet.type == SR_DF_LOGIC) {
+		logic = *(const struct sr_datafeed_logic *)si->packet->payload;
+		logic.data = (uint8_t *)logic.data + si->skip * logic.unitsize;
+		logic.length -= si->skip * logic.unitsize;
+		packet.payload = &logic;
+	} else {
+		analog = *(const struct sr_datafeed_analog *)si->packet->payload;
+		analog.data = (uint8_t *)analog.data
+			+ si->skip * analog.encoding->unitsize;
+		analog.num_samples -= si->skip;
+		packet.payload = &analog;
+	}
+	cb(sdi, &packet, cb_data);
+}
+
+/**
+ * Pass the data which the flight recorder holds for a device to a callback.
+ *
+ * The callback receives a regular packet stream: the device's most
+ * recent SR_DF_HEADER and SR_DF_META packets, the recorded logic and
+ * analog data in their original order, and a final SR_DF_END packet.
+ * Acquisition continues while the snapshot gets taken. The recorder is
+ * not involved in the callback's invocations, which can take their time.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device to take a snapshot of. Must not be NULL.
+ * @param cb The callback which receives the packets. Must not be NULL.
+ * @param cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The flight recorder is not enabled, or holds no
+ *                   data for the device.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_recorder_snapshot(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		sr_datafeed_callback cb, void *cb_data)
+{
+	struct session_recorder *recorder;
+	struct device_recorder *dr;
+	struct recorder_stream *stream;
+	struct recorder_item *item;
+	struct snapshot_item *si;
+	struct sr_datafeed_packet *header, *ref, packet;
+	GArray *items;
+	GSList *meta, *l;
+	GList *i;
+	uint64_t samples;
+	guint idx;
+
+	if (!session || !sdi || !cb)
+		return SR_ERR_ARG;
+
+	recorder = session->recorder;
+	if (!recorder)
+		return SR_ERR_NA;
+
+	/* Take references to the recorded packets, then release the lock. */
+	g_mutex_lock(&recorder->mutex);
+	dr = g_hash_table_lookup(recorder->devices, sdi);
+	if (!dr || !dr->header) {
+		g_mutex_unlock(&recorder->mutex);
+		return SR_ERR_NA;
+	}
+	sr_packet_ref(dr->header, &header);
+	meta = NULL;
+	for (l = dr->meta; l; l = l->next) {
+		sr_packet_ref(l->data, &ref);
+		meta = g_slist_append(meta, ref);
+	}
+	items = g_array_new(FALSE, TRUE, sizeof(struct snapshot_item));
+	for (l = dr->streams; l; l = l->next) {
+		stream = l->data;
+		samples = stream->samples;
+		for (i = stream->items.head; i; i = i->next) {
+			item = i->data;
+			g_array_set_size(items, items->len + 1);
+			si = &g_array_index(items, struct snapshot_item, items->len - 1);
+			sr_packet_ref(item->packet, &si->packet);
+			si->seq = item->seq;
+			/* Trim the oldest packet to the sample limit. */
+			if (recorder->max_samples && samples > recorder->max_samples)
+				si->skip = samples - recorder->max_samples;
+			samples -= item->samples;
+			if (si->skip >= item->samples)
+				si->skip = 0;
+		}
+	}
+	g_mutex_unlock(&recorder->mutex);
+
+	g_array_sort(items, snapshot_item_cmp);
+
+	cb(sdi, header, cb_data);
+	for (l = meta; l; l = l->next)
+		cb(sdi, l->data, cb_data);
+	for (idx = 0; idx < items->len; idx++) {
+		si = &g_array_index(items, struct snapshot_item, idx);
+		snapshot_send(sdi, si, cb, cb_data);
+		sr_packet_unref(si->packet);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	cb(sdi, &packet, cb_data);
+
+	g_array_free(items, TRUE);
+	g_slist_free_full(meta, (GDestroyNotify)sr_packet_unref);
+	sr_packet_unref(header);
+
+	return SR_OK;
+}
+
+static void save_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_output *o;
+	GString *out;
+
+	(void)sdi;
+
+	o = cb_data;
+	out = NULL;
+	if (sr_output_send(o, packet, &out) != SR_OK)
+		sr_err("Cannot write flight recorder packet.");
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+/**
+ * Save the data which the flight recorder holds for a device to a file.
+ *
+ * The file is written in the srzip session file format, from a snapshot
+ * as taken by sr_session_recorder_snapshot(). Acquisition continues
+ * while the file gets written.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device to save the data of. Must not be NULL.
+ * @param filename The name of the file to write. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The flight recorder holds no data for the device,
+ *                   or srzip output is not available.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_recorder_save(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const char *filename)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	int ret;
+
+	if (!session || !sdi || !filename)
+		return SR_ERR_ARG;
+
+	if (!session->recorder)
+		return SR_ERR_NA;
+
+	omod = sr_output_find("srzip");
+	if (!omod) {
+		sr_err("No srzip output module.");
+		return SR_ERR_NA;
+	}
+	o = sr_output_new(omod, NULL, sdi, filename);
+	if (!o)
+		return SR_ERR;
+
+	ret = sr_session_recorder_snapshot(session, sdi, save_cb, (void *)o);
+	sr_output_free(o);
+
+	return ret;
+}
+
+/** @} */
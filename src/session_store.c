@@ -0,0 +1,929 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "minilzo/minilzo.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-store"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Capture store, which keeps all sample data of a session in memory for
+ * random access.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/** Size of a segment's uncompressed sample data. */
+#define STORE_SEGMENT_SIZE (1 << 20)
+
+/** Samples at a time, when logic runs get expanded for storing. */
+#define RUNS_EXPAND_SAMPLES (64 * 1024)
+
+/**
+ * A segment of a stream's samples. Segments get filled one after the
+ * other, full segments get compressed when that is enabled. The session
+ * time of the first sample, and the samplerate, make up the time index.
+ */
+struct store_segment {
+	uint64_t start;
+	uint64_t samples;
+	/* Session time of the first and the most recent sample's arrival. */
+	int64_t time;
+	int64_t last_time;
+	/* Samplerate of all of the segment's samples, 0 if unknown. */
+	uint64_t samplerate;
+	uint8_t *data;
+	size_t size;
+	gboolean compressed;
+};
+
+/**
+ * Stored samples of one stream of a device: the logic data, or the
+ * analog data of one channel as floats.
+ */
+struct store_stream {
+	int type;
+	const struct sr_channel *channel;
+	size_t unitsize;
+	uint64_t segment_samples;
+	GPtrArray *segments;
+	/* The last segment is being filled, not compressed yet. */
+	gboolean open;
+	uint64_t samples;
+};
+
+/** Stored data of one device, since its most recent SR_DF_HEADER. */
+struct device_store {
+	const struct sr_dev_inst *sdi;
+	GSList *streams;
+	/* Samplerate of the most recent SR_DF_META, 0 if none. */
+	uint64_t samplerate;
+	/* Analog packets get converted to floats here. */
+	float *floats;
+	size_t floats_size;
+	/* Runs and planar logic packets get expanded here. */
+	uint8_t *logic;
+	size_t logic_size;
+};
+
+/**
+ * The session's capture store. The mutex protects the stored data
+ * against concurrent queries while the datafeed keeps going.
+ */
+struct session_store {
+	GMutex mutex;
+	struct sr_session *session;
+	gboolean compress;
+	GHashTable *devices;
+	void *lzo_wrkmem;
+	uint8_t *lzo_buf;
+	size_t lzo_buf_size;
+	/* The most recently decompressed segment. */
+	const struct store_segment *cached;
+	uint8_t *cache;
+};
+
+static void store_segment_free(struct store_segment *segment)
+{
+	g_free(segment->data);
+	g_free(segment);
+}
+
+static void store_stream_free(struct store_stream *stream)
+{
+	g_ptr_array_unref(stream->segments);
+	g_free(stream);
+}
+
+static void device_store_clear(struct device_store *ds)
+{
+	g_slist_free_full(ds->streams, (GDestroyNotify)store_stream_free);
+	ds->streams = NULL;
+	ds->samplerate = 0;
+}
+
+static void device_store_free(struct device_store *ds)
+{
+	device_store_clear(ds);
+	g_free(ds->floats);
+	g_free(ds->logic);
+	g_free(ds);
+}
+
+/** @private */
+SR_PRIV void sr_session_store_free(struct session_store *store)
+{
+	if (!store)
+		return;
+
+	g_hash_table_unref(store->devices);
+	g_free(store->lzo_wrkmem);
+	g_free(store->lzo_buf);
+	g_free(store->cache);
+	g_mutex_clear(&store->mutex);
+	g_free(store);
+}
+
+/**
+ * Keep all sample data of a session in memory, for random access.
+ *
+ * The capture store keeps the logic data, and the analog data of each
+ * channel, which the session's devices send, after the transforms.
+ * Applications and their components can query ranges of samples at any
+ * time, also while the acquisition keeps going, instead of keeping
+ * copies of the datafeed of their own. The data is kept in segments of
+ * 1 MiB, which get compressed when they are full if @a compress is set.
+ * Sample numbers map to session time and back, see
+ * sr_session_store_sample_find(). Storing starts over when a device sends
+ * a new SR_DF_HEADER packet.
+ *
+ * The store keeps growing with the acquisition, there is no limit.
+ * See sr_session_recorder_set() for keeping the most recent data only.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to keep the sample data, FALSE to release all
+ *               stored data.
+ * @param compress TRUE to compress full segments.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_store_set(struct sr_session *session,
+		gboolean enable, gboolean compress)
+{
+	struct session_store *store;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	if (session->running) {
+		sr_err("Cannot change the capture store while session is running.");
+		return SR_ERR;
+	}
+
+	sr_session_store_free(session->store);
+	session->store = NULL;
+	if (!enable)
+		return SR_OK;
+
+	store = g_malloc0(sizeof(*store));
+	g_mutex_init(&store->mutex);
+	store->session = session;
+	store->compress = compress;
+	store->devices = g_hash_table_new_full(NULL, NULL, NULL,
+		(GDestroyNotify)device_store_free);
+	/* LZO got initialized by sr_init(). */
+	if (compress)
+		store->lzo_wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+	session->store = store;
+
+	sr_dbg("Capture store enabled%s.", compress ? ", compressed" : "");
+
+	return SR_OK;
+}
+
+static struct store_stream *stream_get(struct session_store *store,
+		struct device_store *ds, int type,
+		const struct sr_channel *channel, size_t unitsize)
+{
+	struct store_stream *stream;
+	GSList *l;
+
+	for (l = ds->streams; l; l = l->next) {
+		stream = l->data;
+		if (stream->type == type && stream->channel == channel)
+			break;
+	}
+	/* Logic data which changes its unitsize starts over. */
+	if (l && stream->unitsize != unitsize) {
+		store->cached = NULL;
+		ds->streams = g_slist_remove(ds->streams, stream);
+		store_stream_free(stream);
+		l = NULL;
+	}
+	if (l)
+		return stream;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->type = type;
+	stream->channel = channel;
+	stream->unitsize = unitsize;
+	stream->segment_samples = MAX(STORE_SEGMENT_SIZE / unitsize, 1);
+	stream->segments = g_ptr_array_new_with_free_func(
+		(GDestroyNotify)store_segment_free);
+	ds->streams = g_slist_append(ds->streams, stream);
+
+	return stream;
+}
+
+/* Compress a full segment, if that is enabled and saves memory. */
+static void segment_seal(struct session_store *store,
+		struct store_segment *segment, size_t unitsize)
+{
+	lzo_uint lzo_len;
+	size_t raw_len;
+
+	raw_len = segment->samples * unitsize;
+	if (!store->compress) {
+		segment->data = g_realloc(segment->data, raw_len);
+		segment->size = raw_len;
+		return;
+	}
+
+	lzo_len = raw_len + raw_len / 16 + 64 + 3;
+	if (lzo_len > store->lzo_buf_size) {
+		g_free(store->lzo_buf);
+		store->lzo_buf = g_malloc(lzo_len);
+		store->lzo_buf_size = lzo_len;
+	}
+	if (lzo1x_1_compress(segment->data, raw_len, store->lzo_buf,
+			&lzo_len, store->lzo_wrkmem) == LZO_E_OK
+			&& lzo_len < raw_len) {
+		segment->data = g_realloc(segment->data, lzo_len);
+		memcpy(segment->data, store->lzo_buf, lzo_len);
+		segment->size = lzo_len;
+		segment->compressed = TRUE;
+	} else {
+		segment->data = g_realloc(segment->data, raw_len);
+		segment->size = raw_len;
+	}
+}
+
+static void stream_seal(struct session_store *store,
+		struct store_stream *stream)
+{
+	if (!stream->open)
+		return;
+	segment_seal(store, g_ptr_array_index(stream->segments,
+		stream->segments->len - 1), stream->unitsize);
+	stream->open = FALSE;
+}
+
+/* Append samples to a stream, opening new segments as needed. */
+static void stream_append(struct session_store *store,
+		struct device_store *ds, struct store_stream *stream,
+		const uint8_t *data, uint64_t samples, size_t stride)
+{
+	struct store_segment *segment;
+	uint64_t count, idx, samplerate;
+	uint8_t *wrptr;
+	int64_t now;
+
+	now = sr_session_timebase_sample_time(store->session->timebase,
+		NULL, 0, NULL);
+	while (samples) {
+		if (!stream->open) {
+			segment = g_malloc0(sizeof(*segment));
+			segment->start = stream->samples;
+			segment->time = sr_session_timebase_sample_time(
+				store->session->timebase, ds->sdi,
+				segment->start, &samplerate);
+			/* The datafeed's most recent samplerate. */
+			segment->samplerate = ds->samplerate
+				? ds->samplerate : samplerate;
+			segment->data = g_malloc(stream->segment_samples
+				* stream->unitsize);
+			g_ptr_array_add(stream->segments, segment);
+			stream->open = TRUE;
+		}
+		segment = g_ptr_array_index(stream->segments,
+			stream->segments->len - 1);
+		count = MIN(samples, stream->segment_samples - segment->samples);
+		wrptr = segment->data + segment->samples * stream->unitsize;
+		if (stride == stream->unitsize) {
+			memcpy(wrptr, data, count * stream->unitsize);
+			data += count * stream->unitsize;
+		} else {
+			for (idx = 0; idx < count; idx++) {
+				memcpy(wrptr, data, stream->unitsize);
+				wrptr += stream->unitsize;
+				data += stride;
+			}
+		}
+		segment->samples += count;
+		segment->last_time = now;
+		stream->samples += count;
+		samples -= count;
+		if (segment->samples == stream->segment_samples)
+			stream_seal(store, stream);
+	}
+}
+
+static void store_logic(struct session_store *store,
+		struct device_store *ds, const struct sr_datafeed_logic *logic)
+{
+	struct store_stream *stream;
+
+	if (!logic->unitsize || !logic->length)
+		return;
+
+	stream = stream_get(store, ds, SR_DF_LOGIC, NULL, logic->unitsize);
+	stream_append(store, ds, stream, logic->data,
+		logic->length / logic->unitsize, logic->unitsize);
+}
+
+static uint8_t *logic_buffer(struct device_store *ds, size_t size)
+{
+	if (size > ds->logic_size) {
+		g_free(ds->logic);
+		ds->logic = g_malloc(size);
+		ds->logic_size = size;
+	}
+
+	return ds->logic;
+}
+
+static void store_logic_runs(struct session_store *store,
+		struct device_store *ds, const struct sr_datafeed_logic_runs *runs)
+{
+	struct store_stream *stream;
+	uint64_t run, offset, count;
+	uint8_t *samples;
+
+	if (!runs->unitsize || !runs->num_runs)
+		return;
+
+	stream = stream_get(store, ds, SR_DF_LOGIC, NULL, runs->unitsize);
+	samples = logic_buffer(ds, RUNS_EXPAND_SAMPLES * runs->unitsize);
+	run = offset = 0;
+	while ((count = sr_logic_runs_expand(runs, &run, &offset, samples,
+			RUNS_EXPAND_SAMPLES)))
+		stream_append(store, ds, stream, samples, count,
+			runs->unitsize);
+}
+
+static void store_logic_planar(struct session_store *store,
+		struct device_store *ds,
+		const struct sr_datafeed_logic_planar *planar)
+{
+	struct store_stream *stream;
+	uint64_t samples;
+	uint8_t *data;
+
+	if (!planar->unitsize || !planar->num_blocks)
+		return;
+
+	samples = planar->num_blocks * 32;
+	data = logic_buffer(ds, samples * planar->unitsize);
+	if (sr_logic_planar_to_logic(planar, data) != SR_OK) {
+		sr_err("Cannot convert planar logic data for storing.");
+		return;
+	}
+	stream = stream_get(store, ds, SR_DF_LOGIC, NULL, planar->unitsize);
+	stream_append(store, ds, stream, data, samples, planar->unitsize);
+}
+
+static void store_analog(struct session_store *store,
+		struct device_store *ds, const struct sr_datafeed_analog *analog)
+{
+	struct store_stream *stream;
+	const struct sr_channel *channel;
+	size_t num_channels, values, idx;
+	GSList *l;
+
+	if (!analog->num_samples || !analog->meaning
+			|| !analog->meaning->channels || !analog->encoding)
+		return;
+
+	/* Channels are interleaved, each one goes to its own stream. */
+	num_channels = g_slist_length(analog->meaning->channels);
+	values = analog->num_samples * num_channels;
+	if (values > ds->floats_size) {
+		g_free(ds->floats);
+		ds->floats = g_malloc(values * sizeof(float));
+		ds->floats_size = values;
+	}
+	if (sr_analog_to_float(analog, ds->floats) != SR_OK) {
+		sr_err("Cannot convert analog data for storing.");
+		return;
+	}
+
+	for (l = analog->meaning->channels, idx = 0; l; l = l->next, idx++) {
+		channel = l->data;
+		stream = stream_get(store, ds, SR_DF_ANALOG, channel,
+			sizeof(float));
+		stream_append(store, ds, stream,
+			(const uint8_t *)&ds->floats[idx], analog->num_samples,
+			num_channels * sizeof(float));
+	}
+}
+
+/*
+ * Segments don't span samplerate changes, their samples' time follows
+ * from the first sample's time and the segment's samplerate.
+ */
+static void store_meta(struct session_store *store,
+		struct device_store *ds, const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	struct store_stream *stream;
+	const struct store_segment *segment;
+	uint64_t samplerate;
+	GSList *l, *ls;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		samplerate = g_variant_get_uint64(src->data);
+		for (ls = ds->streams; ls; ls = ls->next) {
+			stream = ls->data;
+			if (!stream->open)
+				continue;
+			segment = g_ptr_array_index(stream->segments,
+				stream->segments->len - 1);
+			if (segment->samplerate != samplerate)
+				stream_seal(store, stream);
+		}
+		ds->samplerate = samplerate;
+	}
+}
+
+/**
+ * Store a packet which got dispatched. Runs in the dispatching thread,
+ * after the transforms.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_store_feed(struct session_store *store,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct device_store *ds;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+	case SR_DF_META:
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RUNS:
+	case SR_DF_LOGIC_PLANAR:
+	case SR_DF_ANALOG:
+		break;
+	default:
+		return;
+	}
+
+	g_mutex_lock(&store->mutex);
+
+	ds = g_hash_table_lookup(store->devices, sdi);
+	if (!ds) {
+		ds = g_malloc0(sizeof(*ds));
+		ds->sdi = sdi;
+		g_hash_table_insert(store->devices, (void *)sdi, ds);
+	}
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		store->cached = NULL;
+		device_store_clear(ds);
+		break;
+	case SR_DF_META:
+		store_meta(store, ds, packet->payload);
+		break;
+	case SR_DF_LOGIC:
+		store_logic(store, ds, packet->payload);
+		break;
+	case SR_DF_LOGIC_RUNS:
+		store_logic_runs(store, ds, packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		store_logic_planar(store, ds, packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		store_analog(store, ds, packet->payload);
+		break;
+	}
+
+	g_mutex_unlock(&store->mutex);
+}
+
+/* Look up a device's stream, the mutex must be held. */
+static struct store_stream *stream_find(struct session_store *store,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel)
+{
+	struct device_store *ds;
+	struct store_stream *stream;
+	GSList *l;
+
+	ds = g_hash_table_lookup(store->devices, sdi);
+	if (!ds)
+		return NULL;
+
+	for (l = ds->streams; l; l = l->next) {
+		stream = l->data;
+		if (stream->channel == channel)
+			return stream;
+	}
+
+	return NULL;
+}
+
+/* Index of the segment which holds a sample, the mutex must be held. */
+static guint segment_find(const struct store_stream *stream, uint64_t sample)
+{
+	const struct store_segment *segment;
+	guint lo, hi, mid;
+
+	lo = 0;
+	hi = stream->segments->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		segment = g_ptr_array_index(stream->segments, mid);
+		if (segment->start <= sample)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* A segment's uncompressed sample data, the mutex must be held. */
+static const uint8_t *segment_data(struct session_store *store,
+		const struct store_stream *stream,
+		const struct store_segment *segment)
+{
+	lzo_uint len;
+
+	if (!segment->compressed)
+		return segment->data;
+
+	if (store->cached == segment)
+		return store->cache;
+
+	if (!store->cache)
+		store->cache = g_malloc(STORE_SEGMENT_SIZE);
+	len = segment->samples * stream->unitsize;
+	if (lzo1x_decompress_safe(segment->data, segment->size,
+			store->cache, &len, NULL) != LZO_E_OK) {
+		sr_err("Cannot decompress stored segment.");
+		store->cached = NULL;
+		return NULL;
+	}
+	store->cached = segment;
+
+	return store->cache;
+}
+
+/**
+ * Get the number of samples which the capture store holds for a stream.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param channel An analog channel of the device, or NULL for the
+ *                device's logic data.
+ * @param num_samples Receives the number of samples. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The capture store is not enabled, or holds no data
+ *                   for the stream.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_store_samples_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		uint64_t *num_samples)
+{
+	struct store_stream *stream;
+	int ret;
+
+	if (!session || !sdi || !num_samples)
+		return SR_ERR_ARG;
+
+	if (!session->store)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&session->store->mutex);
+	stream = stream_find(session->store, sdi, channel);
+	ret = SR_ERR_NA;
+	if (stream) {
+		*num_samples = stream->samples;
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->store->mutex);
+
+	return ret;
+}
+
+/*
+ * Pick the channels' bits from stored logic samples. The channels' bit
+ * positions are their indices.
+ */
+static void logic_extract(const uint8_t *in, size_t in_unitsize,
+		const unsigned int *bits, size_t num_bits, gboolean identity,
+		uint8_t *out, size_t out_unitsize, uint64_t count)
+{
+	uint64_t idx;
+	size_t bit;
+	uint8_t mask;
+
+	/* The first channels in their order: copy, and mask the rest. */
+	if (identity) {
+		mask = (num_bits % 8) ? (1 << (num_bits % 8)) - 1 : 0xff;
+		for (idx = 0; idx < count; idx++) {
+			memcpy(out, in, out_unitsize);
+			out[out_unitsize - 1] &= mask;
+			in += in_unitsize;
+			out += out_unitsize;
+		}
+		return;
+	}
+
+	memset(out, 0, count * out_unitsize);
+	for (idx = 0; idx < count; idx++) {
+		for (bit = 0; bit < num_bits; bit++) {
+			if (in[bits[bit] / 8] & (1 << (bits[bit] % 8)))
+				out[bit / 8] |= 1 << (bit % 8);
+		}
+		in += in_unitsize;
+		out += out_unitsize;
+	}
+}
+
+/* Copy a range of a stream's samples, the mutex must be held. */
+static int stream_read(struct session_store *store,
+		const struct store_stream *stream, uint64_t start, uint64_t end,
+		const unsigned int *bits, size_t num_bits, gboolean identity,
+		uint8_t *data, size_t out_unitsize, uint64_t *num_samples)
+{
+	const struct store_segment *segment;
+	const uint8_t *rdptr;
+	uint64_t offset, count;
+	guint idx;
+
+	*num_samples = 0;
+	end = MIN(end, stream->samples);
+	if (start >= end)
+		return SR_OK;
+
+	for (idx = segment_find(stream, start); start < end; idx++) {
+		segment = g_ptr_array_index(stream->segments, idx);
+		rdptr = segment_data(store, stream, segment);
+		if (!rdptr)
+			return SR_ERR;
+		offset = start - segment->start;
+		count = MIN(end, segment->start + segment->samples) - start;
+		rdptr += offset * stream->unitsize;
+		if (bits)
+			logic_extract(rdptr, stream->unitsize, bits, num_bits,
+				identity, data, out_unitsize, count);
+		else
+			memcpy(data, rdptr, count * stream->unitsize);
+		data += count * out_unitsize;
+		start += count;
+		*num_samples += count;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get a range of a device's logic samples from the capture store.
+ *
+ * The samples get returned for the given channels only. Each sample
+ * takes (number of channels + 7) / 8 bytes, bit n is the value of the
+ * n-th channel of the list.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param channels The logic channels of the device to return the values
+ *                 of. Must not be NULL.
+ * @param start The first sample.
+ * @param end The sample after the last one. Samples which are not
+ *            stored (yet) are not returned.
+ * @param data Receives the samples, must have room for end - start
+ *             samples. Must not be NULL.
+ * @param num_samples Receives the number of samples which were stored.
+ *                    Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The capture store is not enabled, or holds no logic
+ *                   data for the device.
+ * @retval SR_ERR Stored data could not be decompressed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_store_logic_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const GSList *channels,
+		uint64_t start, uint64_t end, uint8_t *data,
+		uint64_t *num_samples)
+{
+	const struct sr_channel *ch;
+	struct store_stream *stream;
+	const GSList *l;
+	unsigned int *bits;
+	size_t num_bits, idx;
+	gboolean identity;
+	int ret;
+
+	if (!session || !sdi || !channels || !data || !num_samples)
+		return SR_ERR_ARG;
+
+	num_bits = g_slist_length((GSList *)channels);
+	bits = g_malloc(num_bits * sizeof(*bits));
+	identity = TRUE;
+	for (l = channels, idx = 0; l; l = l->next, idx++) {
+		ch = l->data;
+		if (ch->sdi != sdi || ch->type != SR_CHANNEL_LOGIC) {
+			g_free(bits);
+			return SR_ERR_ARG;
+		}
+		bits[idx] = ch->index;
+		if (bits[idx] != idx)
+			identity = FALSE;
+	}
+
+	*num_samples = 0;
+	if (!session->store) {
+		g_free(bits);
+		return SR_ERR_NA;
+	}
+
+	g_mutex_lock(&session->store->mutex);
+	stream = stream_find(session->store, sdi, NULL);
+	ret = stream ? SR_OK : SR_ERR_NA;
+	for (idx = 0; stream && idx < num_bits; idx++) {
+		if (bits[idx] >= stream->unitsize * 8)
+			ret = SR_ERR_ARG;
+	}
+	if (ret == SR_OK)
+		ret = stream_read(session->store, stream, start, end,
+			bits, num_bits, identity, data, (num_bits + 7) / 8,
+			num_samples);
+	g_mutex_unlock(&session->store->mutex);
+
+	g_free(bits);
+
+	return ret;
+}
+
+/**
+ * Get a range of an analog channel's samples from the capture store.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param channel The analog channel. Must not be NULL.
+ * @param start The first sample.
+ * @param end The sample after the last one. Samples which are not
+ *            stored (yet) are not returned.
+ * @param data Receives the samples, must have room for end - start
+ *             values. Must not be NULL.
+ * @param num_samples Receives the number of samples which were stored.
+ *                    Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The capture store is not enabled, or holds no data
+ *                   for the channel.
+ * @retval SR_ERR Stored data could not be decompressed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_store_analog_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		uint64_t start, uint64_t end, float *data, uint64_t *num_samples)
+{
+	struct store_stream *stream;
+	int ret;
+
+	if (!session || !sdi || !channel || !data || !num_samples)
+		return SR_ERR_ARG;
+
+	*num_samples = 0;
+	if (!session->store)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&session->store->mutex);
+	stream = stream_find(session->store, sdi, channel);
+	ret = SR_ERR_NA;
+	if (stream)
+		ret = stream_read(session->store, stream, start, end,
+			NULL, 0, FALSE, (uint8_t *)data, sizeof(float),
+			num_samples);
+	g_mutex_unlock(&session->store->mutex);
+
+	return ret;
+}
+
+/* The sample of a segment at a session time, clipped to the segment. */
+static uint64_t segment_sample_at(const struct store_segment *segment,
+		int64_t time_ns)
+{
+	uint64_t offset;
+	int64_t span;
+
+	if (time_ns <= segment->time || segment->samples < 2)
+		return segment->start;
+
+	span = time_ns - segment->time;
+	if (segment->samplerate) {
+		offset = (uint64_t)span / SR_GHZ(1) * segment->samplerate
+			+ (uint64_t)span % SR_GHZ(1) * segment->samplerate
+			/ SR_GHZ(1);
+	} else if (segment->last_time > segment->time) {
+		/* Samples arrived in between, without a samplerate. */
+		offset = (uint64_t)((double)span * (segment->samples - 1)
+			/ (segment->last_time - segment->time));
+	} else {
+		offset = 0;
+	}
+
+	return segment->start + MIN(offset, segment->samples - 1);
+}
+
+/**
+ * Find the stored sample at a session time.
+ *
+ * The capture store keeps the session time of each segment's first
+ * sample, see sr_session_sample_time(). Sample times within a segment
+ * follow from the device's samplerate. For devices which don't have a
+ * samplerate, they get interpolated from the times when the segment's
+ * data arrived.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param channel An analog channel of the device, or NULL for the
+ *                device's logic data.
+ * @param time_ns The session time, in nanoseconds.
+ * @param sample Receives the number of the sample at that time, the
+ *               first or the last stored sample for times outside of
+ *               the stored data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The capture store is not enabled, or holds no data
+ *                   for the stream.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_store_sample_find(struct sr_session *session,
+		const struct sr_dev_inst *sdi, const struct sr_channel *channel,
+		int64_t time_ns, uint64_t *sample)
+{
+	struct store_stream *stream;
+	const struct store_segment *segment;
+	guint lo, hi, mid;
+	int ret;
+
+	if (!session || !sdi || !sample)
+		return SR_ERR_ARG;
+
+	if (!session->store)
+		return SR_ERR_NA;
+
+	g_mutex_lock(&session->store->mutex);
+	stream = stream_find(session->store, sdi, channel);
+	ret = SR_ERR_NA;
+	if (stream && stream->segments->len) {
+		/* The last segment which starts before the time. */
+		lo = 0;
+		hi = stream->segments->len;
+		while (hi - lo > 1) {
+			mid = lo + (hi - lo) / 2;
+			segment = g_ptr_array_index(stream->segments, mid);
+			if (segment->time <= time_ns)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		segment = g_ptr_array_index(stream->segments, lo);
+		*sample = segment_sample_at(segment, time_ns);
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->store->mutex);
+
+	return ret;
+}
+
+/** @} */
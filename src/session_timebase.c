@@ -0,0 +1,425 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-timebase"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Common time base of the devices in a session.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/**
+ * Time base of one device. Sample numbers map to session time relative
+ * to an anchor, which moves when the samplerate changes during the
+ * acquisition.
+ */
+struct device_timebase {
+	struct sr_timebase pub;
+	uint64_t anchor_sample;
+	int64_t anchor_time;
+	/* The analog channel which counts samples, without logic data. */
+	const struct sr_channel *analog_channel;
+	gboolean has_logic;
+};
+
+/**
+ * The session's time base. The mutex protects the devices' state, which
+ * senders update from device threads while consumers query it.
+ */
+struct session_timebase {
+	GMutex mutex;
+	int64_t origin;
+	GHashTable *devices;
+};
+
+/** @private */
+SR_PRIV struct session_timebase *sr_session_timebase_new(void)
+{
+	struct session_timebase *timebase;
+
+	timebase = g_malloc0(sizeof(*timebase));
+	g_mutex_init(&timebase->mutex);
+	timebase->devices = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	timebase->origin = g_get_monotonic_time();
+
+	return timebase;
+}
+
+/** @private */
+SR_PRIV void sr_session_timebase_free(struct session_timebase *timebase)
+{
+	if (!timebase)
+		return;
+
+	g_hash_table_unref(timebase->devices);
+	g_mutex_clear(&timebase->mutex);
+	g_free(timebase);
+}
+
+/**
+ * Forget all devices, and let session time start over at zero. Gets
+ * called when the session starts.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_timebase_reset(struct session_timebase *timebase)
+{
+	g_mutex_lock(&timebase->mutex);
+	g_hash_table_remove_all(timebase->devices);
+	timebase->origin = g_get_monotonic_time();
+	g_mutex_unlock(&timebase->mutex);
+}
+
+/* Duration of a number of samples in nanoseconds, without overflowing. */
+static int64_t samples_to_ns(uint64_t samples, uint64_t samplerate)
+{
+	return samples / samplerate * SR_GHZ(1)
+		+ samples % samplerate * SR_GHZ(1) / samplerate;
+}
+
+/* Session time of a sample, the mutex must be held. */
+static int64_t device_sample_time(const struct device_timebase *dt,
+		uint64_t sample)
+{
+	uint64_t rate;
+
+	rate = dt->pub.samplerate;
+	if (sample >= dt->anchor_sample)
+		return dt->anchor_time
+			+ samples_to_ns(sample - dt->anchor_sample, rate);
+
+	return dt->anchor_time - samples_to_ns(dt->anchor_sample - sample, rate);
+}
+
+/* Start over with a device's SR_DF_HEADER, the mutex must be held. */
+static void device_start(struct device_timebase *dt,
+		const struct sr_datafeed_header *header, int64_t now)
+{
+	uint64_t samplerate;
+
+	samplerate = dt->pub.samplerate;
+	memset(dt, 0, sizeof(*dt));
+	dt->pub.start = now;
+	dt->pub.samplerate = samplerate;
+	if (header)
+		dt->pub.starttime = header->starttime;
+	dt->anchor_time = now;
+}
+
+static void device_samplerate_set(struct device_timebase *dt,
+		uint64_t samplerate)
+{
+	if (samplerate == dt->pub.samplerate)
+		return;
+
+	/* Samples before the change keep their time. */
+	if (dt->pub.samplerate && dt->pub.samples) {
+		dt->anchor_time = device_sample_time(dt, dt->pub.samples);
+		dt->anchor_sample = dt->pub.samples;
+	}
+	dt->pub.samplerate = samplerate;
+}
+
+/* Count the samples of an analog packet, the mutex must be held. */
+static uint64_t analog_samples(struct device_timebase *dt,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_channel *ch;
+
+	if (dt->has_logic || !analog->meaning || !analog->meaning->channels)
+		return 0;
+
+	/* Each analog channel sends its own packets, count one of them. */
+	ch = analog->meaning->channels->data;
+	if (!dt->analog_channel)
+		dt->analog_channel = ch;
+
+	return ch == dt->analog_channel ? analog->num_samples : 0;
+}
+
+/**
+ * Account a packet which a device has sent. Runs in the sending thread,
+ * before the packet gets queued for dispatch, so that the recorded
+ * times are not subject to dispatch latency.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_timebase_feed(struct session_timebase *timebase,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_runs *runs;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	struct device_timebase *dt;
+	uint64_t samples, run;
+	int64_t now;
+	GSList *l;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+	case SR_DF_META:
+	case SR_DF_TRIGGER:
+	case SR_DF_LOGIC:
+	case SR_DF_ANALOG:
+	case SR_DF_LOGIC_RUNS:
+	case SR_DF_LOGIC_PLANAR:
+		break;
+	default:
+		return;
+	}
+
+	g_mutex_lock(&timebase->mutex);
+	now = (g_get_monotonic_time() - timebase->origin) * 1000;
+	dt = g_hash_table_lookup(timebase->devices, sdi);
+	if (G_UNLIKELY(!dt)) {
+		dt = g_malloc0(sizeof(*dt));
+		device_start(dt, NULL, now);
+		g_hash_table_insert(timebase->devices, (void *)sdi, dt);
+	}
+
+	samples = 0;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		device_start(dt, packet->payload, now);
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				device_samplerate_set(dt,
+					g_variant_get_uint64(src->data));
+		}
+		break;
+	case SR_DF_TRIGGER:
+		if (dt->pub.triggered)
+			break;
+		dt->pub.triggered = TRUE;
+		dt->pub.trigger_sample = dt->pub.samples;
+		if (dt->pub.samplerate)
+			dt->pub.trigger_time = device_sample_time(dt,
+				dt->pub.samples);
+		else
+			dt->pub.trigger_time = now;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		dt->has_logic = TRUE;
+		if (logic->unitsize)
+			samples = logic->length / logic->unitsize;
+		break;
+	case SR_DF_ANALOG:
+		samples = analog_samples(dt, packet->payload);
+		break;
+	case SR_DF_LOGIC_RUNS:
+		runs = packet->payload;
+		dt->has_logic = TRUE;
+		for (run = 0; run < runs->num_runs; run++)
+			samples += runs->lengths[run];
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		dt->has_logic = TRUE;
+		samples = planar->num_blocks * 32;
+		break;
+	}
+	dt->pub.samples += samples;
+	g_mutex_unlock(&timebase->mutex);
+}
+
+/**
+ * Session time of a device's sample, as far as the datafeed told. Unlike
+ * sr_session_sample_time() this doesn't ask the device, and is fine to
+ * use while sending.
+ *
+ * @param timebase The session's time base.
+ * @param sdi The device, or NULL for the current session time.
+ * @param sample The sample number.
+ * @param samplerate Receives the device's samplerate, 0 when it is not
+ *                   known. Can be NULL.
+ *
+ * @return The sample's session time in nanoseconds, the current session
+ *         time when the device or its samplerate is not known.
+ *
+ * @private
+ */
+SR_PRIV int64_t sr_session_timebase_sample_time(
+		struct session_timebase *timebase,
+		const struct sr_dev_inst *sdi, uint64_t sample,
+		uint64_t *samplerate)
+{
+	struct device_timebase *dt;
+	int64_t time;
+
+	g_mutex_lock(&timebase->mutex);
+	time = (g_get_monotonic_time() - timebase->origin) * 1000;
+	dt = sdi ? g_hash_table_lookup(timebase->devices, sdi) : NULL;
+	if (dt && dt->pub.samplerate)
+		time = device_sample_time(dt, sample);
+	if (samplerate)
+		*samplerate = dt ? dt->pub.samplerate : 0;
+	g_mutex_unlock(&timebase->mutex);
+
+	return time;
+}
+
+/*
+ * Devices which don't announce their samplerate in the datafeed get
+ * asked for it. Not done while sending, drivers may hold locks there.
+ */
+static void samplerate_probe(struct session_timebase *timebase,
+		const struct sr_dev_inst *sdi)
+{
+	struct device_timebase *dt;
+	GVariant *gvar;
+	uint64_t samplerate;
+	gboolean known;
+
+	g_mutex_lock(&timebase->mutex);
+	dt = g_hash_table_lookup(timebase->devices, sdi);
+	known = !dt || dt->pub.samplerate;
+	g_mutex_unlock(&timebase->mutex);
+	if (known || !sdi->driver)
+		return;
+
+	if (sr_config_get(sdi->driver, sdi, NULL,
+			SR_CONF_SAMPLERATE, &gvar) != SR_OK)
+		return;
+	samplerate = g_variant_get_uint64(gvar);
+	g_variant_unref(gvar);
+	if (!samplerate)
+		return;
+
+	g_mutex_lock(&timebase->mutex);
+	dt = g_hash_table_lookup(timebase->devices, sdi);
+	if (dt && !dt->pub.samplerate) {
+		dt->pub.samplerate = samplerate;
+		if (dt->pub.triggered)
+			dt->pub.trigger_time = device_sample_time(dt,
+				dt->pub.trigger_sample);
+	}
+	g_mutex_unlock(&timebase->mutex);
+}
+
+/**
+ * Get the time base of a device in a session.
+ *
+ * All devices of a session share the session time, which starts at
+ * zero when the session starts. The device's acquisition start is the
+ * time when it sent its SR_DF_HEADER packet. Its first SR_DF_TRIGGER
+ * gets located at the sample which it was sent after, the hardware's
+ * trigger position. Timestamps get taken as the device sends the
+ * packets, asynchronous dispatch does not delay them.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param timebase Receives the time base. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device has not sent any packets since the
+ *                   session was started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_timebase_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_timebase *timebase)
+{
+	struct device_timebase *dt;
+	int ret;
+
+	if (!session || !sdi || !timebase)
+		return SR_ERR_ARG;
+
+	samplerate_probe(session->timebase, sdi);
+
+	g_mutex_lock(&session->timebase->mutex);
+	dt = g_hash_table_lookup(session->timebase->devices, sdi);
+	ret = SR_ERR_NA;
+	if (dt) {
+		*timebase = dt->pub;
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->timebase->mutex);
+
+	return ret;
+}
+
+/**
+ * Map a device's sample number to session time.
+ *
+ * Samples are numbered from the device's most recent SR_DF_HEADER.
+ * Samplerate changes which the device announces by SR_DF_META packets
+ * are accounted for, provided the sample was sent before the change.
+ * Devices of the same session can get aligned by their samples' session
+ * times, also when their samplerates differ.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param sample The sample number.
+ * @param time_ns Receives the sample's session time, in nanoseconds.
+ *                Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device has not started yet, or its samplerate
+ *                   is unknown.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_sample_time(struct sr_session *session,
+		const struct sr_dev_inst *sdi, uint64_t sample, int64_t *time_ns)
+{
+	struct device_timebase *dt;
+	int ret;
+
+	if (!session || !sdi || !time_ns)
+		return SR_ERR_ARG;
+
+	samplerate_probe(session->timebase, sdi);
+
+	g_mutex_lock(&session->timebase->mutex);
+	dt = g_hash_table_lookup(session->timebase->devices, sdi);
+	ret = SR_ERR_NA;
+	if (dt && dt->pub.samplerate) {
+		*time_ns = device_sample_time(dt, sample);
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->timebase->mutex);
+
+	return ret;
+}
+
+/** @} */
@@ -41,6 +41,201 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/*
+ * A trigger stage, compiled to bit masks of the sample's 64-bit words.
+ * Channel N maps to bit (N % 64) of word (N / 64). A sample matches
+ * when (sample & level_mask) == level_value, and the edge conditions
+ * hold for the bits which changed since the previous sample.
+ */
+struct soft_trigger_stage {
+	uint64_t *level_mask;
+	uint64_t *level_value;
+	uint64_t *rising;
+	uint64_t *falling;
+	uint64_t *edge;
+	gboolean has_edges;
+	/* No matches were specified (client error). */
+	gboolean empty;
+	/* Contradicting or unsupported matches, the stage never matches. */
+	gboolean never;
+	/* Required occurrences, and distance from the previous stage. */
+	uint64_t count;
+	uint64_t within;
+	/* Occurrences since the previous stage's most recent match. */
+	uint64_t occurrences;
+	uint64_t last_occurrence;
+	uint64_t base;
+	/* Position of the stage's most recent match. */
+	gboolean done;
+	uint64_t done_pos;
+};
+
+#define STAGE_MASKS	5
+
+static int stages_compile(struct soft_trigger_logic *stl)
+{
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	struct soft_trigger_stage *st;
+	uint64_t *masks, bit;
+	GSList *l, *m;
+	int idx, index, words, word;
+
+	words = stl->num_words;
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	if (!stl->num_stages)
+		return SR_ERR_ARG;
+	stl->stages = g_malloc0(stl->num_stages * sizeof(stl->stages[0]));
+	stl->masks = g_malloc0(stl->num_stages * STAGE_MASKS * words
+		* sizeof(stl->masks[0]));
+
+	for (l = stl->trigger->stages, idx = 0; l; l = l->next, idx++) {
+		stage = l->data;
+		st = &stl->stages[idx];
+		masks = &stl->masks[idx * STAGE_MASKS * words];
+		st->level_mask = &masks[0 * words];
+		st->level_value = &masks[1 * words];
+		st->rising = &masks[2 * words];
+		st->falling = &masks[3 * words];
+		st->edge = &masks[4 * words];
+		st->empty = !stage->matches;
+		st->count = MAX(stage->count, 1);
+		st->within = stage->within;
+
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel->enabled)
+				/* Ignore disabled channels with a trigger. */
+				continue;
+			index = match->channel->index;
+			if (index >= stl->unitsize * 8) {
+				sr_warn("Ignoring trigger on channel %d beyond "
+					"the sample width.", index);
+				continue;
+			}
+			word = index / 64;
+			bit = UINT64_C(1) << (index % 64);
+			switch (match->match) {
+			case SR_TRIGGER_ZERO:
+				if (st->level_value[word] & bit)
+					st->never = TRUE;
+				st->level_mask[word] |= bit;
+				break;
+			case SR_TRIGGER_ONE:
+				if ((st->level_mask[word] & bit)
+						&& !(st->level_value[word] & bit))
+					st->never = TRUE;
+				st->level_mask[word] |= bit;
+				st->level_value[word] |= bit;
+				break;
+			case SR_TRIGGER_RISING:
+				st->rising[word] |= bit;
+				st->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_FALLING:
+				st->falling[word] |= bit;
+				st->has_edges = TRUE;
+				break;
+			case SR_TRIGGER_EDGE:
+				st->edge[word] |= bit;
+				st->has_edges = TRUE;
+				break;
+			default:
+				/* Analog conditions never match logic data. */
+				st->never = TRUE;
+				break;
+			}
+		}
+	}
+
+	return SR_OK;
+}
+
+/* Load a sample into 64-bit words, least significant channels first. */
+static inline void sample_load(const struct soft_trigger_logic *stl,
+		const uint8_t *sample, uint64_t *words)
+{
+	int w, b, n;
+
+	switch (stl->unitsize) {
+	case 1:
+		words[0] = R8(sample);
+		return;
+	case 2:
+		words[0] = RL16(sample);
+		return;
+	case 4:
+		words[0] = RL32(sample);
+		return;
+	case 8:
+		words[0] = RL64(sample);
+		return;
+	}
+	for (w = 0; w < stl->num_words; w++) {
+		words[w] = 0;
+		n = MIN(8, stl->unitsize - 8 * w);
+		for (b = 0; b < n; b++)
+			words[w] |= (uint64_t)sample[8 * w + b] << (8 * b);
+	}
+}
+
+/* Check a sample against a stage. Edges need the previous sample. */
+static inline gboolean stage_match(const struct soft_trigger_stage *st,
+		const uint64_t *cur, const uint64_t *prev, int words)
+{
+	uint64_t changed;
+	int w;
+
+	if (st->never)
+		return FALSE;
+	for (w = 0; w < words; w++) {
+		if ((cur[w] & st->level_mask[w]) != st->level_value[w])
+			return FALSE;
+	}
+	if (!st->has_edges)
+		return TRUE;
+	/* First sample, don't have enough for an edge match yet. */
+	if (!prev)
+		return FALSE;
+	for (w = 0; w < words; w++) {
+		changed = prev[w] ^ cur[w];
+		if ((changed & st->edge[w]) != st->edge[w])
+			return FALSE;
+		if ((changed & cur[w] & st->rising[w]) != st->rising[w])
+			return FALSE;
+		if ((changed & prev[w] & st->falling[w]) != st->falling[w])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Get memory for pre-trigger data, preferably from the session's pool. */
+static struct sr_buffer *pre_trigger_buffer_new(struct soft_trigger_logic *stl,
+		size_t size)
+{
+	void *data;
+
+	if (stl->sdi->session)
+		return sr_session_buffer_get(stl->sdi->session, size);
+
+	data = g_try_malloc(size);
+
+	return data ? sr_buffer_new(data, size, NULL, NULL) : NULL;
+}
+
+static int pre_trigger_ring_get(struct soft_trigger_logic *stl)
+{
+	stl->pre_trigger_buf = pre_trigger_buffer_new(stl, stl->pre_trigger_size);
+	if (!stl->pre_trigger_buf)
+		return SR_ERR_MALLOC;
+	stl->pre_trigger_buffer = sr_buffer_data_get(stl->pre_trigger_buf, NULL);
+	stl->pre_trigger_head = stl->pre_trigger_buffer;
+	stl->pre_trigger_fill = 0;
+
+	return SR_OK;
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -52,20 +247,14 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
 	stl->prev_sample = g_malloc0(stl->unitsize);
-	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
-	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
-	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
-		/*
-		 * Error out if g_try_malloc() failed (or was invoked as
-		 * g_try_malloc(0)) *and* more than 0 pretrigger samples
-		 * were requested.
-		 */
+	stl->num_words = MAX((stl->unitsize + 7) / 8, 1);
+	stl->words = g_malloc0(2 * stl->num_words * sizeof(stl->words[0]));
+	if (stages_compile(stl) != SR_OK) {
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
-	stl->pre_trigger_head = stl->pre_trigger_buffer;
-
-	if (stl->pre_trigger_size > 0 && !stl->pre_trigger_buffer) {
+	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
+	if (stl->pre_trigger_size > 0 && pre_trigger_ring_get(stl) != SR_OK) {
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
@@ -75,7 +264,11 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
-	g_free(stl->pre_trigger_buffer);
+	g_free(stl->stages);
+	g_free(stl->masks);
+	g_free(stl->words);
+	if (stl->pre_trigger_buf)
+		sr_buffer_unref(stl->pre_trigger_buf);
 	g_free(stl->prev_sample);
 	g_free(stl);
 }
@@ -83,10 +276,19 @@ SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 static void pre_trigger_append(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len)
 {
+	if (len <= 0 || !stl->pre_trigger_size)
+		return;
+
+	/* The ring's memory may have been passed on, use a fresh one. */
+	if (!stl->pre_trigger_buf && pre_trigger_ring_get(stl) != SR_OK)
+		return;
+
 	/* Avoid uselessly copying more than the pre-trigger size. */
-	if (len > stl->pre_trigger_size) {
+	if (len >= stl->pre_trigger_size) {
 		buf += len - stl->pre_trigger_size;
 		len = stl->pre_trigger_size;
+		/* Start over, keeps the ring content contiguous. */
+		stl->pre_trigger_head = stl->pre_trigger_buffer;
 	}
 
 	/* Update the filling level of the pre-trigger circular buffer. */
@@ -107,137 +309,723 @@ static void pre_trigger_append(struct soft_trigger_logic *stl,
 	}
 }
 
+/*
+ * Send the pre-trigger circular buffer content as a single packet. When
+ * the content is contiguous, the ring's memory itself gets passed on
+ * (consumers can keep references without copying), and a fresh ring
+ * gets used afterwards. Wrapped content gets linearized first.
+ */
 static void pre_trigger_send(struct soft_trigger_logic *stl,
 		int *pre_trigger_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_buffer *buf;
+	uint8_t *start, *end, *data;
+	size_t fill, first;
+
+	if (pre_trigger_samples)
+		*pre_trigger_samples = 0;
+
+	fill = stl->pre_trigger_fill;
+	if (!fill || !stl->pre_trigger_buf)
+		return;
+
+	/* If pre-trigger buffer not full, the first valid sample is at its start. */
+	start = stl->pre_trigger_buffer;
+	if (fill == (size_t)stl->pre_trigger_size)
+		start = stl->pre_trigger_head;
+	end = stl->pre_trigger_buffer + stl->pre_trigger_size;
+	first = MIN((size_t)(end - start), fill);
+
+	if (first == fill) {
+		buf = stl->pre_trigger_buf;
+		stl->pre_trigger_buf = NULL;
+		stl->pre_trigger_buffer = NULL;
+		data = start;
+	} else {
+		buf = pre_trigger_buffer_new(stl, fill);
+		if (!buf) {
+			sr_err("Cannot allocate pre-trigger packet.");
+			stl->pre_trigger_fill = 0;
+			return;
+		}
+		data = sr_buffer_data_get(buf, NULL);
+		memcpy(data, start, first);
+		memcpy(data + first, stl->pre_trigger_buffer, fill - first);
+	}
 
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = stl->unitsize;
+	logic.length = fill;
+	logic.data = data;
+	sr_session_send_buffer(stl->sdi, &packet, buf);
+	sr_buffer_unref(buf);
 
+	stl->pre_trigger_head = stl->pre_trigger_buffer;
+	stl->pre_trigger_fill = 0;
 	if (pre_trigger_samples)
-		*pre_trigger_samples = 0;
+		*pre_trigger_samples = fill / stl->unitsize;
+}
 
-	/* If pre-trigger buffer not full, rewind head to the first valid sample. */
-	if (stl->pre_trigger_fill < stl->pre_trigger_size)
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
+/*
+ * Update a stage with the sample at pos, given whether the sample
+ * matches the stage's conditions. Returns whether the stage completed.
+ * Stages get updated from the last to the first, so a stage sees its
+ * predecessor's matches from the following sample on.
+ */
+static inline gboolean stage_update(struct soft_trigger_stage *st,
+		const struct soft_trigger_stage *pred, gboolean match, uint64_t pos)
+{
+	uint64_t start;
 
-	/* Send logic packets for the pre-trigger circular buffer content. */
-	while (stl->pre_trigger_fill > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, stl->pre_trigger_fill);
-		logic.length = size;
-		logic.data = stl->pre_trigger_head;
-		sr_session_send(stl->sdi, &packet);
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-		stl->pre_trigger_fill -= size;
-		if (pre_trigger_samples)
-			*pre_trigger_samples += size / stl->unitsize;
-	}
-}
-
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
-{
-	int bit, prev_bit;
-	gboolean result;
-
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	if (pred) {
+		if (!pred->done)
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
+		/* The previous stage matched again, count from there. */
+		if (pred->done_pos != st->base) {
+			st->base = pred->done_pos;
+			st->occurrences = 0;
+		}
 	}
 
-	return result;
+	if (!match) {
+		if (!st->within)
+			st->occurrences = 0;
+		return FALSE;
+	}
+
+	if (!st->within) {
+		/* Consecutive samples, following the previous stage. */
+		if (st->occurrences)
+			start = st->last_occurrence;
+		else if (pred)
+			start = pred->done_pos;
+		else
+			start = pos - 1;
+		if (pos != start + 1) {
+			st->occurrences = 0;
+			if (pred)
+				return FALSE;
+		}
+	} else if (pred && pos - pred->done_pos > st->within) {
+		st->occurrences = 0;
+		return FALSE;
+	}
+
+	st->last_occurrence = pos;
+	if (++st->occurrences < st->count)
+		return FALSE;
+
+	/* Further occurrences complete the stage again. */
+	st->occurrences = st->count - 1;
+	st->done = TRUE;
+	st->done_pos = pos;
+
+	return TRUE;
+}
+
+/* Start over, forget about partial matches of the stages. */
+SR_PRIV void soft_trigger_logic_reset(struct soft_trigger_logic *stl)
+{
+	struct soft_trigger_stage *st;
+	int i;
+
+	for (i = 0; i < stl->num_stages; i++) {
+		st = &stl->stages[i];
+		st->occurrences = 0;
+		st->done = FALSE;
+	}
 }
 
-/* Returns the offset (in samples) within buf of where the trigger
- * occurred, or -1 if not triggered. */
+/*
+ * Returns the offset (in samples) within buf of where the trigger
+ * occurred, or -1 if not triggered.
+ *
+ * All stages get evaluated for every sample, each stage tracks the most
+ * recent position where it completed since the previous stage did. This
+ * finds the earliest trigger position in a single pass, without going
+ * back to earlier samples on mismatches.
+ */
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
-	int offset;
-	int i;
-	gboolean match_found;
+	struct soft_trigger_stage *st, *pred;
+	uint64_t *cur, *prev, *tmp;
+	int unitsize, words, num_samples, offset, i, k;
+	gboolean match;
 
-	offset = -1;
-	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+	unitsize = stl->unitsize;
+	words = stl->num_words;
+	num_samples = len / unitsize;
+	cur = stl->words;
+	prev = stl->words + words;
+	if (stl->have_prev)
+		sample_load(stl, stl->prev_sample, prev);
+
+	for (k = 0; k < stl->num_stages; k++) {
+		if (stl->stages[k].empty)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
+	}
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
+	offset = -1;
+	for (i = 0; i < num_samples; i++, stl->pos++) {
+		sample_load(stl, buf + i * unitsize, cur);
+		for (k = stl->num_stages - 1; k >= 0; k--) {
+			st = &stl->stages[k];
+			pred = k ? &stl->stages[k - 1] : NULL;
+			if (pred && !pred->done)
 				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
-			}
+			match = stage_match(st, cur,
+				stl->have_prev ? prev : NULL, words);
+			if (stage_update(st, pred, match, stl->pos)
+					&& k == stl->num_stages - 1)
+				offset = i;
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
-		if (match_found) {
-			/* Matched on the current stage. */
-			if (l_stage->next) {
-				/* Advance to next stage. */
-				stl->cur_stage++;
-			} else {
-				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
-
-				/* Fire trigger. */
-				offset = i / stl->unitsize;
-
-				std_session_send_df_trigger(stl->sdi);
-				break;
-			}
-		} else if (stl->cur_stage > 0) {
-			/*
-			 * We had a match at an earlier stage, but failed on the
-			 * current stage. However, we may have a match on this
-			 * stage in the next bit -- trigger on 0001 will fail on
-			 * seeing 00001, so we need to go back to stage 0 -- but
-			 * at the next sample from the one that matched originally,
-			 * which the counter increment at the end of the loop
-			 * takes care of.
-			 */
-			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
-			/* Reset trigger stage. */
-			stl->cur_stage = 0;
-		}
-	}
-
-	if (offset == -1)
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+		stl->have_prev = TRUE;
+		if (offset >= 0)
+			break;
+	}
+
+	if (offset >= 0) {
+		/* Matched on last stage, send pre-trigger data. */
+		memcpy(stl->prev_sample, buf + offset * unitsize, unitsize);
+		stl->pos++;
+		soft_trigger_logic_reset(stl);
+		if (stl->post_trigger_samples)
+			std_session_send_df_frame_begin(stl->sdi);
+		pre_trigger_append(stl, buf, offset * unitsize);
+		pre_trigger_send(stl, pre_trigger_samples);
+
+		/* Fire trigger. */
+		std_session_send_df_trigger(stl->sdi);
+	} else {
+		if (num_samples > 0)
+			memcpy(stl->prev_sample,
+				buf + (num_samples - 1) * unitsize, unitsize);
 		pre_trigger_append(stl, buf, len);
+	}
 
 	return offset;
 }
+
+/*
+ * Enable segmented acquisition: after the trigger fired, the soft trigger
+ * passes post_trigger_samples samples (including the one which fired),
+ * then re-arms. Every segment is sent between SR_DF_FRAME_BEGIN and
+ * SR_DF_FRAME_END, with its own pre-trigger window. The data must then
+ * be passed in using soft_trigger_logic_segments_feed().
+ */
+SR_PRIV void soft_trigger_logic_segments_set(struct soft_trigger_logic *stl,
+		uint64_t post_trigger_samples)
+{
+	stl->post_trigger_samples = post_trigger_samples;
+}
+
+/* End the current segment, and re-arm the trigger. */
+SR_PRIV void soft_trigger_logic_segment_close(struct soft_trigger_logic *stl)
+{
+	if (!stl->segment_open)
+		return;
+
+	std_session_send_df_frame_end(stl->sdi);
+	stl->segment_open = FALSE;
+	stl->post_trigger_left = 0;
+	stl->segments++;
+}
+
+/*
+ * Pass logic data through the soft trigger in segmented mode. Sends
+ * the segments' pre-trigger data, the trigger markers, the post-trigger
+ * data and the frame delimiters. Data outside of segments is only kept
+ * for the next pre-trigger window. The number of completed segments is
+ * available in stl->segments.
+ */
+SR_PRIV int soft_trigger_logic_segments_feed(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t count;
+	int offset, unitsize;
+
+	unitsize = stl->unitsize;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = unitsize;
+
+	while (len >= unitsize) {
+		if (!stl->segment_open) {
+			offset = soft_trigger_logic_check(stl, buf, len, NULL);
+			if (offset == -1)
+				return SR_OK;
+			if (offset < 0)
+				return offset;
+			stl->segment_open = TRUE;
+			stl->post_trigger_left = MAX(stl->post_trigger_samples, 1);
+			buf += offset * unitsize;
+			len -= offset * unitsize;
+			/* The check consumed the trigger sample. */
+			stl->pos--;
+		}
+
+		count = MIN((uint64_t)(len / unitsize), stl->post_trigger_left);
+		logic.length = count * unitsize;
+		logic.data = buf;
+		sr_session_send(stl->sdi, &packet);
+		memcpy(stl->prev_sample, buf + (count - 1) * unitsize, unitsize);
+		stl->have_prev = TRUE;
+		stl->pos += count;
+		buf += count * unitsize;
+		len -= count * unitsize;
+		stl->post_trigger_left -= count;
+		if (!stl->post_trigger_left)
+			soft_trigger_logic_segment_close(stl);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Soft trigger for analog channels. Evaluates level, window and edge
+ * conditions (with hysteresis) on the analog packets' sample data in
+ * their native encoding, keeps a bounded pre-trigger window of packets,
+ * and only forwards data from the trigger position onwards.
+ */
+
+/* State of an analog trigger match. */
+struct analog_match {
+	const struct sr_trigger_match *match;
+	int stage;
+	/* Edge matches which crossed while their stage is current. */
+	gboolean latched;
+	/* Result of level and window matches at the most recent sample. */
+	gboolean level;
+	gboolean armed_rising;
+	gboolean armed_falling;
+};
+
+/* Packet in the pre-trigger window, and the range of samples to send. */
+struct analog_pre_item {
+	struct sr_datafeed_packet *packet;
+	const struct sr_channel *channel;
+	uint64_t skip;
+	uint64_t count;
+};
+
+struct soft_trigger_analog {
+	const struct sr_dev_inst *sdi;
+	struct analog_match *matches;
+	int num_matches;
+	int num_stages;
+	int cur_stage;
+	gboolean fired;
+	uint64_t pre_trigger_samples;
+	/* Pre-trigger packets of all channels, in their original order. */
+	GQueue pre_trigger;
+};
+
+SR_PRIV gboolean soft_trigger_is_analog(const struct sr_trigger *trigger)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	GSList *l, *m;
+
+	if (!trigger || !trigger->stages)
+		return FALSE;
+
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (match->channel->type != SR_CHANNEL_ANALOG)
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		uint64_t pre_trigger_samples)
+{
+	struct soft_trigger_analog *sta;
+	struct sr_trigger_stage *stage;
+	struct analog_match *am;
+	GSList *l, *m;
+	int idx;
+
+	if (!soft_trigger_is_analog(trigger))
+		return NULL;
+
+	sta = g_malloc0(sizeof(*sta));
+	sta->sdi = sdi;
+	sta->pre_trigger_samples = pre_trigger_samples;
+	g_queue_init(&sta->pre_trigger);
+
+	sta->num_stages = g_slist_length(trigger->stages);
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		if (!stage->matches) {
+			soft_trigger_analog_free(sta);
+			return NULL;
+		}
+		sta->num_matches += g_slist_length(stage->matches);
+	}
+	sta->matches = g_malloc0(sta->num_matches * sizeof(sta->matches[0]));
+	idx = 0;
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		for (m = stage->matches; m; m = m->next) {
+			am = &sta->matches[idx++];
+			am->match = m->data;
+			am->stage = stage->stage;
+		}
+	}
+
+	return sta;
+}
+
+static void analog_pre_item_free(struct analog_pre_item *item)
+{
+	sr_packet_unref(item->packet);
+	g_free(item);
+}
+
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta)
+{
+	struct analog_pre_item *item;
+
+	if (!sta)
+		return;
+
+	while ((item = g_queue_pop_head(&sta->pre_trigger)))
+		analog_pre_item_free(item);
+	g_free(sta->matches);
+	g_free(sta);
+}
+
+SR_PRIV gboolean soft_trigger_analog_fired(const struct soft_trigger_analog *sta)
+{
+	return sta->fired;
+}
+
+/* Read a sample value in the packet's native encoding. */
+static inline double analog_value(const struct sr_analog_encoding *enc,
+		const uint8_t *p, double scale, double offset)
+{
+	double raw;
+	uint32_t u24;
+
+	if (enc->is_float) {
+		if (enc->unitsize == sizeof(double))
+			raw = enc->is_bigendian ? read_dblbe(p) : RLDB(p);
+		else
+			raw = enc->is_bigendian ? RBFL(p) : RLFL(p);
+	} else if (enc->is_signed) {
+		switch (enc->unitsize) {
+		case 1: raw = read_i8(p); break;
+		case 2: raw = enc->is_bigendian ? RB16S(p) : RL16S(p); break;
+		case 3:
+			u24 = enc->is_bigendian ? read_u24be(p) : read_u24le(p);
+			raw = (int32_t)(u24 ^ 0x800000) - 0x800000;
+			break;
+		case 4: raw = enc->is_bigendian ? RB32S(p) : RL32S(p); break;
+		default: raw = enc->is_bigendian ? RB64S(p) : RL64S(p); break;
+		}
+	} else {
+		switch (enc->unitsize) {
+		case 1: raw = R8(p); break;
+		case 2: raw = enc->is_bigendian ? RB16(p) : RL16(p); break;
+		case 3: raw = enc->is_bigendian ? read_u24be(p) : read_u24le(p); break;
+		case 4: raw = enc->is_bigendian ? RB32(p) : RL32(p); break;
+		default: raw = enc->is_bigendian ? RB64(p) : RL64(p); break;
+		}
+	}
+
+	return raw * scale + offset;
+}
+
+static gboolean analog_encoding_supported(const struct sr_analog_encoding *enc)
+{
+	if (enc->is_float)
+		return enc->unitsize == sizeof(float) || enc->unitsize == sizeof(double);
+
+	return (enc->unitsize >= 1 && enc->unitsize <= 4)
+		|| enc->unitsize == 8;
+}
+
+/*
+ * Update a match with a new sample value. Returns whether the match
+ * holds at this sample: level and window matches hold while the value
+ * is in range, edge matches hold at the sample which crossed the level.
+ */
+static gboolean analog_match_update(struct analog_match *am, double v)
+{
+	const struct sr_trigger_match *match;
+	gboolean crossed;
+
+	match = am->match;
+	switch (match->match) {
+	case SR_TRIGGER_OVER:
+		am->level = v > match->value;
+		return am->level;
+	case SR_TRIGGER_UNDER:
+		am->level = v < match->value;
+		return am->level;
+	case SR_TRIGGER_INSIDE:
+		am->level = v >= match->value && v <= match->value_high;
+		return am->level;
+	case SR_TRIGGER_OUTSIDE:
+		am->level = v < match->value || v > match->value_high;
+		return am->level;
+	}
+
+	crossed = FALSE;
+	if (match->match == SR_TRIGGER_RISING || match->match == SR_TRIGGER_EDGE) {
+		if (am->armed_rising && v >= match->value) {
+			am->armed_rising = FALSE;
+			crossed = TRUE;
+		} else if (v < match->value - match->hysteresis) {
+			am->armed_rising = TRUE;
+		}
+	}
+	if (match->match == SR_TRIGGER_FALLING || match->match == SR_TRIGGER_EDGE) {
+		if (am->armed_falling && v <= match->value) {
+			am->armed_falling = FALSE;
+			crossed = TRUE;
+		} else if (v > match->value + match->hysteresis) {
+			am->armed_falling = TRUE;
+		}
+	}
+	return crossed;
+}
+
+static gboolean analog_match_is_edge(const struct analog_match *am)
+{
+	return am->match->match == SR_TRIGGER_RISING
+		|| am->match->match == SR_TRIGGER_FALLING
+		|| am->match->match == SR_TRIGGER_EDGE;
+}
+
+/*
+ * Check a packet for the trigger condition. Returns the offset (in
+ * samples) of the trigger position, or -1 if not triggered. Matches on
+ * channels which are not part of the packet contribute their state from
+ * their most recent packet: level matches whether they held at its last
+ * sample, edge matches whether they crossed since their stage became
+ * current.
+ */
+static int analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+	struct analog_match *am;
+	struct analog_match **local;
+	int *local_pos, num_local, num_channels, idx, i, ret;
+	const uint8_t *data;
+	double scale, offset, v;
+	gboolean hit, stage_hit;
+	GSList *l;
+
+	enc = analog->encoding;
+	if (!enc || !analog->meaning || !analog->data
+			|| !analog_encoding_supported(enc))
+		return -1;
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels)
+		return -1;
+
+	/* Matches on this packet's channels, and their interleave positions. */
+	local = g_malloc0(sta->num_matches * sizeof(local[0]));
+	local_pos = g_malloc0(sta->num_matches * sizeof(local_pos[0]));
+	num_local = 0;
+	for (idx = 0; idx < sta->num_matches; idx++) {
+		am = &sta->matches[idx];
+		for (l = analog->meaning->channels, i = 0; l; l = l->next, i++) {
+			if (l->data == am->match->channel) {
+				local[num_local] = am;
+				local_pos[num_local++] = i;
+				break;
+			}
+		}
+	}
+	if (!num_local) {
+		g_free(local);
+		g_free(local_pos);
+		return -1;
+	}
+
+	scale = (double)enc->scale.p / enc->scale.q;
+	offset = (double)enc->offset.p / enc->offset.q;
+	data = analog->data;
+
+	ret = -1;
+	for (i = 0; i < (int)analog->num_samples; i++) {
+		stage_hit = TRUE;
+		for (idx = 0; idx < num_local; idx++) {
+			am = local[idx];
+			v = analog_value(enc, data
+				+ ((size_t)i * num_channels + local_pos[idx])
+				* enc->unitsize, scale, offset);
+			hit = analog_match_update(am, v);
+			if (am->stage != sta->cur_stage)
+				continue;
+			if (analog_match_is_edge(am) && hit)
+				am->latched = TRUE;
+			if (!hit)
+				stage_hit = FALSE;
+		}
+		/* Matches of the current stage on other channels. */
+		for (idx = 0; stage_hit && idx < sta->num_matches; idx++) {
+			am = &sta->matches[idx];
+			if (am->stage != sta->cur_stage)
+				continue;
+			if (analog_match_is_edge(am))
+				stage_hit = am->latched;
+			else
+				stage_hit = am->level;
+		}
+		if (!stage_hit)
+			continue;
+		/* Current stage matched, consume its edges. */
+		for (idx = 0; idx < sta->num_matches; idx++) {
+			am = &sta->matches[idx];
+			if (am->stage == sta->cur_stage)
+				am->latched = FALSE;
+		}
+		if (++sta->cur_stage == sta->num_stages) {
+			ret = i;
+			break;
+		}
+	}
+
+	g_free(local);
+	g_free(local_pos);
+
+	return ret;
+}
+
+/* Send a packet's samples from skip, count samples per channel. */
+static void analog_send_range(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		uint64_t skip, uint64_t count)
+{
+	const struct sr_datafeed_analog *orig;
+	struct sr_datafeed_packet part;
+	struct sr_datafeed_analog analog;
+	size_t num_channels;
+
+	orig = packet->payload;
+	if (!count)
+		return;
+	if (!skip && count == orig->num_samples) {
+		sr_session_send(sdi, packet);
+		return;
+	}
+
+	analog = *orig;
+	num_channels = g_slist_length(orig->meaning->channels);
+	analog.data = (uint8_t *)orig->data
+		+ skip * num_channels * orig->encoding->unitsize;
+	analog.num_samples = count;
+	part.type = SR_DF_ANALOG;
+	part.payload = &analog;
+	sr_session_send(sdi, &part);
+}
+
+/* Keep (part of) a packet in the pre-trigger window. */
+static void analog_pre_append(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_packet *packet, uint64_t count)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_pre_item *item, *first;
+	const struct sr_channel *channel;
+	uint64_t total, excess;
+	GList *i, *next;
+
+	if (!sta->pre_trigger_samples || !count)
+		return;
+
+	analog = packet->payload;
+	channel = analog->meaning->channels->data;
+
+	item = g_malloc0(sizeof(*item));
+	if (sr_packet_ref(packet, &item->packet) != SR_OK) {
+		g_free(item);
+		return;
+	}
+	item->channel = channel;
+	item->count = MIN(count, sta->pre_trigger_samples);
+	item->skip = count - item->count;
+	g_queue_push_tail(&sta->pre_trigger, item);
+
+	/* Trim the channel's oldest data to the pre-trigger size. */
+	total = 0;
+	for (i = sta->pre_trigger.head; i; i = i->next) {
+		first = i->data;
+		if (first->channel == channel)
+			total += first->count;
+	}
+	for (i = sta->pre_trigger.head; i && total > sta->pre_trigger_samples; i = next) {
+		next = i->next;
+		first = i->data;
+		if (first->channel != channel)
+			continue;
+		excess = total - sta->pre_trigger_samples;
+		if (first->count <= excess) {
+			total -= first->count;
+			g_queue_delete_link(&sta->pre_trigger, i);
+			analog_pre_item_free(first);
+		} else {
+			first->skip += excess;
+			first->count -= excess;
+			total -= excess;
+		}
+	}
+}
+
+/*
+ * Pass an analog packet through the soft trigger. Before the trigger
+ * fires, packets get kept in the pre-trigger window. When the trigger
+ * fires, the pre-trigger window, an SR_DF_TRIGGER packet, and the data
+ * from the trigger position onwards get sent. Afterwards packets pass
+ * unmodified. Packets of other types always pass unmodified.
+ */
+SR_PRIV int soft_trigger_analog_send(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_pre_item *item;
+	int offset;
+
+	if (sta->fired || packet->type != SR_DF_ANALOG)
+		return sr_session_send(sta->sdi, packet);
+
+	analog = packet->payload;
+	if (!analog->meaning || !analog->meaning->channels)
+		return SR_OK;
+
+	offset = analog_check(sta, analog);
+	if (offset < 0) {
+		analog_pre_append(sta, packet, analog->num_samples);
+		return SR_OK;
+	}
+
+	sta->fired = TRUE;
+	analog_pre_append(sta, packet, offset);
+	while ((item = g_queue_pop_head(&sta->pre_trigger))) {
+		analog_send_range(sta->sdi, item->packet, item->skip, item->count);
+		analog_pre_item_free(item);
+	}
+	std_session_send_df_trigger(sta->sdi);
+	analog_send_range(sta->sdi, packet, offset, analog->num_samples - offset);
+
+	return SR_OK;
+}
@@ -549,6 +549,45 @@ SR_PRIV GSList *std_scan_complete(struct sr_dev_driver *di, GSList *devices)
 	return devices;
 }
 
+/*
+ * Option lists are the drivers' static arrays, and GUIs list them over
+ * and over. Each array's GVariant is created once and shared, callers
+ * get a reference of their own (see sr_config_list()).
+ */
+G_LOCK_DEFINE_STATIC(opts_cache);
+static GHashTable *opts_cache;
+
+static GVariant *std_opts_gvar(const uint32_t opts[], size_t num_opts)
+{
+	GVariant *gvar;
+	gsize num_cached;
+	const uint32_t *cached;
+
+	G_LOCK(opts_cache);
+	if (!opts_cache) {
+		opts_cache = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, (GDestroyNotify)g_variant_unref);
+	}
+	gvar = g_hash_table_lookup(opts_cache, opts);
+	if (gvar) {
+		/* Check the content, in case the array isn't static. */
+		cached = g_variant_get_fixed_array(gvar, &num_cached,
+			sizeof(uint32_t));
+		if (num_cached != num_opts ||
+				memcmp(cached, opts, num_opts * sizeof(uint32_t)))
+			gvar = NULL;
+	}
+	if (!gvar) {
+		gvar = g_variant_ref_sink(g_variant_new_fixed_array(
+			G_VARIANT_TYPE_UINT32, opts, num_opts, sizeof(uint32_t)));
+		g_hash_table_replace(opts_cache, (gpointer)opts, gvar);
+	}
+	g_variant_ref(gvar);
+	G_UNLOCK(opts_cache);
+
+	return gvar;
+}
+
 SR_PRIV int std_opts_config_list(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
 	const uint32_t scanopts[], size_t scansize, const uint32_t drvopts[],
@@ -559,22 +598,19 @@ SR_PRIV int std_opts_config_list(uint32_t key, GVariant **data,
 		/* Always return scanopts, regardless of sdi or cg. */
 		if (!scanopts || scanopts == NO_OPTS)
 			return SR_ERR_ARG;
-		*data = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
-			scanopts, scansize, sizeof(uint32_t));
+		*data = std_opts_gvar(scanopts, scansize);
 		break;
 	case SR_CONF_DEVICE_OPTIONS:
 		if (!sdi) {
 			/* sdi == NULL: return drvopts. */
 			if (!drvopts || drvopts == NO_OPTS)
 				return SR_ERR_ARG;
-			*data = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
-				drvopts, drvsize, sizeof(uint32_t));
+			*data = std_opts_gvar(drvopts, drvsize);
 		} else if (sdi && !cg) {
 			/* sdi != NULL, cg == NULL: return devopts. */
 			if (!devopts || devopts == NO_OPTS)
 				return SR_ERR_ARG;
-			*data = g_variant_new_fixed_array(G_VARIANT_TYPE_UINT32,
-				devopts, devsize, sizeof(uint32_t));
+			*data = std_opts_gvar(devopts, devsize);
 		} else {
 			/*
 			 * Note: sdi != NULL, cg != NULL is not handled by
@@ -35,6 +35,8 @@
 #include <string.h>
 #include <strings.h>
 #include <errno.h>
+#include <float.h>
+#include <limits.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -56,6 +58,212 @@
  * @{
  */
 
+/*
+ * Fast paths for the conversion of decimal text to numbers. These only
+ * handle the plain and most frequent forms of input text (which is what
+ * the text input modules see in bulk), and leave everything else (white
+ * space, odd prefixes, overflow, hex, inf/nan) to the C library. Which
+ * keeps the existing semantics, the fast paths only ever return results
+ * which are identical to what the slow paths would have returned.
+ */
+
+/* Check eight little endian loaded bytes for all being decimal digits. */
+static inline gboolean swar_is_eight_digits(uint64_t v)
+{
+	return ((v & 0xf0f0f0f0f0f0f0f0ULL) |
+		(((v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)) ==
+		0x3333333333333333ULL;
+}
+
+/* Convert eight decimal digits in one go, first digit in the LSB. */
+static inline uint32_t swar_eight_digits(uint64_t v)
+{
+	const uint64_t mask = 0x000000ff000000ffULL;
+	const uint64_t mul1 = 0x000f424000000064ULL; /* 100 + 1000000 << 32 */
+	const uint64_t mul2 = 0x0000271000000001ULL; /* 1 + 10000 << 32 */
+
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8);
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+
+	return (uint32_t)v;
+}
+
+/*
+ * Accumulate the decimal digits at the start of the text into *value.
+ * Returns the number of digits. The caller must check that count to
+ * detect when the accumulated value has overflown (more than 19 digits).
+ */
+static size_t scan_digits(const char *s, size_t len, uint64_t *value)
+{
+	const char *p;
+	uint64_t v, chunk;
+
+	p = s;
+	v = *value;
+	while (len >= sizeof(chunk)) {
+		memcpy(&chunk, p, sizeof(chunk));
+		chunk = GUINT64_FROM_LE(chunk);
+		if (!swar_is_eight_digits(chunk))
+			break;
+		v = v * 100000000 + swar_eight_digits(chunk);
+		p += sizeof(chunk);
+		len -= sizeof(chunk);
+	}
+	while (len && g_ascii_isdigit(*p)) {
+		v = v * 10 + (*p - '0');
+		p++;
+		len--;
+	}
+	*value = v;
+
+	return p - s;
+}
+
+/* Skip trailing white space, check for the end of the text. */
+static inline gboolean at_text_end(const char *s)
+{
+	while (isspace(*s))
+		s++;
+	return !*s;
+}
+
+/*
+ * Fast path for decimal integer conversion. Accepts an optional sign
+ * and up to 19 digits. Sets *end to the text after the digits.
+ */
+static gboolean atou64_fast(const char *str, uint64_t *ret,
+	gboolean *negative, const char **end)
+{
+	size_t len, count;
+	uint64_t value;
+	gboolean neg;
+
+	neg = FALSE;
+	if (*str == '-' || *str == '+')
+		neg = *str++ == '-';
+	value = 0;
+	len = strlen(str);
+	count = scan_digits(str, len, &value);
+	if (!count || count > 19)
+		return FALSE;
+
+	*ret = value;
+	if (negative)
+		*negative = neg;
+	else if (neg)
+		return FALSE;
+	if (end)
+		*end = &str[count];
+
+	return TRUE;
+}
+
+/*
+ * Fast path for floating point conversion: Clinger's exact case. When
+ * the decimal mantissa fits into the double's 53 bits mantissa and the
+ * power of ten is exactly representable, then a single multiplication
+ * or division with correct rounding delivers the exact result. This
+ * covers the vast majority of values which instruments and logs print.
+ * Everything else is left to g_ascii_strtod(). Requires that floating
+ * point operations are not evaluated at a higher precision.
+ *
+ * Converts a number at the start of the len bytes of text, and sets
+ * *end to the text after it.
+ */
+static gboolean atod_fast_prefix(const char *str, size_t len, double *ret,
+	const char **end)
+{
+#if defined FLT_EVAL_METHOD && FLT_EVAL_METHOD == 0
+	static const double exact_pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	const char *p;
+	size_t int_count, frac_count;
+	uint64_t mant, exp_digits;
+	size_t exp_count;
+	int exp10;
+	gboolean neg, exp_neg;
+	double value;
+
+	p = str;
+	neg = FALSE;
+	if (len && (*p == '-' || *p == '+')) {
+		neg = *p++ == '-';
+		len--;
+	}
+
+	mant = 0;
+	int_count = scan_digits(p, len, &mant);
+	p += int_count;
+	len -= int_count;
+	frac_count = 0;
+	if (len && *p == '.') {
+		p++;
+		len--;
+		frac_count = scan_digits(p, len, &mant);
+		p += frac_count;
+		len -= frac_count;
+	}
+	if (!int_count && !frac_count)
+		return FALSE;
+	if (int_count + frac_count > 19)
+		return FALSE;
+	exp10 = -(int)frac_count;
+
+	if (len && (*p == 'e' || *p == 'E')) {
+		p++;
+		len--;
+		exp_neg = FALSE;
+		if (len && (*p == '-' || *p == '+')) {
+			exp_neg = *p++ == '-';
+			len--;
+		}
+		exp_digits = 0;
+		exp_count = scan_digits(p, len, &exp_digits);
+		if (!exp_count || exp_count > 4)
+			return FALSE;
+		p += exp_count;
+		exp10 += exp_neg ? -(int)exp_digits : (int)exp_digits;
+	}
+
+	if (!mant) {
+		value = 0.0;
+	} else {
+		if (mant > (UINT64_C(1) << 53))
+			return FALSE;
+		if (exp10 < -22 || exp10 > 22)
+			return FALSE;
+		value = (double)mant;
+		if (exp10 < 0)
+			value /= exact_pow10[-exp10];
+		else
+			value *= exact_pow10[exp10];
+	}
+	*ret = neg ? -value : value;
+	*end = p;
+
+	return TRUE;
+#else
+	(void)str;
+	(void)len;
+	(void)ret;
+	(void)end;
+
+	return FALSE;
+#endif
+}
+
+/* Fast path conversion of a text which holds just the number. */
+static gboolean atod_fast(const char *str, double *ret)
+{
+	const char *end;
+
+	return atod_fast_prefix(str, strlen(str), ret, &end) && !*end;
+}
+
 /**
  * Convert a string representation of a numeric value (base 10) to a long integer. The
  * conversion is strict and will fail if the complete string does not represent
@@ -74,8 +282,22 @@ SR_PRIV int sr_atol(const char *str, long *ret)
 {
 	long tmp;
 	char *endptr = NULL;
+	uint64_t value;
+	gboolean neg;
+	const char *end;
 
 	errno = 0;
+	if (atou64_fast(str, &value, &neg, &end) && at_text_end(end)) {
+		if (!neg && value <= LONG_MAX) {
+			*ret = (long)value;
+			return SR_OK;
+		}
+		if (neg && value <= (uint64_t)LONG_MAX + 1) {
+			*ret = (long)(0 - value);
+			return SR_OK;
+		}
+	}
+
 	tmp = strtol(str, &endptr, 10);
 
 	while (endptr && isspace(*endptr))
@@ -170,10 +392,27 @@ SR_PRIV int sr_atoul_base(const char *str, unsigned long *ret, char **end, int b
 {
 	unsigned long num;
 	char *endptr;
+	uint64_t value;
+	const char *fast_end;
 
 	/* Add "0b" prefix support which strtol(3) may be missing. */
 	while (str && isspace(*str))
 		str++;
+
+	/* Quick path for plain decimal numbers, the most frequent input. */
+	if (base == 10 || (!base && *str >= '1' && *str <= '9')) {
+		if (atou64_fast(str, &value, NULL, &fast_end) &&
+				value <= ULONG_MAX) {
+			errno = 0;
+			*ret = value;
+			while (isspace(*fast_end))
+				fast_end++;
+			if (end)
+				*end = (char *)fast_end;
+			return SR_OK;
+		}
+	}
+
 	if ((!base || base == 2) && strncmp(str, "0b", strlen("0b")) == 0) {
 		str += strlen("0b");
 		base = 2;
@@ -199,6 +438,46 @@ SR_PRIV int sr_atoul_base(const char *str, unsigned long *ret, char **end, int b
 	return SR_OK;
 }
 
+/**
+ * Convert decimal text to an unsigned 64bit integer. The conversion is
+ * strict, the text must consist of decimal digits only (no sign, no
+ * white space, no suffix). The function sets errno according to the
+ * details of the failure.
+ *
+ * @param[in] str The input text to convert.
+ * @param[out] ret The conversion result.
+ *
+ * @retval SR_OK Conversion successful.
+ * @retval SR_ERR Conversion failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_atou64(const char *str, uint64_t *ret)
+{
+	size_t len, count;
+	uint64_t value;
+	char *endptr;
+
+	errno = 0;
+	len = strlen(str);
+	value = 0;
+	count = scan_digits(str, len, &value);
+	if (!count || count != len) {
+		errno = EINVAL;
+		return SR_ERR;
+	}
+	if (count > 19) {
+		/* Rare and might overflow, have the C library check. */
+		endptr = NULL;
+		value = g_ascii_strtoull(str, &endptr, 10);
+		if (errno)
+			return SR_ERR;
+	}
+	*ret = value;
+
+	return SR_OK;
+}
+
 /**
  * Convert a string representation of a numeric value (base 10) to an integer. The
  * conversion is strict and will fail if the complete string does not represent
@@ -314,6 +593,11 @@ SR_PRIV int sr_atod_ascii(const char *str, double *ret)
 	char *endptr = NULL;
 
 	errno = 0;
+	if (atod_fast(str, &tmp)) {
+		*ret = tmp;
+		return SR_OK;
+	}
+
 	tmp = g_ascii_strtod(str, &endptr);
 
 	if (!endptr || *endptr || errno) {
@@ -375,6 +659,11 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 	char *endptr = NULL;
 
 	errno = 0;
+	if (atod_fast(str, &tmp)) {
+		*ret = (float)tmp;
+		return SR_OK;
+	}
+
 	tmp = g_ascii_strtod(str, &endptr);
 
 	if (!endptr || *endptr || errno) {
@@ -397,6 +686,69 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 	return SR_OK;
 }
 
+/**
+ * Convert a separated list of numbers to floating point values, in a
+ * single pass and without allocations.
+ *
+ * Each item is converted like sr_atof_ascii() does. Leading white space
+ * is accepted, anything else than the number is not. An empty text is
+ * an empty list.
+ *
+ * @param[in] str The input text to convert.
+ * @param[in] separator The items' separator, e.g. ','.
+ * @param[out] values The conversion results.
+ * @param[in] size The number of items which fit into @a values.
+ * @param[out] count The number of converted items.
+ *
+ * @returns SR_OK when all items converted.
+ * @returns SR_ERR when an item fails to convert, or doesn't fit.
+ *          @a count has the number of items before it.
+ *
+ * @private
+ */
+SR_PRIV int sr_atof_ascii_list(const char *str, char separator,
+	float *values, size_t size, size_t *count)
+{
+	const char *p, *text_end, *item_end, *end;
+	char *endptr;
+	double tmp;
+
+	*count = 0;
+	p = str;
+	text_end = str + strlen(str);
+	if (p == text_end)
+		return SR_OK;
+
+	while (1) {
+		item_end = memchr(p, separator, text_end - p);
+		if (!item_end)
+			item_end = text_end;
+		if (*count >= size)
+			return SR_ERR;
+
+		while (p < item_end && g_ascii_isspace(*p))
+			p++;
+		if (!atod_fast_prefix(p, item_end - p, &tmp, &end)
+				|| end != item_end) {
+			/* The separator terminates the conversion. */
+			errno = 0;
+			tmp = g_ascii_strtod(p, &endptr);
+			if (endptr != item_end || errno) {
+				if (!errno)
+					errno = EINVAL;
+				return SR_ERR;
+			}
+		}
+		values[(*count)++] = (float)tmp;
+
+		if (item_end == text_end)
+			break;
+		p = item_end + 1;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Convert text to a floating point value, and get its precision.
  *
@@ -870,6 +1222,51 @@ SR_PRIV void sr_hexdump_free(GString *s)
 		g_string_free(s, TRUE);
 }
 
+/**
+ * Append the decimal text of an unsigned integer to a string.
+ *
+ * Converts two digits at a time from a lookup table. This avoids the
+ * format string parsing of g_string_append_printf() for text output
+ * which contains lots of numbers.
+ *
+ * @param[in] s The string to append to.
+ * @param[in] value The value to print.
+ *
+ * @private
+ */
+SR_PRIV void sr_string_append_u64(GString *s, uint64_t value)
+{
+	static const char pairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	char buf[20], *p;
+	unsigned int idx;
+
+	p = buf + sizeof(buf);
+	while (value >= 100) {
+		idx = (value % 100) * 2;
+		value /= 100;
+		*--p = pairs[idx + 1];
+		*--p = pairs[idx];
+	}
+	if (value >= 10) {
+		idx = value * 2;
+		*--p = pairs[idx + 1];
+		*--p = pairs[idx];
+	} else {
+		*--p = '0' + value;
+	}
+	g_string_append_len(s, p, buf + sizeof(buf) - p);
+}
+
 /**
  * Convert a string representation of a numeric value to a sr_rational.
  *
@@ -1746,6 +2143,18 @@ SR_API char *sr_text_trim_spaces(char *s)
 	return s;
 }
 
+/* Trim a text line of known length at both ends, NUL terminate it. */
+static char *text_trim_line(char *s, size_t len)
+{
+	while (len && isspace((int)s[len - 1]))
+		len--;
+	s[len] = '\0';
+	while (isspace((int)*s))
+		s++;
+
+	return s;
+}
+
 /**
  * Check for another complete text line, trim, return consumed char count.
  *
@@ -1793,30 +2202,85 @@ SR_API char *sr_text_trim_spaces(char *s)
 SR_API char *sr_text_next_line(char *s, size_t l, char **next, size_t *taken)
 {
 	char *p;
+	size_t len;
 
 	if (next)
 		*next = NULL;
+	if (!s)
+		return NULL;
 	if (!l)
 		l = strlen(s);
 
 	/* Immediate reject incomplete input data. */
-	if (!s || !*s || !l)
+	if (!*s || !l)
 		return NULL;
 
-	/* Search for the next line termination. NUL terminate. */
-	p = g_strstr_len(s, l, "\n");
+	/*
+	 * Search for the next line termination. The C library's memchr()
+	 * inspects several characters at a time on most platforms.
+	 */
+	p = memchr(s, '\n', l);
 	if (!p)
 		return NULL;
-	*p++ = '\0';
+	len = p - s;
+	p++;
 	if (taken)
 		*taken += p - s;
 	l -= p - s;
 	if (next)
 		*next = l ? p : NULL;
 
-	/* Trim NUL terminated text line at both ends. */
-	s = sr_text_trim_spaces(s);
-	return s;
+	/* NUL terminate and trim the text line at both ends. */
+	return text_trim_line(s, len);
+}
+
+/**
+ * Check for several complete text lines at once.
+ *
+ * @param[in] s The input text, current read position.
+ * @param[in] l The input text, remaining available characters.
+ * @param[out] lines Receives the start of each text line which was found.
+ * @param[in] count The maximum number of text lines to return.
+ * @param[out] next Position after the last returned text line.
+ * @param[out] taken Count of consumed chars in the returned text lines.
+ *
+ * @return The number of text lines which were found, up to @a count.
+ *
+ * Works like repeated sr_text_next_line() calls, each returned text line
+ * is NUL terminated and trimmed at both ends, and the 'taken' value gets
+ * accumulated. Text input gets processed in batches of lines, without a
+ * call per line. Optionally 'next' points to after the last returned
+ * text line, or is #NULL when no other text is available in the input
+ * buffer, which includes the case where no text line was found.
+ *
+ * @since 0.6.0
+ */
+SR_API size_t sr_text_next_lines(char *s, size_t l, char **lines,
+		size_t count, char **next, size_t *taken)
+{
+	size_t found;
+	char *line, *p;
+
+	if (next)
+		*next = NULL;
+	if (!s || !lines)
+		return 0;
+	if (!l)
+		l = strlen(s);
+
+	for (found = 0; s && found < count; found++) {
+		line = sr_text_next_line(s, l, &p, taken);
+		if (!line)
+			break;
+		lines[found] = line;
+		if (p)
+			l -= p - s;
+		s = p;
+	}
+	if (next && found)
+		*next = s;
+
+	return found;
 }
 
 /**
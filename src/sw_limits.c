@@ -125,6 +125,72 @@ SR_PRIV void sr_sw_limits_acquisition_start(struct sr_sw_limits *limits)
 	limits->samples_read = 0;
 	limits->frames_read = 0;
 	limits->start_time = g_get_monotonic_time();
+	limits->msec_timer = NULL;
+	g_atomic_int_set(&limits->msec_expired, FALSE);
+}
+
+static int msec_timer_expired(int fd, int revents, void *cb_data)
+{
+	struct sr_sw_limits *limits;
+
+	(void)fd;
+	(void)revents;
+
+	limits = cb_data;
+	g_atomic_int_set(&limits->msec_expired, TRUE);
+
+	/* Fire once. */
+	return FALSE;
+}
+
+/**
+ * Enforce the time limit with a timer instead of clock reads
+ *
+ * Adds a one-shot timer to the session, after which sr_sw_limits_check()
+ * reports the time limit as reached. Without the timer, every check
+ * reads the clock. Should be called right after
+ * sr_sw_limits_acquisition_start(), and sr_sw_limits_stop_timer() must
+ * be called when the acquisition ends.
+ *
+ * @param limits software limits instance
+ * @param session the session of the acquisition
+ *
+ * @return SR_ERR_* upon error, SR_OK otherwise
+ */
+SR_PRIV int sr_sw_limits_start_timer(struct sr_sw_limits *limits,
+	struct sr_session *session)
+{
+	int ret;
+
+	if (!limits->limit_msec)
+		return SR_OK;
+
+	/* Keyed by a member which no driver uses as its source key. */
+	ret = sr_session_fd_source_add(session, &limits->msec_expired, -1, 0,
+		limits->limit_msec / 1000, msec_timer_expired, limits);
+	if (ret != SR_OK)
+		return ret;
+	limits->msec_timer = session;
+
+	return SR_OK;
+}
+
+/**
+ * Remove the time limit timer
+ *
+ * Counterpart to sr_sw_limits_start_timer(). Does nothing when no timer
+ * was started.
+ *
+ * @param limits software limits instance
+ */
+SR_PRIV void sr_sw_limits_stop_timer(struct sr_sw_limits *limits)
+{
+	if (!limits->msec_timer)
+		return;
+	if (!g_atomic_int_get(&limits->msec_expired))
+		sr_session_source_remove_internal(limits->msec_timer,
+			&limits->msec_expired);
+	limits->msec_timer = NULL;
 }
 
 /**
@@ -156,7 +222,13 @@ SR_PRIV gboolean sr_sw_limits_check(struct sr_sw_limits *limits)
 		}
 	}
 
-	if (limits->limit_msec && limits->start_time) {
+	if (limits->limit_msec && limits->msec_timer) {
+		if (g_atomic_int_get(&limits->msec_expired)) {
+			sr_dbg("Requested sampling time (%" PRIu64
+			       "ms) reached.", limits->limit_msec / 1000);
+			return TRUE;
+		}
+	} else if (limits->limit_msec && limits->start_time) {
 		guint64 now;
 		now = g_get_monotonic_time();
 		if (now > limits->start_time &&
@@ -269,6 +341,36 @@ SR_PRIV void sr_sw_limits_update_samples_read(struct sr_sw_limits *limits,
 	limits->samples_read += samples_read;
 }
 
+/**
+ * Account for a block of samples, clipped to the sample limit
+ *
+ * Returns how many of the @p count samples are still within the sample
+ * limit, and accounts for those as read. Drivers can check and account
+ * for a whole block of samples at once, and submit only the returned
+ * number of samples. Without a sample limit, all samples are accepted.
+ *
+ * @param limits software limits instance
+ * @param count the number of samples which are available
+ *
+ * @return The number of samples to accept, 0 when the limit was reached
+ */
+SR_PRIV uint64_t sr_sw_limits_accept_samples(struct sr_sw_limits *limits,
+	uint64_t count)
+{
+	uint64_t remain;
+
+	if (limits->limit_samples) {
+		remain = 0;
+		if (limits->samples_read < limits->limit_samples)
+			remain = limits->limit_samples - limits->samples_read;
+		if (count > remain)
+			count = remain;
+	}
+	limits->samples_read += count;
+
+	return count;
+}
+
 /**
  * Update the amount of frames that have been read
  *
@@ -40,6 +40,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #endif
@@ -61,21 +62,23 @@
 #  define SHUT_RDWR SD_BOTH
 #endif
 
+/* Peers which went away must not raise SIGPIPE, where supported. */
+#if !defined MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
 #define LOG_PREFIX "tcp"
 
-/**
- * Check whether a file descriptor is readable (without blocking).
- *
- * @param[in] fd The file descriptor to check for readability.
- *
- * @return TRUE when readable, FALSE when read would block or when
- *   readability could not get determined.
- *
- * @since 6.0
- *
- * TODO Move to common code, applies to non-sockets as well.
+/*
+ * Size of the userspace receive buffer. Small reads get served from
+ * this buffer, which gets filled by large recv() calls. Callers which
+ * ask for at least this many bytes receive directly into their own
+ * buffer instead.
  */
-SR_PRIV gboolean sr_fd_is_readable(int fd)
+#define TCP_RX_BUF_SIZE	(64 * 1024)
+
+/* Wait up to timeout_ms milliseconds for a file descriptor to become readable. */
+static gboolean fd_wait_readable(int fd, int timeout_ms)
 {
 #if HAVE_POLL
 	struct pollfd fds[1];
@@ -84,7 +87,7 @@ SR_PRIV gboolean sr_fd_is_readable(int fd)
 	memset(fds, 0, sizeof(fds));
 	fds[0].fd = fd;
 	fds[0].events = POLLIN;
-	ret = poll(fds, ARRAY_SIZE(fds), -1);
+	ret = poll(fds, ARRAY_SIZE(fds), timeout_ms);
 	if (ret < 0)
 		return FALSE;
 	if (!ret)
@@ -101,20 +104,82 @@ SR_PRIV gboolean sr_fd_is_readable(int fd)
 	FD_ZERO(&rfds);
 	FD_SET(fd, &rfds);
 	memset(&tv, 0, sizeof(tv));
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
 	ret = select(fd + 1, &rfds, NULL, NULL, &tv);
 	if (ret < 0)
 		return FALSE;
 	if (!ret)
 		return FALSE;
-	if (!FD_ISSET(fd, rfds))
+	if (!FD_ISSET(fd, &rfds))
 		return FALSE;
 	return TRUE;
 #else
 	(void)fd;
+	(void)timeout_ms;
 	return FALSE;
 #endif
 }
 
+/**
+ * Check whether a file descriptor is readable (without blocking).
+ *
+ * @param[in] fd The file descriptor to check for readability.
+ *
+ * @return TRUE when readable, FALSE when read would block or when
+ *   readability could not get determined.
+ *
+ * @since 6.0
+ *
+ * TODO Move to common code, applies to non-sockets as well.
+ */
+SR_PRIV gboolean sr_fd_is_readable(int fd)
+{
+	return fd_wait_readable(fd, 0);
+}
+
+/**
+ * Apply socket options which suit instrument communication.
+ *
+ * Disables the Nagle algorithm, so that short commands are sent
+ * immediately instead of getting held back until previously sent
+ * data was acknowledged. Enables keepalive probes, so that peers
+ * which silently went away get noticed eventually.
+ *
+ * Failure to apply an option is not fatal, the connection remains
+ * usable. This helper is also available to drivers which manage
+ * their TCP sockets themselves.
+ *
+ * @param[in] fd The connected socket's file descriptor.
+ *
+ * @return SR_OK on success, SR_ERR_* otherwise.
+ *
+ * @since 6.0
+ */
+SR_PRIV int sr_tcp_set_sock_opts(int fd)
+{
+	int on, ret;
+
+	if (fd < 0)
+		return SR_ERR_ARG;
+
+	ret = SR_OK;
+	on = 1;
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+			(const char *)&on, sizeof(on)) != 0) {
+		sr_dbg("Cannot set TCP_NODELAY: %s.", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	on = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE,
+			(const char *)&on, sizeof(on)) != 0) {
+		sr_dbg("Cannot set SO_KEEPALIVE: %s.", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+
+	return ret;
+}
+
 /**
  * Create a TCP communication instance.
  *
@@ -162,6 +227,7 @@ SR_PRIV void sr_tcp_dev_inst_free(struct sr_tcp_dev_inst *tcp)
 		return;
 
 	(void)sr_tcp_disconnect(tcp);
+	g_free(tcp->rx_buf);
 	g_free(tcp->host_addr);
 	g_free(tcp->tcp_port);
 	g_free(tcp);
@@ -260,10 +326,124 @@ SR_PRIV int sr_tcp_connect(struct sr_tcp_dev_inst *tcp)
 		return SR_ERR_IO;
 	}
 
+	(void)sr_tcp_set_sock_opts(fd);
+	tcp->sock_fd = fd;
+	tcp->rx_pos = 0;
+	tcp->rx_len = 0;
+	return SR_OK;
+}
+
+/**
+ * Listen for connections from remote TCP communication peers.
+ *
+ * The instance's socket becomes a listening socket, accept connections
+ * with @ref sr_tcp_accept().
+ *
+ * @param[in] tcp The TCP communication instance. Without a host address
+ *                it listens on all local addresses.
+ *
+ * @return SR_OK on success, SR_ERR_* otherwise.
+ *
+ * @since 6.0
+ */
+SR_PRIV int sr_tcp_listen(struct sr_tcp_dev_inst *tcp)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *r;
+	int ret, on;
+	int fd;
+
+	if (!tcp)
+		return SR_ERR_ARG;
+	if (!tcp->tcp_port)
+		return SR_ERR_ARG;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+	ret = getaddrinfo(tcp->host_addr, tcp->tcp_port, &hints, &results);
+	if (ret != 0) {
+		sr_err("Address lookup failed: %s:%s: %s.",
+			tcp->host_addr ? tcp->host_addr : "*",
+			tcp->tcp_port, gai_strerror(ret));
+		return SR_ERR_DATA;
+	}
+
+	fd = -1;
+	for (r = results; r; r = r->ai_next) {
+		fd = socket(r->ai_family, r->ai_socktype, r->ai_protocol);
+		if (fd < 0)
+			continue;
+		on = 1;
+		(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+			(const char *)&on, sizeof(on));
+		if (bind(fd, r->ai_addr, r->ai_addrlen) != 0
+				|| listen(fd, 4) != 0) {
+			close(fd);
+			fd = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+	if (fd < 0) {
+		sr_err("Failed to listen on %s:%s: %s.",
+			tcp->host_addr ? tcp->host_addr : "*",
+			tcp->tcp_port, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
 	tcp->sock_fd = fd;
+	tcp->rx_pos = 0;
+	tcp->rx_len = 0;
 	return SR_OK;
 }
 
+/**
+ * Accept a connection on a listening TCP communication instance.
+ *
+ * Does not block, returns NULL when no connection is pending.
+ *
+ * @param[in] listener The listening instance, see @ref sr_tcp_listen().
+ *
+ * @return A new, connected instance with the peer's address, or NULL.
+ *
+ * @since 6.0
+ */
+SR_PRIV struct sr_tcp_dev_inst *sr_tcp_accept(struct sr_tcp_dev_inst *listener)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	char host[NI_MAXHOST], port[NI_MAXSERV];
+	struct sr_tcp_dev_inst *tcp;
+	int fd;
+
+	if (!listener || listener->sock_fd < 0)
+		return NULL;
+	if (!sr_fd_is_readable(listener->sock_fd))
+		return NULL;
+
+	addr_len = sizeof(addr);
+	fd = accept(listener->sock_fd, (struct sockaddr *)&addr, &addr_len);
+	if (fd < 0) {
+		sr_dbg("Cannot accept connection: %s.", g_strerror(errno));
+		return NULL;
+	}
+	if (getnameinfo((struct sockaddr *)&addr, addr_len,
+			host, sizeof(host), port, sizeof(port),
+			NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+		host[0] = '\0';
+		port[0] = '\0';
+	}
+
+	(void)sr_tcp_set_sock_opts(fd);
+	tcp = sr_tcp_dev_inst_new(host, port);
+	tcp->sock_fd = fd;
+	return tcp;
+}
+
 /**
  * Disconnect from a remote TCP communication peer.
  *
@@ -285,6 +465,8 @@ SR_PRIV int sr_tcp_disconnect(struct sr_tcp_dev_inst *tcp)
 	shutdown(tcp->sock_fd, SHUT_RDWR);
 	close(tcp->sock_fd);
 	tcp->sock_fd = -1;
+	tcp->rx_pos = 0;
+	tcp->rx_len = 0;
 	return SR_OK;
 }
 
@@ -318,18 +500,43 @@ SR_PRIV int sr_tcp_write_bytes(struct sr_tcp_dev_inst *tcp,
 	if (tcp->sock_fd < 0)
 		return SR_ERR_IO;
 
-	rc = send(tcp->sock_fd, data, dlen, 0);
+	rc = send(tcp->sock_fd, data, dlen, MSG_NOSIGNAL);
 	if (rc < 0)
 		return SR_ERR_IO;
 	written = (size_t)rc;
 	return written;
 }
 
+/* Move buffered receive data to the caller's buffer. */
+static size_t tcp_rx_take(struct sr_tcp_dev_inst *tcp,
+	uint8_t *data, size_t dlen)
+{
+	size_t chunk;
+
+	chunk = MIN(dlen, tcp->rx_len);
+	if (!chunk)
+		return 0;
+	memcpy(data, &tcp->rx_buf[tcp->rx_pos], chunk);
+	tcp->rx_pos += chunk;
+	tcp->rx_len -= chunk;
+	if (!tcp->rx_len)
+		tcp->rx_pos = 0;
+
+	return chunk;
+}
+
 /**
  * Fetch receive data from a TCP connection.
- * Does a single operating system call, can return with short
- * receive byte counts. Will not continue after short reads,
- * callers need to handle the condition.
+ * Can return with short receive byte counts. Will not wait for more
+ * data after short reads, callers need to handle the condition.
+ *
+ * Small reads get served from a userspace buffer which is filled by
+ * large recv() calls, reads of larger size receive directly into the
+ * caller's buffer. Previously buffered data is returned immediately,
+ * and only gets extended by what the socket can provide without
+ * blocking. Buffered data is not visible to the socket's poll state,
+ * callers should keep reading until short reads are seen, or check
+ * @ref sr_tcp_is_readable().
  *
  * @param[in] tcp The TCP communication instance to read from.
  * @param[in] data Caller provided buffer for receive data.
@@ -356,16 +563,79 @@ SR_PRIV int sr_tcp_read_bytes(struct sr_tcp_dev_inst *tcp,
 	if (tcp->sock_fd < 0)
 		return SR_ERR_IO;
 
-	if (nonblocking && !sr_fd_is_readable(tcp->sock_fd))
-		return 0;
+	/* Serve previously received data first. */
+	got = tcp_rx_take(tcp, data, dlen);
+	data += got;
+	dlen -= got;
+	if (!dlen)
+		return got;
+
+	/* Only block when nothing was buffered. */
+	if ((nonblocking || got) && !sr_fd_is_readable(tcp->sock_fd))
+		return got;
+
+	/* Large reads bypass the buffer. */
+	if (dlen >= TCP_RX_BUF_SIZE) {
+		rc = recv(tcp->sock_fd, (char *)data, dlen, 0);
+		if (rc < 0)
+			return got ? (int)got : SR_ERR_IO;
+		got += (size_t)rc;
+		return got;
+	}
 
-	rc = recv(tcp->sock_fd, data, dlen, 0);
+	/* Refill the buffer with a single large recv() call. */
+	if (!tcp->rx_buf)
+		tcp->rx_buf = g_malloc(TCP_RX_BUF_SIZE);
+	rc = recv(tcp->sock_fd, (char *)tcp->rx_buf, TCP_RX_BUF_SIZE, 0);
 	if (rc < 0)
-		return SR_ERR_IO;
-	got = (size_t)rc;
+		return got ? (int)got : SR_ERR_IO;
+	tcp->rx_pos = 0;
+	tcp->rx_len = (size_t)rc;
+	got += tcp_rx_take(tcp, data, dlen);
+
 	return got;
 }
 
+/**
+ * Check whether a TCP connection has receive data (without blocking).
+ * Considers previously buffered data as well as the socket's state.
+ *
+ * @param[in] tcp The TCP communication instance to check.
+ *
+ * @return TRUE when a read would not block, FALSE otherwise.
+ *
+ * @since 6.0
+ */
+SR_PRIV gboolean sr_tcp_is_readable(struct sr_tcp_dev_inst *tcp)
+{
+	if (!tcp || tcp->sock_fd < 0)
+		return FALSE;
+	if (tcp->rx_len)
+		return TRUE;
+	return sr_fd_is_readable(tcp->sock_fd);
+}
+
+/**
+ * Wait for receive data on a TCP connection.
+ * Considers previously buffered data as well as the socket's state.
+ *
+ * @param[in] tcp The TCP communication instance to check.
+ * @param[in] timeout_ms The maximum time to wait in milliseconds.
+ *
+ * @return TRUE when a read would not block, FALSE otherwise.
+ *
+ * @since 6.0
+ */
+SR_PRIV gboolean sr_tcp_wait_readable(struct sr_tcp_dev_inst *tcp,
+	int timeout_ms)
+{
+	if (!tcp || tcp->sock_fd < 0)
+		return FALSE;
+	if (tcp->rx_len)
+		return TRUE;
+	return fd_wait_readable(tcp->sock_fd, timeout_ms);
+}
+
 /**
  * Register receive callback for a TCP connection.
  * The connection must have been established before. The callback
@@ -0,0 +1,194 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * CPU affinity and scheduling of libsigrok owned threads
+ */
+
+/* Needed for the CPU_SET() family of macros. */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <errno.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "thread"
+
+/**
+ * Apply a thread policy to the calling thread.
+ *
+ * Failure is not fatal: the thread keeps running with the default
+ * affinity and scheduling. Real-time priorities usually need extra
+ * privileges (CAP_SYS_NICE or an RLIMIT_RTPRIO allowance).
+ *
+ * @param policy The policy to apply. NULL or an empty policy is a no-op.
+ * @param name Name of the thread for log messages.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_policy_apply(const struct sr_thread_policy *policy,
+		const char *name)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+	cpu_set_t set;
+	struct sched_param param;
+	size_t i;
+#endif
+
+	if (!policy || (!policy->cpu_count && !policy->rt_priority))
+		return;
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	if (policy->cpu_count) {
+		CPU_ZERO(&set);
+		for (i = 0; i < policy->cpu_count; i++) {
+			if (policy->cpus[i] < CPU_SETSIZE)
+				CPU_SET(policy->cpus[i], &set);
+		}
+		/* PID 0 is the calling thread on Linux. */
+		if (sched_setaffinity(0, sizeof(set), &set) < 0)
+			sr_warn("Cannot set CPU affinity of %s thread: %s.",
+				name, g_strerror(errno));
+	}
+	if (policy->rt_priority) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = policy->rt_priority;
+		if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+			sr_warn("Cannot set real-time priority of %s thread: %s.",
+				name, g_strerror(errno));
+	}
+#else
+	sr_warn("Thread affinity and priority not supported, "
+		"%s thread keeps defaults.", name);
+#endif
+}
+
+/* Parse a kernel CPU list like "0-7,16-23". */
+static int cpulist_parse(const char *text, unsigned int **cpus, size_t *count)
+{
+	GArray *list;
+	char *end;
+	unsigned long first, last;
+	unsigned int cpu;
+
+	list = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+	while (*text && *text != '\n') {
+		first = strtoul(text, &end, 10);
+		if (end == text)
+			break;
+		last = first;
+		text = end;
+		if (*text == '-') {
+			last = strtoul(++text, &end, 10);
+			if (end == text || last < first || last > 65535)
+				break;
+			text = end;
+		}
+		for (cpu = first; cpu <= last; cpu++)
+			g_array_append_val(list, cpu);
+		if (*text == ',')
+			text++;
+	}
+
+	*count = list->len;
+	*cpus = (unsigned int *)g_array_free(list, FALSE);
+
+	return *count ? SR_OK : SR_ERR_DATA;
+}
+
+/**
+ * Get the CPUs which are local to a device's host controller.
+ *
+ * On systems with several NUMA nodes, sample data takes the shortest
+ * path when the threads which receive and buffer it run on the node
+ * which the device's host controller is attached to. Buffers are
+ * placed on the node of the thread which first writes to them, so
+ * pinning the session's device threads to these CPUs (see
+ * sr_session_thread_policy_set()) keeps sample buffers local as well.
+ *
+ * Only USB devices on Linux are supported currently.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param cpus Receives the CPU numbers, free with g_free().
+ * @param cpu_count Receives the number of CPUs.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device's locality cannot be determined, or
+ *                   the system does not have NUMA nodes.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_local_cpus_get(const struct sr_dev_inst *sdi,
+		unsigned int **cpus, size_t *cpu_count)
+{
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_usb_dev_inst *usb;
+	char *path, *text;
+	int node, ret;
+#endif
+
+	if (!sdi || !cpus || !cpu_count)
+		return SR_ERR_ARG;
+	*cpus = NULL;
+	*cpu_count = 0;
+
+#ifdef HAVE_LIBUSB_1_0
+	if (sdi->inst_type != SR_INST_USB || !sdi->conn)
+		return SR_ERR_NA;
+	usb = sdi->conn;
+
+	/* The root hub's parent is the host controller (PCI) device. */
+	path = g_strdup_printf("/sys/bus/usb/devices/usb%u/../numa_node",
+		(unsigned int)usb->bus);
+	ret = g_file_get_contents(path, &text, NULL, NULL);
+	g_free(path);
+	if (!ret)
+		return SR_ERR_NA;
+	node = atoi(text);
+	g_free(text);
+	if (node < 0)
+		return SR_ERR_NA;
+
+	path = g_strdup_printf("/sys/devices/system/node/node%d/cpulist", node);
+	ret = g_file_get_contents(path, &text, NULL, NULL);
+	g_free(path);
+	if (!ret)
+		return SR_ERR_NA;
+	ret = cpulist_parse(text, cpus, cpu_count);
+	g_free(text);
+	if (ret != SR_OK) {
+		g_free(*cpus);
+		*cpus = NULL;
+		return SR_ERR_NA;
+	}
+	sr_dbg("USB bus %u is local to NUMA node %d, %zu CPUs.",
+		(unsigned int)usb->bus, node, *cpu_count);
+
+	return SR_OK;
+#else
+	return SR_ERR_NA;
+#endif
+}
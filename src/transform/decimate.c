@@ -0,0 +1,386 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Peak detecting decimation. Replaces every bucket of input samples by
+ * two output samples: the bucket's minimum and maximum for analog
+ * channels, and the AND and OR of the bucket's samples for logic
+ * channels. A logic channel which toggled anywhere within a bucket
+ * shows as a 0-1 transition, a constant channel stays constant.
+ *
+ * The bucket size is either given as a factor, or derived from the
+ * samplerate and the requested number of points per second. Several
+ * instances with different sizes provide multiple resolutions. Buckets
+ * span packets, incomplete buckets are dropped at the end of a frame
+ * or the acquisition.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+/* Running minimum/maximum of an analog channel's current bucket. */
+struct analog_bucket {
+	float min;
+	float max;
+	uint64_t count;
+};
+
+struct context {
+	uint64_t factor;
+	uint64_t points;
+	uint64_t samplerate;
+	/* Analog buckets, per struct sr_channel. */
+	GHashTable *buckets;
+	float *analog_buf;
+	size_t analog_buf_size;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	/* Logic bucket, and output. */
+	uint16_t unitsize;
+	uint8_t *logic_and;
+	uint8_t *logic_or;
+	uint64_t logic_count;
+	uint8_t *logic_buf;
+	size_t logic_buf_size;
+	struct sr_datafeed_logic logic;
+	/* Rewritten samplerate of meta packets. */
+	struct sr_datafeed_meta meta;
+	struct sr_config samplerate_cfg;
+	struct sr_datafeed_packet packet;
+};
+
+static void factor_update(struct context *ctx)
+{
+	if (!ctx->points || !ctx->samplerate)
+		return;
+
+	ctx->factor = MAX(ctx->samplerate / ctx->points, 1);
+	sr_dbg("Decimating by %" PRIu64 " for %" PRIu64 " points per second.",
+		ctx->factor, ctx->points);
+}
+
+static void buckets_reset(struct context *ctx)
+{
+	g_hash_table_remove_all(ctx->buckets);
+	ctx->logic_count = 0;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	GVariant *gvar;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	ctx->points = g_variant_get_uint64(g_hash_table_lookup(options, "points"));
+	if (!ctx->factor && !ctx->points) {
+		sr_err("Need a decimation factor or a number of points.");
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	ctx->factor = MAX(ctx->factor, 1);
+	ctx->buckets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, g_free);
+
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	factor_update(ctx);
+
+	return SR_OK;
+}
+
+/* Forward a meta packet with the samplerate after decimation. */
+static int receive_meta(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_meta *meta_in;
+	struct sr_config *src;
+	GSList *l;
+
+	meta_in = packet_in->payload;
+	*packet_out = packet_in;
+
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		ctx->samplerate = g_variant_get_uint64(src->data);
+		factor_update(ctx);
+		buckets_reset(ctx);
+	}
+	if (!ctx->samplerate)
+		return SR_OK;
+
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+	if (ctx->samplerate_cfg.data)
+		g_variant_unref(ctx->samplerate_cfg.data);
+	ctx->samplerate_cfg.key = SR_CONF_SAMPLERATE;
+	ctx->samplerate_cfg.data = g_variant_ref_sink(g_variant_new_uint64(
+		MAX(2 * ctx->samplerate / ctx->factor, 1)));
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		ctx->meta.config = g_slist_append(ctx->meta.config,
+			src->key == SR_CONF_SAMPLERATE ? &ctx->samplerate_cfg : src);
+	}
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_bucket *bucket;
+	size_t num_channels, ch, pos, n, outs, max_outs, size;
+	double min, max;
+	GSList *l;
+	int ret;
+
+	analog = packet_in->payload;
+	*packet_out = NULL;
+	if (!analog->meaning || !analog->num_samples)
+		return SR_OK;
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels)
+		return SR_OK;
+
+	/* Two output samples per completed bucket, plus the partial one. */
+	max_outs = analog->num_samples / ctx->factor + 1;
+	size = 2 * max_outs * num_channels;
+	if (size > ctx->analog_buf_size) {
+		ctx->analog_buf = g_realloc(ctx->analog_buf,
+			size * sizeof(ctx->analog_buf[0]));
+		ctx->analog_buf_size = size;
+	}
+
+	outs = 0;
+	for (l = analog->meaning->channels, ch = 0; l; l = l->next, ch++) {
+		bucket = g_hash_table_lookup(ctx->buckets, l->data);
+		if (!bucket) {
+			bucket = g_malloc0(sizeof(*bucket));
+			g_hash_table_insert(ctx->buckets, l->data, bucket);
+		}
+		/* Channels of a packet share their bucket positions. */
+		outs = 0;
+		for (pos = 0; pos < analog->num_samples; pos += n) {
+			n = MIN(analog->num_samples - pos,
+				ctx->factor - bucket->count);
+			ret = sr_analog_stats_get(analog, ch, pos, pos + n,
+				&min, &max, NULL);
+			if (ret != SR_OK)
+				return ret;
+			if (!bucket->count || min < bucket->min)
+				bucket->min = min;
+			if (!bucket->count || max > bucket->max)
+				bucket->max = max;
+			bucket->count += n;
+			if (bucket->count < ctx->factor)
+				continue;
+			ctx->analog_buf[(2 * outs) * num_channels + ch] = bucket->min;
+			ctx->analog_buf[(2 * outs + 1) * num_channels + ch] = bucket->max;
+			outs++;
+			bucket->count = 0;
+		}
+	}
+	if (!outs)
+		return SR_OK;
+
+	ctx->analog = *analog;
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_float = TRUE;
+	ctx->encoding.is_signed = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->analog.data = ctx->analog_buf;
+	ctx->analog.num_samples = 2 * outs;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *sample;
+	uint8_t *out;
+	size_t num_samples, i, j, outs, size;
+	uint16_t unitsize;
+
+	logic = packet_in->payload;
+	*packet_out = NULL;
+	unitsize = logic->unitsize;
+	if (!unitsize || logic->length < unitsize)
+		return SR_OK;
+
+	if (unitsize != ctx->unitsize) {
+		g_free(ctx->logic_and);
+		g_free(ctx->logic_or);
+		ctx->logic_and = g_malloc(unitsize);
+		ctx->logic_or = g_malloc(unitsize);
+		ctx->unitsize = unitsize;
+		ctx->logic_count = 0;
+	}
+
+	num_samples = logic->length / unitsize;
+	size = 2 * (num_samples / ctx->factor + 1) * unitsize;
+	if (size > ctx->logic_buf_size) {
+		ctx->logic_buf = g_realloc(ctx->logic_buf, size);
+		ctx->logic_buf_size = size;
+	}
+
+	outs = 0;
+	sample = logic->data;
+	for (i = 0; i < num_samples; i++, sample += unitsize) {
+		if (!ctx->logic_count) {
+			memcpy(ctx->logic_and, sample, unitsize);
+			memcpy(ctx->logic_or, sample, unitsize);
+		} else {
+			for (j = 0; j < unitsize; j++) {
+				ctx->logic_and[j] &= sample[j];
+				ctx->logic_or[j] |= sample[j];
+			}
+		}
+		if (++ctx->logic_count < ctx->factor)
+			continue;
+		out = ctx->logic_buf + 2 * outs * unitsize;
+		memcpy(out, ctx->logic_and, unitsize);
+		memcpy(out + unitsize, ctx->logic_or, unitsize);
+		outs++;
+		ctx->logic_count = 0;
+	}
+	if (!outs)
+		return SR_OK;
+
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.length = 2 * outs * unitsize;
+	ctx->logic.data = ctx->logic_buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_META:
+		return receive_meta(ctx, packet_in, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in, packet_out);
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in, packet_out);
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+	case SR_DF_END:
+		buckets_reset(ctx);
+		break;
+	default:
+		break;
+	}
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_hash_table_destroy(ctx->buckets);
+	g_free(ctx->analog_buf);
+	g_free(ctx->logic_and);
+	g_free(ctx->logic_or);
+	g_free(ctx->logic_buf);
+	g_slist_free(ctx->meta.config);
+	if (ctx->samplerate_cfg.data)
+		g_variant_unref(ctx->samplerate_cfg.data);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per bucket", NULL, NULL },
+	{ "points", "Points", "Number of buckets per second, derives the factor from the samplerate", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(100));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Min/max (peak detect) decimation of analog and logic data",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,413 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Downsampling with an anti-alias filter. Analog channels go through
+ * a windowed sinc (Blackman) low pass FIR filter with its cutoff at the
+ * new Nyquist frequency, of which only every factor-th output sample
+ * gets computed. The filter state is kept per channel across packets,
+ * so packet boundaries don't matter. Logic data is subsampled, keeping
+ * every factor-th sample, which keeps logic and analog data aligned.
+ * Meta packets get the reduced samplerate.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/downsample"
+
+#define MAX_TAPS 4095
+
+/* Filter history and phase of an analog channel. */
+struct filter_state {
+	/* The last taps - 1 input samples, followed by room for a packet. */
+	float *buf;
+	size_t buf_size;
+	uint64_t phase;
+};
+
+struct context {
+	uint64_t factor;
+	size_t num_taps;
+	float *taps;
+	uint64_t samplerate;
+	/* Filter states, per struct sr_channel. */
+	GHashTable *states;
+	float *in_buf;
+	size_t in_buf_size;
+	float *analog_buf;
+	size_t analog_buf_size;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	/* Logic subsampling. */
+	uint64_t logic_phase;
+	uint8_t *logic_buf;
+	size_t logic_buf_size;
+	struct sr_datafeed_logic logic;
+	/* Rewritten samplerate of meta packets. */
+	struct sr_datafeed_meta meta;
+	struct sr_config samplerate_cfg;
+	struct sr_datafeed_packet packet;
+};
+
+/* Windowed sinc low pass, cutoff at half the output rate, unity gain. */
+static void taps_create(struct context *ctx)
+{
+	double fc, x, w, sum;
+	size_t i, n;
+
+	n = ctx->num_taps;
+	ctx->taps = g_malloc(n * sizeof(ctx->taps[0]));
+	fc = 0.5 / ctx->factor;
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		x = i - (n - 1) / 2.0;
+		w = 1;
+		if (n > 1)
+			w = 0.42 - 0.5 * cos(2 * G_PI * i / (n - 1))
+				+ 0.08 * cos(4 * G_PI * i / (n - 1));
+		ctx->taps[i] = w * (x == 0 ? 2 * fc : sin(2 * G_PI * fc * x) / (G_PI * x));
+		sum += ctx->taps[i];
+	}
+	for (i = 0; i < n; i++)
+		ctx->taps[i] /= sum;
+}
+
+static void filter_state_free(void *data)
+{
+	struct filter_state *state;
+
+	state = data;
+	g_free(state->buf);
+	g_free(state);
+}
+
+static void states_reset(struct context *ctx)
+{
+	g_hash_table_remove_all(ctx->states);
+	ctx->logic_phase = 0;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	GVariant *gvar;
+	uint64_t taps;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	ctx->factor = MAX(ctx->factor, 1);
+	taps = g_variant_get_uint64(g_hash_table_lookup(options, "taps"));
+	if (!taps)
+		taps = 8 * ctx->factor + 1;
+	ctx->num_taps = MIN(taps, MAX_TAPS);
+	taps_create(ctx);
+	ctx->states = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, filter_state_free);
+
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	return SR_OK;
+}
+
+/* Forward a meta packet with the samplerate after downsampling. */
+static int receive_meta(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_meta *meta_in;
+	struct sr_config *src;
+	GSList *l;
+
+	meta_in = packet_in->payload;
+	*packet_out = packet_in;
+
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		ctx->samplerate = g_variant_get_uint64(src->data);
+		states_reset(ctx);
+	}
+	if (!ctx->samplerate)
+		return SR_OK;
+
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+	if (ctx->samplerate_cfg.data)
+		g_variant_unref(ctx->samplerate_cfg.data);
+	ctx->samplerate_cfg.key = SR_CONF_SAMPLERATE;
+	ctx->samplerate_cfg.data = g_variant_ref_sink(g_variant_new_uint64(
+		MAX(ctx->samplerate / ctx->factor, 1)));
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		ctx->meta.config = g_slist_append(ctx->meta.config,
+			src->key == SR_CONF_SAMPLERATE ? &ctx->samplerate_cfg : src);
+	}
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/*
+ * Filter one channel's samples, out of an interleaved buffer. Returns
+ * the number of output samples, which are written with the stride.
+ */
+static size_t filter_channel(struct context *ctx, struct filter_state *state,
+		const float *in, size_t stride, size_t count, float *out)
+{
+	size_t hist, size, outs, i, k;
+	const float *x;
+	float y;
+
+	/* Line up the history and the new samples. */
+	hist = ctx->num_taps - 1;
+	size = hist + count;
+	if (size > state->buf_size) {
+		state->buf = g_realloc(state->buf, size * sizeof(state->buf[0]));
+		state->buf_size = size;
+	}
+	for (i = 0; i < count; i++)
+		state->buf[hist + i] = in[i * stride];
+
+	/* Only compute the output samples which are kept. */
+	outs = 0;
+	for (i = 0; i < count; i++) {
+		if (++state->phase < ctx->factor)
+			continue;
+		state->phase = 0;
+		x = state->buf + i + hist;
+		y = 0;
+		for (k = 0; k < ctx->num_taps; k++)
+			y += ctx->taps[k] * x[-(ptrdiff_t)k];
+		out[outs * stride] = y;
+		outs++;
+	}
+
+	memmove(state->buf, state->buf + count, hist * sizeof(state->buf[0]));
+
+	return outs;
+}
+
+static int receive_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	struct filter_state *state;
+	size_t num_channels, ch, outs, size;
+	GSList *l;
+	int ret;
+
+	analog = packet_in->payload;
+	*packet_out = NULL;
+	if (!analog->meaning || !analog->num_samples)
+		return SR_OK;
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels)
+		return SR_OK;
+
+	size = analog->num_samples * num_channels;
+	if (size > ctx->in_buf_size) {
+		ctx->in_buf = g_realloc(ctx->in_buf, size * sizeof(ctx->in_buf[0]));
+		ctx->in_buf_size = size;
+	}
+	if ((ret = sr_analog_to_float(analog, ctx->in_buf)) != SR_OK)
+		return ret;
+	size = (analog->num_samples / ctx->factor + 1) * num_channels;
+	if (size > ctx->analog_buf_size) {
+		ctx->analog_buf = g_realloc(ctx->analog_buf,
+			size * sizeof(ctx->analog_buf[0]));
+		ctx->analog_buf_size = size;
+	}
+
+	/* Channels of a packet share their phase. */
+	outs = 0;
+	for (l = analog->meaning->channels, ch = 0; l; l = l->next, ch++) {
+		state = g_hash_table_lookup(ctx->states, l->data);
+		if (!state) {
+			state = g_malloc0(sizeof(*state));
+			state->buf_size = ctx->num_taps - 1;
+			state->buf = g_malloc0((state->buf_size + 1) * sizeof(state->buf[0]));
+			g_hash_table_insert(ctx->states, l->data, state);
+		}
+		outs = filter_channel(ctx, state, ctx->in_buf + ch, num_channels,
+			analog->num_samples, ctx->analog_buf + ch);
+	}
+	if (!outs)
+		return SR_OK;
+
+	ctx->analog = *analog;
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_float = TRUE;
+	ctx->encoding.is_signed = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->analog.data = ctx->analog_buf;
+	ctx->analog.num_samples = outs;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *sample;
+	size_t num_samples, i, outs, size;
+	uint16_t unitsize;
+
+	logic = packet_in->payload;
+	*packet_out = NULL;
+	unitsize = logic->unitsize;
+	if (!unitsize || logic->length < unitsize)
+		return SR_OK;
+
+	num_samples = logic->length / unitsize;
+	size = (num_samples / ctx->factor + 1) * unitsize;
+	if (size > ctx->logic_buf_size) {
+		ctx->logic_buf = g_realloc(ctx->logic_buf, size);
+		ctx->logic_buf_size = size;
+	}
+
+	/* Same phase as the analog channels' kept samples. */
+	outs = 0;
+	sample = logic->data;
+	for (i = 0; i < num_samples; i++, sample += unitsize) {
+		if (++ctx->logic_phase < ctx->factor)
+			continue;
+		ctx->logic_phase = 0;
+		memcpy(ctx->logic_buf + outs * unitsize, sample, unitsize);
+		outs++;
+	}
+	if (!outs)
+		return SR_OK;
+
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.length = outs * unitsize;
+	ctx->logic.data = ctx->logic_buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_META:
+		return receive_meta(ctx, packet_in, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in, packet_out);
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in, packet_out);
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+	case SR_DF_END:
+		states_reset(ctx);
+		break;
+	default:
+		break;
+	}
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_hash_table_destroy(ctx->states);
+	g_free(ctx->taps);
+	g_free(ctx->in_buf);
+	g_free(ctx->analog_buf);
+	g_free(ctx->logic_buf);
+	g_slist_free(ctx->meta.config);
+	if (ctx->samplerate_cfg.data)
+		g_variant_unref(ctx->samplerate_cfg.data);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per output sample", NULL, NULL },
+	{ "taps", "Taps", "Length of the anti-alias filter, 0 for 8 times the factor", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(10));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_downsample = {
+	.id = "downsample",
+	.name = "Downsample",
+	.desc = "Low pass filtered downsampling of analog data",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
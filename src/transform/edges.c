@@ -0,0 +1,351 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Index the edges of the selected logic channels (the enabled logic
+ * channels by default). Each SR_DF_LOGIC packet is preceded by an
+ * SR_DF_LOGIC_EDGES packet, which lists where each channel changes its
+ * value, see struct sr_datafeed_logic_edges. Consumers which follow a
+ * few channels then only look at those samples.
+ *
+ * Adjacent samples get XORed a 64bit word at a time, for unit sizes
+ * which divide the word. Words without changes of the selected channels
+ * get skipped, the set bits of the others are found by counting their
+ * trailing zeros. Place this module after transforms which change the
+ * logic data, the index is not updated by them.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/edges"
+
+struct context {
+	/* Selected channel indices, in ascending order. */
+	uint16_t *channels;
+	size_t num_channels;
+	/* Selected bits and each bit's channel, for the current unit size. */
+	uint16_t unitsize;
+	uint8_t *mask;
+	uint64_t mask_word;
+	int *slots;
+	/* The last sample of the previous packet. */
+	uint8_t *prev;
+	gboolean have_prev;
+	/* Edge positions of each channel, and the packet sent for them. */
+	GArray **edges;
+	uint64_t *offsets;
+	uint64_t *positions;
+	size_t positions_size;
+	struct sr_datafeed_logic_edges payload;
+	struct sr_datafeed_packet packet;
+};
+
+static gboolean name_listed(char **names, const char *name)
+{
+	for (; *names; names++) {
+		if (!strcmp(*names, name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gint compare_index(gconstpointer a, gconstpointer b)
+{
+	return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens;
+	GSList *l;
+	GArray *channels;
+	uint16_t index;
+	size_t i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	tokens = NULL;
+	if (names && *names)
+		tokens = g_strsplit(names, ",", 0);
+	for (i = 0; tokens && tokens[i]; i++)
+		g_strstrip(tokens[i]);
+
+	channels = g_array_new(FALSE, FALSE, sizeof(uint16_t));
+	for (l = t->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (tokens ? !name_listed(tokens, ch->name) : !ch->enabled)
+			continue;
+		index = ch->index;
+		g_array_append_val(channels, index);
+	}
+	g_strfreev(tokens);
+	if (!channels->len) {
+		sr_err("No logic channels selected.");
+		g_array_free(channels, TRUE);
+		return SR_ERR_ARG;
+	}
+	g_array_sort(channels, compare_index);
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->num_channels = channels->len;
+	ctx->channels = (uint16_t *)g_array_free(channels, FALSE);
+	ctx->edges = g_malloc(ctx->num_channels * sizeof(ctx->edges[0]));
+	for (i = 0; i < ctx->num_channels; i++)
+		ctx->edges[i] = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+	ctx->offsets = g_malloc((ctx->num_channels + 1)
+		* sizeof(ctx->offsets[0]));
+
+	return SR_OK;
+}
+
+/* (Re)build the selected bits for the given unit size. */
+static void mask_update(struct context *ctx, uint16_t unitsize)
+{
+	size_t i, bit;
+
+	if (ctx->mask && ctx->unitsize == unitsize)
+		return;
+
+	g_free(ctx->mask);
+	g_free(ctx->slots);
+	g_free(ctx->prev);
+	ctx->unitsize = unitsize;
+	ctx->mask = g_malloc0(unitsize);
+	ctx->slots = g_malloc(unitsize * 8 * sizeof(ctx->slots[0]));
+	ctx->prev = g_malloc(unitsize);
+	ctx->have_prev = FALSE;
+	for (bit = 0; bit < (size_t)unitsize * 8; bit++)
+		ctx->slots[bit] = -1;
+	for (i = 0; i < ctx->num_channels; i++) {
+		bit = ctx->channels[i];
+		if (bit >= (size_t)unitsize * 8)
+			continue;
+		ctx->mask[bit / 8] |= 1 << (bit % 8);
+		ctx->slots[bit] = i;
+	}
+
+	/* The mask of a word's worth of samples. */
+	ctx->mask_word = 0;
+	if (8 % unitsize == 0) {
+		for (i = 0; i < 8; i++)
+			ctx->mask_word |= (uint64_t)ctx->mask[i % unitsize] << (i * 8);
+	}
+}
+
+static inline unsigned int ctz64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#else
+	unsigned int n;
+
+	for (n = 0; !(x & 1); n++)
+		x >>= 1;
+
+	return n;
+#endif
+}
+
+static inline void edge_add(struct context *ctx, size_t bit, uint64_t pos)
+{
+	g_array_append_val(ctx->edges[ctx->slots[bit]], pos);
+}
+
+/* Edges between a sample and the one before it. */
+static void sample_edges(struct context *ctx, const uint8_t *cur,
+		const uint8_t *prev, uint64_t pos)
+{
+	unsigned int x;
+	size_t i;
+
+	for (i = 0; i < ctx->unitsize; i++) {
+		x = (cur[i] ^ prev[i]) & ctx->mask[i];
+		while (x) {
+			edge_add(ctx, i * 8 + ctz64(x), pos);
+			x &= x - 1;
+		}
+	}
+}
+
+static void index_logic(struct context *ctx, const uint8_t *data,
+		uint64_t count)
+{
+	uint64_t a, b, x, i, per_word;
+	unsigned int bit, width;
+
+	if (ctx->have_prev)
+		sample_edges(ctx, data, ctx->prev, 0);
+
+	i = 1;
+	if (ctx->mask_word) {
+		/* Whole words, the bits of a sample after the other. */
+		width = ctx->unitsize * 8;
+		per_word = 8 / ctx->unitsize;
+		for (; i + per_word <= count; i += per_word) {
+			memcpy(&a, data + i * ctx->unitsize, sizeof(a));
+			memcpy(&b, data + (i - 1) * ctx->unitsize, sizeof(b));
+			x = GUINT64_FROM_LE(a ^ b) & ctx->mask_word;
+			while (x) {
+				bit = ctz64(x);
+				edge_add(ctx, bit % width, i + bit / width);
+				x &= x - 1;
+			}
+		}
+	}
+	for (; i < count; i++)
+		sample_edges(ctx, data + i * ctx->unitsize,
+			data + (i - 1) * ctx->unitsize, i);
+
+	memcpy(ctx->prev, data + (count - 1) * ctx->unitsize, ctx->unitsize);
+	ctx->have_prev = TRUE;
+}
+
+/* Gather the channels' edges into the payload of the edges packet. */
+static void payload_update(struct context *ctx, uint64_t count)
+{
+	GArray *edges;
+	size_t i, total;
+
+	total = 0;
+	for (i = 0; i < ctx->num_channels; i++)
+		total += ctx->edges[i]->len;
+	if (total > ctx->positions_size) {
+		g_free(ctx->positions);
+		ctx->positions = g_malloc(total * sizeof(ctx->positions[0]));
+		ctx->positions_size = total;
+	}
+
+	total = 0;
+	for (i = 0; i < ctx->num_channels; i++) {
+		edges = ctx->edges[i];
+		ctx->offsets[i] = total;
+		if (edges->len)
+			memcpy(&ctx->positions[total], edges->data,
+				edges->len * sizeof(uint64_t));
+		total += edges->len;
+		g_array_set_size(edges, 0);
+	}
+	ctx->offsets[i] = total;
+
+	ctx->payload.num_samples = count;
+	ctx->payload.num_channels = ctx->num_channels;
+	ctx->payload.channels = ctx->channels;
+	ctx->payload.offsets = ctx->offsets;
+	ctx->payload.positions = ctx->positions;
+	ctx->packet.type = SR_DF_LOGIC_EDGES;
+	ctx->packet.payload = &ctx->payload;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	uint64_t count;
+	int ret;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		ctx->have_prev = FALSE;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		count = logic->length / logic->unitsize;
+		if (!count)
+			break;
+		mask_update(ctx, logic->unitsize);
+		index_logic(ctx, logic->data, count);
+		payload_update(ctx, count);
+		/* The index goes first, the logic packet follows. */
+		ret = sr_transform_send(t, &ctx->packet);
+		if (ret != SR_OK)
+			return ret;
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+	size_t i;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	for (i = 0; i < ctx->num_channels; i++)
+		g_array_free(ctx->edges[i], TRUE);
+	g_free(ctx->edges);
+	g_free(ctx->channels);
+	g_free(ctx->mask);
+	g_free(ctx->slots);
+	g_free(ctx->prev);
+	g_free(ctx->offsets);
+	g_free(ctx->positions);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to index, the enabled ones when empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_edges = {
+	.id = "edges",
+	.name = "Edges",
+	.desc = "Index the edges of logic channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,32 +24,151 @@
 
 #define LOG_PREFIX "transform/invert"
 
+struct context {
+	/* Selected channels, all of them when NULL. */
+	GHashTable *channels;
+	/* XOR pattern for 8 samples, a multiple of 8 bytes. */
+	size_t unitsize;
+	uint64_t *pattern;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens, **tok;
+	GSList *l;
+	gboolean found;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	if (!names || !*names)
+		return SR_OK;
+
+	ctx->channels = g_hash_table_new(g_direct_hash, g_direct_equal);
+	tokens = g_strsplit(names, ",", 0);
+	for (tok = tokens; *tok; tok++) {
+		g_strstrip(*tok);
+		found = FALSE;
+		for (l = t->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (strcmp(ch->name, *tok))
+				continue;
+			g_hash_table_add(ctx->channels, ch);
+			found = TRUE;
+		}
+		if (!found) {
+			sr_err("Unknown channel '%s'.", *tok);
+			g_strfreev(tokens);
+			g_hash_table_destroy(ctx->channels);
+			g_free(ctx);
+			t->priv = NULL;
+			return SR_ERR_ARG;
+		}
+	}
+	g_strfreev(tokens);
+
+	return SR_OK;
+}
+
+/* (Re)build the XOR pattern, 8 samples of the given unit size. */
+static void pattern_update(const struct sr_transform *t, size_t unitsize)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	uint8_t *pattern;
+	GSList *l;
+	size_t i;
+
+	ctx = t->priv;
+	if (ctx->pattern && ctx->unitsize == unitsize)
+		return;
+
+	g_free(ctx->pattern);
+	ctx->pattern = g_malloc0(unitsize * 8);
+	ctx->unitsize = unitsize;
+	pattern = (uint8_t *)ctx->pattern;
+	if (!ctx->channels) {
+		memset(pattern, 0xff, unitsize);
+	} else {
+		for (l = t->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->type != SR_CHANNEL_LOGIC)
+				continue;
+			if (!g_hash_table_contains(ctx->channels, ch))
+				continue;
+			if ((size_t)ch->index >= unitsize * 8)
+				continue;
+			pattern[ch->index / 8] |= 1 << (ch->index % 8);
+		}
+	}
+	for (i = 1; i < 8; i++)
+		memcpy(pattern + i * unitsize, pattern, unitsize);
+}
+
+/* XOR the pattern onto samples, whole blocks of 8 a word at a time. */
+static int invert_logic(const struct sr_transform *t,
+		uint8_t *data, uint16_t unitsize, size_t count)
+{
+	struct context *ctx;
+	const uint8_t *pattern;
+	uint64_t word;
+	size_t len, block, i, j;
+
+	ctx = t->priv;
+	if (!unitsize)
+		return SR_OK;
+	pattern_update(t, unitsize);
+
+	len = count * unitsize;
+	block = unitsize * 8;
+	for (i = 0; i + block <= len; i += block) {
+		for (j = 0; j < unitsize; j++) {
+			memcpy(&word, data + i + j * 8, sizeof(word));
+			word ^= ctx->pattern[j];
+			memcpy(data + i + j * 8, &word, sizeof(word));
+		}
+	}
+	pattern = (const uint8_t *)ctx->pattern;
+	for (j = 0; i < len; i++, j++)
+		data[i] ^= pattern[j];
+
+	return SR_OK;
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
+	struct context *ctx;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
+	ctx = t->priv;
 
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
-		}
+		if (logic->unitsize)
+			invert_logic(t, logic->data, logic->unitsize,
+				logic->length / logic->unitsize);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
+		/* Channels of a packet share the scale, check the first. */
+		if (ctx->channels && (!analog->meaning || !analog->meaning->channels
+				|| !g_hash_table_contains(ctx->channels,
+					analog->meaning->channels->data)))
+			break;
 		p = analog->encoding->scale.p;
 		q = analog->encoding->scale.q;
 		if (q > INT64_MAX)
@@ -68,12 +187,45 @@ static int receive(const struct sr_transform *t,
 	return SR_OK;
 }
 
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	if (ctx->channels)
+		g_hash_table_destroy(ctx->channels);
+	g_free(ctx->pattern);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to invert, all when empty", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
 SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
-	.options = NULL,
-	.init = NULL,
+	.options = get_options,
+	.init = init,
 	.receive = receive,
-	.cleanup = NULL,
+	.logic_kernel = invert_logic,
+	.cleanup = cleanup,
 };
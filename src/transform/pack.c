@@ -0,0 +1,308 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Shrink logic samples to the selected channels (the enabled logic
+ * channels by default). Bits of other channels are cleared, and the
+ * unit size is cut down to the highest selected channel. So the bits
+ * keep matching their channels' indices, which downstream consumers
+ * rely on.
+ *
+ * With the "pack" option, the selected channels are gathered into
+ * consecutive bits instead, the n-th selected channel (in index order)
+ * ending up in bit n. That is the minimum unit size, but consumers then
+ * have to know about the remapped layout.
+ *
+ * Bits are gathered by a lookup table for each input byte, which maps
+ * the byte's value to its contribution to the output sample.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/pack"
+
+/* Output samples up to this size use the lookup tables. */
+#define TABLE_UNITSIZE sizeof(uint64_t)
+
+struct context {
+	gboolean pack;
+	/* Selected channel indices, in ascending order. */
+	int *indices;
+	size_t num_indices;
+	uint16_t unitsize;
+	/* Lookup tables for the input unit size, bytes which have any. */
+	uint16_t in_unitsize;
+	uint64_t (*tables)[256];
+	size_t *table_bytes;
+	size_t num_table_bytes;
+	uint8_t *buf;
+	size_t buf_size;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_runs runs;
+	struct sr_datafeed_packet packet;
+};
+
+static gint compare_index(gconstpointer a, gconstpointer b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static gboolean name_listed(char **names, const char *name)
+{
+	for (; *names; names++) {
+		if (!strcmp(*names, name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens;
+	GSList *l;
+	GArray *indices;
+	size_t i;
+	int highest;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	tokens = NULL;
+	if (names && *names)
+		tokens = g_strsplit(names, ",", 0);
+	for (i = 0; tokens && tokens[i]; i++)
+		g_strstrip(tokens[i]);
+
+	indices = g_array_new(FALSE, FALSE, sizeof(int));
+	for (l = t->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (tokens ? !name_listed(tokens, ch->name) : !ch->enabled)
+			continue;
+		g_array_append_val(indices, ch->index);
+	}
+	g_strfreev(tokens);
+	if (!indices->len) {
+		sr_err("No logic channels selected.");
+		g_array_free(indices, TRUE);
+		return SR_ERR_ARG;
+	}
+	g_array_sort(indices, compare_index);
+
+	t->priv = ctx = g_malloc0(sizeof(*ctx));
+	ctx->pack = g_variant_get_boolean(g_hash_table_lookup(options, "pack"));
+	ctx->num_indices = indices->len;
+	ctx->indices = (int *)g_array_free(indices, FALSE);
+
+	highest = ctx->pack ? (int)ctx->num_indices - 1
+		: ctx->indices[ctx->num_indices - 1];
+	ctx->unitsize = highest / 8 + 1;
+	sr_dbg("Logic samples of %d channels in %u bytes.",
+		(int)ctx->num_indices, ctx->unitsize);
+
+	return SR_OK;
+}
+
+/* Output bit position of the n-th selected channel. */
+static int output_bit(const struct context *ctx, size_t n)
+{
+	return ctx->pack ? (int)n : ctx->indices[n];
+}
+
+static void tables_update(struct context *ctx, uint16_t in_unitsize)
+{
+	size_t n, byte;
+	int idx, v;
+	gboolean used;
+
+	if (ctx->in_unitsize == in_unitsize)
+		return;
+
+	g_free(ctx->tables);
+	g_free(ctx->table_bytes);
+	ctx->in_unitsize = in_unitsize;
+	ctx->tables = g_malloc0(sizeof(ctx->tables[0]) * in_unitsize);
+	ctx->table_bytes = g_malloc0(sizeof(ctx->table_bytes[0]) * in_unitsize);
+	ctx->num_table_bytes = 0;
+
+	for (byte = 0; byte < in_unitsize; byte++) {
+		used = FALSE;
+		for (n = 0; n < ctx->num_indices; n++) {
+			idx = ctx->indices[n];
+			if ((size_t)idx / 8 != byte)
+				continue;
+			used = TRUE;
+			for (v = 0; v < 256; v++) {
+				if (v & (1 << (idx % 8)))
+					ctx->tables[byte][v] |= UINT64_C(1) << output_bit(ctx, n);
+			}
+		}
+		if (used)
+			ctx->table_bytes[ctx->num_table_bytes++] = byte;
+	}
+}
+
+/* Gather the selected channels of count samples into the buffer. */
+static void pack_samples(struct context *ctx, const uint8_t *data,
+		uint16_t in_unitsize, size_t count)
+{
+	uint8_t *out, tmp[sizeof(uint64_t)];
+	uint64_t word;
+	size_t size, i, j, n, byte;
+	int idx, bit;
+
+	size = count * ctx->unitsize;
+	if (size > ctx->buf_size) {
+		ctx->buf = g_realloc(ctx->buf, size);
+		ctx->buf_size = size;
+	}
+	out = ctx->buf;
+
+	if (ctx->unitsize <= TABLE_UNITSIZE) {
+		tables_update(ctx, in_unitsize);
+		for (i = 0; i < count; i++) {
+			word = 0;
+			for (j = 0; j < ctx->num_table_bytes; j++) {
+				byte = ctx->table_bytes[j];
+				word |= ctx->tables[byte][data[byte]];
+			}
+			WL64(tmp, word);
+			memcpy(out, tmp, ctx->unitsize);
+			data += in_unitsize;
+			out += ctx->unitsize;
+		}
+		return;
+	}
+
+	/* Wide samples, go bit by bit. */
+	memset(out, 0, size);
+	for (i = 0; i < count; i++) {
+		for (n = 0; n < ctx->num_indices; n++) {
+			idx = ctx->indices[n];
+			if ((size_t)idx / 8 >= in_unitsize)
+				continue;
+			if (!(data[idx / 8] & (1 << (idx % 8))))
+				continue;
+			bit = output_bit(ctx, n);
+			out[bit / 8] |= 1 << (bit % 8);
+		}
+		data += in_unitsize;
+		out += ctx->unitsize;
+	}
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_runs *runs;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		pack_samples(ctx, logic->data, logic->unitsize,
+			logic->length / logic->unitsize);
+		ctx->logic = *logic;
+		ctx->logic.unitsize = ctx->unitsize;
+		ctx->logic.length = logic->length / logic->unitsize * ctx->unitsize;
+		ctx->logic.data = ctx->buf;
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->logic;
+		*packet_out = &ctx->packet;
+		break;
+	case SR_DF_LOGIC_RUNS:
+		runs = packet_in->payload;
+		if (!runs->unitsize)
+			break;
+		pack_samples(ctx, runs->data, runs->unitsize, runs->num_runs);
+		ctx->runs = *runs;
+		ctx->runs.unitsize = ctx->unitsize;
+		ctx->runs.data = ctx->buf;
+		ctx->packet.type = SR_DF_LOGIC_RUNS;
+		ctx->packet.payload = &ctx->runs;
+		*packet_out = &ctx->packet;
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_free(ctx->indices);
+	g_free(ctx->tables);
+	g_free(ctx->table_bytes);
+	g_free(ctx->buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the channels to keep, the enabled ones when empty", NULL, NULL },
+	{ "pack", "Pack", "Move the channels to consecutive bits", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_pack = {
+	.id = "pack",
+	.name = "Pack",
+	.desc = "Shrink logic samples to the selected channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
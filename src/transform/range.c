@@ -0,0 +1,291 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sample range selection. Only passes the samples from index 'start'
+ * up to 'start' + 'count' of logic and analog data, and drops the
+ * rest. A count of 0 passes everything from the start index on.
+ *
+ * This is the generic fallback for sources which cannot seek, like
+ * input modules which have to parse their whole input. Logic and
+ * analog data are counted separately, analog data is counted per set
+ * of channels within a packet.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/range"
+
+struct context {
+	uint64_t start;
+	uint64_t count;
+	/* Sample positions of logic data, and per analog channel set. */
+	uint64_t logic_pos;
+	GHashTable *analog_pos;
+	/* Clipped output. */
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_runs runs;
+	uint64_t *run_lengths;
+	size_t run_lengths_size;
+	struct sr_datafeed_analog analog;
+	struct sr_datafeed_packet packet;
+};
+
+/*
+ * Clip @a n samples at position @a pos to the range. Returns the
+ * number of samples to skip at the front in @a skip, and the number
+ * of samples to keep.
+ */
+static uint64_t clip_range(const struct context *ctx,
+		uint64_t pos, uint64_t n, uint64_t *skip)
+{
+	uint64_t first, last;
+
+	first = MAX(pos, ctx->start);
+	last = pos + n;
+	if (ctx->count && last > ctx->start + ctx->count)
+		last = ctx->start + ctx->count;
+	*skip = first - pos;
+
+	return last > first ? last - first : 0;
+}
+
+static void positions_reset(struct context *ctx)
+{
+	ctx->logic_pos = 0;
+	g_hash_table_remove_all(ctx->analog_pos);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->start = g_variant_get_uint64(g_hash_table_lookup(options, "start"));
+	ctx->count = g_variant_get_uint64(g_hash_table_lookup(options, "count"));
+	ctx->analog_pos = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, g_free);
+
+	return SR_OK;
+}
+
+static int receive_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	uint64_t num_samples, skip, keep;
+
+	logic = packet_in->payload;
+	*packet_out = NULL;
+	if (!logic->unitsize)
+		return SR_OK;
+
+	num_samples = logic->length / logic->unitsize;
+	keep = clip_range(ctx, ctx->logic_pos, num_samples, &skip);
+	ctx->logic_pos += num_samples;
+	if (!keep)
+		return SR_OK;
+	if (keep == num_samples) {
+		*packet_out = packet_in;
+		return SR_OK;
+	}
+
+	ctx->logic = *logic;
+	ctx->logic.data = (uint8_t *)logic->data + skip * logic->unitsize;
+	ctx->logic.length = keep * logic->unitsize;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_logic_runs(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic_runs *runs;
+	uint64_t num_samples, skip, keep, first, last, pos, head, tail, i;
+
+	runs = packet_in->payload;
+	*packet_out = NULL;
+	if (!runs->num_runs)
+		return SR_OK;
+
+	num_samples = 0;
+	for (i = 0; i < runs->num_runs; i++)
+		num_samples += runs->lengths[i];
+	keep = clip_range(ctx, ctx->logic_pos, num_samples, &skip);
+	ctx->logic_pos += num_samples;
+	if (!keep)
+		return SR_OK;
+	if (keep == num_samples) {
+		*packet_out = packet_in;
+		return SR_OK;
+	}
+
+	/* Find the runs which overlap the kept samples. */
+	pos = 0;
+	for (first = 0; pos + runs->lengths[first] <= skip; first++)
+		pos += runs->lengths[first];
+	head = pos + runs->lengths[first] - skip;
+	for (last = first; pos + runs->lengths[last] < skip + keep; last++)
+		pos += runs->lengths[last];
+	tail = skip + keep - pos;
+
+	/* The source's lengths are const, clip a copy of them. */
+	if (last - first + 1 > ctx->run_lengths_size) {
+		ctx->run_lengths_size = last - first + 1;
+		ctx->run_lengths = g_realloc(ctx->run_lengths,
+			ctx->run_lengths_size * sizeof(ctx->run_lengths[0]));
+	}
+	memcpy(ctx->run_lengths, runs->lengths + first,
+		(last - first + 1) * sizeof(runs->lengths[0]));
+	ctx->runs = *runs;
+	ctx->runs.num_runs = last - first + 1;
+	ctx->runs.data = (uint8_t *)runs->data + first * runs->unitsize;
+	ctx->runs.lengths = ctx->run_lengths;
+	ctx->run_lengths[0] = MIN(head, keep);
+	if (ctx->runs.num_runs > 1)
+		ctx->run_lengths[ctx->runs.num_runs - 1] = tail;
+	ctx->packet.type = SR_DF_LOGIC_RUNS;
+	ctx->packet.payload = &ctx->runs;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_analog *analog;
+	uint64_t *pos, skip, keep;
+	size_t step;
+	gpointer key;
+
+	analog = packet_in->payload;
+	*packet_out = NULL;
+	if (!analog->meaning || !analog->meaning->channels || !analog->encoding)
+		return SR_OK;
+
+	key = analog->meaning->channels->data;
+	pos = g_hash_table_lookup(ctx->analog_pos, key);
+	if (!pos) {
+		pos = g_malloc0(sizeof(*pos));
+		g_hash_table_insert(ctx->analog_pos, key, pos);
+	}
+	keep = clip_range(ctx, *pos, analog->num_samples, &skip);
+	*pos += analog->num_samples;
+	if (!keep)
+		return SR_OK;
+	if (keep == analog->num_samples) {
+		*packet_out = packet_in;
+		return SR_OK;
+	}
+
+	step = g_slist_length(analog->meaning->channels)
+		* analog->encoding->unitsize;
+	ctx->analog = *analog;
+	ctx->analog.data = (uint8_t *)analog->data + skip * step;
+	ctx->analog.num_samples = keep;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in, packet_out);
+	case SR_DF_LOGIC_RUNS:
+		return receive_logic_runs(ctx, packet_in, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in, packet_out);
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_END:
+		positions_reset(ctx);
+		break;
+	default:
+		break;
+	}
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_hash_table_destroy(ctx->analog_pos);
+	g_free(ctx->run_lengths);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "start", "Start", "Index of the first sample to pass", NULL, NULL },
+	{ "count", "Count", "Number of samples to pass, 0 passes all", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_range = {
+	.id = "range",
+	.name = "Range",
+	.desc = "Pass a range of samples only, drop the rest",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
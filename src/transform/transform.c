@@ -45,12 +45,22 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_decimate;
+extern SR_PRIV struct sr_transform_module transform_range;
+extern SR_PRIV struct sr_transform_module transform_pack;
+extern SR_PRIV struct sr_transform_module transform_downsample;
+extern SR_PRIV struct sr_transform_module transform_edges;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_decimate,
+	&transform_range,
+	&transform_pack,
+	&transform_downsample,
+	&transform_edges,
 	NULL,
 };
 
@@ -260,6 +270,7 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 
 	/* Add the transform to the session's list of transforms. */
 	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	sr_session_dispatch_invalidate(sdi->session);
 
 	return t;
 }
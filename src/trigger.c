@@ -119,6 +119,40 @@ SR_API struct sr_trigger_stage *sr_trigger_stage_add(struct sr_trigger *trig)
 	return stage;
 }
 
+/**
+ * Set the occurrence count and timing of a trigger stage.
+ *
+ * By default a stage matches once, at the sample directly following the
+ * previous stage's match. This allows for sequences like "stage B within
+ * N samples of stage A", or "stage A K times in a row".
+ *
+ * @param stage The trigger stage. Must not be NULL.
+ * @param count How often the stage's matches must occur since the
+ *              previous stage matched. 0 or 1 for once.
+ * @param within The maximum distance in samples from the previous
+ *               stage's match to the last occurrence. 0 requires
+ *               consecutive occurrences, directly following the previous
+ *               stage. Use UINT64_MAX for no limit. For the first stage,
+ *               only the distinction between 0 (consecutive) and other
+ *               values (anywhere) is relevant.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_trigger_stage_timing_set(struct sr_trigger_stage *stage,
+		uint64_t count, uint64_t within)
+{
+	if (!stage)
+		return SR_ERR_ARG;
+
+	stage->count = count;
+	stage->within = within;
+
+	return SR_OK;
+}
+
 /**
  * Allocate a new trigger match and add it to the specified trigger stage.
  *
@@ -173,6 +207,81 @@ SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 	match->channel = ch;
 	match->match = trigger_match;
 	match->value = value;
+	match->value_high = value;
+	stage->matches = g_slist_append(stage->matches, match);
+
+	return SR_OK;
+}
+
+/**
+ * Add a new trigger match for an analog channel to a trigger stage.
+ *
+ * In addition to sr_trigger_match_add(), this supports window matches
+ * and hysteresis. Edge matches (SR_TRIGGER_RISING, SR_TRIGGER_FALLING,
+ * SR_TRIGGER_EDGE) fire when the signal crosses @a value, after it had
+ * been at least @a hysteresis away on the other side. Window matches
+ * (SR_TRIGGER_INSIDE, SR_TRIGGER_OUTSIDE) compare against the range from
+ * @a value to @a value_high.
+ *
+ * @param stage The stage to add the match to. Must not be NULL.
+ * @param ch The channel for this trigger match. Must be of type
+ *           SR_CHANNEL_ANALOG.
+ * @param trigger_match The type of trigger match, from enum
+ *                      sr_trigger_matches.
+ * @param value The level, or the lower bound of the window.
+ * @param value_high The upper bound of the window. Ignored for other
+ *                   types of matches.
+ * @param hysteresis The hysteresis of edge matches. Must not be negative.
+ *                   Ignored for other types of matches.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument(s) were passed to this functions.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_trigger_match_analog_add(struct sr_trigger_stage *stage,
+		struct sr_channel *ch, int trigger_match, float value,
+		float value_high, float hysteresis)
+{
+	struct sr_trigger_match *match;
+
+	if (!stage || !ch)
+		return SR_ERR_ARG;
+
+	if (ch->type != SR_CHANNEL_ANALOG) {
+		sr_err("Not an analog channel: %s.", ch->name);
+		return SR_ERR_ARG;
+	}
+	switch (trigger_match) {
+	case SR_TRIGGER_RISING:
+	case SR_TRIGGER_FALLING:
+	case SR_TRIGGER_EDGE:
+	case SR_TRIGGER_OVER:
+	case SR_TRIGGER_UNDER:
+		value_high = value;
+		break;
+	case SR_TRIGGER_INSIDE:
+	case SR_TRIGGER_OUTSIDE:
+		if (value_high < value) {
+			sr_err("Invalid trigger window.");
+			return SR_ERR_ARG;
+		}
+		break;
+	default:
+		sr_err("Invalid trigger match for an analog channel.");
+		return SR_ERR_ARG;
+	}
+	if (hysteresis < 0) {
+		sr_err("Invalid trigger hysteresis.");
+		return SR_ERR_ARG;
+	}
+
+	match = g_malloc0(sizeof(struct sr_trigger_match));
+	match->channel = ch;
+	match->match = trigger_match;
+	match->value = value;
+	match->value_high = value_high;
+	match->hysteresis = hysteresis;
 	stage->matches = g_slist_append(stage->matches, match);
 
 	return SR_OK;
@@ -50,8 +50,37 @@ struct usb_source {
 
 	struct libusb_context *usb_ctx;
 	GPtrArray *pollfds;
+	/* The kernel event set which polls the fds, see session_poller.c. */
+	struct sr_poller *poller;
 };
 
+/** A libusb FD, and whether the poller or GLib polls it.
+ */
+struct usb_pollfd {
+	GPollFD pollfd;
+	gboolean polled;
+	/* The poller reported the FD, re-arm it after dispatch. */
+	gboolean fired;
+};
+
+/* Events of the FDs, since the last poll or dispatch. */
+static unsigned int usb_source_revents(struct usb_source *usource,
+		gboolean polled_only)
+{
+	struct usb_pollfd *upollfd;
+	unsigned int revents;
+	unsigned int i;
+
+	revents = 0;
+	for (i = 0; i < usource->pollfds->len; i++) {
+		upollfd = g_ptr_array_index(usource->pollfds, i);
+		if (!polled_only || upollfd->polled)
+			revents |= upollfd->pollfd.revents;
+	}
+
+	return revents;
+}
+
 /** USB event source prepare() method.
  */
 static gboolean usb_source_prepare(GSource *source, int *timeout)
@@ -88,6 +117,10 @@ static gboolean usb_source_prepare(GSource *source, int *timeout)
 
 	*timeout = remaining_ms;
 
+	/* The poller reported an event since the last dispatch. */
+	if (usource->poller && usb_source_revents(usource, TRUE))
+		return TRUE;
+
 	return (remaining_ms == 0);
 }
 
@@ -96,17 +129,11 @@ static gboolean usb_source_prepare(GSource *source, int *timeout)
 static gboolean usb_source_check(GSource *source)
 {
 	struct usb_source *usource;
-	GPollFD *pollfd;
 	unsigned int revents;
-	unsigned int i;
 
 	usource = (struct usb_source *)source;
-	revents = 0;
+	revents = usb_source_revents(usource, FALSE);
 
-	for (i = 0; i < usource->pollfds->len; i++) {
-		pollfd = g_ptr_array_index(usource->pollfds, i);
-		revents |= pollfd->revents;
-	}
 	return (revents != 0 || (usource->due_us != INT64_MAX
 			&& usource->due_us <= g_source_get_time(source)));
 }
@@ -117,21 +144,26 @@ static gboolean usb_source_dispatch(GSource *source,
 		GSourceFunc callback, void *user_data)
 {
 	struct usb_source *usource;
-	GPollFD *pollfd;
+	struct usb_pollfd *upollfd;
 	unsigned int revents;
 	unsigned int i;
 	gboolean keep;
 
 	usource = (struct usb_source *)source;
-	revents = 0;
 	/*
 	 * This is somewhat arbitrary, but drivers use revents to distinguish
 	 * actual I/O from timeouts. When we remove the user timeout from the
 	 * driver API, this will no longer be needed.
 	 */
-	for (i = 0; i < usource->pollfds->len; i++) {
-		pollfd = g_ptr_array_index(usource->pollfds, i);
-		revents |= pollfd->revents;
+	revents = usb_source_revents(usource, FALSE);
+
+	/* FDs which the poller reported get re-armed after the callback. */
+	for (i = 0; usource->poller && i < usource->pollfds->len; i++) {
+		upollfd = g_ptr_array_index(usource->pollfds, i);
+		if (!upollfd->polled || !upollfd->pollfd.revents)
+			continue;
+		upollfd->pollfd.revents = 0;
+		upollfd->fired = TRUE;
 	}
 
 	if (!callback) {
@@ -140,6 +172,18 @@ static gboolean usb_source_dispatch(GSource *source,
 	}
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
 
+	if (usource->poller && G_LIKELY(keep)
+			&& G_LIKELY(!g_source_is_destroyed(source))) {
+		for (i = 0; i < usource->pollfds->len; i++) {
+			upollfd = g_ptr_array_index(usource->pollfds, i);
+			if (!upollfd->fired)
+				continue;
+			upollfd->fired = FALSE;
+			sr_session_poller_rearm(usource->poller,
+				upollfd->pollfd.fd);
+		}
+	}
+
 	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
 		if (usource->timeout_us >= 0)
 			usource->due_us = g_source_get_time(source)
@@ -155,6 +199,8 @@ static gboolean usb_source_dispatch(GSource *source,
 static void usb_source_finalize(GSource *source)
 {
 	struct usb_source *usource;
+	struct usb_pollfd *upollfd;
+	unsigned int i;
 
 	usource = (struct usb_source *)source;
 
@@ -162,6 +208,17 @@ static void usb_source_finalize(GSource *source)
 
 	libusb_set_pollfd_notifiers(usource->usb_ctx, NULL, NULL, NULL);
 
+	if (usource->poller) {
+		for (i = 0; i < usource->pollfds->len; i++) {
+			upollfd = g_ptr_array_index(usource->pollfds, i);
+			if (upollfd->polled)
+				sr_session_poller_remove(usource->poller,
+					upollfd->pollfd.fd);
+		}
+		sr_session_poller_unref(usource->poller);
+		usource->poller = NULL;
+	}
+
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
 
@@ -175,23 +232,28 @@ static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
 		short events, void *user_data)
 {
 	struct usb_source *usource;
-	GPollFD *pollfd;
+	struct usb_pollfd *upollfd;
 
 	usource = user_data;
 
 	if (G_UNLIKELY(g_source_is_destroyed(&usource->base)))
 		return;
 
-	pollfd = g_slice_new(GPollFD);
+	upollfd = g_slice_new0(struct usb_pollfd);
 #ifdef _WIN32
 	events = G_IO_IN;
 #endif
-	pollfd->fd = (gintptr)fd;
-	pollfd->events = events;
-	pollfd->revents = 0;
-
-	g_ptr_array_add(usource->pollfds, pollfd);
-	g_source_add_poll(&usource->base, pollfd);
+	upollfd->pollfd.fd = (gintptr)fd;
+	upollfd->pollfd.events = events;
+	upollfd->pollfd.revents = 0;
+
+	g_ptr_array_add(usource->pollfds, upollfd);
+	if (usource->poller && sr_session_poller_add(usource->poller,
+			upollfd->pollfd.fd, events,
+			&upollfd->pollfd.revents) == SR_OK)
+		upollfd->polled = TRUE;
+	else
+		g_source_add_poll(&usource->base, &upollfd->pollfd);
 }
 
 /** Callback invoked when a libusb FD should be removed from the poll set.
@@ -199,7 +261,7 @@ static LIBUSB_CALL void usb_pollfd_added(libusb_os_handle fd,
 static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
 {
 	struct usb_source *usource;
-	GPollFD *pollfd;
+	struct usb_pollfd *upollfd;
 	unsigned int i;
 
 	usource = user_data;
@@ -210,10 +272,15 @@ static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
 	/* It's likely that the removed poll FD is at the end.
 	 */
 	for (i = usource->pollfds->len; G_LIKELY(i > 0); i--) {
-		pollfd = g_ptr_array_index(usource->pollfds, i - 1);
-
-		if ((libusb_os_handle)pollfd->fd == fd) {
-			g_source_remove_poll(&usource->base, pollfd);
+		upollfd = g_ptr_array_index(usource->pollfds, i - 1);
+
+		if ((libusb_os_handle)upollfd->pollfd.fd == fd) {
+			if (upollfd->polled)
+				sr_session_poller_remove(usource->poller,
+					upollfd->pollfd.fd);
+			else
+				g_source_remove_poll(&usource->base,
+					&upollfd->pollfd);
 			g_ptr_array_remove_index_fast(usource->pollfds, i - 1);
 			return;
 		}
@@ -226,7 +293,7 @@ static LIBUSB_CALL void usb_pollfd_removed(libusb_os_handle fd, void *user_data)
  */
 static void usb_source_free_pollfd(void *data)
 {
-	g_slice_free(GPollFD, data);
+	g_slice_free(struct usb_pollfd, data);
 }
 
 /** Create an event source for libusb I/O.
@@ -281,6 +348,7 @@ static GSource *usb_source_new(struct sr_session *session,
 	usource->session = session;
 	usource->usb_ctx = usb_ctx;
 	usource->pollfds = g_ptr_array_new_full(8, &usb_source_free_pollfd);
+	usource->poller = sr_session_poller_get(session);
 
 	for (upfd = upollfds; *upfd != NULL; upfd++)
 		usb_pollfd_added((*upfd)->fd, (*upfd)->events, usource);
@@ -379,6 +447,120 @@ SR_PRIV int sr_usb_split_conn(const char *conn,
 	return valid ? SR_OK : SR_ERR_ARG;
 }
 
+/* A device list which sr_usb_device_list_share() made available. */
+struct shared_device_list {
+	libusb_context *usb_ctx;
+	libusb_device **devlist;
+	ssize_t count;
+	int refcount;
+};
+
+static GMutex shared_lists_mutex;
+static GSList *shared_lists;
+
+static struct shared_device_list *shared_list_find(libusb_context *usb_ctx)
+{
+	struct shared_device_list *shared;
+	GSList *l;
+
+	for (l = shared_lists; l; l = l->next) {
+		shared = l->data;
+		if (shared->usb_ctx == usb_ctx)
+			return shared;
+	}
+
+	return NULL;
+}
+
+/**
+ * Enumerate the USB devices of a libusb context once, and have
+ * sr_usb_get_device_list() return that list until the matching
+ * sr_usb_device_list_unshare() call. Scans of several drivers then
+ * don't enumerate the bus over and over. Calls can nest.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_device_list_share(libusb_context *usb_ctx)
+{
+	struct shared_device_list *shared;
+	ssize_t count;
+
+	g_mutex_lock(&shared_lists_mutex);
+	shared = shared_list_find(usb_ctx);
+	if (shared) {
+		shared->refcount++;
+		g_mutex_unlock(&shared_lists_mutex);
+		return;
+	}
+	shared = g_malloc0(sizeof(*shared));
+	count = libusb_get_device_list(usb_ctx, &shared->devlist);
+	if (count < 0) {
+		sr_err("Failed to retrieve device list: %s.",
+		       libusb_error_name(count));
+		g_free(shared);
+		g_mutex_unlock(&shared_lists_mutex);
+		return;
+	}
+	shared->usb_ctx = usb_ctx;
+	shared->count = count;
+	shared->refcount = 1;
+	shared_lists = g_slist_prepend(shared_lists, shared);
+	g_mutex_unlock(&shared_lists_mutex);
+}
+
+/** @private */
+SR_PRIV void sr_usb_device_list_unshare(libusb_context *usb_ctx)
+{
+	struct shared_device_list *shared;
+
+	g_mutex_lock(&shared_lists_mutex);
+	shared = shared_list_find(usb_ctx);
+	if (shared && --shared->refcount == 0) {
+		shared_lists = g_slist_remove(shared_lists, shared);
+		libusb_free_device_list(shared->devlist, 1);
+		g_free(shared);
+	}
+	g_mutex_unlock(&shared_lists_mutex);
+}
+
+/**
+ * Get the list of USB devices, like libusb_get_device_list() does.
+ *
+ * While a shared list exists for the context, the caller gets a copy
+ * of it, with references on the devices. Either way the caller frees
+ * the list with libusb_free_device_list() as usual.
+ *
+ * @private
+ */
+SR_PRIV ssize_t sr_usb_get_device_list(libusb_context *usb_ctx,
+		libusb_device ***list)
+{
+	struct shared_device_list *shared;
+	libusb_device **copy;
+	ssize_t i;
+
+	g_mutex_lock(&shared_lists_mutex);
+	shared = shared_list_find(usb_ctx);
+	if (!shared) {
+		g_mutex_unlock(&shared_lists_mutex);
+		return libusb_get_device_list(usb_ctx, list);
+	}
+	/* libusb_free_device_list() releases the array with free(). */
+	copy = malloc((shared->count + 1) * sizeof(*copy));
+	if (!copy) {
+		g_mutex_unlock(&shared_lists_mutex);
+		return LIBUSB_ERROR_NO_MEM;
+	}
+	for (i = 0; i < shared->count; i++)
+		copy[i] = libusb_ref_device(shared->devlist[i]);
+	copy[i] = NULL;
+	g_mutex_unlock(&shared_lists_mutex);
+
+	*list = copy;
+
+	return i;
+}
+
 /**
  * Find USB devices according to a connection string.
  *
@@ -412,7 +594,8 @@ SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn)
 
 	/* Looks like a valid USB device specification, but is it connected? */
 	devices = NULL;
-	libusb_get_device_list(usb_ctx, &devlist);
+	if (sr_usb_get_device_list(usb_ctx, &devlist) < 0)
+		return NULL;
 	for (i = 0; devlist[i]; i++) {
 		if ((ret = libusb_get_device_descriptor(devlist[i], &des))) {
 			sr_err("Failed to get device descriptor: %s.",
@@ -449,7 +632,7 @@ SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
 
 	sr_dbg("Trying to open USB device %d.%d.", usb->bus, usb->address);
 
-	if ((cnt = libusb_get_device_list(usb_ctx, &devlist)) < 0) {
+	if ((cnt = sr_usb_get_device_list(usb_ctx, &devlist)) < 0) {
 		sr_err("Failed to retrieve device list: %s.",
 		       libusb_error_name(cnt));
 		return SR_ERR;
@@ -486,34 +669,105 @@ SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb)
 	return ret;
 }
 
+/**
+ * Open a USB device in a libusb context of its own.
+ *
+ * Transfers of a device which was opened this way only complete while
+ * the events of its private context get handled. Drivers use this to
+ * run an event source per device (see usb_context_source_add()), such
+ * that several devices in a session get serviced independently, each
+ * in its own device thread when the session runs device threads.
+ *
+ * @param usb The USB device instance to open. Its private context is
+ *            kept in usb->usb_ctx and is released by sr_usb_close().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Failure.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_open_private(struct sr_usb_dev_inst *usb)
+{
+	int ret;
+
+	ret = libusb_init(&usb->usb_ctx);
+	if (ret != LIBUSB_SUCCESS) {
+		sr_err("libusb_init() returned %s.", libusb_error_name(ret));
+		usb->usb_ctx = NULL;
+		return SR_ERR;
+	}
+
+	ret = sr_usb_open(usb->usb_ctx, usb);
+	if (ret != SR_OK) {
+		libusb_exit(usb->usb_ctx);
+		usb->usb_ctx = NULL;
+	}
+
+	return ret;
+}
+
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb)
 {
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
+	if (usb->usb_ctx) {
+		libusb_exit(usb->usb_ctx);
+		usb->usb_ctx = NULL;
+	}
 	sr_dbg("Closed USB device %d.%d.", usb->bus, usb->address);
 }
 
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data)
+{
+	return usb_context_source_add(session, ctx->libusb_ctx,
+		timeout, cb, cb_data);
+}
+
+SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
+{
+	return usb_context_source_remove(session, ctx->libusb_ctx);
+}
+
+/**
+ * Add an event source for the events of a specific libusb context.
+ *
+ * Unlike usb_source_add() this is not limited to the libsigrok context's
+ * libusb context, the event sources of devices which were opened by
+ * sr_usb_open_private() are independent of each other.
+ *
+ * @private
+ */
+SR_PRIV int usb_context_source_add(struct sr_session *session,
+		libusb_context *usb_ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data)
 {
 	GSource *source;
 	int ret;
 
-	source = usb_source_new(session, ctx->libusb_ctx, timeout);
+	source = usb_source_new(session, usb_ctx, timeout);
 	if (!source)
 		return SR_ERR;
 
 	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+	/*
+	 * Transfer completion callbacks resubmit their transfers. Handle
+	 * them before other sources in the same main context, so that
+	 * timers or idle work never delay the resubmission.
+	 */
+	g_source_set_priority(source, G_PRIORITY_HIGH);
 
-	ret = sr_session_source_add_internal(session, ctx->libusb_ctx, source);
+	ret = sr_session_source_add_internal(session, usb_ctx, source);
 	g_source_unref(source);
 
 	return ret;
 }
 
-SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
+/** @private */
+SR_PRIV int usb_context_source_remove(struct sr_session *session,
+		libusb_context *usb_ctx)
 {
-	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
+	return sr_session_source_remove_internal(session, usb_ctx);
 }
 
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
@@ -598,3 +852,595 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 
 	return ret;
 }
+
+/*
+ * Bulk IN streaming. Logic analyzers keep a queue of transfers submitted
+ * while acquiring, each of which gets resubmitted as soon as its data has
+ * been handed to the driver. The transfers are sized from the data rate:
+ * each holds a few ms of data, so that the data flows steadily at low
+ * rates, while the whole queue buffers enough for the host to catch up
+ * with hiccups at high rates.
+ */
+
+#define STREAM_TRANSFER_MS	10
+#define STREAM_QUEUE_MS		500
+#define STREAM_MAX_TRANSFERS	32
+#define STREAM_ALIGN		512
+
+/* Limits of the queue which a profile may grow to. */
+#define STREAM_QUEUE_MS_MAX	2000
+#define STREAM_TRANSFERS_MAX	128
+
+/*
+ * Where the platform supports it (Linux usbfs), transfer buffers are
+ * allocated in memory which the kernel maps to the device, so the data
+ * needn't be copied from a kernel buffer. The drivers hand the transfer
+ * buffers to the session as they are, without a copy of their own.
+ * Anywhere else, or when the kernel is out of such memory, the buffers
+ * are plain heap memory.
+ */
+static unsigned char *stream_buffer_alloc(struct sr_usb_stream *stream,
+		gboolean *dev_mem)
+{
+	unsigned char *buf;
+
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	buf = libusb_dev_mem_alloc(stream->devhdl, stream->buffer_size);
+	if (buf) {
+		*dev_mem = TRUE;
+		return buf;
+	}
+#endif
+	buf = g_try_malloc(stream->buffer_size);
+	*dev_mem = FALSE;
+
+	return buf;
+}
+
+static void stream_buffer_free(struct sr_usb_stream *stream,
+		unsigned char *buf, gboolean dev_mem)
+{
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	if (dev_mem) {
+		libusb_dev_mem_free(stream->devhdl, buf, stream->buffer_size);
+		return;
+	}
+#else
+	(void)stream;
+	(void)dev_mem;
+#endif
+	g_free(buf);
+}
+
+static void stream_free_transfer(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer)
+{
+	unsigned int i;
+	gboolean dev_mem;
+
+	dev_mem = FALSE;
+	for (i = 0; i < stream->num_transfers; i++) {
+		if (stream->transfers[i] == transfer) {
+			stream->transfers[i] = NULL;
+			dev_mem = stream->dev_mem[i];
+			break;
+		}
+	}
+
+	stream_buffer_free(stream, transfer->buffer, dev_mem);
+	transfer->buffer = NULL;
+	libusb_free_transfer(transfer);
+
+	/* The callback may free the stream, don't touch it afterwards. */
+	if (--stream->submitted == 0) {
+		sr_dbg("Stream done: %" PRIu64 " transfers, %" PRIu64 " bytes, "
+			"%" PRIu64 " empty, %" PRIu64 " overruns, longest gap "
+			"%" PRIu64 " us, longest latency %" PRIu64 " us, at "
+			"least %u of %u in flight.", stream->stats.transfers,
+			stream->stats.bytes, stream->stats.empty_transfers,
+			stream->stats.overruns, stream->stats.gap_max,
+			stream->stats.latency_max, stream->stats.in_flight_min,
+			stream->stats.queue_size);
+		if (stream->cfg.done_cb)
+			stream->cfg.done_cb(stream, stream->cfg.cb_data);
+	}
+}
+
+/* On failure the transfer is freed, possibly along with the stream. */
+static gboolean stream_resubmit_transfer(struct sr_usb_stream *stream,
+		struct libusb_transfer *transfer)
+{
+	int ret;
+
+	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS) {
+		stream->in_flight++;
+		return TRUE;
+	}
+
+	sr_err("%s: %s", __func__, libusb_error_name(ret));
+	stream_free_transfer(stream, transfer);
+
+	return FALSE;
+}
+
+/* Account a transfer's completion, returns its timestamp. */
+static int64_t stream_completed(struct sr_usb_stream *stream)
+{
+	int64_t now, interval;
+
+	now = g_get_monotonic_time();
+	stream->in_flight--;
+	if (stream->in_flight < stream->stats.in_flight_min)
+		stream->stats.in_flight_min = stream->in_flight;
+
+	if (stream->last_us) {
+		interval = now - stream->last_us;
+		stream->stats.gap_total += interval;
+		if ((uint64_t)interval > stream->stats.gap_max)
+			stream->stats.gap_max = interval;
+		/*
+		 * The device kept sending while no transfer completed. Once
+		 * that outlasts what the queue holds, its FIFO has run over.
+		 */
+		if (interval > stream->queue_us) {
+			stream->stats.overruns++;
+			sr_warn("No transfer completed for %" PRIi64 " us, "
+				"data was probably lost.", interval);
+		}
+	}
+	stream->last_us = now;
+
+	return now;
+}
+
+/* Account the time from a transfer's completion until it was resubmitted. */
+static void stream_resubmitted(struct sr_usb_stream *stream, int64_t completed)
+{
+	uint64_t latency;
+
+	latency = g_get_monotonic_time() - completed;
+	stream->stats.latency_total += latency;
+	if (latency > stream->stats.latency_max)
+		stream->stats.latency_max = latency;
+
+	if (stream->cfg.sdi)
+		sr_session_transfer_stats_set(stream->cfg.sdi, &stream->stats);
+}
+
+static void LIBUSB_CALL stream_receive_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_usb_stream *stream;
+	gboolean packet_has_error;
+	int64_t completed;
+	int ret;
+
+	stream = transfer->user_data;
+
+	/*
+	 * If acquisition has already ended, just free any queued up
+	 * transfer that come in.
+	 */
+	if (stream->aborted) {
+		stream_free_transfer(stream, transfer);
+		return;
+	}
+
+	sr_spew("Transfer: status %s received %d bytes.",
+		libusb_error_name(transfer->status), transfer->actual_length);
+	completed = stream_completed(stream);
+
+	packet_has_error = FALSE;
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		sr_usb_stream_abort(stream);
+		stream_free_transfer(stream, transfer);
+		return;
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
+		break;
+	default:
+		packet_has_error = TRUE;
+		break;
+	}
+
+	if (transfer->actual_length == 0 || packet_has_error) {
+		stream->stats.empty_transfers++;
+		if (++stream->empty_count > 2 * stream->num_transfers) {
+			/*
+			 * The device gave up. End the acquisition, the
+			 * frontend will work out that the samplecount is short.
+			 */
+			sr_usb_stream_abort(stream);
+			stream_free_transfer(stream, transfer);
+		} else {
+			if (stream_resubmit_transfer(stream, transfer))
+				stream_resubmitted(stream, completed);
+		}
+		return;
+	}
+	stream->empty_count = 0;
+	stream->stats.transfers++;
+	stream->stats.bytes += transfer->actual_length;
+
+	ret = stream->cfg.data_cb(stream, transfer->buffer,
+		transfer->actual_length, stream->cfg.cb_data);
+	if (ret != SR_OK || stream->aborted) {
+		sr_usb_stream_abort(stream);
+		stream_free_transfer(stream, transfer);
+	} else {
+		if (stream_resubmit_transfer(stream, transfer))
+			stream_resubmitted(stream, completed);
+	}
+}
+
+static const struct {
+	unsigned int transfer_ms;
+	unsigned int queue_ms;
+	unsigned int max_transfers;
+} stream_profiles[] = {
+	[SR_USB_STREAM_BALANCED] = { STREAM_TRANSFER_MS, STREAM_QUEUE_MS, 0 },
+	[SR_USB_STREAM_LOW_LATENCY] = { 2, 100, 0 },
+	[SR_USB_STREAM_ROBUST] = { 20, 1000, 64 },
+};
+
+/**
+ * Size a stream's transfers and queue for a latency profile.
+ *
+ * The profile sets how much data each transfer holds, and how much the
+ * whole queue buffers. When the statistics of a previous acquisition are
+ * passed, the queue grows to hold at least twice the longest gap between
+ * transfer completions seen then, and twice that again if data was lost.
+ * That way a host which stalls now and then gets a deeper queue on the
+ * next run, regardless of the profile. The number of transfers may grow
+ * beyond cfg->max_transfers for the queue to cover its duration.
+ *
+ * @param cfg The stream parameters, bytes_per_sec must already be set.
+ * @param profile The latency profile.
+ * @param prev Statistics of the previous acquisition, or NULL.
+ */
+SR_PRIV void sr_usb_stream_config_profile(struct sr_usb_stream_config *cfg,
+		enum sr_usb_stream_profile profile,
+		const struct sr_transfer_stats *prev)
+{
+	unsigned int queue_ms, num_transfers;
+
+	if (!cfg)
+		return;
+	if ((unsigned int)profile >= ARRAY_SIZE(stream_profiles))
+		profile = SR_USB_STREAM_BALANCED;
+
+	cfg->transfer_ms = stream_profiles[profile].transfer_ms;
+	queue_ms = stream_profiles[profile].queue_ms;
+	if (stream_profiles[profile].max_transfers)
+		cfg->max_transfers = MAX(cfg->max_transfers,
+			stream_profiles[profile].max_transfers);
+
+	if (prev && prev->transfers) {
+		queue_ms = MAX(queue_ms, 2 * prev->gap_max / 1000);
+		if (prev->overruns)
+			queue_ms *= 2;
+		queue_ms = MIN(queue_ms, STREAM_QUEUE_MS_MAX);
+		sr_dbg("Longest gap %" PRIu64 " us (mean %" PRIu64 " us), "
+			"%" PRIu64 " overruns last time, queueing %u ms.",
+			prev->gap_max, prev->gap_total / prev->transfers,
+			prev->overruns, queue_ms);
+	}
+	cfg->queue_ms = queue_ms;
+
+	num_transfers = (queue_ms + cfg->transfer_ms - 1) / cfg->transfer_ms;
+	if (!cfg->max_transfers)
+		cfg->max_transfers = STREAM_MAX_TRANSFERS;
+	if (num_transfers > cfg->max_transfers)
+		cfg->max_transfers = MIN(num_transfers, STREAM_TRANSFERS_MAX);
+}
+
+/**
+ * Create a bulk IN stream, sized for the configured data rate.
+ *
+ * Transfers hold cfg->transfer_ms worth of data, rounded up to a
+ * multiple of cfg->align. There are enough of them to hold cfg->queue_ms
+ * of data, up to cfg->max_transfers. Each transfer times out once the
+ * whole queue's data should have arrived, plus 25% headroom.
+ *
+ * @param devhdl The opened device.
+ * @param cfg The stream parameters, copied into the stream.
+ *
+ * @return The stream, or NULL on invalid parameters.
+ */
+SR_PRIV struct sr_usb_stream *sr_usb_stream_new(
+		struct libusb_device_handle *devhdl,
+		const struct sr_usb_stream_config *cfg)
+{
+	struct sr_usb_stream *stream;
+	uint64_t bytes_per_ms, total;
+	size_t align;
+
+	if (!devhdl || !cfg || !cfg->data_cb)
+		return NULL;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->devhdl = devhdl;
+	stream->cfg = *cfg;
+	if (!stream->cfg.transfer_ms)
+		stream->cfg.transfer_ms = STREAM_TRANSFER_MS;
+	if (!stream->cfg.queue_ms)
+		stream->cfg.queue_ms = STREAM_QUEUE_MS;
+	if (!stream->cfg.max_transfers)
+		stream->cfg.max_transfers = STREAM_MAX_TRANSFERS;
+	if (!stream->cfg.align)
+		stream->cfg.align = STREAM_ALIGN;
+	align = stream->cfg.align;
+
+	/* Very slow streams still get a reasonably sized transfer. */
+	bytes_per_ms = MAX(cfg->bytes_per_sec / 1000, 1);
+	stream->buffer_size = stream->cfg.transfer_ms * bytes_per_ms;
+	stream->buffer_size = (stream->buffer_size + align - 1) / align * align;
+
+	stream->num_transfers = stream->cfg.queue_ms * bytes_per_ms /
+		stream->buffer_size;
+	stream->num_transfers = MIN(stream->num_transfers,
+		stream->cfg.max_transfers);
+	stream->num_transfers = MAX(stream->num_transfers, 1);
+
+	total = (uint64_t)stream->buffer_size * stream->num_transfers;
+	stream->queue_us = total * 1000 / bytes_per_ms;
+	stream->timeout = total / bytes_per_ms;
+	stream->timeout += stream->timeout / 4;
+
+	stream->transfers = g_malloc0(sizeof(*stream->transfers) *
+		stream->num_transfers);
+	stream->dev_mem = g_malloc0(sizeof(*stream->dev_mem) *
+		stream->num_transfers);
+
+	sr_dbg("Stream of %u transfers of %zu bytes, timeout %u ms.",
+		stream->num_transfers, stream->buffer_size, stream->timeout);
+
+	return stream;
+}
+
+/**
+ * Allocate and submit all of a stream's transfers.
+ *
+ * On failure the already submitted transfers are cancelled, and the
+ * done callback runs once they are freed (if any were submitted).
+ */
+SR_PRIV int sr_usb_stream_start(struct sr_usb_stream *stream)
+{
+	struct libusb_transfer *transfer;
+	unsigned char *buf;
+	unsigned int i, num_dev_mem;
+	gboolean dev_mem;
+	int ret;
+
+	if (!stream)
+		return SR_ERR_ARG;
+
+	stream->aborted = FALSE;
+	stream->empty_count = 0;
+	stream->last_us = 0;
+	stream->in_flight = 0;
+	memset(&stream->stats, 0, sizeof(stream->stats));
+	stream->stats.queue_size = stream->num_transfers;
+	stream->stats.in_flight_min = stream->num_transfers;
+
+	num_dev_mem = 0;
+	for (i = 0; i < stream->num_transfers; i++) {
+		if (!(buf = stream_buffer_alloc(stream, &dev_mem))) {
+			sr_err("USB transfer buffer malloc failed.");
+			sr_usb_stream_abort(stream);
+			return SR_ERR_MALLOC;
+		}
+		transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(transfer, stream->devhdl,
+			stream->cfg.endpoint, buf, stream->buffer_size,
+			stream_receive_transfer, stream, stream->timeout);
+		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+			sr_err("Failed to submit transfer: %s.",
+				libusb_error_name(ret));
+			libusb_free_transfer(transfer);
+			stream_buffer_free(stream, buf, dev_mem);
+			sr_usb_stream_abort(stream);
+			return SR_ERR;
+		}
+		stream->transfers[i] = transfer;
+		stream->dev_mem[i] = dev_mem;
+		stream->submitted++;
+		stream->in_flight++;
+		if (dev_mem)
+			num_dev_mem++;
+	}
+	sr_dbg("%u of %u transfer buffers in device memory.",
+		num_dev_mem, stream->num_transfers);
+
+	return SR_OK;
+}
+
+/**
+ * End a stream: cancel its transfers, and drop the data of those
+ * which complete in the meantime.
+ */
+SR_PRIV void sr_usb_stream_abort(struct sr_usb_stream *stream)
+{
+	int i;
+
+	if (!stream)
+		return;
+
+	stream->aborted = TRUE;
+	for (i = stream->num_transfers - 1; i >= 0; i--) {
+		if (stream->transfers[i])
+			libusb_cancel_transfer(stream->transfers[i]);
+	}
+}
+
+/**
+ * Free a stream. None of its transfers must be pending any more.
+ */
+SR_PRIV void sr_usb_stream_free(struct sr_usb_stream *stream)
+{
+	if (!stream)
+		return;
+
+	if (stream->submitted)
+		sr_err("Freeing a stream with %u pending transfers.",
+			stream->submitted);
+	g_free(stream->transfers);
+	g_free(stream->dev_mem);
+	g_free(stream);
+}
+
+/*
+ * Decoding of received data in a thread of its own. Drivers which
+ * download a capture from device memory hand the filled buffers of
+ * their completed transfers to the thread, and resubmit the transfers
+ * with spare buffers right away. That keeps the USB transfers flowing
+ * while the data gets converted and sent to the session.
+ */
+
+struct sr_usb_decoder {
+	GThread *thread;
+	GAsyncQueue *filled;
+	GAsyncQueue *spare;
+	unsigned int num_buffers;
+	size_t buffer_size;
+	sr_usb_decode_cb cb;
+	void *cb_data;
+};
+
+struct usb_decoder_item {
+	uint8_t *buf;
+	size_t length;
+};
+
+static gpointer usb_decoder_thread(gpointer data)
+{
+	struct sr_usb_decoder *dec;
+	struct usb_decoder_item *item;
+
+	dec = data;
+	while ((item = g_async_queue_pop(dec->filled))) {
+		/* An item without a buffer asks the thread to terminate. */
+		if (!item->buf) {
+			g_free(item);
+			break;
+		}
+		dec->cb(item->buf, item->length, dec->cb_data);
+		g_async_queue_push(dec->spare, item->buf);
+		g_free(item);
+	}
+
+	return NULL;
+}
+
+/**
+ * Create a decoding thread for received data.
+ *
+ * The callback runs in the decoding thread, in the order in which the
+ * data was received. It usually sends packets to the session, which
+ * the driver must not do from another thread in the meantime.
+ *
+ * @param buffer_size The size of the transfers' buffers.
+ * @param num_buffers The number of spare buffers. Reception blocks when
+ *                    that much data is waiting for decoding.
+ * @param cb The routine which decodes a buffer's data.
+ * @param cb_data Passed to the callback.
+ *
+ * @return The decoder, or NULL on failure. Drivers decode the data
+ *         themselves then.
+ */
+SR_PRIV struct sr_usb_decoder *sr_usb_decoder_new(size_t buffer_size,
+		unsigned int num_buffers, sr_usb_decode_cb cb, void *cb_data)
+{
+	struct sr_usb_decoder *dec;
+	GError *error;
+	uint8_t *buf;
+	unsigned int i;
+
+	if (!buffer_size || !num_buffers || !cb)
+		return NULL;
+
+	dec = g_malloc0(sizeof(*dec));
+	dec->buffer_size = buffer_size;
+	dec->cb = cb;
+	dec->cb_data = cb_data;
+	dec->filled = g_async_queue_new();
+	dec->spare = g_async_queue_new();
+	for (i = 0; i < num_buffers; i++) {
+		if (!(buf = g_try_malloc(buffer_size)))
+			break;
+		g_async_queue_push(dec->spare, buf);
+	}
+	dec->num_buffers = i;
+
+	error = NULL;
+	if (dec->num_buffers)
+		dec->thread = g_thread_try_new("sr-usb-decode",
+			usb_decoder_thread, dec, &error);
+	if (!dec->thread) {
+		sr_warn("Cannot create decoding thread%s%s, decoding inline.",
+			error ? ": " : "", error ? error->message : "");
+		if (error)
+			g_error_free(error);
+		while ((buf = g_async_queue_try_pop(dec->spare)))
+			g_free(buf);
+		g_async_queue_unref(dec->spare);
+		g_async_queue_unref(dec->filled);
+		g_free(dec);
+		return NULL;
+	}
+	sr_dbg("Decoding in a thread, %u spare buffers of %zu bytes.",
+		dec->num_buffers, buffer_size);
+
+	return dec;
+}
+
+/**
+ * Hand a completed transfer's data to the decoding thread.
+ *
+ * The transfer gets a spare buffer in exchange, and can be resubmitted
+ * right away. Blocks until a spare buffer is available.
+ *
+ * @param dec The decoder.
+ * @param transfer The completed transfer. Its buffer must have been
+ *                 allocated by g_malloc() and be of the decoder's
+ *                 buffer size.
+ */
+SR_PRIV void sr_usb_decoder_push(struct sr_usb_decoder *dec,
+		struct libusb_transfer *transfer)
+{
+	struct usb_decoder_item *item;
+
+	if (!dec || !transfer || transfer->actual_length <= 0)
+		return;
+
+	item = g_malloc(sizeof(*item));
+	item->buf = transfer->buffer;
+	item->length = transfer->actual_length;
+	transfer->buffer = g_async_queue_pop(dec->spare);
+	g_async_queue_push(dec->filled, item);
+}
+
+/**
+ * Wait for the decoding of all pushed data, and free the decoder.
+ *
+ * @param dec The decoder, may be NULL.
+ */
+SR_PRIV void sr_usb_decoder_finish(struct sr_usb_decoder *dec)
+{
+	struct usb_decoder_item *item;
+	uint8_t *buf;
+
+	if (!dec)
+		return;
+
+	/* The terminating item queues behind the pending data. */
+	item = g_malloc0(sizeof(*item));
+	g_async_queue_push(dec->filled, item);
+	g_thread_join(dec->thread);
+
+	while ((buf = g_async_queue_try_pop(dec->spare)))
+		g_free(buf);
+	g_async_queue_unref(dec->spare);
+	g_async_queue_unref(dec->filled);
+	g_free(dec);
+}
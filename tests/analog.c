@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
@@ -428,6 +429,218 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+/* Check double results, value ranges, and strided output. */
+/* Check packed 24bit integer input, in both byte orders. */
+START_TEST(test_analog_to_float_24bit)
+{
+	int ret;
+	size_t i;
+	float fout[3];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	static const uint8_t le[] = {
+		0x01, 0x00, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00, 0x80,
+	};
+	static const uint8_t be[] = {
+		0x00, 0x00, 0x01, 0xff, 0xff, 0xff, 0x80, 0x00, 0x00,
+	};
+	static const float want_signed[] = { 1, -1, -8388608, };
+	static const float want_unsigned[] = { 1, 16777215, 8388608, };
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = 3;
+	encoding.is_float = FALSE;
+	analog.num_samples = 3;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = FALSE;
+	analog.data = (void *)le;
+	ret = sr_analog_to_float(&analog, fout);
+	fail_unless(ret == SR_OK, "i24le conversion failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(fout); i++)
+		fail_unless(fout[i] == want_signed[i], "i24le %zu: %f", i, fout[i]);
+	encoding.is_bigendian = TRUE;
+	analog.data = (void *)be;
+	ret = sr_analog_to_float(&analog, fout);
+	fail_unless(ret == SR_OK, "i24be conversion failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(fout); i++)
+		fail_unless(fout[i] == want_signed[i], "i24be %zu: %f", i, fout[i]);
+
+	encoding.is_signed = FALSE;
+	ret = sr_analog_to_float(&analog, fout);
+	fail_unless(ret == SR_OK, "u24be conversion failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(fout); i++)
+		fail_unless(fout[i] == want_unsigned[i], "u24be %zu: %f", i, fout[i]);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+START_TEST(test_analog_to_double_range)
+{
+	int ret;
+	size_t i;
+	double dout[8];
+	float fout[8];
+	struct sr_channel ch1, ch2;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/* Two interleaved channels, three samples each. */
+	int16_t v[] = { -100, 200, -300, 400, -500, 600, };
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(v[0]);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.scale.p = 1;
+	encoding.scale.q = 8;
+	encoding.offset.p = 1;
+	encoding.offset.q = 2;
+	analog.num_samples = 3;
+	analog.data = v;
+	meaning.channels = g_slist_append(NULL, &ch1);
+	meaning.channels = g_slist_append(meaning.channels, &ch2);
+
+	ret = sr_analog_to_double(&analog, dout);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(v); i++)
+		fail_unless(dout[i] == v[i] / 8.0 + 0.5, "%zu: %f", i, dout[i]);
+
+	/* Values [2, 5), every other result element. */
+	for (i = 0; i < ARRAY_SIZE(fout); i++)
+		fout[i] = 19;
+	ret = sr_analog_to_float_range(&analog, 2, 5, fout, 2);
+	fail_unless(ret == SR_OK);
+	fail_unless(fout[0] == -37.0f && fout[2] == 50.5f
+		&& fout[4] == -62.0f);
+	fail_unless(fout[1] == 19 && fout[3] == 19 && fout[5] == 19);
+
+	/* Empty and invalid ranges. */
+	ret = sr_analog_to_double_range(&analog, 6, 6, dout, 1);
+	fail_unless(ret == SR_OK);
+	ret = sr_analog_to_double_range(&analog, 4, 3, dout, 1);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_to_double_range(&analog, 0, 7, dout, 1);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_to_double_range(&analog, 0, 6, NULL, 1);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* Check statistics and decimation on raw integer input. */
+START_TEST(test_analog_stats_decimate)
+{
+	int ret;
+	double min, max, mean;
+	float dmin[3], dmax[3];
+	struct sr_channel ch1, ch2;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/* Two interleaved channels, five samples each. */
+	uint8_t v[] = { 10, 0, 20, 0, 0, 0, 40, 0, 30, 0, };
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = 1;
+	encoding.is_float = FALSE;
+	encoding.is_signed = FALSE;
+	encoding.scale.p = -1;
+	encoding.scale.q = 2;
+	encoding.offset.p = 5;
+	encoding.offset.q = 1;
+	analog.num_samples = 5;
+	analog.data = v;
+	meaning.channels = g_slist_append(NULL, &ch1);
+	meaning.channels = g_slist_append(meaning.channels, &ch2);
+
+	/* Values 0, -5, 5, -15, -10, a negative scale swaps the extremes. */
+	ret = sr_analog_stats_get(&analog, 0, 0, 5, &min, &max, &mean);
+	fail_unless(ret == SR_OK);
+	fail_unless(min == -15.0 && max == 5.0 && mean == -5.0,
+		"%f %f %f", min, max, mean);
+	ret = sr_analog_stats_get(&analog, 1, 0, 5, &min, &max, NULL);
+	fail_unless(ret == SR_OK);
+	fail_unless(min == 5.0 && max == 5.0);
+
+	ret = sr_analog_decimate(&analog, 0, 0, 5, 2, dmin, dmax);
+	fail_unless(ret == SR_OK);
+	fail_unless(dmin[0] == -5.0f && dmax[0] == 0.0f);
+	fail_unless(dmin[1] == -15.0f && dmax[1] == 5.0f);
+	fail_unless(dmin[2] == -10.0f && dmax[2] == -10.0f);
+
+	ret = sr_analog_stats_get(&analog, 2, 0, 5, &min, &max, &mean);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_stats_get(&analog, 0, 3, 3, &min, &max, &mean);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_decimate(&analog, 0, 0, 5, 0, dmin, dmax);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/* Check thresholding of raw integer input, into bytes and logic bits. */
+START_TEST(test_a2l_threshold_raw)
+{
+	int ret;
+	size_t i;
+	uint8_t out[6], logic[12], state;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	/* With scale -1/4 and offset 1: 4.0, 3.0, 1.0, -1.0, 0.0, 1.25 */
+	int16_t v[] = { -12, -8, 0, 8, 4, -1, };
+	const uint8_t want[] = { 1, 1, 0, 0, 0, 1, };
+	const uint8_t want_st[] = { 1, 1, 1, 0, 0, 0, };
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	encoding.unitsize = sizeof(v[0]);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.scale.p = -1;
+	encoding.scale.q = 4;
+	encoding.offset.p = 1;
+	encoding.offset.q = 1;
+	analog.num_samples = ARRAY_SIZE(v);
+	analog.data = v;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	ret = sr_a2l_threshold(&analog, 1.25, out, ARRAY_SIZE(v));
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(out, want, sizeof(want)) == 0);
+
+	/* Bit 10 of 16-bit logic samples, other bits are kept. */
+	memset(logic, 0xff, sizeof(logic));
+	state = 1;
+	ret = sr_a2l_schmitt_trigger_logic(&analog, 0.5, 2.0, &state,
+		logic, 2, 10, ARRAY_SIZE(v));
+	fail_unless(ret == SR_OK);
+	fail_unless(state == 0);
+	for (i = 0; i < ARRAY_SIZE(v); i++) {
+		fail_unless(logic[2 * i] == 0xff);
+		fail_unless(logic[2 * i + 1] == (want_st[i] ? 0xff : 0xfb));
+	}
+
+	ret = sr_a2l_threshold_logic(&analog, 1.25, logic, 2, 16, 1);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -697,6 +910,10 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_float_24bit);
+	tcase_add_test(tc, test_analog_to_double_range);
+	tcase_add_test(tc, test_a2l_threshold_raw);
+	tcase_add_test(tc, test_analog_stats_decimate);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
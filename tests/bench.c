@@ -0,0 +1,598 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput benchmarks of the datafeed hot paths.
+ *
+ * Every benchmark runs its workload repeatedly for a minimum amount of
+ * time, and reports the number of samples it processed per second. The
+ * results are written to stdout as one JSON object per line, so that
+ * they can get collected and compared across revisions:
+ *
+ *   {"benchmark": "output/csv", "variant": "unitsize=2", "samples": ...,
+ *    "seconds": ..., "samples_per_second": ...}
+ *
+ * Some of the measured routines are internal to the library. This
+ * program is linked statically (see Makefile.am), and uses the private
+ * header.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/* Number of samples which one run of a workload processes. */
+#define BENCH_SAMPLES	(1 << 16)
+
+/* Channel counts of logic data, in bytes per sample. */
+static const size_t logic_unitsizes[] = { 1, 2, 4, 8, };
+
+static double min_seconds = 0.5;
+static const char *filter;
+
+typedef void (*bench_func)(void *arg, size_t samples);
+
+/* Run a workload until the minimum time has passed, report the result. */
+static void bench_run(const char *name, const char *variant,
+		bench_func func, void *arg)
+{
+	gint64 start, elapsed;
+	uint64_t samples;
+	double seconds;
+
+	if (filter && !strstr(name, filter))
+		return;
+
+	/* Warm up caches and lazily initialized state. */
+	func(arg, BENCH_SAMPLES);
+
+	samples = 0;
+	start = g_get_monotonic_time();
+	do {
+		func(arg, BENCH_SAMPLES);
+		samples += BENCH_SAMPLES;
+		elapsed = g_get_monotonic_time() - start;
+	} while (elapsed < min_seconds * G_USEC_PER_SEC);
+
+	seconds = (double)elapsed / G_USEC_PER_SEC;
+	printf("{\"benchmark\": \"%s\", \"variant\": \"%s\", "
+		"\"samples\": %" PRIu64 ", \"seconds\": %.6f, "
+		"\"samples_per_second\": %.0f}\n",
+		name, variant, samples, seconds, samples / seconds);
+	fflush(stdout);
+}
+
+/* A user device with logic channels and an analog channel in a session. */
+struct bench_dev {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *analog_ch;
+};
+
+static void bench_dev_open(struct sr_context *ctx, struct bench_dev *dev,
+		size_t unitsize)
+{
+	char name[16];
+	size_t i;
+
+	sr_session_new(ctx, &dev->session);
+	dev->sdi = sr_dev_inst_user_new("sigrok", "bench", NULL);
+	for (i = 0; i < unitsize * 8; i++) {
+		snprintf(name, sizeof(name), "D%zu", i);
+		sr_dev_inst_channel_add(dev->sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_dev_inst_channel_add(dev->sdi, i, SR_CHANNEL_ANALOG, "A0");
+	dev->analog_ch = g_slist_last(dev->sdi->channels)->data;
+	sr_session_dev_add(dev->session, dev->sdi);
+}
+
+static void bench_dev_close(struct bench_dev *dev)
+{
+	sr_session_destroy(dev->session);
+	sr_dev_inst_free(dev->sdi);
+}
+
+static void datafeed_sink(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+/* Pseudo random but reproducible sample data. */
+static uint8_t *logic_data_new(size_t unitsize)
+{
+	uint8_t *data;
+	GRand *rand;
+	size_t i;
+
+	data = g_malloc(BENCH_SAMPLES * unitsize);
+	rand = g_rand_new_with_seed(unitsize);
+	for (i = 0; i < BENCH_SAMPLES * unitsize; i++)
+		data[i] = g_rand_int(rand) & 0xff;
+	g_rand_free(rand);
+
+	return data;
+}
+
+/*--- analog conversion ----------------------------------------------------*/
+
+struct analog_arg {
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	void *data;
+	float *out;
+	uint8_t *logic;
+	uint8_t state;
+};
+
+static void analog_arg_init(struct analog_arg *arg, size_t unitsize,
+		gboolean is_signed, gboolean is_float, gboolean is_bigendian)
+{
+	GRand *rand;
+	uint8_t *p;
+	size_t i;
+	float f;
+	double d;
+	int32_t v;
+
+	memset(arg, 0, sizeof(*arg));
+	arg->data = g_malloc(BENCH_SAMPLES * unitsize);
+	arg->out = g_malloc(BENCH_SAMPLES * sizeof(float));
+	arg->logic = g_malloc0(BENCH_SAMPLES * sizeof(uint64_t));
+
+	rand = g_rand_new_with_seed(unitsize);
+	p = arg->data;
+	for (i = 0; i < BENCH_SAMPLES; i++, p += unitsize) {
+		if (is_float && unitsize == sizeof(float)) {
+			f = g_rand_double_range(rand, -1.0, 1.0);
+			memcpy(p, &f, sizeof(f));
+		} else if (is_float) {
+			d = g_rand_double_range(rand, -1.0, 1.0);
+			memcpy(p, &d, sizeof(d));
+		} else {
+			v = g_rand_int(rand);
+			memcpy(p, &v, unitsize);
+		}
+	}
+	g_rand_free(rand);
+
+	arg->encoding.unitsize = unitsize;
+	arg->encoding.is_signed = is_signed;
+	arg->encoding.is_float = is_float;
+	arg->encoding.is_bigendian = is_bigendian;
+	arg->encoding.scale.p = 1;
+	arg->encoding.scale.q = is_float ? 1 : 1000;
+	arg->encoding.offset.p = 0;
+	arg->encoding.offset.q = 1;
+	arg->analog.data = arg->data;
+	arg->analog.num_samples = BENCH_SAMPLES;
+	arg->analog.encoding = &arg->encoding;
+	arg->analog.meaning = &arg->meaning;
+	arg->analog.spec = &arg->spec;
+}
+
+static void analog_arg_free(struct analog_arg *arg)
+{
+	g_free(arg->data);
+	g_free(arg->out);
+	g_free(arg->logic);
+}
+
+static void run_analog_to_float(void *arg, size_t samples)
+{
+	struct analog_arg *a = arg;
+
+	(void)samples;
+	sr_analog_to_float(&a->analog, a->out);
+}
+
+static void run_a2l_threshold(void *arg, size_t samples)
+{
+	struct analog_arg *a = arg;
+
+	sr_a2l_threshold(&a->analog, 0.0, a->logic, samples);
+}
+
+static void run_a2l_schmitt_trigger(void *arg, size_t samples)
+{
+	struct analog_arg *a = arg;
+
+	sr_a2l_schmitt_trigger(&a->analog, -0.1, 0.1, &a->state,
+		a->logic, samples);
+}
+
+static void run_a2l_threshold_logic(void *arg, size_t samples)
+{
+	struct analog_arg *a = arg;
+
+	sr_a2l_threshold_logic(&a->analog, 0.0, a->logic, 2, 9, samples);
+}
+
+static void run_a2l_schmitt_trigger_logic(void *arg, size_t samples)
+{
+	struct analog_arg *a = arg;
+
+	sr_a2l_schmitt_trigger_logic(&a->analog, -0.1, 0.1, &a->state,
+		a->logic, 2, 9, samples);
+}
+
+static void bench_analog(void)
+{
+	static const struct {
+		const char *variant;
+		size_t unitsize;
+		gboolean is_signed, is_float, is_bigendian;
+	} encodings[] = {
+		{ "float", sizeof(float), TRUE, TRUE, FALSE, },
+		{ "float-swapped", sizeof(float), TRUE, TRUE, TRUE, },
+		{ "double", sizeof(double), TRUE, TRUE, FALSE, },
+		{ "int8", 1, TRUE, FALSE, FALSE, },
+		{ "uint16", 2, FALSE, FALSE, FALSE, },
+		{ "int16", 2, TRUE, FALSE, FALSE, },
+		{ "int32", 4, TRUE, FALSE, FALSE, },
+	};
+	struct analog_arg arg;
+	size_t i;
+
+	for (i = 0; i < G_N_ELEMENTS(encodings); i++) {
+		analog_arg_init(&arg, encodings[i].unitsize,
+			encodings[i].is_signed, encodings[i].is_float,
+			encodings[i].is_bigendian);
+#ifdef WORDS_BIGENDIAN
+		arg.encoding.is_bigendian = !arg.encoding.is_bigendian;
+#endif
+		bench_run("analog_to_float", encodings[i].variant,
+			run_analog_to_float, &arg);
+		analog_arg_free(&arg);
+	}
+
+	analog_arg_init(&arg, sizeof(float), TRUE, TRUE, FALSE);
+#ifdef WORDS_BIGENDIAN
+	arg.encoding.is_bigendian = TRUE;
+#endif
+	bench_run("a2l_threshold", "float", run_a2l_threshold, &arg);
+	bench_run("a2l_schmitt_trigger", "float",
+		run_a2l_schmitt_trigger, &arg);
+	bench_run("a2l_threshold_logic", "float",
+		run_a2l_threshold_logic, &arg);
+	bench_run("a2l_schmitt_trigger_logic", "float",
+		run_a2l_schmitt_trigger_logic, &arg);
+	analog_arg_free(&arg);
+}
+
+/*--- soft trigger ---------------------------------------------------------*/
+
+struct trigger_arg {
+	struct soft_trigger_logic *stl;
+	uint8_t *data;
+	size_t unitsize;
+};
+
+static void run_soft_trigger(void *arg, size_t samples)
+{
+	struct trigger_arg *t = arg;
+	int pre_trigger_samples;
+
+	soft_trigger_logic_check(t->stl, t->data, samples * t->unitsize,
+		&pre_trigger_samples);
+}
+
+static void bench_soft_trigger(struct sr_context *ctx)
+{
+	struct bench_dev dev;
+	struct trigger_arg arg;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct sr_channel *ch;
+	char variant[32];
+	size_t i, j, last;
+
+	for (i = 0; i < G_N_ELEMENTS(logic_unitsizes); i++) {
+		arg.unitsize = logic_unitsizes[i];
+		bench_dev_open(ctx, &dev, arg.unitsize);
+
+		/*
+		 * Trigger on a rising edge of the most significant channel,
+		 * which the sample data never sets. The whole buffer gets
+		 * scanned in every run.
+		 */
+		arg.data = logic_data_new(arg.unitsize);
+		last = arg.unitsize - 1;
+		for (j = 0; j < BENCH_SAMPLES; j++)
+			arg.data[j * arg.unitsize + last] &= 0x7f;
+		ch = g_slist_nth_data(dev.sdi->channels, arg.unitsize * 8 - 1);
+		trigger = sr_trigger_new(NULL);
+		stage = sr_trigger_stage_add(trigger);
+		sr_trigger_match_add(stage, ch, SR_TRIGGER_RISING, 0);
+		arg.stl = soft_trigger_logic_new(dev.sdi, trigger, 0);
+
+		snprintf(variant, sizeof(variant), "unitsize=%zu", arg.unitsize);
+		bench_run("soft_trigger_logic_check", variant,
+			run_soft_trigger, &arg);
+
+		soft_trigger_logic_free(arg.stl);
+		sr_trigger_free(trigger);
+		g_free(arg.data);
+		bench_dev_close(&dev);
+	}
+}
+
+/*--- feed queues ----------------------------------------------------------*/
+
+struct feed_arg {
+	struct feed_queue_logic *logic_q;
+	struct feed_queue_analog *analog_q;
+	uint8_t *data;
+	float *values;
+	size_t unitsize;
+};
+
+static void run_feed_logic_many(void *arg, size_t samples)
+{
+	struct feed_arg *f = arg;
+
+	feed_queue_logic_submit_many(f->logic_q, f->data, samples);
+}
+
+static void run_feed_logic_one(void *arg, size_t samples)
+{
+	struct feed_arg *f = arg;
+	size_t i;
+
+	/* Short runs of repeated values, as RLE decoders produce them. */
+	for (i = 0; i < samples; i += 4)
+		feed_queue_logic_submit_one(f->logic_q,
+			&f->data[i * f->unitsize], 4);
+}
+
+static void run_feed_analog_many(void *arg, size_t samples)
+{
+	struct feed_arg *f = arg;
+
+	feed_queue_analog_submit_many(f->analog_q, f->values, samples);
+}
+
+static void run_feed_analog_native(void *arg, size_t samples)
+{
+	struct feed_arg *f = arg;
+
+	feed_queue_analog_submit_native(f->analog_q, f->data, samples);
+}
+
+static void bench_feed_queue(struct sr_context *ctx)
+{
+	struct bench_dev dev;
+	struct feed_arg arg;
+	char variant[32];
+	size_t i;
+
+	for (i = 0; i < G_N_ELEMENTS(logic_unitsizes); i++) {
+		arg.unitsize = logic_unitsizes[i];
+		bench_dev_open(ctx, &dev, arg.unitsize);
+		sr_session_datafeed_callback_add(dev.session, datafeed_sink, NULL);
+		arg.data = logic_data_new(arg.unitsize);
+		arg.logic_q = feed_queue_logic_alloc(dev.sdi, 4096, arg.unitsize);
+
+		snprintf(variant, sizeof(variant), "unitsize=%zu", arg.unitsize);
+		bench_run("feed_queue_logic_submit_many", variant,
+			run_feed_logic_many, &arg);
+		bench_run("feed_queue_logic_submit_one", variant,
+			run_feed_logic_one, &arg);
+
+		feed_queue_logic_free(arg.logic_q);
+		g_free(arg.data);
+		bench_dev_close(&dev);
+	}
+
+	bench_dev_open(ctx, &dev, 1);
+	sr_session_datafeed_callback_add(dev.session, datafeed_sink, NULL);
+	arg.values = g_malloc0(BENCH_SAMPLES * sizeof(float));
+	arg.data = logic_data_new(sizeof(int16_t));
+	arg.analog_q = feed_queue_analog_alloc(dev.sdi, 4096, 3, dev.analog_ch);
+	feed_queue_analog_mq_unit(arg.analog_q, SR_MQ_VOLTAGE,
+		(enum sr_mqflag)0, SR_UNIT_VOLT);
+	bench_run("feed_queue_analog_submit_many", "float",
+		run_feed_analog_many, &arg);
+	feed_queue_analog_native(arg.analog_q, sizeof(int16_t), TRUE, FALSE);
+	bench_run("feed_queue_analog_submit_native", "int16",
+		run_feed_analog_native, &arg);
+	feed_queue_analog_free(arg.analog_q);
+	g_free(arg.values);
+	g_free(arg.data);
+	bench_dev_close(&dev);
+}
+
+/*--- transform and output modules -----------------------------------------*/
+
+struct module_arg {
+	const struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+};
+
+static void run_transform(void *arg, size_t samples)
+{
+	struct module_arg *m = arg;
+
+	m->logic.length = samples * m->logic.unitsize;
+	sr_session_send(m->sdi, &m->packet);
+}
+
+static void run_output(void *arg, size_t samples)
+{
+	struct module_arg *m = arg;
+	GString *out;
+
+	m->logic.length = samples * m->logic.unitsize;
+	out = NULL;
+	sr_output_send(m->o, &m->packet, &out);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+static void module_arg_init(struct module_arg *arg,
+		const struct sr_dev_inst *sdi, size_t unitsize)
+{
+	memset(arg, 0, sizeof(*arg));
+	arg->sdi = sdi;
+	arg->logic.unitsize = unitsize;
+	arg->logic.data = logic_data_new(unitsize);
+	arg->packet.type = SR_DF_LOGIC;
+	arg->packet.payload = &arg->logic;
+}
+
+static void bench_transforms(struct sr_context *ctx)
+{
+	const struct sr_transform_module **tmods;
+	const struct sr_transform *t;
+	struct bench_dev dev;
+	struct module_arg arg;
+	char name[64], variant[32];
+	size_t i, j;
+
+	tmods = sr_transform_list();
+	for (i = 0; tmods[i]; i++) {
+		snprintf(name, sizeof(name), "transform/%s",
+			sr_transform_id_get(tmods[i]));
+		for (j = 0; j < G_N_ELEMENTS(logic_unitsizes); j++) {
+			bench_dev_open(ctx, &dev, logic_unitsizes[j]);
+			sr_session_datafeed_callback_add(dev.session,
+				datafeed_sink, NULL);
+			t = sr_transform_new(tmods[i], NULL, dev.sdi);
+			if (!t) {
+				bench_dev_close(&dev);
+				break;
+			}
+			module_arg_init(&arg, dev.sdi, logic_unitsizes[j]);
+			snprintf(variant, sizeof(variant), "unitsize=%zu",
+				logic_unitsizes[j]);
+			bench_run(name, variant, run_transform, &arg);
+
+			dev.session->transforms = g_slist_remove(
+				dev.session->transforms, t);
+			sr_transform_free(t);
+			g_free(arg.logic.data);
+			bench_dev_close(&dev);
+		}
+	}
+}
+
+static void bench_outputs(struct sr_context *ctx)
+{
+	const struct sr_output_module **omods;
+	struct sr_datafeed_packet header_packet;
+	struct sr_datafeed_header header;
+	struct bench_dev dev;
+	struct module_arg arg;
+	GString *out;
+	char name[64], variant[32];
+	size_t i, j;
+
+	header.feed_version = 1;
+	gettimeofday(&header.starttime, NULL);
+	header_packet.type = SR_DF_HEADER;
+	header_packet.payload = &header;
+
+	omods = sr_output_list();
+	for (i = 0; omods[i]; i++) {
+		/* Modules which write files on their own need a file name. */
+		if (sr_output_test_flag(omods[i], SR_OUTPUT_INTERNAL_IO_HANDLING))
+			continue;
+		snprintf(name, sizeof(name), "output/%s",
+			sr_output_id_get(omods[i]));
+		for (j = 0; j < G_N_ELEMENTS(logic_unitsizes); j++) {
+			bench_dev_open(ctx, &dev, logic_unitsizes[j]);
+			module_arg_init(&arg, dev.sdi, logic_unitsizes[j]);
+			arg.o = sr_output_new(omods[i], NULL, dev.sdi, NULL);
+			if (!arg.o) {
+				g_free(arg.logic.data);
+				bench_dev_close(&dev);
+				break;
+			}
+			out = NULL;
+			sr_output_send(arg.o, &header_packet, &out);
+			if (out)
+				g_string_free(out, TRUE);
+
+			snprintf(variant, sizeof(variant), "unitsize=%zu",
+				logic_unitsizes[j]);
+			bench_run(name, variant, run_output, &arg);
+
+			sr_output_free(arg.o);
+			g_free(arg.logic.data);
+			bench_dev_close(&dev);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct sr_context *ctx;
+	GOptionContext *opt_ctx;
+	GError *error;
+	char *opt_filter;
+	double opt_seconds;
+	GOptionEntry entries[] = {
+		{ "time", 't', 0, G_OPTION_ARG_DOUBLE, &opt_seconds,
+			"Minimum run time per benchmark in seconds", "SECONDS" },
+		{ "filter", 'f', 0, G_OPTION_ARG_STRING, &opt_filter,
+			"Only run benchmarks whose name contains TEXT", "TEXT" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL },
+	};
+
+	opt_seconds = min_seconds;
+	opt_filter = NULL;
+	error = NULL;
+	opt_ctx = g_option_context_new("- datafeed throughput benchmarks");
+	g_option_context_add_main_entries(opt_ctx, entries, NULL);
+	if (!g_option_context_parse(opt_ctx, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(opt_ctx);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(opt_ctx);
+	min_seconds = opt_seconds;
+	filter = opt_filter;
+
+	/* Keep log output from skewing the measurements. */
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&ctx) != SR_OK)
+		return EXIT_FAILURE;
+
+	bench_analog();
+	bench_soft_trigger(ctx);
+	bench_feed_queue(ctx);
+	bench_transforms(ctx);
+	bench_outputs(ctx);
+
+	sr_exit(ctx);
+	g_free(opt_filter);
+
+	return EXIT_SUCCESS;
+}
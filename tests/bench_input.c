@@ -0,0 +1,671 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Import throughput benchmarks of input modules.
+ *
+ * Synthetic files of the supported formats are generated in memory,
+ * with a configurable channel count, edge density and size. They get
+ * fed to the input module in 1MiB pieces by means of sr_input_send(),
+ * followed by sr_input_end(). Results are written to stdout as one
+ * JSON object per line, with the rate in MB/s of input data and in
+ * samples/s of logic data which reached the session feed.
+ *
+ * The generated files can be kept with --write, for use with other
+ * tools or for comparisons against real world captures.
+ *
+ * The STF generator uses the library's bundled LZO compressor, this
+ * program is linked statically (see Makefile.am).
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <libsigrok/libsigrok.h>
+#include "minilzo/minilzo.h"
+
+#define SEND_CHUNK_SIZE	(1024 * 1024)
+
+static int opt_channels = 8;
+static double opt_density = 0.05;
+static int opt_size_mb = 64;
+static char *opt_write_dir;
+static char *opt_filter;
+
+static GOptionEntry entries[] = {
+	{ "channels", 'c', 0, G_OPTION_ARG_INT, &opt_channels,
+		"Number of logic channels (default 8)", "COUNT" },
+	{ "density", 'd', 0, G_OPTION_ARG_DOUBLE, &opt_density,
+		"Probability of a channel changing per sample (default 0.05)",
+		"P" },
+	{ "size", 's', 0, G_OPTION_ARG_INT, &opt_size_mb,
+		"Approximate size of every generated file (default 64)", "MB" },
+	{ "write", 'w', 0, G_OPTION_ARG_FILENAME, &opt_write_dir,
+		"Keep the generated files in DIR", "DIR" },
+	{ "filter", 'f', 0, G_OPTION_ARG_STRING, &opt_filter,
+		"Only run generators whose name contains TEXT", "TEXT" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL },
+};
+
+/*--- sample data model ----------------------------------------------------*/
+
+/* Cheap and reproducible pseudo random numbers (xorshift64). */
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+
+	return rng_state;
+}
+
+static void rng_seed(uint64_t seed)
+{
+	rng_state = seed * 0x9e3779b97f4a7c15ull + 1;
+}
+
+/*
+ * Get the next logic sample: every channel toggles with the requested
+ * probability. Densities of 0.5 and above yield random data.
+ */
+static uint64_t next_sample(uint64_t prev, int channels)
+{
+	uint64_t mask, bit, threshold;
+	int i;
+
+	threshold = (uint64_t)(opt_density * (double)UINT32_MAX);
+	mask = 0;
+	for (i = 0; i < channels; i++) {
+		bit = UINT64_C(1) << i;
+		if ((rng_next() & UINT32_MAX) < threshold)
+			mask |= bit;
+	}
+
+	return prev ^ mask;
+}
+
+/* Number of samples until the next change of any channel. */
+static uint64_t next_gap(int channels)
+{
+	uint64_t gap;
+
+	gap = 1;
+	while (!next_sample(0, channels) && gap < 1000000)
+		gap++;
+
+	return gap;
+}
+
+static size_t target_size(void)
+{
+	return (size_t)opt_size_mb * 1024 * 1024;
+}
+
+/*--- generators -----------------------------------------------------------*/
+
+/* A generated file, and the options to import it with. */
+struct corpus {
+	GString *data;
+	const char *options[4];
+};
+
+/* VCD identifiers, from the printable ASCII range. */
+static void vcd_ident(char *buf, int idx)
+{
+	int len;
+
+	len = 0;
+	do {
+		buf[len++] = '!' + idx % 94;
+		idx /= 94;
+	} while (idx);
+	buf[len] = '\0';
+}
+
+static void gen_vcd(struct corpus *c)
+{
+	GString *s;
+	uint64_t value, prev, changed, time;
+	char ident[8];
+	int i;
+
+	s = c->data;
+	g_string_append(s, "$timescale 10 ns $end\n$scope module bench $end\n");
+	for (i = 0; i < opt_channels; i++) {
+		vcd_ident(ident, i);
+		g_string_append_printf(s, "$var wire 1 %s d%d $end\n", ident, i);
+	}
+	g_string_append(s, "$upscope $end\n$enddefinitions $end\n");
+
+	/* Initial values, then changes only. */
+	g_string_append(s, "#0\n$dumpvars\n");
+	for (i = 0; i < opt_channels; i++) {
+		vcd_ident(ident, i);
+		g_string_append_printf(s, "0%s\n", ident);
+	}
+	g_string_append(s, "$end\n");
+
+	prev = 0;
+	time = 0;
+	while (s->len < target_size()) {
+		time += next_gap(opt_channels);
+		value = next_sample(prev, opt_channels);
+		changed = value ^ prev;
+		if (!changed)
+			changed = value ^= 1;
+		g_string_append_printf(s, "#%" PRIu64 "\n", time);
+		for (i = 0; i < opt_channels; i++) {
+			if (!(changed & (UINT64_C(1) << i)))
+				continue;
+			vcd_ident(ident, i);
+			g_string_append_printf(s, "%c%s\n",
+				(value >> i) & 1 ? '1' : '0', ident);
+		}
+		prev = value;
+	}
+	g_string_append_printf(s, "#%" PRIu64 "\n", time + 1);
+}
+
+/* One column per channel, plus a timestamp column. */
+static void gen_csv_logic(struct corpus *c)
+{
+	static char formats[48];
+	GString *s;
+	uint64_t value, n;
+	int i;
+
+	snprintf(formats, sizeof(formats), "column_formats=t,%dl",
+		opt_channels);
+	c->options[0] = formats;
+	c->options[1] = "samplerate=1000000";
+	c->options[2] = "header=false";
+
+	s = c->data;
+	value = 0;
+	for (n = 0; s->len < target_size(); n++) {
+		value = next_sample(value, opt_channels);
+		g_string_append_printf(s, "%" PRIu64, n);
+		for (i = 0; i < opt_channels; i++) {
+			g_string_append_c(s, ',');
+			g_string_append_c(s, (value >> i) & 1 ? '1' : '0');
+		}
+		g_string_append_c(s, '\n');
+	}
+}
+
+/* All channels in one hex column. */
+static void gen_csv_hex(struct corpus *c)
+{
+	static char formats[48];
+	GString *s;
+	uint64_t value;
+	int digits;
+
+	snprintf(formats, sizeof(formats), "column_formats=x%d",
+		opt_channels);
+	c->options[0] = formats;
+	c->options[1] = "samplerate=1000000";
+	c->options[2] = "header=false";
+
+	s = c->data;
+	digits = (opt_channels + 3) / 4;
+	value = 0;
+	while (s->len < target_size()) {
+		value = next_sample(value, opt_channels);
+		g_string_append_printf(s, "%0*" PRIx64 "\n", digits, value);
+	}
+}
+
+static void put_le(char *p, uint64_t value, size_t len)
+{
+	while (len--) {
+		*p++ = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static void append_le(GString *s, uint64_t value, size_t len)
+{
+	while (len--) {
+		g_string_append_c(s, value & 0xff);
+		value >>= 8;
+	}
+}
+
+static void append_double_le(GString *s, double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	append_le(s, bits, sizeof(bits));
+}
+
+/* Saleae Logic 2 digital export: transition times of a single channel. */
+static void gen_saleae(struct corpus *c)
+{
+	GString *s;
+	uint64_t count, n, sample, bits;
+	const double rate = 1e6;
+	double end_time;
+	size_t count_pos;
+
+	c->options[0] = "samplerate=1000000";
+
+	s = c->data;
+	g_string_append_len(s, "<SALEAE>", 8);
+	append_le(s, 0, 4);	/* version */
+	append_le(s, 0, 4);	/* type: digital */
+	append_le(s, 0, 4);	/* initial state */
+	append_double_le(s, 0.0);	/* begin time */
+	count_pos = s->len;
+	append_double_le(s, 0.0);	/* end time, patched below */
+	append_le(s, 0, 8);	/* transition count, patched below */
+
+	sample = 0;
+	count = (target_size() - s->len) / sizeof(double);
+	for (n = 0; n < count; n++) {
+		sample += next_gap(1);
+		append_double_le(s, sample / rate);
+	}
+
+	/* Patch the end time and transition count. */
+	end_time = (sample + 1) / rate;
+	memcpy(&bits, &end_time, sizeof(bits));
+	put_le(&s->str[count_pos], bits, sizeof(bits));
+	put_le(&s->str[count_pos + sizeof(bits)], count, 8);
+}
+
+/*
+ * Asix Sigma test file: text header, then LZO compressed records of
+ * chunks with 64 clusters of 7 16bit samples (50MHz mode). At most 16
+ * channels.
+ */
+#define STF_CHUNK_SIZE		1440
+#define STF_CLUSTERS		64
+#define STF_CLUSTER_SAMPLES	7
+#define STF_RECORD_CHUNKS	(1024 * 1024 / STF_CHUNK_SIZE)
+
+static void gen_stf(struct corpus *c)
+{
+	GString *s, *raw;
+	uint8_t *compressed, *work;
+	lzo_uint compressed_len;
+	uint64_t ts, value, records, r, total_samples;
+	size_t chunk, cluster, i, len_pos;
+	int channels, ch;
+
+	channels = MIN(opt_channels, 16);
+	s = c->data;
+	g_string_append_len(s, "Sigma Test File", 16);
+
+	/* Header, the sample count gets patched in after generation. */
+	g_string_append(s, "TestFirstTS=0\r\n");
+	len_pos = s->len;
+	g_string_append(s, "TestLengthTS=000000000000000000\r\n");
+	g_string_append(s, "TestCLKTime=300300\r\n");
+	g_string_append(s, "Sigma.ClockSource=ClockScheme=0;Period=1\r\n");
+	g_string_append(s, "Sigma.SigmaInputs=");
+	for (ch = 0; ch < 16; ch++)
+		g_string_append_printf(s, "%s%d", ch ? ";" : "", ch + 1);
+	g_string_append(s, "\r\nTraces.Traces=");
+	for (ch = 0; ch < channels; ch++)
+		g_string_append_printf(s, "%sType=Input:Caption=D%d:Input0=%d",
+			ch ? ";" : "", ch, ch);
+	g_string_append(s, "\r\n");
+	g_string_append_c(s, '\0');
+
+	raw = g_string_sized_new(STF_RECORD_CHUNKS * STF_CHUNK_SIZE);
+	compressed = g_malloc(STF_RECORD_CHUNKS * STF_CHUNK_SIZE * 2);
+	work = g_malloc(LZO1X_1_MEM_COMPRESS);
+	lzo_init();
+
+	/* Compression ratios vary with the density, aim for the size. */
+	ts = 0;
+	value = 0;
+	records = 0;
+	while (s->len < target_size()) {
+		g_string_truncate(raw, 0);
+		/* Chunk info blocks. */
+		for (chunk = 0; chunk < STF_RECORD_CHUNKS; chunk++) {
+			r = ts + chunk * STF_CLUSTERS * STF_CLUSTER_SAMPLES;
+			append_le(raw, 0, 4);
+			append_le(raw, records * STF_RECORD_CHUNKS + chunk, 4);
+			append_le(raw, r, 8);
+			append_le(raw, r + STF_CLUSTERS * STF_CLUSTER_SAMPLES - 1, 8);
+			append_le(raw, STF_CLUSTERS * STF_CLUSTER_SAMPLES, 8);
+		}
+		/* Cluster timestamps, all clusters are adjacent. */
+		for (chunk = 0; chunk < STF_RECORD_CHUNKS; chunk++) {
+			for (cluster = 0; cluster < STF_CLUSTERS; cluster++) {
+				append_le(raw, ts, 8);
+				ts += STF_CLUSTER_SAMPLES;
+			}
+		}
+		/* Sample data. */
+		for (i = 0; i < STF_RECORD_CHUNKS * STF_CLUSTERS *
+				STF_CLUSTER_SAMPLES; i++) {
+			value = next_sample(value, channels);
+			append_le(raw, value, 2);
+		}
+
+		lzo1x_1_compress((const lzo_bytep)raw->str, raw->len,
+			compressed, &compressed_len, work);
+		append_le(s, compressed_len, 4);
+		append_le(s, crc32(0, compressed, compressed_len), 4);
+		g_string_append_len(s, (const char *)compressed, compressed_len);
+		records++;
+	}
+	append_le(s, 0xffffffff, 4);
+	append_le(s, 0, 4);
+
+	total_samples = ts;
+	snprintf(&s->str[len_pos], 33, "TestLengthTS=%018" PRIu64,
+		total_samples - 1);
+	s->str[len_pos + 31] = '\r';
+
+	g_free(work);
+	g_free(compressed);
+	g_string_free(raw, TRUE);
+}
+
+/* LogicPort project file, with run length compressed sample lines. */
+static void gen_logicport(struct corpus *c)
+{
+	GString *s, *lines;
+	uint64_t value, count;
+	int channels, i;
+
+	channels = MIN(opt_channels, 34);
+	s = c->data;
+	g_string_append(s, "Version\x11" "1.0\x11" "1\x11"
+		" CAUTION: Do not change the contents of this file.\r\n");
+	g_string_append(s, "AcquiredSamplePeriod\x11" "1e-08\r\n");
+	g_string_append(s, "AcquiredChannelList");
+	for (i = 0; i < channels; i++)
+		g_string_append(s, "\x11True");
+	g_string_append(s, "\r\nInvertedChannelList");
+	for (i = 0; i < channels; i++)
+		g_string_append(s, "\x11" "False");
+	g_string_append(s, "\r\nSignals");
+	for (i = 0; i < channels; i++)
+		g_string_append_printf(s, "\x11" "D%d", i);
+	g_string_append(s, "\r\n");
+
+	/* Sample lines, then the block which announces their count. */
+	lines = g_string_sized_new(target_size());
+	value = 0;
+	count = 0;
+	while (lines->len < target_size()) {
+		value = next_sample(value, channels);
+		g_string_append(lines, "  ");
+		for (i = 0; i < channels; i++) {
+			g_string_append_c(lines, (value >> i) & 1 ? '1' : '0');
+			g_string_append_c(lines, ',');
+		}
+		g_string_append_printf(lines, "%" PRIu64 "\r\n",
+			next_gap(channels));
+		count++;
+	}
+	g_string_append_printf(s, "SampleData\x11%d\x11%" PRIu64 "\r\n{\r\n  ",
+		channels, count);
+	for (i = 0; i < channels; i++)
+		g_string_append_printf(s, "W%d,", i);
+	g_string_append(s, "Count\r\n");
+	g_string_append_len(s, lines->str, lines->len);
+	g_string_append(s, "}\r\n");
+	g_string_append(s, "NotesString\x11/\x11\x11/\r\n");
+	g_string_free(lines, TRUE);
+}
+
+/* Protocol values for a UART waveform, in raw and in text form. */
+static void gen_protocoldata(struct corpus *c, gboolean text)
+{
+	GString *s;
+	size_t n;
+
+	s = c->data;
+	g_string_append(s, "# -- sigrok protocol data values file --\n"
+		"# -- sigrok protocol data header start --\n"
+		"protocol=uart\nbitrate=115200\nframeformat=8n1\n");
+	g_string_append_printf(s, "textinput=%s\n", text ? "yes" : "no");
+	g_string_append(s, "# -- sigrok protocol data header end --\n");
+
+	/* Protocol data expands to many samples, keep it smaller. */
+	for (n = 0; s->len < target_size() / 16; n++) {
+		if (text)
+			g_string_append_printf(s, "%02x%c",
+				(unsigned)(rng_next() & 0xff),
+				n % 16 == 15 ? '\n' : ' ');
+		else
+			g_string_append_c(s, rng_next() & 0xff);
+	}
+}
+
+static void gen_protocoldata_bytes(struct corpus *c)
+{
+	gen_protocoldata(c, FALSE);
+}
+
+static void gen_protocoldata_text(struct corpus *c)
+{
+	gen_protocoldata(c, TRUE);
+}
+
+static const struct generator {
+	const char *name;
+	const char *module;
+	const char *ext;
+	void (*gen)(struct corpus *c);
+} generators[] = {
+	{ "vcd", "vcd", "vcd", gen_vcd, },
+	{ "csv-logic", "csv", "csv", gen_csv_logic, },
+	{ "csv-hex", "csv", "csv", gen_csv_hex, },
+	{ "saleae-logic2", "saleae", "bin", gen_saleae, },
+	{ "stf", "stf", "stf", gen_stf, },
+	{ "logicport", "logicport", "lpf", gen_logicport, },
+	{ "protocoldata-bytes", "protocoldata", "sr-protocol",
+		gen_protocoldata_bytes, },
+	{ "protocoldata-text", "protocoldata", "sr-protocol",
+		gen_protocoldata_text, },
+};
+
+/*--- import ---------------------------------------------------------------*/
+
+/* Convert "key=value" texts to the types of the module's options. */
+static GHashTable *input_options_new(const struct sr_input_module *imod,
+		const char **specs)
+{
+	const struct sr_option **opts;
+	GHashTable *table;
+	GVariant *value;
+	const GVariantType *type;
+	char **kv;
+	size_t i, j;
+
+	table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	opts = sr_input_options_get(imod);
+	for (i = 0; specs[i]; i++) {
+		kv = g_strsplit(specs[i], "=", 2);
+		for (j = 0; opts && opts[j]; j++) {
+			if (!kv[1] || strcmp(opts[j]->id, kv[0]))
+				continue;
+			type = g_variant_get_type(opts[j]->def);
+			if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING))
+				value = g_variant_new_string(kv[1]);
+			else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT64))
+				value = g_variant_new_uint64(
+					g_ascii_strtoull(kv[1], NULL, 10));
+			else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT32))
+				value = g_variant_new_uint32(
+					g_ascii_strtoull(kv[1], NULL, 10));
+			else
+				value = g_variant_parse(type, kv[1],
+					NULL, NULL, NULL);
+			if (value)
+				g_hash_table_insert(table, g_strdup(kv[0]),
+					g_variant_ref_sink(value));
+		}
+		g_strfreev(kv);
+	}
+	sr_input_options_free(opts);
+
+	return table;
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	uint64_t *samples;
+
+	(void)sdi;
+
+	samples = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	if (logic->unitsize)
+		*samples += logic->length / logic->unitsize;
+}
+
+static int import(struct sr_context *ctx, const struct generator *g,
+		struct corpus *c)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	GHashTable *options;
+	GString *buf;
+	uint64_t samples;
+	gint64 start, elapsed;
+	double seconds;
+	size_t pos, len;
+	int ret;
+
+	if (!(imod = sr_input_find(g->module))) {
+		fprintf(stderr, "Input module '%s' not available.\n", g->module);
+		return SR_ERR_NA;
+	}
+	options = input_options_new(imod, c->options);
+	in = sr_input_new(imod, options);
+	g_hash_table_destroy(options);
+	if (!in)
+		return SR_ERR;
+
+	samples = 0;
+	sr_session_new(ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, &samples);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	ret = SR_OK;
+	buf = g_string_sized_new(SEND_CHUNK_SIZE);
+	start = g_get_monotonic_time();
+	for (pos = 0; pos < c->data->len && ret == SR_OK; pos += len) {
+		len = MIN(SEND_CHUNK_SIZE, c->data->len - pos);
+		g_string_truncate(buf, 0);
+		g_string_append_len(buf, &c->data->str[pos], len);
+		ret = sr_input_send(in, buf);
+	}
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+	elapsed = g_get_monotonic_time() - start;
+	g_string_free(buf, TRUE);
+
+	if (ret == SR_OK) {
+		seconds = MAX((double)elapsed / G_USEC_PER_SEC, 1e-6);
+		printf("{\"benchmark\": \"input/%s\", \"channels\": %d, "
+			"\"density\": %g, \"bytes\": %zu, \"samples\": %"
+			PRIu64 ", \"seconds\": %.6f, \"mb_per_second\": %.2f, "
+			"\"samples_per_second\": %.0f}\n",
+			g->name, opt_channels, opt_density, c->data->len,
+			samples, seconds, c->data->len / seconds / 1e6,
+			samples / seconds);
+		fflush(stdout);
+	} else {
+		fprintf(stderr, "Import of %s failed: %s.\n", g->name,
+			sr_strerror(ret));
+	}
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	struct sr_context *ctx;
+	GOptionContext *opt_ctx;
+	GError *error;
+	struct corpus c;
+	char *path;
+	size_t i;
+	int ret;
+
+	error = NULL;
+	opt_ctx = g_option_context_new("- input module import benchmarks");
+	g_option_context_add_main_entries(opt_ctx, entries, NULL);
+	if (!g_option_context_parse(opt_ctx, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(opt_ctx);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(opt_ctx);
+	if (opt_channels < 1 || opt_channels > 64) {
+		fprintf(stderr, "Channel count must be 1 to 64.\n");
+		return EXIT_FAILURE;
+	}
+
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&ctx) != SR_OK)
+		return EXIT_FAILURE;
+
+	ret = EXIT_SUCCESS;
+	for (i = 0; i < G_N_ELEMENTS(generators); i++) {
+		if (opt_filter && !strstr(generators[i].name, opt_filter))
+			continue;
+		memset(&c, 0, sizeof(c));
+		c.data = g_string_sized_new(target_size() + 4096);
+		rng_seed(i + 1);
+		generators[i].gen(&c);
+
+		if (opt_write_dir) {
+			path = g_strdup_printf("%s/bench-%s.%s", opt_write_dir,
+				generators[i].name, generators[i].ext);
+			if (!g_file_set_contents(path, c.data->str,
+					c.data->len, NULL))
+				fprintf(stderr, "Cannot write %s.\n", path);
+			g_free(path);
+		}
+
+		if (import(ctx, &generators[i], &c) != SR_OK)
+			ret = EXIT_FAILURE;
+		g_string_free(c.data, TRUE);
+	}
+
+	sr_exit(ctx);
+
+	return ret;
+}
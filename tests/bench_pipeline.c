@@ -0,0 +1,391 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * End-to-end throughput benchmark of the acquisition pipeline.
+ *
+ * Sample data either comes from the demo driver in its max-throughput
+ * mode, or gets replayed from a session file (see session_driver.c).
+ * It runs through the requested transforms, and every packet gets fed
+ * to the requested output modules. The output text is discarded.
+ *
+ * When the session ends, one JSON object with the overall throughput,
+ * percentiles of the time it took to dispatch a packet to the output
+ * modules, and the peak resident set size of the process is written to
+ * stdout. Examples:
+ *
+ *   bench_pipeline --samples 500000000 --logic 16 -o vcd -o csv
+ *   bench_pipeline --srzip-file ref.sr -o srzip
+ *   bench_pipeline --session ref.sr -T invert -o bits
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <libsigrok/libsigrok.h>
+
+struct pipeline {
+	struct sr_context *ctx;
+	struct sr_session *session;
+	/* Requested output modules, and their instances per device. */
+	GSList *output_modules;
+	GHashTable *outputs;
+	char *srzip_file;
+	gboolean srzip_file_is_temp;
+	/* Dispatch time of every packet, in microseconds. */
+	GArray *latencies;
+	uint64_t samples;
+	uint64_t bytes;
+	gint64 start_us;
+	gint64 end_us;
+};
+
+static char *opt_session;
+static char **opt_outputs;
+static char **opt_transforms;
+static char *opt_srzip_file;
+static gint64 opt_samples = 100000000;
+static gint64 opt_samplerate = 200000000;
+static int opt_logic = 8;
+static int opt_analog = 0;
+
+static GOptionEntry entries[] = {
+	{ "session", 's', 0, G_OPTION_ARG_FILENAME, &opt_session,
+		"Replay a session file instead of running the demo driver",
+		"FILE" },
+	{ "output", 'o', 0, G_OPTION_ARG_STRING_ARRAY, &opt_outputs,
+		"Feed data to an output module (repeatable)", "ID" },
+	{ "transform", 'T', 0, G_OPTION_ARG_STRING_ARRAY, &opt_transforms,
+		"Run data through a transform module (repeatable)", "ID" },
+	{ "srzip-file", 0, 0, G_OPTION_ARG_FILENAME, &opt_srzip_file,
+		"Keep the srzip output in FILE (for use as a reference)",
+		"FILE" },
+	{ "samples", 'n', 0, G_OPTION_ARG_INT64, &opt_samples,
+		"Number of samples the demo driver sends", "COUNT" },
+	{ "samplerate", 'r', 0, G_OPTION_ARG_INT64, &opt_samplerate,
+		"Samplerate of the demo device", "HZ" },
+	{ "logic", 'l', 0, G_OPTION_ARG_INT, &opt_logic,
+		"Number of logic channels of the demo device", "COUNT" },
+	{ "analog", 'a', 0, G_OPTION_ARG_INT, &opt_analog,
+		"Number of analog channels of the demo device", "COUNT" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL },
+};
+
+static void outputs_free(gpointer data)
+{
+	GSList *outputs = data;
+
+	g_slist_free_full(outputs, (GDestroyNotify)sr_output_free);
+}
+
+static void outputs_new(struct pipeline *p, const struct sr_dev_inst *sdi)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	const char *filename;
+	GSList *l, *outputs;
+
+	outputs = NULL;
+	for (l = p->output_modules; l; l = l->next) {
+		omod = l->data;
+		filename = NULL;
+		if (sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING))
+			filename = p->srzip_file;
+		o = sr_output_new(omod, NULL, sdi, filename);
+		if (!o) {
+			fprintf(stderr, "Cannot create %s output.\n",
+				sr_output_id_get(omod));
+			continue;
+		}
+		outputs = g_slist_append(outputs, (gpointer)o);
+	}
+	g_hash_table_replace(p->outputs, (gpointer)sdi, outputs);
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct pipeline *p;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	GSList *l;
+	GString *out;
+	gint64 start, latency;
+	guint32 usec;
+
+	p = cb_data;
+	start = g_get_monotonic_time();
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		outputs_new(p, sdi);
+		if (!p->start_us)
+			p->start_us = start;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		p->bytes += logic->length;
+		if (logic->unitsize)
+			p->samples += logic->length / logic->unitsize;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		p->bytes += analog->num_samples * analog->encoding->unitsize;
+		p->samples += analog->num_samples;
+		break;
+	}
+
+	for (l = g_hash_table_lookup(p->outputs, sdi); l; l = l->next) {
+		out = NULL;
+		if (sr_output_send(l->data, packet, &out) != SR_OK)
+			fprintf(stderr, "Output failed on packet type %d.\n",
+				packet->type);
+		if (out)
+			g_string_free(out, TRUE);
+	}
+
+	latency = g_get_monotonic_time() - start;
+	usec = MIN(latency, G_MAXUINT32);
+	g_array_append_val(p->latencies, usec);
+	if (packet->type == SR_DF_END)
+		p->end_us = g_get_monotonic_time();
+}
+
+static int demo_setup(struct pipeline *p)
+{
+	struct sr_dev_driver **drivers, *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_config logic_opt, analog_opt;
+	GSList *options, *devices;
+	size_t i;
+
+	driver = NULL;
+	drivers = sr_driver_list(p->ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(p->ctx, driver) != SR_OK) {
+		fprintf(stderr, "The demo driver is not available.\n");
+		return SR_ERR_NA;
+	}
+
+	logic_opt.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	logic_opt.data = g_variant_ref_sink(g_variant_new_int32(opt_logic));
+	analog_opt.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	analog_opt.data = g_variant_ref_sink(g_variant_new_int32(opt_analog));
+	options = g_slist_append(NULL, &logic_opt);
+	options = g_slist_append(options, &analog_opt);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(logic_opt.data);
+	g_variant_unref(analog_opt.data);
+	if (!devices) {
+		fprintf(stderr, "The demo driver found no device.\n");
+		return SR_ERR;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	sr_session_new(p->ctx, &p->session);
+	if (sr_dev_open(sdi) != SR_OK)
+		return SR_ERR;
+	sr_session_dev_add(p->session, sdi);
+	sr_config_set(sdi, NULL, SR_CONF_MAX_THROUGHPUT,
+		g_variant_new_boolean(TRUE));
+	sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(opt_samplerate));
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(opt_samples));
+
+	return SR_OK;
+}
+
+static int pipeline_setup(struct pipeline *p)
+{
+	const struct sr_output_module *omod;
+	const struct sr_transform_module *tmod;
+	GSList *devices, *l;
+	char **id;
+	int fd;
+
+	for (id = opt_outputs; id && *id; id++) {
+		if (!(omod = sr_output_find(*id))) {
+			fprintf(stderr, "Unknown output module '%s'.\n", *id);
+			return SR_ERR_ARG;
+		}
+		p->output_modules = g_slist_append(p->output_modules,
+			(gpointer)omod);
+		if (!sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING))
+			continue;
+		if (p->srzip_file)
+			continue;
+		if (opt_srzip_file) {
+			p->srzip_file = g_strdup(opt_srzip_file);
+		} else {
+			fd = g_file_open_tmp("bench-XXXXXX.sr",
+				&p->srzip_file, NULL);
+			if (fd < 0)
+				return SR_ERR_IO;
+			close(fd);
+			g_unlink(p->srzip_file);
+			p->srzip_file_is_temp = TRUE;
+		}
+	}
+
+	if (opt_session) {
+		if (sr_session_load(p->ctx, opt_session, &p->session) != SR_OK) {
+			fprintf(stderr, "Cannot load session file '%s'.\n",
+				opt_session);
+			return SR_ERR;
+		}
+	} else if (demo_setup(p) != SR_OK) {
+		return SR_ERR;
+	}
+
+	sr_session_dev_list(p->session, &devices);
+	for (id = opt_transforms; id && *id; id++) {
+		if (!(tmod = sr_transform_find(*id))) {
+			fprintf(stderr, "Unknown transform module '%s'.\n", *id);
+			g_slist_free(devices);
+			return SR_ERR_ARG;
+		}
+		for (l = devices; l; l = l->next)
+			sr_transform_new(tmod, NULL, l->data);
+	}
+	g_slist_free(devices);
+
+	sr_session_datafeed_callback_add(p->session, datafeed_in, p);
+
+	return SR_OK;
+}
+
+static int latency_cmp(gconstpointer a, gconstpointer b)
+{
+	guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+
+	return (x > y) - (x < y);
+}
+
+static guint32 percentile(GArray *sorted, double pct)
+{
+	size_t idx;
+
+	if (!sorted->len)
+		return 0;
+	idx = (size_t)(pct / 100.0 * (sorted->len - 1) + 0.5);
+
+	return g_array_index(sorted, guint32, idx);
+}
+
+static void pipeline_report(struct pipeline *p)
+{
+	struct rusage usage;
+	struct sr_session_stats *stats;
+	double seconds;
+	char **id;
+
+	g_array_sort(p->latencies, latency_cmp);
+	seconds = (double)(p->end_us - p->start_us) / G_USEC_PER_SEC;
+	if (seconds <= 0)
+		seconds = 1e-6;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("{\"source\": \"%s\", \"transforms\": [",
+		opt_session ? opt_session : "demo");
+	for (id = opt_transforms; id && *id; id++)
+		printf("%s\"%s\"", id == opt_transforms ? "" : ", ", *id);
+	printf("], \"outputs\": [");
+	for (id = opt_outputs; id && *id; id++)
+		printf("%s\"%s\"", id == opt_outputs ? "" : ", ", *id);
+	printf("], \"samples\": %" PRIu64 ", \"bytes\": %" PRIu64
+		", \"seconds\": %.6f, \"samples_per_second\": %.0f"
+		", \"bytes_per_second\": %.0f, \"packets\": %u",
+		p->samples, p->bytes, seconds, p->samples / seconds,
+		p->bytes / seconds, p->latencies->len);
+	printf(", \"dispatch_us\": {\"p50\": %u, \"p90\": %u, \"p99\": %u"
+		", \"p999\": %u, \"max\": %u}",
+		percentile(p->latencies, 50), percentile(p->latencies, 90),
+		percentile(p->latencies, 99), percentile(p->latencies, 99.9),
+		percentile(p->latencies, 100));
+	if (sr_session_stats_get(p->session, &stats) == SR_OK) {
+		printf(", \"queue_high_water\": %zu, \"queue_dropped\": %"
+			PRIu64, stats->queue_high_water, stats->queue_dropped);
+		sr_session_stats_free(stats);
+	}
+	/* Linux reports the maximum resident set size in kilobytes. */
+	printf(", \"peak_rss_kb\": %ld}\n", usage.ru_maxrss);
+}
+
+int main(int argc, char **argv)
+{
+	struct pipeline p;
+	GOptionContext *opt_ctx;
+	GError *error;
+	int ret;
+
+	error = NULL;
+	opt_ctx = g_option_context_new("- acquisition pipeline benchmark");
+	g_option_context_add_main_entries(opt_ctx, entries, NULL);
+	if (!g_option_context_parse(opt_ctx, &argc, &argv, &error)) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		g_option_context_free(opt_ctx);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(opt_ctx);
+
+	memset(&p, 0, sizeof(p));
+	p.outputs = g_hash_table_new_full(NULL, NULL, NULL, outputs_free);
+	p.latencies = g_array_sized_new(FALSE, FALSE, sizeof(guint32), 65536);
+
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&p.ctx) != SR_OK)
+		return EXIT_FAILURE;
+
+	ret = pipeline_setup(&p);
+	if (ret == SR_OK)
+		ret = sr_session_start(p.session);
+	if (ret == SR_OK)
+		ret = sr_session_run(p.session);
+	if (ret == SR_OK) {
+		if (!p.end_us)
+			p.end_us = g_get_monotonic_time();
+		pipeline_report(&p);
+	} else {
+		fprintf(stderr, "Benchmark failed: %s.\n", sr_strerror(ret));
+	}
+
+	/* Outputs flush and close their files when they get freed. */
+	g_hash_table_destroy(p.outputs);
+	if (p.srzip_file_is_temp)
+		g_unlink(p.srzip_file);
+	g_free(p.srzip_file);
+	g_slist_free(p.output_modules);
+	g_array_free(p.latencies, TRUE);
+	if (p.session)
+		sr_session_destroy(p.session);
+	sr_exit(p.ctx);
+
+	return ret == SR_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
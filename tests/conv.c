@@ -268,6 +268,122 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+START_TEST(test_logic_unitsize_convert)
+{
+	static const uint8_t in[] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+		0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
+	};
+	static const uint8_t narrow[] = { 0x01, 0x03, 0x05, 0x07 };
+	static const uint8_t wide[] = {
+		0x01, 0x02, 0x00, 0x00, 0x03, 0x04, 0x00, 0x00,
+	};
+	static const uint8_t odd[] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x00,
+		0x06, 0x07, 0x08, 0x09, 0x0a, 0x00,
+	};
+	uint8_t out[32];
+
+	/* Narrowing of the fast paths, keeps the low bytes. */
+	memset(out, 0xff, sizeof(out));
+	sr_logic_unitsize_convert(in, 2, out, 1, 4);
+	fail_unless(memcmp(out, narrow, sizeof(narrow)) == 0);
+	fail_unless(out[sizeof(narrow)] == 0xff);
+
+	/* Widening of the fast paths, pads with zeros. */
+	memset(out, 0xff, sizeof(out));
+	sr_logic_unitsize_convert(in, 2, out, 4, 2);
+	fail_unless(memcmp(out, wide, sizeof(wide)) == 0);
+
+	/* Same unit size. */
+	sr_logic_unitsize_convert(in, 8, out, 8, 2);
+	fail_unless(memcmp(out, in, sizeof(in)) == 0);
+
+	/* Unit sizes without a fast path. */
+	memset(out, 0xff, sizeof(out));
+	sr_logic_unitsize_convert(in, 5, out, 6, 2);
+	fail_unless(memcmp(out, odd, sizeof(odd)) == 0);
+}
+END_TEST
+
+START_TEST(test_logic_runs_expand)
+{
+	static const uint8_t values[] = { 0x01, 0x02, 0x03, 0x04 };
+	static const uint8_t expanded[] = {
+		0x01, 0x02, 0x01, 0x02, 0x01, 0x02, 0x03, 0x04,
+	};
+	uint64_t lengths[] = { 3, 1 };
+	struct sr_datafeed_logic_runs runs;
+	uint64_t run, offset, count;
+	uint8_t out[16];
+
+	runs.num_runs = 2;
+	runs.unitsize = 2;
+	runs.data = (void *)values;
+	runs.lengths = lengths;
+
+	/* All runs in one go. */
+	run = offset = 0;
+	count = sr_logic_runs_expand(&runs, &run, &offset, out, 8);
+	fail_unless(count == 4);
+	fail_unless(memcmp(out, expanded, sizeof(expanded)) == 0);
+	fail_unless(run == 2 && offset == 0);
+	fail_unless(sr_logic_runs_expand(&runs, &run, &offset, out, 8) == 0);
+
+	/* Split within a run. */
+	run = offset = 0;
+	memset(out, 0, sizeof(out));
+	count = sr_logic_runs_expand(&runs, &run, &offset, out, 2);
+	fail_unless(count == 2);
+	fail_unless(run == 0 && offset == 2);
+	count = sr_logic_runs_expand(&runs, &run, &offset, &out[4], 2);
+	fail_unless(count == 2);
+	fail_unless(memcmp(out, expanded, sizeof(expanded)) == 0);
+}
+END_TEST
+
+START_TEST(test_logic_planar_to_logic)
+{
+	uint32_t words[] = {
+		/* Block 0: channels 0, 9, 15. */
+		0x80000001, 0xffff0000, 0x55555555,
+		/* Block 1. */
+		0x00000000, 0x00000001, 0x80000000,
+	};
+	uint8_t plane_bits[] = { 0, 9, 15 };
+	struct sr_datafeed_logic_planar planar;
+	uint8_t out[2 * 32 * 2];
+	uint16_t sample, expected;
+	size_t blk, i, p;
+
+	planar.num_blocks = 2;
+	planar.unitsize = 2;
+	planar.num_planes = 3;
+	planar.plane_bits = plane_bits;
+	planar.data = words;
+
+	memset(out, 0xaa, sizeof(out));
+	fail_unless(sr_logic_planar_to_logic(&planar, out) == SR_OK);
+	for (blk = 0; blk < 2; blk++) {
+		for (i = 0; i < 32; i++) {
+			expected = 0;
+			for (p = 0; p < 3; p++) {
+				if (words[blk * 3 + p] & (1UL << (31 - i)))
+					expected |= 1 << plane_bits[p];
+			}
+			sample = read_u16le(&out[(blk * 32 + i) * 2]);
+			fail_unless(sample == expected,
+				"Sample %zu: 0x%04x != 0x%04x.",
+				blk * 32 + i, sample, expected);
+		}
+	}
+
+	/* Planes must fit the unit size. */
+	planar.unitsize = 1;
+	fail_unless(sr_logic_planar_to_logic(&planar, out) == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -284,5 +400,11 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("logic");
+	tcase_add_test(tc, test_logic_unitsize_convert);
+	tcase_add_test(tc, test_logic_runs_expand);
+	tcase_add_test(tc, test_logic_planar_to_logic);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
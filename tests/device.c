@@ -61,6 +61,21 @@ START_TEST(test_channel_add)
 }
 END_TEST
 
+START_TEST(test_config_reapply)
+{
+	struct sr_dev_inst *sdi;
+
+	fail_unless(sr_dev_config_reapply(NULL) == SR_ERR_ARG);
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(sdi != NULL, "sr_dev_inst_user_new() failed.");
+
+	/* Nothing was applied to the device yet. */
+	fail_unless(sr_dev_config_reapply(sdi) == SR_OK);
+	fail_unless(sr_dev_config_reapply(sdi) == SR_OK);
+}
+END_TEST
+
 Suite *suite_device(void)
 {
 	Suite *s;
@@ -76,5 +91,9 @@ Suite *suite_device(void)
 	tcase_add_test(tc, test_channel_add);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("sr_dev_config_reapply");
+	tcase_add_test(tc, test_config_reapply);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -40,6 +41,50 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/*
+ * Check whether scanning all drivers concurrently works. Only drivers
+ * which accept the option get scanned, which includes the demo driver.
+ */
+START_TEST(test_driver_scan_all)
+{
+	struct sr_dev_driver **drivers;
+	struct sr_dev_driver *driver;
+	struct sr_config *src;
+	GSList *options, *devices, *l;
+	gboolean have_demo, found_demo;
+	int i;
+
+	srtest_driver_init_all(srtest_ctx);
+
+	have_demo = FALSE;
+	drivers = sr_driver_list(srtest_ctx);
+	for (i = 0; drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			have_demo = TRUE;
+	}
+
+	src = g_malloc0(sizeof(*src));
+	src->key = SR_CONF_NUM_LOGIC_CHANNELS;
+	src->data = g_variant_ref_sink(g_variant_new_int32(4));
+	options = g_slist_append(NULL, src);
+
+	devices = sr_driver_scan_all(srtest_ctx, options);
+	found_demo = FALSE;
+	for (l = devices; l; l = l->next) {
+		driver = sr_dev_inst_driver_get(l->data);
+		fail_unless(driver != NULL, "Device without driver.");
+		if (!strcmp(driver->name, "demo"))
+			found_demo = TRUE;
+	}
+	fail_unless(found_demo == have_demo, "Demo device not found.");
+
+	g_slist_free(devices);
+	g_slist_free(options);
+	g_variant_unref(src->data);
+	g_free(src);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +115,7 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_driver_scan_all);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
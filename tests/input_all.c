@@ -19,7 +19,11 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -33,6 +37,62 @@ START_TEST(test_input_available)
 }
 END_TEST
 
+/* Write a temporary file, return its name. */
+static char *write_temp_file(const void *data, size_t len)
+{
+	GError *error;
+	char *name;
+	int fd;
+
+	error = NULL;
+	fd = g_file_open_tmp("sr-input-XXXXXX", &name, &error);
+	fail_unless(fd >= 0, "Cannot create temp file.");
+	close(fd);
+	fail_unless(g_file_set_contents(name, data, len, &error),
+		"Cannot write temp file.");
+
+	return name;
+}
+
+/* Check that a WAV file's header gets detected by probing. */
+START_TEST(test_input_probe_file)
+{
+	static const uint8_t wav[] = {
+		'R', 'I', 'F', 'F', 0x28, 0, 0, 0,
+		'W', 'A', 'V', 'E', 'f', 'm', 't', ' ',
+		16, 0, 0, 0, 1, 0, 1, 0,
+		0x40, 0x1f, 0, 0, 0x80, 0x3e, 0, 0,
+		2, 0, 16, 0, 'd', 'a', 't', 'a',
+		4, 0, 0, 0, 0x00, 0x10, 0x00, 0xf0,
+	};
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	char *name;
+	int ret;
+
+	name = write_temp_file(wav, sizeof(wav));
+	ret = sr_input_probe_file(name, &imod);
+	fail_unless(ret == SR_OK, "Probe failed: %d.", ret);
+	fail_unless(imod != NULL);
+	fail_unless(strcmp(sr_input_id_get(imod), "wav") == 0,
+		"Unexpected module %s.", sr_input_id_get(imod));
+
+	ret = sr_input_scan_file(name, &in);
+	fail_unless(ret == SR_OK, "Scan failed: %d.", ret);
+	fail_unless(in != NULL);
+	fail_unless(sr_input_module_get(in) == imod);
+	sr_input_free(in);
+
+	g_unlink(name);
+	g_free(name);
+
+	ret = sr_input_probe_file(NULL, &imod);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_input_probe_file("", &imod);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
 Suite *suite_input_all(void)
 {
 	Suite *s;
@@ -42,6 +102,7 @@ Suite *suite_input_all(void)
 
 	tc = tcase_create("basic");
 	tcase_add_test(tc, test_input_available);
+	tcase_add_test(tc, test_input_probe_file);
 	suite_add_tcase(s, tc);
 
 	return s;
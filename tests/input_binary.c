@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <check.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -308,6 +310,64 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+static void range_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	g_string_append_len(cb_data, logic->data, logic->length);
+}
+
+/* Check that loading a range of samples seeks into the file. */
+START_TEST(test_input_binary_load_range)
+{
+	struct sr_input *in;
+	struct sr_session *session;
+	GString *received;
+	GError *error;
+	char *name;
+	int fd, ret;
+
+	error = NULL;
+	fd = g_file_open_tmp("sr-binary-XXXXXX", &name, &error);
+	fail_unless(fd >= 0, "Cannot create temp file.");
+	close(fd);
+	fail_unless(g_file_set_contents(name, "Hello world", 11, &error),
+		"Cannot write temp file.");
+
+	received = g_string_new(NULL);
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, range_datafeed_in, received);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	ret = sr_input_load_file_range(in, name, 6, 3, NULL, NULL);
+	fail_unless(ret == SR_OK, "Loading the range failed: %d.", ret);
+	fail_unless(!strcmp(received->str, "wor"),
+		"Expected 'wor', got '%s'.", received->str);
+
+	/* The end of the range gets clipped to the end of the file. */
+	g_string_truncate(received, 0);
+	sr_input_reset(in);
+	ret = sr_input_load_file_range(in, name, 6, 100, NULL, NULL);
+	fail_unless(ret == SR_OK, "Loading the range failed: %d.", ret);
+	fail_unless(!strcmp(received->str, "world"),
+		"Expected 'world', got '%s'.", received->str);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(received, TRUE);
+	g_unlink(name);
+	g_free(name);
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +381,7 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_load_range);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +97,57 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Check that appending to a buffer yields the same text as sending. */
+START_TEST(test_output_send_append)
+{
+	static const uint8_t samples[] = { 0x00, 0x01, 0x01, 0x00, 0x01 };
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o_send, *o_append;
+	struct sr_datafeed_packet packets[2];
+	struct sr_datafeed_logic logic;
+	GString *sent, *appended, *out;
+	size_t i;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	o_send = sr_output_new(sr_output_find("hex"), NULL, sdi, NULL);
+	o_append = sr_output_new(sr_output_find("hex"), NULL, sdi, NULL);
+	fail_unless(o_send && o_append, "Failed to create output instances.");
+
+	logic.length = sizeof(samples);
+	logic.unitsize = 1;
+	logic.data = (void *)samples;
+	packets[0].type = SR_DF_LOGIC;
+	packets[0].payload = &logic;
+	packets[1].type = SR_DF_END;
+	packets[1].payload = NULL;
+
+	sent = g_string_new(NULL);
+	appended = g_string_new(NULL);
+	for (i = 0; i < ARRAY_SIZE(packets); i++) {
+		out = NULL;
+		ret = sr_output_send(o_send, &packets[i], &out);
+		fail_unless(ret == SR_OK, "sr_output_send() failed: %d.", ret);
+		if (out) {
+			g_string_append(sent, out->str);
+			g_string_free(out, TRUE);
+		}
+		ret = sr_output_send_append(o_append, &packets[i], appended);
+		fail_unless(ret == SR_OK, "sr_output_send_append() failed: %d.", ret);
+	}
+	fail_unless(sent->len > 0, "No output.");
+	fail_unless(!strcmp(sent->str, appended->str),
+		"Appended output differs: '%s' vs '%s'.",
+		sent->str, appended->str);
+
+	g_string_free(sent, TRUE);
+	g_string_free(appended, TRUE);
+	sr_output_free(o_send);
+	sr_output_free(o_append);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +162,7 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_send_append);
 	suite_add_tcase(s, tc);
 
 	return s;
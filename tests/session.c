@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -185,6 +186,272 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether asynchronous dispatch can be configured, and whether
+ * invalid parameters are rejected.
+ */
+START_TEST(test_session_dispatch_async_set)
+{
+	int ret;
+	struct sr_session *sess;
+	uint64_t dropped;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_dispatch_async_set(sess, 64, SR_DISPATCH_BLOCK);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_dispatch_async_set(sess, 64, SR_DISPATCH_DROP);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_dispatch_async_set(sess, 0, SR_DISPATCH_BLOCK);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_datafeed_parallel_set(sess, 4);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_parallel_set(sess, 0);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_device_threads_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_device_threads_set(sess, FALSE);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_recorder_set(sess, 1000000, 0);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_recorder_set(sess, 0, 5000);
+	fail_unless(ret == SR_OK);
+
+	dropped = 42;
+	ret = sr_session_dispatch_dropped_get(sess, &dropped);
+	fail_unless(ret == SR_OK);
+	fail_unless(dropped == 0);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+START_TEST(test_session_dispatch_async_set_bogus)
+{
+	int ret;
+	struct sr_session *sess;
+	uint64_t dropped;
+
+	ret = sr_session_dispatch_async_set(NULL, 64, SR_DISPATCH_BLOCK);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_dispatch_dropped_get(NULL, &dropped);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_datafeed_parallel_set(NULL, 4);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_device_threads_set(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_rearm(NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_recorder_set(NULL, 1000, 0);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_dispatch_async_set(sess, 64, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_dispatch_dropped_get(sess, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_rearm(sess);
+	fail_unless(ret == SR_ERR);
+	ret = sr_session_recorder_snapshot(sess, NULL, NULL, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static void stats_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+/*
+ * Check whether statistics can be retrieved for an idle session, and
+ * cover its callbacks.
+ */
+START_TEST(test_session_stats_get)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_stats *stats;
+
+	ret = sr_session_stats_get(NULL, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_stats_get(sess, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_datafeed_callback_add(sess, stats_cb, NULL);
+	sr_session_datafeed_callback_add(sess, stats_cb, NULL);
+	stats = NULL;
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats != NULL);
+	fail_unless(stats->num_devices == 0);
+	fail_unless(stats->num_transforms == 0);
+	fail_unless(stats->num_callbacks == 2);
+	fail_unless(stats->callbacks[0].calls == 0);
+	fail_unless(stats->queue_high_water == 0);
+	fail_unless(stats->queue_dropped == 0);
+	sr_session_stats_free(stats);
+	sr_session_stats_free(NULL);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether the time base rejects invalid arguments. */
+START_TEST(test_session_timebase_get_bogus)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_timebase tb;
+	int64_t ns;
+
+	ret = sr_session_timebase_get(NULL, NULL, &tb);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_sample_time(NULL, NULL, 0, &ns);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_timebase_get(sess, NULL, &tb);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_sample_time(sess, NULL, 0, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether outputs on worker threads reject invalid arguments. */
+START_TEST(test_session_output_add_bogus)
+{
+	int ret;
+	struct sr_session *sess;
+
+	ret = sr_session_output_add(NULL, NULL, stdout, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_output_remove(NULL, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_output_add(sess, NULL, stdout, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_output_remove(sess, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether the capture store can be enabled and disabled. */
+START_TEST(test_session_store_set)
+{
+	int ret;
+	uint64_t samples;
+	struct sr_session *sess;
+
+	ret = sr_session_store_set(NULL, TRUE, FALSE);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_store_samples_get(sess, NULL, NULL, &samples);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_store_set(sess, TRUE, TRUE);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_store_set(sess, FALSE, FALSE);
+	fail_unless(ret == SR_OK);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether sr_session_file_info_get() rejects bogus arguments. */
+START_TEST(test_session_file_info_get_bogus)
+{
+	int ret;
+	struct sr_session_file_info *info;
+
+	ret = sr_session_file_info_get(NULL, &info);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_file_info_get("foo.sr", NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	info = NULL;
+	ret = sr_session_file_info_get("/this/file/does/not/exist.sr", &info);
+	fail_unless(ret != SR_OK);
+	fail_unless(info == NULL);
+	sr_session_file_info_free(NULL);
+}
+END_TEST
+
+static void release_cb(void *data, void *cb_data)
+{
+	(void)data;
+	(*(int *)cb_data)++;
+}
+
+/*
+ * Check whether buffers invoke their release callback exactly once,
+ * when the last reference was dropped.
+ */
+START_TEST(test_buffer_ref_unref)
+{
+	struct sr_buffer *buf;
+	uint8_t data[16];
+	size_t size;
+	int released;
+
+	released = 0;
+	buf = sr_buffer_new(data, sizeof(data), release_cb, &released);
+	fail_unless(buf != NULL);
+	fail_unless(sr_buffer_data_get(buf, &size) == data);
+	fail_unless(size == sizeof(data));
+
+	fail_unless(sr_buffer_ref(buf) == buf);
+	sr_buffer_unref(buf);
+	fail_unless(released == 0);
+	sr_buffer_unref(buf);
+	fail_unless(released == 1);
+}
+END_TEST
+
+/*
+ * Check whether referencing a plain packet creates a copy, and whether
+ * referencing that copy again shares it.
+ */
+START_TEST(test_packet_ref_unref)
+{
+	struct sr_datafeed_packet packet, *ref1, *ref2;
+	struct sr_datafeed_logic logic;
+	const struct sr_datafeed_logic *logic_ref;
+	uint8_t data[4] = { 0x12, 0x34, 0x56, 0x78 };
+	int ret;
+
+	logic.length = sizeof(data);
+	logic.unitsize = 2;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	ret = sr_packet_ref(&packet, &ref1);
+	fail_unless(ret == SR_OK);
+	fail_unless(ref1 != &packet);
+	logic_ref = ref1->payload;
+	fail_unless(logic_ref->data != data);
+	fail_unless(logic_ref->length == sizeof(data));
+	fail_unless(memcmp(logic_ref->data, data, sizeof(data)) == 0);
+
+	ret = sr_packet_ref(ref1, &ref2);
+	fail_unless(ret == SR_OK);
+	fail_unless(ref2 == ref1);
+
+	sr_packet_unref(ref2);
+	sr_packet_unref(ref1);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -199,6 +466,7 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_new_multiple);
 	tcase_add_test(tc, test_session_destroy);
 	tcase_add_test(tc, test_session_destroy_bogus);
+	tcase_add_test(tc, test_session_file_info_get_bogus);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("trigger");
@@ -209,5 +477,20 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("dispatch");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_dispatch_async_set);
+	tcase_add_test(tc, test_session_dispatch_async_set_bogus);
+	tcase_add_test(tc, test_session_stats_get);
+	tcase_add_test(tc, test_session_timebase_get_bogus);
+	tcase_add_test(tc, test_session_output_add_bogus);
+	tcase_add_test(tc, test_session_store_set);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("refcount");
+	tcase_add_test(tc, test_buffer_ref_unref);
+	tcase_add_test(tc, test_packet_ref_unref);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
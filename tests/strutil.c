@@ -519,6 +519,44 @@ START_TEST(test_text_line)
 }
 END_TEST
 
+START_TEST(test_text_lines)
+{
+	char *input_text, *next_pos, *lines[3];
+	size_t count, taken;
+
+	input_text = g_strdup(" one\ntwo \r\n\nthree\nfour");
+
+	/* Returns no more lines than requested. */
+	taken = 0;
+	count = sr_text_next_lines(input_text, 0, lines, 2, &next_pos, &taken);
+	fail_unless(count == 2, "Unexpected text line count");
+	fail_unless(strcmp(lines[0], "one") == 0, "Unexpected line content");
+	fail_unless(strcmp(lines[1], "two") == 0, "Unexpected line content");
+	fail_unless(next_pos && strcmp(next_pos, "\nthree\nfour") == 0,
+		"Unexpected next line content");
+	fail_unless(taken == strlen(" one\ntwo \r\n"),
+		"Unexpected consumed count");
+
+	/* Stops at the incomplete last line. */
+	count = sr_text_next_lines(next_pos, 0, lines, ARRAY_SIZE(lines),
+		&next_pos, &taken);
+	fail_unless(count == 2, "Unexpected text line count");
+	fail_unless(strcmp(lines[0], "") == 0, "Unexpected line content");
+	fail_unless(strcmp(lines[1], "three") == 0, "Unexpected line content");
+	fail_unless(next_pos && strcmp(next_pos, "four") == 0,
+		"Unexpected next line content");
+	fail_unless(taken == strlen(" one\ntwo \r\n\nthree\n"),
+		"Unexpected consumed count (totalled)");
+
+	count = sr_text_next_lines(next_pos, 0, lines, ARRAY_SIZE(lines),
+		&next_pos, &taken);
+	fail_unless(count == 0, "Incomplete text line found");
+	fail_unless(!next_pos, "Next line found, unexpected");
+
+	g_free(input_text);
+}
+END_TEST
+
 /*
  * TODO Ideally this table of test cases should reside within the
  * test_text_word() routine. But compilation fails when it's put there
@@ -632,6 +670,7 @@ Suite *suite_strutil(void)
 
 	tc = tcase_create("text");
 	tcase_add_test(tc, test_text_line);
+	tcase_add_test(tc, test_text_lines);
 	tcase_add_test(tc, test_text_word);
 	suite_add_tcase(s, tc);
 
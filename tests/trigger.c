@@ -98,6 +98,7 @@ START_TEST(test_trigger_stage_add)
 			fail_unless((int)g_slist_length(t[i]->stages) == (j + 1));
 			fail_unless(s[j]->stage == j);
 			fail_unless(s[j]->matches == NULL);
+			fail_unless(s[j]->count == 0 && s[j]->within == 0);
 		}
 	}
 
@@ -115,6 +116,21 @@ START_TEST(test_trigger_stage_add_null)
 }
 END_TEST
 
+/* Check whether setting the stage timing works. */
+START_TEST(test_trigger_stage_timing_set)
+{
+	struct sr_trigger *t;
+	struct sr_trigger_stage *s;
+
+	t = sr_trigger_new("T");
+	s = sr_trigger_stage_add(t);
+	fail_unless(sr_trigger_stage_timing_set(s, 3, 1000) == SR_OK);
+	fail_unless(s->count == 3 && s->within == 1000);
+	fail_unless(sr_trigger_stage_timing_set(NULL, 3, 1000) == SR_ERR_ARG);
+	sr_trigger_free(t);
+}
+END_TEST
+
 /* Check whether creating/freeing triggers with matches works. */
 START_TEST(test_trigger_match_add)
 {
@@ -249,6 +265,55 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/* Check whether trigger_match_analog_add() validates windows and hysteresis. */
+START_TEST(test_trigger_match_analog_add)
+{
+	int ret;
+	struct sr_trigger *t;
+	struct sr_trigger_stage *s;
+	struct sr_trigger_match *m;
+	struct sr_channel *chl, *cha;
+
+	t = sr_trigger_new("T");
+	s = sr_trigger_stage_add(t);
+	chl = g_malloc0(sizeof(struct sr_channel));
+	chl->type = SR_CHANNEL_LOGIC;
+	chl->name = g_strdup("L0");
+	cha = g_malloc0(sizeof(struct sr_channel));
+	cha->index = 1;
+	cha->type = SR_CHANNEL_ANALOG;
+	cha->name = g_strdup("A0");
+
+	/* Valid window and edge matches. */
+	ret = sr_trigger_match_analog_add(s, cha, SR_TRIGGER_INSIDE, -1.5, 2.5, 0);
+	fail_unless(ret == SR_OK);
+	ret = sr_trigger_match_analog_add(s, cha, SR_TRIGGER_RISING, 1.0, 0, 0.25);
+	fail_unless(ret == SR_OK);
+	fail_unless(g_slist_length(s->matches) == 2);
+	m = s->matches->data;
+	fail_unless(m->value == -1.5f && m->value_high == 2.5f);
+	m = s->matches->next->data;
+	fail_unless(m->value_high == 1.0f && m->hysteresis == 0.25f);
+
+	/* Invalid input. */
+	ret = sr_trigger_match_analog_add(s, chl, SR_TRIGGER_OVER, 0, 0, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_trigger_match_analog_add(s, cha, SR_TRIGGER_ONE, 0, 0, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_trigger_match_analog_add(s, cha, SR_TRIGGER_OUTSIDE, 2.0, 1.0, 0);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_trigger_match_analog_add(s, cha, SR_TRIGGER_EDGE, 0, 0, -0.1);
+	fail_unless(ret == SR_ERR_ARG);
+	fail_unless(g_slist_length(s->matches) == 2);
+
+	sr_trigger_free(t);
+	g_free(chl->name);
+	g_free(chl);
+	g_free(cha->name);
+	g_free(cha);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -267,6 +332,7 @@ Suite *suite_trigger(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_trigger_stage_add);
 	tcase_add_test(tc, test_trigger_stage_add_null);
+	tcase_add_test(tc, test_trigger_stage_timing_set);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("match");
@@ -274,6 +340,7 @@ Suite *suite_trigger(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_trigger_match_add);
 	tcase_add_test(tc, test_trigger_match_add_bogus);
+	tcase_add_test(tc, test_trigger_match_analog_add);
 	suite_add_tcase(s, tc);
 
 	return s;